@@ -70,6 +70,7 @@ static errno_t ls_print(struct dir_elem_t *);
 static errno_t ls_print_single_column(struct dir_elem_t *);
 static int ls_cmp_type_name(const void *, const void *);
 static int ls_cmp_name(const void *, const void *);
+static errno_t ls_stat_entries(const char *, struct dir_elem_t *, int);
 static signed int ls_scan_dir(const char *, DIR *, struct dir_elem_t **);
 static unsigned int ls_recursive(const char *, DIR *);
 static unsigned int ls_scope(const char *, struct dir_elem_t *);
@@ -174,6 +175,70 @@ static int ls_cmp_name(const void *a, const void *b)
 	return str_cmp(da->name, db->name);
 }
 
+/** Get information about directory entries.
+ *
+ * All entries are stat'ed relative to the directory in batches instead
+ * of looking up each path separately.
+ *
+ * @param d		Name of the directory.
+ * @param entries	Entries with the name field filled in.
+ * @param count	Number of entries.
+ */
+static errno_t ls_stat_entries(const char *d, struct dir_elem_t *entries,
+    int count)
+{
+	const char **names = NULL;
+	vfs_stat_t *stats = NULL;
+	errno_t *rcs = NULL;
+	int dfd = -1;
+	errno_t rc;
+	int i;
+
+	if (count == 0)
+		return EOK;
+
+	names = malloc(count * sizeof(char *));
+	stats = malloc(count * sizeof(vfs_stat_t));
+	rcs = malloc(count * sizeof(errno_t));
+	if (!names || !stats || !rcs) {
+		cli_error(CL_ENOMEM, "ls: failed to scan %s", d);
+		rc = ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < count; i++)
+		names[i] = entries[i].name;
+
+	rc = vfs_lookup(d, WALK_DIRECTORY, &dfd);
+	if (rc == EOK)
+		rc = vfs_stat_bulk(dfd, names, count, stats, rcs);
+	if (rc != EOK) {
+		printf("ls: failed to stat entries of %s\n", d);
+		printf("error=%s\n", str_error_name(rc));
+		goto out;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (rcs[i] != EOK) {
+			printf("ls: skipping bogus node %s/%s\n", d,
+			    entries[i].name);
+			printf("error=%s\n", str_error_name(rcs[i]));
+			rc = rcs[i];
+			goto out;
+		}
+
+		entries[i].s = stats[i];
+	}
+
+out:
+	if (dfd >= 0)
+		vfs_put(dfd);
+	free(names);
+	free(stats);
+	free(rcs);
+	return rc;
+}
+
 /** Scan a directory.
  *
  * Scan the content of a directory and print it.
@@ -189,9 +254,6 @@ static signed int ls_scan_dir(const char *d, DIR *dirp,
 	int alloc_blocks = 20;
 	int i;
 	int nbdirs = 0;
-	errno_t rc;
-	int len;
-	char *buff;
 	struct dir_elem_t *tmp;
 	struct dir_elem_t *tosort;
 	struct dirent *dp;
@@ -199,16 +261,9 @@ static signed int ls_scan_dir(const char *d, DIR *dirp,
 	if (!dirp)
 		return -1;
 
-	buff = (char *) malloc(PATH_MAX);
-	if (!buff) {
-		cli_error(CL_ENOMEM, "ls: failed to scan %s", d);
-		return -1;
-	}
-
 	tosort = (struct dir_elem_t *) malloc(alloc_blocks * sizeof(*tosort));
 	if (!tosort) {
 		cli_error(CL_ENOMEM, "ls: failed to scan %s", d);
-		free(buff);
 		return -1;
 	}
 
@@ -233,17 +288,12 @@ static signed int ls_scan_dir(const char *d, DIR *dirp,
 		}
 
 		str_cpy(tosort[nbdirs].name, str_size(dp->d_name) + 1, dp->d_name);
-		len = snprintf(buff, PATH_MAX - 1, "%s/%s", d, tosort[nbdirs].name);
-		buff[len] = '\0';
-
-		rc = vfs_stat_path(buff, &tosort[nbdirs++].s);
-		if (rc != EOK) {
-			printf("ls: skipping bogus node %s\n", buff);
-			printf("error=%s\n", str_error_name(rc));
-			goto out;
-		}
+		nbdirs++;
 	}
 
+	if (ls_stat_entries(d, tosort, nbdirs) != EOK)
+		goto out;
+
 	if (ls.sort) {
 		int (*compar)(const void *, const void *);
 		compar = ls.single_column ? ls_cmp_name : ls_cmp_type_name;
@@ -280,7 +330,6 @@ out:
 	for (i = 0; i < nbdirs; i++)
 		free(tosort[i].name);
 	free(tosort);
-	free(buff);
 
 	return nbdirs;
 }
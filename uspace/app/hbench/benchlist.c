@@ -41,14 +41,19 @@ benchmark_t *benchmarks[] = {
 	&benchmark_dir_read,
 	&benchmark_fibril_mutex,
 	&benchmark_file_read,
+	&benchmark_file_write,
 	&benchmark_rand_read,
 	&benchmark_seq_read,
 	&benchmark_malloc1,
 	&benchmark_malloc2,
+	&benchmark_meta_concurrent,
+	&benchmark_meta_ops,
 	&benchmark_ns_ping,
 	&benchmark_ping_pong,
 	&benchmark_read1k,
 	&benchmark_taskgetid,
+	&benchmark_tcp_conn,
+	&benchmark_tcp_xfer,
 	&benchmark_write1k,
 };
 
@@ -32,20 +32,64 @@
  */
 
 #include <dirent.h>
+#include <errno.h>
+#include <str.h>
 #include <str_error.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <vfs/vfs.h>
 #include "../hbench.h"
 
+/** List directory one entry per VFS request.
+ *
+ * This is how readdir() used to work before batched directory reads
+ * and serves as a baseline.
+ */
+static bool list_single(bench_run_t *run, const char *path)
+{
+	char name[256];
+	aoff64_t pos = 0;
+	ssize_t len;
+	errno_t rc;
+	int fd;
+
+	rc = vfs_lookup_open(path, WALK_DIRECTORY, MODE_READ, &fd);
+	if (rc != EOK) {
+		return bench_run_fail(run, "failed to open %s for reading: %s",
+		    path, str_error(rc));
+	}
+
+	while (vfs_read_short(fd, pos, name, sizeof(name), &len) == EOK)
+		pos += len;
+
+	vfs_put(fd);
+	return true;
+}
+
 /** Execute directory listing benchmark.
  *
  * Note that while this benchmark tries to measure speed of direct
  * read, it rather measures speed of FS cache as it is highly probable
  * that the corresponding blocks would be cached after first run.
+ *
+ * Set the 'mode' param to 'single' to read one entry per request
+ * instead of using batched directory reads.
  */
 static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
 {
 	const char *path = bench_env_param_get(env, "dirname", "/");
+	const char *mode = bench_env_param_get(env, "mode", "batch");
+
+	if (str_cmp(mode, "single") == 0) {
+		bench_run_start(run);
+		for (uint64_t i = 0; i < size; i++) {
+			if (!list_single(run, path))
+				return false;
+		}
+		bench_run_stop(run);
+
+		return true;
+	}
 
 	bench_run_start(run);
 	for (uint64_t i = 0; i < size; i++) {
@@ -69,7 +113,7 @@ static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
 
 benchmark_t benchmark_dir_read = {
 	.name = "dir_read",
-	.desc = "Read contents of a directory (use 'dirname' param to alter the default).",
+	.desc = "Read contents of a directory (use 'dirname' param to alter the default, 'mode=single' to disable batching).",
 	.entry = &runner,
 	.setup = NULL,
 	.teardown = NULL
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str_error.h>
+#include <vfs/vfs.h>
+#include "../hbench.h"
+
+/** Execute file writing benchmark.
+ *
+ * A new file is created and @a size buffers are sequentially appended
+ * to it. The file is synced before the measurement stops so that the
+ * time needed to allocate the blocks and write them out is included.
+ * The file is removed afterwards.
+ */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	const char *path;
+	const char *bsstr;
+	char *buf = NULL;
+	unsigned bsize;
+	aoff64_t pos;
+	size_t nw;
+	int file = -1;
+	int nitem;
+	errno_t rc;
+
+	path = bench_env_param_get(env, "filename", "/tmp/hbench_file_write");
+
+	bsstr = bench_env_param_get(env, "bs", "4096");
+	nitem = sscanf(bsstr, "%u", &bsize);
+	if (nitem < 1 || bsize == 0) {
+		bench_run_fail(run, "'bs' must be a positive number of bytes.");
+		goto error;
+	}
+
+	buf = malloc(bsize);
+	if (buf == NULL) {
+		bench_run_fail(run, "failed to allocate %uB buffer", bsize);
+		goto error;
+	}
+
+	for (unsigned i = 0; i < bsize; i++)
+		buf[i] = (char) i;
+
+	rc = vfs_lookup_open(path, WALK_REGULAR | WALK_MUST_CREATE,
+	    MODE_WRITE, &file);
+	if (rc != EOK) {
+		bench_run_fail(run, "failed to create %s: %s", path,
+		    str_error(rc));
+		goto error;
+	}
+
+	pos = 0;
+	bench_run_start(run);
+	for (uint64_t i = 0; i < size; i++) {
+		rc = vfs_write(file, &pos, buf, bsize, &nw);
+		if (rc != EOK) {
+			bench_run_fail(run, "failed to write to %s: %s",
+			    path, str_error(rc));
+			goto error;
+		}
+	}
+
+	rc = vfs_sync(file);
+	if (rc != EOK) {
+		bench_run_fail(run, "failed to sync %s: %s", path,
+		    str_error(rc));
+		goto error;
+	}
+	bench_run_stop(run);
+
+	vfs_put(file);
+	vfs_unlink_path(path);
+	free(buf);
+
+	return true;
+error:
+	if (file >= 0) {
+		vfs_put(file);
+		vfs_unlink_path(path);
+	}
+	if (buf != NULL)
+		free(buf);
+	return false;
+}
+
+benchmark_t benchmark_file_write = {
+	.name = "file_write",
+	.desc = "Sequentially write a new file (use 'filename' and 'bs' params to alter the defaults).",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/**
+ * @}
+ */
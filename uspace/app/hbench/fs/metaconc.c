@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <errno.h>
+#include <fibril.h>
+#include <fibril_synch.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+#include <vfs/vfs.h>
+#include "../hbench.h"
+
+/*
+ * Concurrent metadata benchmark. Several fibrils repeatedly create and
+ * remove files, each of them in its own directory, so that the VFS can
+ * serve them in parallel.
+ */
+
+#define META_NAME_MAX 256
+
+typedef struct {
+	/** Number of create/unlink pairs for each worker */
+	uint64_t count;
+	/** Protects the fields below */
+	fibril_mutex_t lock;
+	/** Signalled when a worker finishes */
+	fibril_condvar_t done_cv;
+	/** Number of running workers */
+	unsigned running;
+	/** First error reported by any worker */
+	errno_t rc;
+} meta_shared_t;
+
+typedef struct {
+	meta_shared_t *shared;
+	/** Directory of the worker */
+	char dir[META_NAME_MAX];
+} meta_worker_t;
+
+/** Create and remove files in the worker's directory. */
+static errno_t meta_worker(void *arg)
+{
+	meta_worker_t *worker = arg;
+	meta_shared_t *shared = worker->shared;
+	char path[META_NAME_MAX];
+	errno_t rc = EOK;
+
+	for (uint64_t i = 0; i < shared->count; i++) {
+		snprintf(path, sizeof(path), "%s/f%" PRIu64, worker->dir, i);
+
+		rc = vfs_link_path(path, KIND_FILE, NULL);
+		if (rc != EOK)
+			break;
+
+		rc = vfs_unlink_path(path);
+		if (rc != EOK)
+			break;
+	}
+
+	fibril_mutex_lock(&shared->lock);
+	if (rc != EOK && shared->rc == EOK)
+		shared->rc = rc;
+	shared->running--;
+	fibril_condvar_broadcast(&shared->done_cv);
+	fibril_mutex_unlock(&shared->lock);
+
+	return EOK;
+}
+
+/** Execute concurrent metadata benchmark.
+ *
+ * Each of the 'fibrils' workers gets its own directory under 'dirname'
+ * in which it creates and removes @a size files.
+ */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	meta_worker_t *workers = NULL;
+	meta_shared_t shared;
+	const char *dirname;
+	const char *nstr;
+	unsigned nworkers;
+	unsigned ndirs = 0;
+	bool ok = false;
+	int nitem;
+	errno_t rc;
+
+	dirname = bench_env_param_get(env, "dirname", "/tmp");
+
+	nstr = bench_env_param_get(env, "fibrils", "4");
+	nitem = sscanf(nstr, "%u", &nworkers);
+	if (nitem < 1 || nworkers == 0) {
+		bench_run_fail(run, "'fibrils' must be a positive number.");
+		goto out;
+	}
+
+	workers = calloc(nworkers, sizeof(meta_worker_t));
+	if (workers == NULL) {
+		bench_run_fail(run, "failed to allocate %u workers", nworkers);
+		goto out;
+	}
+
+	fibril_mutex_initialize(&shared.lock);
+	fibril_condvar_initialize(&shared.done_cv);
+	shared.count = size;
+	shared.running = 0;
+	shared.rc = EOK;
+
+	for (ndirs = 0; ndirs < nworkers; ndirs++) {
+		meta_worker_t *worker = &workers[ndirs];
+
+		worker->shared = &shared;
+		snprintf(worker->dir, sizeof(worker->dir),
+		    "%s/hbench_meta_%u", dirname, ndirs);
+
+		rc = vfs_link_path(worker->dir, KIND_DIRECTORY, NULL);
+		if (rc != EOK) {
+			bench_run_fail(run, "failed to create %s: %s",
+			    worker->dir, str_error(rc));
+			goto out;
+		}
+	}
+
+	bench_run_start(run);
+
+	fibril_mutex_lock(&shared.lock);
+	for (unsigned i = 0; i < nworkers; i++) {
+		fid_t fid = fibril_create(meta_worker, &workers[i]);
+		if (fid == 0)
+			break;
+
+		shared.running++;
+		fibril_add_ready(fid);
+	}
+
+	if (shared.running < nworkers)
+		shared.rc = ENOMEM;
+
+	while (shared.running > 0)
+		fibril_condvar_wait(&shared.done_cv, &shared.lock);
+	fibril_mutex_unlock(&shared.lock);
+
+	bench_run_stop(run);
+
+	if (shared.rc != EOK) {
+		bench_run_fail(run, "worker failed: %s", str_error(shared.rc));
+		goto out;
+	}
+
+	ok = true;
+out:
+	while (ndirs > 0) {
+		ndirs--;
+		(void) vfs_unlink_path(workers[ndirs].dir);
+	}
+
+	free(workers);
+	return ok;
+}
+
+benchmark_t benchmark_meta_concurrent = {
+	.name = "meta_concurrent",
+	.desc = "Create and unlink files from several fibrils, each in its own directory (use 'fibrils' and 'dirname' params to alter the defaults).",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/**
+ * @}
+ */
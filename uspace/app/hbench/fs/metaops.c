@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <str_error.h>
+#include <vfs/vfs.h>
+#include "../hbench.h"
+
+/*
+ * Metadata benchmark. Creates a number of files in a single directory,
+ * then looks up each of them and finally removes them all. With many
+ * files this exercises i-node and block group descriptor handling of the
+ * file system server much more than the data path.
+ */
+
+#define META_NAME_MAX 256
+
+/** Remove files f0 .. f<count - 1> in a directory. */
+static errno_t unlink_files(const char *dirname, uint64_t count)
+{
+	char path[META_NAME_MAX];
+	errno_t rc = EOK;
+
+	for (uint64_t i = 0; i < count; i++) {
+		snprintf(path, sizeof(path), "%s/f%" PRIu64, dirname, i);
+
+		errno_t rc2 = vfs_unlink_path(path);
+		if (rc2 != EOK && rc == EOK)
+			rc = rc2;
+	}
+
+	return rc;
+}
+
+/** Execute metadata benchmark.
+ *
+ * Creates @a size files in directory 'dirname'/hbench_metaops, stats
+ * and unlinks them.
+ */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	char dir[META_NAME_MAX];
+	char path[META_NAME_MAX];
+	const char *dirname;
+	vfs_stat_t st;
+	uint64_t created = 0;
+	bool ok = false;
+	errno_t rc;
+
+	dirname = bench_env_param_get(env, "dirname", "/tmp");
+	snprintf(dir, sizeof(dir), "%s/hbench_metaops", dirname);
+
+	rc = vfs_link_path(dir, KIND_DIRECTORY, NULL);
+	if (rc != EOK) {
+		bench_run_fail(run, "failed to create %s: %s", dir,
+		    str_error(rc));
+		return false;
+	}
+
+	bench_run_start(run);
+
+	for (created = 0; created < size; created++) {
+		snprintf(path, sizeof(path), "%s/f%" PRIu64, dir, created);
+
+		rc = vfs_link_path(path, KIND_FILE, NULL);
+		if (rc != EOK) {
+			bench_run_fail(run, "failed to create %s: %s", path,
+			    str_error(rc));
+			goto out;
+		}
+	}
+
+	for (uint64_t i = 0; i < size; i++) {
+		snprintf(path, sizeof(path), "%s/f%" PRIu64, dir, i);
+
+		rc = vfs_stat_path(path, &st);
+		if (rc != EOK) {
+			bench_run_fail(run, "failed to stat %s: %s", path,
+			    str_error(rc));
+			goto out;
+		}
+	}
+
+	rc = unlink_files(dir, created);
+	created = 0;
+	if (rc != EOK) {
+		bench_run_fail(run, "failed to unlink files: %s",
+		    str_error(rc));
+		goto out;
+	}
+
+	bench_run_stop(run);
+	ok = true;
+out:
+	if (created > 0)
+		(void) unlink_files(dir, created);
+	(void) vfs_unlink_path(dir);
+	return ok;
+}
+
+benchmark_t benchmark_meta_ops = {
+	.name = "meta_ops",
+	.desc = "Create, stat and unlink files in a single directory (use 'dirname' param to alter the default).",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/**
+ * @}
+ */
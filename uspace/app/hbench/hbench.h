@@ -134,14 +134,19 @@ extern size_t benchmark_count;
 extern benchmark_t benchmark_dir_read;
 extern benchmark_t benchmark_fibril_mutex;
 extern benchmark_t benchmark_file_read;
+extern benchmark_t benchmark_file_write;
 extern benchmark_t benchmark_rand_read;
 extern benchmark_t benchmark_seq_read;
 extern benchmark_t benchmark_malloc1;
 extern benchmark_t benchmark_malloc2;
+extern benchmark_t benchmark_meta_concurrent;
+extern benchmark_t benchmark_meta_ops;
 extern benchmark_t benchmark_ns_ping;
 extern benchmark_t benchmark_ping_pong;
 extern benchmark_t benchmark_read1k;
 extern benchmark_t benchmark_taskgetid;
+extern benchmark_t benchmark_tcp_conn;
+extern benchmark_t benchmark_tcp_xfer;
 extern benchmark_t benchmark_write1k;
 
 #endif
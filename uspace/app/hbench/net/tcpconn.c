@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <errno.h>
+#include <fibril_synch.h>
+#include <inet/addr.h>
+#include <inet/endpoint.h>
+#include <inet/tcp.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+#include "../hbench.h"
+
+/*
+ * TCP connection setup benchmark. Listeners are set up in this task on
+ * several ports of the loopback interface and 'size' client connections
+ * are opened to them, alternating between the ports. The run ends once
+ * the server side has accepted all of the connections. All connections
+ * are kept open until then, so the cost of finding the connection for an
+ * incoming segment and of allocating an ephemeral port grows with the
+ * number of connections unless both take constant time.
+ *
+ * There are only so many ephemeral ports for each remote endpoint,
+ * therefore the number of listening ports must be large enough for the
+ * requested number of connections (four ports suffice for 50000).
+ */
+
+/** Maximum number of listening ports */
+#define CONN_PORTS_MAX 16
+
+/** Accept state shared with the server connection fibrils */
+typedef struct {
+	fibril_mutex_t lock;
+	fibril_condvar_t cv;
+	/** Number of connections the server should accept */
+	uint64_t expected;
+	/** Number of connections accepted so far */
+	uint64_t accepted;
+} conn_accept_t;
+
+static conn_accept_t conn_accept;
+
+static void conn_new_conn(tcp_listener_t *, tcp_conn_t *);
+
+static tcp_listen_cb_t conn_listen_cb = {
+	.new_conn = conn_new_conn
+};
+
+static tcp_cb_t conn_conn_cb = {
+};
+
+/** Server side: count the accepted connection.
+ *
+ * The server side of the connection is closed when this returns, but
+ * it stays in the TCP service until the client side is closed, too.
+ */
+static void conn_new_conn(tcp_listener_t *lst, tcp_conn_t *conn)
+{
+	fibril_mutex_lock(&conn_accept.lock);
+	++conn_accept.accepted;
+	fibril_mutex_unlock(&conn_accept.lock);
+	fibril_condvar_broadcast(&conn_accept.cv);
+}
+
+/** Execute TCP connection setup benchmark.
+ *
+ * Opens @a size connections to ports 'port' to 'port' + 'ports' - 1
+ * on the loopback interface.
+ */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	tcp_t *tcp = NULL;
+	tcp_listener_t *lst[CONN_PORTS_MAX];
+	tcp_conn_t **conn = NULL;
+	inet_ep_t ep;
+	inet_ep2_t epp;
+	const char *sport;
+	const char *snports;
+	uint16_t port;
+	uint16_t nports;
+	uint64_t nconn = 0;
+	unsigned nlst = 0;
+	bool ok = false;
+	errno_t rc;
+
+	sport = bench_env_param_get(env, "port", "5002");
+	rc = str_uint16_t(sport, NULL, 10, true, &port);
+	if (rc != EOK) {
+		bench_run_fail(run, "invalid port '%s'", sport);
+		return false;
+	}
+
+	snports = bench_env_param_get(env, "ports", "4");
+	rc = str_uint16_t(snports, NULL, 10, true, &nports);
+	if (rc != EOK || nports < 1 || nports > CONN_PORTS_MAX ||
+	    port + nports - 1 > UINT16_MAX) {
+		bench_run_fail(run, "invalid number of ports '%s'", snports);
+		return false;
+	}
+
+	conn = calloc(size, sizeof(tcp_conn_t *));
+	if (conn == NULL) {
+		bench_run_fail(run, "out of memory");
+		return false;
+	}
+
+	fibril_mutex_initialize(&conn_accept.lock);
+	fibril_condvar_initialize(&conn_accept.cv);
+	conn_accept.expected = size;
+	conn_accept.accepted = 0;
+
+	rc = tcp_create(&tcp);
+	if (rc != EOK) {
+		bench_run_fail(run, "failed initializing TCP: %s",
+		    str_error(rc));
+		goto out;
+	}
+
+	for (nlst = 0; nlst < nports; nlst++) {
+		inet_ep_init(&ep);
+		inet_addr(&ep.addr, 127, 0, 0, 1);
+		ep.port = port + nlst;
+
+		rc = tcp_listener_create(tcp, &ep, &conn_listen_cb, NULL,
+		    &conn_conn_cb, NULL, &lst[nlst]);
+		if (rc != EOK) {
+			bench_run_fail(run, "failed creating listener: %s",
+			    str_error(rc));
+			goto out;
+		}
+	}
+
+	bench_run_start(run);
+
+	for (nconn = 0; nconn < size; nconn++) {
+		inet_ep2_init(&epp);
+		inet_addr(&epp.remote.addr, 127, 0, 0, 1);
+		epp.remote.port = port + nconn % nports;
+
+		rc = tcp_conn_create(tcp, &epp, &conn_conn_cb, NULL,
+		    &conn[nconn]);
+		if (rc != EOK) {
+			bench_run_fail(run, "failed opening connection %"
+			    PRIu64 ": %s", nconn, str_error(rc));
+			goto out;
+		}
+	}
+
+	/* Wait for the server side to accept everything */
+	fibril_mutex_lock(&conn_accept.lock);
+	while (conn_accept.accepted < conn_accept.expected)
+		fibril_condvar_wait(&conn_accept.cv, &conn_accept.lock);
+	fibril_mutex_unlock(&conn_accept.lock);
+
+	bench_run_stop(run);
+
+	ok = true;
+out:
+	while (nconn > 0)
+		tcp_conn_destroy(conn[--nconn]);
+	while (nlst > 0)
+		tcp_listener_destroy(lst[--nlst]);
+	if (tcp != NULL)
+		tcp_destroy(tcp);
+	free(conn);
+	return ok;
+}
+
+benchmark_t benchmark_tcp_conn = {
+	.name = "tcp_conn",
+	.desc = "Open connections to listeners on the loopback interface (use 'port' and 'ports' params to alter the first port and number of ports).",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/**
+ * @}
+ */
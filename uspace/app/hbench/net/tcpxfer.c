@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup hbench
+ * @{
+ */
+
+#include <errno.h>
+#include <fibril_synch.h>
+#include <inet/addr.h>
+#include <inet/endpoint.h>
+#include <inet/tcp.h>
+#include <mem.h>
+#include <stdlib.h>
+#include <str.h>
+#include <str_error.h>
+#include "../hbench.h"
+
+/*
+ * TCP bulk transfer benchmark (similar to iperf). A listener and a client
+ * connection are set up in this task and 'size' blocks of data are
+ * transferred from the client to the server over the loopback interface.
+ * The run ends once the server side has received all of the data.
+ *
+ * To measure throughput over a path with latency start the TCP service
+ * with the -d option, which delays incoming segments.
+ */
+
+#define XFER_BLOCK_SIZE (16 * 1024)
+
+/** Transfer state shared with the server connection fibril */
+typedef struct {
+	fibril_mutex_t lock;
+	fibril_condvar_t cv;
+	/** Number of bytes the server should receive */
+	uint64_t expected;
+	/** Number of bytes received so far */
+	uint64_t received;
+	/** Server side finished */
+	bool done;
+	/** Server side error */
+	errno_t rc;
+} xfer_t;
+
+static xfer_t xfer;
+
+static void xfer_new_conn(tcp_listener_t *, tcp_conn_t *);
+
+static tcp_listen_cb_t xfer_listen_cb = {
+	.new_conn = xfer_new_conn
+};
+
+static tcp_cb_t xfer_conn_cb = {
+};
+
+/** Server side: receive data until everything expected has arrived. */
+static void xfer_new_conn(tcp_listener_t *lst, tcp_conn_t *conn)
+{
+	uint8_t *buf;
+	size_t nrecv;
+	errno_t rc = EOK;
+
+	buf = malloc(XFER_BLOCK_SIZE);
+	if (buf == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+
+	while (xfer.received < xfer.expected) {
+		rc = tcp_conn_recv_wait(conn, buf, XFER_BLOCK_SIZE, &nrecv);
+		if (rc != EOK)
+			break;
+		if (nrecv == 0) {
+			/* Connection closed prematurely */
+			rc = EIO;
+			break;
+		}
+
+		xfer.received += nrecv;
+	}
+
+	free(buf);
+out:
+	fibril_mutex_lock(&xfer.lock);
+	xfer.rc = rc;
+	xfer.done = true;
+	fibril_mutex_unlock(&xfer.lock);
+	fibril_condvar_broadcast(&xfer.cv);
+}
+
+/** Execute TCP bulk transfer benchmark.
+ *
+ * Sends @a size blocks of XFER_BLOCK_SIZE bytes to port 'port' on the
+ * loopback interface.
+ */
+static bool runner(bench_env_t *env, bench_run_t *run, uint64_t size)
+{
+	tcp_t *tcp = NULL;
+	tcp_listener_t *lst = NULL;
+	tcp_conn_t *conn = NULL;
+	inet_ep_t ep;
+	inet_ep2_t epp;
+	uint8_t *buf = NULL;
+	const char *sport;
+	uint16_t port;
+	bool ok = false;
+	errno_t rc;
+
+	sport = bench_env_param_get(env, "port", "5001");
+	rc = str_uint16_t(sport, NULL, 10, true, &port);
+	if (rc != EOK) {
+		bench_run_fail(run, "invalid port '%s'", sport);
+		return false;
+	}
+
+	buf = malloc(XFER_BLOCK_SIZE);
+	if (buf == NULL) {
+		bench_run_fail(run, "out of memory");
+		return false;
+	}
+
+	for (size_t i = 0; i < XFER_BLOCK_SIZE; i++)
+		buf[i] = (uint8_t) i;
+
+	fibril_mutex_initialize(&xfer.lock);
+	fibril_condvar_initialize(&xfer.cv);
+	xfer.expected = size * XFER_BLOCK_SIZE;
+	xfer.received = 0;
+	xfer.done = false;
+	xfer.rc = EOK;
+
+	rc = tcp_create(&tcp);
+	if (rc != EOK) {
+		bench_run_fail(run, "failed initializing TCP: %s",
+		    str_error(rc));
+		goto out;
+	}
+
+	inet_ep_init(&ep);
+	inet_addr(&ep.addr, 127, 0, 0, 1);
+	ep.port = port;
+
+	rc = tcp_listener_create(tcp, &ep, &xfer_listen_cb, NULL,
+	    &xfer_conn_cb, NULL, &lst);
+	if (rc != EOK) {
+		bench_run_fail(run, "failed creating listener: %s",
+		    str_error(rc));
+		goto out;
+	}
+
+	inet_ep2_init(&epp);
+	inet_addr(&epp.remote.addr, 127, 0, 0, 1);
+	epp.remote.port = port;
+
+	bench_run_start(run);
+
+	rc = tcp_conn_create(tcp, &epp, &xfer_conn_cb, NULL, &conn);
+	if (rc != EOK) {
+		bench_run_fail(run, "failed connecting: %s", str_error(rc));
+		goto out;
+	}
+
+	for (uint64_t i = 0; i < size; i++) {
+		rc = tcp_conn_send(conn, buf, XFER_BLOCK_SIZE);
+		if (rc != EOK) {
+			bench_run_fail(run, "failed sending data: %s",
+			    str_error(rc));
+			goto out;
+		}
+	}
+
+	/* Wait for the server side to receive everything */
+	fibril_mutex_lock(&xfer.lock);
+	while (!xfer.done)
+		fibril_condvar_wait(&xfer.cv, &xfer.lock);
+	fibril_mutex_unlock(&xfer.lock);
+
+	bench_run_stop(run);
+
+	if (xfer.rc != EOK) {
+		bench_run_fail(run, "failed receiving data: %s",
+		    str_error(xfer.rc));
+		goto out;
+	}
+
+	ok = true;
+out:
+	if (conn != NULL) {
+		if (!ok)
+			(void) tcp_conn_reset(conn);
+		tcp_conn_destroy(conn);
+	}
+	if (lst != NULL)
+		tcp_listener_destroy(lst);
+	if (tcp != NULL)
+		tcp_destroy(tcp);
+	free(buf);
+	return ok;
+}
+
+benchmark_t benchmark_tcp_xfer = {
+	.name = "tcp_xfer",
+	.desc = "Transfer blocks of 16 KiB over a TCP connection on the loopback interface (use 'port' param to alter the default).",
+	.entry = &runner,
+	.setup = NULL,
+	.teardown = NULL
+};
+
+/**
+ * @}
+ */
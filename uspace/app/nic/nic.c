@@ -69,6 +69,7 @@ static void print_syntax(void)
 	printf("\tunicast <block|default|list|promisc> - set unicast receive filtering\n");
 	printf("\tmulticast <block|list|promisc> - set multicast receive filtering\n");
 	printf("\tbroadcast <block|allow> - block or allow incoming broadcast frames\n");
+	printf("\tstats - show traffic statistics\n");
 }
 
 static async_sess_t *get_nic_by_index(size_t i)
@@ -260,6 +261,23 @@ static const char *nic_broadcast_mode_str(nic_broadcast_mode_t mode)
 	}
 }
 
+static const char *nic_poll_mode_str(nic_poll_mode_t mode)
+{
+	switch (mode) {
+	case NIC_POLL_IMMEDIATE:
+		return "immediate";
+	case NIC_POLL_ON_DEMAND:
+		return "on demand";
+	case NIC_POLL_PERIODIC:
+		return "periodic";
+	case NIC_POLL_SOFTWARE_PERIODIC:
+		return "software periodic";
+	default:
+		assert(false);
+		return NULL;
+	}
+}
+
 static char *nic_addr_format(nic_address_t *a)
 {
 	int rc;
@@ -345,6 +363,66 @@ error:
 	return rc;
 }
 
+static void nic_print_batch_hist(const char *name, unsigned long *hist)
+{
+	unsigned i;
+
+	printf("\t%s batch sizes:\n", name);
+	for (i = 0; i < NIC_BATCH_HIST_BUCKETS - 1; i++) {
+		printf("\t\t%u-%u: %lu\n", 1u << i, (2u << i) - 1,
+		    hist[i]);
+	}
+
+	printf("\t\t%u+: %lu\n", 1u << i, hist[i]);
+}
+
+static errno_t nic_show_stats(int i)
+{
+	async_sess_t *sess;
+	nic_device_stats_t stats;
+	nic_poll_mode_t poll_mode;
+	struct timespec period;
+	errno_t rc;
+
+	sess = get_nic_by_index(i);
+	if (sess == NULL) {
+		printf("Specified NIC doesn't exist or cannot connect to it.\n");
+		return EINVAL;
+	}
+
+	rc = nic_get_stats(sess, &stats);
+	if (rc != EOK) {
+		printf("Error getting NIC statistics.\n");
+		return EIO;
+	}
+
+	rc = nic_poll_get_mode(sess, &poll_mode, &period);
+	if (rc != EOK) {
+		printf("Error getting NIC poll mode.\n");
+		return EIO;
+	}
+
+	printf("\tPoll mode: %s", nic_poll_mode_str(poll_mode));
+	if (poll_mode == NIC_POLL_PERIODIC ||
+	    poll_mode == NIC_POLL_SOFTWARE_PERIODIC) {
+		printf(" (%lld us)", (long long) (period.tv_sec * 1000000 +
+		    period.tv_nsec / 1000));
+	}
+	printf("\n");
+
+	printf("\tReceived: %lu frames, %lu bytes, %lu errors, "
+	    "%lu dropped\n", stats.receive_packets, stats.receive_bytes,
+	    stats.receive_errors, stats.receive_dropped);
+	printf("\tSent: %lu frames, %lu bytes, %lu errors, %lu dropped\n",
+	    stats.send_packets, stats.send_bytes, stats.send_errors,
+	    stats.send_dropped);
+
+	nic_print_batch_hist("Receive", stats.receive_batch_hist);
+	nic_print_batch_hist("Send", stats.send_batch_hist);
+
+	return EOK;
+}
+
 static errno_t nic_set_speed(int i, char *str)
 {
 	async_sess_t *sess;
@@ -592,6 +670,9 @@ int main(int argc, char *argv[])
 		if (!str_cmp(argv[2], "broadcast"))
 			return nic_set_rx_broadcast(index, argv[3]);
 
+		if (!str_cmp(argv[2], "stats"))
+			return nic_show_stats(index);
+
 	} else {
 		printf(NAME ": Invalid argument.\n");
 		print_syntax();
@@ -32,12 +32,16 @@
 #include <stdint.h>
 
 #include <as.h>
+#include <byteorder.h>
 #include <ddf/driver.h>
 #include <ddf/interrupt.h>
 #include <ddf/log.h>
 #include <ops/nic.h>
 #include <pci_dev_iface.h>
 #include <nic/nic.h>
+#include <inet/checksum.h>
+#include <macros.h>
+#include <str_error.h>
 
 #include <nic.h>
 
@@ -45,17 +49,42 @@
 
 #define NAME	"virtio-net"
 
-#define VIRTIO_NET_NUM_QUEUES	3
-
-#define RX_QUEUE_1	0
-#define TX_QUEUE_1	1
-#define CT_QUEUE_1	2
+/** Index of the receive virtqueue of queue pair @a i */
+#define RX_QUEUE(i)	(2 * (i))
+/** Index of the transmit virtqueue of queue pair @a i */
+#define TX_QUEUE(i)	(2 * (i) + 1)
 
 #define BUFFER_SIZE	2048
 #define RX_BUF_SIZE	BUFFER_SIZE
+/**
+ * Received packet is placed this far into an RX buffer, so that the IP header
+ * following the packet header and the Ethernet header is 32-bit aligned
+ */
+#define RX_BUF_PAD \
+	((4 - (sizeof(virtio_net_hdr_t) + ETH_HDR_SIZE) % 4) % 4)
+/** Length of an RX buffer given to the device */
+#define RX_BUF_LEN	(RX_BUF_SIZE - RX_BUF_PAD)
 #define TX_BUF_SIZE	BUFFER_SIZE
 #define CT_BUF_SIZE	BUFFER_SIZE
 
+#define ETH_HDR_SIZE	14
+#define ETYPE_IPV4	0x0800
+#define ETYPE_IPV6	0x86dd
+#define IPV4_HDR_SIZE	20
+#define IPV6_HDR_SIZE	40
+#define IP_PROTO_TCP	6
+#define IP_PROTO_UDP	17
+
+/** Largest frame (without FCS) that can be sent */
+#define VIRTIO_NET_FRAME_MAX	1514
+/** Maximum number of descriptors used by a single transmitted frame */
+#define TX_CHAIN_MAX \
+	((sizeof(virtio_net_hdr_t) + VIRTIO_NET_FRAME_MAX + \
+	TX_BUF_SIZE - 1) / TX_BUF_SIZE)
+
+/** How long to wait for the device to complete a control command (usec) */
+#define VIRTIO_NET_CT_TIMEOUT	1000000
+
 static ddf_dev_ops_t virtio_net_dev_ops;
 
 static errno_t virtio_net_dev_add(ddf_dev_t *dev);
@@ -69,50 +98,409 @@ static driver_t virtio_net_driver = {
 	.driver_ops = &virtio_net_driver_ops
 };
 
-/** VirtIO net IRQ handler.
+/** Locate the transport header of an unfragmented IP packet.
  *
- * @param icall IRQ event notification
- * @param arg Argument (nic_t *)
+ * @param data Frame data
+ * @param size Frame size
+ * @param ipv6 Place to store @c true iff the packet is an IPv6 packet
+ * @param l4_offs Place to store offset of the transport header in the frame
+ * @param proto Place to store the transport protocol number
+ *
+ * @return @c true if the frame carries an unfragmented IPv4 or IPv6 packet
+ *         with at least four bytes of the transport header present
  */
-static void virtio_net_irq_handler(ipc_call_t *icall, void *arg)
+static bool virtio_net_parse_ip(const uint8_t *data, size_t size, bool *ipv6,
+    size_t *l4_offs, uint8_t *proto)
+{
+	if (size < ETH_HDR_SIZE)
+		return false;
+
+	const uint8_t *ip = data + ETH_HDR_SIZE;
+	uint16_t etype = ((uint16_t) data[12] << 8) | data[13];
+
+	switch (etype) {
+	case ETYPE_IPV4:
+		if (size < ETH_HDR_SIZE + IPV4_HDR_SIZE)
+			return false;
+		/* Fragments (apart from the last one) have no ports */
+		if ((((ip[6] << 8) | ip[7]) & 0x3fff) != 0)
+			return false;
+		*ipv6 = false;
+		*l4_offs = ETH_HDR_SIZE + (ip[0] & 0x0f) * 4;
+		*proto = ip[9];
+		break;
+	case ETYPE_IPV6:
+		if (size < ETH_HDR_SIZE + IPV6_HDR_SIZE)
+			return false;
+		*ipv6 = true;
+		*l4_offs = ETH_HDR_SIZE + IPV6_HDR_SIZE;
+		*proto = ip[6];
+		break;
+	default:
+		return false;
+	}
+
+	return *l4_offs + 4 <= size;
+}
+
+/** Select transmit queue pair for a frame.
+ *
+ * Frames of the same flow are always sent through the same queue pair
+ * so that the device does not reorder them.
+ *
+ * @param virtio_net VIRTIO net device
+ * @param data Frame data
+ * @param size Frame size
+ * @return Queue pair
+ */
+static virtio_net_queue_pair_t *virtio_net_tx_select(virtio_net_t *virtio_net,
+    const uint8_t *data, size_t size)
+{
+	bool ipv6;
+	size_t l4_offs;
+	uint8_t proto;
+	uint32_t hash = 0;
+
+	if (virtio_net->tx_queue_pairs == 1 ||
+	    !virtio_net_parse_ip(data, size, &ipv6, &l4_offs, &proto))
+		return &virtio_net->qp[0];
+
+	/* Hash the addresses and, for TCP and UDP, the ports */
+	size_t addr_offs = ETH_HDR_SIZE + (ipv6 ? 8 : 12);
+	size_t end = ETH_HDR_SIZE + (ipv6 ? 40 : 20);
+	if (proto == IP_PROTO_TCP || proto == IP_PROTO_UDP) {
+		for (size_t i = l4_offs; i < l4_offs + 4; i++)
+			hash = hash * 31 + data[i];
+	}
+	for (size_t i = addr_offs; i < end; i++)
+		hash = hash * 31 + data[i];
+
+	return &virtio_net->qp[hash % virtio_net->tx_queue_pairs];
+}
+
+/** Complete a partial checksum of a received frame.
+ *
+ * @param data Frame data
+ * @param size Frame size
+ * @param hdr Packet header
+ *
+ * @return @c true on success, @c false if the checksum is out of the frame
+ */
+static bool virtio_net_rx_csum(uint8_t *data, size_t size,
+    const virtio_net_hdr_t *hdr)
+{
+	size_t start = uint16_t_le2host(hdr->csum_start);
+	size_t offset = uint16_t_le2host(hdr->csum_offset);
+
+	if (start >= size || offset + sizeof(uint16_t) > size - start)
+		return false;
+
+	/* The checksum field already holds the pseudo header sum */
+	uint16_t cs = inet_checksum_calc(INET_CHECKSUM_INIT, data + start,
+	    size - start);
+	data[start + offset] = cs >> 8;
+	data[start + offset + 1] = cs & 0xff;
+	return true;
+}
+
+/** Give an RX buffer back to the device.
+ *
+ * If the descriptor does not hold a buffer from the received frame pool,
+ * try to get one, so that the next frame received into it can be passed
+ * on without copying. Otherwise the driver's own buffer is used.
+ *
+ * @param nic NIC
+ * @param qp Queue pair
+ * @param descno RX descriptor
+ */
+static void virtio_net_rx_post(nic_t *nic, virtio_net_queue_pair_t *qp,
+    uint16_t descno)
 {
-	nic_t *nic = (nic_t *)arg;
 	virtio_net_t *virtio_net = nic_get_specific(nic);
 	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+	nic_rx_buf_t *rxb = &qp->rx_pbuf[descno];
+
+	if (rxb->pbuf.pool == NULL && nic_alloc_rx_buf(nic, rxb) == EOK &&
+	    rxb->size < RX_BUF_SIZE)
+		nic_release_rx_buf(nic, rxb);
+
+	uintptr_t phys = (rxb->pbuf.pool != NULL) ? rxb->phys :
+	    qp->rx_buf_p[descno];
+
+	/*
+	 * Associtate the buffer with the descriptor, set length and flags.
+	 */
+	virtio_virtq_desc_set(vdev, qp->rx_queue, descno, phys + RX_BUF_PAD,
+	    RX_BUF_LEN, VIRTQ_DESC_F_WRITE, 0);
+	/*
+	 * Put the set descriptor into the available ring of the RX queue.
+	 */
+	virtio_virtq_produce_available(vdev, qp->rx_queue, descno);
+}
+
+/** Get the data the device has received into an RX buffer.
+ *
+ * @param qp Queue pair
+ * @param descno RX descriptor
+ * @return Start of the received data
+ */
+static uint8_t *virtio_net_rx_data(virtio_net_queue_pair_t *qp,
+    uint16_t descno)
+{
+	nic_rx_buf_t *rxb = &qp->rx_pbuf[descno];
+	uint8_t *buf = (rxb->pbuf.pool != NULL) ? rxb->virt :
+	    qp->rx_buf[descno];
 
+	return buf + RX_BUF_PAD;
+}
+
+/** Receive frames from the RX queue of a queue pair.
+ *
+ * With mergeable receive buffers, a frame can span several consecutive
+ * used buffers, the first of which carries the packet header. A frame
+ * received into a single buffer from the received frame pool is passed on
+ * without copying.
+ *
+ * @param nic NIC
+ * @param qp Queue pair
+ * @param frames List to append the received frames to or @c NULL to
+ *               deliver them one by one
+ */
+static void virtio_net_rx(nic_t *nic, virtio_net_queue_pair_t *qp,
+    nic_frame_list_t *frames)
+{
+	virtio_net_t *virtio_net = nic_get_specific(nic);
+	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+	bool mergeable = (vdev->features & VIRTIO_NET_F_MRG_RXBUF) != 0;
+	uint16_t descs[RX_BUFFERS];
+	uint32_t lens[RX_BUFFERS];
 	uint16_t descno;
 	uint32_t len;
-	while (virtio_virtq_consume_used(vdev, RX_QUEUE_1, &descno, &len)) {
+
+	while (virtio_virtq_consume_used(vdev, qp->rx_queue, &descno, &len)) {
 		virtio_net_hdr_t *hdr =
-		    (virtio_net_hdr_t *) virtio_net->rx_buf[descno];
-		if (len <= sizeof(*hdr)) {
+		    (virtio_net_hdr_t *) virtio_net_rx_data(qp, descno);
+		unsigned nbufs = 1;
+		bool valid = len > sizeof(*hdr) && len <= RX_BUF_LEN;
+
+		if (mergeable) {
+			nbufs = uint16_t_le2host(hdr->num_buffers);
+			if (nbufs == 0 || nbufs > RX_BUFFERS) {
+				nbufs = 1;
+				valid = false;
+			}
+		}
+
+		descs[0] = descno;
+		lens[0] = len;
+		size_t size = valid ? len - sizeof(*hdr) : 0;
+
+		unsigned count = 1;
+		while (count < nbufs && virtio_virtq_consume_used(vdev,
+		    qp->rx_queue, &descno, &len)) {
+			descs[count] = descno;
+			lens[count] = len;
+			if (len > RX_BUF_LEN)
+				valid = false;
+			size += len;
+			count++;
+		}
+
+		if (!valid || count < nbufs) {
 			ddf_msg(LVL_WARN,
-			    "RX data length too short, packet dropped");
-			virtio_virtq_produce_available(vdev, RX_QUEUE_1,
+			    "Malformed RX data, packet dropped");
+		} else {
+			nic_frame_t *frame = NULL;
+
+			if (count == 1 &&
+			    qp->rx_pbuf[descs[0]].pbuf.pool != NULL) {
+				/* Hand the buffer over instead of copying */
+				frame = nic_rx_buf_to_frame(nic,
+				    &qp->rx_pbuf[descs[0]],
+				    RX_BUF_PAD + sizeof(*hdr), size);
+			}
+
+			if (frame == NULL) {
+				frame = nic_alloc_frame(nic, size);
+				if (frame != NULL) {
+					uint8_t *dst = frame->data;
+					memcpy(dst, &hdr[1],
+					    lens[0] - sizeof(*hdr));
+					dst += lens[0] - sizeof(*hdr);
+					for (unsigned i = 1; i < count; i++) {
+						memcpy(dst, virtio_net_rx_data(
+						    qp, descs[i]), lens[i]);
+						dst += lens[i];
+					}
+				}
+			}
+
+			if (frame == NULL) {
+				ddf_msg(LVL_WARN,
+				    "Cannot allocate RX frame, packet dropped");
+			} else if ((hdr->flags & VIRTIO_NET_HDR_F_NEEDS_CSUM) &&
+			    !virtio_net_rx_csum(frame->data, size, hdr)) {
+				ddf_msg(LVL_WARN, "Bad RX checksum offsets, "
+				    "packet dropped");
+				nic_release_frame(nic, frame);
+			} else if (frames != NULL) {
+				/* Deliver the whole burst at once */
+				nic_frame_list_append(frames, frame);
+			} else {
+				nic_received_frame(nic, frame);
+			}
+		}
+
+		for (unsigned i = 0; i < count; i++)
+			virtio_net_rx_post(nic, qp, descs[i]);
+	}
+}
+
+/** Return descriptor chains of transmitted frames to the free list.
+ *
+ * @param vdev VIRTIO device
+ * @param qp Queue pair
+ */
+static void virtio_net_tx_done(virtio_dev_t *vdev, virtio_net_queue_pair_t *qp)
+{
+	uint16_t descno;
+	uint32_t len;
+
+	while (virtio_virtq_consume_used(vdev, qp->tx_queue, &descno, &len)) {
+		while (descno != (uint16_t) -1U) {
+			uint16_t next = virtio_virtq_desc_get_next(vdev,
+			    qp->tx_queue, descno);
+			virtio_free_desc(vdev, qp->tx_queue, &qp->tx_free_head,
 			    descno);
-			continue;
+			descno = next;
 		}
+	}
+}
 
-		nic_frame_t *frame = nic_alloc_frame(nic, len - sizeof(*hdr));
-		if (frame) {
-			memcpy(frame->data, &hdr[1], len - sizeof(*hdr));
-			nic_received_frame(nic, frame);
-		} else {
-			ddf_msg(LVL_WARN,
-			    "Cannot allocate RX frame, packet dropped");
+/** Collect completed control commands.
+ *
+ * @param virtio_net VIRTIO net device
+ */
+static void virtio_net_ct_done(virtio_net_t *virtio_net)
+{
+	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+	uint16_t descno;
+	uint32_t len;
+
+	fibril_mutex_lock(&virtio_net->ct_lock);
+	while (virtio_virtq_consume_used(vdev, virtio_net->ct_queue, &descno,
+	    &len)) {
+		if (descno == virtio_net->ct_pending) {
+			virtio_net->ct_pending = (uint16_t) -1U;
+			fibril_condvar_broadcast(&virtio_net->ct_cv);
+		}
+
+		while (descno != (uint16_t) -1U) {
+			uint16_t next = virtio_virtq_desc_get_next(vdev,
+			    virtio_net->ct_queue, descno);
+			virtio_free_desc(vdev, virtio_net->ct_queue,
+			    &virtio_net->ct_free_head, descno);
+			descno = next;
 		}
+	}
+	fibril_mutex_unlock(&virtio_net->ct_lock);
+}
 
-		virtio_virtq_produce_available(vdev, RX_QUEUE_1, descno);
+/** Execute a command on the control virtqueue.
+ *
+ * @param virtio_net VIRTIO net device
+ * @param class Command class
+ * @param command Command
+ * @param data Command-specific data
+ * @param size Size of the command-specific data
+ *
+ * @return EOK on success, EIO if the device rejected the command,
+ *         ETIMEOUT if it did not complete it in time or EBUSY if there
+ *         are no free control descriptors
+ */
+static errno_t virtio_net_ctrl_cmd(virtio_net_t *virtio_net, uint8_t class,
+    uint8_t command, const void *data, size_t size)
+{
+	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+	uint16_t ct_queue = virtio_net->ct_queue;
+	errno_t rc = EOK;
+
+	assert(sizeof(virtio_net_ctrl_hdr_t) + size <= CT_BUF_SIZE);
+
+	fibril_mutex_lock(&virtio_net->ct_lock);
+
+	uint16_t cmd_desc = virtio_alloc_desc(vdev, ct_queue,
+	    &virtio_net->ct_free_head);
+	if (cmd_desc == (uint16_t) -1U) {
+		fibril_mutex_unlock(&virtio_net->ct_lock);
+		return EBUSY;
+	}
+	uint16_t ack_desc = virtio_alloc_desc(vdev, ct_queue,
+	    &virtio_net->ct_free_head);
+	if (ack_desc == (uint16_t) -1U) {
+		virtio_free_desc(vdev, ct_queue, &virtio_net->ct_free_head,
+		    cmd_desc);
+		fibril_mutex_unlock(&virtio_net->ct_lock);
+		return EBUSY;
 	}
 
-	while (virtio_virtq_consume_used(vdev, TX_QUEUE_1, &descno, &len)) {
-		virtio_free_desc(vdev, TX_QUEUE_1, &virtio_net->tx_free_head,
-		    descno);
+	virtio_net_ctrl_hdr_t *chdr =
+	    (virtio_net_ctrl_hdr_t *) virtio_net->ct_buf[cmd_desc];
+	chdr->class = class;
+	chdr->command = command;
+	memcpy(&chdr[1], data, size);
+
+	uint8_t *ack = virtio_net->ct_buf[ack_desc];
+	*ack = VIRTIO_NET_ERR;
+
+	virtio_virtq_desc_set(vdev, ct_queue, cmd_desc,
+	    virtio_net->ct_buf_p[cmd_desc], sizeof(*chdr) + size,
+	    VIRTQ_DESC_F_NEXT, ack_desc);
+	virtio_virtq_desc_set(vdev, ct_queue, ack_desc,
+	    virtio_net->ct_buf_p[ack_desc], sizeof(*ack), VIRTQ_DESC_F_WRITE,
+	    0);
+
+	virtio_net->ct_pending = cmd_desc;
+	virtio_virtq_produce_available(vdev, ct_queue, cmd_desc);
+
+	while (virtio_net->ct_pending == cmd_desc) {
+		if (fibril_condvar_wait_timeout(&virtio_net->ct_cv,
+		    &virtio_net->ct_lock, VIRTIO_NET_CT_TIMEOUT) == ETIMEOUT)
+			break;
 	}
-	while (virtio_virtq_consume_used(vdev, CT_QUEUE_1, &descno, &len)) {
-		virtio_free_desc(vdev, CT_QUEUE_1, &virtio_net->ct_free_head,
-		    descno);
+
+	if (virtio_net->ct_pending == cmd_desc) {
+		/* The descriptors are freed once the device completes them */
+		virtio_net->ct_pending = (uint16_t) -1U;
+		rc = ETIMEOUT;
+	} else if (*ack != VIRTIO_NET_OK) {
+		rc = EIO;
 	}
+
+	fibril_mutex_unlock(&virtio_net->ct_lock);
+	return rc;
+}
+
+/** VirtIO net IRQ handler.
+ *
+ * @param icall IRQ event notification
+ * @param arg Argument (nic_t *)
+ */
+static void virtio_net_irq_handler(ipc_call_t *icall, void *arg)
+{
+	nic_t *nic = (nic_t *)arg;
+	virtio_net_t *virtio_net = nic_get_specific(nic);
+	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+
+	nic_frame_list_t *frames = nic_alloc_frame_list();
+	for (unsigned i = 0; i < virtio_net->queue_pairs; i++)
+		virtio_net_rx(nic, &virtio_net->qp[i], frames);
+	nic_received_frame_list(nic, frames);
+
+	for (unsigned i = 0; i < virtio_net->queue_pairs; i++)
+		virtio_net_tx_done(vdev, &virtio_net->qp[i]);
+
+	virtio_net_ct_done(virtio_net);
 }
 
 static errno_t virtio_net_register_interrupt(ddf_dev_t *dev)
@@ -172,6 +560,69 @@ static errno_t virtio_net_register_interrupt(ddf_dev_t *dev)
 	    &virtio_net->irq_handle);
 }
 
+/** Deallocate DMA buffers of all queues.
+ *
+ * @param nic NIC
+ */
+static void virtio_net_teardown_bufs(nic_t *nic)
+{
+	virtio_net_t *virtio_net = nic_get_specific(nic);
+
+	for (unsigned i = 0; i < VIRTIO_NET_MAX_QUEUE_PAIRS; i++) {
+		for (unsigned j = 0; j < RX_BUFFERS; j++)
+			nic_release_rx_buf(nic, &virtio_net->qp[i].rx_pbuf[j]);
+		virtio_teardown_dma_bufs(virtio_net->qp[i].rx_buf);
+		virtio_teardown_dma_bufs(virtio_net->qp[i].tx_buf);
+	}
+	virtio_teardown_dma_bufs(virtio_net->ct_buf);
+}
+
+/** Set up the virtqueues and DMA buffers of a queue pair.
+ *
+ * @param nic NIC
+ * @param i Index of the queue pair
+ * @return EOK on success or an error code
+ */
+static errno_t virtio_net_qp_setup(nic_t *nic, unsigned i)
+{
+	virtio_net_t *virtio_net = nic_get_specific(nic);
+	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+	virtio_net_queue_pair_t *qp = &virtio_net->qp[i];
+
+	qp->rx_queue = RX_QUEUE(i);
+	qp->tx_queue = TX_QUEUE(i);
+
+	errno_t rc = virtio_virtq_setup(vdev, qp->rx_queue, RX_BUFFERS);
+	if (rc != EOK)
+		return rc;
+	rc = virtio_virtq_setup(vdev, qp->tx_queue, TX_BUFFERS);
+	if (rc != EOK)
+		return rc;
+
+	rc = virtio_setup_dma_bufs(RX_BUFFERS, RX_BUF_SIZE, false,
+	    qp->rx_buf, qp->rx_buf_p);
+	if (rc != EOK)
+		return rc;
+	rc = virtio_setup_dma_bufs(TX_BUFFERS, TX_BUF_SIZE, true,
+	    qp->tx_buf, qp->tx_buf_p);
+	if (rc != EOK)
+		return rc;
+
+	/*
+	 * Give all RX buffers to the NIC
+	 */
+	for (unsigned j = 0; j < RX_BUFFERS; j++)
+		virtio_net_rx_post(nic, qp, j);
+
+	/*
+	 * Put all TX buffers on a free list
+	 */
+	virtio_create_desc_free_list(vdev, qp->tx_queue, TX_BUFFERS,
+	    &qp->tx_free_head);
+
+	return EOK;
+}
+
 static errno_t virtio_net_initialize(ddf_dev_t *dev)
 {
 	nic_t *nic = nic_create_and_bind(dev);
@@ -186,6 +637,10 @@ static errno_t virtio_net_initialize(ddf_dev_t *dev)
 
 	nic_set_specific(nic, virtio_net);
 
+	fibril_mutex_initialize(&virtio_net->ct_lock);
+	fibril_condvar_initialize(&virtio_net->ct_cv);
+	virtio_net->ct_pending = (uint16_t) -1U;
+
 	errno_t rc = virtio_pci_dev_initialize(dev, &virtio_net->virtio_dev);
 	if (rc != EOK)
 		return rc;
@@ -203,17 +658,27 @@ static errno_t virtio_net_initialize(ddf_dev_t *dev)
 
 	/* Reset the device and negotiate the feature bits */
 	rc = virtio_device_setup_start(vdev,
-	    VIRTIO_NET_F_MAC | VIRTIO_NET_F_CTRL_VQ);
+	    VIRTIO_NET_F_MAC | VIRTIO_NET_F_CTRL_VQ,
+	    VIRTIO_NET_F_GUEST_CSUM | VIRTIO_NET_F_MRG_RXBUF |
+	    VIRTIO_NET_F_MQ);
 	if (rc != EOK)
 		goto fail;
 
 	/* Perform device-specific setup */
 
+	unsigned max_pairs = 1;
+	if (vdev->features & VIRTIO_NET_F_MQ) {
+		max_pairs = pio_read_le16(&netcfg->max_virtqueue_pairs);
+		if (max_pairs == 0)
+			max_pairs = 1;
+	}
+
 	/*
-	 * Discover and configure the virtqueues
+	 * Discover and configure the virtqueues. The queue pairs come first,
+	 * followed by the control queue.
 	 */
 	uint16_t num_queues = pio_read_le16(&cfg->num_queues);
-	if (num_queues != VIRTIO_NET_NUM_QUEUES) {
+	if (num_queues < 2 * max_pairs + 1) {
 		ddf_msg(LVL_NOTE, "Unsupported number of virtqueues: %u",
 		    num_queues);
 		rc = ELIMIT;
@@ -226,58 +691,27 @@ static errno_t virtio_net_initialize(ddf_dev_t *dev)
 		goto fail;
 	}
 
-	rc = virtio_virtq_setup(vdev, RX_QUEUE_1, RX_BUFFERS);
-	if (rc != EOK)
-		goto fail;
-	rc = virtio_virtq_setup(vdev, TX_QUEUE_1, TX_BUFFERS);
-	if (rc != EOK)
-		goto fail;
-	rc = virtio_virtq_setup(vdev, CT_QUEUE_1, CT_BUFFERS);
-	if (rc != EOK)
-		goto fail;
+	unsigned pairs = min(max_pairs, VIRTIO_NET_MAX_QUEUE_PAIRS);
+	for (unsigned i = 0; i < pairs; i++) {
+		rc = virtio_net_qp_setup(nic, i);
+		if (rc != EOK)
+			goto fail;
+	}
 
-	/*
-	 * Setup DMA buffers
-	 */
-	rc = virtio_setup_dma_bufs(RX_BUFFERS, RX_BUF_SIZE, false,
-	    virtio_net->rx_buf, virtio_net->rx_buf_p);
-	if (rc != EOK)
-		goto fail;
-	rc = virtio_setup_dma_bufs(TX_BUFFERS, TX_BUF_SIZE, true,
-	    virtio_net->tx_buf, virtio_net->tx_buf_p);
+	virtio_net->ct_queue = 2 * max_pairs;
+	rc = virtio_virtq_setup(vdev, virtio_net->ct_queue, CT_BUFFERS);
 	if (rc != EOK)
 		goto fail;
 	rc = virtio_setup_dma_bufs(CT_BUFFERS, CT_BUF_SIZE, true,
 	    virtio_net->ct_buf, virtio_net->ct_buf_p);
 	if (rc != EOK)
 		goto fail;
-
-	/*
-	 * Give all RX buffers to the NIC
-	 */
-	for (unsigned i = 0; i < RX_BUFFERS; i++) {
-		/*
-		 * Associtate the buffer with the descriptor, set length and
-		 * flags.
-		 */
-		virtio_virtq_desc_set(vdev, RX_QUEUE_1, i,
-		    virtio_net->rx_buf_p[i], RX_BUF_SIZE, VIRTQ_DESC_F_WRITE,
-		    0);
-		/*
-		 * Put the set descriptor into the available ring of the RX
-		 * queue.
-		 */
-		virtio_virtq_produce_available(vdev, RX_QUEUE_1, i);
-	}
-
-	/*
-	 * Put all TX and CT buffers on a free list
-	 */
-	virtio_create_desc_free_list(vdev, TX_QUEUE_1, TX_BUFFERS,
-	    &virtio_net->tx_free_head);
-	virtio_create_desc_free_list(vdev, CT_QUEUE_1, CT_BUFFERS,
+	virtio_create_desc_free_list(vdev, virtio_net->ct_queue, CT_BUFFERS,
 	    &virtio_net->ct_free_head);
 
+	virtio_net->queue_pairs = pairs;
+	virtio_net->tx_queue_pairs = 1;
+
 	/*
 	 * Read the MAC address
 	 */
@@ -305,12 +739,30 @@ static errno_t virtio_net_initialize(ddf_dev_t *dev)
 	/* Go live */
 	virtio_device_setup_finalize(vdev);
 
+	/*
+	 * The device only uses the first queue pair until told otherwise,
+	 * which can be done only after it is live.
+	 */
+	if (pairs > 1) {
+		uint16_t vq_pairs = host2uint16_t_le(pairs);
+		rc = virtio_net_ctrl_cmd(virtio_net, VIRTIO_NET_CTRL_MQ,
+		    VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET, &vq_pairs,
+		    sizeof(vq_pairs));
+		if (rc == EOK) {
+			virtio_net->tx_queue_pairs = pairs;
+		} else {
+			ddf_msg(LVL_WARN, "Cannot enable %u queue pairs: %s",
+			    pairs, str_error(rc));
+		}
+	}
+
+	ddf_msg(LVL_NOTE, "Using %u queue pair(s), features %x",
+	    virtio_net->tx_queue_pairs, vdev->features);
+
 	return EOK;
 
 fail:
-	virtio_teardown_dma_bufs(virtio_net->rx_buf);
-	virtio_teardown_dma_bufs(virtio_net->tx_buf);
-	virtio_teardown_dma_bufs(virtio_net->ct_buf);
+	virtio_net_teardown_bufs(nic);
 
 	virtio_device_setup_fail(vdev);
 	virtio_pci_dev_cleanup(vdev);
@@ -322,47 +774,86 @@ static void virtio_net_uninitialize(ddf_dev_t *dev)
 	nic_t *nic = ddf_dev_data_get(dev);
 	virtio_net_t *virtio_net = (virtio_net_t *) nic_get_specific(nic);
 
-	virtio_teardown_dma_bufs(virtio_net->rx_buf);
-	virtio_teardown_dma_bufs(virtio_net->tx_buf);
-	virtio_teardown_dma_bufs(virtio_net->ct_buf);
+	virtio_net_teardown_bufs(nic);
 
 	virtio_device_setup_fail(&virtio_net->virtio_dev);
 	virtio_pci_dev_cleanup(&virtio_net->virtio_dev);
 }
 
+/** Send a frame.
+ *
+ * The frame is copied behind the packet header into a chain of TX buffers.
+ * TCP segments its data in the stack before it reaches inet, which has no
+ * way to pass segmentation metadata down, so frames larger than the MTU are
+ * never handed to the device for segmentation and are dropped here.
+ *
+ * @param nic NIC
+ * @param data Frame data
+ * @param size Frame size
+ */
 static void virtio_net_send(nic_t *nic, void *data, size_t size)
 {
 	virtio_net_t *virtio_net = nic_get_specific(nic);
 	virtio_dev_t *vdev = &virtio_net->virtio_dev;
+	uint16_t descs[TX_CHAIN_MAX];
 
-	if (size > sizeof(virtio_net) + TX_BUF_SIZE) {
+	if (size > VIRTIO_NET_FRAME_MAX) {
 		ddf_msg(LVL_WARN, "TX data too big, frame dropped");
 		return;
 	}
 
-	uint16_t descno = virtio_alloc_desc(vdev, TX_QUEUE_1,
-	    &virtio_net->tx_free_head);
-	if (descno == (uint16_t) -1U) {
-		ddf_msg(LVL_WARN, "No TX buffers available, frame dropped");
-		return;
+	virtio_net_queue_pair_t *qp = virtio_net_tx_select(virtio_net, data,
+	    size);
+
+	unsigned count = (sizeof(virtio_net_hdr_t) + size + TX_BUF_SIZE - 1) /
+	    TX_BUF_SIZE;
+	for (unsigned i = 0; i < count; i++) {
+		descs[i] = virtio_alloc_desc(vdev, qp->tx_queue,
+		    &qp->tx_free_head);
+		if (descs[i] == (uint16_t) -1U) {
+			ddf_msg(LVL_WARN,
+			    "No TX buffers available, frame dropped");
+			while (i-- > 0) {
+				virtio_free_desc(vdev, qp->tx_queue,
+				    &qp->tx_free_head, descs[i]);
+			}
+			return;
+		}
+		assert(descs[i] < TX_BUFFERS);
 	}
-	assert(descno < TX_BUFFERS);
 
 	/* Setup the packet header */
-	virtio_net_hdr_t *hdr = (virtio_net_hdr_t *) virtio_net->tx_buf[descno];
+	virtio_net_hdr_t *hdr = (virtio_net_hdr_t *) qp->tx_buf[descs[0]];
 	memset(hdr, 0, sizeof(virtio_net_hdr_t));
 	hdr->gso_type = VIRTIO_NET_HDR_GSO_NONE;
 	hdr->num_buffers = 0;
 
-	/* Copy packet data into the buffer just past the header */
-	memcpy(&hdr[1], data, size);
+	/* Copy packet data into the chain just past the header */
+	const uint8_t *src = data;
+	size_t left = size;
+	size_t lens[TX_CHAIN_MAX];
+	for (unsigned i = 0; i < count; i++) {
+		uint8_t *buf = qp->tx_buf[descs[i]];
+		size_t offs = (i == 0) ? sizeof(virtio_net_hdr_t) : 0;
+		size_t chunk = min(left, TX_BUF_SIZE - offs);
+
+		memcpy(buf + offs, src, chunk);
+		lens[i] = offs + chunk;
+		src += chunk;
+		left -= chunk;
+	}
 
 	/*
-	 * Set the descriptor, put it into the virtqueue and notify the device
+	 * Set the descriptors, put the chain into the virtqueue and notify
+	 * the device
 	 */
-	virtio_virtq_desc_set(vdev, TX_QUEUE_1, descno,
-	    virtio_net->tx_buf_p[descno], sizeof(virtio_net_hdr_t) + size, 0, 0);
-	virtio_virtq_produce_available(vdev, TX_QUEUE_1, descno);
+	for (unsigned i = 0; i < count; i++) {
+		bool last = (i + 1 == count);
+		virtio_virtq_desc_set(vdev, qp->tx_queue, descs[i],
+		    qp->tx_buf_p[descs[i]], lens[i],
+		    last ? 0 : VIRTQ_DESC_F_NEXT, last ? 0 : descs[i + 1]);
+	}
+	virtio_virtq_produce_available(vdev, qp->tx_queue, descs[0]);
 }
 
 static errno_t virtio_net_on_multicast_mode_change(nic_t *nic,
@@ -31,22 +31,43 @@
 
 #include <virtio-pci.h>
 #include <abi/cap.h>
+#include <fibril_synch.h>
 #include <nic/nic.h>
+#include <nic.h>
 
-#define RX_BUFFERS	8
-#define TX_BUFFERS	8
+#define RX_BUFFERS	64
+#define TX_BUFFERS	64
 #define CT_BUFFERS	4
 
+/** Maximum number of queue pairs the driver will use */
+#define VIRTIO_NET_MAX_QUEUE_PAIRS	4
+
 /** Device handles packets with partial checksum. */
 #define VIRTIO_NET_F_CSUM		(1U << 0)
 /** Driver handles packets with partial checksum. */
 #define VIRTIO_NET_F_GUEST_CSUM		(1U << 2)
 /** Device has given MAC address. */
 #define VIRTIO_NET_F_MAC		(1U << 5)
+/** Device can receive TSOv4. */
+#define VIRTIO_NET_F_HOST_TSO4		(1U << 11)
+/** Device can receive TSOv6. */
+#define VIRTIO_NET_F_HOST_TSO6		(1U << 12)
+/** Driver can merge receive buffers. */
+#define VIRTIO_NET_F_MRG_RXBUF		(1U << 15)
 /** Control channel is available */
 #define VIRTIO_NET_F_CTRL_VQ		(1U << 17)
+/** Device supports multiqueue with automatic receive steering. */
+#define VIRTIO_NET_F_MQ			(1U << 22)
+
+/** Checksum starting at csum_start needs to be computed */
+#define VIRTIO_NET_HDR_F_NEEDS_CSUM	1
+/** Checksum of the received packet has been validated */
+#define VIRTIO_NET_HDR_F_DATA_VALID	2
+
+#define VIRTIO_NET_HDR_GSO_NONE		0
+#define VIRTIO_NET_HDR_GSO_TCPV4	1
+#define VIRTIO_NET_HDR_GSO_TCPV6	4
 
-#define VIRTIO_NET_HDR_GSO_NONE 0
 typedef struct {
 	uint8_t flags;
 	uint8_t gso_type;
@@ -57,22 +78,67 @@ typedef struct {
 	uint16_t num_buffers;
 } virtio_net_hdr_t;
 
+/** Control virtqueue command header */
+typedef struct {
+	uint8_t class;
+	uint8_t command;
+} virtio_net_ctrl_hdr_t;
+
+#define VIRTIO_NET_OK	0
+#define VIRTIO_NET_ERR	1
+
+#define VIRTIO_NET_CTRL_MQ			4
+#define VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET		0
+
 typedef struct {
 	uint8_t mac[ETH_ADDR];
+	ioport16_t status;
+	ioport16_t max_virtqueue_pairs;
 } virtio_net_cfg_t;
 
+/** Receive and transmit virtqueue pair */
 typedef struct {
-	virtio_dev_t virtio_dev;
+	/** Index of the receive virtqueue */
+	uint16_t rx_queue;
+	/** Index of the transmit virtqueue */
+	uint16_t tx_queue;
+
 	void *rx_buf[RX_BUFFERS];
 	uintptr_t rx_buf_p[RX_BUFFERS];
+	/**
+	 * Buffers from the received frame pool used instead of rx_buf
+	 * (where pbuf.pool is not @c NULL)
+	 */
+	nic_rx_buf_t rx_pbuf[RX_BUFFERS];
 	void *tx_buf[TX_BUFFERS];
 	uintptr_t tx_buf_p[TX_BUFFERS];
-	void *ct_buf[CT_BUFFERS];
-	uintptr_t ct_buf_p[CT_BUFFERS];
 
 	uint16_t tx_free_head;
+} virtio_net_queue_pair_t;
+
+typedef struct {
+	virtio_dev_t virtio_dev;
+
+	/** Queue pairs that have been set up */
+	virtio_net_queue_pair_t qp[VIRTIO_NET_MAX_QUEUE_PAIRS];
+	/** Number of queue pairs that have been set up */
+	unsigned queue_pairs;
+	/** Number of queue pairs used for transmission */
+	unsigned tx_queue_pairs;
+
+	/** Index of the control virtqueue */
+	uint16_t ct_queue;
+	void *ct_buf[CT_BUFFERS];
+	uintptr_t ct_buf_p[CT_BUFFERS];
 	uint16_t ct_free_head;
 
+	/** Serializes control commands */
+	fibril_mutex_t ct_lock;
+	/** Signalled when the device completes a control command */
+	fibril_condvar_t ct_cv;
+	/** Head descriptor of the pending control command or 0xFFFF */
+	uint16_t ct_pending;
+
 	int irq;
 	cap_irq_handle_t irq_handle;
 } virtio_net_t;
@@ -85,6 +85,8 @@ typedef struct {
 	aoff64_t pblocks;    /**< Number of physical blocks */
 	size_t pblock_size;  /**< Physical block size. */
 	cache_t *cache;
+	/** Device memory mapped into our address space or @c NULL */
+	void *map;
 } devcon_t;
 
 static errno_t read_blocks(devcon_t *, aoff64_t, size_t, void *, size_t);
@@ -107,7 +109,7 @@ static devcon_t *devcon_search(service_id_t service_id)
 }
 
 static errno_t devcon_add(service_id_t service_id, async_sess_t *sess,
-    size_t bsize, aoff64_t dev_size, bd_t *bd)
+    size_t bsize, aoff64_t dev_size, bd_t *bd, void *map)
 {
 	devcon_t *devcon;
 
@@ -124,6 +126,7 @@ static errno_t devcon_add(service_id_t service_id, async_sess_t *sess,
 	devcon->pblock_size = bsize;
 	devcon->pblocks = dev_size;
 	devcon->cache = NULL;
+	devcon->map = map;
 
 	fibril_mutex_lock(&dcl_lock);
 	list_foreach(dcl, link, devcon_t, d) {
@@ -162,7 +165,8 @@ errno_t block_init(service_id_t service_id)
 	}
 
 	size_t bsize;
-	rc = bd_get_block_size(bd, &bsize);
+	unsigned caps;
+	rc = bd_get_block_size_caps(bd, &bsize, &caps);
 	if (rc != EOK) {
 		bd_close(bd);
 		async_hangup(sess);
@@ -177,8 +181,22 @@ errno_t block_init(service_id_t service_id)
 		return rc;
 	}
 
-	rc = devcon_add(service_id, sess, bsize, dev_size, bd);
+	/*
+	 * If the device is backed by memory (e.g. a RAM disk) that the server
+	 * is willing to share with us, map it and access the data directly,
+	 * without any IPC.
+	 */
+	void *map = NULL;
+	if ((caps & BD_CAP_MAP) != 0 && dev_size <= SIZE_MAX / bsize) {
+		rc = bd_map(bd, PAGES2SIZE(SIZE2PAGES(dev_size * bsize)), &map);
+		if (rc != EOK)
+			map = NULL;
+	}
+
+	rc = devcon_add(service_id, sess, bsize, dev_size, bd, map);
 	if (rc != EOK) {
+		if (map != NULL)
+			as_area_destroy(map);
 		bd_close(bd);
 		async_hangup(sess);
 		return rc;
@@ -202,6 +220,9 @@ void block_fini(service_id_t service_id)
 	if (devcon->bb_buf)
 		free(devcon->bb_buf);
 
+	if (devcon->map != NULL)
+		as_area_destroy(devcon->map);
+
 	bd_close(devcon->bd);
 	async_hangup(devcon->sess);
 
@@ -788,6 +809,168 @@ errno_t block_write_direct(service_id_t service_id, aoff64_t ba, size_t cnt,
 	return write_blocks(devcon, ba, cnt, (void *)data, devcon->pblock_size * cnt);
 }
 
+/** Read multiple extents directly from device (bypass cache).
+ *
+ * Data of the individual extents is stored consecutively in @a buf.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param ext		Array of extents (physical block addresses).
+ * @param next		Number of extents.
+ * @param buf		Buffer for storing the data.
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+errno_t block_read_direct_v(service_id_t service_id, const bd_extent_t *ext,
+    size_t next, void *buf)
+{
+	devcon_t *devcon;
+	size_t size;
+	errno_t rc;
+
+	devcon = devcon_search(service_id);
+	assert(devcon);
+
+	if (devcon->map != NULL) {
+		for (size_t i = 0; i < next; i++) {
+			size = ext[i].cnt * devcon->pblock_size;
+			rc = read_blocks(devcon, ext[i].ba, ext[i].cnt, buf,
+			    size);
+			if (rc != EOK)
+				return rc;
+			buf += size;
+		}
+
+		return EOK;
+	}
+
+	rc = bd_extents_size(ext, next, devcon->pblock_size, &size);
+	if (rc != EOK)
+		return rc;
+
+	return bd_read_blocks_v(devcon->bd, ext, next, buf, size);
+}
+
+/** Write multiple extents directly to device (bypass cache).
+ *
+ * Data of the individual extents is taken consecutively from @a data.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param ext		Array of extents (physical block addresses).
+ * @param next		Number of extents.
+ * @param data		The data to be written.
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+errno_t block_write_direct_v(service_id_t service_id, const bd_extent_t *ext,
+    size_t next, const void *data)
+{
+	devcon_t *devcon;
+	size_t size;
+	errno_t rc;
+
+	devcon = devcon_search(service_id);
+	assert(devcon);
+
+	if (devcon->map != NULL) {
+		for (size_t i = 0; i < next; i++) {
+			size = ext[i].cnt * devcon->pblock_size;
+			rc = write_blocks(devcon, ext[i].ba, ext[i].cnt,
+			    (void *) data, size);
+			if (rc != EOK)
+				return rc;
+			data += size;
+		}
+
+		return EOK;
+	}
+
+	rc = bd_extents_size(ext, next, devcon->pblock_size, &size);
+	if (rc != EOK)
+		return rc;
+
+	return bd_write_blocks_v(devcon->bd, ext, next, data, size);
+}
+
+/** Forward client's data read directly to device (bypass cache).
+ *
+ * @param service_id	Service ID of the block device.
+ * @param ba		Address of first block (physical).
+ * @param cnt		Number of blocks.
+ * @param rcall		Received data read call to forward (consumed).
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+errno_t block_read_forward(service_id_t service_id, aoff64_t ba, size_t cnt,
+    ipc_call_t *rcall)
+{
+	devcon_t *devcon;
+
+	devcon = devcon_search(service_id);
+	assert(devcon);
+
+	return bd_read_blocks_forward(devcon->bd, ba, cnt, rcall);
+}
+
+/** Forward client's data write directly to device (bypass cache).
+ *
+ * @param service_id	Service ID of the block device.
+ * @param ba		Address of first block (physical).
+ * @param cnt		Number of blocks.
+ * @param wcall		Received data write call to forward (consumed).
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+errno_t block_write_forward(service_id_t service_id, aoff64_t ba, size_t cnt,
+    ipc_call_t *wcall)
+{
+	devcon_t *devcon;
+
+	devcon = devcon_search(service_id);
+	assert(devcon);
+
+	return bd_write_blocks_forward(devcon->bd, ba, cnt, wcall);
+}
+
+/** Forward client's data read directly to device as vectored read.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param ext		Array of extents (physical block addresses).
+ * @param next		Number of extents.
+ * @param rcall		Received data read call to forward (consumed).
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+errno_t block_read_forward_v(service_id_t service_id, const bd_extent_t *ext,
+    size_t next, ipc_call_t *rcall)
+{
+	devcon_t *devcon;
+
+	devcon = devcon_search(service_id);
+	assert(devcon);
+
+	return bd_read_blocks_v_forward(devcon->bd, ext, next, rcall);
+}
+
+/** Forward client's data write directly to device as vectored write.
+ *
+ * @param service_id	Service ID of the block device.
+ * @param ext		Array of extents (physical block addresses).
+ * @param next		Number of extents.
+ * @param wcall		Received data write call to forward (consumed).
+ *
+ * @return		EOK on success or an error code on failure.
+ */
+errno_t block_write_forward_v(service_id_t service_id, const bd_extent_t *ext,
+    size_t next, ipc_call_t *wcall)
+{
+	devcon_t *devcon;
+
+	devcon = devcon_search(service_id);
+	assert(devcon);
+
+	return bd_write_blocks_v_forward(devcon->bd, ext, next, wcall);
+}
+
 /** Synchronize blocks to persistent storage.
  *
  * @param service_id	Service ID of the block device.
@@ -922,6 +1105,16 @@ static errno_t read_blocks(devcon_t *devcon, aoff64_t ba, size_t cnt, void *buf,
 {
 	assert(devcon);
 
+	if (devcon->map != NULL) {
+		/* Copy directly from mapped device memory */
+		if (ba > devcon->pblocks || cnt > devcon->pblocks - ba)
+			return ELIMIT;
+
+		memcpy(buf, devcon->map + ba * devcon->pblock_size,
+		    min(cnt * devcon->pblock_size, size));
+		return EOK;
+	}
+
 	errno_t rc = bd_read_blocks(devcon->bd, ba, cnt, buf, size);
 	if (rc != EOK) {
 		printf("Error %s reading %zu blocks starting at block %" PRIuOFF64
@@ -949,6 +1142,16 @@ static errno_t write_blocks(devcon_t *devcon, aoff64_t ba, size_t cnt, void *dat
 {
 	assert(devcon);
 
+	if (devcon->map != NULL) {
+		/* Copy directly to mapped device memory */
+		if (ba > devcon->pblocks || cnt > devcon->pblocks - ba)
+			return ELIMIT;
+
+		memcpy(devcon->map + ba * devcon->pblock_size, data,
+		    min(cnt * devcon->pblock_size, size));
+		return EOK;
+	}
+
 	errno_t rc = bd_write_blocks(devcon->bd, ba, cnt, data, size);
 	if (rc != EOK) {
 		printf("Error %s writing %zu blocks starting at block %" PRIuOFF64
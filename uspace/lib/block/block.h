@@ -45,6 +45,7 @@
 #include <adt/hash_table.h>
 #include <adt/list.h>
 #include <loc.h>
+#include <types/bd.h>
 
 /*
  * Flags that can be used with block_get().
@@ -120,6 +121,16 @@ extern errno_t block_read_toc(service_id_t, uint8_t, void *, size_t);
 extern errno_t block_read_direct(service_id_t, aoff64_t, size_t, void *);
 extern errno_t block_read_bytes_direct(service_id_t, aoff64_t, size_t, void *);
 extern errno_t block_write_direct(service_id_t, aoff64_t, size_t, const void *);
+extern errno_t block_read_forward(service_id_t, aoff64_t, size_t, ipc_call_t *);
+extern errno_t block_write_forward(service_id_t, aoff64_t, size_t, ipc_call_t *);
+extern errno_t block_read_direct_v(service_id_t, const bd_extent_t *, size_t,
+    void *);
+extern errno_t block_write_direct_v(service_id_t, const bd_extent_t *, size_t,
+    const void *);
+extern errno_t block_read_forward_v(service_id_t, const bd_extent_t *, size_t,
+    ipc_call_t *);
+extern errno_t block_write_forward_v(service_id_t, const bd_extent_t *, size_t,
+    ipc_call_t *);
 extern errno_t block_sync_cache(service_id_t, aoff64_t, size_t);
 
 #endif
@@ -0,0 +1,419 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <async.h>
+#include <bd.h>
+#include <bd_srv.h>
+#include <block.h>
+#include <errno.h>
+#include <loc.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdlib.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(block);
+
+/** Block size of the test disk */
+#define TEST_BSIZE 512
+/** Number of blocks of the test disk */
+#define TEST_NBLOCKS 16
+
+static const char *test_block_server = "test-block";
+static const char *test_block_svc = "test/block";
+
+/** Memory-backed test disk */
+typedef struct {
+	uint8_t data[TEST_NBLOCKS * TEST_BSIZE];
+	/** Number of vectored read requests */
+	unsigned nreads_v;
+	/** Number of vectored write requests */
+	unsigned nwrites_v;
+} test_disk_t;
+
+/** Test environment */
+typedef struct {
+	test_disk_t disk;
+	bd_srvs_t srvs;
+	loc_srv_t *srv;
+	service_id_t sid;
+} test_env_t;
+
+static void test_bd_conn(ipc_call_t *, void *);
+static errno_t test_bd_open(bd_srvs_t *, bd_srv_t *);
+static errno_t test_bd_close(bd_srv_t *);
+static errno_t test_bd_read_blocks(bd_srv_t *, aoff64_t, size_t, void *,
+    size_t);
+static errno_t test_bd_write_blocks(bd_srv_t *, aoff64_t, size_t,
+    const void *, size_t);
+static errno_t test_bd_read_blocks_v(bd_srv_t *, const bd_extent_t *, size_t,
+    void *, size_t);
+static errno_t test_bd_write_blocks_v(bd_srv_t *, const bd_extent_t *,
+    size_t, const void *, size_t);
+static errno_t test_bd_get_block_size(bd_srv_t *, size_t *);
+static errno_t test_bd_get_num_blocks(bd_srv_t *, aoff64_t *);
+
+/** Operations of a device that implements vectored requests */
+static bd_ops_t test_bd_ops = {
+	.open = test_bd_open,
+	.close = test_bd_close,
+	.read_blocks = test_bd_read_blocks,
+	.write_blocks = test_bd_write_blocks,
+	.read_blocks_v = test_bd_read_blocks_v,
+	.write_blocks_v = test_bd_write_blocks_v,
+	.get_block_size = test_bd_get_block_size,
+	.get_num_blocks = test_bd_get_num_blocks
+};
+
+/** Operations of a device where vectored requests are emulated */
+static bd_ops_t test_bd_emul_ops = {
+	.open = test_bd_open,
+	.close = test_bd_close,
+	.read_blocks = test_bd_read_blocks,
+	.write_blocks = test_bd_write_blocks,
+	.get_block_size = test_bd_get_block_size,
+	.get_num_blocks = test_bd_get_num_blocks
+};
+
+/** Extents used by the tests (out of order, of different sizes) */
+static const bd_extent_t test_ext[] = {
+	{ .ba = 9, .cnt = 2 },
+	{ .ba = 1, .cnt = 1 },
+	{ .ba = 4, .cnt = 3 }
+};
+
+#define TEST_NEXT (sizeof(test_ext) / sizeof(test_ext[0]))
+/** Number of blocks covered by the test extents */
+#define TEST_EXT_BLOCKS 6
+
+/** Set up test disk and connect to it.
+ *
+ * @param env Test environment
+ * @param ops Block device operations to use
+ */
+static void test_env_init(test_env_t *env, bd_ops_t *ops)
+{
+	errno_t rc;
+
+	memset(env, 0, sizeof(test_env_t));
+	for (size_t i = 0; i < sizeof(env->disk.data); i++)
+		env->disk.data[i] = i % 251;
+
+	bd_srvs_init(&env->srvs);
+	env->srvs.ops = ops;
+	env->srvs.sarg = &env->disk;
+
+	async_set_fallback_port_handler(test_bd_conn, &env->srvs);
+
+	// FIXME This causes this test to be non-reentrant!
+	rc = loc_server_register(test_block_server, &env->srv);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = loc_service_register(env->srv, test_block_svc, fallback_port_id,
+	    &env->sid);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = block_init(env->sid);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+}
+
+/** Tear down test environment. */
+static void test_env_fini(test_env_t *env)
+{
+	errno_t rc;
+
+	block_fini(env->sid);
+
+	rc = loc_service_unregister(env->srv, env->sid);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	loc_server_unregister(env->srv);
+}
+
+/** Check that @a buf holds the data of the test extents.
+ *
+ * @param env Test environment
+ * @param buf Buffer with data of the test extents stored consecutively
+ */
+static void test_check_extents(test_env_t *env, const uint8_t *buf)
+{
+	for (size_t i = 0; i < TEST_NEXT; i++) {
+		PCUT_ASSERT_INT_EQUALS(0, memcmp(buf,
+		    env->disk.data + test_ext[i].ba * TEST_BSIZE,
+		    test_ext[i].cnt * TEST_BSIZE));
+		buf += test_ext[i].cnt * TEST_BSIZE;
+	}
+}
+
+/** Vectored read is passed to the device in a single request */
+PCUT_TEST(read_direct_v)
+{
+	test_env_t *env;
+	uint8_t *buf;
+	errno_t rc;
+
+	env = malloc(sizeof(test_env_t));
+	PCUT_ASSERT_NOT_NULL(env);
+	test_env_init(env, &test_bd_ops);
+
+	buf = calloc(TEST_EXT_BLOCKS, TEST_BSIZE);
+	PCUT_ASSERT_NOT_NULL(buf);
+
+	rc = block_read_direct_v(env->sid, test_ext, TEST_NEXT, buf);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_INT_EQUALS(1, env->disk.nreads_v);
+	test_check_extents(env, buf);
+
+	free(buf);
+	test_env_fini(env);
+	free(env);
+}
+
+/** Vectored write is passed to the device in a single request */
+PCUT_TEST(write_direct_v)
+{
+	test_env_t *env;
+	uint8_t *buf;
+	errno_t rc;
+
+	env = malloc(sizeof(test_env_t));
+	PCUT_ASSERT_NOT_NULL(env);
+	test_env_init(env, &test_bd_ops);
+
+	buf = malloc(TEST_EXT_BLOCKS * TEST_BSIZE);
+	PCUT_ASSERT_NOT_NULL(buf);
+	for (size_t i = 0; i < TEST_EXT_BLOCKS * TEST_BSIZE; i++)
+		buf[i] = 0xff - i % 253;
+
+	rc = block_write_direct_v(env->sid, test_ext, TEST_NEXT, buf);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_INT_EQUALS(1, env->disk.nwrites_v);
+	test_check_extents(env, buf);
+
+	/* Blocks outside of the extents are not touched */
+	PCUT_ASSERT_INT_EQUALS(0, env->disk.data[0]);
+	PCUT_ASSERT_INT_EQUALS((2 * TEST_BSIZE) % 251,
+	    env->disk.data[2 * TEST_BSIZE]);
+
+	free(buf);
+	test_env_fini(env);
+	free(env);
+}
+
+/** Vectored requests work with a device that does not implement them */
+PCUT_TEST(direct_v_emul)
+{
+	test_env_t *env;
+	uint8_t *buf;
+	errno_t rc;
+
+	env = malloc(sizeof(test_env_t));
+	PCUT_ASSERT_NOT_NULL(env);
+	test_env_init(env, &test_bd_emul_ops);
+
+	buf = calloc(TEST_EXT_BLOCKS, TEST_BSIZE);
+	PCUT_ASSERT_NOT_NULL(buf);
+
+	rc = block_read_direct_v(env->sid, test_ext, TEST_NEXT, buf);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	test_check_extents(env, buf);
+
+	for (size_t i = 0; i < TEST_EXT_BLOCKS * TEST_BSIZE; i++)
+		buf[i] = 0x5a;
+
+	rc = block_write_direct_v(env->sid, test_ext, TEST_NEXT, buf);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	test_check_extents(env, buf);
+
+	PCUT_ASSERT_INT_EQUALS(0, env->disk.nreads_v);
+	PCUT_ASSERT_INT_EQUALS(0, env->disk.nwrites_v);
+
+	free(buf);
+	test_env_fini(env);
+	free(env);
+}
+
+/** Vectored request with an invalid extent is rejected */
+PCUT_TEST(direct_v_out_of_range)
+{
+	test_env_t *env;
+	uint8_t *buf;
+	bd_extent_t ext[2];
+	errno_t rc;
+
+	env = malloc(sizeof(test_env_t));
+	PCUT_ASSERT_NOT_NULL(env);
+	test_env_init(env, &test_bd_ops);
+
+	buf = calloc(4, TEST_BSIZE);
+	PCUT_ASSERT_NOT_NULL(buf);
+
+	ext[0].ba = 0;
+	ext[0].cnt = 2;
+	ext[1].ba = TEST_NBLOCKS - 1;
+	ext[1].cnt = 2;
+
+	rc = block_read_direct_v(env->sid, ext, 2, buf);
+	PCUT_ASSERT_ERRNO_VAL(ELIMIT, rc);
+
+	rc = block_write_direct_v(env->sid, ext, 2, buf);
+	PCUT_ASSERT_ERRNO_VAL(ELIMIT, rc);
+
+	free(buf);
+	test_env_fini(env);
+	free(env);
+}
+
+static void test_bd_conn(ipc_call_t *icall, void *arg)
+{
+	bd_srvs_t *srvs = (bd_srvs_t *) arg;
+
+	bd_conn(icall, srvs);
+}
+
+static errno_t test_bd_open(bd_srvs_t *srvs, bd_srv_t *bd)
+{
+	return EOK;
+}
+
+static errno_t test_bd_close(bd_srv_t *bd)
+{
+	return EOK;
+}
+
+/** Check that blocks are within the test disk. */
+static errno_t test_bd_check_range(aoff64_t ba, size_t cnt)
+{
+	if (ba > TEST_NBLOCKS || cnt > TEST_NBLOCKS - ba)
+		return ELIMIT;
+
+	return EOK;
+}
+
+static errno_t test_bd_read_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
+    void *buf, size_t size)
+{
+	test_disk_t *disk = (test_disk_t *) bd->srvs->sarg;
+	errno_t rc;
+
+	rc = test_bd_check_range(ba, cnt);
+	if (rc != EOK)
+		return rc;
+
+	if (size != cnt * TEST_BSIZE)
+		return EINVAL;
+
+	memcpy(buf, disk->data + ba * TEST_BSIZE, size);
+	return EOK;
+}
+
+static errno_t test_bd_write_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
+    const void *buf, size_t size)
+{
+	test_disk_t *disk = (test_disk_t *) bd->srvs->sarg;
+	errno_t rc;
+
+	rc = test_bd_check_range(ba, cnt);
+	if (rc != EOK)
+		return rc;
+
+	if (size != cnt * TEST_BSIZE)
+		return EINVAL;
+
+	memcpy(disk->data + ba * TEST_BSIZE, buf, size);
+	return EOK;
+}
+
+static errno_t test_bd_read_blocks_v(bd_srv_t *bd, const bd_extent_t *ext,
+    size_t next, void *buf, size_t size)
+{
+	test_disk_t *disk = (test_disk_t *) bd->srvs->sarg;
+	size_t tsize;
+	errno_t rc;
+
+	++disk->nreads_v;
+
+	if (bd_extents_size(ext, next, TEST_BSIZE, &tsize) != EOK ||
+	    tsize != size)
+		return EINVAL;
+
+	for (size_t i = 0; i < next; i++) {
+		rc = test_bd_read_blocks(bd, ext[i].ba, ext[i].cnt, buf,
+		    ext[i].cnt * TEST_BSIZE);
+		if (rc != EOK)
+			return rc;
+
+		buf += ext[i].cnt * TEST_BSIZE;
+	}
+
+	return EOK;
+}
+
+static errno_t test_bd_write_blocks_v(bd_srv_t *bd, const bd_extent_t *ext,
+    size_t next, const void *buf, size_t size)
+{
+	test_disk_t *disk = (test_disk_t *) bd->srvs->sarg;
+	size_t tsize;
+	errno_t rc;
+
+	++disk->nwrites_v;
+
+	if (bd_extents_size(ext, next, TEST_BSIZE, &tsize) != EOK ||
+	    tsize != size)
+		return EINVAL;
+
+	for (size_t i = 0; i < next; i++) {
+		rc = test_bd_check_range(ext[i].ba, ext[i].cnt);
+		if (rc != EOK)
+			return rc;
+	}
+
+	for (size_t i = 0; i < next; i++) {
+		(void) test_bd_write_blocks(bd, ext[i].ba, ext[i].cnt, buf,
+		    ext[i].cnt * TEST_BSIZE);
+		buf += ext[i].cnt * TEST_BSIZE;
+	}
+
+	return EOK;
+}
+
+static errno_t test_bd_get_block_size(bd_srv_t *bd, size_t *rsize)
+{
+	*rsize = TEST_BSIZE;
+	return EOK;
+}
+
+static errno_t test_bd_get_num_blocks(bd_srv_t *bd, aoff64_t *rnb)
+{
+	*rnb = TEST_NBLOCKS;
+	return EOK;
+}
+
+PCUT_EXPORT(block);
@@ -68,5 +68,18 @@ link_t *prodcons_consume(prodcons_t *pc)
 	return head;
 }
 
+link_t *prodcons_try_consume(prodcons_t *pc)
+{
+	fibril_mutex_lock(&pc->mtx);
+
+	link_t *head = list_first(&pc->list);
+	if (head != NULL)
+		list_remove(head);
+
+	fibril_mutex_unlock(&pc->mtx);
+
+	return head;
+}
+
 /** @}
  */
@@ -39,11 +39,26 @@
 #include <errno.h>
 #include <assert.h>
 #include <string.h>
+#include <str.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Size of the buffer for batched directory reads */
+#define DIR_BUF_SIZE 4096
 
 struct __dirstream {
 	int fd;
 	struct dirent res;
+	/** Position of the next entry to fetch from the file system */
 	aoff64_t pos;
+	/** File system supports batched directory reads */
+	bool batched;
+	/** Buffer of entries fetched by vfs_readdir() */
+	uint8_t *buf;
+	/** Number of valid bytes in @c buf */
+	size_t buf_used;
+	/** Offset of the next unread entry in @c buf */
+	size_t buf_off;
 };
 
 /** Open directory.
@@ -78,9 +93,56 @@ DIR *opendir(const char *dirname)
 
 	dirp->fd = fd;
 	dirp->pos = 0;
+	dirp->batched = true;
+	dirp->buf = NULL;
+	dirp->buf_used = 0;
+	dirp->buf_off = 0;
 	return dirp;
 }
 
+/** Get next directory entry using batched directory reads.
+ *
+ * Refill the entry buffer from the file system when it is exhausted.
+ *
+ * @param dirp Open directory
+ * @return EOK on success, ENOENT at the end of the directory, ENOTSUP
+ *         if the file system does not support batched reads or another
+ *         error code
+ */
+static errno_t readdir_batched(DIR *dirp)
+{
+	vfs_dirent_t *de;
+	errno_t rc;
+
+	if (dirp->buf_off >= dirp->buf_used) {
+		if (dirp->buf == NULL) {
+			dirp->buf = malloc(DIR_BUF_SIZE);
+			if (dirp->buf == NULL)
+				return ENOTSUP;
+		}
+
+		dirp->buf_off = 0;
+		dirp->buf_used = 0;
+
+		rc = vfs_readdir(dirp->fd, &dirp->pos, dirp->buf,
+		    DIR_BUF_SIZE, &dirp->buf_used);
+		if (rc != EOK)
+			return rc;
+
+		if (dirp->buf_used == 0)
+			return ENOENT;
+	}
+
+	de = (vfs_dirent_t *) (dirp->buf + dirp->buf_off);
+	if (de->reclen < sizeof(vfs_dirent_t) ||
+	    de->reclen > dirp->buf_used - dirp->buf_off)
+		return EIO;
+
+	str_cpy(dirp->res.d_name, sizeof(dirp->res.d_name), de->name);
+	dirp->buf_off += de->reclen;
+	return EOK;
+}
+
 /** Read directory entry.
  *
  * @param dirp Open directory
@@ -92,6 +154,20 @@ struct dirent *readdir(DIR *dirp)
 	errno_t rc;
 	ssize_t len = 0;
 
+	if (dirp->batched) {
+		rc = readdir_batched(dirp);
+		if (rc == EOK)
+			return &dirp->res;
+		if (rc != ENOTSUP) {
+			if (rc != ENOENT)
+				errno = rc;
+			return NULL;
+		}
+
+		/* Fall back to reading one entry at a time. */
+		dirp->batched = false;
+	}
+
 	rc = vfs_read_short(dirp->fd, dirp->pos, dirp->res.d_name,
 	    sizeof(dirp->res.d_name), &len);
 	if (rc != EOK) {
@@ -113,6 +189,8 @@ struct dirent *readdir(DIR *dirp)
 void rewinddir(DIR *dirp)
 {
 	dirp->pos = 0;
+	dirp->buf_used = 0;
+	dirp->buf_off = 0;
 }
 
 /** Close directory.
@@ -123,6 +201,7 @@ void rewinddir(DIR *dirp)
 int closedir(DIR *dirp)
 {
 	errno_t rc = vfs_put(dirp->fd);
+	free(dirp->buf);
 	free(dirp);
 
 	if (rc == EOK) {
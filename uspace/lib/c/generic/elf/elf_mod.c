@@ -37,15 +37,19 @@
  * @brief	Userspace ELF module loader.
  *
  * This module allows loading ELF binaries (both executables and
- * shared objects) from VFS. The current implementation allocates
- * anonymous memory, fills it with segment data and then adjusts
- * the memory areas' flags to the final value. In the future,
- * the segments will be mapped directly from the file.
+ * shared objects) from VFS. Read-only segments are mapped directly
+ * from the file using the VFS pager, so that their frames are shared
+ * by all tasks running the same binary. For other segments, anonymous
+ * memory is allocated, filled with segment data and then the memory
+ * areas' flags are adjusted to the final value.
  */
 
 #include <errno.h>
 #include <stdio.h>
 #include <vfs/vfs.h>
+#include <ipc/services.h>
+#include <ipc/vfs.h>
+#include <ns.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <align.h>
@@ -96,11 +100,16 @@ errno_t elf_load_file(int file, eld_flags_t flags, elf_finfo_t *info)
 	}
 
 	elf.fd = ofile;
+	elf.map_fd = -1;
 	elf.info = info;
 	elf.flags = flags;
 
 	rc = elf_load_module(&elf);
 
+	/* Segments mapped from the file keep using map_fd */
+	if (rc != EOK && elf.map_fd >= 0)
+		vfs_put(elf.map_fd);
+
 	vfs_put(ofile);
 	return rc;
 }
@@ -371,6 +380,69 @@ static errno_t segment_header(elf_ld_t *elf, elf_segment_header_t *entry)
 	return EOK;
 }
 
+/** Map read-only segment directly from the file.
+ *
+ * The segment is backed by the VFS pager with VFS_PAGER_SHARED, so that
+ * it shares frames with the VFS page cache. This is only possible if
+ * the segment is never written to (not even by the caller, see ELDF_RW),
+ * it has no zero-filled part and its file offset is congruent with its
+ * address modulo page size.
+ *
+ * @param elf   Loader state.
+ * @param entry Program header entry describing segment to be loaded.
+ * @param base  Page-aligned address where the segment area starts
+ * @param flags Final flags of the memory area
+ *
+ * @return EOK on success, ENOTSUP if the segment cannot be mapped or
+ *         another error code.
+ */
+static errno_t map_segment(elf_ld_t *elf, elf_segment_header_t *entry,
+    uintptr_t base, int flags)
+{
+	static async_sess_t *pager_sess = NULL;
+	uintptr_t pad;
+	void *a;
+	errno_t rc;
+
+	if ((flags & AS_AREA_WRITE) != 0 || (elf->flags & ELDF_RW) != 0 ||
+	    entry->p_filesz != entry->p_memsz)
+		return ENOTSUP;
+
+	pad = (entry->p_vaddr + elf->bias) - base;
+	if (entry->p_offset % PAGE_SIZE != pad || entry->p_offset < pad)
+		return ENOTSUP;
+
+	if (pager_sess == NULL) {
+		pager_sess = service_connect(SERVICE_VFS, INTERFACE_PAGER, 0,
+		    &rc);
+		if (pager_sess == NULL)
+			return ENOTSUP;
+	}
+
+	/* The pager needs a handle opened for reading as long as mapped */
+	if (elf->map_fd < 0) {
+		rc = vfs_clone(elf->fd, -1, true, &elf->map_fd);
+		if (rc != EOK)
+			return ENOTSUP;
+
+		rc = vfs_open(elf->map_fd, MODE_READ);
+		if (rc != EOK) {
+			vfs_put(elf->map_fd);
+			elf->map_fd = -1;
+			return ENOTSUP;
+		}
+	}
+
+	a = async_as_area_create((void *) base, entry->p_memsz + pad, flags,
+	    pager_sess, elf->map_fd, VFS_PAGER_SHARED, entry->p_offset - pad);
+	if (a == AS_MAP_FAILED)
+		return ENOTSUP;
+
+	DPRINTF("Mapped segment at %p from file offset 0x%zx\n",
+	    (void *) base, (size_t) (entry->p_offset - pad));
+	return EOK;
+}
+
 /** Load segment described by program header entry.
  *
  * @param elf	Loader state.
@@ -432,6 +504,17 @@ errno_t load_segment(elf_ld_t *elf, elf_segment_header_t *entry)
 	    (void *) (entry->p_vaddr + bias +
 	    ALIGN_UP(entry->p_memsz, PAGE_SIZE)));
 
+	rc = map_segment(elf, entry, base + bias, flags);
+	if (rc == EOK) {
+		if (flags & AS_AREA_EXEC) {
+			/* Enforce SMC coherence for the segment */
+			if (smc_coherence(seg_ptr, entry->p_filesz))
+				return ENOMEM;
+		}
+
+		return EOK;
+	}
+
 	/*
 	 * For the course of loading, the area needs to be readable
 	 * and writeable.
@@ -0,0 +1,587 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/**
+ * @file
+ * @brief Shared packet buffer pool.
+ *
+ * A packet buffer pool is an address space area divided into fixed-size
+ * buffers, which can be shared with other tasks. Instead of copying
+ * packet data with each IPC call, tasks pass references to buffers
+ * (pool ID, buffer ID). The receiving task maps the pool the first time
+ * it encounters it (pbuf_pool_import() on the client side,
+ * pbuf_pool_export() on the server side). A task that has imported
+ * a pool can export it further.
+ *
+ * Each buffer has a reference count stored in the shared area. Only
+ * the task that created the pool allocates buffers. Any task that maps
+ * the pool writable can add and drop references. A buffer becomes free
+ * when its reference count drops to zero. Tasks that only receive
+ * packets are given the pool read-only.
+ *
+ * A buffer passed with an IPC call is lent to the recipient for the
+ * duration of the call. To keep using it after answering, the recipient
+ * needs to add a reference with pbuf_ref(), which requires the pool to be
+ * mapped writable.
+ *
+ * Pool ID consists of the task ID of the creator (upper 32 bits) and
+ * a per-task sequence number (lower 32 bits), which is never reused.
+ *
+ * A pool created with pbuf_pool_create_dma() is physically contiguous,
+ * so that a device driver can let the device write received packets
+ * directly into the buffers.
+ */
+
+#include <adt/list.h>
+#include <align.h>
+#include <as.h>
+#include <assert.h>
+#include <async.h>
+#include <ddi.h>
+#include <errno.h>
+#include <fibril_synch.h>
+#include <macros.h>
+#include <pbuf.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <task.h>
+
+/** Magic number identifying a packet buffer pool area ('PBuf') */
+#define PBUF_MAGIC 0x50427566
+/** Buffer alignment within the pool */
+#define PBUF_ALIGN 64
+
+/** Pool header, stored at the beginning of the shared area */
+typedef struct {
+	/** PBUF_MAGIC */
+	uint32_t magic;
+	/** Number of buffers */
+	uint32_t count;
+	/** Size of one buffer (multiple of PBUF_ALIGN) */
+	uint32_t buf_size;
+	/** Offset of first buffer from the beginning of the area */
+	uint32_t data_offs;
+	/** Pool ID */
+	pbuf_pool_id_t id;
+	/** Buffer reference counts */
+	atomic_uint refcnt[];
+} pbuf_pool_hdr_t;
+
+/** Packet buffer pool (as mapped in this task) */
+struct pbuf_pool {
+	/** Link to pbuf_pools */
+	link_t lpools;
+	/** Pool ID */
+	pbuf_pool_id_t id;
+	/** Shared area (starts with the header) */
+	pbuf_pool_hdr_t *hdr;
+	/** Size of shared area */
+	size_t area_size;
+	/** Number of buffers */
+	size_t count;
+	/** Size of one buffer */
+	size_t buf_size;
+	/** First buffer */
+	uint8_t *data;
+	/** @c true if this task created the pool */
+	bool owner;
+	/** @c true if the pool is mapped writable */
+	bool writable;
+	/** @c true if the pool was created by pbuf_pool_create_dma() */
+	bool dma;
+	/** Physical address of the shared area (DMA pool only) */
+	uintptr_t phys;
+	/** Synchronizes buffer allocation */
+	fibril_mutex_t lock;
+	/** Where to start looking for a free buffer */
+	size_t next;
+};
+
+/** Pools mapped in this task */
+static LIST_INITIALIZE(pbuf_pools);
+static FIBRIL_MUTEX_INITIALIZE(pbuf_pools_lock);
+/** Sequence number for generating pool IDs */
+static uint32_t pbuf_pool_seq;
+
+/** Find pool by ID (with pbuf_pools_lock held). */
+static pbuf_pool_t *pbuf_pool_find_locked(pbuf_pool_id_t id)
+{
+	assert(fibril_mutex_is_locked(&pbuf_pools_lock));
+
+	list_foreach(pbuf_pools, lpools, pbuf_pool_t, pool) {
+		if (pool->id == id)
+			return pool;
+	}
+
+	return NULL;
+}
+
+/** Create packet buffer pool.
+ *
+ * @param count Number of buffers
+ * @param size Size of one buffer in bytes
+ * @param dma Allocate physically contiguous memory
+ * @param rpool Place to store pointer to new pool
+ * @return EOK on success, EINVAL if parameters are out of range,
+ *         ENOMEM if out of memory
+ */
+static errno_t pbuf_pool_create_common(size_t count, size_t size, bool dma,
+    pbuf_pool_t **rpool)
+{
+	pbuf_pool_t *pool;
+	size_t buf_size;
+	size_t data_offs;
+	void *area;
+	errno_t rc;
+	size_t i;
+
+	if (count == 0 || count > PBUF_COUNT_MAX || size == 0 ||
+	    size > PBUF_SIZE_MAX)
+		return EINVAL;
+
+	pool = calloc(1, sizeof(pbuf_pool_t));
+	if (pool == NULL)
+		return ENOMEM;
+
+	fibril_mutex_lock(&pbuf_pools_lock);
+	if (pbuf_pool_seq == UINT32_MAX) {
+		/* Do not wrap around, the old IDs may still be in use */
+		fibril_mutex_unlock(&pbuf_pools_lock);
+		free(pool);
+		return ELIMIT;
+	}
+
+	/* Task ID makes pool ID unique system-wide */
+	pool->id = ((pbuf_pool_id_t)task_get_id() << 32) | pbuf_pool_seq++;
+	fibril_mutex_unlock(&pbuf_pools_lock);
+
+	buf_size = ALIGN_UP(size, PBUF_ALIGN);
+	data_offs = ALIGN_UP(sizeof(pbuf_pool_hdr_t) +
+	    count * sizeof(atomic_uint), PBUF_ALIGN);
+
+	pool->area_size = PAGES2SIZE(SIZE2PAGES(data_offs + count * buf_size));
+	if (dma) {
+		area = AS_AREA_ANY;
+		rc = dmamem_map_anonymous(pool->area_size, 0,
+		    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE, 0,
+		    &pool->phys, &area);
+		if (rc != EOK) {
+			free(pool);
+			return ENOMEM;
+		}
+	} else {
+		area = as_area_create(AS_AREA_ANY, pool->area_size,
+		    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
+		    AS_AREA_UNPAGED);
+		if (area == AS_MAP_FAILED) {
+			free(pool);
+			return ENOMEM;
+		}
+	}
+
+	pool->hdr = (pbuf_pool_hdr_t *)area;
+	pool->count = count;
+	pool->buf_size = buf_size;
+	pool->data = (uint8_t *)pool->hdr + data_offs;
+	pool->owner = true;
+	pool->writable = true;
+	pool->dma = dma;
+	fibril_mutex_initialize(&pool->lock);
+
+	pool->hdr->magic = PBUF_MAGIC;
+	pool->hdr->count = count;
+	pool->hdr->buf_size = buf_size;
+	pool->hdr->data_offs = data_offs;
+	for (i = 0; i < count; i++)
+		atomic_init(&pool->hdr->refcnt[i], 0);
+
+	pool->hdr->id = pool->id;
+
+	fibril_mutex_lock(&pbuf_pools_lock);
+	list_append(&pool->lpools, &pbuf_pools);
+	fibril_mutex_unlock(&pbuf_pools_lock);
+
+	*rpool = pool;
+	return EOK;
+}
+
+/** Create packet buffer pool.
+ *
+ * @param count Number of buffers
+ * @param size Size of one buffer in bytes
+ * @param rpool Place to store pointer to new pool
+ * @return EOK on success, EINVAL if parameters are out of range,
+ *         ENOMEM if out of memory
+ */
+errno_t pbuf_pool_create(size_t count, size_t size, pbuf_pool_t **rpool)
+{
+	return pbuf_pool_create_common(count, size, false, rpool);
+}
+
+/** Create packet buffer pool suitable for DMA.
+ *
+ * The pool is physically contiguous and the physical address of each
+ * buffer can be obtained using pbuf_phys().
+ *
+ * @param count Number of buffers
+ * @param size Size of one buffer in bytes
+ * @param rpool Place to store pointer to new pool
+ * @return EOK on success, EINVAL if parameters are out of range,
+ *         ENOMEM if out of memory
+ */
+errno_t pbuf_pool_create_dma(size_t count, size_t size, pbuf_pool_t **rpool)
+{
+	return pbuf_pool_create_common(count, size, true, rpool);
+}
+
+/** Destroy packet buffer pool.
+ *
+ * Unmaps the pool from this task. The area remains accessible
+ * to other tasks that have mapped it.
+ *
+ * @param pool Pool or @c NULL
+ */
+void pbuf_pool_destroy(pbuf_pool_t *pool)
+{
+	if (pool == NULL)
+		return;
+
+	fibril_mutex_lock(&pbuf_pools_lock);
+	list_remove(&pool->lpools);
+	fibril_mutex_unlock(&pbuf_pools_lock);
+
+	if (pool->dma)
+		dmamem_unmap_anonymous(pool->hdr);
+	else
+		as_area_destroy(pool->hdr);
+	free(pool);
+}
+
+/** Get pool ID.
+ *
+ * @param pool Pool
+ * @return Pool ID
+ */
+pbuf_pool_id_t pbuf_pool_get_id(pbuf_pool_t *pool)
+{
+	return pool->id;
+}
+
+/** Get size of buffers in pool.
+ *
+ * @param pool Pool
+ * @return Size of one buffer in bytes
+ */
+size_t pbuf_pool_get_buf_size(pbuf_pool_t *pool)
+{
+	return pool->buf_size;
+}
+
+/** Find pool mapped in this task.
+ *
+ * @param id Pool ID
+ * @return Pool or @c NULL if this task has not mapped pool @a id
+ */
+pbuf_pool_t *pbuf_pool_find(pbuf_pool_id_t id)
+{
+	pbuf_pool_t *pool;
+
+	fibril_mutex_lock(&pbuf_pools_lock);
+	pool = pbuf_pool_find_locked(id);
+	fibril_mutex_unlock(&pbuf_pools_lock);
+
+	return pool;
+}
+
+/** Import packet buffer pool.
+ *
+ * Client side of sharing a pool. The caller first sends a request
+ * which the server handles using pbuf_pool_export() and which returns
+ * the size of the pool area and the pool ID. Then this function is called
+ * (with the same exchange) to map the pool.
+ *
+ * @param exch Exchange
+ * @param id Pool ID
+ * @param size Size of pool area as returned by the server
+ * @param rpool Place to store pointer to pool
+ * @return EOK on success, EIO if the shared area is not a valid pool,
+ *         ENOMEM if out of memory or other error code
+ */
+errno_t pbuf_pool_import(async_exch_t *exch, pbuf_pool_id_t id, size_t size,
+    pbuf_pool_t **rpool)
+{
+	pbuf_pool_t *pool;
+	pbuf_pool_t *old;
+	pbuf_pool_hdr_t *hdr;
+	void *area;
+	size_t count;
+	size_t buf_size;
+	size_t data_offs;
+	unsigned int flags;
+	errno_t rc;
+
+	pool = calloc(1, sizeof(pbuf_pool_t));
+	if (pool == NULL)
+		return ENOMEM;
+
+	rc = async_share_in_start_0_1(exch, size, &flags, &area);
+	if (rc != EOK) {
+		free(pool);
+		return rc;
+	}
+
+	hdr = (pbuf_pool_hdr_t *)area;
+
+	/* Validate the area, its creator cannot be trusted */
+	if (size < sizeof(pbuf_pool_hdr_t)) {
+		as_area_destroy(area);
+		free(pool);
+		return EIO;
+	}
+
+	/* Read each field once, the creator can change them at any time */
+	count = hdr->count;
+	buf_size = hdr->buf_size;
+	data_offs = hdr->data_offs;
+	if (hdr->magic != PBUF_MAGIC || hdr->id != id ||
+	    count == 0 || count > PBUF_COUNT_MAX ||
+	    buf_size == 0 || buf_size > PBUF_SIZE_MAX ||
+	    buf_size % PBUF_ALIGN != 0 ||
+	    data_offs < sizeof(pbuf_pool_hdr_t) + count * sizeof(atomic_uint) ||
+	    data_offs % PBUF_ALIGN != 0 || data_offs > size ||
+	    count > (size - data_offs) / buf_size) {
+		as_area_destroy(area);
+		free(pool);
+		return EIO;
+	}
+
+	pool->id = id;
+	pool->hdr = hdr;
+	pool->area_size = size;
+	pool->count = count;
+	pool->buf_size = buf_size;
+	pool->data = (uint8_t *)area + data_offs;
+	pool->owner = false;
+	pool->writable = (flags & AS_AREA_WRITE) != 0;
+	fibril_mutex_initialize(&pool->lock);
+
+	fibril_mutex_lock(&pbuf_pools_lock);
+
+	/* Another fibril might have imported the pool in the meantime */
+	old = pbuf_pool_find_locked(id);
+	if (old != NULL) {
+		fibril_mutex_unlock(&pbuf_pools_lock);
+		as_area_destroy(area);
+		free(pool);
+		*rpool = old;
+		return EOK;
+	}
+
+	list_append(&pool->lpools, &pbuf_pools);
+	fibril_mutex_unlock(&pbuf_pools_lock);
+
+	*rpool = pool;
+	return EOK;
+}
+
+/** Export packet buffer pool.
+ *
+ * Server side of sharing a pool (see pbuf_pool_import()). Answers
+ * @a call with the size of the pool area and the pool ID, then accepts
+ * the share request.
+ *
+ * A client that only receives packets and never keeps buffers past
+ * the call should be given the pool read-only. A pool mapped read-only
+ * in this task can only be exported read-only.
+ *
+ * @param call Request for the pool
+ * @param pool Pool or @c NULL if the requested pool was not found
+ * @param writable @c true to let the client add and drop references
+ */
+void pbuf_pool_export(ipc_call_t *call, pbuf_pool_t *pool, bool writable)
+{
+	unsigned int flags = AS_AREA_READ;
+
+	ipc_call_t scall;
+	size_t size;
+
+	if (pool == NULL) {
+		async_answer_0(call, ENOENT);
+		return;
+	}
+
+	if (writable && !pool->writable) {
+		async_answer_0(call, EPERM);
+		return;
+	}
+
+	if (writable)
+		flags |= AS_AREA_WRITE;
+
+	async_answer_3(call, EOK, pool->area_size, LOWER32(pool->id),
+	    UPPER32(pool->id));
+
+	if (!async_share_in_receive(&scall, &size)) {
+		async_answer_0(&scall, EINVAL);
+		return;
+	}
+
+	if (size != pool->area_size) {
+		async_answer_0(&scall, EINVAL);
+		return;
+	}
+
+	(void) async_share_in_finalize(&scall, pool->hdr, flags);
+}
+
+/** Allocate packet buffer.
+ *
+ * Only the task that created the pool can allocate buffers from it.
+ * The new buffer has one reference.
+ *
+ * @param pool Pool
+ * @param rid Place to store buffer ID
+ * @return EOK on success, ENOMEM if no buffer is free
+ */
+errno_t pbuf_alloc(pbuf_pool_t *pool, pbuf_id_t *rid)
+{
+	size_t i;
+	size_t id;
+
+	assert(pool->owner);
+
+	fibril_mutex_lock(&pool->lock);
+
+	for (i = 0; i < pool->count; i++) {
+		id = (pool->next + i) % pool->count;
+		/*
+		 * Other tasks only drop references, once zero, the count
+		 * cannot change under us.
+		 */
+		if (atomic_load_explicit(&pool->hdr->refcnt[id],
+		    memory_order_acquire) == 0) {
+			atomic_store_explicit(&pool->hdr->refcnt[id], 1,
+			    memory_order_relaxed);
+			pool->next = (id + 1) % pool->count;
+			fibril_mutex_unlock(&pool->lock);
+			*rid = id;
+			return EOK;
+		}
+	}
+
+	fibril_mutex_unlock(&pool->lock);
+	return ENOMEM;
+}
+
+/** Add reference to packet buffer.
+ *
+ * The caller must already hold a reference (or have the buffer lent).
+ *
+ * @param pool Pool
+ * @param id Buffer ID
+ */
+void pbuf_ref(pbuf_pool_t *pool, pbuf_id_t id)
+{
+	assert(pool->writable);
+	assert(id < pool->count);
+	atomic_fetch_add_explicit(&pool->hdr->refcnt[id], 1,
+	    memory_order_relaxed);
+}
+
+/** Drop reference to packet buffer.
+ *
+ * When the last reference is dropped, the buffer is freed.
+ *
+ * @param pool Pool
+ * @param id Buffer ID
+ */
+void pbuf_release(pbuf_pool_t *pool, pbuf_id_t id)
+{
+	assert(pool->writable);
+	assert(id < pool->count);
+	atomic_fetch_sub_explicit(&pool->hdr->refcnt[id], 1,
+	    memory_order_release);
+}
+
+/** Get pointer to data in packet buffer.
+ *
+ * @param pool Pool
+ * @param id Buffer ID
+ * @param offs Offset of data within the buffer
+ * @param size Size of data
+ * @return Pointer to data or @c NULL if the buffer ID or the range
+ *         is not valid
+ */
+void *pbuf_get(pbuf_pool_t *pool, pbuf_id_t id, size_t offs, size_t size)
+{
+	if (id >= pool->count || offs > pool->buf_size ||
+	    size > pool->buf_size - offs)
+		return NULL;
+
+	return pool->data + id * pool->buf_size + offs;
+}
+
+/** Get physical address of packet buffer.
+ *
+ * @param pool Pool created by pbuf_pool_create_dma()
+ * @param id Buffer ID
+ * @return Physical address of the start of the buffer
+ */
+uintptr_t pbuf_phys(pbuf_pool_t *pool, pbuf_id_t id)
+{
+	assert(pool->dma);
+	assert(id < pool->count);
+
+	return pool->phys + ((uint8_t *)pool->data - (uint8_t *)pool->hdr) +
+	    id * pool->buf_size;
+}
+
+/** Get offset of data within packet buffer.
+ *
+ * @param pool Pool
+ * @param id Buffer ID
+ * @param data Pointer into the buffer
+ * @return Offset of @a data from start of the buffer
+ */
+size_t pbuf_offset(pbuf_pool_t *pool, pbuf_id_t id, const void *data)
+{
+	const uint8_t *buf = pool->data + id * pool->buf_size;
+
+	assert(id < pool->count);
+	assert((const uint8_t *)data >= buf);
+	assert((const uint8_t *)data <= buf + pool->buf_size);
+
+	return (const uint8_t *)data - buf;
+}
+
+/** @}
+ */
@@ -906,6 +906,53 @@ errno_t vfs_read_short(int file, aoff64_t pos, void *buf, size_t nbyte,
 	return EOK;
 }
 
+/** Read a batch of directory entries
+ *
+ * Fill @a buf with packed directory entries (vfs_dirent_t) starting at
+ * position @a pos. On success @a pos is updated to the position of the
+ * next entry not returned. Zero bytes read indicates the end of directory.
+ * File systems which do not support batched reads return ENOTSUP, in
+ * which case the caller should fall back to vfs_read_short().
+ *
+ * @param file          Directory handle to read from
+ * @param[in,out] pos   Position to read from, updated to the next position
+ * @param buf           Buffer to read to
+ * @param nbyte         Size of the buffer
+ * @param[out] nread    Number of bytes filled with entries
+ *
+ * @return              EOK on success or an error code
+ */
+errno_t vfs_readdir(int file, aoff64_t *pos, void *buf, size_t nbyte,
+    size_t *nread)
+{
+	errno_t rc;
+	ipc_call_t answer;
+	aid_t req;
+
+	if (nbyte > DATA_XFER_LIMIT)
+		nbyte = DATA_XFER_LIMIT;
+
+	async_exch_t *exch = vfs_exchange_begin();
+
+	req = async_send_3(exch, VFS_IN_READDIR, file, LOWER32(*pos),
+	    UPPER32(*pos), &answer);
+	rc = async_data_read_start(exch, buf, nbyte);
+
+	vfs_exchange_end(exch);
+
+	if (rc == EOK)
+		async_wait_for(req, &rc);
+	else
+		async_forget(req);
+
+	if (rc != EOK)
+		return rc;
+
+	*nread = ipc_get_arg1(&answer);
+	*pos = MERGE_LOUP32(ipc_get_arg2(&answer), ipc_get_arg3(&answer));
+	return EOK;
+}
+
 /** Rename a file or directory
  *
  * There is no file-handle-based variant to disallow attempts to introduce loops
@@ -1076,24 +1123,130 @@ errno_t vfs_stat(int file, vfs_stat_t *stat)
 	return rc;
 }
 
+/** Get information about several files in one request
+ *
+ * Each name is looked up relative to @a parent. Names may be relative
+ * paths. The per-name result is stored in @a rcs and @a stats is only
+ * valid for names whose return code is EOK.
+ *
+ * @param parent        Directory handle the names are relative to
+ * @param names         Array of names
+ * @param count         Number of names
+ * @param[out] stats    Array of @a count structures to store information
+ * @param[out] rcs      Array of @a count per-name return codes
+ *
+ * @return              EOK if all names were processed or an error code
+ */
+errno_t vfs_stat_bulk(int parent, const char *const *names, size_t count,
+    vfs_stat_t *stats, errno_t *rcs)
+{
+	size_t done = 0;
+	char *buf;
+
+	buf = malloc(MAX_PATH_LEN);
+	if (buf == NULL)
+		return ENOMEM;
+
+	while (done < count) {
+		/* Pack as many names as fit into one request. */
+		size_t n = 0;
+		size_t bsize = 0;
+		while (done + n < count && n < VFS_STAT_BULK_MAX) {
+			size_t nsize = str_size(names[done + n]) + 1;
+			if (bsize + nsize > MAX_PATH_LEN)
+				break;
+
+			memcpy(buf + bsize, names[done + n], nsize);
+			bsize += nsize;
+			n++;
+		}
+
+		if (n == 0) {
+			free(buf);
+			return ENAMETOOLONG;
+		}
+
+		async_exch_t *exch = vfs_exchange_begin();
+
+		ipc_call_t answer;
+		aid_t req = async_send_2(exch, VFS_IN_STAT_BULK, parent, n,
+		    &answer);
+
+		/* VFS expects all three transfers even if one fails. */
+		errno_t rc = async_data_write_start(exch, buf, bsize);
+		errno_t rc2 = async_data_read_start(exch, stats + done,
+		    n * sizeof(vfs_stat_t));
+		if (rc == EOK)
+			rc = rc2;
+		rc2 = async_data_read_start(exch, rcs + done,
+		    n * sizeof(errno_t));
+		if (rc == EOK)
+			rc = rc2;
+
+		vfs_exchange_end(exch);
+
+		async_wait_for(req, &rc2);
+		if (rc2 != EOK)
+			rc = rc2;
+
+		if (rc != EOK) {
+			free(buf);
+			return rc;
+		}
+
+		done += n;
+	}
+
+	free(buf);
+	return EOK;
+}
+
 /** Get file information
  *
- * @param path          File path to get information about
+ * This only takes a single request, unlike vfs_lookup() followed by
+ * vfs_stat().
+ *
+ * @param parent        Directory handle @a path is relative to
+ * @param path          Path of the file to get information about
  * @param[out] stat     Place to store file information
  *
  * @return              EOK on success or an error code
  */
-errno_t vfs_stat_path(const char *path, vfs_stat_t *stat)
+errno_t vfs_stat_at(int parent, const char *path, vfs_stat_t *stat)
 {
-	int file;
-	errno_t rc = vfs_lookup(path, 0, &file);
+	errno_t rc, rc_name;
+
+	rc = vfs_stat_bulk(parent, &path, 1, stat, &rc_name);
 	if (rc != EOK)
 		return rc;
 
-	rc = vfs_stat(file, stat);
+	return rc_name;
+}
 
-	vfs_put(file);
+/** Get file information
+ *
+ * @param path          File path to get information about
+ * @param[out] stat     Place to store file information
+ *
+ * @return              EOK on success or an error code
+ */
+errno_t vfs_stat_path(const char *path, vfs_stat_t *stat)
+{
+	size_t size;
+	char *p = vfs_absolutize(path, &size);
+	if (!p)
+		return ENOMEM;
 
+	int root = vfs_root();
+	if (root < 0) {
+		free(p);
+		return ENOENT;
+	}
+
+	errno_t rc = vfs_stat_at(root, p, stat);
+
+	vfs_put(root);
+	free(p);
 	return rc;
 }
 
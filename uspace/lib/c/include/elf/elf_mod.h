@@ -88,6 +88,12 @@ typedef struct {
 	/** Filedescriptor of the file from which we are loading */
 	int fd;
 
+	/**
+	 * File handle used by segments mapped from the file or -1. It must
+	 * remain open for as long as the segments are mapped.
+	 */
+	int map_fd;
+
 	/** Difference between run-time addresses and link-time addresses */
 	uintptr_t bias;
 
@@ -46,6 +46,22 @@
 #define MAX_MNTOPTS_LEN 256
 #define PLB_SIZE        (2 * MAX_PATH_LEN)
 
+/*
+ * A file mapping created with the VFS pager passes three arguments:
+ * the file handle, flags and the file offset of the start of the area
+ * (which must be page-aligned).
+ */
+
+/**
+ * Flag in the second pager argument of a file mapping requesting that
+ * pages are shared with the VFS page cache instead of being copied. Must
+ * only be used for mappings that are never written to.
+ */
+#define VFS_PAGER_SHARED 1
+
+/** Maximum number of names in a single bulk stat request */
+#define VFS_STAT_BULK_MAX 64
+
 /* Basic types. */
 typedef int16_t fs_handle_t;
 typedef uint32_t fs_index_t;
@@ -61,6 +77,16 @@ typedef struct {
 	unsigned int instance;
 	bool concurrent_read_write;
 	bool write_retains_size;
+	/**
+	 * Names can be cached by VFS. Only set for file systems whose names
+	 * are compared exactly and change solely through VFS.
+	 */
+	bool cache_lookups;
+	/**
+	 * File contents can be cached by VFS. Only set for file systems
+	 * whose files change solely through VFS.
+	 */
+	bool cache_pages;
 } vfs_info_t;
 
 /** Data returned by filesystem probe regarding a specific volume. */
@@ -69,6 +95,36 @@ typedef struct {
 	char vuid[FS_VUID_MAXLEN + 1];
 } vfs_fs_probe_info_t;
 
+/** Type of a directory entry returned by VFS_IN_READDIR. */
+typedef enum {
+	VFS_DIRENT_UNKNOWN = 0,
+	VFS_DIRENT_FILE,
+	VFS_DIRENT_DIRECTORY
+} vfs_dirent_type_t;
+
+/** Directory entry carries a valid size. */
+#define VFS_DIRENT_HAS_SIZE	1
+
+/** Packed directory entry returned by VFS_IN_READDIR.
+ *
+ * Entries are stored back to back in the reply buffer. Each entry starts
+ * at an 8-byte aligned offset and @c reclen is the distance to the next one.
+ */
+typedef struct {
+	/** Length of the record including the name and padding. */
+	uint16_t reclen;
+	/** Entry type (vfs_dirent_type_t). */
+	uint8_t type;
+	/** VFS_DIRENT_* flags. */
+	uint8_t flags;
+	/** Index of the node or zero if not known. */
+	fs_index_t index;
+	/** Size of the node, valid if VFS_DIRENT_HAS_SIZE is set. */
+	uint64_t size;
+	/** NUL-terminated entry name. */
+	char name[];
+} vfs_dirent_t;
+
 typedef enum {
 	VFS_IN_CLONE = IPC_FIRST_USER_METHOD,
 	VFS_IN_FSPROBE,
@@ -77,10 +133,12 @@ typedef enum {
 	VFS_IN_OPEN,
 	VFS_IN_PUT,
 	VFS_IN_READ,
+	VFS_IN_READDIR,
 	VFS_IN_REGISTER,
 	VFS_IN_RENAME,
 	VFS_IN_RESIZE,
 	VFS_IN_STAT,
+	VFS_IN_STAT_BULK,
 	VFS_IN_STATFS,
 	VFS_IN_SYNC,
 	VFS_IN_UNLINK,
@@ -100,7 +158,9 @@ typedef enum {
 	VFS_OUT_MOUNTED,
 	VFS_OUT_OPEN_NODE,
 	VFS_OUT_READ,
+	VFS_OUT_READDIR,
 	VFS_OUT_STAT,
+	VFS_OUT_STAT_BULK,
 	VFS_OUT_STATFS,
 	VFS_OUT_SYNC,
 	VFS_OUT_TRUNCATE,
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libc
+ * @{
+ */
+/** @file Shared packet buffer pool
+ */
+
+#ifndef _LIBC_PBUF_H_
+#define _LIBC_PBUF_H_
+
+#include <async.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <types/common.h>
+
+/** Maximum number of buffers in a pool */
+#define PBUF_COUNT_MAX 65536
+/** Maximum size of a single buffer */
+#define PBUF_SIZE_MAX 65536
+
+/**
+ * Packet buffer pool ID (unique system-wide).
+ *
+ * Passed in IPC as two arguments, lower 32 bits first.
+ */
+typedef uint64_t pbuf_pool_id_t;
+/** Packet buffer ID (index into pool) */
+typedef sysarg_t pbuf_id_t;
+
+struct pbuf_pool;
+typedef struct pbuf_pool pbuf_pool_t;
+
+/** Reference to a packet buffer */
+typedef struct {
+	/** Pool or @c NULL if data is not stored in a packet buffer */
+	pbuf_pool_t *pool;
+	/** Buffer */
+	pbuf_id_t id;
+} pbuf_ref_t;
+
+extern errno_t pbuf_pool_create(size_t, size_t, pbuf_pool_t **);
+extern errno_t pbuf_pool_create_dma(size_t, size_t, pbuf_pool_t **);
+extern void pbuf_pool_destroy(pbuf_pool_t *);
+extern pbuf_pool_id_t pbuf_pool_get_id(pbuf_pool_t *);
+extern size_t pbuf_pool_get_buf_size(pbuf_pool_t *);
+extern pbuf_pool_t *pbuf_pool_find(pbuf_pool_id_t);
+extern errno_t pbuf_pool_import(async_exch_t *, pbuf_pool_id_t, size_t,
+    pbuf_pool_t **);
+extern void pbuf_pool_export(ipc_call_t *, pbuf_pool_t *, bool);
+
+extern errno_t pbuf_alloc(pbuf_pool_t *, pbuf_id_t *);
+extern void pbuf_ref(pbuf_pool_t *, pbuf_id_t);
+extern void pbuf_release(pbuf_pool_t *, pbuf_id_t);
+extern void *pbuf_get(pbuf_pool_t *, pbuf_id_t, size_t, size_t);
+extern size_t pbuf_offset(pbuf_pool_t *, pbuf_id_t, const void *);
+extern uintptr_t pbuf_phys(pbuf_pool_t *, pbuf_id_t);
+
+#endif
+
+/** @}
+ */
@@ -102,12 +102,16 @@ extern errno_t vfs_pass_handle(async_exch_t *, int, async_exch_t *);
 extern errno_t vfs_put(int);
 extern errno_t vfs_read(int, aoff64_t *, void *, size_t, size_t *);
 extern errno_t vfs_read_short(int, aoff64_t, void *, size_t, ssize_t *);
+extern errno_t vfs_readdir(int, aoff64_t *, void *, size_t, size_t *);
 extern errno_t vfs_receive_handle(bool, int *);
 extern errno_t vfs_rename_path(const char *, const char *);
 extern errno_t vfs_resize(int, aoff64_t);
 extern int vfs_root(void);
 extern errno_t vfs_root_set(int);
 extern errno_t vfs_stat(int, vfs_stat_t *);
+extern errno_t vfs_stat_at(int, const char *, vfs_stat_t *);
+extern errno_t vfs_stat_bulk(int, const char *const *, size_t, vfs_stat_t *,
+    errno_t *);
 extern errno_t vfs_stat_path(const char *, vfs_stat_t *);
 extern errno_t vfs_statfs(int, vfs_statfs_t *);
 extern errno_t vfs_statfs_path(const char *, vfs_statfs_t *);
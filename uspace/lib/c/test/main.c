@@ -45,6 +45,7 @@ PCUT_IMPORT(inttypes);
 PCUT_IMPORT(loc);
 PCUT_IMPORT(mem);
 PCUT_IMPORT(odict);
+PCUT_IMPORT(pbuf);
 PCUT_IMPORT(perf);
 PCUT_IMPORT(perm);
 PCUT_IMPORT(qsort);
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <pbuf.h>
+#include <pcut/pcut.h>
+#include <stdint.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(pbuf);
+
+/** Creating and destroying a pool */
+PCUT_TEST(pool_create_destroy)
+{
+	pbuf_pool_t *pool;
+	errno_t rc;
+
+	rc = pbuf_pool_create(16, 1500, &pool);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Buffer size is rounded up */
+	PCUT_ASSERT_TRUE(pbuf_pool_get_buf_size(pool) >= 1500);
+
+	PCUT_ASSERT_EQUALS(pool, pbuf_pool_find(pbuf_pool_get_id(pool)));
+
+	pbuf_pool_destroy(pool);
+}
+
+/** Buffers of a DMA pool are physically contiguous */
+PCUT_TEST(pool_create_dma)
+{
+	pbuf_pool_t *pool;
+	pbuf_id_t id[2];
+	size_t bsize;
+	errno_t rc;
+
+	rc = pbuf_pool_create_dma(4, 2048, &pool);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	bsize = pbuf_pool_get_buf_size(pool);
+
+	rc = pbuf_alloc(pool, &id[0]);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = pbuf_alloc(pool, &id[1]);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_TRUE(pbuf_phys(pool, id[0]) != 0);
+	PCUT_ASSERT_INT_EQUALS((id[1] - id[0]) * bsize,
+	    pbuf_phys(pool, id[1]) - pbuf_phys(pool, id[0]));
+
+	pbuf_release(pool, id[0]);
+	pbuf_release(pool, id[1]);
+	pbuf_pool_destroy(pool);
+}
+
+/** Pool parameters out of range are rejected */
+PCUT_TEST(pool_create_invalid)
+{
+	pbuf_pool_t *pool;
+	errno_t rc;
+
+	rc = pbuf_pool_create(0, 1500, &pool);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+
+	rc = pbuf_pool_create(16, 0, &pool);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+
+	rc = pbuf_pool_create(16, PBUF_SIZE_MAX + 1, &pool);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+}
+
+/** Distinct pools have distinct IDs */
+PCUT_TEST(pool_id)
+{
+	pbuf_pool_t *p1;
+	pbuf_pool_t *p2;
+	errno_t rc;
+
+	rc = pbuf_pool_create(1, 64, &p1);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = pbuf_pool_create(1, 64, &p2);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_TRUE(pbuf_pool_get_id(p1) != pbuf_pool_get_id(p2));
+
+	pbuf_pool_destroy(p1);
+	PCUT_ASSERT_NULL(pbuf_pool_find(pbuf_pool_get_id(p2) ^ 1));
+	pbuf_pool_destroy(p2);
+}
+
+/** Buffers are allocated until the pool is exhausted and freed on release */
+PCUT_TEST(alloc_release)
+{
+	pbuf_pool_t *pool;
+	pbuf_id_t id[4];
+	pbuf_id_t nid;
+	unsigned i;
+	errno_t rc;
+
+	rc = pbuf_pool_create(4, 128, &pool);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	for (i = 0; i < 4; i++) {
+		rc = pbuf_alloc(pool, &id[i]);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	}
+
+	PCUT_ASSERT_TRUE(id[0] != id[1]);
+	PCUT_ASSERT_TRUE(id[2] != id[3]);
+
+	rc = pbuf_alloc(pool, &nid);
+	PCUT_ASSERT_ERRNO_VAL(ENOMEM, rc);
+
+	/* Buffer with an extra reference is not freed by one release */
+	pbuf_ref(pool, id[2]);
+	pbuf_release(pool, id[2]);
+	rc = pbuf_alloc(pool, &nid);
+	PCUT_ASSERT_ERRNO_VAL(ENOMEM, rc);
+
+	pbuf_release(pool, id[2]);
+	rc = pbuf_alloc(pool, &nid);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(id[2], nid);
+
+	pbuf_pool_destroy(pool);
+}
+
+/** Access to buffer data is bounds-checked */
+PCUT_TEST(get)
+{
+	pbuf_pool_t *pool;
+	pbuf_id_t id;
+	uint8_t *p;
+	size_t bsize;
+	errno_t rc;
+
+	rc = pbuf_pool_create(2, 256, &pool);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	bsize = pbuf_pool_get_buf_size(pool);
+
+	rc = pbuf_alloc(pool, &id);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	p = pbuf_get(pool, id, 0, bsize);
+	PCUT_ASSERT_NOT_NULL(p);
+	p[0] = 0x12;
+	p[bsize - 1] = 0x34;
+
+	p = pbuf_get(pool, id, 2, 10);
+	PCUT_ASSERT_NOT_NULL(p);
+	PCUT_ASSERT_INT_EQUALS(2, pbuf_offset(pool, id, p));
+
+	PCUT_ASSERT_NULL(pbuf_get(pool, id, 1, bsize));
+	PCUT_ASSERT_NULL(pbuf_get(pool, id, bsize + 1, 0));
+	PCUT_ASSERT_NULL(pbuf_get(pool, 2, 0, 1));
+
+	pbuf_release(pool, id);
+	pbuf_pool_destroy(pool);
+}
+
+PCUT_EXPORT(pbuf);
@@ -37,6 +37,7 @@
 
 #include <async.h>
 #include <offset.h>
+#include <types/bd.h>
 
 typedef struct {
 	async_sess_t *sess;
@@ -47,10 +48,23 @@ extern void bd_close(bd_t *);
 extern errno_t bd_read_blocks(bd_t *, aoff64_t, size_t, void *, size_t);
 extern errno_t bd_read_toc(bd_t *, uint8_t, void *, size_t);
 extern errno_t bd_write_blocks(bd_t *, aoff64_t, size_t, const void *, size_t);
+extern errno_t bd_read_blocks_forward(bd_t *, aoff64_t, size_t, ipc_call_t *);
+extern errno_t bd_write_blocks_forward(bd_t *, aoff64_t, size_t, ipc_call_t *);
+extern errno_t bd_extents_size(const bd_extent_t *, size_t, size_t, size_t *);
+extern errno_t bd_read_blocks_v(bd_t *, const bd_extent_t *, size_t, void *,
+    size_t);
+extern errno_t bd_write_blocks_v(bd_t *, const bd_extent_t *, size_t,
+    const void *, size_t);
+extern errno_t bd_read_blocks_v_forward(bd_t *, const bd_extent_t *, size_t,
+    ipc_call_t *);
+extern errno_t bd_write_blocks_v_forward(bd_t *, const bd_extent_t *, size_t,
+    ipc_call_t *);
 extern errno_t bd_sync_cache(bd_t *, aoff64_t, size_t);
 extern errno_t bd_get_block_size(bd_t *, size_t *);
+extern errno_t bd_get_block_size_caps(bd_t *, size_t *, unsigned *);
 extern errno_t bd_get_num_blocks(bd_t *, aoff64_t *);
 extern errno_t bd_eject(bd_t *);
+extern errno_t bd_map(bd_t *, size_t, void **);
 
 #endif
 
@@ -40,6 +40,7 @@
 #include <fibril_synch.h>
 #include <stdbool.h>
 #include <offset.h>
+#include <types/bd.h>
 
 typedef struct bd_ops bd_ops_t;
 
@@ -66,6 +67,43 @@ struct bd_ops {
 	errno_t (*get_block_size)(bd_srv_t *, size_t *);
 	errno_t (*get_num_blocks)(bd_srv_t *, aoff64_t *);
 	errno_t (*eject)(bd_srv_t *);
+	/**
+	 * Optional. Handle block read by forwarding the received data read
+	 * call elsewhere. The call must always be consumed (forwarded or
+	 * answered). Takes precedence over read_blocks.
+	 */
+	errno_t (*read_blocks_fwd)(bd_srv_t *, aoff64_t, size_t, ipc_call_t *,
+	    size_t);
+	/**
+	 * Optional. Handle block write by forwarding the received data write
+	 * call elsewhere. The call must always be consumed (forwarded or
+	 * answered). Takes precedence over write_blocks.
+	 */
+	errno_t (*write_blocks_fwd)(bd_srv_t *, aoff64_t, size_t, ipc_call_t *,
+	    size_t);
+	/**
+	 * Optional. Vectored read. If not implemented, it is emulated
+	 * using read_blocks.
+	 */
+	errno_t (*read_blocks_v)(bd_srv_t *, const bd_extent_t *, size_t,
+	    void *, size_t);
+	/**
+	 * Optional. Vectored write. If not implemented, it is emulated
+	 * using write_blocks.
+	 */
+	errno_t (*write_blocks_v)(bd_srv_t *, const bd_extent_t *, size_t,
+	    const void *, size_t);
+	/** Optional. Vectored read, forwarding variant (see read_blocks_fwd). */
+	errno_t (*read_blocks_v_fwd)(bd_srv_t *, const bd_extent_t *, size_t,
+	    ipc_call_t *, size_t);
+	/** Optional. Vectored write, forwarding variant (see write_blocks_fwd). */
+	errno_t (*write_blocks_v_fwd)(bd_srv_t *, const bd_extent_t *, size_t,
+	    ipc_call_t *, size_t);
+	/**
+	 * Optional. Get memory area backing the device (start address and
+	 * size rounded up to whole pages) to be shared with the client.
+	 */
+	errno_t (*map)(bd_srv_t *, void **, size_t *);
 };
 
 extern void bd_srvs_init(bd_srvs_t *);
@@ -44,7 +44,10 @@ typedef enum {
 	BD_SYNC_CACHE,
 	BD_WRITE_BLOCKS,
 	BD_READ_TOC,
-	BD_EJECT
+	BD_EJECT,
+	BD_READ_BLOCKS_V,
+	BD_WRITE_BLOCKS_V,
+	BD_MAP
 } bd_request_t;
 
 #endif
@@ -81,6 +81,12 @@
  */
 #define NIC_VLAN_BITMAP_SIZE  512
 
+/**
+ * Number of buckets in batch size histograms. Bucket i counts batches
+ * of 2^i to 2^(i+1) - 1 frames, the last bucket counts all larger ones.
+ */
+#define NIC_BATCH_HIST_BUCKETS  8
+
 #define NIC_DEVICE_PRINT_FMT  "%x"
 
 /**
@@ -222,6 +228,13 @@ typedef struct nic_device_stats {
 	unsigned long receive_compressed;
 	/** Total compressed packet transmitted. */
 	unsigned long send_compressed;
+
+	/* batching */
+
+	/** Histogram of number of frames received at once */
+	unsigned long receive_batch_hist[NIC_BATCH_HIST_BUCKETS];
+	/** Histogram of number of frames reported transmitted at once */
+	unsigned long send_batch_hist[NIC_BATCH_HIST_BUCKETS];
 } nic_device_stats_t;
 
 /** Errors corresponding to those in the nic_device_stats_t */
@@ -34,6 +34,7 @@
  * @brief Block device client interface
  */
 
+#include <as.h>
 #include <async.h>
 #include <assert.h>
 #include <bd.h>
@@ -153,6 +154,249 @@ errno_t bd_write_blocks(bd_t *bd, aoff64_t ba, size_t cnt, const void *data,
 	return EOK;
 }
 
+/** Forward client's data read request to block device.
+ *
+ * Sends a request to read @a cnt blocks starting at @a ba and forwards
+ * the pending IPC_M_DATA_READ call @a rcall of our own client along
+ * with it. The data is thus transferred directly between the block device
+ * server and our client without being copied through the caller.
+ *
+ * @param bd Block device
+ * @param ba Address of first block
+ * @param cnt Number of blocks
+ * @param rcall Received data read call (always consumed)
+ * @return EOK on success or an error code
+ */
+errno_t bd_read_blocks_forward(bd_t *bd, aoff64_t ba, size_t cnt,
+    ipc_call_t *rcall)
+{
+	async_exch_t *exch = async_exchange_begin(bd->sess);
+
+	ipc_call_t answer;
+	aid_t req = async_send_3(exch, BD_READ_BLOCKS, LOWER32(ba),
+	    UPPER32(ba), cnt, &answer);
+	errno_t rc = async_forward_0(rcall, exch, 0, IPC_FF_ROUTE_FROM_ME);
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+	return retval;
+}
+
+/** Forward client's data write request to block device.
+ *
+ * Sends a request to write @a cnt blocks starting at @a ba and forwards
+ * the pending IPC_M_DATA_WRITE call @a wcall of our own client along
+ * with it.
+ *
+ * @param bd Block device
+ * @param ba Address of first block
+ * @param cnt Number of blocks
+ * @param wcall Received data write call (always consumed)
+ * @return EOK on success or an error code
+ */
+errno_t bd_write_blocks_forward(bd_t *bd, aoff64_t ba, size_t cnt,
+    ipc_call_t *wcall)
+{
+	async_exch_t *exch = async_exchange_begin(bd->sess);
+
+	ipc_call_t answer;
+	aid_t req = async_send_3(exch, BD_WRITE_BLOCKS, LOWER32(ba),
+	    UPPER32(ba), cnt, &answer);
+	errno_t rc = async_forward_0(wcall, exch, 0, IPC_FF_ROUTE_FROM_ME);
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+	return retval;
+}
+
+/** Compute total data size of extent list.
+ *
+ * @param ext Array of extents
+ * @param next Number of extents
+ * @param bsize Block size
+ * @param rsize Place to store total size in bytes
+ * @return EOK on success, EOVERFLOW if size does not fit in size_t
+ */
+errno_t bd_extents_size(const bd_extent_t *ext, size_t next, size_t bsize,
+    size_t *rsize)
+{
+	size_t total = 0;
+	size_t i;
+
+	for (i = 0; i < next; i++) {
+		if (ext[i].cnt > (SIZE_MAX - total) / bsize)
+			return EOVERFLOW;
+		total += ext[i].cnt * bsize;
+	}
+
+	*rsize = total;
+	return EOK;
+}
+
+/** Read blocks from multiple extents (vectored read).
+ *
+ * Data of all extents is stored consecutively in @a data.
+ *
+ * @param bd Block device
+ * @param ext Array of extents
+ * @param next Number of extents (at most BD_EXTENTS_MAX)
+ * @param data Data buffer
+ * @param size Size of data buffer
+ * @return EOK on success or an error code
+ */
+errno_t bd_read_blocks_v(bd_t *bd, const bd_extent_t *ext, size_t next,
+    void *data, size_t size)
+{
+	async_exch_t *exch = async_exchange_begin(bd->sess);
+
+	ipc_call_t answer;
+	aid_t req = async_send_1(exch, BD_READ_BLOCKS_V, next, &answer);
+	errno_t rc = async_data_write_start(exch, ext,
+	    next * sizeof(bd_extent_t));
+	if (rc != EOK) {
+		async_exchange_end(exch);
+		async_forget(req);
+		return rc;
+	}
+
+	rc = async_data_read_start(exch, data, size);
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+	return retval;
+}
+
+/** Write blocks to multiple extents (vectored write).
+ *
+ * Data of all extents is taken consecutively from @a data.
+ *
+ * @param bd Block device
+ * @param ext Array of extents
+ * @param next Number of extents (at most BD_EXTENTS_MAX)
+ * @param data Data buffer
+ * @param size Size of data buffer
+ * @return EOK on success or an error code
+ */
+errno_t bd_write_blocks_v(bd_t *bd, const bd_extent_t *ext, size_t next,
+    const void *data, size_t size)
+{
+	async_exch_t *exch = async_exchange_begin(bd->sess);
+
+	ipc_call_t answer;
+	aid_t req = async_send_1(exch, BD_WRITE_BLOCKS_V, next, &answer);
+	errno_t rc = async_data_write_start(exch, ext,
+	    next * sizeof(bd_extent_t));
+	if (rc != EOK) {
+		async_exchange_end(exch);
+		async_forget(req);
+		return rc;
+	}
+
+	rc = async_data_write_start(exch, data, size);
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+	return retval;
+}
+
+/** Forward client's data read request to block device as vectored read.
+ *
+ * @param bd Block device
+ * @param ext Array of extents
+ * @param next Number of extents
+ * @param rcall Received data read call (always consumed)
+ * @return EOK on success or an error code
+ */
+errno_t bd_read_blocks_v_forward(bd_t *bd, const bd_extent_t *ext,
+    size_t next, ipc_call_t *rcall)
+{
+	async_exch_t *exch = async_exchange_begin(bd->sess);
+
+	ipc_call_t answer;
+	aid_t req = async_send_1(exch, BD_READ_BLOCKS_V, next, &answer);
+	errno_t rc = async_data_write_start(exch, ext,
+	    next * sizeof(bd_extent_t));
+	if (rc != EOK) {
+		async_exchange_end(exch);
+		async_forget(req);
+		async_answer_0(rcall, rc);
+		return rc;
+	}
+
+	rc = async_forward_0(rcall, exch, 0, IPC_FF_ROUTE_FROM_ME);
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+	return retval;
+}
+
+/** Forward client's data write request to block device as vectored write.
+ *
+ * @param bd Block device
+ * @param ext Array of extents
+ * @param next Number of extents
+ * @param wcall Received data write call (always consumed)
+ * @return EOK on success or an error code
+ */
+errno_t bd_write_blocks_v_forward(bd_t *bd, const bd_extent_t *ext,
+    size_t next, ipc_call_t *wcall)
+{
+	async_exch_t *exch = async_exchange_begin(bd->sess);
+
+	ipc_call_t answer;
+	aid_t req = async_send_1(exch, BD_WRITE_BLOCKS_V, next, &answer);
+	errno_t rc = async_data_write_start(exch, ext,
+	    next * sizeof(bd_extent_t));
+	if (rc != EOK) {
+		async_exchange_end(exch);
+		async_forget(req);
+		async_answer_0(wcall, rc);
+		return rc;
+	}
+
+	rc = async_forward_0(wcall, exch, 0, IPC_FF_ROUTE_FROM_ME);
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+	return retval;
+}
+
 errno_t bd_sync_cache(bd_t *bd, aoff64_t ba, size_t cnt)
 {
 	async_exch_t *exch = async_exchange_begin(bd->sess);
@@ -165,17 +409,33 @@ errno_t bd_sync_cache(bd_t *bd, aoff64_t ba, size_t cnt)
 }
 
 errno_t bd_get_block_size(bd_t *bd, size_t *rbsize)
+{
+	unsigned caps;
+
+	return bd_get_block_size_caps(bd, rbsize, &caps);
+}
+
+/** Get block size and capabilities of a block device.
+ *
+ * @param bd Block device
+ * @param rbsize Place to store block size
+ * @param rcaps Place to store capabilities (combination of bd_cap_t)
+ * @return EOK on success or an error code
+ */
+errno_t bd_get_block_size_caps(bd_t *bd, size_t *rbsize, unsigned *rcaps)
 {
 	sysarg_t bsize;
+	sysarg_t caps;
 	async_exch_t *exch = async_exchange_begin(bd->sess);
 
-	errno_t rc = async_req_0_1(exch, BD_GET_BLOCK_SIZE, &bsize);
+	errno_t rc = async_req_0_2(exch, BD_GET_BLOCK_SIZE, &bsize, &caps);
 	async_exchange_end(exch);
 
 	if (rc != EOK)
 		return rc;
 
 	*rbsize = bsize;
+	*rcaps = caps;
 	return EOK;
 }
 
@@ -205,6 +465,45 @@ errno_t bd_eject(bd_t *bd)
 	return rc;
 }
 
+/** Map device memory into our address space.
+ *
+ * Only supported by devices backed by memory, such as RAM disks, which
+ * report BD_CAP_MAP (see bd_get_block_size_caps()). Data can then be
+ * accessed directly without any IPC.
+ *
+ * @param bd Block device
+ * @param size Size of the device data rounded up to whole pages
+ * @param rbuf Place to store address of the mapped area
+ * @return EOK on success, ENOTSUP if the device does not support mapping
+ *         or an error code
+ */
+errno_t bd_map(bd_t *bd, size_t size, void **rbuf)
+{
+	void *buf;
+
+	async_exch_t *exch = async_exchange_begin(bd->sess);
+
+	ipc_call_t answer;
+	aid_t req = async_send_0(exch, BD_MAP, &answer);
+	errno_t rc = async_share_in_start_0_0(exch, size, &buf);
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+	if (retval != EOK) {
+		as_area_destroy(buf);
+		return retval;
+	}
+
+	*rbuf = buf;
+	return EOK;
+}
+
 static void bd_cb_conn(ipc_call_t *icall, void *arg)
 {
 	bd_t *bd = (bd_t *)arg;
@@ -33,6 +33,7 @@
  * @file
  * @brief Block device server stub
  */
+#include <as.h>
 #include <errno.h>
 #include <ipc/bd.h>
 #include <macros.h>
@@ -40,6 +41,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <bd.h>
 #include <bd_srv.h>
 
 static void bd_read_blocks_srv(bd_srv_t *srv, ipc_call_t *call)
@@ -60,6 +62,13 @@ static void bd_read_blocks_srv(bd_srv_t *srv, ipc_call_t *call)
 		return;
 	}
 
+	if (srv->srvs->ops->read_blocks_fwd != NULL) {
+		/* Server forwards the data transfer itself */
+		rc = srv->srvs->ops->read_blocks_fwd(srv, ba, cnt, &rcall, size);
+		async_answer_0(call, rc);
+		return;
+	}
+
 	buf = malloc(size);
 	if (buf == NULL) {
 		async_answer_0(&rcall, ENOMEM);
@@ -88,6 +97,164 @@ static void bd_read_blocks_srv(bd_srv_t *srv, ipc_call_t *call)
 	async_answer_0(call, EOK);
 }
 
+/** Receive extent list of a vectored request.
+ *
+ * @param next Number of extents
+ * @param rext Place to store pointer to newly allocated extent array
+ * @return EOK on success or an error code
+ */
+static errno_t bd_extents_receive(size_t next, bd_extent_t **rext)
+{
+	void *data;
+	size_t size;
+	errno_t rc;
+
+	if (next == 0 || next > BD_EXTENTS_MAX) {
+		async_data_write_void(EINVAL);
+		return EINVAL;
+	}
+
+	rc = async_data_write_accept(&data, false, next * sizeof(bd_extent_t),
+	    next * sizeof(bd_extent_t), 0, &size);
+	if (rc != EOK)
+		return rc;
+
+	*rext = (bd_extent_t *) data;
+	return EOK;
+}
+
+/** Emulate vectored read using read_blocks. */
+static errno_t bd_read_blocks_v_emul(bd_srv_t *srv, const bd_extent_t *ext,
+    size_t next, void *buf, size_t size)
+{
+	size_t bsize;
+	size_t tsize;
+	size_t xsize;
+	size_t i;
+	errno_t rc;
+
+	if (srv->srvs->ops->read_blocks == NULL ||
+	    srv->srvs->ops->get_block_size == NULL)
+		return ENOTSUP;
+
+	rc = srv->srvs->ops->get_block_size(srv, &bsize);
+	if (rc != EOK)
+		return rc;
+
+	rc = bd_extents_size(ext, next, bsize, &tsize);
+	if (rc != EOK || tsize != size)
+		return EINVAL;
+
+	for (i = 0; i < next; i++) {
+		xsize = ext[i].cnt * bsize;
+		rc = srv->srvs->ops->read_blocks(srv, ext[i].ba, ext[i].cnt,
+		    buf, xsize);
+		if (rc != EOK)
+			return rc;
+
+		buf += xsize;
+	}
+
+	return EOK;
+}
+
+/** Emulate vectored write using write_blocks. */
+static errno_t bd_write_blocks_v_emul(bd_srv_t *srv, const bd_extent_t *ext,
+    size_t next, const void *buf, size_t size)
+{
+	size_t bsize;
+	size_t tsize;
+	size_t xsize;
+	size_t i;
+	errno_t rc;
+
+	if (srv->srvs->ops->write_blocks == NULL ||
+	    srv->srvs->ops->get_block_size == NULL)
+		return ENOTSUP;
+
+	rc = srv->srvs->ops->get_block_size(srv, &bsize);
+	if (rc != EOK)
+		return rc;
+
+	rc = bd_extents_size(ext, next, bsize, &tsize);
+	if (rc != EOK || tsize != size)
+		return EINVAL;
+
+	for (i = 0; i < next; i++) {
+		xsize = ext[i].cnt * bsize;
+		rc = srv->srvs->ops->write_blocks(srv, ext[i].ba, ext[i].cnt,
+		    buf, xsize);
+		if (rc != EOK)
+			return rc;
+
+		buf += xsize;
+	}
+
+	return EOK;
+}
+
+static void bd_read_blocks_v_srv(bd_srv_t *srv, ipc_call_t *call)
+{
+	bd_extent_t *ext;
+	size_t next;
+	void *buf;
+	size_t size;
+	errno_t rc;
+
+	next = ipc_get_arg1(call);
+
+	rc = bd_extents_receive(next, &ext);
+	if (rc != EOK) {
+		async_answer_0(call, rc);
+		return;
+	}
+
+	ipc_call_t rcall;
+	if (!async_data_read_receive(&rcall, &size)) {
+		free(ext);
+		async_answer_0(&rcall, EINVAL);
+		async_answer_0(call, EINVAL);
+		return;
+	}
+
+	if (srv->srvs->ops->read_blocks_v_fwd != NULL) {
+		/* Server forwards the data transfer itself */
+		rc = srv->srvs->ops->read_blocks_v_fwd(srv, ext, next, &rcall,
+		    size);
+		free(ext);
+		async_answer_0(call, rc);
+		return;
+	}
+
+	buf = malloc(size);
+	if (buf == NULL) {
+		free(ext);
+		async_answer_0(&rcall, ENOMEM);
+		async_answer_0(call, ENOMEM);
+		return;
+	}
+
+	if (srv->srvs->ops->read_blocks_v != NULL) {
+		rc = srv->srvs->ops->read_blocks_v(srv, ext, next, buf, size);
+	} else {
+		rc = bd_read_blocks_v_emul(srv, ext, next, buf, size);
+	}
+
+	free(ext);
+
+	if (rc != EOK) {
+		async_answer_0(&rcall, rc);
+		async_answer_0(call, rc);
+		free(buf);
+		return;
+	}
+
+	async_data_read_finalize(&rcall, buf, size);
+
+	free(buf);
+	async_answer_0(call, EOK);
+}
+
 static void bd_read_toc_srv(bd_srv_t *srv, ipc_call_t *call)
 {
 	uint8_t session;
@@ -161,13 +328,36 @@ static void bd_write_blocks_srv(bd_srv_t *srv, ipc_call_t *call)
 	ba = MERGE_LOUP32(ipc_get_arg1(call), ipc_get_arg2(call));
 	cnt = ipc_get_arg3(call);
 
-	rc = async_data_write_accept(&data, false, 0, 0, 0, &size);
+	ipc_call_t wcall;
+	if (!async_data_write_receive(&wcall, &size)) {
+		async_answer_0(&wcall, EINVAL);
+		async_answer_0(call, EINVAL);
+		return;
+	}
+
+	if (srv->srvs->ops->write_blocks_fwd != NULL) {
+		/* Server forwards the data transfer itself */
+		rc = srv->srvs->ops->write_blocks_fwd(srv, ba, cnt, &wcall, size);
+		async_answer_0(call, rc);
+		return;
+	}
+
+	data = malloc(size);
+	if (data == NULL) {
+		async_answer_0(&wcall, ENOMEM);
+		async_answer_0(call, ENOMEM);
+		return;
+	}
+
+	rc = async_data_write_finalize(&wcall, data, size);
 	if (rc != EOK) {
+		free(data);
 		async_answer_0(call, rc);
 		return;
 	}
 
 	if (srv->srvs->ops->write_blocks == NULL) {
+		free(data);
 		async_answer_0(call, ENOTSUP);
 		return;
 	}
@@ -177,18 +367,84 @@ static void bd_write_blocks_srv(bd_srv_t *srv, ipc_call_t *call)
 	async_answer_0(call, rc);
 }
 
+static void bd_write_blocks_v_srv(bd_srv_t *srv, ipc_call_t *call)
+{
+	bd_extent_t *ext;
+	size_t next;
+	void *data;
+	size_t size;
+	errno_t rc;
+
+	next = ipc_get_arg1(call);
+
+	rc = bd_extents_receive(next, &ext);
+	if (rc != EOK) {
+		async_answer_0(call, rc);
+		return;
+	}
+
+	ipc_call_t wcall;
+	if (!async_data_write_receive(&wcall, &size)) {
+		free(ext);
+		async_answer_0(&wcall, EINVAL);
+		async_answer_0(call, EINVAL);
+		return;
+	}
+
+	if (srv->srvs->ops->write_blocks_v_fwd != NULL) {
+		/* Server forwards the data transfer itself */
+		rc = srv->srvs->ops->write_blocks_v_fwd(srv, ext, next, &wcall,
+		    size);
+		free(ext);
+		async_answer_0(call, rc);
+		return;
+	}
+
+	data = malloc(size);
+	if (data == NULL) {
+		free(ext);
+		async_answer_0(&wcall, ENOMEM);
+		async_answer_0(call, ENOMEM);
+		return;
+	}
+
+	rc = async_data_write_finalize(&wcall, data, size);
+	if (rc != EOK) {
+		free(ext);
+		free(data);
+		async_answer_0(call, rc);
+		return;
+	}
+
+	if (srv->srvs->ops->write_blocks_v != NULL) {
+		rc = srv->srvs->ops->write_blocks_v(srv, ext, next, data,
+		    size);
+	} else {
+		rc = bd_write_blocks_v_emul(srv, ext, next, data, size);
+	}
+
+	free(ext);
+	free(data);
+	async_answer_0(call, rc);
+}
+
 static void bd_get_block_size_srv(bd_srv_t *srv, ipc_call_t *call)
 {
 	errno_t rc;
 	size_t block_size;
+	unsigned caps;
 
 	if (srv->srvs->ops->get_block_size == NULL) {
 		async_answer_0(call, ENOTSUP);
 		return;
 	}
 
+	caps = 0;
+	if (srv->srvs->ops->map != NULL)
+		caps |= BD_CAP_MAP;
+
 	rc = srv->srvs->ops->get_block_size(srv, &block_size);
-	async_answer_1(call, rc, block_size);
+	async_answer_2(call, rc, block_size, caps);
 }
 
 static void bd_get_num_blocks_srv(bd_srv_t *srv, ipc_call_t *call)
@@ -218,6 +474,44 @@ static void bd_eject_srv(bd_srv_t *srv, ipc_call_t *call)
 	async_answer_0(call, rc);
 }
 
+static void bd_map_srv(bd_srv_t *srv, ipc_call_t *call)
+{
+	void *area;
+	size_t area_size;
+	size_t size;
+	errno_t rc;
+
+	ipc_call_t scall;
+	if (!async_share_in_receive(&scall, &size)) {
+		async_answer_0(&scall, EINVAL);
+		async_answer_0(call, EINVAL);
+		return;
+	}
+
+	if (srv->srvs->ops->map == NULL) {
+		async_answer_0(&scall, ENOTSUP);
+		async_answer_0(call, ENOTSUP);
+		return;
+	}
+
+	rc = srv->srvs->ops->map(srv, &area, &area_size);
+	if (rc != EOK) {
+		async_answer_0(&scall, rc);
+		async_answer_0(call, rc);
+		return;
+	}
+
+	if (size != area_size) {
+		async_answer_0(&scall, EINVAL);
+		async_answer_0(call, EINVAL);
+		return;
+	}
+
+	rc = async_share_in_finalize(&scall, area, AS_AREA_READ |
+	    AS_AREA_WRITE | AS_AREA_CACHEABLE);
+	async_answer_0(call, rc);
+}
+
 static bd_srv_t *bd_srv_create(bd_srvs_t *srvs)
 {
 	bd_srv_t *srv;
@@ -291,6 +585,15 @@ errno_t bd_conn(ipc_call_t *icall, bd_srvs_t *srvs)
 		case BD_EJECT:
 			bd_eject_srv(srv, &call);
 			break;
+		case BD_READ_BLOCKS_V:
+			bd_read_blocks_v_srv(srv, &call);
+			break;
+		case BD_WRITE_BLOCKS_V:
+			bd_write_blocks_v_srv(srv, &call);
+			break;
+		case BD_MAP:
+			bd_map_srv(srv, &call);
+			break;
 		default:
 			async_answer_0(&call, EINVAL);
 		}
@@ -85,7 +85,8 @@ typedef enum {
 	NIC_OFFLOAD_SET,
 	NIC_POLL_GET_MODE,
 	NIC_POLL_SET_MODE,
-	NIC_POLL_NOW
+	NIC_POLL_NOW,
+	NIC_PBUF_POOL_SHARE
 } nic_funcs_t;
 
 /** Send frame from NIC
@@ -1335,6 +1336,36 @@ errno_t nic_poll_now(async_sess_t *dev_sess)
 	return rc;
 }
 
+/** Map the packet buffer pool into which the NIC receives frames.
+ *
+ * After the pool is mapped, the driver delivers received frames
+ * using NIC_EV_RECEIVED_PBUF instead of copying them.
+ *
+ * @param[in]  dev_sess
+ * @param[out] rpool    Place to store pointer to the pool
+ *
+ * @return EOK If the operation was successfully completed
+ * @return ENOTSUP If the driver does not use a packet buffer pool
+ *
+ */
+errno_t nic_pbuf_pool_import(async_sess_t *dev_sess, pbuf_pool_t **rpool)
+{
+	sysarg_t size;
+	sysarg_t id_lo;
+	sysarg_t id_hi;
+
+	async_exch_t *exch = async_exchange_begin(dev_sess);
+	errno_t rc = async_req_1_3(exch, DEV_IFACE_ID(NIC_DEV_IFACE),
+	    NIC_PBUF_POOL_SHARE, &size, &id_lo, &id_hi);
+	if (rc == EOK) {
+		rc = pbuf_pool_import(exch, MERGE_LOUP32(id_lo, id_hi), size,
+		    rpool);
+	}
+	async_exchange_end(exch);
+
+	return rc;
+}
+
 static void remote_nic_send_frame(ddf_fun_t *dev, void *iface,
     ipc_call_t *call)
 {
@@ -2485,6 +2516,27 @@ static void remote_nic_poll_now(ddf_fun_t *dev, void *iface,
 	async_answer_0(call, rc);
 }
 
+static void remote_nic_pbuf_pool_share(ddf_fun_t *dev, void *iface,
+    ipc_call_t *call)
+{
+	nic_iface_t *nic_iface = (nic_iface_t *) iface;
+	pbuf_pool_t *pool;
+
+	if (nic_iface->pbuf_pool_get == NULL) {
+		async_answer_0(call, ENOTSUP);
+		return;
+	}
+
+	errno_t rc = nic_iface->pbuf_pool_get(dev, &pool);
+	if (rc != EOK) {
+		async_answer_0(call, rc);
+		return;
+	}
+
+	/* The client only receives frames */
+	pbuf_pool_export(call, pool, false);
+}
+
 /** Remote NIC interface operations.
  *
  */
@@ -2529,7 +2581,8 @@ static const remote_iface_func_ptr_t remote_nic_iface_ops[] = {
 	[NIC_OFFLOAD_SET] = remote_nic_offload_set,
 	[NIC_POLL_GET_MODE] = remote_nic_poll_get_mode,
 	[NIC_POLL_SET_MODE] = remote_nic_poll_set_mode,
-	[NIC_POLL_NOW] = remote_nic_poll_now
+	[NIC_POLL_NOW] = remote_nic_poll_now,
+	[NIC_PBUF_POOL_SHARE] = remote_nic_pbuf_pool_share
 };
 
 /** Remote NIC interface structure.
@@ -36,15 +36,31 @@
 #define LIBDRV_NIC_IFACE_H_
 
 #include <async.h>
+#include <pbuf.h>
 #include <nic/nic.h>
 #include <ipc/common.h>
 
 typedef enum {
 	NIC_EV_ADDR_CHANGED = IPC_FIRST_USER_METHOD,
 	NIC_EV_RECEIVED,
-	NIC_EV_DEVICE_STATE
+	NIC_EV_DEVICE_STATE,
+	NIC_EV_RECEIVED_PBUF,
+	NIC_EV_RECEIVED_PBUF_BATCH
 } nic_event_t;
 
+/** Maximum number of frames delivered with NIC_EV_RECEIVED_PBUF_BATCH */
+#define NIC_RX_BATCH_MAX 64
+
+/** Frame descriptor passed with NIC_EV_RECEIVED_PBUF_BATCH */
+typedef struct {
+	/** Packet buffer ID */
+	pbuf_id_t id;
+	/** Offset of frame within the buffer */
+	size_t offs;
+	/** Frame size */
+	size_t size;
+} nic_pbuf_desc_t;
+
 extern errno_t nic_send_frame(async_sess_t *, void *, size_t);
 extern errno_t nic_callback_create(async_sess_t *, async_port_handler_t, void *);
 extern errno_t nic_get_state(async_sess_t *, nic_device_state_t *);
@@ -109,6 +125,8 @@ extern errno_t nic_poll_set_mode(async_sess_t *, nic_poll_mode_t,
     const struct timespec *);
 extern errno_t nic_poll_now(async_sess_t *);
 
+extern errno_t nic_pbuf_pool_import(async_sess_t *, pbuf_pool_t **);
+
 #endif
 
 /** @}
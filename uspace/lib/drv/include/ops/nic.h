@@ -38,6 +38,7 @@
 
 #include <ipc/services.h>
 #include <nic/nic.h>
+#include <pbuf.h>
 #include <time.h>
 #include "../ddf/driver.h"
 
@@ -107,6 +108,8 @@ typedef struct nic_iface {
 	errno_t (*poll_set_mode)(ddf_fun_t *, nic_poll_mode_t,
 	    const struct timespec *);
 	errno_t (*poll_now)(ddf_fun_t *);
+
+	errno_t (*pbuf_pool_get)(ddf_fun_t *, pbuf_pool_t **);
 } nic_iface_t;
 
 #endif
@@ -56,6 +56,7 @@ extern errno_t ext4_filesystem_put_block_group_ref(ext4_block_group_ref_t *);
 extern errno_t ext4_filesystem_get_inode_ref(ext4_filesystem_t *, uint32_t,
     ext4_inode_ref_t **);
 extern errno_t ext4_filesystem_put_inode_ref(ext4_inode_ref_t *);
+extern errno_t ext4_filesystem_flush_refs(ext4_filesystem_t *, bool);
 extern errno_t ext4_filesystem_alloc_inode(ext4_filesystem_t *, ext4_inode_ref_t **,
     int);
 extern errno_t ext4_filesystem_free_inode(ext4_inode_ref_t *);
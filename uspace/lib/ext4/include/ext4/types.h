@@ -35,7 +35,10 @@
 #ifndef LIBEXT4_TYPES_H_
 #define LIBEXT4_TYPES_H_
 
+#include <adt/hash_table.h>
+#include <adt/list.h>
 #include <block.h>
+#include <fibril_synch.h>
 
 /*
  * Structure of the super block
@@ -227,11 +230,94 @@ typedef struct ext4_superblock {
 	EXT4_FEATURE_RO_COMPAT_GDT_CSUM | \
 	EXT4_FEATURE_RO_COMPAT_EXTRA_ISIZE)
 
+/** Number of block preallocation windows per filesystem */
+#define EXT4_PREALLOC_SLOTS   16
+
+/** Number of blocks reserved when a regular file grows */
+#define EXT4_PREALLOC_BLOCKS  256
+
+/** Block preallocation window.
+ *
+ * Free blocks past the end of a regular file reserved in memory only,
+ * so that following appends can be satisfied without searching the
+ * bitmap and the file stays contiguous. Nothing is written to disk
+ * for them; if another allocation takes them first, the window is
+ * dropped.
+ */
+typedef struct {
+	/** I-node number owning the window or 0 if the slot is unused */
+	uint32_t inode;
+	/** First preallocated block */
+	uint32_t start;
+	/** Number of preallocated blocks */
+	uint32_t count;
+	/** Time of last use (for LRU replacement) */
+	uint32_t last_use;
+} ext4_prealloc_t;
+
+/** Number of unused i-node references kept cached per filesystem */
+#define EXT4_INODE_REF_CACHE_SIZE  512
+
+/** Number of unused block group references kept cached per filesystem */
+#define EXT4_BG_REF_CACHE_SIZE  128
+
+/** Number of i-nodes with cached extents per filesystem */
+#define EXT4_EXTENT_CACHE_INODES   16
+
+/** Number of extents cached per i-node */
+#define EXT4_EXTENT_CACHE_EXTENTS  32
+
+/** Cached mapping of continuous range of logical blocks */
+typedef struct {
+	/** First logical block */
+	uint32_t iblock;
+	/** Number of blocks */
+	uint32_t count;
+	/** Physical address of the first block */
+	uint64_t fblock;
+} ext4_extent_cache_range_t;
+
+/** Extent status cache of one i-node.
+ *
+ * Remembers extents found during extent tree lookups so that
+ * following lookups in the same extent need not walk the tree.
+ */
+typedef struct {
+	/** I-node number or 0 if the slot is unused */
+	uint32_t inode;
+	/** Time of last use (for LRU replacement) */
+	uint32_t last_use;
+	/** Number of valid ranges */
+	size_t nranges;
+	/** Non-overlapping ranges sorted by logical block */
+	ext4_extent_cache_range_t range[EXT4_EXTENT_CACHE_EXTENTS];
+} ext4_extent_cache_t;
+
 typedef struct ext4_filesystem {
 	service_id_t device;
 	ext4_superblock_t *superblock;
 	aoff64_t inode_block_limits[4];
 	aoff64_t inode_blocks_per_level[4];
+	/** Protects the preallocation windows */
+	fibril_mutex_t prealloc_lock;
+	ext4_prealloc_t prealloc[EXT4_PREALLOC_SLOTS];
+	uint32_t prealloc_clock;
+	ext4_extent_cache_t extent_cache[EXT4_EXTENT_CACHE_INODES];
+	uint32_t extent_cache_clock;
+	/** Incremented whenever cached extents are invalidated */
+	uint32_t extent_cache_gen;
+	/** Metadata journal or @c NULL if the file system has none */
+	struct ext4_journal *journal;
+	/** Cached i-node references hashed by index */
+	hash_table_t inode_refs;
+	/** Unused cached i-node references, least recently used first */
+	list_t inode_lru;
+	size_t inode_lru_count;
+	/** Cached block group references hashed by index */
+	hash_table_t bg_refs;
+	/** Unused cached block group references, least recently used first */
+	list_t bg_lru;
+	size_t bg_lru_count;
 } ext4_filesystem_t;
 
 /** Size of buffer for volume name. To hold 16 latin-1 chars encoded as UTF-8
@@ -278,6 +364,9 @@ typedef struct ext4_block_group_ref {
 	ext4_filesystem_t *fs;
 	uint32_t index;
 	bool dirty;
+	ht_link_t link;                   /* Link to ext4_filesystem_t.bg_refs */
+	link_t lru_link;                  /* Link to ext4_filesystem_t.bg_lru */
+	unsigned refcnt;                  /* Number of users of the reference */
 } ext4_block_group_ref_t;
 
 #define EXT4_MIN_BLOCK_GROUP_DESCRIPTOR_SIZE  32
@@ -393,6 +482,9 @@ typedef struct ext4_inode_ref {
 	ext4_filesystem_t *fs;
 	uint32_t index;         /* Index number of this inode */
 	bool dirty;
+	ht_link_t link;         /* Link to ext4_filesystem_t.inode_refs */
+	link_t lru_link;        /* Link to ext4_filesystem_t.inode_lru */
+	unsigned refcnt;        /* Number of users of the reference */
 } ext4_inode_ref_t;
 
 #define EXT4_DIRECTORY_FILENAME_LEN  255
@@ -537,6 +629,9 @@ typedef struct ext4_extent_path {
 
 #define EXT4_EXTENT_MAGIC  0xF30A
 
+/** Maximum length of an initialized extent, longer ones are uninitialized */
+#define EXT4_EXTENT_MAX_INIT_LEN  32768
+
 #define	EXT4_EXTENT_FIRST(header) \
 	((ext4_extent_t *) (((void *) (header)) + sizeof(ext4_extent_header_t)))
 
@@ -557,6 +652,90 @@ typedef struct ext4_hash_info {
 	const uint32_t *seed;
 } ext4_hash_info_t;
 
+/*
+ * Journal (jbd2) on-disk structures. All fields are big-endian.
+ */
+#define EXT4_JOURNAL_MAGIC  0xC03B3998
+
+#define EXT4_JOURNAL_DESCRIPTOR_BLOCK  1
+#define EXT4_JOURNAL_COMMIT_BLOCK      2
+#define EXT4_JOURNAL_SUPERBLOCK_V1     3
+#define EXT4_JOURNAL_SUPERBLOCK_V2     4
+#define EXT4_JOURNAL_REVOKE_BLOCK      5
+
+typedef struct ext4_journal_header {
+	uint32_t magic;
+	uint32_t blocktype;
+	uint32_t sequence;  /* Transaction ID */
+} ext4_journal_header_t;
+
+#define EXT4_JOURNAL_FEATURE_COMPAT_CHECKSUM        0x0001
+#define EXT4_JOURNAL_FEATURE_INCOMPAT_REVOKE        0x0001
+#define EXT4_JOURNAL_FEATURE_INCOMPAT_64BIT         0x0002
+#define EXT4_JOURNAL_FEATURE_INCOMPAT_ASYNC_COMMIT  0x0004
+#define EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V2       0x0008
+#define EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V3       0x0010
+
+/* Journal features which can be replayed */
+#define EXT4_JOURNAL_FEATURE_INCOMPAT_SUPP \
+	(EXT4_JOURNAL_FEATURE_INCOMPAT_REVOKE | \
+	EXT4_JOURNAL_FEATURE_INCOMPAT_64BIT | \
+	EXT4_JOURNAL_FEATURE_INCOMPAT_ASYNC_COMMIT | \
+	EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V2 | \
+	EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V3)
+
+typedef struct ext4_journal_superblock {
+	ext4_journal_header_t header;
+	uint32_t block_size;             /* Journal device block size */
+	uint32_t max_len;                /* Total blocks in journal file */
+	uint32_t first;                  /* First block of log information */
+	uint32_t sequence;               /* First commit ID expected in log */
+	uint32_t start;                  /* Block number of start of log */
+	uint32_t error;                  /* Error value, as set by abort */
+	uint32_t features_compatible;
+	uint32_t features_incompatible;
+	uint32_t features_read_only;
+	uint8_t uuid[16];                /* 128-bit uuid for journal */
+	uint32_t nr_users;               /* Nr of filesystems sharing log */
+	uint32_t dyn_super;              /* Blocknr of dynamic superblock copy */
+	uint32_t max_transaction;        /* Limit of journal blocks per trans */
+	uint32_t max_trans_data;         /* Limit of data blocks per trans */
+	uint8_t checksum_type;           /* Checksum type */
+	uint8_t padding2[3];
+	uint32_t num_fc_blocks;          /* Number of fast commit blocks */
+	uint32_t padding[41];
+	uint32_t checksum;               /* Checksum of the superblock */
+	uint8_t users[16 * 48];          /* IDs of all filesystems sharing log */
+} ext4_journal_superblock_t;
+
+/* Flags in a descriptor block tag */
+#define EXT4_JOURNAL_FLAG_ESCAPE     0x0001  /* Block was escaped in the log */
+#define EXT4_JOURNAL_FLAG_SAME_UUID  0x0002  /* UUID is not repeated */
+#define EXT4_JOURNAL_FLAG_DELETED    0x0004  /* Block deleted by transaction */
+#define EXT4_JOURNAL_FLAG_LAST_TAG   0x0008  /* Last tag in the block */
+
+typedef struct ext4_journal_block_tag {
+	uint32_t blocknr;
+	uint16_t checksum;
+	uint16_t flags;
+	uint32_t blocknr_high;  /* Only present with the 64bit feature */
+} ext4_journal_block_tag_t;
+
+typedef struct ext4_journal_block_tag3 {
+	uint32_t blocknr;
+	uint32_t flags;
+	uint32_t blocknr_high;
+	uint32_t checksum;
+} ext4_journal_block_tag3_t;
+
+typedef struct ext4_journal_revoke_header {
+	ext4_journal_header_t header;
+	uint32_t count;  /* Number of bytes used in the block */
+} ext4_journal_revoke_header_t;
+
+/** Metadata journal of a mounted file system */
+typedef struct ext4_journal ext4_journal_t;
+
 #endif
 
 /**
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libext4
+ * @{
+ */
+/**
+ * @file Journal structure
+ *
+ */
+
+#ifndef LIBEXT4_PRIVATE_JOURNAL_H_
+#define LIBEXT4_PRIVATE_JOURNAL_H_
+
+#include <adt/hash_table.h>
+#include <adt/list.h>
+#include <fibril_synch.h>
+#include <loc.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "ext4/types.h"
+
+/** Continuous range of journal blocks */
+typedef struct {
+	/** First journal block */
+	uint32_t jblock;
+	/** File system address of the first block */
+	uint64_t fblock;
+	/** Number of blocks */
+	uint32_t count;
+} ext4_journal_run_t;
+
+/** Block in the running transaction */
+typedef struct {
+	ht_link_t link;
+	block_t *block;
+	/**
+	 * File data block. Data blocks are not logged, they are written
+	 * in place before the commit record (ordered mode).
+	 */
+	bool data;
+} ext4_journal_buf_t;
+
+/** Actual structure of journal.
+ *
+ * This is private to libext4.
+ */
+struct ext4_journal {
+	/** Link to journal_list */
+	link_t link;
+	ext4_filesystem_t *fs;
+	service_id_t service_id;
+	uint32_t block_size;
+	/** Number of device blocks per file system block */
+	size_t spb;
+	/** Mapping of journal blocks to file system blocks */
+	ext4_journal_run_t *runs;
+	size_t nruns;
+	/** Journal superblock (the whole block) */
+	void *sb_block;
+	uint32_t first;
+	uint32_t max_len;
+	uint32_t incompat;
+	/** Size of a descriptor block tag */
+	size_t tag_bytes;
+	/** Sequence number of the running transaction */
+	uint32_t sequence;
+	/** Number of blocks after which the transaction is committed */
+	size_t trans_max;
+
+	/** Protects the running transaction and the handle count */
+	fibril_mutex_t lock;
+	/** Signalled when handles finish or a commit takes the transaction */
+	fibril_condvar_t cv;
+	/** Serializes commits */
+	fibril_mutex_t commit_lock;
+	/** Number of operations in progress */
+	unsigned handles;
+	/** A commit is waiting for the running operations to finish */
+	bool locked;
+	/** The running transaction should be committed soon */
+	bool commit_request;
+	/** Blocks of the running transaction hashed by address */
+	hash_table_t running;
+	size_t running_count;
+	/** Commit interval timer */
+	fibril_timer_t *timer;
+	/** Commit interval timer is set and its handler has not started yet */
+	bool timer_armed;
+};
+
+extern errno_t ext4_journal_activate(ext4_journal_t *);
+extern errno_t ext4_journal_log(ext4_journal_t *, uint32_t, block_t **,
+    uint8_t *, size_t);
+extern errno_t ext4_journal_recover(ext4_journal_t *);
+
+#endif
+
+/** @}
+ */
@@ -36,6 +36,7 @@
  */
 
 #include <errno.h>
+#include <fibril_synch.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include "ext4/balloc.h"
@@ -43,6 +44,7 @@
 #include "ext4/block_group.h"
 #include "ext4/filesystem.h"
 #include "ext4/inode.h"
+#include "ext4/journal.h"
 #include "ext4/superblock.h"
 #include "ext4/types.h"
 
@@ -85,7 +87,7 @@ errno_t ext4_balloc_free_block(ext4_inode_ref_t *inode_ref, uint32_t block_addr)
 	bitmap_block->dirty = true;
 
 	/* Release block with bitmap */
-	rc = block_put(bitmap_block);
+	rc = ext4_block_put(bitmap_block);
 	if (rc != EOK) {
 		/* Error in saving bitmap */
 		ext4_filesystem_put_block_group_ref(bg_ref);
@@ -119,10 +121,21 @@ errno_t ext4_balloc_free_block(ext4_inode_ref_t *inode_ref, uint32_t block_addr)
 	return ext4_filesystem_put_block_group_ref(bg_ref);
 }
 
-static errno_t ext4_balloc_free_blocks_internal(ext4_inode_ref_t *inode_ref,
+/** Release run of blocks lying in one block group.
+ *
+ * The blocks are marked as free in the bitmap and the free blocks
+ * counters are updated. Block count of any i-node is not changed.
+ *
+ * @param fs    Filesystem
+ * @param first First block to release
+ * @param count Number of blocks to release
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_balloc_release_run(ext4_filesystem_t *fs,
     uint32_t first, uint32_t count)
 {
-	ext4_filesystem_t *fs = inode_ref->fs;
 	ext4_superblock_t *sb = fs->superblock;
 
 	/* Compute indexes */
@@ -158,28 +171,19 @@ static errno_t ext4_balloc_free_blocks_internal(ext4_inode_ref_t *inode_ref,
 	bitmap_block->dirty = true;
 
 	/* Release block with bitmap */
-	rc = block_put(bitmap_block);
+	rc = ext4_block_put(bitmap_block);
 	if (rc != EOK) {
 		/* Error in saving bitmap */
 		ext4_filesystem_put_block_group_ref(bg_ref);
 		return rc;
 	}
 
-	uint32_t block_size = ext4_superblock_get_block_size(sb);
-
 	/* Update superblock free blocks count */
 	uint32_t sb_free_blocks =
 	    ext4_superblock_get_free_blocks_count(sb);
 	sb_free_blocks += count;
 	ext4_superblock_set_free_blocks_count(sb, sb_free_blocks);
 
-	/* Update inode blocks count */
-	uint64_t ino_blocks =
-	    ext4_inode_get_blocks_count(sb, inode_ref->inode);
-	ino_blocks -= count * (block_size / EXT4_INODE_BLOCK_SIZE);
-	ext4_inode_set_blocks_count(sb, inode_ref->inode, ino_blocks);
-	inode_ref->dirty = true;
-
 	/* Update block group free blocks count */
 	uint32_t free_blocks =
 	    ext4_block_group_get_free_blocks_count(bg_ref->block_group, sb);
@@ -192,6 +196,27 @@ static errno_t ext4_balloc_free_blocks_internal(ext4_inode_ref_t *inode_ref,
 	return ext4_filesystem_put_block_group_ref(bg_ref);
 }
 
+static errno_t ext4_balloc_free_blocks_internal(ext4_inode_ref_t *inode_ref,
+    uint32_t first, uint32_t count)
+{
+	ext4_superblock_t *sb = inode_ref->fs->superblock;
+
+	errno_t rc = ext4_balloc_release_run(inode_ref->fs, first, count);
+	if (rc != EOK)
+		return rc;
+
+	uint32_t block_size = ext4_superblock_get_block_size(sb);
+
+	/* Update inode blocks count */
+	uint64_t ino_blocks =
+	    ext4_inode_get_blocks_count(sb, inode_ref->inode);
+	ino_blocks -= count * (block_size / EXT4_INODE_BLOCK_SIZE);
+	ext4_inode_set_blocks_count(sb, inode_ref->inode, ino_blocks);
+	inode_ref->dirty = true;
+
+	return EOK;
+}
+
 /** Free continuous set of blocks.
  *
  * @param inode_ref Inode, where the blocks are allocated
@@ -312,7 +337,7 @@ static errno_t ext4_balloc_find_goal(ext4_inode_ref_t *inode_ref, uint32_t *goal
 		if (rc != EOK)
 			return rc;
 
-		if (goal != 0) {
+		if (*goal != 0) {
 			(*goal)++;
 			return EOK;
 		}
@@ -405,7 +430,7 @@ errno_t ext4_balloc_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t *fblock)
 	if (ext4_bitmap_is_free_bit(bitmap_block->data, index_in_group)) {
 		ext4_bitmap_set_bit(bitmap_block->data, index_in_group);
 		bitmap_block->dirty = true;
-		rc = block_put(bitmap_block);
+		rc = ext4_block_put(bitmap_block);
 		if (rc != EOK) {
 			ext4_filesystem_put_block_group_ref(bg_ref);
 			return rc;
@@ -431,7 +456,7 @@ errno_t ext4_balloc_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t *fblock)
 		if (ext4_bitmap_is_free_bit(bitmap_block->data, tmp_idx)) {
 			ext4_bitmap_set_bit(bitmap_block->data, tmp_idx);
 			bitmap_block->dirty = true;
-			rc = block_put(bitmap_block);
+			rc = ext4_block_put(bitmap_block);
 			if (rc != EOK)
 				return rc;
 
@@ -448,7 +473,7 @@ errno_t ext4_balloc_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t *fblock)
 	    index_in_group, &rel_block_idx, blocks_in_group);
 	if (rc == EOK) {
 		bitmap_block->dirty = true;
-		rc = block_put(bitmap_block);
+		rc = ext4_block_put(bitmap_block);
 		if (rc != EOK)
 			return rc;
 
@@ -464,7 +489,7 @@ errno_t ext4_balloc_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t *fblock)
 	    index_in_group, &rel_block_idx, blocks_in_group);
 	if (rc == EOK) {
 		bitmap_block->dirty = true;
-		rc = block_put(bitmap_block);
+		rc = ext4_block_put(bitmap_block);
 		if (rc != EOK)
 			return rc;
 
@@ -476,7 +501,7 @@ errno_t ext4_balloc_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t *fblock)
 	}
 
 	/* No free block found yet */
-	rc = block_put(bitmap_block);
+	rc = ext4_block_put(bitmap_block);
 	if (rc != EOK) {
 		ext4_filesystem_put_block_group_ref(bg_ref);
 		return rc;
@@ -536,7 +561,7 @@ goal_failed:
 		    index_in_group, &rel_block_idx, blocks_in_group);
 		if (rc == EOK) {
 			bitmap_block->dirty = true;
-			rc = block_put(bitmap_block);
+			rc = ext4_block_put(bitmap_block);
 			if (rc != EOK) {
 				ext4_filesystem_put_block_group_ref(bg_ref);
 				return rc;
@@ -554,7 +579,7 @@ goal_failed:
 		    index_in_group, &rel_block_idx, blocks_in_group);
 		if (rc == EOK) {
 			bitmap_block->dirty = true;
-			rc = block_put(bitmap_block);
+			rc = ext4_block_put(bitmap_block);
 			if (rc != EOK) {
 				ext4_filesystem_put_block_group_ref(bg_ref);
 				return rc;
@@ -567,7 +592,7 @@ goal_failed:
 			goto success;
 		}
 
-		rc = block_put(bitmap_block);
+		rc = ext4_block_put(bitmap_block);
 		if (rc != EOK) {
 			ext4_filesystem_put_block_group_ref(bg_ref);
 			return rc;
@@ -662,7 +687,7 @@ errno_t ext4_balloc_try_alloc_block(ext4_inode_ref_t *inode_ref, uint32_t fblock
 	}
 
 	/* Release block with bitmap */
-	rc = block_put(bitmap_block);
+	rc = ext4_block_put(bitmap_block);
 	if (rc != EOK) {
 		/* Error in saving bitmap */
 		ext4_filesystem_put_block_group_ref(bg_ref);
@@ -699,6 +724,423 @@ terminate:
 	return ext4_filesystem_put_block_group_ref(bg_ref);
 }
 
+/** Allocate run of blocks in one block group.
+ *
+ * The bitmap is searched once for the first free block at or after
+ * @a index and as many following free blocks as possible (up to @a want).
+ * Only the first @a claim blocks of the run are allocated, the rest
+ * is left free.
+ *
+ * @param fs     Filesystem
+ * @param bgid   Index of block group
+ * @param index  Index in group where the search starts
+ * @param want   Maximum length of the run
+ * @param claim  Maximum number of blocks to allocate
+ * @param fblock Output value - first block of the run
+ * @param count  Output value - length of the run
+ *
+ * @return EOK on success, ENOSPC if the group has no free block
+ *         or another error code
+ *
+ */
+static errno_t ext4_balloc_alloc_run_in_group(ext4_filesystem_t *fs,
+    uint32_t bgid, uint32_t index, uint32_t want, uint32_t claim,
+    uint32_t *fblock, uint32_t *count)
+{
+	ext4_superblock_t *sb = fs->superblock;
+	uint32_t rel_block_idx;
+	uint32_t run;
+	uint32_t claimed = 0;
+
+	/* Load block group reference */
+	ext4_block_group_ref_t *bg_ref;
+	errno_t rc = ext4_filesystem_get_block_group_ref(fs, bgid, &bg_ref);
+	if (rc != EOK)
+		return rc;
+
+	uint32_t free_blocks =
+	    ext4_block_group_get_free_blocks_count(bg_ref->block_group, sb);
+	if (free_blocks == 0) {
+		/* This group has no free blocks */
+		ext4_filesystem_put_block_group_ref(bg_ref);
+		return ENOSPC;
+	}
+
+	/* Compute indexes */
+	uint32_t first_in_group =
+	    ext4_balloc_get_first_data_block_in_group(sb, bg_ref);
+	uint32_t first_in_group_index =
+	    ext4_filesystem_blockaddr2_index_in_group(sb, first_in_group);
+	uint32_t blocks_in_group = ext4_superblock_get_blocks_in_group(sb, bgid);
+
+	if (index < first_in_group_index)
+		index = first_in_group_index;
+
+	/* Load block with bitmap */
+	uint32_t bitmap_block_addr =
+	    ext4_block_group_get_block_bitmap(bg_ref->block_group, sb);
+
+	block_t *bitmap_block;
+	rc = block_get(&bitmap_block, fs->device, bitmap_block_addr,
+	    BLOCK_FLAGS_NONE);
+	if (rc != EOK) {
+		ext4_filesystem_put_block_group_ref(bg_ref);
+		return rc;
+	}
+
+	/* Find the run and mark its beginning as used */
+	rc = ext4_bitmap_find_free_run(bitmap_block->data, index,
+	    blocks_in_group, want, &rel_block_idx, &run);
+	if (rc == EOK) {
+		claimed = min(run, claim);
+		ext4_bitmap_set_bits(bitmap_block->data, rel_block_idx,
+		    claimed);
+		bitmap_block->dirty = true;
+	}
+
+	errno_t rc2 = ext4_block_put(bitmap_block);
+	if (rc == EOK)
+		rc = rc2;
+	if (rc != EOK) {
+		ext4_filesystem_put_block_group_ref(bg_ref);
+		return rc;
+	}
+
+	/* Update superblock free blocks count */
+	uint32_t sb_free_blocks = ext4_superblock_get_free_blocks_count(sb);
+	sb_free_blocks -= claimed;
+	ext4_superblock_set_free_blocks_count(sb, sb_free_blocks);
+
+	/* Update block group free blocks count */
+	free_blocks -= claimed;
+	ext4_block_group_set_free_blocks_count(bg_ref->block_group, sb,
+	    free_blocks);
+	bg_ref->dirty = true;
+
+	*fblock = ext4_filesystem_index_in_group2blockaddr(sb, rel_block_idx,
+	    bgid);
+	*count = run;
+
+	return ext4_filesystem_put_block_group_ref(bg_ref);
+}
+
+/** Allocate run of blocks near goal.
+ *
+ * The block group of the goal is searched first (starting at the goal),
+ * then all other block groups in turn.
+ *
+ * @param fs     Filesystem
+ * @param goal   Preferred first block
+ * @param want   Maximum length of the run
+ * @param claim  Maximum number of blocks to allocate
+ * @param fblock Output value - first block of the run
+ * @param count  Output value - length of the run (at least 1), the first
+ *               min(@a claim, @a count) blocks of it are allocated
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_balloc_alloc_run(ext4_filesystem_t *fs, uint32_t goal,
+    uint32_t want, uint32_t claim, uint32_t *fblock, uint32_t *count)
+{
+	ext4_superblock_t *sb = fs->superblock;
+	uint32_t block_group_count = ext4_superblock_get_block_group_count(sb);
+
+	/* Load block group number for goal and relative index */
+	uint32_t block_group = ext4_filesystem_blockaddr2group(sb, goal);
+	uint32_t index_in_group =
+	    ext4_filesystem_blockaddr2_index_in_group(sb, goal);
+
+	if (block_group >= block_group_count) {
+		/* Goal is past the end of the volume */
+		block_group = 0;
+		index_in_group = 0;
+	}
+
+	errno_t rc = ext4_balloc_alloc_run_in_group(fs, block_group,
+	    index_in_group, want, claim, fblock, count);
+	if (rc != ENOSPC)
+		return rc;
+
+	/* Try other block groups */
+	uint32_t bgid = (block_group + 1) % block_group_count;
+	for (uint32_t i = 1; i < block_group_count; ++i) {
+		rc = ext4_balloc_alloc_run_in_group(fs, bgid, 0, want,
+		    claim, fblock, count);
+		if (rc != ENOSPC)
+			return rc;
+
+		bgid = (bgid + 1) % block_group_count;
+	}
+
+	return ENOSPC;
+}
+
+/** Claim run of blocks at given address.
+ *
+ * Free blocks starting exactly at @a first are allocated, up to @a want
+ * of them. The run ends at the first used block or at the end of the
+ * block group.
+ *
+ * @param fs    Filesystem
+ * @param first First block to allocate
+ * @param want  Maximum number of blocks to allocate
+ * @param count Output value - number of allocated blocks
+ *
+ * @return EOK on success, ENOSPC if @a first is not free
+ *         or another error code
+ *
+ */
+static errno_t ext4_balloc_claim_run(ext4_filesystem_t *fs, uint32_t first,
+    uint32_t want, uint32_t *count)
+{
+	ext4_superblock_t *sb = fs->superblock;
+
+	/* Compute indexes */
+	uint32_t bgid = ext4_filesystem_blockaddr2group(sb, first);
+	uint32_t index = ext4_filesystem_blockaddr2_index_in_group(sb, first);
+	uint32_t blocks_in_group = ext4_superblock_get_blocks_in_group(sb, bgid);
+
+	uint32_t end = blocks_in_group;
+	if (want < end - index)
+		end = index + want;
+
+	/* Load block group reference */
+	ext4_block_group_ref_t *bg_ref;
+	errno_t rc = ext4_filesystem_get_block_group_ref(fs, bgid, &bg_ref);
+	if (rc != EOK)
+		return rc;
+
+	/* Load block with bitmap */
+	uint32_t bitmap_block_addr =
+	    ext4_block_group_get_block_bitmap(bg_ref->block_group, sb);
+
+	block_t *bitmap_block;
+	rc = block_get(&bitmap_block, fs->device, bitmap_block_addr,
+	    BLOCK_FLAGS_NONE);
+	if (rc != EOK) {
+		ext4_filesystem_put_block_group_ref(bg_ref);
+		return rc;
+	}
+
+	uint32_t idx = index;
+	while (idx < end && ext4_bitmap_is_free_bit(bitmap_block->data, idx))
+		idx++;
+
+	uint32_t run = idx - index;
+	if (run > 0) {
+		ext4_bitmap_set_bits(bitmap_block->data, index, run);
+		bitmap_block->dirty = true;
+	}
+
+	rc = ext4_block_put(bitmap_block);
+	if (rc == EOK && run == 0)
+		rc = ENOSPC;
+	if (rc != EOK) {
+		ext4_filesystem_put_block_group_ref(bg_ref);
+		return rc;
+	}
+
+	/* Update superblock free blocks count */
+	uint32_t sb_free_blocks = ext4_superblock_get_free_blocks_count(sb);
+	sb_free_blocks -= run;
+	ext4_superblock_set_free_blocks_count(sb, sb_free_blocks);
+
+	/* Update block group free blocks count */
+	uint32_t free_blocks =
+	    ext4_block_group_get_free_blocks_count(bg_ref->block_group, sb);
+	free_blocks -= run;
+	ext4_block_group_set_free_blocks_count(bg_ref->block_group, sb,
+	    free_blocks);
+	bg_ref->dirty = true;
+
+	*count = run;
+	return ext4_filesystem_put_block_group_ref(bg_ref);
+}
+
+/** Find preallocation window of an i-node.
+ *
+ * Must be called with the preallocation lock held.
+ *
+ * @param fs    Filesystem
+ * @param inode I-node number
+ *
+ * @return Preallocation window or NULL if the i-node has none
+ *
+ */
+static ext4_prealloc_t *ext4_balloc_prealloc_find(ext4_filesystem_t *fs,
+    uint32_t inode)
+{
+	assert(fibril_mutex_is_locked(&fs->prealloc_lock));
+
+	for (unsigned i = 0; i < EXT4_PREALLOC_SLOTS; ++i) {
+		if (fs->prealloc[i].inode == inode)
+			return &fs->prealloc[i];
+	}
+
+	return NULL;
+}
+
+/** Remember blocks reserved for an i-node.
+ *
+ * If there is no free slot, the least recently used window is
+ * dropped. Must be called with the preallocation lock held.
+ *
+ * @param fs    Filesystem
+ * @param inode I-node number
+ * @param start First reserved block
+ * @param count Number of reserved blocks
+ *
+ */
+static void ext4_balloc_prealloc_store(ext4_filesystem_t *fs,
+    uint32_t inode, uint32_t start, uint32_t count)
+{
+	ext4_prealloc_t *victim = &fs->prealloc[0];
+
+	assert(fibril_mutex_is_locked(&fs->prealloc_lock));
+
+	for (unsigned i = 0; i < EXT4_PREALLOC_SLOTS; ++i) {
+		ext4_prealloc_t *pa = &fs->prealloc[i];
+
+		if (pa->inode == 0) {
+			victim = pa;
+			break;
+		}
+
+		if (pa->last_use < victim->last_use)
+			victim = pa;
+	}
+
+	victim->inode = inode;
+	victim->start = start;
+	victim->count = count;
+	victim->last_use = ++fs->prealloc_clock;
+}
+
+/** Allocate continuous run of data blocks.
+ *
+ * Up to @a want blocks are allocated in one pass over the block
+ * bitmap. For regular files, free blocks following the allocated ones
+ * are reserved in memory. Following allocations continuing at the end
+ * of the file claim them first, so that the file stays contiguous
+ * and the bitmap need not be searched.
+ *
+ * @param inode_ref I-node to allocate blocks for
+ * @param goal      Preferred first block or 0 to compute it from the i-node
+ * @param want      Maximum number of blocks to allocate
+ * @param fblock    Output value - first allocated block
+ * @param count     Output value - number of allocated blocks (at least 1)
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_balloc_alloc_blocks(ext4_inode_ref_t *inode_ref, uint32_t goal,
+    uint32_t want, uint32_t *fblock, uint32_t *count)
+{
+	ext4_filesystem_t *fs = inode_ref->fs;
+	ext4_superblock_t *sb = fs->superblock;
+	uint32_t block_size;
+	uint32_t first;
+	uint32_t run;
+	errno_t rc;
+
+	assert(want > 0);
+
+	/* Find GOAL */
+	if (goal == 0) {
+		rc = ext4_balloc_find_goal(inode_ref, &goal);
+		if (rc != EOK)
+			return rc;
+	}
+
+	fibril_mutex_lock(&fs->prealloc_lock);
+
+	uint32_t request = want;
+	if (ext4_inode_is_type(sb, inode_ref->inode, EXT4_INODE_MODE_FILE)) {
+		ext4_prealloc_t *pa = ext4_balloc_prealloc_find(fs,
+		    inode_ref->index);
+		if (pa != NULL && pa->start == goal) {
+			/* Continue in the preallocation window */
+			rc = ext4_balloc_claim_run(fs, pa->start,
+			    min(want, pa->count), &run);
+			if (rc == EOK) {
+				first = pa->start;
+				pa->start += run;
+				pa->count -= run;
+				if (pa->count == 0)
+					pa->inode = 0;
+				else
+					pa->last_use = ++fs->prealloc_clock;
+
+				fibril_mutex_unlock(&fs->prealloc_lock);
+				goto success;
+			}
+
+			if (rc != ENOSPC) {
+				fibril_mutex_unlock(&fs->prealloc_lock);
+				return rc;
+			}
+
+			/* The reserved blocks have been allocated elsewhere */
+		}
+
+		/*
+		 * The file is not growing sequentially or the window
+		 * is gone, drop it.
+		 */
+		if (pa != NULL)
+			pa->inode = 0;
+
+		request = max(want, EXT4_PREALLOC_BLOCKS);
+	}
+
+	rc = ext4_balloc_alloc_run(fs, goal, request, want, &first, &run);
+	if (rc != EOK) {
+		fibril_mutex_unlock(&fs->prealloc_lock);
+		return rc;
+	}
+
+	if (run > want) {
+		/* Reserve the rest of the run for following allocations */
+		ext4_balloc_prealloc_store(fs, inode_ref->index,
+		    first + want, run - want);
+		run = want;
+	}
+
+	fibril_mutex_unlock(&fs->prealloc_lock);
+
+success:
+	block_size = ext4_superblock_get_block_size(sb);
+
+	/* Update inode blocks (different block size!) count */
+	uint64_t ino_blocks =
+	    ext4_inode_get_blocks_count(sb, inode_ref->inode);
+	ino_blocks += run * (block_size / EXT4_INODE_BLOCK_SIZE);
+	ext4_inode_set_blocks_count(sb, inode_ref->inode, ino_blocks);
+	inode_ref->dirty = true;
+
+	*fblock = first;
+	*count = run;
+	return EOK;
+}
+
+/** Discard preallocation window of an i-node.
+ *
+ * @param fs    Filesystem
+ * @param inode I-node number
+ *
+ */
+void ext4_balloc_discard_prealloc(ext4_filesystem_t *fs, uint32_t inode)
+{
+	fibril_mutex_lock(&fs->prealloc_lock);
+
+	ext4_prealloc_t *pa = ext4_balloc_prealloc_find(fs, inode);
+	if (pa != NULL)
+		pa->inode = 0;
+
+	fibril_mutex_unlock(&fs->prealloc_lock);
+}
+
 /**
  * @}
  */
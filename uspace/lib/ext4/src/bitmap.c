@@ -264,6 +264,102 @@ errno_t ext4_bitmap_find_free_bit_and_set(uint8_t *bitmap, uint32_t start_idx,
 	return ENOSPC;
 }
 
+/** Set range of bits as used.
+ *
+ * @param bitmap Pointer to bitmap
+ * @param index  Index of the first bit to set
+ * @param count  Number of bits to set
+ *
+ */
+void ext4_bitmap_set_bits(uint8_t *bitmap, uint32_t index, uint32_t count)
+{
+	uint32_t idx = index;
+	uint32_t remaining = count;
+
+	/* Set bits up to byte boundary */
+	while (((idx % 8) != 0) && (remaining > 0)) {
+		ext4_bitmap_set_bit(bitmap, idx);
+		idx++;
+		remaining--;
+	}
+
+	/* Set whole bytes */
+	uint8_t *target = bitmap + (idx / 8);
+	while (remaining >= 8) {
+		*target = 0xff;
+
+		idx += 8;
+		remaining -= 8;
+		target++;
+	}
+
+	/* Set remaining bits */
+	while (remaining > 0) {
+		ext4_bitmap_set_bit(bitmap, idx);
+		idx++;
+		remaining--;
+	}
+}
+
+/** Find run of free bits.
+ *
+ * Find the first free bit at or after @a start and determine how many
+ * free bits follow it (at most @a want), all in one pass. Fully used
+ * bytes are skipped as a whole. The bits are not modified.
+ *
+ * @param bitmap Pointer to bitmap
+ * @param start  Index of bit, where the algorithm will begin
+ * @param max    Maximum index of bit in bitmap
+ * @param want   Maximum length of the run
+ * @param index  Output value - index of first bit of the run
+ * @param count  Output value - length of the run (1 to @a want)
+ *
+ * @return EOK if free bit was found, ENOSPC otherwise
+ *
+ */
+errno_t ext4_bitmap_find_free_run(uint8_t *bitmap, uint32_t start,
+    uint32_t max, uint32_t want, uint32_t *index, uint32_t *count)
+{
+	uint32_t idx = start;
+
+	/* Find first free bit */
+	while (idx < max) {
+		if ((idx % 8) == 0 && bitmap[idx / 8] == 0xff) {
+			/* Skip fully used byte */
+			idx += 8;
+			continue;
+		}
+
+		if (ext4_bitmap_is_free_bit(bitmap, idx))
+			break;
+
+		idx++;
+	}
+
+	if (idx >= max)
+		return ENOSPC;
+
+	/* Extend the run */
+	uint32_t first = idx;
+	while (idx < max && idx - first < want) {
+		if ((idx % 8) == 0 && bitmap[idx / 8] == 0 &&
+		    idx + 8 <= max && idx - first + 8 <= want) {
+			/* Whole free byte */
+			idx += 8;
+			continue;
+		}
+
+		if (!ext4_bitmap_is_free_bit(bitmap, idx))
+			break;
+
+		idx++;
+	}
+
+	*index = first;
+	*count = idx - first;
+	return EOK;
+}
+
 /**
  * @}
  */
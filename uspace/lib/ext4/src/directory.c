@@ -44,6 +44,7 @@
 #include "ext4/directory_index.h"
 #include "ext4/filesystem.h"
 #include "ext4/inode.h"
+#include "ext4/journal.h"
 #include "ext4/superblock.h"
 
 /** Get i-node number from directory entry.
@@ -230,7 +231,7 @@ errno_t ext4_directory_iterator_seek(ext4_directory_iterator_t *it, aoff64_t pos
 	/* Are we at the end? */
 	if (pos >= size) {
 		if (it->current_block) {
-			errno_t rc = block_put(it->current_block);
+			errno_t rc = ext4_block_put(it->current_block);
 			it->current_block = NULL;
 
 			if (rc != EOK)
@@ -254,7 +255,7 @@ errno_t ext4_directory_iterator_seek(ext4_directory_iterator_t *it, aoff64_t pos
 	if ((it->current_block == NULL) ||
 	    (current_block_idx != next_block_idx)) {
 		if (it->current_block) {
-			errno_t rc = block_put(it->current_block);
+			errno_t rc = ext4_block_put(it->current_block);
 			it->current_block = NULL;
 
 			if (rc != EOK)
@@ -336,7 +337,7 @@ errno_t ext4_directory_iterator_fini(ext4_directory_iterator_t *it)
 	it->current = NULL;
 
 	if (it->current_block)
-		return block_put(it->current_block);
+		return ext4_block_put(it->current_block);
 
 	return EOK;
 }
@@ -437,7 +438,7 @@ errno_t ext4_directory_add_entry(ext4_inode_ref_t *parent, const char *name,
 		if (rc == EOK)
 			success = true;
 
-		rc = block_put(block);
+		rc = ext4_block_put(block);
 		if (rc != EOK)
 			return rc;
 
@@ -467,7 +468,7 @@ errno_t ext4_directory_add_entry(ext4_inode_ref_t *parent, const char *name,
 
 	/* Save new block */
 	new_block->dirty = true;
-	rc = block_put(new_block);
+	rc = ext4_block_put(new_block);
 
 	return rc;
 }
@@ -542,7 +543,7 @@ errno_t ext4_directory_find_entry(ext4_directory_search_result_t *result,
 
 		/* Entry not found - put block and continue to the next block */
 
-		rc = block_put(block);
+		rc = ext4_block_put(block);
 		if (rc != EOK)
 			return rc;
 	}
@@ -761,7 +762,7 @@ errno_t ext4_directory_find_in_block(block_t *block, ext4_superblock_t *sb,
 errno_t ext4_directory_destroy_result(ext4_directory_search_result_t *result)
 {
 	if (result->block)
-		return block_put(result->block);
+		return ext4_block_put(result->block);
 
 	return EOK;
 }
@@ -44,6 +44,7 @@
 #include "ext4/filesystem.h"
 #include "ext4/hash.h"
 #include "ext4/inode.h"
+#include "ext4/journal.h"
 #include "ext4/superblock.h"
 
 /** Type entry to pass to sorting algorithm.
@@ -278,14 +279,14 @@ errno_t ext4_directory_dx_init(ext4_inode_ref_t *dir)
 	uint32_t iblock;
 	rc = ext4_filesystem_append_inode_block(dir, &fblock, &iblock);
 	if (rc != EOK) {
-		block_put(block);
+		ext4_block_put(block);
 		return rc;
 	}
 
 	block_t *new_block;
 	rc = block_get(&new_block, dir->fs->device, fblock, BLOCK_FLAGS_NOREAD);
 	if (rc != EOK) {
-		block_put(block);
+		ext4_block_put(block);
 		return rc;
 	}
 
@@ -295,9 +296,9 @@ errno_t ext4_directory_dx_init(ext4_inode_ref_t *dir)
 	ext4_directory_entry_ll_set_inode(block_entry, 0);
 
 	new_block->dirty = true;
-	rc = block_put(new_block);
+	rc = ext4_block_put(new_block);
 	if (rc != EOK) {
-		block_put(block);
+		ext4_block_put(block);
 		return rc;
 	}
 
@@ -307,7 +308,7 @@ errno_t ext4_directory_dx_init(ext4_inode_ref_t *dir)
 
 	block->dirty = true;
 
-	return block_put(block);
+	return ext4_block_put(block);
 }
 
 /** Initialize hash info structure necessary for index operations.
@@ -462,7 +463,7 @@ static errno_t ext4_directory_dx_get_leaf(ext4_hash_info_t *hinfo,
 		entry_space = entry_space / sizeof(ext4_directory_dx_entry_t);
 
 		if (limit != entry_space) {
-			block_put(tmp_block);
+			ext4_block_put(tmp_block);
 			return EXT4_ERR_BAD_DX_DIR;
 		}
 
@@ -532,7 +533,7 @@ static errno_t ext4_directory_dx_next_block(ext4_inode_ref_t *inode_ref,
 		p++;
 
 		/* Don't forget to put old block (prevent memory leak) */
-		rc = block_put(p->block);
+		rc = ext4_block_put(p->block);
 		if (rc != EOK)
 			return rc;
 
@@ -579,7 +580,7 @@ errno_t ext4_directory_dx_find_entry(ext4_directory_search_result_t *result,
 	rc = ext4_directory_hinfo_init(&hinfo, root_block, fs->superblock,
 	    name_len, name);
 	if (rc != EOK) {
-		block_put(root_block);
+		ext4_block_put(root_block);
 		return EXT4_ERR_BAD_DX_DIR;
 	}
 
@@ -594,7 +595,7 @@ errno_t ext4_directory_dx_find_entry(ext4_directory_search_result_t *result,
 	rc = ext4_directory_dx_get_leaf(&hinfo, inode_ref, root_block,
 	    &dx_block, dx_blocks);
 	if (rc != EOK) {
-		block_put(root_block);
+		ext4_block_put(root_block);
 		return EXT4_ERR_BAD_DX_DIR;
 	}
 
@@ -628,7 +629,7 @@ errno_t ext4_directory_dx_find_entry(ext4_directory_search_result_t *result,
 		}
 
 		/* Not found, leave untouched */
-		rc2 = block_put(leaf_block);
+		rc2 = ext4_block_put(leaf_block);
 		if (rc2 != EOK)
 			goto cleanup;
 
@@ -651,7 +652,7 @@ cleanup:
 	tmp = dx_blocks;
 
 	while (tmp <= dx_block) {
-		rc2 = block_put(tmp->block);
+		rc2 = ext4_block_put(tmp->block);
 		if (rc == EOK && rc2 != EOK)
 			rc = rc2;
 		++tmp;
@@ -997,7 +998,7 @@ static errno_t ext4_directory_dx_split_index(ext4_inode_ref_t *inode_ref,
 			/* Finally insert new entry */
 			ext4_directory_dx_insert_entry(dx_blocks, hash_right, new_iblock);
 
-			return block_put(new_block);
+			return ext4_block_put(new_block);
 		} else {
 			/* Create second level index */
 
@@ -1070,7 +1071,7 @@ errno_t ext4_directory_dx_add_entry(ext4_inode_ref_t *parent,
 	rc = ext4_directory_hinfo_init(&hinfo, root_block, fs->superblock,
 	    name_len, name);
 	if (rc != EOK) {
-		block_put(root_block);
+		ext4_block_put(root_block);
 		return EXT4_ERR_BAD_DX_DIR;
 	}
 
@@ -1138,7 +1139,7 @@ errno_t ext4_directory_dx_add_entry(ext4_inode_ref_t *parent,
 		    child, name, name_len);
 
 	/* Cleanup */
-	rc = block_put(new_block);
+	rc = ext4_block_put(new_block);
 	if (rc != EOK)
 		return rc;
 
@@ -1147,7 +1148,7 @@ errno_t ext4_directory_dx_add_entry(ext4_inode_ref_t *parent,
 release_target_index:
 	rc2 = rc;
 
-	rc = block_put(target_block);
+	rc = ext4_block_put(target_block);
 	if (rc != EOK)
 		return rc;
 
@@ -1158,7 +1159,7 @@ release_index:
 	dx_it = dx_blocks;
 
 	while (dx_it <= dx_block) {
-		rc = block_put(dx_it->block);
+		rc = ext4_block_put(dx_it->block);
 		if (rc != EOK)
 			return rc;
 
@@ -41,6 +41,7 @@
 #include "ext4/balloc.h"
 #include "ext4/extent.h"
 #include "ext4/inode.h"
+#include "ext4/journal.h"
 #include "ext4/superblock.h"
 
 /** Get logical number of the block covered by extent.
@@ -360,6 +361,174 @@ static void ext4_extent_binsearch(ext4_extent_header_t *header,
 	*extent = l - 1;
 }
 
+/** Find extent cache of an i-node.
+ *
+ * @param fs    Filesystem
+ * @param inode I-node number
+ *
+ * @return Extent cache or NULL if the i-node has none
+ *
+ */
+static ext4_extent_cache_t *ext4_extent_cache_find(ext4_filesystem_t *fs,
+    uint32_t inode)
+{
+	for (unsigned i = 0; i < EXT4_EXTENT_CACHE_INODES; ++i) {
+		if (fs->extent_cache[i].inode == inode)
+			return &fs->extent_cache[i];
+	}
+
+	return NULL;
+}
+
+/** Find index of the first cached range not ending before iblock.
+ *
+ * @param cache  Extent cache
+ * @param iblock Logical block number
+ *
+ * @return Index of the range (nranges if there is none)
+ *
+ */
+static size_t ext4_extent_cache_search(ext4_extent_cache_t *cache,
+    uint32_t iblock)
+{
+	size_t l = 0;
+	size_t r = cache->nranges;
+
+	while (l < r) {
+		size_t m = l + (r - l) / 2;
+		ext4_extent_cache_range_t *range = &cache->range[m];
+
+		if ((uint64_t) range->iblock + range->count <= iblock)
+			l = m + 1;
+		else
+			r = m;
+	}
+
+	return l;
+}
+
+/** Look up logical block in the extent cache.
+ *
+ * @param inode_ref I-node to look up block of
+ * @param iblock    Logical block number
+ * @param fblock    Output value for physical block number
+ *
+ * @return True if the block was found in the cache
+ *
+ */
+static bool ext4_extent_cache_lookup(ext4_inode_ref_t *inode_ref,
+    uint32_t iblock, uint32_t *fblock)
+{
+	ext4_filesystem_t *fs = inode_ref->fs;
+	ext4_extent_cache_t *cache = ext4_extent_cache_find(fs,
+	    inode_ref->index);
+	if (cache == NULL)
+		return false;
+
+	size_t i = ext4_extent_cache_search(cache, iblock);
+	if (i >= cache->nranges || cache->range[i].iblock > iblock)
+		return false;
+
+	cache->last_use = ++fs->extent_cache_clock;
+	*fblock = cache->range[i].fblock + (iblock - cache->range[i].iblock);
+	return true;
+}
+
+/** Insert extent to the extent cache.
+ *
+ * Ranges overlapping the new one are replaced by it. If the cache
+ * of the i-node is full, it is emptied first. If the i-node has no
+ * cache, the least recently used one is taken over.
+ *
+ * @param inode_ref I-node owning the extent
+ * @param iblock    First logical block of the extent
+ * @param count     Number of blocks in the extent
+ * @param fblock    First physical block of the extent
+ *
+ */
+static void ext4_extent_cache_insert(ext4_inode_ref_t *inode_ref,
+    uint32_t iblock, uint32_t count, uint64_t fblock)
+{
+	ext4_filesystem_t *fs = inode_ref->fs;
+	ext4_extent_cache_t *cache = ext4_extent_cache_find(fs,
+	    inode_ref->index);
+
+	if (cache == NULL) {
+		cache = &fs->extent_cache[0];
+		for (unsigned i = 0; i < EXT4_EXTENT_CACHE_INODES; ++i) {
+			ext4_extent_cache_t *c = &fs->extent_cache[i];
+
+			if (c->inode == 0) {
+				cache = c;
+				break;
+			}
+
+			if (c->last_use < cache->last_use)
+				cache = c;
+		}
+
+		cache->inode = inode_ref->index;
+		cache->nranges = 0;
+	}
+
+	cache->last_use = ++fs->extent_cache_clock;
+
+	/* Find ranges overlapping the new one */
+	size_t first = ext4_extent_cache_search(cache, iblock);
+	size_t last = first;
+	while (last < cache->nranges &&
+	    cache->range[last].iblock < (uint64_t) iblock + count)
+		last++;
+
+	if (first == last && cache->nranges == EXT4_EXTENT_CACHE_EXTENTS) {
+		/* Cache is full */
+		cache->nranges = 0;
+		first = last = 0;
+	}
+
+	/* Replace ranges first..last-1 with the new one */
+	if (last != first + 1) {
+		memmove(&cache->range[first + 1], &cache->range[last],
+		    (cache->nranges - last) * sizeof(ext4_extent_cache_range_t));
+		cache->nranges = cache->nranges + 1 - (last - first);
+	}
+
+	cache->range[first].iblock = iblock;
+	cache->range[first].count = count;
+	cache->range[first].fblock = fblock;
+}
+
+/** Invalidate cached extents of an i-node from logical block on.
+ *
+ * @param inode_ref   I-node to invalidate cached extents of
+ * @param iblock_from First logical block to invalidate
+ *
+ */
+static void ext4_extent_cache_invalidate(ext4_inode_ref_t *inode_ref,
+    uint32_t iblock_from)
+{
+	ext4_filesystem_t *fs = inode_ref->fs;
+
+	/* Lookups in progress must not insert stale extents */
+	fs->extent_cache_gen++;
+
+	ext4_extent_cache_t *cache = ext4_extent_cache_find(fs,
+	    inode_ref->index);
+	if (cache == NULL)
+		return;
+
+	size_t i = ext4_extent_cache_search(cache, iblock_from);
+	if (i < cache->nranges && cache->range[i].iblock < iblock_from) {
+		/* Range is released partially */
+		cache->range[i].count = iblock_from - cache->range[i].iblock;
+		i++;
+	}
+
+	cache->nranges = i;
+	if (cache->nranges == 0)
+		cache->inode = 0;
+}
+
 /** Find physical block in the extent tree by logical block number.
  *
  * There is no need to save path in the tree during this algorithm.
@@ -390,6 +559,11 @@ errno_t ext4_extent_find_block(ext4_inode_ref_t *inode_ref, uint32_t iblock,
 		return EOK;
 	}
 
+	/* Try to avoid walking the tree */
+	if (ext4_extent_cache_lookup(inode_ref, iblock, fblock))
+		return EOK;
+
+	uint32_t cache_gen = inode_ref->fs->extent_cache_gen;
 	block_t *block = NULL;
 
 	/* Walk through extent tree */
@@ -405,7 +579,7 @@ errno_t ext4_extent_find_block(ext4_inode_ref_t *inode_ref, uint32_t iblock,
 		uint64_t child = ext4_extent_index_get_leaf(index);
 
 		if (block != NULL) {
-			rc = block_put(block);
+			rc = ext4_block_put(block);
 			if (rc != EOK)
 				return rc;
 		}
@@ -429,14 +603,26 @@ errno_t ext4_extent_find_block(ext4_inode_ref_t *inode_ref, uint32_t iblock,
 		/* Compute requested physical block address */
 		uint32_t phys_block;
 		uint32_t first = ext4_extent_get_first_block(extent);
+		uint16_t count = ext4_extent_get_block_count(extent);
 		phys_block = ext4_extent_get_start(extent) + iblock - first;
 
 		*fblock = phys_block;
+
+		/*
+		 * Remember the extent unless it was invalidated meanwhile.
+		 * Uninitialized extents store their length biased by
+		 * EXT4_EXTENT_MAX_INIT_LEN, do not cache those.
+		 */
+		if (count <= EXT4_EXTENT_MAX_INIT_LEN && iblock - first < count &&
+		    cache_gen == inode_ref->fs->extent_cache_gen) {
+			ext4_extent_cache_insert(inode_ref, first, count,
+			    ext4_extent_get_start(extent));
+		}
 	}
 
 	/* Cleanup */
 	if (block != NULL)
-		rc = block_put(block);
+		rc = ext4_block_put(block);
 
 	return rc;
 }
@@ -521,7 +707,7 @@ cleanup:
 	 */
 	for (uint16_t i = 1; i < tmp_path->depth; ++i) {
 		if (tmp_path[i].block) {
-			rc2 = block_put(tmp_path[i].block);
+			rc2 = ext4_block_put(tmp_path[i].block);
 			if (rc == EOK && rc2 != EOK)
 				rc = rc2;
 		}
@@ -603,7 +789,7 @@ static errno_t ext4_extent_release_branch(ext4_inode_ref_t *inode_ref,
 
 	/* Release data block where the node was stored */
 
-	rc = block_put(block);
+	rc = ext4_block_put(block);
 	if (rc != EOK)
 		return rc;
 
@@ -619,6 +805,9 @@ static errno_t ext4_extent_release_branch(ext4_inode_ref_t *inode_ref,
 errno_t ext4_extent_release_blocks_from(ext4_inode_ref_t *inode_ref,
     uint32_t iblock_from)
 {
+	/* Forget mappings of the released blocks */
+	ext4_extent_cache_invalidate(inode_ref, iblock_from);
+
 	/* Find the first extent to modify */
 	ext4_extent_path_t *path;
 	errno_t rc2;
@@ -741,7 +930,7 @@ cleanup:
 	 */
 	for (uint16_t i = 1; i <= path->depth; ++i) {
 		if (path[i].block) {
-			rc2 = block_put(path[i].block);
+			rc2 = ext4_block_put(path[i].block);
 			if (rc == EOK && rc2 != EOK)
 				rc = rc2;
 		}
@@ -795,10 +984,10 @@ static errno_t ext4_extent_append_extent(ext4_inode_ref_t *inode_ref,
 			}
 
 			/* Put back not modified old block */
-			rc = block_put(path_ptr->block);
+			rc = ext4_block_put(path_ptr->block);
 			if (rc != EOK) {
 				ext4_balloc_free_block(inode_ref, fblock);
-				block_put(block);
+				ext4_block_put(block);
 				return rc;
 			}
 
@@ -949,25 +1138,30 @@ static errno_t ext4_extent_append_extent(ext4_inode_ref_t *inode_ref,
 	return EOK;
 }
 
-/** Append data block to the i-node.
+/** Append run of data blocks to the i-node.
  *
- * This function allocates data block, tries to append it
- * to some existing extent or creates new extents.
+ * This function allocates up to @a count continuous data blocks
+ * in one step and appends them to the last extent if they follow it
+ * physically, otherwise a new extent covering the whole run is created.
  * It includes possible extent tree modifications (splitting).
  *
- * @param inode_ref I-node to append block to
- * @param iblock    Output logical number of newly allocated block
- * @param fblock    Output physical block address of newly allocated block
+ * @param inode_ref   I-node to append blocks to
+ * @param count       Maximum number of blocks to append
+ * @param iblock      Output logical number of first newly allocated block
+ * @param fblock      Output physical address of first newly allocated block
+ * @param allocated   Output number of appended blocks (at least 1)
+ * @param update_size Add size of appended blocks to the i-node size
  *
  * @return Error code
  *
  */
-errno_t ext4_extent_append_block(ext4_inode_ref_t *inode_ref, uint32_t *iblock,
-    uint32_t *fblock, bool update_size)
+errno_t ext4_extent_append_blocks(ext4_inode_ref_t *inode_ref, uint32_t count,
+    uint32_t *iblock, uint32_t *fblock, uint32_t *allocated, bool update_size)
 {
 	ext4_superblock_t *sb = inode_ref->fs->superblock;
 	uint64_t inode_size = ext4_inode_get_size(sb, inode_ref->inode);
 	uint32_t block_size = ext4_superblock_get_block_size(sb);
+	uint32_t block_limit = (1 << 15);
 
 	/* Calculate number of new logical block */
 	uint32_t new_block_idx = 0;
@@ -990,80 +1184,66 @@ errno_t ext4_extent_append_block(ext4_inode_ref_t *inode_ref, uint32_t *iblock,
 	while (path_ptr->depth != 0)
 		path_ptr++;
 
+	uint32_t phys_block = 0;
+	uint32_t run = 0;
+
 	/* Add new extent to the node if not present */
 	if (path_ptr->extent == NULL)
 		goto append_extent;
 
 	uint16_t block_count = ext4_extent_get_block_count(path_ptr->extent);
-	uint16_t block_limit = (1 << 15);
-
-	uint32_t phys_block = 0;
-	if (block_count < block_limit) {
-		/* There is space for new block in the extent */
-		if (block_count == 0) {
-			/* Existing extent is empty */
-			rc = ext4_balloc_alloc_block(inode_ref, &phys_block);
-			if (rc != EOK)
-				goto finish;
-
-			/* Initialize extent */
-			ext4_extent_set_first_block(path_ptr->extent, new_block_idx);
-			ext4_extent_set_start(path_ptr->extent, phys_block);
-			ext4_extent_set_block_count(path_ptr->extent, 1);
-
-			/* Update i-node */
-			if (update_size) {
-				ext4_inode_set_size(inode_ref->inode, inode_size + block_size);
-				inode_ref->dirty = true;
-			}
-
-			path_ptr->block->dirty = true;
 
+	if (block_count == 0) {
+		/* Existing extent is empty */
+		rc = ext4_balloc_alloc_blocks(inode_ref, 0,
+		    min(count, block_limit), &phys_block, &run);
+		if (rc != EOK)
 			goto finish;
-		} else {
-			/* Existing extent contains some blocks */
-			phys_block = ext4_extent_get_start(path_ptr->extent);
-			phys_block += ext4_extent_get_block_count(path_ptr->extent);
 
-			/* Check if the following block is free for allocation */
-			bool free;
-			rc = ext4_balloc_try_alloc_block(inode_ref, phys_block, &free);
-			if (rc != EOK)
-				goto finish;
+		/* Initialize extent */
+		ext4_extent_set_first_block(path_ptr->extent, new_block_idx);
+		ext4_extent_set_start(path_ptr->extent, phys_block);
+		ext4_extent_set_block_count(path_ptr->extent, run);
 
-			if (!free) {
-				/* Target is not free, new block must be appended to new extent */
-				goto append_extent;
-			}
-
-			/* Update extent */
-			ext4_extent_set_block_count(path_ptr->extent, block_count + 1);
-
-			/* Update i-node */
-			if (update_size) {
-				ext4_inode_set_size(inode_ref->inode, inode_size + block_size);
-				inode_ref->dirty = true;
-			}
+		goto update;
+	}
 
-			path_ptr->block->dirty = true;
+	uint32_t first_block = ext4_extent_get_first_block(path_ptr->extent);
+	if ((block_count < block_limit) &&
+	    (first_block + block_count == new_block_idx)) {
+		/* There is space for new blocks in the extent */
+		uint32_t goal = ext4_extent_get_start(path_ptr->extent) +
+		    block_count;
 
+		rc = ext4_balloc_alloc_blocks(inode_ref, goal,
+		    min(count, block_limit - block_count), &phys_block, &run);
+		if (rc != EOK)
 			goto finish;
+
+		if (phys_block == goal) {
+			/* Run follows the extent, just make it longer */
+			ext4_extent_set_block_count(path_ptr->extent,
+			    block_count + run);
+			goto update;
 		}
+
+		/* Run is elsewhere, it must be appended as new extent */
+		goto new_extent;
 	}
 
 append_extent:
-	/* Append new extent to the tree */
-	phys_block = 0;
-
-	/* Allocate new data block */
-	rc = ext4_balloc_alloc_block(inode_ref, &phys_block);
+	/* Allocate new data blocks */
+	rc = ext4_balloc_alloc_blocks(inode_ref, 0, min(count, block_limit),
+	    &phys_block, &run);
 	if (rc != EOK)
 		goto finish;
 
-	/* Append extent for new block (includes tree splitting if needed) */
+new_extent:
+	/* Append extent for new blocks (includes tree splitting if needed) */
 	rc = ext4_extent_append_extent(inode_ref, path, new_block_idx);
 	if (rc != EOK) {
-		ext4_balloc_free_block(inode_ref, phys_block);
+		ext4_balloc_free_blocks(inode_ref, phys_block, run);
+		run = 0;
 		goto finish;
 	}
 
@@ -1071,13 +1251,15 @@ append_extent:
 	path_ptr = path + tree_depth;
 
 	/* Initialize newly created extent */
-	ext4_extent_set_block_count(path_ptr->extent, 1);
+	ext4_extent_set_block_count(path_ptr->extent, run);
 	ext4_extent_set_first_block(path_ptr->extent, new_block_idx);
 	ext4_extent_set_start(path_ptr->extent, phys_block);
 
+update:
 	/* Update i-node */
 	if (update_size) {
-		ext4_inode_set_size(inode_ref->inode, inode_size + block_size);
+		ext4_inode_set_size(inode_ref->inode,
+		    inode_size + (uint64_t) run * block_size);
 		inode_ref->dirty = true;
 	}
 
@@ -1089,6 +1271,7 @@ finish:
 	/* Set return values */
 	*iblock = new_block_idx;
 	*fblock = phys_block;
+	*allocated = run;
 
 	/*
 	 * Put loaded blocks
@@ -1096,7 +1279,7 @@ finish:
 	 */
 	for (uint16_t i = 1; i <= path->depth; ++i) {
 		if (path[i].block) {
-			rc2 = block_put(path[i].block);
+			rc2 = ext4_block_put(path[i].block);
 			if (rc == EOK && rc2 != EOK)
 				rc = rc2;
 		}
@@ -1108,6 +1291,28 @@ finish:
 	return rc;
 }
 
+/** Append data block to the i-node.
+ *
+ * This function allocates data block, tries to append it
+ * to some existing extent or creates new extents.
+ * It includes possible extent tree modifications (splitting).
+ *
+ * @param inode_ref I-node to append block to
+ * @param iblock    Output logical number of newly allocated block
+ * @param fblock    Output physical block address of newly allocated block
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_extent_append_block(ext4_inode_ref_t *inode_ref, uint32_t *iblock,
+    uint32_t *fblock, bool update_size)
+{
+	uint32_t allocated;
+
+	return ext4_extent_append_blocks(inode_ref, 1, iblock, fblock,
+	    &allocated, update_size);
+}
+
 /**
  * @}
  */
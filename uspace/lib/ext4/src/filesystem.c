@@ -37,6 +37,7 @@
  */
 
 #include <byteorder.h>
+#include <assert.h>
 #include <errno.h>
 #include <mem.h>
 #include <align.h>
@@ -53,6 +54,7 @@
 #include "ext4/filesystem.h"
 #include "ext4/ialloc.h"
 #include "ext4/inode.h"
+#include "ext4/journal.h"
 #include "ext4/ops.h"
 #include "ext4/superblock.h"
 
@@ -61,6 +63,10 @@ static errno_t ext4_filesystem_init_block_groups(ext4_filesystem_t *);
 static errno_t ext4_filesystem_alloc_this_inode(ext4_filesystem_t *,
     uint32_t, ext4_inode_ref_t **, int);
 static uint32_t ext4_filesystem_inodes_per_block(ext4_superblock_t *);
+static errno_t ext4_filesystem_refs_init(ext4_filesystem_t *);
+static void ext4_filesystem_refs_fini(ext4_filesystem_t *);
+static uint16_t ext4_filesystem_bg_checksum(ext4_superblock_t *, uint32_t,
+    ext4_block_group_t *);
 
 /** Initialize filesystem for opening.
  *
@@ -80,6 +86,7 @@ static errno_t ext4_filesystem_init(ext4_filesystem_t *fs, service_id_t service_
 	ext4_superblock_t *temp_superblock = NULL;
 
 	fs->device = service_id;
+	fibril_mutex_initialize(&fs->prealloc_lock);
 
 	/* Initialize block library (4096 is size of communication channel) */
 	rc = block_init(fs->device);
@@ -103,6 +110,13 @@ static errno_t ext4_filesystem_init(ext4_filesystem_t *fs, service_id_t service_
 	if (rc != EOK)
 		goto err_1;
 
+	/* Initialize caches of i-node and block group references */
+	rc = ext4_filesystem_refs_init(fs);
+	if (rc != EOK) {
+		block_cache_fini(fs->device);
+		goto err_1;
+	}
+
 	/* Compute limits for indirect block levels */
 	uint32_t block_ids_per_block = block_size / sizeof(uint32_t);
 	fs->inode_block_limits[0] = EXT4_INODE_DIRECT_BLOCK_COUNT;
@@ -139,6 +153,7 @@ static errno_t ext4_filesystem_init(ext4_filesystem_t *fs, service_id_t service_
 
 	return EOK;
 err_2:
+	ext4_filesystem_refs_fini(fs);
 	block_cache_fini(fs->device);
 err_1:
 	block_fini(fs->device);
@@ -155,6 +170,9 @@ err:
  */
 static void ext4_filesystem_fini(ext4_filesystem_t *fs)
 {
+	/* Write back and drop cached references */
+	ext4_filesystem_refs_fini(fs);
+
 	/* Release memory space for superblock */
 	free(fs->superblock);
 
@@ -440,13 +458,29 @@ errno_t ext4_filesystem_open(ext4_instance_t *inst, service_id_t service_id,
 
 	fs_inited = 1;
 
+	/* Replay the journal if needed and start journalling */
+	rc = ext4_journal_open(fs, cmode);
+	if (rc != EOK)
+		goto error;
+
 	/* Read root node */
 	rc = ext4_node_get_core(&root_node, inst, EXT4_INODE_ROOT_INDEX);
 	if (rc != EOK)
 		goto error;
 
-	/* Mark system as mounted */
-	ext4_superblock_set_state(fs->superblock, EXT4_SUPERBLOCK_STATE_ERROR_FS);
+	/*
+	 * Mark system as mounted. A journalled file system stays consistent,
+	 * only the journal needs to be checked after a crash.
+	 */
+	if (fs->journal != NULL) {
+		ext4_superblock_set_features_incompatible(fs->superblock,
+		    ext4_superblock_get_features_incompatible(fs->superblock) |
+		    EXT4_FEATURE_INCOMPAT_RECOVER);
+	} else {
+		ext4_superblock_set_state(fs->superblock,
+		    EXT4_SUPERBLOCK_STATE_ERROR_FS);
+	}
+
 	rc = ext4_superblock_write_direct(fs->device, fs->superblock);
 	if (rc != EOK)
 		goto error;
@@ -465,6 +499,9 @@ error:
 	if (root_node != NULL)
 		ext4_node_put(root_node);
 
+	if (fs != NULL)
+		(void) ext4_journal_close(fs->journal);
+
 	if (fs_inited)
 		ext4_filesystem_fini(fs);
 	free(fs);
@@ -481,9 +518,22 @@ error:
  */
 errno_t ext4_filesystem_close(ext4_filesystem_t *fs)
 {
+	/* Write back cached i-node and block group references */
+	errno_t rc = ext4_filesystem_flush_refs(fs, true);
+	if (rc != EOK)
+		return rc;
+
+	/* Commit the last transaction */
+	rc = ext4_journal_close(fs->journal);
+	if (rc != EOK)
+		return rc;
+
 	/* Write the superblock to the device */
+	ext4_superblock_set_features_incompatible(fs->superblock,
+	    ext4_superblock_get_features_incompatible(fs->superblock) &
+	    ~EXT4_FEATURE_INCOMPAT_RECOVER);
 	ext4_superblock_set_state(fs->superblock, EXT4_SUPERBLOCK_STATE_VALID_FS);
-	errno_t rc = ext4_superblock_write_direct(fs->device, fs->superblock);
+	rc = ext4_superblock_write_direct(fs->device, fs->superblock);
 	if (rc != EOK)
 		return rc;
 
@@ -521,6 +571,12 @@ static errno_t ext4_filesystem_check_features(ext4_filesystem_t *fs,
 	incompatible_features =
 	    ext4_superblock_get_features_incompatible(fs->superblock);
 	incompatible_features &= ~EXT4_FEATURE_INCOMPAT_SUPP;
+
+	/* The journal is replayed when the file system is opened */
+	if (ext4_superblock_has_feature_compatible(fs->superblock,
+	    EXT4_FEATURE_COMPAT_HAS_JOURNAL))
+		incompatible_features &= ~EXT4_FEATURE_INCOMPAT_RECOVER;
+
 	if (incompatible_features > 0)
 		return ENOTSUP;
 
@@ -691,7 +747,7 @@ static errno_t ext4_filesystem_init_block_groups(ext4_filesystem_t *fs)
 
 		block->dirty = true;
 
-		rc = block_put(block);
+		rc = ext4_block_put(block);
 		if (rc != EOK)
 			return rc;
 
@@ -803,7 +859,7 @@ static errno_t ext4_filesystem_init_block_bitmap(ext4_block_group_ref_t *bg_ref)
 	bitmap_block->dirty = true;
 
 	/* Save bitmap */
-	return block_put(bitmap_block);
+	return ext4_block_put(bitmap_block);
 }
 
 /** Initialize i-node bitmap in block group.
@@ -846,7 +902,7 @@ static errno_t ext4_filesystem_init_inode_bitmap(ext4_block_group_ref_t *bg_ref)
 	bitmap_block->dirty = true;
 
 	/* Save bitmap */
-	return block_put(bitmap_block);
+	return ext4_block_put(bitmap_block);
 }
 
 /** Initialize i-node table in block group.
@@ -888,7 +944,7 @@ static errno_t ext4_filesystem_init_inode_table(ext4_block_group_ref_t *bg_ref)
 		memset(block->data, 0, block_size);
 		block->dirty = true;
 
-		rc = block_put(block);
+		rc = ext4_block_put(block);
 		if (rc != EOK)
 			return rc;
 	}
@@ -896,6 +952,287 @@ static errno_t ext4_filesystem_init_inode_table(ext4_block_group_ref_t *bg_ref)
 	return EOK;
 }
 
+static size_t ext4_filesystem_ref_key_hash(const void *key)
+{
+	const uint32_t *index = key;
+	return *index;
+}
+
+static size_t ext4_filesystem_inode_ref_hash(const ht_link_t *item)
+{
+	ext4_inode_ref_t *ref = hash_table_get_inst(item, ext4_inode_ref_t,
+	    link);
+	return ref->index;
+}
+
+static bool ext4_filesystem_inode_ref_key_equal(const void *key, size_t hash,
+    const ht_link_t *item)
+{
+	const uint32_t *index = key;
+	ext4_inode_ref_t *ref = hash_table_get_inst(item, ext4_inode_ref_t,
+	    link);
+	return ref->index == *index;
+}
+
+static const hash_table_ops_t ext4_filesystem_inode_ref_ops = {
+	.hash = ext4_filesystem_inode_ref_hash,
+	.key_hash = ext4_filesystem_ref_key_hash,
+	.key_equal = ext4_filesystem_inode_ref_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+static size_t ext4_filesystem_bg_ref_hash(const ht_link_t *item)
+{
+	ext4_block_group_ref_t *ref = hash_table_get_inst(item,
+	    ext4_block_group_ref_t, link);
+	return ref->index;
+}
+
+static bool ext4_filesystem_bg_ref_key_equal(const void *key, size_t hash,
+    const ht_link_t *item)
+{
+	const uint32_t *index = key;
+	ext4_block_group_ref_t *ref = hash_table_get_inst(item,
+	    ext4_block_group_ref_t, link);
+	return ref->index == *index;
+}
+
+static const hash_table_ops_t ext4_filesystem_bg_ref_ops = {
+	.hash = ext4_filesystem_bg_ref_hash,
+	.key_hash = ext4_filesystem_ref_key_hash,
+	.key_equal = ext4_filesystem_bg_ref_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+/** Initialize caches of i-node and block group references.
+ *
+ * References are shared by all users of the same i-node or block group.
+ * When the last user puts a reference it stays cached (and keeps its
+ * block referenced) until it is evicted in LRU order. Changes are only
+ * written back to the block (and the block group checksum computed)
+ * on eviction.
+ *
+ * @param fs Filesystem
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_filesystem_refs_init(ext4_filesystem_t *fs)
+{
+	if (!hash_table_create(&fs->inode_refs, 0, 0,
+	    &ext4_filesystem_inode_ref_ops))
+		return ENOMEM;
+
+	if (!hash_table_create(&fs->bg_refs, 0, 0,
+	    &ext4_filesystem_bg_ref_ops)) {
+		hash_table_destroy(&fs->inode_refs);
+		return ENOMEM;
+	}
+
+	list_initialize(&fs->inode_lru);
+	fs->inode_lru_count = 0;
+	list_initialize(&fs->bg_lru);
+	fs->bg_lru_count = 0;
+	return EOK;
+}
+
+/** Finalize caches of i-node and block group references.
+ *
+ * @param fs Filesystem
+ *
+ */
+static void ext4_filesystem_refs_fini(ext4_filesystem_t *fs)
+{
+	(void) ext4_filesystem_flush_refs(fs, true);
+
+	assert(hash_table_size(&fs->inode_refs) == 0);
+	assert(hash_table_size(&fs->bg_refs) == 0);
+
+	hash_table_destroy(&fs->inode_refs);
+	hash_table_destroy(&fs->bg_refs);
+}
+
+/** Detach unused i-node reference from the cache.
+ *
+ * Must not block, so that the cache cannot change under the caller.
+ * The reference is appended to @a evicted, its block is to be put
+ * with ext4_filesystem_put_evicted().
+ *
+ * @param ref     I-node reference
+ * @param evicted List of evicted references
+ *
+ */
+static void ext4_filesystem_detach_inode_ref(ext4_inode_ref_t *ref,
+    list_t *evicted)
+{
+	ext4_filesystem_t *fs = ref->fs;
+
+	assert(ref->refcnt == 0);
+
+	list_remove(&ref->lru_link);
+	fs->inode_lru_count--;
+	hash_table_remove_item(&fs->inode_refs, &ref->link);
+
+	/* Mark block dirty for writing changes to physical device */
+	if (ref->dirty)
+		ref->block->dirty = true;
+
+	list_append(&ref->lru_link, evicted);
+}
+
+/** Detach unused block group reference from the cache.
+ *
+ * @param ref     Block group reference
+ * @param evicted List of evicted references
+ *
+ */
+static void ext4_filesystem_detach_bg_ref(ext4_block_group_ref_t *ref,
+    list_t *evicted)
+{
+	ext4_filesystem_t *fs = ref->fs;
+
+	assert(ref->refcnt == 0);
+
+	list_remove(&ref->lru_link);
+	fs->bg_lru_count--;
+	hash_table_remove_item(&fs->bg_refs, &ref->link);
+
+	if (ref->dirty) {
+		/* Compute new checksum of block group */
+		uint16_t checksum =
+		    ext4_filesystem_bg_checksum(fs->superblock, ref->index,
+		    ref->block_group);
+		ext4_block_group_set_checksum(ref->block_group, checksum);
+
+		/* Mark block dirty for writing changes to physical device */
+		ref->block->dirty = true;
+	}
+
+	list_append(&ref->lru_link, evicted);
+}
+
+/** Put blocks of evicted references and free them.
+ *
+ * @param inodes Evicted i-node references
+ * @param bgs    Evicted block group references
+ *
+ * @return Error code of the first failure
+ *
+ */
+static errno_t ext4_filesystem_put_evicted(list_t *inodes, list_t *bgs)
+{
+	errno_t rc = EOK;
+	errno_t rc2;
+
+	while (!list_empty(inodes)) {
+		ext4_inode_ref_t *ref = list_pop(inodes, ext4_inode_ref_t,
+		    lru_link);
+		rc2 = ext4_block_put(ref->block);
+		if (rc2 != EOK && rc == EOK)
+			rc = rc2;
+		free(ref);
+	}
+
+	while (!list_empty(bgs)) {
+		ext4_block_group_ref_t *ref = list_pop(bgs,
+		    ext4_block_group_ref_t, lru_link);
+		rc2 = ext4_block_put(ref->block);
+		if (rc2 != EOK && rc == EOK)
+			rc = rc2;
+		free(ref);
+	}
+
+	return rc;
+}
+
+/** Write back cached i-node and block group references.
+ *
+ * Unused references with changes are written back to their blocks and
+ * evicted. References in use are written back when they are put.
+ *
+ * @param fs  Filesystem
+ * @param all Evict also unused references without changes
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_filesystem_flush_refs(ext4_filesystem_t *fs, bool all)
+{
+	list_t inodes;
+	list_t bgs;
+
+	list_initialize(&inodes);
+	list_initialize(&bgs);
+
+	list_foreach_safe(fs->inode_lru, cur, next) {
+		ext4_inode_ref_t *ref = list_get_instance(cur, ext4_inode_ref_t,
+		    lru_link);
+		if (all || ref->dirty)
+			ext4_filesystem_detach_inode_ref(ref, &inodes);
+	}
+
+	list_foreach_safe(fs->bg_lru, cur, next) {
+		ext4_block_group_ref_t *ref = list_get_instance(cur,
+		    ext4_block_group_ref_t, lru_link);
+		if (all || ref->dirty)
+			ext4_filesystem_detach_bg_ref(ref, &bgs);
+	}
+
+	return ext4_filesystem_put_evicted(&inodes, &bgs);
+}
+
+/** Look up block group reference in the cache.
+ *
+ * @param fs   Filesystem
+ * @param bgid Index of block group
+ *
+ * @return Reference (with a new user added) or @c NULL if not cached
+ *
+ */
+static ext4_block_group_ref_t *ext4_filesystem_find_bg_ref(
+    ext4_filesystem_t *fs, uint32_t bgid)
+{
+	ht_link_t *link = hash_table_find(&fs->bg_refs, &bgid);
+	if (link == NULL)
+		return NULL;
+
+	ext4_block_group_ref_t *ref = hash_table_get_inst(link,
+	    ext4_block_group_ref_t, link);
+	if (ref->refcnt++ == 0) {
+		list_remove(&ref->lru_link);
+		fs->bg_lru_count--;
+	}
+
+	return ref;
+}
+
+/** Look up i-node reference in the cache.
+ *
+ * @param fs    Filesystem
+ * @param index I-node number
+ *
+ * @return Reference (with a new user added) or @c NULL if not cached
+ *
+ */
+static ext4_inode_ref_t *ext4_filesystem_find_inode_ref(ext4_filesystem_t *fs,
+    uint32_t index)
+{
+	ht_link_t *link = hash_table_find(&fs->inode_refs, &index);
+	if (link == NULL)
+		return NULL;
+
+	ext4_inode_ref_t *ref = hash_table_get_inst(link, ext4_inode_ref_t,
+	    link);
+	if (ref->refcnt++ == 0) {
+		list_remove(&ref->lru_link);
+		fs->inode_lru_count--;
+	}
+
+	return ref;
+}
+
 /** Get reference to block group specified by index.
  *
  * @param fs   Filesystem to find block group on
@@ -908,6 +1245,13 @@ static errno_t ext4_filesystem_init_inode_table(ext4_block_group_ref_t *bg_ref)
 errno_t ext4_filesystem_get_block_group_ref(ext4_filesystem_t *fs, uint32_t bgid,
     ext4_block_group_ref_t **ref)
 {
+	/* Try the cache first */
+	ext4_block_group_ref_t *cached = ext4_filesystem_find_bg_ref(fs, bgid);
+	if (cached != NULL) {
+		*ref = cached;
+		return EOK;
+	}
+
 	/* Allocate memory for new structure */
 	ext4_block_group_ref_t *newref =
 	    malloc(sizeof(ext4_block_group_ref_t));
@@ -947,7 +1291,7 @@ errno_t ext4_filesystem_get_block_group_ref(ext4_filesystem_t *fs, uint32_t bgid
 	    EXT4_BLOCK_GROUP_BLOCK_UNINIT)) {
 		rc = ext4_filesystem_init_block_bitmap(newref);
 		if (rc != EOK) {
-			block_put(newref->block);
+			ext4_block_put(newref->block);
 			free(newref);
 			return rc;
 		}
@@ -962,7 +1306,7 @@ errno_t ext4_filesystem_get_block_group_ref(ext4_filesystem_t *fs, uint32_t bgid
 	    EXT4_BLOCK_GROUP_INODE_UNINIT)) {
 		rc = ext4_filesystem_init_inode_bitmap(newref);
 		if (rc != EOK) {
-			block_put(newref->block);
+			ext4_block_put(newref->block);
 			free(newref);
 			return rc;
 		}
@@ -974,7 +1318,7 @@ errno_t ext4_filesystem_get_block_group_ref(ext4_filesystem_t *fs, uint32_t bgid
 		    EXT4_BLOCK_GROUP_ITABLE_ZEROED)) {
 			rc = ext4_filesystem_init_inode_table(newref);
 			if (rc != EOK) {
-				block_put(newref->block);
+				ext4_block_put(newref->block);
 				free(newref);
 				return rc;
 			}
@@ -986,6 +1330,20 @@ errno_t ext4_filesystem_get_block_group_ref(ext4_filesystem_t *fs, uint32_t bgid
 		newref->dirty = true;
 	}
 
+	/* Someone else might have loaded the descriptor in the meantime */
+	cached = ext4_filesystem_find_bg_ref(fs, bgid);
+	if (cached != NULL) {
+		if (newref->dirty)
+			cached->dirty = true;
+		*ref = cached;
+		rc = ext4_block_put(newref->block);
+		free(newref);
+		return rc;
+	}
+
+	newref->refcnt = 1;
+	link_initialize(&newref->lru_link);
+	hash_table_insert(&fs->bg_refs, &newref->link);
 	return EOK;
 }
 
@@ -1088,23 +1446,26 @@ uint32_t ext4_filesystem_bg_get_backup_blocks(ext4_block_group_ref_t *bg)
  */
 errno_t ext4_filesystem_put_block_group_ref(ext4_block_group_ref_t *ref)
 {
-	/* Check if reference modified */
-	if (ref->dirty) {
-		/* Compute new checksum of block group */
-		uint16_t checksum =
-		    ext4_filesystem_bg_checksum(ref->fs->superblock, ref->index,
-		    ref->block_group);
-		ext4_block_group_set_checksum(ref->block_group, checksum);
+	ext4_filesystem_t *fs = ref->fs;
+	list_t inodes;
+	list_t bgs;
 
-		/* Mark block dirty for writing changes to physical device */
-		ref->block->dirty = true;
-	}
+	assert(ref->refcnt > 0);
+	if (--ref->refcnt > 0)
+		return EOK;
 
-	/* Put back block, that contains block group descriptor */
-	errno_t rc = block_put(ref->block);
-	free(ref);
+	/* Keep the reference cached, changes are written back on eviction */
+	list_append(&ref->lru_link, &fs->bg_lru);
+	fs->bg_lru_count++;
 
-	return rc;
+	if (fs->bg_lru_count <= EXT4_BG_REF_CACHE_SIZE)
+		return EOK;
+
+	list_initialize(&inodes);
+	list_initialize(&bgs);
+	ext4_filesystem_detach_bg_ref(list_get_instance(list_first(&fs->bg_lru),
+	    ext4_block_group_ref_t, lru_link), &bgs);
+	return ext4_filesystem_put_evicted(&inodes, &bgs);
 }
 
 /** Get reference to i-node specified by index.
@@ -1119,6 +1480,13 @@ errno_t ext4_filesystem_put_block_group_ref(ext4_block_group_ref_t *ref)
 errno_t ext4_filesystem_get_inode_ref(ext4_filesystem_t *fs, uint32_t index,
     ext4_inode_ref_t **ref)
 {
+	/* Try the cache first */
+	ext4_inode_ref_t *cached = ext4_filesystem_find_inode_ref(fs, index);
+	if (cached != NULL) {
+		*ref = cached;
+		return EOK;
+	}
+
 	/* Allocate memory for new structure */
 	ext4_inode_ref_t *newref =
 	    malloc(sizeof(ext4_inode_ref_t));
@@ -1179,6 +1547,19 @@ errno_t ext4_filesystem_get_inode_ref(ext4_filesystem_t *fs, uint32_t index,
 	newref->fs = fs;
 	newref->dirty = false;
 
+	/* Someone else might have loaded the i-node in the meantime */
+	cached = ext4_filesystem_find_inode_ref(fs, newref->index);
+	if (cached != NULL) {
+		*ref = cached;
+		rc = ext4_block_put(newref->block);
+		free(newref);
+		return rc;
+	}
+
+	newref->refcnt = 1;
+	link_initialize(&newref->lru_link);
+	hash_table_insert(&fs->inode_refs, &newref->link);
+
 	*ref = newref;
 
 	return EOK;
@@ -1193,17 +1574,26 @@ errno_t ext4_filesystem_get_inode_ref(ext4_filesystem_t *fs, uint32_t index,
  */
 errno_t ext4_filesystem_put_inode_ref(ext4_inode_ref_t *ref)
 {
-	/* Check if reference modified */
-	if (ref->dirty) {
-		/* Mark block dirty for writing changes to physical device */
-		ref->block->dirty = true;
-	}
+	ext4_filesystem_t *fs = ref->fs;
+	list_t inodes;
+	list_t bgs;
 
-	/* Put back block, that contains i-node */
-	errno_t rc = block_put(ref->block);
-	free(ref);
+	assert(ref->refcnt > 0);
+	if (--ref->refcnt > 0)
+		return EOK;
 
-	return rc;
+	/* Keep the reference cached, changes are written back on eviction */
+	list_append(&ref->lru_link, &fs->inode_lru);
+	fs->inode_lru_count++;
+
+	if (fs->inode_lru_count <= EXT4_INODE_REF_CACHE_SIZE)
+		return EOK;
+
+	list_initialize(&inodes);
+	list_initialize(&bgs);
+	ext4_filesystem_detach_inode_ref(list_get_instance(
+	    list_first(&fs->inode_lru), ext4_inode_ref_t, lru_link), &inodes);
+	return ext4_filesystem_put_evicted(&inodes, &bgs);
 }
 
 /** Initialize newly allocated i-node in the filesystem.
@@ -1408,13 +1798,13 @@ errno_t ext4_filesystem_free_inode(ext4_inode_ref_t *inode_ref)
 			if (ind_block != 0) {
 				rc = ext4_balloc_free_block(inode_ref, ind_block);
 				if (rc != EOK) {
-					block_put(block);
+					ext4_block_put(block);
 					return rc;
 				}
 			}
 		}
 
-		rc = block_put(block);
+		rc = ext4_block_put(block);
 		if (rc != EOK)
 			return rc;
 
@@ -1441,7 +1831,7 @@ errno_t ext4_filesystem_free_inode(ext4_inode_ref_t *inode_ref)
 				rc = block_get(&subblock, fs->device, ind_block,
 				    BLOCK_FLAGS_NONE);
 				if (rc != EOK) {
-					block_put(block);
+					ext4_block_put(block);
 					return rc;
 				}
 
@@ -1454,28 +1844,28 @@ errno_t ext4_filesystem_free_inode(ext4_inode_ref_t *inode_ref)
 					if (ind_subblock != 0) {
 						rc = ext4_balloc_free_block(inode_ref, ind_subblock);
 						if (rc != EOK) {
-							block_put(subblock);
-							block_put(block);
+							ext4_block_put(subblock);
+							ext4_block_put(block);
 							return rc;
 						}
 					}
 				}
 
-				rc = block_put(subblock);
+				rc = ext4_block_put(subblock);
 				if (rc != EOK) {
-					block_put(block);
+					ext4_block_put(block);
 					return rc;
 				}
 			}
 
 			rc = ext4_balloc_free_block(inode_ref, ind_block);
 			if (rc != EOK) {
-				block_put(block);
+				ext4_block_put(block);
 				return rc;
 			}
 		}
 
-		rc = block_put(block);
+		rc = ext4_block_put(block);
 		if (rc != EOK)
 			return rc;
 
@@ -1501,6 +1891,9 @@ finish:
 		ext4_inode_set_file_acl(inode_ref->inode, fs->superblock, 0);
 	}
 
+	/* Forget blocks reserved for the i-node */
+	ext4_balloc_discard_prealloc(fs, inode_ref->index);
+
 	/* Free inode by allocator */
 	errno_t rc;
 	if (ext4_inode_is_type(fs->superblock, inode_ref->inode,
@@ -1661,7 +2054,7 @@ errno_t ext4_filesystem_get_inode_data_block_index(ext4_inode_ref_t *inode_ref,
 		    uint32_t_le2host(((uint32_t *) block->data)[offset_in_block]);
 
 		/* Put back indirect block untouched */
-		rc = block_put(block);
+		rc = ext4_block_put(block);
 		if (rc != EOK)
 			return rc;
 
@@ -1770,7 +2163,7 @@ errno_t ext4_filesystem_set_inode_data_block_index(ext4_inode_ref_t *inode_ref,
 		new_block->dirty = true;
 
 		/* Put back the allocated block */
-		rc = block_put(new_block);
+		rc = ext4_block_put(new_block);
 		if (rc != EOK)
 			return rc;
 
@@ -1793,7 +2186,7 @@ errno_t ext4_filesystem_set_inode_data_block_index(ext4_inode_ref_t *inode_ref,
 			/* Allocate new block */
 			rc = ext4_balloc_alloc_block(inode_ref, &new_block_addr);
 			if (rc != EOK) {
-				block_put(block);
+				ext4_block_put(block);
 				return rc;
 			}
 
@@ -1801,7 +2194,7 @@ errno_t ext4_filesystem_set_inode_data_block_index(ext4_inode_ref_t *inode_ref,
 			rc = block_get(&new_block, fs->device, new_block_addr,
 			    BLOCK_FLAGS_NOREAD);
 			if (rc != EOK) {
-				block_put(block);
+				ext4_block_put(block);
 				return rc;
 			}
 
@@ -1809,9 +2202,9 @@ errno_t ext4_filesystem_set_inode_data_block_index(ext4_inode_ref_t *inode_ref,
 			memset(new_block->data, 0, block_size);
 			new_block->dirty = true;
 
-			rc = block_put(new_block);
+			rc = ext4_block_put(new_block);
 			if (rc != EOK) {
-				block_put(block);
+				ext4_block_put(block);
 				return rc;
 			}
 
@@ -1829,7 +2222,7 @@ errno_t ext4_filesystem_set_inode_data_block_index(ext4_inode_ref_t *inode_ref,
 			block->dirty = true;
 		}
 
-		rc = block_put(block);
+		rc = ext4_block_put(block);
 		if (rc != EOK)
 			return rc;
 
@@ -1930,7 +2323,7 @@ errno_t ext4_filesystem_release_inode_block(ext4_inode_ref_t *inode_ref,
 			block->dirty = true;
 		}
 
-		rc = block_put(block);
+		rc = ext4_block_put(block);
 		if (rc != EOK)
 			return rc;
 
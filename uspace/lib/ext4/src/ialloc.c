@@ -41,6 +41,7 @@
 #include "ext4/block_group.h"
 #include "ext4/filesystem.h"
 #include "ext4/ialloc.h"
+#include "ext4/journal.h"
 #include "ext4/superblock.h"
 
 /** Convert i-node number to relative index in block group.
@@ -122,7 +123,7 @@ errno_t ext4_ialloc_free_inode(ext4_filesystem_t *fs, uint32_t index, bool is_di
 	bitmap_block->dirty = true;
 
 	/* Put back the block with bitmap */
-	rc = block_put(bitmap_block);
+	rc = ext4_block_put(bitmap_block);
 	if (rc != EOK) {
 		/* Error in saving bitmap */
 		ext4_filesystem_put_block_group_ref(bg_ref);
@@ -237,7 +238,7 @@ retry:
 
 			/* Block group has not any free i-node */
 			if (rc == ENOSPC) {
-				rc = block_put(bitmap_block);
+				rc = ext4_block_put(bitmap_block);
 				if (rc != EOK) {
 					ext4_filesystem_put_block_group_ref(bg_ref);
 					return rc;
@@ -254,7 +255,7 @@ retry:
 			/* Free i-node found, save the bitmap */
 			bitmap_block->dirty = true;
 
-			rc = block_put(bitmap_block);
+			rc = ext4_block_put(bitmap_block);
 			if (rc != EOK) {
 				ext4_filesystem_put_block_group_ref(bg_ref);
 				return rc;
@@ -369,7 +370,7 @@ errno_t ext4_ialloc_alloc_this_inode(ext4_filesystem_t *fs, uint32_t inode,
 	/* Save the bitmap */
 	bitmap_block->dirty = true;
 
-	rc = block_put(bitmap_block);
+	rc = ext4_block_put(bitmap_block);
 	if (rc != EOK) {
 		ext4_filesystem_put_block_group_ref(bg_ref);
 		return rc;
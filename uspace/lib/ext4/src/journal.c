@@ -0,0 +1,1439 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libext4
+ * @{
+ */
+/**
+ * @file  journal.c
+ * @brief Metadata journal compatible with jbd2.
+ *
+ * Metadata blocks modified by file system operations are collected in
+ * a running transaction. The journal keeps a reference to each of them,
+ * so that libblock does not write them in place before the transaction
+ * is committed. Transactions are committed when they grow large, after
+ * a commit interval or when the file system is synced, so that many
+ * operations share a single commit and the log is written with large
+ * sequential writes. After the commit record is stable the blocks are
+ * written in place and the journal is marked empty again.
+ *
+ * File data blocks written by the same operations are kept in the
+ * transaction as well, but they are not logged. They are written in
+ * place before the commit record, so that committed metadata never
+ * points to stale data (ordered mode).
+ *
+ * A log left behind by an unclean shutdown (by us or by another system)
+ * is replayed when the file system is opened.
+ */
+
+#include <adt/hash.h>
+#include <adt/hash_table.h>
+#include <adt/list.h>
+#include <assert.h>
+#include <byteorder.h>
+#include <errno.h>
+#include <fibril_synch.h>
+#include <macros.h>
+#include <mem.h>
+#include <qsort.h>
+#include <stdlib.h>
+#include "ext4/filesystem.h"
+#include "ext4/inode.h"
+#include "ext4/journal.h"
+#include "ext4/superblock.h"
+#include "ext4/types.h"
+#include "../private/journal.h"
+
+/** Maximum number of blocks in one transaction */
+#define EXT4_JOURNAL_TRANS_MAX  1024
+
+/** Time after which a running transaction is committed (in microseconds) */
+#define EXT4_JOURNAL_COMMIT_INTERVAL  (5 * 1000 * 1000)
+
+/** Size of the journal UUID following the first tag of a descriptor */
+#define EXT4_JOURNAL_UUID_SIZE  16
+
+/** Revoked block found during recovery */
+typedef struct {
+	ht_link_t link;
+	uint64_t block;
+	/** Latest transaction revoking the block */
+	uint32_t sequence;
+} ext4_journal_revoke_t;
+
+typedef enum {
+	ext4_jpass_scan,
+	ext4_jpass_revoke,
+	ext4_jpass_replay
+} ext4_journal_pass_t;
+
+static LIST_INITIALIZE(journal_list);
+static FIBRIL_MUTEX_INITIALIZE(journal_list_lock);
+
+static size_t ext4_journal_buf_key_hash(const void *key)
+{
+	const aoff64_t *lba = key;
+	return hash_mix64(*lba);
+}
+
+static size_t ext4_journal_buf_hash(const ht_link_t *item)
+{
+	ext4_journal_buf_t *buf = hash_table_get_inst(item, ext4_journal_buf_t,
+	    link);
+	return hash_mix64(buf->block->lba);
+}
+
+static bool ext4_journal_buf_key_equal(const void *key, size_t hash,
+    const ht_link_t *item)
+{
+	const aoff64_t *lba = key;
+	ext4_journal_buf_t *buf = hash_table_get_inst(item, ext4_journal_buf_t,
+	    link);
+	return buf->block->lba == *lba;
+}
+
+static void ext4_journal_buf_remove_callback(ht_link_t *item)
+{
+	free(hash_table_get_inst(item, ext4_journal_buf_t, link));
+}
+
+static const hash_table_ops_t ext4_journal_buf_ops = {
+	.hash = ext4_journal_buf_hash,
+	.key_hash = ext4_journal_buf_key_hash,
+	.key_equal = ext4_journal_buf_key_equal,
+	.equal = NULL,
+	.remove_callback = ext4_journal_buf_remove_callback
+};
+
+static size_t ext4_journal_revoke_key_hash(const void *key)
+{
+	const uint64_t *block = key;
+	return hash_mix64(*block);
+}
+
+static size_t ext4_journal_revoke_hash(const ht_link_t *item)
+{
+	ext4_journal_revoke_t *rec = hash_table_get_inst(item,
+	    ext4_journal_revoke_t, link);
+	return hash_mix64(rec->block);
+}
+
+static bool ext4_journal_revoke_key_equal(const void *key, size_t hash,
+    const ht_link_t *item)
+{
+	const uint64_t *block = key;
+	ext4_journal_revoke_t *rec = hash_table_get_inst(item,
+	    ext4_journal_revoke_t, link);
+	return rec->block == *block;
+}
+
+static void ext4_journal_revoke_remove_callback(ht_link_t *item)
+{
+	free(hash_table_get_inst(item, ext4_journal_revoke_t, link));
+}
+
+static const hash_table_ops_t ext4_journal_revoke_ops = {
+	.hash = ext4_journal_revoke_hash,
+	.key_hash = ext4_journal_revoke_key_hash,
+	.key_equal = ext4_journal_revoke_key_equal,
+	.equal = NULL,
+	.remove_callback = ext4_journal_revoke_remove_callback
+};
+
+/** Compare transaction sequence numbers.
+ *
+ * @return True if @a a comes after @a b
+ */
+static bool ext4_journal_seq_after(uint32_t a, uint32_t b)
+{
+	return (int32_t) (a - b) > 0;
+}
+
+/** Get the next block of the circular log. */
+static uint32_t ext4_journal_next(ext4_journal_t *journal, uint32_t jblock)
+{
+	jblock++;
+	if (jblock >= journal->max_len)
+		jblock = journal->first;
+	return jblock;
+}
+
+/** Find the run of file system blocks holding a journal block.
+ *
+ * @param journal Journal
+ * @param jblock  Journal block
+ * @param fblock  Place to store the file system address
+ * @param count   Place to store number of following blocks in the same run
+ *                (including @a jblock)
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_bmap(ext4_journal_t *journal, uint32_t jblock,
+    uint64_t *fblock, uint32_t *count)
+{
+	for (size_t i = 0; i < journal->nruns; i++) {
+		ext4_journal_run_t *run = &journal->runs[i];
+
+		if (jblock >= run->jblock && jblock - run->jblock < run->count) {
+			*fblock = run->fblock + (jblock - run->jblock);
+			*count = run->count - (jblock - run->jblock);
+			return EOK;
+		}
+	}
+
+	return EIO;
+}
+
+/** Read one journal block.
+ *
+ * The journal is accessed directly, bypassing the block cache.
+ *
+ * @param journal Journal
+ * @param jblock  Journal block to read
+ * @param buf     Buffer of one file system block
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_read(ext4_journal_t *journal, uint32_t jblock,
+    void *buf)
+{
+	uint64_t fblock;
+	uint32_t count;
+
+	errno_t rc = ext4_journal_bmap(journal, jblock, &fblock, &count);
+	if (rc != EOK)
+		return rc;
+
+	return block_read_direct(journal->service_id, fblock * journal->spb,
+	    journal->spb, buf);
+}
+
+/** Write consecutive journal blocks.
+ *
+ * Each continuous run of the journal file is written with a single
+ * request.
+ *
+ * @param journal Journal
+ * @param jblock  First journal block
+ * @param cnt     Number of blocks (must not wrap around)
+ * @param buf     Data to be written
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_write(ext4_journal_t *journal, uint32_t jblock,
+    uint32_t cnt, const void *buf)
+{
+	while (cnt > 0) {
+		uint64_t fblock;
+		uint32_t count;
+
+		errno_t rc = ext4_journal_bmap(journal, jblock, &fblock, &count);
+		if (rc != EOK)
+			return rc;
+
+		count = min(count, cnt);
+		rc = block_write_direct(journal->service_id,
+		    fblock * journal->spb, count * journal->spb, buf);
+		if (rc != EOK)
+			return rc;
+
+		jblock += count;
+		cnt -= count;
+		buf += count * journal->block_size;
+	}
+
+	return EOK;
+}
+
+/** Make previously written blocks stable.
+ *
+ * @param journal Journal
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_flush(ext4_journal_t *journal)
+{
+	errno_t rc = block_sync_cache(journal->service_id, 0, 0);
+
+	/* Devices without a write cache need not support this */
+	if (rc == ENOTSUP)
+		return EOK;
+
+	return rc;
+}
+
+/** Write the journal superblock.
+ *
+ * @param journal  Journal
+ * @param start    First block of the log or 0 if the log is empty
+ * @param sequence Sequence number of the first transaction in the log
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_write_sb(ext4_journal_t *journal, uint32_t start,
+    uint32_t sequence)
+{
+	ext4_journal_superblock_t *sb = journal->sb_block;
+
+	sb->start = host2uint32_t_be(start);
+	sb->sequence = host2uint32_t_be(sequence);
+
+	return ext4_journal_write(journal, 0, 1, journal->sb_block);
+}
+
+/** Map blocks of the journal i-node.
+ *
+ * @param journal Journal
+ * @param index   Journal i-node number
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_map(ext4_journal_t *journal, uint32_t index)
+{
+	ext4_filesystem_t *fs = journal->fs;
+	ext4_inode_ref_t *inode_ref;
+	size_t size = 0;
+	errno_t rc;
+
+	rc = ext4_filesystem_get_inode_ref(fs, index, &inode_ref);
+	if (rc != EOK)
+		return rc;
+
+	uint64_t count = ext4_inode_get_size(fs->superblock, inode_ref->inode) /
+	    journal->block_size;
+	if (count > UINT32_MAX) {
+		rc = ENOTSUP;
+		goto out;
+	}
+
+	for (uint32_t iblock = 0; iblock < count; iblock++) {
+		uint32_t fblock;
+
+		rc = ext4_filesystem_get_inode_data_block_index(inode_ref, iblock,
+		    &fblock);
+		if (rc != EOK)
+			goto out;
+
+		if (fblock == 0) {
+			rc = EIO;
+			goto out;
+		}
+
+		if (journal->nruns > 0) {
+			ext4_journal_run_t *last = &journal->runs[journal->nruns - 1];
+			if (last->fblock + last->count == fblock) {
+				last->count++;
+				continue;
+			}
+		}
+
+		if (journal->nruns == size) {
+			size_t nsize = size > 0 ? 2 * size : 4;
+			ext4_journal_run_t *nruns = realloc(journal->runs,
+			    nsize * sizeof(ext4_journal_run_t));
+			if (nruns == NULL) {
+				rc = ENOMEM;
+				goto out;
+			}
+
+			journal->runs = nruns;
+			size = nsize;
+		}
+
+		journal->runs[journal->nruns].jblock = iblock;
+		journal->runs[journal->nruns].fblock = fblock;
+		journal->runs[journal->nruns].count = 1;
+		journal->nruns++;
+	}
+
+	rc = EOK;
+out:
+	;
+	errno_t rc2 = ext4_filesystem_put_inode_ref(inode_ref);
+	return rc == EOK ? rc2 : rc;
+}
+
+/** Get size of a descriptor block tag as stored in the log. */
+static size_t ext4_journal_tag_bytes(uint32_t incompat)
+{
+	size_t size;
+
+	if ((incompat & EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V3) != 0)
+		return sizeof(ext4_journal_block_tag3_t);
+
+	size = sizeof(ext4_journal_block_tag_t);
+	if ((incompat & EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V2) != 0)
+		size += sizeof(uint16_t);
+	if ((incompat & EXT4_JOURNAL_FEATURE_INCOMPAT_64BIT) != 0)
+		return size;
+
+	return size - sizeof(uint32_t);
+}
+
+/** Check whether a block was revoked after being logged.
+ *
+ * @param revoked  Revoke table
+ * @param block    File system block
+ * @param sequence Transaction logging the block
+ *
+ * @return True if the block must not be replayed
+ *
+ */
+static bool ext4_journal_revoked(hash_table_t *revoked, uint64_t block,
+    uint32_t sequence)
+{
+	ht_link_t *link = hash_table_find(revoked, &block);
+	if (link == NULL)
+		return false;
+
+	ext4_journal_revoke_t *rec = hash_table_get_inst(link,
+	    ext4_journal_revoke_t, link);
+	return !ext4_journal_seq_after(sequence, rec->sequence);
+}
+
+/** Record blocks revoked by a revoke block.
+ *
+ * @param journal  Journal
+ * @param revoked  Revoke table
+ * @param data     Revoke block
+ * @param sequence Transaction of the revoke block
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_add_revokes(ext4_journal_t *journal,
+    hash_table_t *revoked, const void *data, uint32_t sequence)
+{
+	const ext4_journal_revoke_header_t *hdr = data;
+	size_t rsize = (journal->incompat &
+	    EXT4_JOURNAL_FEATURE_INCOMPAT_64BIT) != 0 ? 8 : 4;
+	size_t count = min(uint32_t_be2host(hdr->count), journal->block_size);
+
+	for (size_t off = sizeof(*hdr); off + rsize <= count; off += rsize) {
+		const uint32_t *rec = data + off;
+		uint64_t block;
+
+		if (rsize == 8) {
+			block = ((uint64_t) uint32_t_be2host(rec[0]) << 32) |
+			    uint32_t_be2host(rec[1]);
+		} else {
+			block = uint32_t_be2host(rec[0]);
+		}
+
+		ht_link_t *link = hash_table_find(revoked, &block);
+		if (link != NULL) {
+			ext4_journal_revoke_t *r = hash_table_get_inst(link,
+			    ext4_journal_revoke_t, link);
+			if (ext4_journal_seq_after(sequence, r->sequence))
+				r->sequence = sequence;
+			continue;
+		}
+
+		ext4_journal_revoke_t *r = malloc(sizeof(ext4_journal_revoke_t));
+		if (r == NULL)
+			return ENOMEM;
+
+		r->block = block;
+		r->sequence = sequence;
+		hash_table_insert(revoked, &r->link);
+	}
+
+	return EOK;
+}
+
+/** Perform one pass over the log.
+ *
+ * The scan pass finds the end of the log, i.e. the first transaction
+ * which has not been committed. The revoke pass collects revoked blocks
+ * and the replay pass writes logged blocks to their home locations.
+ *
+ * @param journal Journal
+ * @param pass    Which pass to perform
+ * @param revoked Revoke table
+ * @param end     Sequence number of the first uncommitted transaction
+ *                (output of the scan pass, input of the other passes)
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_pass(ext4_journal_t *journal,
+    ext4_journal_pass_t pass, hash_table_t *revoked, uint32_t *end)
+{
+	ext4_journal_superblock_t *sb = journal->sb_block;
+	uint32_t sequence = uint32_t_be2host(sb->sequence);
+	uint32_t jblock = uint32_t_be2host(sb->start);
+	size_t tag_bytes = ext4_journal_tag_bytes(journal->incompat);
+	size_t tail = 0;
+	errno_t rc = EOK;
+
+	if ((journal->incompat & (EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V2 |
+	    EXT4_JOURNAL_FEATURE_INCOMPAT_CSUM_V3)) != 0)
+		tail = sizeof(uint32_t);
+
+	uint8_t *buf = malloc(journal->block_size);
+	uint8_t *data = malloc(journal->block_size);
+	if (buf == NULL || data == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+
+	/* Never go around the log more than once */
+	for (uint32_t i = 0; i < journal->max_len; i++) {
+		if (pass != ext4_jpass_scan && sequence == *end)
+			break;
+
+		rc = ext4_journal_read(journal, jblock, buf);
+		if (rc != EOK)
+			goto out;
+
+		ext4_journal_header_t *hdr = (ext4_journal_header_t *) buf;
+		if (uint32_t_be2host(hdr->magic) != EXT4_JOURNAL_MAGIC ||
+		    uint32_t_be2host(hdr->sequence) != sequence)
+			break;
+
+		uint32_t blocktype = uint32_t_be2host(hdr->blocktype);
+		jblock = ext4_journal_next(journal, jblock);
+
+		if (blocktype == EXT4_JOURNAL_COMMIT_BLOCK) {
+			sequence++;
+			continue;
+		}
+
+		if (blocktype == EXT4_JOURNAL_REVOKE_BLOCK) {
+			if (pass == ext4_jpass_revoke) {
+				rc = ext4_journal_add_revokes(journal, revoked, buf,
+				    sequence);
+				if (rc != EOK)
+					goto out;
+			}
+			continue;
+		}
+
+		if (blocktype != EXT4_JOURNAL_DESCRIPTOR_BLOCK)
+			break;
+
+		uint8_t *tagp = buf + sizeof(ext4_journal_header_t);
+		uint8_t *tagend = buf + journal->block_size - tail;
+
+		while (tagp + tag_bytes <= tagend) {
+			uint64_t block;
+			uint32_t flags;
+
+			if (tag_bytes == sizeof(ext4_journal_block_tag3_t)) {
+				ext4_journal_block_tag3_t *tag =
+				    (ext4_journal_block_tag3_t *) tagp;
+				flags = uint32_t_be2host(tag->flags);
+				block = uint32_t_be2host(tag->blocknr);
+			} else {
+				ext4_journal_block_tag_t *tag =
+				    (ext4_journal_block_tag_t *) tagp;
+				flags = uint16_t_be2host(tag->flags);
+				block = uint32_t_be2host(tag->blocknr);
+			}
+
+			if ((journal->incompat &
+			    EXT4_JOURNAL_FEATURE_INCOMPAT_64BIT) != 0) {
+				ext4_journal_block_tag_t *tag =
+				    (ext4_journal_block_tag_t *) tagp;
+				block |= (uint64_t) uint32_t_be2host(
+				    tag->blocknr_high) << 32;
+			}
+
+			if (pass == ext4_jpass_replay &&
+			    !ext4_journal_revoked(revoked, block, sequence)) {
+				rc = ext4_journal_read(journal, jblock, data);
+				if (rc != EOK)
+					goto out;
+
+				if ((flags & EXT4_JOURNAL_FLAG_ESCAPE) != 0) {
+					*(uint32_t *) data =
+					    host2uint32_t_be(EXT4_JOURNAL_MAGIC);
+				}
+
+				rc = block_write_direct(journal->service_id,
+				    block * journal->spb, journal->spb, data);
+				if (rc != EOK)
+					goto out;
+			}
+
+			jblock = ext4_journal_next(journal, jblock);
+
+			tagp += tag_bytes;
+			if ((flags & EXT4_JOURNAL_FLAG_SAME_UUID) == 0)
+				tagp += EXT4_JOURNAL_UUID_SIZE;
+			if ((flags & EXT4_JOURNAL_FLAG_LAST_TAG) != 0)
+				break;
+		}
+	}
+
+	if (pass == ext4_jpass_scan)
+		*end = sequence;
+out:
+	free(buf);
+	free(data);
+	return rc;
+}
+
+/** Replay the log.
+ *
+ * Committed transactions are written to their home locations and the
+ * log is marked empty. Transactions without a commit record are ignored.
+ *
+ * @param journal Journal
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_journal_recover(ext4_journal_t *journal)
+{
+	hash_table_t revoked;
+	uint32_t end;
+	errno_t rc;
+
+	if (!hash_table_create(&revoked, 0, 0, &ext4_journal_revoke_ops))
+		return ENOMEM;
+
+	rc = ext4_journal_pass(journal, ext4_jpass_scan, &revoked, &end);
+	if (rc != EOK)
+		goto out;
+
+	rc = ext4_journal_pass(journal, ext4_jpass_revoke, &revoked, &end);
+	if (rc != EOK)
+		goto out;
+
+	rc = ext4_journal_pass(journal, ext4_jpass_replay, &revoked, &end);
+	if (rc != EOK)
+		goto out;
+
+	rc = ext4_journal_flush(journal);
+	if (rc != EOK)
+		goto out;
+
+	/* The log is empty now */
+	rc = ext4_journal_write_sb(journal, 0, end);
+	if (rc != EOK)
+		goto out;
+
+	rc = ext4_journal_flush(journal);
+out:
+	hash_table_destroy(&revoked);
+	return rc;
+}
+
+/** Destroy journal structure. */
+static void ext4_journal_destroy(ext4_journal_t *journal)
+{
+	if (journal->timer != NULL)
+		fibril_timer_destroy(journal->timer);
+	free(journal->runs);
+	free(journal->sb_block);
+	free(journal);
+}
+
+/** Commit interval timer handler. */
+static void ext4_journal_timer(void *arg)
+{
+	ext4_journal_t *journal = (ext4_journal_t *) arg;
+
+	fibril_mutex_lock(&journal->lock);
+	journal->timer_armed = false;
+	fibril_mutex_unlock(&journal->lock);
+
+	(void) ext4_journal_commit(journal);
+}
+
+/** Open the journal of a file system.
+ *
+ * Replays the log if the file system was not unmounted cleanly. If the
+ * journal can be used for logging, @c fs->journal is set.
+ *
+ * @param fs    File system
+ * @param cmode Cache mode of the file system
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_journal_open(ext4_filesystem_t *fs, enum cache_mode cmode)
+{
+	ext4_superblock_t *sb = fs->superblock;
+	ext4_journal_t *journal;
+	size_t dev_bsize;
+	errno_t rc;
+
+	fs->journal = NULL;
+
+	if (!ext4_superblock_has_feature_compatible(sb,
+	    EXT4_FEATURE_COMPAT_HAS_JOURNAL))
+		return EOK;
+
+	uint32_t index = ext4_superblock_get_journal_inode_number(sb);
+	if (index == 0) {
+		/* Journal on an external device is not supported */
+		if (ext4_superblock_has_feature_incompatible(sb,
+		    EXT4_FEATURE_INCOMPAT_RECOVER))
+			return ENOTSUP;
+		return EOK;
+	}
+
+	rc = block_get_bsize(fs->device, &dev_bsize);
+	if (rc != EOK)
+		return rc;
+
+	journal = calloc(1, sizeof(ext4_journal_t));
+	if (journal == NULL)
+		return ENOMEM;
+
+	link_initialize(&journal->link);
+	journal->fs = fs;
+	journal->service_id = fs->device;
+	journal->block_size = ext4_superblock_get_block_size(sb);
+	journal->spb = journal->block_size / dev_bsize;
+
+	rc = ext4_journal_map(journal, index);
+	if (rc != EOK)
+		goto error;
+
+	journal->sb_block = malloc(journal->block_size);
+	if (journal->sb_block == NULL) {
+		rc = ENOMEM;
+		goto error;
+	}
+
+	rc = ext4_journal_read(journal, 0, journal->sb_block);
+	if (rc != EOK)
+		goto error;
+
+	ext4_journal_superblock_t *jsb = journal->sb_block;
+	uint32_t blocktype = uint32_t_be2host(jsb->header.blocktype);
+	if (uint32_t_be2host(jsb->header.magic) != EXT4_JOURNAL_MAGIC ||
+	    (blocktype != EXT4_JOURNAL_SUPERBLOCK_V1 &&
+	    blocktype != EXT4_JOURNAL_SUPERBLOCK_V2) ||
+	    uint32_t_be2host(jsb->block_size) != journal->block_size) {
+		rc = EIO;
+		goto error;
+	}
+
+	journal->first = uint32_t_be2host(jsb->first);
+	journal->max_len = uint32_t_be2host(jsb->max_len);
+	if (journal->first == 0 || journal->first >= journal->max_len) {
+		rc = EIO;
+		goto error;
+	}
+
+	uint32_t compat = 0;
+	if (blocktype == EXT4_JOURNAL_SUPERBLOCK_V2) {
+		compat = uint32_t_be2host(jsb->features_compatible);
+		journal->incompat = uint32_t_be2host(jsb->features_incompatible);
+	}
+
+	if (jsb->start != 0) {
+		if ((journal->incompat & ~EXT4_JOURNAL_FEATURE_INCOMPAT_SUPP) != 0) {
+			rc = ENOTSUP;
+			goto error;
+		}
+
+		rc = ext4_journal_recover(journal);
+		if (rc != EOK)
+			goto error;
+
+		/* Drop blocks cached before they were replayed */
+		rc = ext4_filesystem_flush_refs(fs, true);
+		if (rc != EOK)
+			goto error;
+		rc = block_cache_fini(fs->device);
+		if (rc != EOK)
+			goto error;
+		rc = block_cache_init(fs->device, journal->block_size, 0, cmode);
+		if (rc != EOK)
+			goto error;
+
+		ext4_superblock_t *nsb;
+		rc = ext4_superblock_read_direct(fs->device, &nsb);
+		if (rc != EOK)
+			goto error;
+
+		ext4_superblock_release(fs->superblock);
+		fs->superblock = nsb;
+	}
+
+	journal->sequence = uint32_t_be2host(jsb->sequence);
+
+	/*
+	 * We do not compute journal checksums, so such journals are only
+	 * replayed. Transactions are committed synchronously, which is
+	 * compatible with asynchronous commit.
+	 */
+	if ((compat & EXT4_JOURNAL_FEATURE_COMPAT_CHECKSUM) != 0 ||
+	    (journal->incompat & ~(EXT4_JOURNAL_FEATURE_INCOMPAT_REVOKE |
+	    EXT4_JOURNAL_FEATURE_INCOMPAT_64BIT |
+	    EXT4_JOURNAL_FEATURE_INCOMPAT_ASYNC_COMMIT)) != 0) {
+		ext4_journal_destroy(journal);
+		return EOK;
+	}
+
+	rc = ext4_journal_activate(journal);
+	if (rc == ENOTSUP) {
+		/* The log is too small to be used */
+		ext4_journal_destroy(journal);
+		return EOK;
+	}
+	if (rc != EOK)
+		goto error;
+
+	fs->journal = journal;
+	return EOK;
+error:
+	ext4_journal_destroy(journal);
+	return rc;
+}
+
+/** Start logging to a journal.
+ *
+ * The journal becomes active on its device, i.e. dirty blocks put
+ * by ext4_block_put() are added to its running transaction.
+ *
+ * @param journal Journal with the log geometry set up and an empty log
+ *
+ * @return EOK on success, ENOTSUP if the log is too small
+ *         or another error code
+ *
+ */
+errno_t ext4_journal_activate(ext4_journal_t *journal)
+{
+	journal->tag_bytes = ext4_journal_tag_bytes(journal->incompat);
+	journal->trans_max = min(EXT4_JOURNAL_TRANS_MAX,
+	    (journal->max_len - journal->first) / 4);
+	if (journal->trans_max == 0)
+		return ENOTSUP;
+
+	fibril_mutex_initialize(&journal->lock);
+	fibril_condvar_initialize(&journal->cv);
+	fibril_mutex_initialize(&journal->commit_lock);
+
+	journal->timer = fibril_timer_create(NULL);
+	if (journal->timer == NULL)
+		return ENOMEM;
+
+	if (!hash_table_create(&journal->running, 0, 0,
+	    &ext4_journal_buf_ops))
+		return ENOMEM;
+
+	fibril_mutex_lock(&journal_list_lock);
+	list_append(&journal->link, &journal_list);
+	fibril_mutex_unlock(&journal_list_lock);
+
+	return EOK;
+}
+
+/** Drop reference to a block of the running transaction. */
+static bool ext4_journal_release(ht_link_t *item, void *arg)
+{
+	ext4_journal_buf_t *buf = hash_table_get_inst(item, ext4_journal_buf_t,
+	    link);
+
+	/* The block is still dirty and gets written in place */
+	(void) block_put(buf->block);
+	return true;
+}
+
+/** Commit the running transaction and close the journal.
+ *
+ * @param journal Journal or @c NULL
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_journal_close(ext4_journal_t *journal)
+{
+	if (journal == NULL)
+		return EOK;
+
+	(void) fibril_timer_clear(journal->timer);
+
+	errno_t rc = ext4_journal_commit(journal);
+	if (rc != EOK)
+		hash_table_apply(&journal->running, ext4_journal_release, NULL);
+
+	fibril_mutex_lock(&journal_list_lock);
+	list_remove(&journal->link);
+	fibril_mutex_unlock(&journal_list_lock);
+
+	journal->fs->journal = NULL;
+	hash_table_destroy(&journal->running);
+	ext4_journal_destroy(journal);
+	return rc;
+}
+
+/** Start a file system operation.
+ *
+ * A transaction is only committed when no operation is in progress,
+ * so that each operation is committed as a whole.
+ *
+ * @param journal Journal or @c NULL
+ *
+ */
+void ext4_journal_start(ext4_journal_t *journal)
+{
+	if (journal == NULL)
+		return;
+
+	fibril_mutex_lock(&journal->lock);
+
+	if (journal->commit_request && journal->handles == 0) {
+		fibril_mutex_unlock(&journal->lock);
+		(void) ext4_journal_commit(journal);
+		fibril_mutex_lock(&journal->lock);
+	}
+
+	while (journal->locked)
+		fibril_condvar_wait(&journal->cv, &journal->lock);
+
+	journal->handles++;
+	fibril_mutex_unlock(&journal->lock);
+}
+
+/** Finish a file system operation.
+ *
+ * @param journal Journal or @c NULL
+ *
+ */
+void ext4_journal_stop(ext4_journal_t *journal)
+{
+	bool commit;
+
+	if (journal == NULL)
+		return;
+
+	fibril_mutex_lock(&journal->lock);
+	assert(journal->handles > 0);
+	journal->handles--;
+	if (journal->handles == 0)
+		fibril_condvar_broadcast(&journal->cv);
+	commit = journal->commit_request && journal->handles == 0 &&
+	    !journal->locked;
+	fibril_mutex_unlock(&journal->lock);
+
+	if (commit)
+		(void) ext4_journal_commit(journal);
+}
+
+/** Add a dirty block to the running transaction.
+ *
+ * @param journal Journal
+ * @param block   Dirty block
+ * @param data    @c true if @a block is a file data block
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_dirty(ext4_journal_t *journal, block_t *block,
+    bool data)
+{
+	ext4_journal_buf_t *buf;
+	ht_link_t *link;
+	block_t *ref;
+	errno_t rc;
+
+	fibril_mutex_lock(&journal->lock);
+
+	link = hash_table_find(&journal->running, &block->lba);
+	if (link != NULL) {
+		/* A block reused for metadata must be logged */
+		buf = hash_table_get_inst(link, ext4_journal_buf_t, link);
+		if (!data)
+			buf->data = false;
+		fibril_mutex_unlock(&journal->lock);
+		return EOK;
+	}
+
+	buf = malloc(sizeof(ext4_journal_buf_t));
+	if (buf == NULL) {
+		fibril_mutex_unlock(&journal->lock);
+		return ENOMEM;
+	}
+
+	/*
+	 * Keep an extra reference, libblock does not write back blocks
+	 * which are still referenced.
+	 */
+	rc = block_get(&ref, block->service_id, block->lba, BLOCK_FLAGS_NOREAD);
+	if (rc != EOK) {
+		fibril_mutex_unlock(&journal->lock);
+		free(buf);
+		return rc;
+	}
+
+	assert(ref == block);
+	buf->block = ref;
+	buf->data = data;
+	hash_table_insert(&journal->running, &buf->link);
+	journal->running_count++;
+
+	if (!journal->timer_armed) {
+		journal->timer_armed = true;
+		fibril_timer_set(journal->timer, EXT4_JOURNAL_COMMIT_INTERVAL,
+		    ext4_journal_timer, journal);
+	}
+
+	if (journal->running_count >= journal->trans_max)
+		journal->commit_request = true;
+
+	fibril_mutex_unlock(&journal->lock);
+	return EOK;
+}
+
+/** Find journal of a device.
+ *
+ * @param service_id Device
+ *
+ * @return Journal or @c NULL if the device has no active journal
+ *
+ */
+static ext4_journal_t *ext4_journal_find(service_id_t service_id)
+{
+	fibril_mutex_lock(&journal_list_lock);
+
+	list_foreach(journal_list, link, ext4_journal_t, journal) {
+		if (journal->service_id == service_id) {
+			fibril_mutex_unlock(&journal_list_lock);
+			return journal;
+		}
+	}
+
+	fibril_mutex_unlock(&journal_list_lock);
+	return NULL;
+}
+
+/** Return a block to the cache, adding it to the running transaction.
+ *
+ * @param block Block
+ * @param data  @c true if @a block is a file data block
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_block_put(block_t *block, bool data)
+{
+	if (block->dirty) {
+		ext4_journal_t *journal = ext4_journal_find(block->service_id);
+
+		/* If this fails, the block is written in place right away */
+		if (journal != NULL)
+			(void) ext4_journal_dirty(journal, block, data);
+	}
+
+	return block_put(block);
+}
+
+/** Return a metadata block to the cache.
+ *
+ * This should be used instead of block_put() for metadata blocks. If the
+ * block is dirty and the file system is journalled, the block is added
+ * to the running transaction instead of being written in place.
+ *
+ * @param block Block
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_block_put(block_t *block)
+{
+	return ext4_journal_block_put(block, false);
+}
+
+/** Return a file data block to the cache.
+ *
+ * This should be used instead of block_put() for file data blocks. If
+ * the block is dirty and the file system is journalled, the block is
+ * written in place before the running transaction commits.
+ *
+ * @param block Block
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_data_block_put(block_t *block)
+{
+	return ext4_journal_block_put(block, true);
+}
+
+typedef struct {
+	block_t **blocks;
+	size_t size;
+	/** Number of metadata blocks, collected from the start */
+	size_t nmeta;
+	/** Number of data blocks, collected from the end */
+	size_t ndata;
+} ext4_journal_collect_t;
+
+static bool ext4_journal_collect(ht_link_t *item, void *arg)
+{
+	ext4_journal_collect_t *collect = (ext4_journal_collect_t *) arg;
+	ext4_journal_buf_t *buf = hash_table_get_inst(item, ext4_journal_buf_t,
+	    link);
+
+	if (buf->data)
+		collect->blocks[collect->size - ++collect->ndata] = buf->block;
+	else
+		collect->blocks[collect->nmeta++] = buf->block;
+
+	return true;
+}
+
+static int ext4_journal_block_cmp(const void *a, const void *b)
+{
+	const block_t *ba = *(const block_t **) a;
+	const block_t *bb = *(const block_t **) b;
+
+	if (ba->lba < bb->lba)
+		return -1;
+	return ba->lba > bb->lba ? 1 : 0;
+}
+
+/** Write a transaction to the log.
+ *
+ * The log must be empty. When this returns successfully, the transaction
+ * is committed, but the blocks have not been written in place yet.
+ *
+ * @param journal  Journal
+ * @param sequence Sequence number of the transaction
+ * @param blocks   Blocks sorted by address
+ * @param data     Contents of the blocks
+ * @param count    Number of blocks
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_journal_log(ext4_journal_t *journal, uint32_t sequence,
+    block_t **blocks, uint8_t *data, size_t count)
+{
+	ext4_journal_superblock_t *sb = journal->sb_block;
+	uint32_t bsize = journal->block_size;
+	bool *escaped;
+	uint8_t *desc;
+	errno_t rc;
+
+	desc = malloc(bsize);
+	escaped = calloc(count, sizeof(bool));
+	if (desc == NULL || escaped == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+
+	/* Point the journal at the transaction */
+	rc = ext4_journal_write_sb(journal, journal->first, sequence);
+	if (rc != EOK)
+		goto out;
+
+	uint32_t jblock = journal->first;
+	size_t i = 0;
+
+	while (i < count) {
+		ext4_journal_header_t *hdr = (ext4_journal_header_t *) desc;
+		ext4_journal_block_tag_t *tag = NULL;
+		size_t off = sizeof(ext4_journal_header_t);
+		size_t start = i;
+
+		memset(desc, 0, bsize);
+		hdr->magic = host2uint32_t_be(EXT4_JOURNAL_MAGIC);
+		hdr->blocktype = host2uint32_t_be(EXT4_JOURNAL_DESCRIPTOR_BLOCK);
+		hdr->sequence = host2uint32_t_be(sequence);
+
+		while (i < count) {
+			size_t need = journal->tag_bytes;
+			uint16_t flags = EXT4_JOURNAL_FLAG_SAME_UUID;
+			uint8_t *bdata = data + i * bsize;
+
+			if (i == start) {
+				need += EXT4_JOURNAL_UUID_SIZE;
+				flags = 0;
+			}
+
+			if (off + need > bsize)
+				break;
+
+			/* The log must not contain anything looking like a header */
+			if (uint32_t_be2host(*(uint32_t *) bdata) ==
+			    EXT4_JOURNAL_MAGIC) {
+				memset(bdata, 0, sizeof(uint32_t));
+				escaped[i] = true;
+				flags |= EXT4_JOURNAL_FLAG_ESCAPE;
+			}
+
+			tag = (ext4_journal_block_tag_t *) (desc + off);
+			tag->blocknr = host2uint32_t_be(LOWER32(blocks[i]->lba));
+			tag->flags = host2uint16_t_be(flags);
+			if ((journal->incompat &
+			    EXT4_JOURNAL_FEATURE_INCOMPAT_64BIT) != 0) {
+				tag->blocknr_high =
+				    host2uint32_t_be(UPPER32(blocks[i]->lba));
+			}
+
+			off += journal->tag_bytes;
+			if (i == start) {
+				memcpy(desc + off, sb->uuid, EXT4_JOURNAL_UUID_SIZE);
+				off += EXT4_JOURNAL_UUID_SIZE;
+			}
+
+			i++;
+		}
+
+		assert(tag != NULL);
+		tag->flags |= host2uint16_t_be(EXT4_JOURNAL_FLAG_LAST_TAG);
+
+		rc = ext4_journal_write(journal, jblock, 1, desc);
+		if (rc != EOK)
+			goto out;
+		jblock++;
+
+		rc = ext4_journal_write(journal, jblock, i - start,
+		    data + start * bsize);
+		if (rc != EOK)
+			goto out;
+		jblock += i - start;
+	}
+
+	/* The commit record must not get stable before the rest */
+	rc = ext4_journal_flush(journal);
+	if (rc != EOK)
+		goto out;
+
+	ext4_journal_header_t *hdr = (ext4_journal_header_t *) desc;
+	memset(desc, 0, bsize);
+	hdr->magic = host2uint32_t_be(EXT4_JOURNAL_MAGIC);
+	hdr->blocktype = host2uint32_t_be(EXT4_JOURNAL_COMMIT_BLOCK);
+	hdr->sequence = host2uint32_t_be(sequence);
+
+	rc = ext4_journal_write(journal, jblock, 1, desc);
+	if (rc != EOK)
+		goto out;
+
+	rc = ext4_journal_flush(journal);
+out:
+	if (escaped != NULL) {
+		/* Restore original contents for the in-place write */
+		for (i = 0; i < count; i++) {
+			if (escaped[i]) {
+				*(uint32_t *) (data + i * bsize) =
+				    host2uint32_t_be(EXT4_JOURNAL_MAGIC);
+			}
+		}
+	}
+
+	free(escaped);
+	free(desc);
+	return rc;
+}
+
+/** Write blocks to their home locations.
+ *
+ * @param journal Journal
+ * @param blocks  Blocks sorted by address
+ * @param data    Contents of the blocks
+ * @param count   Number of blocks
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_journal_checkpoint(ext4_journal_t *journal,
+    block_t **blocks, uint8_t *data, size_t count)
+{
+	errno_t rc;
+	size_t i = 0;
+
+	while (i < count) {
+		/* Write adjacent blocks together */
+		size_t n = 1;
+		while (i + n < count && blocks[i + n]->lba == blocks[i]->lba + n)
+			n++;
+
+		rc = block_write_direct(journal->service_id,
+		    blocks[i]->lba * journal->spb, n * journal->spb,
+		    data + i * journal->block_size);
+		if (rc != EOK)
+			return rc;
+
+		i += n;
+	}
+
+	return ext4_journal_flush(journal);
+}
+
+/** Commit the running transaction.
+ *
+ * Waits for running operations to finish, writes file data blocks of
+ * the transaction in place, logs the metadata blocks, then writes them
+ * in place and marks the log empty.
+ *
+ * @param journal Journal or @c NULL
+ *
+ * @return Error code
+ *
+ */
+errno_t ext4_journal_commit(ext4_journal_t *journal)
+{
+	ext4_journal_collect_t collect;
+	uint8_t *data = NULL;
+	uint32_t sequence;
+	uint32_t bsize;
+	size_t count;
+	errno_t rc;
+
+	if (journal == NULL)
+		return EOK;
+
+	bsize = journal->block_size;
+	fibril_mutex_lock(&journal->commit_lock);
+	fibril_mutex_lock(&journal->lock);
+
+	/* Wait for operations in progress, keep new ones from starting */
+	journal->locked = true;
+	while (journal->handles > 0)
+		fibril_condvar_wait(&journal->cv, &journal->lock);
+
+	/* Add changes in cached i-nodes and block groups to the transaction */
+	fibril_mutex_unlock(&journal->lock);
+	(void) ext4_filesystem_flush_refs(journal->fs, false);
+	fibril_mutex_lock(&journal->lock);
+
+	count = journal->running_count;
+	if (count == 0) {
+		journal->locked = false;
+		journal->commit_request = false;
+		fibril_condvar_broadcast(&journal->cv);
+		fibril_mutex_unlock(&journal->lock);
+		fibril_mutex_unlock(&journal->commit_lock);
+		return EOK;
+	}
+
+	collect.blocks = calloc(count, sizeof(block_t *));
+	collect.size = count;
+	collect.nmeta = 0;
+	collect.ndata = 0;
+	data = malloc(count * bsize);
+	if (collect.blocks == NULL || data == NULL) {
+		journal->locked = false;
+		fibril_condvar_broadcast(&journal->cv);
+		fibril_mutex_unlock(&journal->lock);
+		fibril_mutex_unlock(&journal->commit_lock);
+		free(collect.blocks);
+		free(data);
+		return ENOMEM;
+	}
+
+	/* Take over the running transaction */
+	hash_table_apply(&journal->running, ext4_journal_collect, &collect);
+	assert(collect.nmeta + collect.ndata == count);
+
+	size_t nmeta = collect.nmeta;
+	size_t ndata = collect.ndata;
+	block_t **mblocks = collect.blocks;
+	block_t **dblocks = collect.blocks + nmeta;
+	uint8_t *mdata = data;
+	uint8_t *ddata = data + nmeta * bsize;
+
+	qsort(mblocks, nmeta, sizeof(block_t *), ext4_journal_block_cmp);
+	qsort(dblocks, ndata, sizeof(block_t *), ext4_journal_block_cmp);
+
+	for (size_t i = 0; i < count; i++) {
+		memcpy(data + i * bsize, collect.blocks[i]->data, bsize);
+		collect.blocks[i]->dirty = false;
+	}
+
+	hash_table_clear(&journal->running);
+	journal->running_count = 0;
+	journal->commit_request = false;
+	journal->locked = false;
+	sequence = journal->sequence++;
+	fibril_condvar_broadcast(&journal->cv);
+	fibril_mutex_unlock(&journal->lock);
+
+	/* Data must be stable before the commit record referring to it */
+	errno_t rcd = EOK;
+	if (ndata > 0)
+		rcd = ext4_journal_checkpoint(journal, dblocks, ddata, ndata);
+
+	/* Number of tags fitting in a descriptor block */
+	size_t tags = (bsize - sizeof(ext4_journal_header_t) -
+	    EXT4_JOURNAL_UUID_SIZE) / journal->tag_bytes;
+	size_t ndesc = (nmeta + tags - 1) / tags;
+
+	rc = EOK;
+	if (rcd == EOK && nmeta > 0) {
+		if (ndesc + nmeta + 1 <= journal->max_len - journal->first) {
+			rc = ext4_journal_log(journal, sequence, mblocks,
+			    mdata, nmeta);
+		} else {
+			/* Transaction too large for the log */
+			rc = ENOSPC;
+		}
+	}
+
+	/*
+	 * If the transaction could not be logged, still write the blocks
+	 * in place. This is not atomic, but no worse than having no journal.
+	 * If the data could not be written, the metadata is held back too,
+	 * so that it cannot point to stale data.
+	 */
+	errno_t rc2 = rcd;
+	if (rcd == EOK && nmeta > 0) {
+		rc2 = ext4_journal_checkpoint(journal, mblocks, mdata, nmeta);
+
+		/* Mark the log empty */
+		if (rc2 == EOK) {
+			rc2 = ext4_journal_write_sb(journal, 0, sequence + 1);
+			if (rc2 == EOK)
+				rc2 = ext4_journal_flush(journal);
+		}
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		/* Blocks we could not write must not be lost */
+		if (rc2 != EOK && (i < nmeta || rcd != EOK))
+			collect.blocks[i]->dirty = true;
+		(void) block_put(collect.blocks[i]);
+	}
+
+	free(collect.blocks);
+	free(data);
+	fibril_mutex_unlock(&journal->commit_lock);
+
+	if (rc2 != EOK)
+		return rc2;
+	return rc == ENOSPC ? EOK : rc;
+}
+
+/**
+ * @}
+ */
@@ -50,6 +50,7 @@
 #include "ext4/directory_index.h"
 #include "ext4/extent.h"
 #include "ext4/inode.h"
+#include "ext4/journal.h"
 #include "ext4/ops.h"
 #include "ext4/filesystem.h"
 #include "ext4/fstypes.h"
@@ -75,6 +76,9 @@ static errno_t ext4_create_node(fs_node_t **, service_id_t, int);
 static errno_t ext4_destroy_node(fs_node_t *);
 static errno_t ext4_link(fs_node_t *, fs_node_t *, const char *);
 static errno_t ext4_unlink(fs_node_t *, fs_node_t *, const char *);
+static errno_t ext4_destroy_node_core(fs_node_t *);
+static errno_t ext4_link_core(fs_node_t *, fs_node_t *, const char *);
+static errno_t ext4_unlink_core(fs_node_t *, fs_node_t *, const char *);
 static errno_t ext4_has_children(bool *, fs_node_t *);
 static fs_index_t ext4_index_get(fs_node_t *);
 static aoff64_t ext4_size_get(fs_node_t *);
@@ -450,7 +454,9 @@ errno_t ext4_create_node(fs_node_t **rfn, service_id_t service_id, int flags)
 
 	/* Allocate new i-node in filesystem */
 	ext4_inode_ref_t *inode_ref;
+	ext4_journal_start(inst->filesystem->journal);
 	rc = ext4_filesystem_alloc_inode(inst->filesystem, &inode_ref, flags);
+	ext4_journal_stop(inst->filesystem->journal);
 	if (rc != EOK) {
 		free(enode);
 		free(fs_node);
@@ -485,6 +491,24 @@ errno_t ext4_create_node(fs_node_t **rfn, service_id_t service_id, int flags)
  *
  */
 errno_t ext4_destroy_node(fs_node_t *fn)
+{
+	ext4_journal_t *journal = EXT4_NODE(fn)->instance->filesystem->journal;
+
+	ext4_journal_start(journal);
+	errno_t rc = ext4_destroy_node_core(fn);
+	ext4_journal_stop(journal);
+
+	return rc;
+}
+
+/** Destroy existing node within a journal handle.
+ *
+ * @param fs Node to destroy
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_destroy_node_core(fs_node_t *fn)
 {
 	/* If directory, check for children */
 	bool has_children;
@@ -536,6 +560,27 @@ errno_t ext4_destroy_node(fs_node_t *fn)
  *
  */
 errno_t ext4_link(fs_node_t *pfn, fs_node_t *cfn, const char *name)
+{
+	ext4_journal_t *journal = EXT4_NODE(pfn)->instance->filesystem->journal;
+
+	ext4_journal_start(journal);
+	errno_t rc = ext4_link_core(pfn, cfn, name);
+	ext4_journal_stop(journal);
+
+	return rc;
+}
+
+/** Link the specfied node to directory within a journal handle.
+ *
+ * @param pfn  Parent node to link in
+ * @param cfn  Node to be linked
+ * @param name Name which will be assigned to directory entry
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_link_core(fs_node_t *pfn, fs_node_t *cfn,
+    const char *name)
 {
 	/* Check maximum name length */
 	if (str_size(name) > EXT4_DIRECTORY_FILENAME_LEN)
@@ -609,6 +654,27 @@ errno_t ext4_link(fs_node_t *pfn, fs_node_t *cfn, const char *name)
  *
  */
 errno_t ext4_unlink(fs_node_t *pfn, fs_node_t *cfn, const char *name)
+{
+	ext4_journal_t *journal = EXT4_NODE(pfn)->instance->filesystem->journal;
+
+	ext4_journal_start(journal);
+	errno_t rc = ext4_unlink_core(pfn, cfn, name);
+	ext4_journal_stop(journal);
+
+	return rc;
+}
+
+/** Unlink node from specified directory within a journal handle.
+ *
+ * @param pfn  Parent node to delete node from
+ * @param cfn  Child node to be unlinked from directory
+ * @param name Name of entry that will be removed
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_unlink_core(fs_node_t *pfn, fs_node_t *cfn,
+    const char *name)
 {
 	bool has_children;
 	errno_t rc = ext4_has_children(&has_children, cfn);
@@ -1179,6 +1245,105 @@ errno_t ext4_read_directory(ipc_call_t *call, aoff64_t pos, size_t size,
 	}
 }
 
+/** Read a batch of directory entries.
+ *
+ * @param service_id Device to read data from
+ * @param index      Number of directory node
+ * @param pos        Position of the first entry to read
+ * @param buf        Buffer to fill with packed entries
+ * @param size       Size of the buffer
+ * @param used       Output value, number of bytes used in the buffer
+ * @param npos       Output value, position of the next entry
+ *
+ * @return Error code
+ *
+ */
+static errno_t ext4_readdir(service_id_t service_id, fs_index_t index,
+    aoff64_t pos, void *buf, size_t size, size_t *used, aoff64_t *npos)
+{
+	char name[EXT4_DIRECTORY_FILENAME_LEN + 1];
+
+	ext4_instance_t *inst;
+	errno_t rc = ext4_instance_get(service_id, &inst);
+	if (rc != EOK)
+		return rc;
+
+	ext4_superblock_t *sb = inst->filesystem->superblock;
+
+	/* Load i-node */
+	ext4_inode_ref_t *inode_ref;
+	rc = ext4_filesystem_get_inode_ref(inst->filesystem, index, &inode_ref);
+	if (rc != EOK)
+		return rc;
+
+	if (!ext4_inode_is_type(sb, inode_ref->inode,
+	    EXT4_INODE_MODE_DIRECTORY)) {
+		ext4_filesystem_put_inode_ref(inode_ref);
+		return ENOTDIR;
+	}
+
+	ext4_directory_iterator_t it;
+	rc = ext4_directory_iterator_init(&it, inode_ref, pos);
+	if (rc != EOK) {
+		ext4_filesystem_put_inode_ref(inode_ref);
+		return rc;
+	}
+
+	*used = 0;
+	*npos = pos;
+
+	while (it.current != NULL) {
+		if (it.current->inode == 0)
+			goto next;
+
+		uint16_t name_size = ext4_directory_entry_ll_get_name_length(sb,
+		    it.current);
+
+		/* Skip . and .. */
+		if (ext4_is_dots(it.current->name, name_size))
+			goto next;
+
+		memcpy(name, it.current->name, name_size);
+		name[name_size] = '\0';
+
+		vfs_dirent_type_t type;
+		switch (ext4_directory_entry_ll_get_inode_type(sb,
+		    it.current)) {
+		case EXT4_DIRECTORY_FILETYPE_REG_FILE:
+			type = VFS_DIRENT_FILE;
+			break;
+		case EXT4_DIRECTORY_FILETYPE_DIR:
+			type = VFS_DIRENT_DIRECTORY;
+			break;
+		default:
+			type = VFS_DIRENT_UNKNOWN;
+			break;
+		}
+
+		if (!fs_dirent_pack(buf, size, used, name,
+		    ext4_directory_entry_ll_get_inode(it.current), type, 0, 0)) {
+			/* Buffer too small to hold even a single entry */
+			if (*used == 0)
+				rc = EOVERFLOW;
+			break;
+		}
+
+	next:
+		rc = ext4_directory_iterator_next(&it);
+		if (rc != EOK)
+			break;
+
+		*npos = it.current_offset;
+	}
+
+	errno_t rc2 = ext4_directory_iterator_fini(&it);
+	if (rc == EOK)
+		rc = rc2;
+
+	rc2 = ext4_filesystem_put_inode_ref(inode_ref);
+	return rc == EOK ? rc2 : rc;
+}
+
 /** Read data from file.
  *
  * @param call      IPC call
@@ -1289,6 +1454,9 @@ static errno_t ext4_write(service_id_t service_id, fs_index_t index, aoff64_t po
 	if (rc != EOK)
 		return rc;
 
+	ext4_journal_t *journal = EXT4_NODE(fn)->instance->filesystem->journal;
+	ext4_journal_start(journal);
+
 	ipc_call_t call;
 	size_t len;
 	if (!async_data_write_receive(&call, &len)) {
@@ -1326,27 +1494,36 @@ static errno_t ext4_write(service_id_t service_id, fs_index_t index, aoff64_t po
 		if ((ext4_superblock_has_feature_incompatible(fs->superblock,
 		    EXT4_FEATURE_INCOMPAT_EXTENTS)) &&
 		    (ext4_inode_has_flag(inode_ref->inode, EXT4_INODE_FLAG_EXTENTS))) {
-			uint32_t last_iblock =
-			    ext4_inode_get_size(fs->superblock, inode_ref->inode) /
+			uint64_t inode_size =
+			    ext4_inode_get_size(fs->superblock, inode_ref->inode);
+			uint32_t last_iblock = (inode_size + block_size - 1) /
 			    block_size;
+			uint32_t count;
 
+			/* Fill the gap before the target block in large runs */
 			while (last_iblock < iblock) {
-				rc = ext4_extent_append_block(inode_ref, &last_iblock,
-				    &fblock, true);
+				rc = ext4_extent_append_blocks(inode_ref,
+				    iblock - last_iblock, &last_iblock, &fblock,
+				    &count, true);
 				if (rc != EOK) {
 					async_answer_0(&call, rc);
 					goto exit;
 				}
+
+				last_iblock += count;
 			}
 
-			rc = ext4_extent_append_block(inode_ref, &last_iblock,
-			    &fblock, false);
+			rc = ext4_extent_append_blocks(inode_ref, 1, &last_iblock,
+			    &fblock, &count, false);
 			if (rc != EOK) {
 				async_answer_0(&call, rc);
 				goto exit;
 			}
 		} else {
-			rc = ext4_balloc_alloc_block(inode_ref, &fblock);
+			uint32_t count;
+
+			rc = ext4_balloc_alloc_blocks(inode_ref, 0, 1, &fblock,
+			    &count);
 			if (rc != EOK) {
 				async_answer_0(&call, rc);
 				goto exit;
@@ -1385,7 +1562,7 @@ static errno_t ext4_write(service_id_t service_id, fs_index_t index, aoff64_t po
 
 	write_block->dirty = true;
 
-	rc = block_put(write_block);
+	rc = ext4_data_block_put(write_block);
 	if (rc != EOK)
 		goto exit;
 
@@ -1402,6 +1579,7 @@ static errno_t ext4_write(service_id_t service_id, fs_index_t index, aoff64_t po
 
 exit:
 	rc2 = ext4_node_put(fn);
+	ext4_journal_stop(journal);
 	return rc == EOK ? rc2 : rc;
 }
 
@@ -1426,9 +1604,12 @@ static errno_t ext4_truncate(service_id_t service_id, fs_index_t index,
 
 	ext4_node_t *enode = EXT4_NODE(fn);
 	ext4_inode_ref_t *inode_ref = enode->inode_ref;
+	ext4_journal_t *journal = enode->instance->filesystem->journal;
 
+	ext4_journal_start(journal);
 	rc = ext4_filesystem_truncate_inode(inode_ref, new_size);
 	errno_t const rc2 = ext4_node_put(fn);
+	ext4_journal_stop(journal);
 
 	return rc == EOK ? rc2 : rc;
 }
@@ -1479,9 +1660,20 @@ static errno_t ext4_sync(service_id_t service_id, fs_index_t index)
 		return rc;
 
 	ext4_node_t *enode = EXT4_NODE(fn);
+	ext4_filesystem_t *fs = enode->instance->filesystem;
 	enode->inode_ref->dirty = true;
 
-	return ext4_node_put(fn);
+	rc = ext4_node_put(fn);
+	if (rc != EOK)
+		return rc;
+
+	/* Write back cached i-nodes and block group descriptors */
+	rc = ext4_filesystem_flush_refs(fs, false);
+	if (rc != EOK)
+		return rc;
+
+	/* Make all metadata changes durable */
+	return ext4_journal_commit(fs->journal);
 }
 
 /** VFS operations
@@ -1496,7 +1688,8 @@ vfs_out_ops_t ext4_ops = {
 	.truncate = ext4_truncate,
 	.close = ext4_close,
 	.destroy = ext4_destroy,
-	.sync = ext4_sync
+	.sync = ext4_sync,
+	.readdir = ext4_readdir
 };
 
 /**
@@ -988,6 +988,18 @@ void ext4_superblock_set_last_orphan(ext4_superblock_t *sb,
 	sb->last_orphan = host2uint32_t_le(last_orphan);
 }
 
+/** Get number of the i-node holding the journal.
+ *
+ * @param sb Superblock
+ *
+ * @return Journal i-node number or 0 if the journal is external
+ *
+ */
+uint32_t ext4_superblock_get_journal_inode_number(ext4_superblock_t *sb)
+{
+	return uint32_t_le2host(sb->journal_inode_number);
+}
+
 /** Get hash seed for directory index hash function.
  *
  * @param sb Superblock
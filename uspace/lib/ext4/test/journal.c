@@ -0,0 +1,432 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <async.h>
+#include <bd_srv.h>
+#include <block.h>
+#include <byteorder.h>
+#include <errno.h>
+#include <ext4/filesystem.h>
+#include <ext4/journal.h>
+#include <ext4/types.h>
+#include <loc.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdlib.h>
+#include "../private/journal.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(journal);
+
+/** Block size of the test disk (and of the file system) */
+#define TEST_BSIZE 1024
+/** Number of blocks of the test disk */
+#define TEST_NBLOCKS 64
+/** First block of the journal on the test disk */
+#define TEST_JSTART 32
+/** Maximum number of recorded writes */
+#define TEST_MAX_WRITES 64
+
+static const char *test_journal_server = "test-ext4-journal";
+static const char *test_journal_svc = "test/ext4-journal";
+
+/** Memory-backed test disk */
+typedef struct {
+	uint8_t data[TEST_NBLOCKS * TEST_BSIZE];
+	/** Addresses of written blocks in the order of writing */
+	aoff64_t writes[TEST_MAX_WRITES];
+	size_t nwrites;
+} test_disk_t;
+
+/** Test environment */
+typedef struct {
+	test_disk_t disk;
+	bd_srvs_t srvs;
+	loc_srv_t *srv;
+	service_id_t sid;
+	ext4_filesystem_t fs;
+	ext4_journal_t *journal;
+} test_env_t;
+
+static void test_bd_conn(ipc_call_t *, void *);
+static errno_t test_bd_open(bd_srvs_t *, bd_srv_t *);
+static errno_t test_bd_close(bd_srv_t *);
+static errno_t test_bd_read_blocks(bd_srv_t *, aoff64_t, size_t, void *,
+    size_t);
+static errno_t test_bd_write_blocks(bd_srv_t *, aoff64_t, size_t,
+    const void *, size_t);
+static errno_t test_bd_get_block_size(bd_srv_t *, size_t *);
+static errno_t test_bd_get_num_blocks(bd_srv_t *, aoff64_t *);
+
+static bd_ops_t test_bd_ops = {
+	.open = test_bd_open,
+	.close = test_bd_close,
+	.read_blocks = test_bd_read_blocks,
+	.write_blocks = test_bd_write_blocks,
+	.get_block_size = test_bd_get_block_size,
+	.get_num_blocks = test_bd_get_num_blocks
+};
+
+/** Set up test disk, journal and fake file system.
+ *
+ * The journal occupies the second half of the disk and is empty.
+ */
+static void test_env_init(test_env_t *env)
+{
+	ext4_journal_superblock_t *jsb;
+	errno_t rc;
+
+	memset(env, 0, sizeof(test_env_t));
+	list_initialize(&env->fs.inode_lru);
+	list_initialize(&env->fs.bg_lru);
+
+	bd_srvs_init(&env->srvs);
+	env->srvs.ops = &test_bd_ops;
+	env->srvs.sarg = &env->disk;
+
+	async_set_fallback_port_handler(test_bd_conn, &env->srvs);
+
+	// FIXME This causes this test to be non-reentrant!
+	rc = loc_server_register(test_journal_server, &env->srv);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = loc_service_register(env->srv, test_journal_svc, fallback_port_id,
+	    &env->sid);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = block_init(env->sid);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	env->fs.device = env->sid;
+
+	env->journal = calloc(1, sizeof(ext4_journal_t));
+	PCUT_ASSERT_NOT_NULL(env->journal);
+
+	env->journal->fs = &env->fs;
+	env->journal->service_id = env->sid;
+	env->journal->block_size = TEST_BSIZE;
+	env->journal->spb = 1;
+
+	env->journal->runs = calloc(1, sizeof(ext4_journal_run_t));
+	PCUT_ASSERT_NOT_NULL(env->journal->runs);
+	env->journal->runs[0].jblock = 0;
+	env->journal->runs[0].fblock = TEST_JSTART;
+	env->journal->runs[0].count = TEST_NBLOCKS - TEST_JSTART;
+	env->journal->nruns = 1;
+
+	env->journal->sb_block = calloc(1, TEST_BSIZE);
+	PCUT_ASSERT_NOT_NULL(env->journal->sb_block);
+
+	env->journal->first = 1;
+	env->journal->max_len = TEST_NBLOCKS - TEST_JSTART;
+	env->journal->sequence = 1;
+	env->journal->tag_bytes = sizeof(ext4_journal_block_tag_t) -
+	    sizeof(uint32_t);
+
+	jsb = env->journal->sb_block;
+	jsb->header.magic = host2uint32_t_be(EXT4_JOURNAL_MAGIC);
+	jsb->header.blocktype = host2uint32_t_be(EXT4_JOURNAL_SUPERBLOCK_V2);
+	jsb->block_size = host2uint32_t_be(TEST_BSIZE);
+	jsb->max_len = host2uint32_t_be(env->journal->max_len);
+	jsb->first = host2uint32_t_be(env->journal->first);
+	jsb->sequence = host2uint32_t_be(1);
+	memcpy(env->disk.data + TEST_JSTART * TEST_BSIZE, jsb, TEST_BSIZE);
+}
+
+/** Tear down test environment.
+ *
+ * @param env Test environment
+ * @param active @c true if the journal was activated
+ */
+static void test_env_fini(test_env_t *env, bool active)
+{
+	errno_t rc;
+
+	if (active) {
+		rc = ext4_journal_close(env->journal);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+		rc = block_cache_fini(env->sid);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	} else {
+		free(env->journal->runs);
+		free(env->journal->sb_block);
+		free(env->journal);
+	}
+
+	block_fini(env->sid);
+
+	rc = loc_service_unregister(env->srv, env->sid);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	loc_server_unregister(env->srv);
+}
+
+/** Get block of the test disk. */
+static uint8_t *test_disk_block(test_env_t *env, aoff64_t ba)
+{
+	return env->disk.data + ba * TEST_BSIZE;
+}
+
+/** Find first write of a block.
+ *
+ * @return Index of the write or TEST_MAX_WRITES if not written
+ */
+static size_t test_disk_find_write(test_env_t *env, aoff64_t ba)
+{
+	for (size_t i = 0; i < env->disk.nwrites; i++) {
+		if (env->disk.writes[i] == ba)
+			return i;
+	}
+
+	return TEST_MAX_WRITES;
+}
+
+/** Logged transaction is replayed */
+PCUT_TEST(recover_committed)
+{
+	test_env_t *env;
+	block_t blk[2];
+	block_t *blocks[2];
+	uint8_t *data;
+	ext4_journal_superblock_t *jsb;
+	errno_t rc;
+
+	env = malloc(sizeof(test_env_t));
+	PCUT_ASSERT_NOT_NULL(env);
+	test_env_init(env);
+
+	data = malloc(2 * TEST_BSIZE);
+	PCUT_ASSERT_NOT_NULL(data);
+
+	memset(blk, 0, sizeof(blk));
+	blk[0].lba = 5;
+	blk[1].lba = 6;
+	blocks[0] = &blk[0];
+	blocks[1] = &blk[1];
+
+	memset(data, 0xa5, TEST_BSIZE);
+	memset(data + TEST_BSIZE, 0x5a, TEST_BSIZE);
+
+	/* Second block looks like a journal header, it must be escaped */
+	*(uint32_t *) (data + TEST_BSIZE) =
+	    host2uint32_t_be(EXT4_JOURNAL_MAGIC);
+
+	rc = ext4_journal_log(env->journal, 1, blocks, data, 2);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* The blocks are not written in place yet (crash) */
+	PCUT_ASSERT_INT_EQUALS(0, test_disk_block(env, 5)[0]);
+	PCUT_ASSERT_INT_EQUALS(0, test_disk_block(env, 6)[0]);
+
+	rc = ext4_journal_recover(env->journal);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(test_disk_block(env, 5), data,
+	    TEST_BSIZE));
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(test_disk_block(env, 6),
+	    data + TEST_BSIZE, TEST_BSIZE));
+
+	/* The log is empty and the next transaction follows */
+	jsb = (ext4_journal_superblock_t *) test_disk_block(env, TEST_JSTART);
+	PCUT_ASSERT_INT_EQUALS(0, uint32_t_be2host(jsb->start));
+	PCUT_ASSERT_INT_EQUALS(2, uint32_t_be2host(jsb->sequence));
+
+	free(data);
+	test_env_fini(env, false);
+	free(env);
+}
+
+/** Transaction without commit record is not replayed */
+PCUT_TEST(recover_uncommitted)
+{
+	test_env_t *env;
+	block_t blk;
+	block_t *blocks[1];
+	uint8_t *data;
+	ext4_journal_superblock_t *jsb;
+	errno_t rc;
+
+	env = malloc(sizeof(test_env_t));
+	PCUT_ASSERT_NOT_NULL(env);
+	test_env_init(env);
+
+	data = malloc(TEST_BSIZE);
+	PCUT_ASSERT_NOT_NULL(data);
+
+	memset(&blk, 0, sizeof(blk));
+	blk.lba = 5;
+	blocks[0] = &blk;
+	memset(data, 0xa5, TEST_BSIZE);
+
+	rc = ext4_journal_log(env->journal, 1, blocks, data, 1);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Lose the commit record (after descriptor and one data block) */
+	memset(test_disk_block(env, TEST_JSTART + 3), 0, TEST_BSIZE);
+
+	rc = ext4_journal_recover(env->journal);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_INT_EQUALS(0, test_disk_block(env, 5)[0]);
+
+	/* The log is empty, the transaction is dropped */
+	jsb = (ext4_journal_superblock_t *) test_disk_block(env, TEST_JSTART);
+	PCUT_ASSERT_INT_EQUALS(0, uint32_t_be2host(jsb->start));
+	PCUT_ASSERT_INT_EQUALS(1, uint32_t_be2host(jsb->sequence));
+
+	free(data);
+	test_env_fini(env, false);
+	free(env);
+}
+
+/** Data blocks are written before the commit record (ordered mode) */
+PCUT_TEST(commit_ordered)
+{
+	test_env_t *env;
+	block_t *mblock;
+	block_t *dblock;
+	errno_t rc;
+
+	env = malloc(sizeof(test_env_t));
+	PCUT_ASSERT_NOT_NULL(env);
+	test_env_init(env);
+
+	rc = block_cache_init(env->sid, TEST_BSIZE, 0, CACHE_MODE_WB);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = ext4_journal_activate(env->journal);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	ext4_journal_start(env->journal);
+
+	rc = block_get(&mblock, env->sid, 5, BLOCK_FLAGS_NOREAD);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	memset(mblock->data, 0xa5, TEST_BSIZE);
+	mblock->dirty = true;
+	rc = ext4_block_put(mblock);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = block_get(&dblock, env->sid, 10, BLOCK_FLAGS_NOREAD);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	memset(dblock->data, 0x5a, TEST_BSIZE);
+	dblock->dirty = true;
+	rc = ext4_data_block_put(dblock);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	ext4_journal_stop(env->journal);
+
+	/* Nothing is written before commit */
+	PCUT_ASSERT_INT_EQUALS(0, env->disk.nwrites);
+
+	rc = ext4_journal_commit(env->journal);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/*
+	 * Log: superblock, descriptor, metadata block, commit record.
+	 * The data block is not logged.
+	 */
+	size_t commit = test_disk_find_write(env, TEST_JSTART + 3);
+	size_t dwrite = test_disk_find_write(env, 10);
+	size_t mwrite = test_disk_find_write(env, 5);
+
+	PCUT_ASSERT_TRUE(commit < TEST_MAX_WRITES);
+	PCUT_ASSERT_TRUE(dwrite < commit);
+	PCUT_ASSERT_TRUE(commit < mwrite && mwrite < TEST_MAX_WRITES);
+
+	PCUT_ASSERT_INT_EQUALS(0x5a, test_disk_block(env, 10)[0]);
+	PCUT_ASSERT_INT_EQUALS(0xa5, test_disk_block(env, 5)[0]);
+	PCUT_ASSERT_INT_EQUALS(0xa5, test_disk_block(env, TEST_JSTART + 2)[0]);
+
+	test_env_fini(env, true);
+	free(env);
+}
+
+static void test_bd_conn(ipc_call_t *icall, void *arg)
+{
+	bd_srvs_t *srvs = (bd_srvs_t *) arg;
+
+	bd_conn(icall, srvs);
+}
+
+static errno_t test_bd_open(bd_srvs_t *bds, bd_srv_t *bd)
+{
+	return EOK;
+}
+
+static errno_t test_bd_close(bd_srv_t *bd)
+{
+	return EOK;
+}
+
+static errno_t test_bd_read_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
+    void *buf, size_t size)
+{
+	test_disk_t *disk = (test_disk_t *) bd->srvs->sarg;
+
+	if (ba > TEST_NBLOCKS || cnt > TEST_NBLOCKS - ba)
+		return ELIMIT;
+	if (size < cnt * TEST_BSIZE)
+		return EINVAL;
+
+	memcpy(buf, disk->data + ba * TEST_BSIZE, cnt * TEST_BSIZE);
+	return EOK;
+}
+
+static errno_t test_bd_write_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
+    const void *buf, size_t size)
+{
+	test_disk_t *disk = (test_disk_t *) bd->srvs->sarg;
+
+	if (ba > TEST_NBLOCKS || cnt > TEST_NBLOCKS - ba)
+		return ELIMIT;
+	if (size < cnt * TEST_BSIZE)
+		return EINVAL;
+
+	memcpy(disk->data + ba * TEST_BSIZE, buf, cnt * TEST_BSIZE);
+
+	for (size_t i = 0; i < cnt; i++) {
+		if (disk->nwrites < TEST_MAX_WRITES)
+			disk->writes[disk->nwrites++] = ba + i;
+	}
+
+	return EOK;
+}
+
+static errno_t test_bd_get_block_size(bd_srv_t *bd, size_t *rsize)
+{
+	*rsize = TEST_BSIZE;
+	return EOK;
+}
+
+static errno_t test_bd_get_num_blocks(bd_srv_t *bd, aoff64_t *rnb)
+{
+	*rnb = TEST_NBLOCKS;
+	return EOK;
+}
+
+PCUT_EXPORT(journal);
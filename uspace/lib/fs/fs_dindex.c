@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libfs
+ * @{
+ */
+/**
+ * @file
+ * In-memory name index of a directory.
+ *
+ * File systems which store directories as unsorted lists of entries
+ * (e.g. FAT) can use this to avoid scanning the whole directory for every
+ * looked up name. The index maps case-folded names to positions of the
+ * corresponding directory entries.
+ */
+
+#include "libfs.h"
+#include <adt/hash.h>
+#include <adt/hash_table.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <str.h>
+
+struct fs_dindex {
+	/** Entries hashed by folded name */
+	hash_table_t entries;
+};
+
+typedef struct {
+	ht_link_t link;
+	/** Folded name */
+	char *key;
+	/** Position of the directory entry */
+	aoff64_t pos;
+} fs_dindex_entry_t;
+
+/** Fold name for case-insensitive comparison.
+ *
+ * This matches the case folding done by str_casecmp().
+ *
+ * @param name Name
+ * @return Newly allocated folded name or @c NULL if out of memory
+ */
+static char *fs_dindex_fold(const char *name)
+{
+	char *key = str_dup(name);
+	if (key == NULL)
+		return NULL;
+
+	for (char *p = key; *p != '\0'; p++)
+		*p = tolower(*p);
+
+	return key;
+}
+
+static size_t fs_dindex_key_hash(const void *key)
+{
+	return hash_string((const char *) key);
+}
+
+static size_t fs_dindex_hash(const ht_link_t *item)
+{
+	fs_dindex_entry_t *entry = hash_table_get_inst(item,
+	    fs_dindex_entry_t, link);
+	return hash_string(entry->key);
+}
+
+static bool fs_dindex_key_equal(const void *key, size_t hash,
+    const ht_link_t *item)
+{
+	fs_dindex_entry_t *entry = hash_table_get_inst(item,
+	    fs_dindex_entry_t, link);
+	return str_cmp((const char *) key, entry->key) == 0;
+}
+
+static void fs_dindex_remove_callback(ht_link_t *item)
+{
+	fs_dindex_entry_t *entry = hash_table_get_inst(item,
+	    fs_dindex_entry_t, link);
+	free(entry->key);
+	free(entry);
+}
+
+static const hash_table_ops_t fs_dindex_ops = {
+	.hash = fs_dindex_hash,
+	.key_hash = fs_dindex_key_hash,
+	.key_equal = fs_dindex_key_equal,
+	.equal = NULL,
+	.remove_callback = fs_dindex_remove_callback
+};
+
+/** Create empty directory name index.
+ *
+ * @param rdindex Place to store pointer to the new index
+ * @return EOK on success or ENOMEM
+ */
+errno_t fs_dindex_create(fs_dindex_t **rdindex)
+{
+	fs_dindex_t *dindex;
+
+	dindex = calloc(1, sizeof(fs_dindex_t));
+	if (dindex == NULL)
+		return ENOMEM;
+
+	if (!hash_table_create(&dindex->entries, 0, 0, &fs_dindex_ops)) {
+		free(dindex);
+		return ENOMEM;
+	}
+
+	*rdindex = dindex;
+	return EOK;
+}
+
+/** Destroy directory name index.
+ *
+ * @param dindex Directory name index or @c NULL
+ */
+void fs_dindex_destroy(fs_dindex_t *dindex)
+{
+	if (dindex == NULL)
+		return;
+
+	hash_table_destroy(&dindex->entries);
+	free(dindex);
+}
+
+/** Insert name into directory name index.
+ *
+ * @param dindex Directory name index
+ * @param name Name of the directory entry
+ * @param pos Position of the directory entry
+ * @return EOK on success or ENOMEM
+ */
+errno_t fs_dindex_insert(fs_dindex_t *dindex, const char *name, aoff64_t pos)
+{
+	fs_dindex_entry_t *entry;
+
+	entry = malloc(sizeof(fs_dindex_entry_t));
+	if (entry == NULL)
+		return ENOMEM;
+
+	entry->key = fs_dindex_fold(name);
+	if (entry->key == NULL) {
+		free(entry);
+		return ENOMEM;
+	}
+
+	entry->pos = pos;
+	hash_table_insert(&dindex->entries, &entry->link);
+	return EOK;
+}
+
+/** Remove name from directory name index.
+ *
+ * @param dindex Directory name index
+ * @param name Name of the directory entry
+ * @param pos Position of the directory entry
+ * @return @c true if the entry was found and removed
+ */
+bool fs_dindex_remove(fs_dindex_t *dindex, const char *name, aoff64_t pos)
+{
+	char *key = fs_dindex_fold(name);
+	if (key == NULL)
+		return false;
+
+	ht_link_t *link = hash_table_find(&dindex->entries, key);
+	free(key);
+
+	while (link != NULL) {
+		fs_dindex_entry_t *entry = hash_table_get_inst(link,
+		    fs_dindex_entry_t, link);
+		if (entry->pos == pos) {
+			hash_table_remove_item(&dindex->entries, link);
+			return true;
+		}
+
+		link = hash_table_find_next(&dindex->entries, link);
+	}
+
+	return false;
+}
+
+/** Look up name in directory name index.
+ *
+ * If there are several entries with the same name, the one with
+ * the lowest position is returned.
+ *
+ * @param dindex Directory name index
+ * @param name Name to look up
+ * @param rpos Place to store the position of the directory entry
+ * @return EOK on success, ENOENT if not found or ENOMEM
+ */
+errno_t fs_dindex_lookup(fs_dindex_t *dindex, const char *name,
+    aoff64_t *rpos)
+{
+	bool found = false;
+
+	char *key = fs_dindex_fold(name);
+	if (key == NULL)
+		return ENOMEM;
+
+	ht_link_t *link = hash_table_find(&dindex->entries, key);
+	free(key);
+
+	while (link != NULL) {
+		fs_dindex_entry_t *entry = hash_table_get_inst(link,
+		    fs_dindex_entry_t, link);
+		if (!found || entry->pos < *rpos)
+			*rpos = entry->pos;
+		found = true;
+
+		link = hash_table_find_next(&dindex->entries, link);
+	}
+
+	return found ? EOK : ENOENT;
+}
+
+/** @}
+ */
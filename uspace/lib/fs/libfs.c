@@ -35,6 +35,7 @@
  */
 
 #include "libfs.h"
+#include <align.h>
 #include <macros.h>
 #include <errno.h>
 #include <async.h>
@@ -63,6 +64,9 @@
 		return; \
 	} while (0)
 
+/** Maximum size of a single batched directory read reply */
+#define READDIR_BUF_MAX  (64 * 1024)
+
 static fs_reg_t reg;
 
 static vfs_out_ops_t *vfs_out_ops = NULL;
@@ -73,6 +77,7 @@ static char fs_name[FS_NAME_MAXLEN + 1];
 static void libfs_link(libfs_ops_t *, fs_handle_t, ipc_call_t *);
 static void libfs_lookup(libfs_ops_t *, fs_handle_t, ipc_call_t *);
 static void libfs_stat(libfs_ops_t *, fs_handle_t, ipc_call_t *);
+static void libfs_stat_bulk(libfs_ops_t *, fs_handle_t, ipc_call_t *);
 static void libfs_open_node(libfs_ops_t *, fs_handle_t, ipc_call_t *);
 static void libfs_statfs(libfs_ops_t *, fs_handle_t, ipc_call_t *);
 
@@ -166,6 +171,58 @@ static void vfs_out_read(ipc_call_t *req)
 		async_answer_0(req, rc);
 }
 
+static void vfs_out_readdir(ipc_call_t *req)
+{
+	service_id_t service_id = (service_id_t) ipc_get_arg1(req);
+	fs_index_t index = (fs_index_t) ipc_get_arg2(req);
+	aoff64_t pos = (aoff64_t) MERGE_LOUP32(ipc_get_arg3(req),
+	    ipc_get_arg4(req));
+	aoff64_t npos = pos;
+	size_t used = 0;
+	ipc_call_t call;
+	size_t size;
+	errno_t rc;
+
+	if (!async_data_read_receive(&call, &size)) {
+		async_answer_0(&call, EINVAL);
+		async_answer_0(req, EINVAL);
+		return;
+	}
+
+	if (vfs_out_ops->readdir == NULL) {
+		async_answer_0(&call, ENOTSUP);
+		async_answer_0(req, ENOTSUP);
+		return;
+	}
+
+	if (size > READDIR_BUF_MAX)
+		size = READDIR_BUF_MAX;
+
+	void *buf = malloc(size);
+	if (buf == NULL) {
+		async_answer_0(&call, ENOMEM);
+		async_answer_0(req, ENOMEM);
+		return;
+	}
+
+	rc = vfs_out_ops->readdir(service_id, index, pos, buf, size, &used,
+	    &npos);
+	if (rc != EOK) {
+		free(buf);
+		async_answer_0(&call, rc);
+		async_answer_0(req, rc);
+		return;
+	}
+
+	rc = async_data_read_finalize(&call, buf, used);
+	free(buf);
+
+	if (rc == EOK)
+		async_answer_3(req, EOK, used, LOWER32(npos), UPPER32(npos));
+	else
+		async_answer_0(req, rc);
+}
+
 static void vfs_out_write(ipc_call_t *req)
 {
 	service_id_t service_id = (service_id_t) ipc_get_arg1(req);
@@ -236,6 +293,11 @@ static void vfs_out_stat(ipc_call_t *req)
 	libfs_stat(libfs_ops, reg.fs_handle, req);
 }
 
+static void vfs_out_stat_bulk(ipc_call_t *req)
+{
+	libfs_stat_bulk(libfs_ops, reg.fs_handle, req);
+}
+
 static void vfs_out_sync(ipc_call_t *req)
 {
 	service_id_t service_id = (service_id_t) ipc_get_arg1(req);
@@ -313,6 +375,9 @@ static void vfs_connection(ipc_call_t *icall, void *arg)
 		case VFS_OUT_READ:
 			vfs_out_read(&call);
 			break;
+		case VFS_OUT_READDIR:
+			vfs_out_readdir(&call);
+			break;
 		case VFS_OUT_WRITE:
 			vfs_out_write(&call);
 			break;
@@ -331,6 +396,9 @@ static void vfs_connection(ipc_call_t *icall, void *arg)
 		case VFS_OUT_STAT:
 			vfs_out_stat(&call);
 			break;
+		case VFS_OUT_STAT_BULK:
+			vfs_out_stat_bulk(&call);
+			break;
 		case VFS_OUT_SYNC:
 			vfs_out_sync(&call);
 			break;
@@ -433,6 +501,42 @@ void fs_node_initialize(fs_node_t *fn)
 	memset(fn, 0, sizeof(fs_node_t));
 }
 
+/** Append a directory entry to a batched directory read buffer.
+ *
+ * @param buf     Buffer being filled
+ * @param bsize   Size of the buffer
+ * @param used    Number of bytes already used, updated on success
+ * @param name    Entry name
+ * @param index   Node index or zero if not known
+ * @param type    Entry type
+ * @param flags   VFS_DIRENT_* flags
+ * @param size    Node size, valid if VFS_DIRENT_HAS_SIZE is in @a flags
+ *
+ * @return @c true if the entry was stored, @c false if it does not fit
+ */
+bool fs_dirent_pack(void *buf, size_t bsize, size_t *used, const char *name,
+    fs_index_t index, vfs_dirent_type_t type, uint8_t flags, aoff64_t size)
+{
+	size_t nsize = str_size(name) + 1;
+	size_t reclen = ALIGN_UP(sizeof(vfs_dirent_t) + nsize,
+	    sizeof(uint64_t));
+
+	if (reclen > UINT16_MAX || reclen > bsize - *used)
+		return false;
+
+	vfs_dirent_t *de = (vfs_dirent_t *) ((uint8_t *) buf + *used);
+	memset(de, 0, reclen);
+	de->reclen = reclen;
+	de->type = type;
+	de->flags = flags;
+	de->index = index;
+	de->size = size;
+	memcpy(de->name, name, nsize);
+
+	*used += reclen;
+	return true;
+}
+
 static char plb_get_char(unsigned pos)
 {
 	return reg.plb_ro[pos % PLB_SIZE];
@@ -713,6 +817,23 @@ out:
 		(void) ops->node_put(tmp);
 }
 
+/** Fill in file information for a node. */
+static void libfs_stat_fill(libfs_ops_t *ops, fs_handle_t fs_handle,
+    service_id_t service_id, fs_index_t index, fs_node_t *fn,
+    vfs_stat_t *stat)
+{
+	memset(stat, 0, sizeof(vfs_stat_t));
+
+	stat->fs_handle = fs_handle;
+	stat->service_id = service_id;
+	stat->index = index;
+	stat->lnkcnt = ops->lnkcnt_get(fn);
+	stat->is_file = ops->is_file(fn);
+	stat->is_directory = ops->is_directory(fn);
+	stat->size = ops->size_get(fn);
+	stat->service = ops->service_get(fn);
+}
+
 void libfs_stat(libfs_ops_t *ops, fs_handle_t fs_handle, ipc_call_t *req)
 {
 	service_id_t service_id = (service_id_t) ipc_get_arg1(req);
@@ -733,16 +854,7 @@ void libfs_stat(libfs_ops_t *ops, fs_handle_t fs_handle, ipc_call_t *req)
 	}
 
 	vfs_stat_t stat;
-	memset(&stat, 0, sizeof(vfs_stat_t));
-
-	stat.fs_handle = fs_handle;
-	stat.service_id = service_id;
-	stat.index = index;
-	stat.lnkcnt = ops->lnkcnt_get(fn);
-	stat.is_file = ops->is_file(fn);
-	stat.is_directory = ops->is_directory(fn);
-	stat.size = ops->size_get(fn);
-	stat.service = ops->service_get(fn);
+	libfs_stat_fill(ops, fs_handle, service_id, index, fn, &stat);
 
 	ops->node_put(fn);
 
@@ -750,6 +862,89 @@ void libfs_stat(libfs_ops_t *ops, fs_handle_t fs_handle, ipc_call_t *req)
 	async_answer_0(req, EOK);
 }
 
+/** Get information about several nodes in one request.
+ *
+ * The request carries an array of node indices. Two data reads follow,
+ * one for the array of vfs_stat_t structures and one for the array of
+ * per-node return codes.
+ */
+void libfs_stat_bulk(libfs_ops_t *ops, fs_handle_t fs_handle, ipc_call_t *req)
+{
+	service_id_t service_id = (service_id_t) ipc_get_arg1(req);
+	size_t count = (size_t) ipc_get_arg2(req);
+	fs_index_t *indices = NULL;
+	vfs_stat_t *stats = NULL;
+	errno_t *rcs = NULL;
+	ipc_call_t call;
+	size_t size;
+	errno_t rc;
+
+	if (count == 0 || count > VFS_STAT_BULK_MAX) {
+		rc = EINVAL;
+		if (async_data_write_receive(&call, NULL))
+			async_answer_0(&call, rc);
+		goto error;
+	}
+
+	rc = async_data_write_accept((void **) &indices, false,
+	    count * sizeof(fs_index_t), count * sizeof(fs_index_t), 0, NULL);
+	if (rc != EOK)
+		goto error;
+
+	stats = calloc(count, sizeof(vfs_stat_t));
+	rcs = calloc(count, sizeof(errno_t));
+	if (stats == NULL || rcs == NULL) {
+		rc = ENOMEM;
+		goto error;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		fs_node_t *fn;
+
+		rcs[i] = ops->node_get(&fn, service_id, indices[i]);
+		if (rcs[i] == EOK && fn == NULL)
+			rcs[i] = ENOENT;
+		if (rcs[i] != EOK)
+			continue;
+
+		libfs_stat_fill(ops, fs_handle, service_id, indices[i], fn,
+		    &stats[i]);
+		ops->node_put(fn);
+	}
+
+error:
+	/*
+	 * Answer the two data reads for the stat and return code arrays
+	 * even if the request failed so that the client is not left hanging.
+	 */
+	if (!async_data_read_receive(&call, &size)) {
+		async_answer_0(&call, EINVAL);
+		rc = EINVAL;
+	} else if (rc != EOK || size != count * sizeof(vfs_stat_t)) {
+		if (rc == EOK)
+			rc = EINVAL;
+		async_answer_0(&call, rc);
+	} else {
+		rc = async_data_read_finalize(&call, stats, size);
+	}
+
+	if (!async_data_read_receive(&call, &size)) {
+		async_answer_0(&call, EINVAL);
+		rc = EINVAL;
+	} else if (rc != EOK || size != count * sizeof(errno_t)) {
+		if (rc == EOK)
+			rc = EINVAL;
+		async_answer_0(&call, rc);
+	} else {
+		rc = async_data_read_finalize(&call, rcs, size);
+	}
+
+	free(indices);
+	free(stats);
+	free(rcs);
+	async_answer_0(req, rc);
+}
+
 void libfs_statfs(libfs_ops_t *ops, fs_handle_t fs_handle, ipc_call_t *req)
 {
 	service_id_t service_id = (service_id_t) ipc_get_arg1(req);
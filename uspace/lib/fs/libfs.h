@@ -52,6 +52,13 @@ typedef struct {
 	errno_t (*close)(service_id_t, fs_index_t);
 	errno_t (*destroy)(service_id_t, fs_index_t);
 	errno_t (*sync)(service_id_t, fs_index_t);
+	/*
+	 * Optional batched directory read. Fills the buffer with packed
+	 * vfs_dirent_t entries starting at the given position and returns
+	 * the number of bytes used and the position of the next entry.
+	 */
+	errno_t (*readdir)(service_id_t, fs_index_t, aoff64_t, void *, size_t,
+	    size_t *, aoff64_t *);
 } vfs_out_ops_t;
 
 typedef struct {
@@ -89,6 +96,9 @@ typedef struct {
 	errno_t (*free_block_count)(service_id_t, uint64_t *);
 } libfs_ops_t;
 
+/** In-memory name index of a directory. */
+typedef struct fs_dindex fs_dindex_t;
+
 typedef struct {
 	int fs_handle;           /**< File system handle. */
 	uint8_t *plb_ro;         /**< Read-only PLB view. */
@@ -98,11 +108,19 @@ extern errno_t fs_register(async_sess_t *, vfs_info_t *, vfs_out_ops_t *,
     libfs_ops_t *);
 
 extern void fs_node_initialize(fs_node_t *);
+extern bool fs_dirent_pack(void *, size_t, size_t *, const char *, fs_index_t,
+    vfs_dirent_type_t, uint8_t, aoff64_t);
 
 extern errno_t fs_instance_create(service_id_t, void *);
 extern errno_t fs_instance_get(service_id_t, void **);
 extern errno_t fs_instance_destroy(service_id_t);
 
+extern errno_t fs_dindex_create(fs_dindex_t **);
+extern void fs_dindex_destroy(fs_dindex_t *);
+extern errno_t fs_dindex_insert(fs_dindex_t *, const char *, aoff64_t);
+extern bool fs_dindex_remove(fs_dindex_t *, const char *, aoff64_t);
+extern errno_t fs_dindex_lookup(fs_dindex_t *, const char *, aoff64_t *);
+
 #endif
 
 /** @}
@@ -38,6 +38,7 @@
 #include <async.h>
 #include <inet/addr.h>
 #include <inet/eth_addr.h>
+#include <pbuf.h>
 
 struct iplink_ev_ops;
 
@@ -75,6 +76,8 @@ typedef struct {
 	void *data;
 	/** Size of @c data in bytes */
 	size_t size;
+	/** Packet buffer holding @c data (pool is @c NULL if none) */
+	pbuf_ref_t pbuf;
 } iplink_recv_sdu_t;
 
 typedef struct iplink_ev_ops {
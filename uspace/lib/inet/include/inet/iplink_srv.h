@@ -50,6 +50,8 @@ typedef struct {
 	struct iplink_ops *ops;
 	void *arg;
 	async_sess_t *client_sess;
+	/** Client does not accept packet buffer references */
+	bool no_pbuf;
 } iplink_srv_t;
 
 typedef struct iplink_ops {
@@ -68,6 +70,8 @@ extern void iplink_srv_init(iplink_srv_t *);
 
 extern errno_t iplink_conn(ipc_call_t *, void *);
 extern errno_t iplink_ev_recv(iplink_srv_t *, iplink_recv_sdu_t *, ip_ver_t);
+extern errno_t iplink_ev_recv_pbuf(iplink_srv_t *, iplink_recv_sdu_t *,
+    ip_ver_t);
 extern errno_t iplink_ev_change_addr(iplink_srv_t *, eth_addr_t *);
 
 #endif
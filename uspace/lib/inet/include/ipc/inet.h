@@ -35,21 +35,37 @@
 #ifndef LIBINET_IPC_INET_H
 #define LIBINET_IPC_INET_H
 
+#include <inet/addr.h>
 #include <ipc/common.h>
+#include <stddef.h>
 
 /** Requests on Inet default port */
 typedef enum {
 	INET_CALLBACK_CREATE = IPC_FIRST_USER_METHOD,
 	INET_GET_SRCADDR,
 	INET_SEND,
-	INET_SET_PROTO
+	INET_SET_PROTO,
+	INET_PBUF_POOL_SHARE
 } inet_request_t;
 
 /** Events on Inet default port */
 typedef enum {
-	INET_EV_RECV = IPC_FIRST_USER_METHOD
+	INET_EV_RECV = IPC_FIRST_USER_METHOD,
+	INET_EV_RECV_PBUF
 } inet_event_t;
 
+/** Datagram parameters passed with INET_EV_RECV_PBUF */
+typedef struct {
+	/** Source address */
+	inet_addr_t src;
+	/** Destination address */
+	inet_addr_t dest;
+	/** Offset of data within the packet buffer */
+	size_t offs;
+	/** Size of data */
+	size_t size;
+} inet_ev_recv_pbuf_t;
+
 /** Requests on Inet configuration port */
 typedef enum {
 	INETCFG_ADDR_CREATE_STATIC = IPC_FIRST_USER_METHOD,
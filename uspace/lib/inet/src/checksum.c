@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup libinet
+ * @{
+ */
+/**
+ * @file
+ * @brief Internet checksum (RFC 1071)
+ *
+ * The one's complement sum is independent of byte order (RFC 1071,
+ * section 2(B)), so the data is summed using native 32-bit loads into
+ * a 64-bit accumulator, which is only folded to 16 bits (and converted
+ * to network byte order) at the very end.
+ */
+
+#include <byteorder.h>
+#include <inet/checksum.h>
+#include <mem.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Word loaded from the data being summed */
+typedef uint32_t __attribute__((may_alias)) inet_checksum_word_t;
+
+/** Half-word loaded from the data being summed */
+typedef uint16_t __attribute__((may_alias)) inet_checksum_hword_t;
+
+/** One's complement addition.
+ *
+ * Result is a + b + carry.
+ */
+static uint16_t inet_ocadd16(uint16_t a, uint16_t b)
+{
+	uint32_t s;
+
+	s = (uint32_t)a + (uint32_t)b;
+	return (s & 0xffff) + (s >> 16);
+}
+
+/** Swap bytes of 16-bit value. */
+static uint16_t inet_checksum_swap(uint16_t v)
+{
+	return (v << 8) | (v >> 8);
+}
+
+/** Fold 64-bit one's complement accumulator to 16 bits.
+ *
+ * @param acc Accumulator
+ * @return One's complement sum of the 16-bit lanes of @a acc
+ */
+static uint16_t inet_checksum_fold(uint64_t acc)
+{
+	acc = (acc & 0xffffffff) + (acc >> 32);
+	acc = (acc & 0xffffffff) + (acc >> 32);
+	acc = (acc & 0xffff) + (acc >> 16);
+	acc = (acc & 0xffff) + (acc >> 16);
+	return (uint16_t)acc;
+}
+
+/** Compute one's complement sum of a block of data, optionally copying it.
+ *
+ * The first byte of the block is the most significant byte of the first
+ * 16-bit word. If the size is odd, the block is padded with a zero byte.
+ *
+ * @param dst  Destination buffer or @c NULL not to copy the data. It
+ *             must have the same alignment (modulo the word size) as @a src
+ * @param src  Data
+ * @param size Size of data in bytes
+ * @param copy @c true iff data should be copied to @a dst
+ * @return One's complement sum in host byte order
+ */
+static inline uint16_t inet_checksum_block(uint8_t *dst, const uint8_t *src,
+    size_t size, bool copy)
+{
+	const inet_checksum_word_t *sw;
+	inet_checksum_word_t *dw;
+	uint64_t acc;
+	uint16_t first;
+	uint16_t sum;
+	bool odd;
+	size_t i;
+
+	acc = 0;
+	first = 0;
+	odd = false;
+
+	/*
+	 * If the data starts at an odd address, sum the first byte
+	 * separately. The remaining data is then summed with its bytes
+	 * swapped, which is corrected for at the end.
+	 */
+	if (((uintptr_t)src & 1) != 0 && size > 0) {
+		odd = true;
+		first = (uint16_t)src[0] << 8;
+		if (copy)
+			*dst++ = src[0];
+		++src;
+		--size;
+	}
+
+	/* Align to word boundary */
+	if (((uintptr_t)src & 2) != 0 && size >= 2) {
+		acc += *(const inet_checksum_hword_t *)src;
+		if (copy) {
+			*(inet_checksum_hword_t *)dst =
+			    *(const inet_checksum_hword_t *)src;
+			dst += 2;
+		}
+		src += 2;
+		size -= 2;
+	}
+
+	sw = (const inet_checksum_word_t *)src;
+	dw = (inet_checksum_word_t *)dst;
+
+	/* Main loop, eight words per iteration */
+	while (size >= 8 * sizeof(inet_checksum_word_t)) {
+		if (copy) {
+			for (i = 0; i < 8; i++)
+				dw[i] = sw[i];
+			dw += 8;
+		}
+
+		acc += (uint64_t)sw[0] + sw[1] + sw[2] + sw[3];
+		acc += (uint64_t)sw[4] + sw[5] + sw[6] + sw[7];
+		sw += 8;
+		size -= 8 * sizeof(inet_checksum_word_t);
+	}
+
+	while (size >= sizeof(inet_checksum_word_t)) {
+		if (copy)
+			*dw++ = *sw;
+		acc += *sw++;
+		size -= sizeof(inet_checksum_word_t);
+	}
+
+	src = (const uint8_t *)sw;
+	dst = (uint8_t *)dw;
+
+	if (size >= 2) {
+		acc += *(const inet_checksum_hword_t *)src;
+		if (copy) {
+			*(inet_checksum_hword_t *)dst =
+			    *(const inet_checksum_hword_t *)src;
+			dst += 2;
+		}
+		src += 2;
+		size -= 2;
+	}
+
+	/* Trailing byte is padded with zero */
+	if (size > 0) {
+		acc += uint16_t_be2host((uint16_t)src[0] << 8);
+		if (copy)
+			*dst = src[0];
+	}
+
+	/* Convert sum of native 16-bit words to network byte order */
+	sum = uint16_t_be2host(inet_checksum_fold(acc));
+
+	if (odd)
+		sum = inet_ocadd16(first, inet_checksum_swap(sum));
+
+	return sum;
+}
+
+/** Compute Internet checksum.
+ *
+ * Checksum of data spanning multiple buffers can be computed by passing
+ * the result for the previous buffer as @a ivalue. All buffers except
+ * the last one must have an even size.
+ *
+ * @param ivalue Initial value (INET_CHECKSUM_INIT or checksum
+ *               of preceding data)
+ * @param data   Data
+ * @param size   Size of data in bytes
+ * @return Checksum (in host byte order)
+ */
+uint16_t inet_checksum_calc(uint16_t ivalue, const void *data, size_t size)
+{
+	uint16_t sum;
+
+	sum = inet_checksum_block(NULL, data, size, false);
+	return ~inet_ocadd16(~ivalue, sum);
+}
+
+/** Copy data and compute its Internet checksum.
+ *
+ * Equivalent to memcpy() followed by inet_checksum_calc(), but
+ * only passes through the data once if the buffers are suitably
+ * aligned.
+ *
+ * @param ivalue Initial value (INET_CHECKSUM_INIT or checksum
+ *               of preceding data)
+ * @param dst    Destination buffer
+ * @param src    Source buffer
+ * @param size   Size of data in bytes
+ * @return Checksum of the data (in host byte order)
+ */
+uint16_t inet_checksum_copy(uint16_t ivalue, void *dst, const void *src,
+    size_t size)
+{
+	uint16_t sum;
+
+	if ((((uintptr_t)dst ^ (uintptr_t)src) &
+	    (sizeof(inet_checksum_word_t) - 1)) != 0) {
+		/* Misaligned buffers, copy first */
+		memcpy(dst, src, size);
+		return inet_checksum_calc(ivalue, dst, size);
+	}
+
+	sum = inet_checksum_block(dst, src, size, true);
+	return ~inet_ocadd16(~ivalue, sum);
+}
+
+/** @}
+ */
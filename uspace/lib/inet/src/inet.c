@@ -33,6 +33,8 @@
 #include <ipc/inet.h>
 #include <ipc/services.h>
 #include <loc.h>
+#include <macros.h>
+#include <pbuf.h>
 #include <stdlib.h>
 
 static void inet_cb_conn(ipc_call_t *icall, void *arg);
@@ -233,6 +235,90 @@ static void inet_ev_recv(ipc_call_t *icall)
 	async_answer_0(icall, rc);
 }
 
+/** Map packet buffer pool of the Inet service.
+ *
+ * @param id Pool ID
+ * @param rpool Place to store pointer to pool
+ * @return EOK on success or an error code
+ */
+static errno_t inet_pbuf_pool_import(pbuf_pool_id_t id, pbuf_pool_t **rpool)
+{
+	sysarg_t size;
+	sysarg_t rid_lo;
+	sysarg_t rid_hi;
+
+	async_exch_t *exch = async_exchange_begin(inet_sess);
+	errno_t rc = async_req_2_3(exch, INET_PBUF_POOL_SHARE, LOWER32(id),
+	    UPPER32(id), &size, &rid_lo, &rid_hi);
+	if (rc == EOK)
+		rc = pbuf_pool_import(exch, id, size, rpool);
+	async_exchange_end(exch);
+
+	return rc;
+}
+
+static void inet_ev_recv_pbuf(ipc_call_t *icall)
+{
+	inet_dgram_t dgram;
+	inet_ev_recv_pbuf_t params;
+	pbuf_pool_t *pool;
+	errno_t rc;
+
+	dgram.tos = ipc_get_arg1(icall);
+	dgram.iplink = ipc_get_arg2(icall);
+	pbuf_pool_id_t pool_id = MERGE_LOUP32(ipc_get_arg3(icall),
+	    ipc_get_arg4(icall));
+	pbuf_id_t buf_id = ipc_get_arg5(icall);
+
+	ipc_call_t call;
+	size_t size;
+	if (!async_data_write_receive(&call, &size)) {
+		async_answer_0(&call, EINVAL);
+		async_answer_0(icall, EINVAL);
+		return;
+	}
+
+	if (size != sizeof(inet_ev_recv_pbuf_t)) {
+		async_answer_0(&call, EINVAL);
+		async_answer_0(icall, EINVAL);
+		return;
+	}
+
+	rc = async_data_write_finalize(&call, &params, size);
+	if (rc != EOK) {
+		async_answer_0(&call, rc);
+		async_answer_0(icall, rc);
+		return;
+	}
+
+	pool = pbuf_pool_find(pool_id);
+	if (pool == NULL) {
+		rc = inet_pbuf_pool_import(pool_id, &pool);
+		if (rc != EOK) {
+			/* Make the server send us a copy */
+			async_answer_0(icall, ENOTSUP);
+			return;
+		}
+	}
+
+	dgram.src = params.src;
+	dgram.dest = params.dest;
+	dgram.data = pbuf_get(pool, buf_id, params.offs, params.size);
+	dgram.size = params.size;
+	if (dgram.data == NULL) {
+		async_answer_0(icall, EINVAL);
+		return;
+	}
+
+	rc = inet_ev_ops->recv(&dgram);
+	if (rc == ENOTSUP) {
+		/* Would be mistaken for a request to copy */
+		rc = EIO;
+	}
+
+	async_answer_0(icall, rc);
+}
+
 static void inet_cb_conn(ipc_call_t *icall, void *arg)
 {
 	while (true) {
@@ -248,6 +334,9 @@ static void inet_cb_conn(ipc_call_t *icall, void *arg)
 		case INET_EV_RECV:
 			inet_ev_recv(&call);
 			break;
+		case INET_EV_RECV_PBUF:
+			inet_ev_recv_pbuf(&call);
+			break;
 		default:
 			async_answer_0(&call, ENOTSUP);
 		}
@@ -43,6 +43,8 @@
 #include <ipc/iplink.h>
 #include <ipc/services.h>
 #include <loc.h>
+#include <macros.h>
+#include <pbuf.h>
 #include <stdlib.h>
 
 static void iplink_cb_conn(ipc_call_t *icall, void *arg);
@@ -257,11 +259,85 @@ static void iplink_ev_recv(iplink_t *iplink, ipc_call_t *icall)
 		return;
 	}
 
+	sdu.pbuf.pool = NULL;
 	rc = iplink->ev_ops->recv(iplink, &sdu, ver);
 	free(sdu.data);
 	async_answer_0(icall, rc);
 }
 
+/** Map packet buffer pool of IP link.
+ *
+ * @param iplink IP link
+ * @param id Pool ID
+ * @param rpool Place to store pointer to pool
+ * @return EOK on success or an error code
+ */
+static errno_t iplink_pbuf_pool_import(iplink_t *iplink, pbuf_pool_id_t id,
+    pbuf_pool_t **rpool)
+{
+	sysarg_t size;
+	sysarg_t rid_lo;
+	sysarg_t rid_hi;
+
+	async_exch_t *exch = async_exchange_begin(iplink->sess);
+	errno_t rc = async_req_2_3(exch, IPLINK_PBUF_POOL_SHARE, LOWER32(id),
+	    UPPER32(id), &size, &rid_lo, &rid_hi);
+	if (rc == EOK)
+		rc = pbuf_pool_import(exch, id, size, rpool);
+	async_exchange_end(exch);
+
+	return rc;
+}
+
+static void iplink_ev_recv_pbuf(iplink_t *iplink, ipc_call_t *icall)
+{
+	iplink_recv_sdu_t sdu;
+	pbuf_pool_t *pool;
+	errno_t rc;
+
+	ip_ver_t ver = ipc_get_arg1(icall);
+	pbuf_pool_id_t pool_id = MERGE_LOUP32(ipc_get_arg2(icall),
+	    ipc_get_arg3(icall));
+	size_t pos = ipc_get_arg4(icall);
+	size_t size = ipc_get_arg5(icall);
+	size_t buf_size;
+	pbuf_id_t buf_id;
+	size_t offs;
+
+	pool = pbuf_pool_find(pool_id);
+	if (pool == NULL) {
+		rc = iplink_pbuf_pool_import(iplink, pool_id, &pool);
+		if (rc != EOK) {
+			/* Make the server send us a copy */
+			async_answer_0(icall, ENOTSUP);
+			return;
+		}
+	}
+
+	/* Split offset within the pool into buffer ID and offset */
+	buf_size = pbuf_pool_get_buf_size(pool);
+	buf_id = pos / buf_size;
+	offs = pos % buf_size;
+
+	sdu.data = pbuf_get(pool, buf_id, offs, size);
+	if (sdu.data == NULL) {
+		async_answer_0(icall, EINVAL);
+		return;
+	}
+
+	sdu.size = size;
+	sdu.pbuf.pool = pool;
+	sdu.pbuf.id = buf_id;
+
+	rc = iplink->ev_ops->recv(iplink, &sdu, ver);
+	if (rc == ENOTSUP) {
+		/* Would be mistaken for a request to copy */
+		rc = EIO;
+	}
+
+	async_answer_0(icall, rc);
+}
+
 static void iplink_ev_change_addr(iplink_t *iplink, ipc_call_t *icall)
 {
 	eth_addr_t *addr;
@@ -299,6 +375,9 @@ static void iplink_cb_conn(ipc_call_t *icall, void *arg)
 		case IPLINK_EV_CHANGE_ADDR:
 			iplink_ev_change_addr(iplink, &call);
 			break;
+		case IPLINK_EV_RECV_PBUF:
+			iplink_ev_recv_pbuf(iplink, &call);
+			break;
 		default:
 			async_answer_0(&call, ENOTSUP);
 		}
@@ -37,10 +37,12 @@
 #include <errno.h>
 #include <inet/eth_addr.h>
 #include <ipc/iplink.h>
+#include <macros.h>
 #include <stdlib.h>
 #include <stddef.h>
 #include <inet/addr.h>
 #include <inet/iplink_srv.h>
+#include <pbuf.h>
 
 static void iplink_get_mtu_srv(iplink_srv_t *srv, ipc_call_t *call)
 {
@@ -224,6 +226,18 @@ static void iplink_send6_srv(iplink_srv_t *srv, ipc_call_t *icall)
 	async_answer_0(icall, rc);
 }
 
+static void iplink_pbuf_pool_share_srv(iplink_srv_t *srv, ipc_call_t *call)
+{
+	pbuf_pool_id_t id = MERGE_LOUP32(ipc_get_arg1(call),
+	    ipc_get_arg2(call));
+
+	/*
+	 * Only pools that we have ourselves can be passed on. The client
+	 * only receives packets.
+	 */
+	pbuf_pool_export(call, pbuf_pool_find(id), false);
+}
+
 void iplink_srv_init(iplink_srv_t *srv)
 {
 	fibril_mutex_initialize(&srv->lock);
@@ -231,6 +245,7 @@ void iplink_srv_init(iplink_srv_t *srv)
 	srv->ops = NULL;
 	srv->arg = NULL;
 	srv->client_sess = NULL;
+	srv->no_pbuf = false;
 }
 
 errno_t iplink_conn(ipc_call_t *icall, void *arg)
@@ -256,6 +271,7 @@ errno_t iplink_conn(ipc_call_t *icall, void *arg)
 		return ENOMEM;
 
 	srv->client_sess = sess;
+	srv->no_pbuf = false;
 
 	rc = srv->ops->open(srv);
 	if (rc != EOK)
@@ -297,6 +313,9 @@ errno_t iplink_conn(ipc_call_t *icall, void *arg)
 		case IPLINK_ADDR_REMOVE:
 			iplink_addr_remove_srv(srv, &call);
 			break;
+		case IPLINK_PBUF_POOL_SHARE:
+			iplink_pbuf_pool_share_srv(srv, &call);
+			break;
 		default:
 			async_answer_0(&call, EINVAL);
 		}
@@ -333,6 +352,49 @@ errno_t iplink_ev_recv(iplink_srv_t *srv, iplink_recv_sdu_t *sdu, ip_ver_t ver)
 	return EOK;
 }
 
+/** Deliver received SDU stored in a packet buffer.
+ *
+ * Only the reference to the packet buffer is passed to the client, which
+ * maps the pool on first use. If the client does not support packet buffers,
+ * the data is copied as with iplink_ev_recv(). The buffer is lent to the
+ * client only for the duration of the call.
+ *
+ * @param srv IP link server
+ * @param sdu Received SDU, @c sdu->pbuf must refer to the buffer holding
+ *            @c sdu->data
+ * @param ver IP version
+ * @return EOK on success or an error code
+ */
+errno_t iplink_ev_recv_pbuf(iplink_srv_t *srv, iplink_recv_sdu_t *sdu,
+    ip_ver_t ver)
+{
+	pbuf_pool_t *pool = sdu->pbuf.pool;
+
+	if (srv->client_sess == NULL)
+		return EIO;
+
+	if (pool == NULL || srv->no_pbuf)
+		return iplink_ev_recv(srv, sdu, ver);
+
+	/* Buffer ID and offset are passed as offset within the pool */
+	size_t offs = sdu->pbuf.id * pbuf_pool_get_buf_size(pool) +
+	    pbuf_offset(pool, sdu->pbuf.id, sdu->data);
+
+	async_exch_t *exch = async_exchange_begin(srv->client_sess);
+	errno_t rc = async_req_5_0(exch, IPLINK_EV_RECV_PBUF, (sysarg_t)ver,
+	    LOWER32(pbuf_pool_get_id(pool)), UPPER32(pbuf_pool_get_id(pool)),
+	    offs, sdu->size);
+	async_exchange_end(exch);
+
+	if (rc == ENOTSUP) {
+		/* Client cannot map the pool, fall back to copying */
+		srv->no_pbuf = true;
+		return iplink_ev_recv(srv, sdu, ver);
+	}
+
+	return rc;
+}
+
 errno_t iplink_ev_change_addr(iplink_srv_t *srv, eth_addr_t *addr)
 {
 	if (srv->client_sess == NULL)
@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <inet/checksum.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <perf.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(checksum);
+
+enum {
+	/** Largest buffer used in tests */
+	test_buf_size = 65536,
+	/** Amount of data to checksum for each buffer size in benchmark */
+	bench_total = 16 * 1024 * 1024
+};
+
+/** Reference implementation of Internet checksum.
+ *
+ * Straightforward implementation adding one 16-bit word at a time.
+ */
+static uint16_t ref_checksum_calc(uint16_t ivalue, const void *data,
+    size_t size)
+{
+	const uint8_t *bdata = (const uint8_t *)data;
+	uint32_t s;
+	uint16_t sum;
+	uint16_t w;
+	size_t i;
+
+	sum = ~ivalue;
+	for (i = 0; i < size; i += 2) {
+		w = (uint16_t)bdata[i] << 8;
+		if (i + 1 < size)
+			w |= bdata[i + 1];
+		s = (uint32_t)sum + w;
+		sum = (s & 0xffff) + (s >> 16);
+	}
+
+	return ~sum;
+}
+
+/** Fill buffer with pseudo-random data */
+static void fill_buf(uint8_t *buf, size_t size)
+{
+	uint32_t x = 12345;
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		x = x * 1103515245 + 12345;
+		buf[i] = x >> 16;
+	}
+}
+
+/** Checksum of known data (RFC 1071 section 3 example) */
+PCUT_TEST(known)
+{
+	uint8_t data[] = { 0x00, 0x01, 0xf2, 0x03, 0xf4, 0xf5, 0xf6, 0xf7 };
+
+	PCUT_ASSERT_INT_EQUALS((uint16_t)~0xddf2,
+	    inet_checksum_calc(INET_CHECKSUM_INIT, data, sizeof(data)));
+
+	/* Odd size, trailing byte is padded with zero */
+	PCUT_ASSERT_INT_EQUALS((uint16_t)~0xdcfb,
+	    inet_checksum_calc(INET_CHECKSUM_INIT, data, 7));
+
+	/* Empty buffer */
+	PCUT_ASSERT_INT_EQUALS(INET_CHECKSUM_INIT,
+	    inet_checksum_calc(INET_CHECKSUM_INIT, data, 0));
+}
+
+/** Checksum matches reference for all sizes and alignments */
+PCUT_TEST(calc_ref)
+{
+	uint8_t *buf;
+	size_t offs;
+	size_t size;
+
+	buf = malloc(test_buf_size + 8);
+	PCUT_ASSERT_NOT_NULL(buf);
+	fill_buf(buf, test_buf_size + 8);
+
+	for (offs = 0; offs < 8; offs++) {
+		for (size = 0; size < 300; size++) {
+			PCUT_ASSERT_INT_EQUALS(
+			    ref_checksum_calc(0x1234, buf + offs, size),
+			    inet_checksum_calc(0x1234, buf + offs, size));
+		}
+
+		PCUT_ASSERT_INT_EQUALS(
+		    ref_checksum_calc(INET_CHECKSUM_INIT, buf + offs,
+		    test_buf_size),
+		    inet_checksum_calc(INET_CHECKSUM_INIT, buf + offs,
+		    test_buf_size));
+	}
+
+	/* All ones exercises carry handling */
+	memset(buf, 0xff, test_buf_size);
+	PCUT_ASSERT_INT_EQUALS(
+	    ref_checksum_calc(INET_CHECKSUM_INIT, buf, test_buf_size),
+	    inet_checksum_calc(INET_CHECKSUM_INIT, buf, test_buf_size));
+
+	free(buf);
+}
+
+/** Checksum can be computed over several consecutive buffers */
+PCUT_TEST(calc_chain)
+{
+	uint8_t buf[100];
+	uint16_t cs;
+
+	fill_buf(buf, sizeof(buf));
+
+	cs = inet_checksum_calc(INET_CHECKSUM_INIT, buf, 20);
+	cs = inet_checksum_calc(cs, buf + 20, 42);
+	cs = inet_checksum_calc(cs, buf + 62, 38);
+
+	PCUT_ASSERT_INT_EQUALS(
+	    ref_checksum_calc(INET_CHECKSUM_INIT, buf, sizeof(buf)), cs);
+}
+
+/** Copy-and-checksum copies data and matches reference */
+PCUT_TEST(copy)
+{
+	uint8_t *src;
+	uint8_t *dst;
+	size_t soffs;
+	size_t doffs;
+	size_t size;
+	uint16_t cs;
+
+	src = malloc(300 + 8);
+	PCUT_ASSERT_NOT_NULL(src);
+	dst = malloc(300 + 8);
+	PCUT_ASSERT_NOT_NULL(dst);
+	fill_buf(src, 300 + 8);
+
+	for (soffs = 0; soffs < 4; soffs++) {
+		for (doffs = 0; doffs < 4; doffs++) {
+			for (size = 0; size < 300; size++) {
+				memset(dst, 0, 300 + 8);
+				cs = inet_checksum_copy(0x4321, dst + doffs,
+				    src + soffs, size);
+				PCUT_ASSERT_INT_EQUALS(
+				    ref_checksum_calc(0x4321, src + soffs,
+				    size), cs);
+				PCUT_ASSERT_INT_EQUALS(0, memcmp(dst + doffs,
+				    src + soffs, size));
+				/* Nothing written past the end */
+				PCUT_ASSERT_INT_EQUALS(0, dst[doffs + size]);
+			}
+		}
+	}
+
+	free(src);
+	free(dst);
+}
+
+/** Compare throughput of reference and optimized implementation.
+ *
+ * This is a microbenchmark, it only prints the results. The checksums
+ * computed by both implementations are compared to keep the compiler
+ * from optimizing the work away.
+ */
+PCUT_TEST(benchmark)
+{
+	stopwatch_t sw;
+	uint8_t *buf;
+	uint8_t *dst;
+	size_t size;
+	size_t iters;
+	size_t i;
+	uint16_t rcs;
+	uint16_t cs;
+	nsec_t rt, ot, ct;
+
+	buf = malloc(test_buf_size);
+	PCUT_ASSERT_NOT_NULL(buf);
+	dst = malloc(test_buf_size);
+	PCUT_ASSERT_NOT_NULL(dst);
+	fill_buf(buf, test_buf_size);
+
+	printf("%8s %14s %14s %14s\n", "size", "ref [MiB/s]",
+	    "calc [MiB/s]", "copy [MiB/s]");
+
+	for (size = 64; size <= test_buf_size; size *= 4) {
+		iters = bench_total / size;
+
+		rcs = INET_CHECKSUM_INIT;
+		stopwatch_start(&sw);
+		for (i = 0; i < iters; i++)
+			rcs = ref_checksum_calc(rcs, buf, size);
+		stopwatch_stop(&sw);
+		rt = stopwatch_get_nanos(&sw);
+
+		cs = INET_CHECKSUM_INIT;
+		stopwatch_start(&sw);
+		for (i = 0; i < iters; i++)
+			cs = inet_checksum_calc(cs, buf, size);
+		stopwatch_stop(&sw);
+		ot = stopwatch_get_nanos(&sw);
+		PCUT_ASSERT_INT_EQUALS(rcs, cs);
+
+		cs = INET_CHECKSUM_INIT;
+		stopwatch_start(&sw);
+		for (i = 0; i < iters; i++)
+			cs = inet_checksum_copy(cs, dst, buf, size);
+		stopwatch_stop(&sw);
+		ct = stopwatch_get_nanos(&sw);
+		PCUT_ASSERT_INT_EQUALS(rcs, cs);
+
+		printf("%8zu %14llu %14llu %14llu\n", size,
+		    (unsigned long long)(rt > 0 ? SEC2NSEC(bench_total) /
+		    (1024 * 1024) / rt : 0),
+		    (unsigned long long)(ot > 0 ? SEC2NSEC(bench_total) /
+		    (1024 * 1024) / ot : 0),
+		    (unsigned long long)(ct > 0 ? SEC2NSEC(bench_total) /
+		    (1024 * 1024) / ct : 0));
+	}
+
+	free(buf);
+	free(dst);
+}
+
+PCUT_EXPORT(checksum);
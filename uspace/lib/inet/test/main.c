@@ -31,6 +31,7 @@
 PCUT_INIT;
 
 PCUT_IMPORT(addr);
+PCUT_IMPORT(checksum);
 PCUT_IMPORT(eth_addr);
 
 PCUT_MAIN();
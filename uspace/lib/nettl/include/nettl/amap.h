@@ -36,7 +36,7 @@
 #ifndef LIBNETTL_AMAP_H_
 #define LIBNETTL_AMAP_H_
 
-#include <adt/list.h>
+#include <adt/hash_table.h>
 #include <inet/endpoint.h>
 #include <nettl/portrng.h>
 #include <loc.h>
@@ -44,7 +44,7 @@
 /** Port range for (remote endpoint, local address) */
 typedef struct {
 	/** Link to amap_t.repla */
-	link_t lamap;
+	ht_link_t lamap;
 	/** Remote endpoint */
 	inet_ep_t rep;
 	/* Local address */
@@ -56,7 +56,7 @@ typedef struct {
 /** Port range for local address */
 typedef struct {
 	/** Link to amap_t.laddr */
-	link_t lamap;
+	ht_link_t lamap;
 	/** Local address */
 	inet_addr_t laddr;
 	/** Port range */
@@ -66,7 +66,7 @@ typedef struct {
 /** Port range for local link */
 typedef struct {
 	/** Link to amap_t.llink */
-	link_t lamap;
+	ht_link_t lamap;
 	/** Local link ID */
 	service_id_t llink;
 	/** Port range */
@@ -76,11 +76,11 @@ typedef struct {
 /** Association map */
 typedef struct {
 	/** Remote endpoint, local address */
-	list_t repla; /* of amap_repla_t */
+	hash_table_t repla; /* of amap_repla_t */
 	/** Local addresses */
-	list_t laddr; /* of amap_laddr_t */
+	hash_table_t laddr; /* of amap_laddr_t */
 	/** Local links */
-	list_t llink; /* of amap_llink_t */
+	hash_table_t llink; /* of amap_llink_t */
 	/** Nothing specified (listen on all local addresses) */
 	portrng_t *unspec;
 } amap_t;
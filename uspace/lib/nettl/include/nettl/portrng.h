@@ -36,13 +36,18 @@
 #ifndef LIBNETTL_PORTRNG_H_
 #define LIBNETTL_PORTRNG_H_
 
+#include <adt/hash_table.h>
+#include <adt/list.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /** Allocated port */
 typedef struct {
 	/** Link to portrng_t.used */
 	link_t lprng;
+	/** Link to portrng_t.ports */
+	ht_link_t lhash;
 	/** Port number */
 	uint16_t pn;
 	/** User argument */
@@ -51,6 +56,16 @@ typedef struct {
 
 typedef struct {
 	list_t used; /* of portrng_port_t */
+	/** Number of allocated ports */
+	size_t nused;
+	/** Allocated ports hashed by port number */
+	hash_table_t ports; /* of portrng_port_t */
+	/** @c true iff @c ports is in use */
+	bool hashed;
+	/** Number of allocated ports from the dynamic range */
+	size_t ndyn;
+	/** Next port number to try when allocating from the dynamic range */
+	uint16_t dyn_next;
 } portrng_t;
 
 typedef enum {
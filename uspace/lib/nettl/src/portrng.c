@@ -34,8 +34,21 @@
  * @file Port range allocator
  *
  * Allocates port numbers from IETF port number ranges.
+ *
+ * Allocated ports are kept on a list. Once a port range holds more than
+ * a few ports, they are also entered into a hash table keyed by the port
+ * number, so that a port can be found in constant time. Most port ranges
+ * (e.g. those of individual TCP connections) only ever hold one port and
+ * do not need the table.
+ *
+ * Ports from the dynamic range are allocated by a cursor which rotates
+ * through the range, so allocation takes constant expected time unless
+ * the range is nearly exhausted, and a port that has just been freed is
+ * not reused right away.
  */
 
+#include <adt/hash.h>
+#include <adt/hash_table.h>
 #include <adt/list.h>
 #include <errno.h>
 #include <inet/endpoint.h>
@@ -45,6 +58,47 @@
 
 #include <io/log.h>
 
+/** Number of ports above which a port range uses a hash table */
+#define PORTRNG_HASH_MIN 8
+
+/** Number of ports in the dynamic range */
+#define PORTRNG_DYN_CNT (inet_port_dyn_hi - inet_port_dyn_lo + 1)
+
+static size_t portrng_port_hash(const ht_link_t *item)
+{
+	portrng_port_t *port = hash_table_get_inst(item, portrng_port_t, lhash);
+	return hash_mix(port->pn);
+}
+
+static size_t portrng_port_key_hash(const void *key)
+{
+	const uint16_t *pn = key;
+	return hash_mix(*pn);
+}
+
+static bool portrng_port_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	portrng_port_t *p1 = hash_table_get_inst(item1, portrng_port_t, lhash);
+	portrng_port_t *p2 = hash_table_get_inst(item2, portrng_port_t, lhash);
+	return p1->pn == p2->pn;
+}
+
+static bool portrng_port_key_equal(const void *key, size_t hash,
+    const ht_link_t *item)
+{
+	const uint16_t *pn = key;
+	portrng_port_t *port = hash_table_get_inst(item, portrng_port_t, lhash);
+	return port->pn == *pn;
+}
+
+static const hash_table_ops_t portrng_port_ops = {
+	.hash = portrng_port_hash,
+	.key_hash = portrng_port_key_hash,
+	.equal = portrng_port_equal,
+	.key_equal = portrng_port_key_equal,
+	.remove_callback = NULL
+};
+
 /** Create port range.
  *
  * @param rpr Place to store pointer to new port range
@@ -61,6 +115,7 @@ errno_t portrng_create(portrng_t **rpr)
 		return ENOMEM;
 
 	list_initialize(&pr->used);
+	pr->dyn_next = inet_port_dyn_lo;
 	*rpr = pr;
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_create() - end");
 	return EOK;
@@ -74,9 +129,62 @@ void portrng_destroy(portrng_t *pr)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_destroy()");
 	assert(list_empty(&pr->used));
+	if (pr->hashed)
+		hash_table_destroy(&pr->ports);
 	free(pr);
 }
 
+/** Find allocated port.
+ *
+ * @param pr   Port range
+ * @param pnum Port number
+ * @return Port or @c NULL if @a pnum is not allocated
+ */
+static portrng_port_t *portrng_port_find(portrng_t *pr, uint16_t pnum)
+{
+	ht_link_t *link;
+
+	if (pr->hashed) {
+		link = hash_table_find(&pr->ports, &pnum);
+		if (link == NULL)
+			return NULL;
+		return hash_table_get_inst(link, portrng_port_t, lhash);
+	}
+
+	list_foreach(pr->used, lprng, portrng_port_t, port) {
+		if (port->pn == pnum)
+			return port;
+	}
+
+	return NULL;
+}
+
+/** Enter port into port range.
+ *
+ * Starts using the hash table once the number of ports exceeds
+ * PORTRNG_HASH_MIN. If the table cannot be created, lookups keep
+ * walking the list.
+ *
+ * @param pr   Port range
+ * @param port Port
+ */
+static void portrng_port_insert(portrng_t *pr, portrng_port_t *port)
+{
+	list_append(&port->lprng, &pr->used);
+	++pr->nused;
+	if (port->pn >= inet_port_dyn_lo)
+		++pr->ndyn;
+
+	if (pr->hashed) {
+		hash_table_insert(&pr->ports, &port->lhash);
+	} else if (pr->nused > PORTRNG_HASH_MIN &&
+	    hash_table_create(&pr->ports, 0, 0, &portrng_port_ops)) {
+		pr->hashed = true;
+		list_foreach(pr->used, lprng, portrng_port_t, p)
+			hash_table_insert(&pr->ports, &p->lhash);
+	}
+}
+
 /** Allocate port number from port range.
  *
  * @param pr    Port range
@@ -96,33 +204,24 @@ errno_t portrng_alloc(portrng_t *pr, uint16_t pnum, void *arg,
     portrng_flags_t flags, uint16_t *apnum)
 {
 	portrng_port_t *p;
-	uint32_t i;
-	bool found;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_alloc() - begin");
 
 	if (pnum == inet_port_any) {
-
-		for (i = inet_port_dyn_lo; i <= inet_port_dyn_hi; i++) {
-			log_msg(LOG_DEFAULT, LVL_DEBUG2, "trying %" PRIu32, i);
-			found = false;
-			list_foreach(pr->used, lprng, portrng_port_t, port) {
-				if (port->pn == pnum) {
-					found = true;
-					break;
-				}
-			}
-
-			if (!found) {
-				pnum = i;
-				break;
-			}
-		}
-
-		if (pnum == inet_port_any) {
+		if (pr->ndyn >= PORTRNG_DYN_CNT) {
 			/* No free port found */
 			return ENOENT;
 		}
+
+		/* Terminates since there is at least one free port */
+		do {
+			pnum = pr->dyn_next;
+			if (pr->dyn_next == inet_port_dyn_hi)
+				pr->dyn_next = inet_port_dyn_lo;
+			else
+				++pr->dyn_next;
+		} while (portrng_port_find(pr, pnum) != NULL);
+
 		log_msg(LOG_DEFAULT, LVL_DEBUG2, "selected %" PRIu16, pnum);
 	} else {
 		log_msg(LOG_DEFAULT, LVL_DEBUG2, "user asked for %" PRIu16, pnum);
@@ -133,11 +232,9 @@ errno_t portrng_alloc(portrng_t *pr, uint16_t pnum, void *arg,
 			return EINVAL;
 		}
 
-		list_foreach(pr->used, lprng, portrng_port_t, port) {
-			if (port->pn == pnum) {
-				log_msg(LOG_DEFAULT, LVL_DEBUG2, "port already used");
-				return EEXIST;
-			}
+		if (portrng_port_find(pr, pnum) != NULL) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG2, "port already used");
+			return EEXIST;
 		}
 	}
 
@@ -147,7 +244,7 @@ errno_t portrng_alloc(portrng_t *pr, uint16_t pnum, void *arg,
 
 	p->pn = pnum;
 	p->arg = arg;
-	list_append(&p->lprng, &pr->used);
+	portrng_port_insert(pr, p);
 	*apnum = pnum;
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_alloc() - end OK pn=%" PRIu16,
 	    pnum);
@@ -164,14 +261,14 @@ errno_t portrng_alloc(portrng_t *pr, uint16_t pnum, void *arg,
  */
 errno_t portrng_find_port(portrng_t *pr, uint16_t pnum, void **rarg)
 {
-	list_foreach(pr->used, lprng, portrng_port_t, port) {
-		if (port->pn == pnum) {
-			*rarg = port->arg;
-			return EOK;
-		}
-	}
+	portrng_port_t *port;
 
-	return ENOENT;
+	port = portrng_port_find(pr, pnum);
+	if (port == NULL)
+		return ENOENT;
+
+	*rarg = port->arg;
+	return EOK;
 }
 
 /** Free port in port range.
@@ -181,21 +278,25 @@ errno_t portrng_find_port(portrng_t *pr, uint16_t pnum, void **rarg)
  */
 void portrng_free_port(portrng_t *pr, uint16_t pnum)
 {
+	portrng_port_t *port;
+
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_free_port(%u)", pnum);
-	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_free_port() - begin");
-	list_foreach(pr->used, lprng, portrng_port_t, port) {
-		log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_free_port - check port %u", port->pn);
-		if (port->pn == pnum) {
-			log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_free_port - OK");
-			list_remove(&port->lprng);
-			free(port);
-			log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_free_port() - end");
-			return;
-		}
+
+	port = portrng_port_find(pr, pnum);
+	if (port == NULL) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_free_port - FAIL");
+		assert(false);
+		return;
 	}
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_free_port - FAIL");
-	assert(false);
+	list_remove(&port->lprng);
+	if (pr->hashed)
+		hash_table_remove_item(&pr->ports, &port->lhash);
+	--pr->nused;
+	if (port->pn >= inet_port_dyn_lo)
+		--pr->ndyn;
+	free(port);
+	log_msg(LOG_DEFAULT, LVL_DEBUG2, "portrng_free_port() - end");
 }
 
 /** Determine if port range is empty.
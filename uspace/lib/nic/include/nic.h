@@ -43,6 +43,7 @@
 #include <ddf/driver.h>
 #include <device/hw_res_parsed.h>
 #include <ops/nic.h>
+#include <pbuf.h>
 
 #define DEVICE_CATEGORY_NIC "nic"
 
@@ -68,10 +69,26 @@ typedef struct {
 	link_t link;
 	void *data;
 	size_t size;
+	/** Packet buffer holding the data (if allocated from the pool) */
+	pbuf_ref_t pbuf;
 } nic_frame_t;
 
 typedef list_t nic_frame_list_t;
 
+/**
+ * Buffer from the received frame pool which the device receives into.
+ */
+typedef struct {
+	/** Packet buffer */
+	pbuf_ref_t pbuf;
+	/** Virtual address of the buffer */
+	void *virt;
+	/** Physical address of the buffer */
+	uintptr_t phys;
+	/** Size of the buffer */
+	size_t size;
+} nic_rx_buf_t;
+
 /**
  * Handler for writing frame data to the NIC device.
  * The function is responsible for releasing the frame.
@@ -257,6 +274,10 @@ extern nic_frame_t *nic_alloc_frame(nic_t *, size_t);
 extern nic_frame_list_t *nic_alloc_frame_list(void);
 extern void nic_frame_list_append(nic_frame_list_t *, nic_frame_t *);
 extern void nic_release_frame(nic_t *, nic_frame_t *);
+extern errno_t nic_alloc_rx_buf(nic_t *, nic_rx_buf_t *);
+extern nic_frame_t *nic_rx_buf_to_frame(nic_t *, nic_rx_buf_t *, size_t,
+    size_t);
+extern void nic_release_rx_buf(nic_t *, nic_rx_buf_t *);
 
 /* RXC query and report functions */
 extern void nic_report_hw_filtering(nic_t *, int, int, int);
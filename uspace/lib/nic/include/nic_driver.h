@@ -79,6 +79,14 @@ struct nic {
 	nic_address_t default_mac;
 	/** Client callback session */
 	async_sess_t *client_session;
+	/** Pool of buffers for received frames (or @c NULL) */
+	pbuf_pool_t *pbuf_pool;
+	/** The pool is physically contiguous, the device can receive into it */
+	bool pbuf_dma;
+	/** Client has mapped the pool, received frames are not copied */
+	bool pbuf_shared;
+	/** Client does not accept batches of received frames */
+	bool rx_batch_unsupported;
 	/** Current polling mode of the NIC */
 	nic_poll_mode_t poll_mode;
 	/** Polling period (applicable when poll_mode == NIC_POLL_PERIODIC) */
@@ -89,6 +97,17 @@ struct nic {
 	struct timespec default_poll_period;
 	/** Software period fibrill information */
 	struct sw_poll_info sw_poll_info;
+	/**
+	 * Polling mode is switched automatically according to receive rate
+	 * (until the client sets the mode explicitly)
+	 */
+	bool poll_adaptive;
+	/** Timer sampling the receive rate */
+	fibril_timer_t *poll_adapt_timer;
+	/** The receive rate is being sampled */
+	bool poll_adapt_running;
+	/** Number of received packets at the last sample */
+	unsigned long poll_adapt_rx_packets;
 	/**
 	 * Lock on everything but statistics, rx control and wol virtues. This lock
 	 * cannot be used if filters_lock or stats_lock is already held - you must
@@ -209,6 +228,10 @@ typedef struct nic_globals {
 	fibril_mutex_t lock;
 } nic_globals_t;
 
+extern errno_t nic_poll_mode_set_locked(nic_t *, nic_poll_mode_t,
+    const struct timespec *);
+extern void nic_poll_adapt_start(nic_t *);
+
 #endif
 
 /** @}
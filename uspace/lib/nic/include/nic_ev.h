@@ -40,11 +40,17 @@
 
 #include <async.h>
 #include <nic/nic.h>
+#include <nic_iface.h>
+#include <pbuf.h>
 #include <stddef.h>
 
 extern errno_t nic_ev_addr_changed(async_sess_t *, const nic_address_t *);
 extern errno_t nic_ev_device_state(async_sess_t *, sysarg_t);
 extern errno_t nic_ev_received(async_sess_t *, void *, size_t);
+extern errno_t nic_ev_received_pbuf(async_sess_t *, pbuf_pool_id_t,
+    pbuf_id_t, size_t, size_t);
+extern errno_t nic_ev_received_pbuf_batch(async_sess_t *, pbuf_pool_id_t,
+    nic_pbuf_desc_t *, size_t);
 
 #endif
 
@@ -53,6 +53,25 @@
 
 #define NIC_GLOBALS_MAX_CACHE_SIZE 16
 
+/**
+ * Number of buffers in the received frame pool. Drivers that receive
+ * directly into the pool keep some of them posted to the device.
+ */
+#define NIC_PBUF_COUNT 512
+/** Size of a buffer in the received frame pool */
+#define NIC_PBUF_SIZE 2048
+/** Space left before the frame so that the L3 header is 32-bit aligned */
+#define NIC_PBUF_HEADROOM 2
+
+/** Interval of sampling the receive rate for adaptive polling */
+#define NIC_POLL_ADAPT_INTERVAL_USEC 100000
+/** Receive rate (frames/s) above which interrupts are coalesced */
+#define NIC_POLL_ADAPT_HIGH_RATE 20000
+/** Receive rate (frames/s) below which each frame raises an interrupt */
+#define NIC_POLL_ADAPT_LOW_RATE 5000
+/** Polling period used under high load (unless the driver has a default) */
+#define NIC_POLL_ADAPT_PERIOD_USEC 250
+
 nic_globals_t nic_globals;
 
 /**
@@ -143,6 +162,8 @@ void nic_driver_implement(driver_ops_t *driver_ops, ddf_dev_ops_t *dev_ops,
 			iface->poll_set_mode = nic_poll_set_mode_impl;
 		if (!iface->poll_now)
 			iface->poll_now = nic_poll_now_impl;
+		if (!iface->pbuf_pool_get)
+			iface->pbuf_pool_get = nic_pbuf_pool_get_impl;
 	}
 }
 
@@ -255,13 +276,11 @@ errno_t nic_get_resources(nic_t *nic_data, hw_res_list_parsed_t *resources)
 	return hw_res_get_list_parsed(parent_sess, resources, 0);
 }
 
-/** Allocate frame
+/** Get frame structure from the cache or allocate a new one.
  *
- *  @param nic_data 	The NIC driver data
- *  @param size	        Frame size in bytes
- *  @return pointer to allocated frame if success, NULL otherwise
+ *  @return pointer to frame structure if success, NULL otherwise
  */
-nic_frame_t *nic_alloc_frame(nic_t *nic_data, size_t size)
+static nic_frame_t *nic_frame_get(void)
 {
 	nic_frame_t *frame;
 	fibril_mutex_lock(&nic_globals.lock);
@@ -280,10 +299,41 @@ nic_frame_t *nic_alloc_frame(nic_t *nic_data, size_t size)
 		link_initialize(&frame->link);
 	}
 
-	frame->data = malloc(size);
-	if (frame->data == NULL) {
-		free(frame);
+	return frame;
+}
+
+/** Allocate frame
+ *
+ * The frame data is placed into a buffer from the received frame pool
+ * if one is available, so that it can be handed to the client without
+ * copying. Otherwise it is allocated from the heap.
+ *
+ *  @param nic_data 	The NIC driver data
+ *  @param size	        Frame size in bytes
+ *  @return pointer to allocated frame if success, NULL otherwise
+ */
+nic_frame_t *nic_alloc_frame(nic_t *nic_data, size_t size)
+{
+	nic_frame_t *frame = nic_frame_get();
+	if (frame == NULL)
 		return NULL;
+
+	frame->pbuf.pool = NULL;
+	frame->data = NULL;
+
+	if (nic_data->pbuf_pool != NULL &&
+	    size <= NIC_PBUF_SIZE - NIC_PBUF_HEADROOM &&
+	    pbuf_alloc(nic_data->pbuf_pool, &frame->pbuf.id) == EOK) {
+		frame->pbuf.pool = nic_data->pbuf_pool;
+		frame->data = pbuf_get(frame->pbuf.pool, frame->pbuf.id,
+		    NIC_PBUF_HEADROOM, size);
+		assert(frame->data != NULL);
+	} else {
+		frame->data = malloc(size);
+		if (frame->data == NULL) {
+			free(frame);
+			return NULL;
+		}
 	}
 
 	frame->size = size;
@@ -300,7 +350,12 @@ void nic_release_frame(nic_t *nic_data, nic_frame_t *frame)
 	if (!frame)
 		return;
 
-	if (frame->data != NULL) {
+	if (frame->pbuf.pool != NULL) {
+		pbuf_release(frame->pbuf.pool, frame->pbuf.id);
+		frame->pbuf.pool = NULL;
+		frame->data = NULL;
+		frame->size = 0;
+	} else if (frame->data != NULL) {
 		free(frame->data);
 		frame->data = NULL;
 		frame->size = 0;
@@ -317,6 +372,87 @@ void nic_release_frame(nic_t *nic_data, nic_frame_t *frame)
 	}
 }
 
+/** Allocate receive buffer
+ *
+ * Drivers which let the device write received frames directly into
+ * the received frame pool post such buffers to the device. Once a frame
+ * has been received, the buffer is turned into a frame using
+ * nic_rx_buf_to_frame(), which avoids copying the frame data.
+ *
+ *  @param nic_data 	The NIC driver data
+ *  @param buf		Place to store the buffer
+ *  @return EOK on success, ENOTSUP if the pool is not suitable for DMA,
+ *	    ENOMEM if no buffer is free
+ */
+errno_t nic_alloc_rx_buf(nic_t *nic_data, nic_rx_buf_t *buf)
+{
+	errno_t rc;
+
+	if (nic_data->pbuf_pool == NULL || !nic_data->pbuf_dma)
+		return ENOTSUP;
+
+	rc = pbuf_alloc(nic_data->pbuf_pool, &buf->pbuf.id);
+	if (rc != EOK)
+		return rc;
+
+	buf->pbuf.pool = nic_data->pbuf_pool;
+	buf->size = pbuf_pool_get_buf_size(nic_data->pbuf_pool);
+	buf->virt = pbuf_get(buf->pbuf.pool, buf->pbuf.id, 0, buf->size);
+	buf->phys = pbuf_phys(buf->pbuf.pool, buf->pbuf.id);
+	assert(buf->virt != NULL);
+	return EOK;
+}
+
+/** Turn receive buffer into a frame
+ *
+ * The frame takes over the buffer, which must not be used by the driver
+ * afterwards.
+ *
+ *  @param nic_data 	The NIC driver data
+ *  @param buf		Buffer the device has received the frame into
+ *  @param offs		Offset of the frame within the buffer
+ *  @param size		Frame size in bytes
+ *  @return pointer to frame if success, NULL otherwise (the buffer
+ *	    is left to the driver)
+ */
+nic_frame_t *nic_rx_buf_to_frame(nic_t *nic_data, nic_rx_buf_t *buf,
+    size_t offs, size_t size)
+{
+	void *data;
+	nic_frame_t *frame;
+
+	data = pbuf_get(buf->pbuf.pool, buf->pbuf.id, offs, size);
+	if (data == NULL)
+		return NULL;
+
+	frame = nic_frame_get();
+	if (frame == NULL)
+		return NULL;
+
+	frame->pbuf = buf->pbuf;
+	frame->data = data;
+	frame->size = size;
+
+	buf->pbuf.pool = NULL;
+	buf->virt = NULL;
+	return frame;
+}
+
+/** Release receive buffer
+ *
+ *  @param nic_data 	The NIC driver data
+ *  @param buf		Buffer to release
+ */
+void nic_release_rx_buf(nic_t *nic_data, nic_rx_buf_t *buf)
+{
+	if (buf->pbuf.pool == NULL)
+		return;
+
+	pbuf_release(buf->pbuf.pool, buf->pbuf.id);
+	buf->pbuf.pool = NULL;
+	buf->virt = NULL;
+}
+
 /**
  * Allocate a new frame list
  *
@@ -507,15 +643,30 @@ void nic_set_tx_busy(nic_t *nic_data, int busy)
 	nic_data->tx_busy = busy;
 }
 
-/**
- * This is the function that the driver should call when it receives a frame.
- * The frame is checked by filters and then sent up to the NIL layer or
- * discarded. The frame is released.
+/** Get batch size histogram bucket.
+ *
+ * @param count Number of frames in the batch (nonzero)
+ * @return Bucket index
+ */
+static size_t nic_batch_hist_bucket(size_t count)
+{
+	size_t bucket = 0;
+
+	while (count > 1 && bucket < NIC_BATCH_HIST_BUCKETS - 1) {
+		count >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+/** Check received frame against filters and update statistics.
  *
  * @param nic_data
  * @param frame		The received frame
+ * @return @c true if the frame should be passed to the client
  */
-void nic_received_frame(nic_t *nic_data, nic_frame_t *frame)
+static bool nic_rx_accept(nic_t *nic_data, nic_frame_t *frame)
 {
 	/*
 	 * Note: this function must not lock main lock, because loopback driver
@@ -543,36 +694,145 @@ void nic_received_frame(nic_t *nic_data, nic_frame_t *frame)
 			break;
 		}
 		fibril_rwlock_write_unlock(&nic_data->stats_lock);
+		return true;
+	}
+
+	switch (frame_type) {
+	case NIC_FRAME_UNICAST:
+		nic_data->stats.receive_filtered_unicast++;
+		break;
+	case NIC_FRAME_MULTICAST:
+		nic_data->stats.receive_filtered_multicast++;
+		break;
+	case NIC_FRAME_BROADCAST:
+		nic_data->stats.receive_filtered_broadcast++;
+		break;
+	}
+	fibril_rwlock_write_unlock(&nic_data->stats_lock);
+	return false;
+}
+
+/** Record number of frames received at once.
+ *
+ * @param nic_data
+ * @param count		Number of accepted frames
+ */
+static void nic_rx_batch_account(nic_t *nic_data, size_t count)
+{
+	if (count == 0)
+		return;
+
+	fibril_rwlock_write_lock(&nic_data->stats_lock);
+	nic_data->stats.receive_batch_hist[nic_batch_hist_bucket(count)]++;
+	fibril_rwlock_write_unlock(&nic_data->stats_lock);
+}
+
+/** Pass single accepted frame to the client.
+ *
+ * @param nic_data
+ * @param frame		The received frame
+ */
+static void nic_rx_deliver(nic_t *nic_data, nic_frame_t *frame)
+{
+	errno_t rc = ENOTSUP;
+
+	if (frame->pbuf.pool != NULL && nic_data->pbuf_shared) {
+		/* Client has the pool mapped, pass just the reference */
+		rc = nic_ev_received_pbuf(nic_data->client_session,
+		    pbuf_pool_get_id(frame->pbuf.pool), frame->pbuf.id,
+		    pbuf_offset(frame->pbuf.pool, frame->pbuf.id,
+		    frame->data), frame->size);
+		if (rc == ENOENT) {
+			/* Client failed to map the pool */
+			nic_data->pbuf_shared = false;
+			rc = ENOTSUP;
+		}
+	}
+
+	if (rc == ENOTSUP) {
 		nic_ev_received(nic_data->client_session, frame->data,
 		    frame->size);
-	} else {
-		switch (frame_type) {
-		case NIC_FRAME_UNICAST:
-			nic_data->stats.receive_filtered_unicast++;
-			break;
-		case NIC_FRAME_MULTICAST:
-			nic_data->stats.receive_filtered_multicast++;
-			break;
-		case NIC_FRAME_BROADCAST:
-			nic_data->stats.receive_filtered_broadcast++;
-			break;
+	}
+}
+
+/** Pass batch of accepted frames stored in the frame pool to the client.
+ *
+ * The frames are released.
+ *
+ * @param nic_data
+ * @param frames	Frames
+ * @param count		Number of frames
+ */
+static void nic_rx_deliver_batch(nic_t *nic_data, nic_frame_t **frames,
+    size_t count)
+{
+	nic_pbuf_desc_t descs[NIC_RX_BATCH_MAX];
+	errno_t rc = ENOTSUP;
+	size_t i;
+
+	assert(count <= NIC_RX_BATCH_MAX);
+
+	if (count > 1) {
+		for (i = 0; i < count; i++) {
+			descs[i].id = frames[i]->pbuf.id;
+			descs[i].offs = pbuf_offset(frames[i]->pbuf.pool,
+			    frames[i]->pbuf.id, frames[i]->data);
+			descs[i].size = frames[i]->size;
 		}
-		fibril_rwlock_write_unlock(&nic_data->stats_lock);
+
+		rc = nic_ev_received_pbuf_batch(nic_data->client_session,
+		    pbuf_pool_get_id(nic_data->pbuf_pool), descs, count);
+		if (rc == ENOENT) {
+			/* Client failed to map the pool */
+			nic_data->pbuf_shared = false;
+			rc = ENOTSUP;
+		} else if (rc == ENOTSUP) {
+			/* Client does not accept batches */
+			nic_data->rx_batch_unsupported = true;
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		if (rc == ENOTSUP)
+			nic_rx_deliver(nic_data, frames[i]);
+		nic_release_frame(nic_data, frames[i]);
 	}
+}
+
+/**
+ * This is the function that the driver should call when it receives a frame.
+ * The frame is checked by filters and then sent up to the NIL layer or
+ * discarded. The frame is released.
+ *
+ * @param nic_data
+ * @param frame		The received frame
+ */
+void nic_received_frame(nic_t *nic_data, nic_frame_t *frame)
+{
+	if (nic_rx_accept(nic_data, frame)) {
+		nic_rx_batch_account(nic_data, 1);
+		nic_rx_deliver(nic_data, frame);
+	}
+
 	nic_release_frame(nic_data, frame);
 }
 
 /**
  * Some NICs can receive multiple frames during single interrupt. These can
  * send them in whole list of frames (actually nic_frame_t structures), then
- * the list is deallocated and each frame is passed to the
- * nic_received_packet function.
+ * the list is deallocated and each frame is checked by filters like in
+ * nic_received_frame. Frames stored in the frame pool are passed to the
+ * client in batches of up to NIC_RX_BATCH_MAX frames per IPC call.
  *
  * @param nic_data
  * @param frames		List of received frames
  */
 void nic_received_frame_list(nic_t *nic_data, nic_frame_list_t *frames)
 {
+	nic_frame_t *batch[NIC_RX_BATCH_MAX];
+	size_t nbatch = 0;
+	size_t accepted = 0;
+
 	if (frames == NULL)
 		return;
 	while (!list_empty(frames)) {
@@ -580,8 +840,32 @@ void nic_received_frame_list(nic_t *nic_data, nic_frame_list_t *frames)
 		    list_get_instance(list_first(frames), nic_frame_t, link);
 
 		list_remove(&frame->link);
-		nic_received_frame(nic_data, frame);
+		if (!nic_rx_accept(nic_data, frame)) {
+			nic_release_frame(nic_data, frame);
+			continue;
+		}
+
+		accepted++;
+
+		if (frame->pbuf.pool != NULL && nic_data->pbuf_shared &&
+		    !nic_data->rx_batch_unsupported) {
+			batch[nbatch++] = frame;
+			if (nbatch == NIC_RX_BATCH_MAX) {
+				nic_rx_deliver_batch(nic_data, batch, nbatch);
+				nbatch = 0;
+			}
+		} else {
+			/* Keep the order of frames */
+			nic_rx_deliver_batch(nic_data, batch, nbatch);
+			nbatch = 0;
+
+			nic_rx_deliver(nic_data, frame);
+			nic_release_frame(nic_data, frame);
+		}
 	}
+
+	nic_rx_deliver_batch(nic_data, batch, nbatch);
+	nic_rx_batch_account(nic_data, accepted);
 	nic_driver_release_frame_list(frames);
 }
 
@@ -616,6 +900,27 @@ static nic_t *nic_create(ddf_dev_t *dev)
 	nic_data->on_going_down = NULL;
 	nic_data->on_stopping = NULL;
 	nic_data->specific = NULL;
+	nic_data->pbuf_shared = false;
+	nic_data->rx_batch_unsupported = false;
+	nic_data->poll_adaptive = true;
+	nic_data->poll_adapt_running = false;
+	nic_data->poll_adapt_rx_packets = 0;
+
+	/* Without the timer the polling mode is simply not adapted */
+	nic_data->poll_adapt_timer = fibril_timer_create(NULL);
+
+	/*
+	 * Prefer a pool the device can receive into. Without the pool frames
+	 * are simply allocated from the heap.
+	 */
+	nic_data->pbuf_dma = true;
+	if (pbuf_pool_create_dma(NIC_PBUF_COUNT, NIC_PBUF_SIZE,
+	    &nic_data->pbuf_pool) != EOK) {
+		nic_data->pbuf_dma = false;
+		if (pbuf_pool_create(NIC_PBUF_COUNT, NIC_PBUF_SIZE,
+		    &nic_data->pbuf_pool) != EOK)
+			nic_data->pbuf_pool = NULL;
+	}
 
 	fibril_rwlock_initialize(&nic_data->main_lock);
 	fibril_rwlock_initialize(&nic_data->stats_lock);
@@ -658,6 +963,13 @@ nic_t *nic_create_and_bind(ddf_dev_t *device)
  */
 static void nic_destroy(nic_t *nic_data)
 {
+	if (nic_data->poll_adapt_timer != NULL) {
+		fibril_timer_clear(nic_data->poll_adapt_timer);
+		fibril_timer_destroy(nic_data->poll_adapt_timer);
+	}
+
+	if (nic_data->pbuf_pool != NULL)
+		pbuf_pool_destroy(nic_data->pbuf_pool);
 	free(nic_data->specific);
 }
 
@@ -930,6 +1242,8 @@ void nic_report_send_ok(nic_t *nic_data, size_t packets, size_t bytes)
 	fibril_rwlock_write_lock(&nic_data->stats_lock);
 	nic_data->stats.send_packets += packets;
 	nic_data->stats.send_bytes += bytes;
+	if (packets > 0)
+		nic_data->stats.send_batch_hist[nic_batch_hist_bucket(packets)]++;
 	fibril_rwlock_write_unlock(&nic_data->stats_lock);
 }
 
@@ -1132,5 +1446,128 @@ void nic_sw_period_stop(nic_t *nic_data)
 	nic_data->sw_poll_info.running = 0;
 }
 
+/** Change polling mode of the device
+ *
+ * If the driver cannot poll periodically by itself, software periodic
+ * polling is used instead. Must be called with main_lock locked for writing.
+ *
+ * @param nic_data	Nic data structure
+ * @param mode		The new poll mode
+ * @param period	Period used in periodic polling. Can be NULL.
+ *
+ * @return EOK		If the mode was changed
+ * @return ENOTSUP	If the mode is not supported
+ * @return EINVAL	If the mode cannot be set up
+ */
+errno_t nic_poll_mode_set_locked(nic_t *nic_data, nic_poll_mode_t mode,
+    const struct timespec *period)
+{
+	bool sw_period = false;
+
+	errno_t rc = nic_data->on_poll_mode_change(nic_data, mode, period);
+	assert(rc == EOK || rc == ENOTSUP || rc == EINVAL);
+	if (rc == ENOTSUP && (nic_data->on_poll_request != NULL) &&
+	    (mode == NIC_POLL_PERIODIC || mode == NIC_POLL_SOFTWARE_PERIODIC)) {
+
+		rc = nic_data->on_poll_mode_change(nic_data, NIC_POLL_ON_DEMAND, NULL);
+		assert(rc == EOK || rc == ENOTSUP);
+		sw_period = true;
+	}
+	if (rc == EOK) {
+		nic_data->poll_mode = mode;
+		if (period)
+			nic_data->poll_period = *period;
+
+		if (sw_period)
+			nic_sw_period_start(nic_data);
+		else
+			nic_sw_period_stop(nic_data);
+	}
+
+	return rc;
+}
+
+/** Adapt polling mode to the receive rate
+ *
+ * Under high load the device is switched to periodic polling, which
+ * coalesces interrupts and lets the driver deliver frames in batches.
+ * Once the load drops, the device is switched back to raising interrupt
+ * for each frame, which gives the lowest latency.
+ *
+ * @param arg Nic data structure
+ */
+static void nic_poll_adapt(void *arg)
+{
+	nic_t *nic_data = (nic_t *) arg;
+	struct timespec period;
+	unsigned long packets;
+	unsigned long rate;
+
+	fibril_rwlock_write_lock(&nic_data->main_lock);
+
+	if (nic_data->state != NIC_STATE_ACTIVE) {
+		nic_data->poll_adapt_running = false;
+		fibril_rwlock_write_unlock(&nic_data->main_lock);
+		return;
+	}
+
+	fibril_rwlock_read_lock(&nic_data->stats_lock);
+	packets = nic_data->stats.receive_packets;
+	fibril_rwlock_read_unlock(&nic_data->stats_lock);
+
+	/* Statistics are reset when the device is stopped */
+	if (packets < nic_data->poll_adapt_rx_packets)
+		nic_data->poll_adapt_rx_packets = 0;
+
+	rate = (packets - nic_data->poll_adapt_rx_packets) *
+	    (1000000 / NIC_POLL_ADAPT_INTERVAL_USEC);
+	nic_data->poll_adapt_rx_packets = packets;
+
+	if (nic_data->poll_adaptive) {
+		if (nic_data->poll_mode == NIC_POLL_IMMEDIATE &&
+		    rate >= NIC_POLL_ADAPT_HIGH_RATE) {
+			if (nic_data->default_poll_mode == NIC_POLL_PERIODIC) {
+				period = nic_data->default_poll_period;
+			} else {
+				period.tv_sec = 0;
+				period.tv_nsec =
+				    USEC2NSEC(NIC_POLL_ADAPT_PERIOD_USEC);
+			}
+
+			(void) nic_poll_mode_set_locked(nic_data,
+			    NIC_POLL_PERIODIC, &period);
+		} else if (nic_data->poll_mode == NIC_POLL_PERIODIC &&
+		    rate < NIC_POLL_ADAPT_LOW_RATE) {
+			(void) nic_poll_mode_set_locked(nic_data,
+			    NIC_POLL_IMMEDIATE, NULL);
+		}
+	}
+
+	fibril_timer_set(nic_data->poll_adapt_timer,
+	    NIC_POLL_ADAPT_INTERVAL_USEC, nic_poll_adapt, nic_data);
+
+	fibril_rwlock_write_unlock(&nic_data->main_lock);
+}
+
+/** Start adapting polling mode to the receive rate
+ *
+ * Does nothing if the driver cannot change the polling mode. Sampling
+ * stops by itself once the device leaves the active state. Must be called
+ * with main_lock locked for writing.
+ *
+ * @param nic_data Nic data structure
+ */
+void nic_poll_adapt_start(nic_t *nic_data)
+{
+	if (nic_data->on_poll_mode_change == NULL ||
+	    nic_data->poll_adapt_timer == NULL ||
+	    nic_data->poll_adapt_running)
+		return;
+
+	nic_data->poll_adapt_running = true;
+	fibril_timer_set(nic_data->poll_adapt_timer,
+	    NIC_POLL_ADAPT_INTERVAL_USEC, nic_poll_adapt, nic_data);
+}
+
 /** @}
  */
@@ -38,6 +38,7 @@
 #include <async.h>
 #include <nic_iface.h>
 #include <errno.h>
+#include <macros.h>
 #include "nic_ev.h"
 
 /** Device address changed. */
@@ -93,5 +94,46 @@ errno_t nic_ev_received(async_sess_t *sess, void *data, size_t size)
 	return retval;
 }
 
+/** Frame received into a packet buffer.
+ *
+ * The buffer is lent to the client until it answers.
+ */
+errno_t nic_ev_received_pbuf(async_sess_t *sess, pbuf_pool_id_t pool_id,
+    pbuf_id_t buf_id, size_t offs, size_t size)
+{
+	async_exch_t *exch = async_exchange_begin(sess);
+	errno_t retval = async_req_5_0(exch, NIC_EV_RECEIVED_PBUF,
+	    LOWER32(pool_id), UPPER32(pool_id), buf_id, offs, size);
+	async_exchange_end(exch);
+
+	return retval;
+}
+
+/** Multiple frames received into packet buffers.
+ *
+ * The buffers are lent to the client until it answers.
+ */
+errno_t nic_ev_received_pbuf_batch(async_sess_t *sess, pbuf_pool_id_t pool_id,
+    nic_pbuf_desc_t *descs, size_t count)
+{
+	async_exch_t *exch = async_exchange_begin(sess);
+
+	ipc_call_t answer;
+	aid_t req = async_send_3(exch, NIC_EV_RECEIVED_PBUF_BATCH,
+	    LOWER32(pool_id), UPPER32(pool_id), count, &answer);
+	errno_t retval = async_data_write_start(exch, descs,
+	    count * sizeof(nic_pbuf_desc_t));
+
+	async_exchange_end(exch);
+
+	if (retval != EOK) {
+		async_forget(req);
+		return retval;
+	}
+
+	async_wait_for(req, &retval);
+	return retval;
+}
+
 /** @}
  */
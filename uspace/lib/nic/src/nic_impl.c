@@ -106,6 +106,14 @@ errno_t nic_set_state_impl(ddf_fun_t *fun, nic_device_state_t state)
 	default:
 		break;
 	}
+	if (state == NIC_STATE_STOPPED &&
+	    nic_data->on_poll_mode_change != NULL &&
+	    nic_data->poll_mode != nic_data->default_poll_mode) {
+		/* The mode might have been adapted, restore the default */
+		(void) nic_poll_mode_set_locked(nic_data,
+		    nic_data->default_poll_mode, &nic_data->default_poll_period);
+	}
+
 	if (event_handler != NULL) {
 		errno_t rc = event_handler(nic_data);
 		if (rc != EOK) {
@@ -121,6 +129,7 @@ errno_t nic_set_state_impl(ddf_fun_t *fun, nic_device_state_t state)
 		nic_data->poll_mode = nic_data->default_poll_mode;
 		memcpy(&nic_data->poll_period, &nic_data->default_poll_period,
 		    sizeof(struct timespec));
+		nic_data->poll_adaptive = true;
 		if (rc != EOK) {
 			/*
 			 * We have already ran the on stopped handler, even if we
@@ -151,6 +160,9 @@ errno_t nic_set_state_impl(ddf_fun_t *fun, nic_device_state_t state)
 
 	nic_data->state = state;
 
+	if (state == NIC_STATE_ACTIVE)
+		nic_poll_adapt_start(nic_data);
+
 	nic_ev_device_state(nic_data->client_session, state);
 
 	fibril_rwlock_write_unlock(&nic_data->main_lock);
@@ -203,6 +215,10 @@ errno_t nic_callback_create_impl(ddf_fun_t *fun)
 		return ENOMEM;
 	}
 
+	/* New client has to map the frame pool again */
+	nic->pbuf_shared = false;
+	nic->rx_batch_unsupported = false;
+
 	fibril_rwlock_write_unlock(&nic->main_lock);
 	return EOK;
 }
@@ -761,20 +777,10 @@ errno_t nic_poll_set_mode_impl(ddf_fun_t *fun,
 			return EINVAL;
 	}
 	fibril_rwlock_write_lock(&nic_data->main_lock);
-	errno_t rc = nic_data->on_poll_mode_change(nic_data, mode, period);
-	assert(rc == EOK || rc == ENOTSUP || rc == EINVAL);
-	if (rc == ENOTSUP && (nic_data->on_poll_request != NULL) &&
-	    (mode == NIC_POLL_PERIODIC || mode == NIC_POLL_SOFTWARE_PERIODIC)) {
-
-		rc = nic_data->on_poll_mode_change(nic_data, NIC_POLL_ON_DEMAND, NULL);
-		assert(rc == EOK || rc == ENOTSUP);
-		if (rc == EOK)
-			nic_sw_period_start(nic_data);
-	}
+	errno_t rc = nic_poll_mode_set_locked(nic_data, mode, period);
 	if (rc == EOK) {
-		nic_data->poll_mode = mode;
-		if (period)
-			nic_data->poll_period = *period;
+		/* Mode chosen by the client is no longer adapted to the load */
+		nic_data->poll_adaptive = false;
 	}
 	fibril_rwlock_write_unlock(&nic_data->main_lock);
 	return rc;
@@ -808,6 +814,32 @@ errno_t nic_poll_now_impl(ddf_fun_t *fun)
 	}
 }
 
+/**
+ * Default implementation of the pbuf_pool_get method.
+ * Provides the pool holding received frames to the client. From now on
+ * received frames are passed to the client by reference.
+ *
+ * @param[in]	fun
+ * @param[out]	rpool	Place to store the pool
+ *
+ * @return EOK		If the pool was provided
+ * @return ENOTSUP	If the driver has no frame pool
+ */
+errno_t nic_pbuf_pool_get_impl(ddf_fun_t *fun, pbuf_pool_t **rpool)
+{
+	nic_t *nic_data = nic_get_from_ddf_fun(fun);
+	fibril_rwlock_write_lock(&nic_data->main_lock);
+	if (nic_data->pbuf_pool == NULL) {
+		fibril_rwlock_write_unlock(&nic_data->main_lock);
+		return ENOTSUP;
+	}
+
+	nic_data->pbuf_shared = true;
+	*rpool = nic_data->pbuf_pool;
+	fibril_rwlock_write_unlock(&nic_data->main_lock);
+	return EOK;
+}
+
 /**
  * Default handler for unknown methods (outside of the NIC interface).
  * Logs a warning message and returns ENOTSUP to the caller.
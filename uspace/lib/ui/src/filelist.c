@@ -312,6 +312,51 @@ void ui_file_list_clear_entries(ui_file_list_t *flist)
 	}
 }
 
+/** Append a batch of directory entries to file list.
+ *
+ * Information about all entries is retrieved in a single request.
+ * Entries which cannot be stat'ed are skipped.
+ *
+ * @param flist File list
+ * @param dfd Handle of the directory containing the entries
+ * @param names Entry names
+ * @param count Number of entries (at most VFS_STAT_BULK_MAX)
+ * @return EOK on success or an error code
+ */
+static errno_t ui_file_list_append_batch(ui_file_list_t *flist, int dfd,
+    char **names, size_t count)
+{
+	vfs_stat_t finfo[VFS_STAT_BULK_MAX];
+	errno_t rcs[VFS_STAT_BULK_MAX];
+	ui_file_list_entry_attr_t attr;
+	errno_t rc;
+	size_t i;
+
+	rc = vfs_stat_bulk(dfd, (const char *const *) names, count, finfo,
+	    rcs);
+	if (rc != EOK)
+		return rc;
+
+	for (i = 0; i < count; i++) {
+		if (rcs[i] != EOK) {
+			/* Possibly a stale entry */
+			continue;
+		}
+
+		ui_file_list_entry_attr_init(&attr);
+		attr.name = names[i];
+		attr.size = finfo[i].size;
+		attr.isdir = finfo[i].is_directory;
+		attr.svc = finfo[i].service;
+
+		rc = ui_file_list_entry_append(flist, &attr);
+		if (rc != EOK)
+			return rc;
+	}
+
+	return EOK;
+}
+
 /** Read directory into file list entry list.
  *
  * @param flist File list
@@ -320,9 +365,11 @@ void ui_file_list_clear_entries(ui_file_list_t *flist)
  */
 errno_t ui_file_list_read_dir(ui_file_list_t *flist, const char *dirname)
 {
-	DIR *dir;
+	DIR *dir = NULL;
 	struct dirent *dirent;
-	vfs_stat_t finfo;
+	char *names[VFS_STAT_BULK_MAX];
+	size_t nnames = 0;
+	int dfd = -1;
 	char newdir[256];
 	char *ndir = NULL;
 	ui_file_list_entry_attr_t attr;
@@ -362,29 +409,39 @@ errno_t ui_file_list_read_dir(ui_file_list_t *flist, const char *dirname)
 			goto error;
 	}
 
+	rc = vfs_lookup(".", WALK_DIRECTORY, &dfd);
+	if (rc != EOK)
+		goto error;
+
+	/* Stat entries in batches to save round trips to the file system */
 	dirent = readdir(dir);
-	while (dirent != NULL) {
-		rc = vfs_stat_path(dirent->d_name, &finfo);
-		if (rc != EOK) {
-			/* Possibly a stale entry */
+	while (dirent != NULL || nnames > 0) {
+		if (dirent != NULL) {
+			names[nnames] = str_dup(dirent->d_name);
+			if (names[nnames] == NULL) {
+				rc = ENOMEM;
+				goto error;
+			}
+
+			++nnames;
 			dirent = readdir(dir);
-			continue;
 		}
 
-		ui_file_list_entry_attr_init(&attr);
-		attr.name = dirent->d_name;
-		attr.size = finfo.size;
-		attr.isdir = finfo.is_directory;
-		attr.svc = finfo.service;
-
-		rc = ui_file_list_entry_append(flist, &attr);
-		if (rc != EOK)
-			goto error;
-
-		dirent = readdir(dir);
+		if (nnames == VFS_STAT_BULK_MAX ||
+		    (dirent == NULL && nnames > 0)) {
+			rc = ui_file_list_append_batch(flist, dfd, names,
+			    nnames);
+			while (nnames > 0)
+				free(names[--nnames]);
+			if (rc != EOK)
+				goto error;
+		}
 	}
 
+	vfs_put(dfd);
+	dfd = -1;
 	closedir(dir);
+	dir = NULL;
 
 	rc = ui_file_list_sort(flist);
 	if (rc != EOK)
@@ -415,6 +472,10 @@ errno_t ui_file_list_read_dir(ui_file_list_t *flist, const char *dirname)
 
 	return EOK;
 error:
+	while (nnames > 0)
+		free(names[--nnames]);
+	if (dfd >= 0)
+		vfs_put(dfd);
 	(void) vfs_cwd_set(flist->dir);
 	if (ndir != NULL)
 		free(ndir);
@@ -299,8 +299,19 @@ void virtio_virtq_teardown(virtio_dev_t *vdev, uint16_t num)
 /**
  * Perform device initialization as described in section 3.1.1 of the
  * specification, steps 1 - 6.
+ *
+ * @param vdev[in]      VIRTIO device to set up.
+ * @param features[in]  Device-specific feature bits the driver requires.
+ * @param optional[in]  Device-specific feature bits the driver can use if the
+ *                      device offers them.
+ *
+ * The feature bits that were accepted are stored in \a vdev->features.
+ *
+ * @return  EOK on success, ENOTSUP if the device does not offer all of the
+ *          required features.
  */
-errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features)
+errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features,
+    uint32_t optional)
 {
 	virtio_pci_common_cfg_t *cfg = vdev->common_cfg;
 
@@ -329,7 +340,7 @@ errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features)
 
 	if (features != (features & device_features))
 		return ENOTSUP;
-	features &= device_features;
+	features |= optional & device_features;
 
 	if (reserved_features != (reserved_features & device_reserved_features))
 		return ENOTSUP;
@@ -353,6 +364,7 @@ errno_t virtio_device_setup_start(virtio_dev_t *vdev, uint32_t features)
 	if (!(status & VIRTIO_DEV_STATUS_FEATURES_OK))
 		return ENOTSUP;
 
+	vdev->features = features;
 	return EOK;
 }
 
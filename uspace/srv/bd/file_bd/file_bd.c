@@ -41,8 +41,8 @@
 #include <stdio.h>
 #include <async.h>
 #include <as.h>
+#include <bd.h>
 #include <bd_srv.h>
-#include <fibril_synch.h>
 #include <loc.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -52,6 +52,7 @@
 #include <task.h>
 #include <macros.h>
 #include <str.h>
+#include <vfs/vfs.h>
 
 #define NAME "file_bd"
 
@@ -59,12 +60,12 @@
 
 static size_t block_size;
 static aoff64_t num_blocks;
-static FILE *img;
+/** Image file handle */
+static int img = -1;
 static loc_srv_t *srv;
 
 static service_id_t service_id;
 static bd_srvs_t bd_srvs;
-static fibril_mutex_t dev_lock;
 
 static void print_usage(void);
 static errno_t file_bd_init(const char *fname);
@@ -74,6 +75,11 @@ static errno_t file_bd_open(bd_srvs_t *, bd_srv_t *);
 static errno_t file_bd_close(bd_srv_t *);
 static errno_t file_bd_read_blocks(bd_srv_t *, aoff64_t, size_t, void *, size_t);
 static errno_t file_bd_write_blocks(bd_srv_t *, aoff64_t, size_t, const void *, size_t);
+static errno_t file_bd_read_blocks_v(bd_srv_t *, const bd_extent_t *, size_t,
+    void *, size_t);
+static errno_t file_bd_write_blocks_v(bd_srv_t *, const bd_extent_t *, size_t,
+    const void *, size_t);
+static errno_t file_bd_sync_cache(bd_srv_t *, aoff64_t, size_t);
 static errno_t file_bd_get_block_size(bd_srv_t *, size_t *);
 static errno_t file_bd_get_num_blocks(bd_srv_t *, aoff64_t *);
 
@@ -82,6 +88,9 @@ static bd_ops_t file_bd_ops = {
 	.close = file_bd_close,
 	.read_blocks = file_bd_read_blocks,
 	.write_blocks = file_bd_write_blocks,
+	.read_blocks_v = file_bd_read_blocks_v,
+	.write_blocks_v = file_bd_write_blocks_v,
+	.sync_cache = file_bd_sync_cache,
 	.get_block_size = file_bd_get_block_size,
 	.get_num_blocks = file_bd_get_num_blocks
 };
@@ -183,32 +192,32 @@ static errno_t file_bd_init(const char *fname)
 		return rc;
 	}
 
-	img = fopen(fname, "rb+");
-	if (img == NULL) {
+	/*
+	 * Access the image directly through VFS using explicit positions.
+	 * Unlike stdio, this requires no seeking, no intermediate buffer
+	 * and no locking of a shared file position.
+	 */
+	rc = vfs_lookup_open(fname, WALK_REGULAR, MODE_READ | MODE_WRITE,
+	    &img);
+	if (rc != EOK) {
 		rc = EINVAL;
 		goto error;
 	}
 
-	if (fseek(img, 0, SEEK_END) != 0) {
-		rc = EIO;
-		goto error;
-	}
-
-	off64_t img_size = ftell(img);
-	if (img_size < 0) {
+	vfs_stat_t stat;
+	rc = vfs_stat(img, &stat);
+	if (rc != EOK) {
 		rc = EIO;
 		goto error;
 	}
 
-	num_blocks = img_size / block_size;
-
-	fibril_mutex_initialize(&dev_lock);
+	num_blocks = stat.size / block_size;
 
 	return EOK;
 error:
-	if (img != NULL) {
-		fclose(img);
-		img = NULL;
+	if (img >= 0) {
+		vfs_put(img);
+		img = -1;
 	}
 
 	if (srv != NULL) {
@@ -240,7 +249,9 @@ static errno_t file_bd_close(bd_srv_t *bd)
 static errno_t file_bd_read_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt, void *buf,
     size_t size)
 {
+	aoff64_t pos;
 	size_t n_rd;
+	errno_t rc;
 
 	if (size < cnt * block_size)
 		return EINVAL;
@@ -253,24 +264,12 @@ static errno_t file_bd_read_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt, void *
 		return ELIMIT;
 	}
 
-	fibril_mutex_lock(&dev_lock);
-
-	clearerr(img);
-	if (fseek(img, ba * block_size, SEEK_SET) < 0) {
-		fibril_mutex_unlock(&dev_lock);
-		return EIO;
-	}
-
-	n_rd = fread(buf, block_size, cnt, img);
-
-	if (ferror(img)) {
-		fibril_mutex_unlock(&dev_lock);
+	pos = ba * block_size;
+	rc = vfs_read(img, &pos, buf, cnt * block_size, &n_rd);
+	if (rc != EOK)
 		return EIO;	/* Read error */
-	}
 
-	fibril_mutex_unlock(&dev_lock);
-
-	if (n_rd < cnt)
+	if (n_rd < cnt * block_size)
 		return EINVAL;	/* Read beyond end of device */
 
 	return EOK;
@@ -280,7 +279,9 @@ static errno_t file_bd_read_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt, void *
 static errno_t file_bd_write_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt,
     const void *buf, size_t size)
 {
+	aoff64_t pos;
 	size_t n_wr;
+	errno_t rc;
 
 	if (size < cnt * block_size)
 		return EINVAL;
@@ -293,31 +294,98 @@ static errno_t file_bd_write_blocks(bd_srv_t *bd, uint64_t ba, size_t cnt,
 		return ELIMIT;
 	}
 
-	fibril_mutex_lock(&dev_lock);
+	pos = ba * block_size;
+	rc = vfs_write(img, &pos, buf, cnt * block_size, &n_wr);
+	if (rc != EOK || n_wr < cnt * block_size)
+		return EIO;	/* Write error */
 
-	clearerr(img);
-	if (fseek(img, ba * block_size, SEEK_SET) < 0) {
-		fibril_mutex_unlock(&dev_lock);
-		return EIO;
-	}
+	return EOK;
+}
 
-	n_wr = fwrite(buf, block_size, cnt, img);
+/** Check that all extents lie within the device and match buffer size. */
+static errno_t file_bd_extents_check(const bd_extent_t *ext, size_t next,
+    size_t size)
+{
+	size_t tsize;
+	size_t i;
 
-	if (ferror(img) || n_wr < cnt) {
-		fibril_mutex_unlock(&dev_lock);
-		return EIO;	/* Write error */
+	if (bd_extents_size(ext, next, block_size, &tsize) != EOK ||
+	    tsize != size)
+		return EINVAL;
+
+	/* Check whether access is within device address bounds. */
+	for (i = 0; i < next; i++) {
+		if (ext[i].ba > num_blocks ||
+		    ext[i].cnt > num_blocks - ext[i].ba) {
+			printf(NAME ": Accessed blocks %" PRIu64 "+%" PRIu64
+			    ", while max block number is %" PRIuOFF64 ".\n",
+			    ext[i].ba, ext[i].cnt, num_blocks - 1);
+			return ELIMIT;
+		}
 	}
 
-	if (fflush(img) != 0) {
-		fibril_mutex_unlock(&dev_lock);
-		return EIO;
+	return EOK;
+}
+
+/** Read blocks from multiple extents of the device. */
+static errno_t file_bd_read_blocks_v(bd_srv_t *bd, const bd_extent_t *ext,
+    size_t next, void *buf, size_t size)
+{
+	aoff64_t pos;
+	size_t n_rd;
+	size_t i;
+	errno_t rc;
+
+	rc = file_bd_extents_check(ext, next, size);
+	if (rc != EOK)
+		return rc;
+
+	for (i = 0; i < next; i++) {
+		pos = ext[i].ba * block_size;
+		rc = vfs_read(img, &pos, buf, ext[i].cnt * block_size, &n_rd);
+		if (rc != EOK)
+			return EIO;	/* Read error */
+
+		if (n_rd < ext[i].cnt * block_size)
+			return EINVAL;	/* Read beyond end of device */
+
+		buf += ext[i].cnt * block_size;
 	}
 
-	fibril_mutex_unlock(&dev_lock);
+	return EOK;
+}
+
+/** Write blocks to multiple extents of the device. */
+static errno_t file_bd_write_blocks_v(bd_srv_t *bd, const bd_extent_t *ext,
+    size_t next, const void *buf, size_t size)
+{
+	aoff64_t pos;
+	size_t n_wr;
+	size_t i;
+	errno_t rc;
+
+	rc = file_bd_extents_check(ext, next, size);
+	if (rc != EOK)
+		return rc;
+
+	for (i = 0; i < next; i++) {
+		pos = ext[i].ba * block_size;
+		rc = vfs_write(img, &pos, buf, ext[i].cnt * block_size, &n_wr);
+		if (rc != EOK || n_wr < ext[i].cnt * block_size)
+			return EIO;	/* Write error */
+
+		buf += ext[i].cnt * block_size;
+	}
 
 	return EOK;
 }
 
+/** Synchronize image file to persistent storage. */
+static errno_t file_bd_sync_cache(bd_srv_t *bd, aoff64_t ba, size_t cnt)
+{
+	return vfs_sync(img);
+}
+
 /** Get device block size. */
 static errno_t file_bd_get_block_size(bd_srv_t *bd, size_t *rsize)
 {
@@ -43,6 +43,7 @@
 #include <ipc/ns.h>
 #include <sysinfo.h>
 #include <as.h>
+#include <bd.h>
 #include <bd_srv.h>
 #include <ddi.h>
 #include <align.h>
@@ -71,6 +72,11 @@ static errno_t rd_open(bd_srvs_t *, bd_srv_t *);
 static errno_t rd_close(bd_srv_t *);
 static errno_t rd_read_blocks(bd_srv_t *, aoff64_t, size_t, void *, size_t);
 static errno_t rd_write_blocks(bd_srv_t *, aoff64_t, size_t, const void *, size_t);
+static errno_t rd_read_blocks_v(bd_srv_t *, const bd_extent_t *, size_t,
+    void *, size_t);
+static errno_t rd_write_blocks_v(bd_srv_t *, const bd_extent_t *, size_t,
+    const void *, size_t);
+static errno_t rd_map(bd_srv_t *, void **, size_t *);
 static errno_t rd_get_block_size(bd_srv_t *, size_t *);
 static errno_t rd_get_num_blocks(bd_srv_t *, aoff64_t *);
 
@@ -88,6 +94,9 @@ static bd_ops_t rd_bd_ops = {
 	.close = rd_close,
 	.read_blocks = rd_read_blocks,
 	.write_blocks = rd_write_blocks,
+	.read_blocks_v = rd_read_blocks_v,
+	.write_blocks_v = rd_write_blocks_v,
+	.map = rd_map,
 	.get_block_size = rd_get_block_size,
 	.get_num_blocks = rd_get_num_blocks
 };
@@ -144,6 +153,83 @@ static errno_t rd_write_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
 	return EOK;
 }
 
+/** Check that all extents lie within the device and match buffer size. */
+static errno_t rd_extents_check(const bd_extent_t *ext, size_t next,
+    size_t size)
+{
+	size_t tsize;
+	size_t i;
+
+	if (bd_extents_size(ext, next, block_size, &tsize) != EOK ||
+	    tsize != size)
+		return EINVAL;
+
+	for (i = 0; i < next; i++) {
+		if (ext[i].ba > rd_size / block_size ||
+		    ext[i].cnt > rd_size / block_size - ext[i].ba) {
+			/* Accessing past the end of the device. */
+			return ELIMIT;
+		}
+	}
+
+	return EOK;
+}
+
+/** Read blocks from multiple extents of the device. */
+static errno_t rd_read_blocks_v(bd_srv_t *bd, const bd_extent_t *ext,
+    size_t next, void *buf, size_t size)
+{
+	size_t i;
+	errno_t rc;
+
+	rc = rd_extents_check(ext, next, size);
+	if (rc != EOK)
+		return rc;
+
+	fibril_rwlock_read_lock(&rd_lock);
+	for (i = 0; i < next; i++) {
+		memcpy(buf, rd_addr + ext[i].ba * block_size,
+		    ext[i].cnt * block_size);
+		buf += ext[i].cnt * block_size;
+	}
+	fibril_rwlock_read_unlock(&rd_lock);
+
+	return EOK;
+}
+
+/** Write blocks to multiple extents of the device. */
+static errno_t rd_write_blocks_v(bd_srv_t *bd, const bd_extent_t *ext,
+    size_t next, const void *buf, size_t size)
+{
+	size_t i;
+	errno_t rc;
+
+	rc = rd_extents_check(ext, next, size);
+	if (rc != EOK)
+		return rc;
+
+	fibril_rwlock_write_lock(&rd_lock);
+	for (i = 0; i < next; i++) {
+		memcpy(rd_addr + ext[i].ba * block_size, buf,
+		    ext[i].cnt * block_size);
+		buf += ext[i].cnt * block_size;
+	}
+	fibril_rwlock_write_unlock(&rd_lock);
+
+	return EOK;
+}
+
+/** Share the ramdisk image with the client.
+ *
+ * The client can then access the data directly, without any IPC.
+ */
+static errno_t rd_map(bd_srv_t *bd, void **rarea, size_t *rsize)
+{
+	*rarea = rd_addr;
+	*rsize = ALIGN_UP(rd_size, PAGE_SIZE);
+	return EOK;
+}
+
 /** Prepare the ramdisk image for operation. */
 static bool rd_init(void)
 {
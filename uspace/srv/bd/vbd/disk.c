@@ -65,15 +65,22 @@ static errno_t vbds_disk_parts_remove(vbds_disk_t *, vbds_rem_flag_t);
 
 static errno_t vbds_bd_open(bd_srvs_t *, bd_srv_t *);
 static errno_t vbds_bd_close(bd_srv_t *);
-static errno_t vbds_bd_read_blocks(bd_srv_t *, aoff64_t, size_t, void *, size_t);
+static errno_t vbds_bd_read_blocks_fwd(bd_srv_t *, aoff64_t, size_t,
+    ipc_call_t *, size_t);
 static errno_t vbds_bd_sync_cache(bd_srv_t *, aoff64_t, size_t);
-static errno_t vbds_bd_write_blocks(bd_srv_t *, aoff64_t, size_t, const void *,
-    size_t);
+static errno_t vbds_bd_write_blocks_fwd(bd_srv_t *, aoff64_t, size_t,
+    ipc_call_t *, size_t);
+static errno_t vbds_bd_read_blocks_v_fwd(bd_srv_t *, const bd_extent_t *,
+    size_t, ipc_call_t *, size_t);
+static errno_t vbds_bd_write_blocks_v_fwd(bd_srv_t *, const bd_extent_t *,
+    size_t, ipc_call_t *, size_t);
 static errno_t vbds_bd_get_block_size(bd_srv_t *, size_t *);
 static errno_t vbds_bd_get_num_blocks(bd_srv_t *, aoff64_t *);
 static errno_t vbds_bd_eject(bd_srv_t *);
 
 static errno_t vbds_bsa_translate(vbds_part_t *, aoff64_t, size_t, aoff64_t *);
+static errno_t vbds_extents_translate(vbds_part_t *, const bd_extent_t *,
+    size_t, bd_extent_t **);
 
 static errno_t vbds_part_svc_register(vbds_part_t *);
 static errno_t vbds_part_svc_unregister(vbds_part_t *);
@@ -90,12 +97,14 @@ static errno_t vbds_label_write(void *, aoff64_t, size_t, const void *);
 static bd_ops_t vbds_bd_ops = {
 	.open = vbds_bd_open,
 	.close = vbds_bd_close,
-	.read_blocks = vbds_bd_read_blocks,
 	.sync_cache = vbds_bd_sync_cache,
-	.write_blocks = vbds_bd_write_blocks,
 	.get_block_size = vbds_bd_get_block_size,
 	.get_num_blocks = vbds_bd_get_num_blocks,
-	.eject = vbds_bd_eject
+	.eject = vbds_bd_eject,
+	.read_blocks_fwd = vbds_bd_read_blocks_fwd,
+	.write_blocks_fwd = vbds_bd_write_blocks_fwd,
+	.read_blocks_v_fwd = vbds_bd_read_blocks_v_fwd,
+	.write_blocks_v_fwd = vbds_bd_write_blocks_v_fwd
 };
 
 /** Provide disk access to liblabel */
@@ -973,27 +982,35 @@ static errno_t vbds_bd_close(bd_srv_t *bd)
 	return EOK;
 }
 
-static errno_t vbds_bd_read_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
-    void *buf, size_t size)
+/** Read blocks from partition.
+ *
+ * The client's data read request is forwarded to the disk with
+ * the block address translated, so that the data does not pass
+ * through VBD at all.
+ */
+static errno_t vbds_bd_read_blocks_fwd(bd_srv_t *bd, aoff64_t ba, size_t cnt,
+    ipc_call_t *rcall, size_t size)
 {
 	vbds_part_t *part = bd_srv_part(bd);
 	aoff64_t gba;
 	errno_t rc;
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG2, "vbds_bd_read_blocks()");
+	log_msg(LOG_DEFAULT, LVL_DEBUG2, "vbds_bd_read_blocks_fwd()");
 	fibril_rwlock_read_lock(&part->lock);
 
 	if (cnt * part->disk->block_size < size) {
 		fibril_rwlock_read_unlock(&part->lock);
+		async_answer_0(rcall, EINVAL);
 		return EINVAL;
 	}
 
 	if (vbds_bsa_translate(part, ba, cnt, &gba) != EOK) {
 		fibril_rwlock_read_unlock(&part->lock);
+		async_answer_0(rcall, ELIMIT);
 		return ELIMIT;
 	}
 
-	rc = block_read_direct(part->disk->svc_id, gba, cnt, buf);
+	rc = block_read_forward(part->disk->svc_id, gba, cnt, rcall);
 	fibril_rwlock_read_unlock(&part->lock);
 
 	return rc;
@@ -1023,28 +1040,93 @@ static errno_t vbds_bd_sync_cache(bd_srv_t *bd, aoff64_t ba, size_t cnt)
 	return rc;
 }
 
-static errno_t vbds_bd_write_blocks(bd_srv_t *bd, aoff64_t ba, size_t cnt,
-    const void *buf, size_t size)
+/** Write blocks to partition.
+ *
+ * The client's data write request is forwarded to the disk with
+ * the block address translated.
+ */
+static errno_t vbds_bd_write_blocks_fwd(bd_srv_t *bd, aoff64_t ba, size_t cnt,
+    ipc_call_t *wcall, size_t size)
 {
 	vbds_part_t *part = bd_srv_part(bd);
 	aoff64_t gba;
 	errno_t rc;
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG2, "vbds_bd_write_blocks()");
+	log_msg(LOG_DEFAULT, LVL_DEBUG2, "vbds_bd_write_blocks_fwd()");
 	fibril_rwlock_read_lock(&part->lock);
 
 	if (cnt * part->disk->block_size < size) {
 		fibril_rwlock_read_unlock(&part->lock);
+		async_answer_0(wcall, EINVAL);
 		return EINVAL;
 	}
 
 	if (vbds_bsa_translate(part, ba, cnt, &gba) != EOK) {
 		fibril_rwlock_read_unlock(&part->lock);
+		async_answer_0(wcall, ELIMIT);
 		return ELIMIT;
 	}
 
-	rc = block_write_direct(part->disk->svc_id, gba, cnt, buf);
+	rc = block_write_forward(part->disk->svc_id, gba, cnt, wcall);
+	fibril_rwlock_read_unlock(&part->lock);
+	return rc;
+}
+
+/** Read blocks from multiple partition extents.
+ *
+ * All extents are translated and the request is forwarded to the disk
+ * as a single vectored read.
+ */
+static errno_t vbds_bd_read_blocks_v_fwd(bd_srv_t *bd, const bd_extent_t *ext,
+    size_t next, ipc_call_t *rcall, size_t size)
+{
+	vbds_part_t *part = bd_srv_part(bd);
+	bd_extent_t *gext;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG2, "vbds_bd_read_blocks_v_fwd()");
+	fibril_rwlock_read_lock(&part->lock);
+
+	rc = vbds_extents_translate(part, ext, next, &gext);
+	if (rc != EOK) {
+		fibril_rwlock_read_unlock(&part->lock);
+		async_answer_0(rcall, rc);
+		return rc;
+	}
+
+	rc = block_read_forward_v(part->disk->svc_id, gext, next, rcall);
 	fibril_rwlock_read_unlock(&part->lock);
+
+	free(gext);
+	return rc;
+}
+
+/** Write blocks to multiple partition extents.
+ *
+ * All extents are translated and the request is forwarded to the disk
+ * as a single vectored write.
+ */
+static errno_t vbds_bd_write_blocks_v_fwd(bd_srv_t *bd, const bd_extent_t *ext,
+    size_t next, ipc_call_t *wcall, size_t size)
+{
+	vbds_part_t *part = bd_srv_part(bd);
+	bd_extent_t *gext;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG2, "vbds_bd_write_blocks_v_fwd()");
+	fibril_rwlock_read_lock(&part->lock);
+
+	rc = vbds_extents_translate(part, ext, next, &gext);
+	if (rc != EOK) {
+		fibril_rwlock_read_unlock(&part->lock);
+		async_answer_0(wcall, rc);
+		return rc;
+	}
+
+	rc = block_write_forward_v(part->disk->svc_id, gext, next, wcall);
+	fibril_rwlock_read_unlock(&part->lock);
+
+	free(gext);
 	return rc;
 }
 
@@ -1147,6 +1229,43 @@ static errno_t vbds_bsa_translate(vbds_part_t *part, aoff64_t ba, size_t cnt,
 	return EOK;
 }
 
+/** Translate list of extents with range checking.
+ *
+ * @param part Partition
+ * @param ext Extents relative to partition
+ * @param next Number of extents
+ * @param rgext Place to store pointer to newly allocated array of
+ *              translated extents
+ * @return EOK on success, ELIMIT if an extent is out of range,
+ *         ENOMEM if out of memory
+ */
+static errno_t vbds_extents_translate(vbds_part_t *part, const bd_extent_t *ext,
+    size_t next, bd_extent_t **rgext)
+{
+	bd_extent_t *gext;
+	aoff64_t gba;
+	size_t i;
+
+	gext = calloc(next, sizeof(bd_extent_t));
+	if (gext == NULL)
+		return ENOMEM;
+
+	for (i = 0; i < next; i++) {
+		if (ext[i].cnt > part->nblocks ||
+		    vbds_bsa_translate(part, ext[i].ba, ext[i].cnt,
+		    &gba) != EOK) {
+			free(gext);
+			return ELIMIT;
+		}
+
+		gext[i].ba = gba;
+		gext[i].cnt = ext[i].cnt;
+	}
+
+	*rgext = gext;
+	return EOK;
+}
+
 /** Register service for partition */
 static errno_t vbds_part_svc_register(vbds_part_t *part)
 {
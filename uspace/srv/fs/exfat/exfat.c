@@ -55,6 +55,8 @@ vfs_info_t exfat_vfs_info = {
 	.name = NAME,
 	.concurrent_read_write = false,
 	.write_retains_size = false,
+	.cache_lookups = false,
+	.cache_pages = true,
 	.instance = 0,
 };
 
@@ -161,6 +161,9 @@ typedef struct exfat_node {
 	bool		currc_cached_valid;
 	aoff64_t	currc_cached_bn;
 	exfat_cluster_t	currc_cached_value;
+
+	/** Name index of a directory node or @c NULL if not built yet. */
+	fs_dindex_t	*dindex;
 } exfat_node_t;
 
 extern vfs_out_ops_t exfat_ops;
@@ -555,6 +555,128 @@ errno_t exfat_directory_lookup_free(exfat_directory_t *di, size_t count)
 	return ENOSPC;
 }
 
+/** Build the name index of a directory.
+ *
+ * @param nodep		Locked directory node.
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t exfat_directory_index_build(exfat_node_t *nodep)
+{
+	char name[EXFAT_FILENAME_LEN + 1];
+	exfat_file_dentry_t df;
+	exfat_stream_dentry_t ds;
+	fs_dindex_t *dindex;
+	exfat_directory_t di;
+	errno_t rc;
+
+	rc = fs_dindex_create(&dindex);
+	if (rc != EOK)
+		return rc;
+
+	rc = exfat_directory_open(nodep, &di);
+	if (rc != EOK) {
+		fs_dindex_destroy(dindex);
+		return rc;
+	}
+
+	while ((rc = exfat_directory_read_file(&di, name, EXFAT_FILENAME_LEN,
+	    &df, &ds)) == EOK) {
+		/* di.pos points to the file entry again */
+		rc = fs_dindex_insert(dindex, name, di.pos);
+		if (rc != EOK)
+			break;
+
+		rc = exfat_directory_next(&di);
+		if (rc != EOK)
+			break;
+	}
+
+	if (rc != ENOENT) {
+		(void) exfat_directory_close(&di);
+		fs_dindex_destroy(dindex);
+		return rc;
+	}
+
+	rc = exfat_directory_close(&di);
+	if (rc != EOK) {
+		fs_dindex_destroy(dindex);
+		return rc;
+	}
+
+	nodep->dindex = dindex;
+	return EOK;
+}
+
+/** Look up a name using the directory name index.
+ *
+ * The index is built on first use by reading the whole directory.
+ *
+ * @param nodep		Locked directory node.
+ * @param name		Name to look up.
+ * @param pos		Place to store the position of the file entry.
+ *
+ * @return		EOK on success, ENOENT if there is no such name or
+ *			another error code if the index cannot be built.
+ */
+errno_t exfat_directory_index_lookup(exfat_node_t *nodep, const char *name,
+    aoff64_t *pos)
+{
+	errno_t rc;
+
+	if (nodep->dindex == NULL) {
+		rc = exfat_directory_index_build(nodep);
+		if (rc != EOK)
+			return (rc == ENOENT) ? EIO : rc;
+	}
+
+	return fs_dindex_lookup(nodep->dindex, name, pos);
+}
+
+/** Add a name to the directory name index if the index exists.
+ *
+ * @param nodep		Locked directory node.
+ * @param name		Name of the new file.
+ * @param pos		Position of the file entry.
+ */
+void exfat_directory_index_insert(exfat_node_t *nodep, const char *name,
+    aoff64_t pos)
+{
+	if (nodep->dindex == NULL)
+		return;
+
+	if (fs_dindex_insert(nodep->dindex, name, pos) != EOK)
+		exfat_directory_index_drop(nodep);
+}
+
+/** Remove a name from the directory name index if the index exists.
+ *
+ * @param nodep		Locked directory node.
+ * @param name		Name of the removed file.
+ * @param pos		Position of the file entry.
+ */
+void exfat_directory_index_remove(exfat_node_t *nodep, const char *name,
+    aoff64_t pos)
+{
+	if (nodep->dindex == NULL)
+		return;
+
+	if (!fs_dindex_remove(nodep->dindex, name, pos))
+		exfat_directory_index_drop(nodep);
+}
+
+/** Drop the directory name index.
+ *
+ * It will be rebuilt on the next lookup.
+ *
+ * @param nodep		Directory node.
+ */
+void exfat_directory_index_drop(exfat_node_t *nodep)
+{
+	fs_dindex_destroy(nodep->dindex);
+	nodep->dindex = NULL;
+}
+
 /**
  * @}
  */
@@ -79,6 +79,14 @@ extern errno_t exfat_directory_expand(exfat_directory_t *);
 extern errno_t exfat_directory_lookup_free(exfat_directory_t *, size_t);
 extern errno_t exfat_directory_print(exfat_directory_t *);
 
+extern errno_t exfat_directory_index_lookup(exfat_node_t *, const char *,
+    aoff64_t *);
+extern void exfat_directory_index_insert(exfat_node_t *, const char *,
+    aoff64_t);
+extern void exfat_directory_index_remove(exfat_node_t *, const char *,
+    aoff64_t);
+extern void exfat_directory_index_drop(exfat_node_t *);
+
 #endif
 
 /**
@@ -113,6 +113,7 @@ static void exfat_node_initialize(exfat_node_t *node)
 	node->currc_cached_valid = false;
 	node->currc_cached_bn = 0;
 	node->currc_cached_value = 0;
+	node->dindex = NULL;
 }
 
 static errno_t exfat_node_sync(exfat_node_t *node)
@@ -201,6 +202,7 @@ restart:
 				return rc;
 		}
 		nodep->idx->nodep = NULL;
+		exfat_directory_index_drop(nodep);
 		free(nodep->bp);
 		free(nodep);
 
@@ -239,12 +241,14 @@ static errno_t exfat_node_get_new(exfat_node_t **nodepp)
 				idxp_tmp->nodep = NULL;
 				fibril_mutex_unlock(&nodep->lock);
 				fibril_mutex_unlock(&idxp_tmp->lock);
+				exfat_directory_index_drop(nodep);
 				free(nodep->bp);
 				free(nodep);
 				return rc;
 			}
 		}
 		idxp_tmp->nodep = NULL;
+		exfat_directory_index_drop(nodep);
 		fibril_mutex_unlock(&nodep->lock);
 		fibril_mutex_unlock(&idxp_tmp->lock);
 		fn = FS_NODE(nodep);
@@ -512,12 +516,39 @@ errno_t exfat_match(fs_node_t **rfn, fs_node_t *pfn, const char *component)
 	exfat_file_dentry_t df;
 	exfat_stream_dentry_t ds;
 	service_id_t service_id;
+	exfat_node_t *nodep;
+	exfat_idx_t *idx;
+	aoff64_t pos;
 	errno_t rc;
 
 	fibril_mutex_lock(&parentp->idx->lock);
 	service_id = parentp->idx->service_id;
 	fibril_mutex_unlock(&parentp->idx->lock);
 
+	/*
+	 * Try the directory name index first so that we do not have to
+	 * read all the file entry sets on every lookup.
+	 */
+	fibril_mutex_lock(&parentp->lock);
+	rc = exfat_directory_index_lookup(parentp, component, &pos);
+	fibril_mutex_unlock(&parentp->lock);
+	if (rc == ENOENT) {
+		*rfn = NULL;
+		return EOK;
+	}
+	if (rc == EOK) {
+		idx = exfat_idx_get_by_pos(service_id, parentp->firstc, pos);
+		if (!idx)
+			return ENOMEM;
+		rc = exfat_node_get_core(&nodep, idx);
+		fibril_mutex_unlock(&idx->lock);
+		if (rc != EOK)
+			return rc;
+		*rfn = FS_NODE(nodep);
+		return EOK;
+	}
+
+	/* The index could not be built, scan the directory instead. */
 	exfat_directory_t di;
 	rc = exfat_directory_open(parentp, &di);
 	if (rc != EOK)
@@ -527,10 +558,9 @@ errno_t exfat_match(fs_node_t **rfn, fs_node_t *pfn, const char *component)
 	    &ds) == EOK) {
 		if (str_casecmp(name, component) == 0) {
 			/* hit */
-			exfat_node_t *nodep;
 			aoff64_t o = di.pos %
 			    (BPS(di.bs) / sizeof(exfat_dentry_t));
-			exfat_idx_t *idx = exfat_idx_get_by_pos(service_id,
+			idx = exfat_idx_get_by_pos(service_id,
 			    parentp->firstc, di.bnum * DPS(di.bs) + o);
 			if (!idx) {
 				/*
@@ -617,6 +647,7 @@ errno_t exfat_node_put(fs_node_t *fn)
 	}
 	fibril_mutex_unlock(&nodep->lock);
 	if (destroy) {
+		exfat_directory_index_drop(nodep);
 		free(nodep->bp);
 		free(nodep);
 	}
@@ -711,6 +742,7 @@ errno_t exfat_destroy_node(fs_node_t *fn)
 	}
 
 	exfat_idx_destroy(nodep->idx);
+	exfat_directory_index_drop(nodep);
 	free(nodep->bp);
 	free(nodep);
 	return rc;
@@ -760,6 +792,11 @@ errno_t exfat_link(fs_node_t *pfn, fs_node_t *cfn, const char *name)
 	}
 
 	fibril_mutex_unlock(&parentp->idx->lock);
+
+	fibril_mutex_lock(&parentp->lock);
+	exfat_directory_index_insert(parentp, name, di.pos);
+	fibril_mutex_unlock(&parentp->lock);
+
 	fibril_mutex_lock(&childp->idx->lock);
 
 	childp->idx->pfc = parentp->firstc;
@@ -813,6 +850,8 @@ errno_t exfat_unlink(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 	if (rc != EOK)
 		goto error;
 
+	exfat_directory_index_remove(parentp, nm, childp->idx->pdi);
+
 	/* remove the index structure from the position hash */
 	exfat_idx_hashout(childp->idx);
 	/* clear position information */
@@ -50,6 +50,8 @@
 
 vfs_info_t ext4fs_vfs_info = {
 	.name = NAME,
+	.cache_lookups = true,
+	.cache_pages = true,
 	.instance = 0
 };
 
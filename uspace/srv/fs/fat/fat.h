@@ -221,6 +221,16 @@ typedef struct {
 	struct fat_node	*nodep;
 } fat_idx_t;
 
+/** Run of physically contiguous clusters of a node. */
+typedef struct {
+	/** Logical number of the first cluster of the run within the node. */
+	uint32_t	lcl;
+	/** Physical number of the first cluster of the run. */
+	fat_cluster_t	pcl;
+	/** Number of clusters in the run. */
+	uint32_t	count;
+} fat_run_t;
+
 /** FAT in-core node. */
 typedef struct fat_node {
 	/** Back pointer to the FS node. */
@@ -243,20 +253,33 @@ typedef struct fat_node {
 	bool			dirty;
 
 	/*
-	 * Cache of the node's last and "current" cluster to avoid some
-	 * unnecessary FAT walks.
+	 * Cache of the node's last cluster to avoid some unnecessary FAT
+	 * walks.
 	 */
-	/* Node's last cluster in FAT. */
 	bool		lastc_cached_valid;
 	fat_cluster_t	lastc_cached_value;
-	/* Node's "current" cluster, i.e. where the last I/O took place. */
-	bool		currc_cached_valid;
-	aoff64_t	currc_cached_bn;
-	fat_cluster_t	currc_cached_value;
+
+	/*
+	 * Cache of the beginning of the node's cluster chain. The runs are
+	 * sorted by their logical cluster numbers and cover logical clusters
+	 * 0 .. runs_clusters - 1.
+	 */
+	fat_run_t	*runs;
+	/** Number of valid runs. */
+	size_t		runs_count;
+	/** Number of allocated runs. */
+	size_t		runs_size;
+	/** Number of clusters covered by the runs. */
+	uint32_t	runs_clusters;
+
+	/** Name index of a directory node or @c NULL if not built yet. */
+	fs_dindex_t	*dindex;
 } fat_node_t;
 
 typedef struct {
 	bool lfn_enabled;
+	/** Map of free clusters or @c NULL if not available. */
+	struct fat_free_map *free_map;
 } fat_instance_t;
 
 extern vfs_out_ops_t fat_ops;
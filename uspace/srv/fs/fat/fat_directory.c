@@ -561,6 +561,156 @@ errno_t fat_directory_vollabel_get(fat_directory_t *di, char *label)
 	return ENOENT;
 }
 
+/** Get the key of a name in the directory name index.
+ *
+ * A name without an extension also matches the same name followed by
+ * a dot (see fat_dentry_namecmp()), so such a trailing dot is dropped.
+ *
+ * @param name		Name.
+ * @param key		Buffer for the key of FAT_LFN_NAME_SIZE bytes.
+ */
+static void fat_directory_index_key(const char *name, char *key)
+{
+	size_t size;
+
+	str_cpy(key, FAT_LFN_NAME_SIZE, name);
+	size = str_size(key);
+	if (size > 1 && key[size - 1] == '.') {
+		key[size - 1] = '\0';
+		if (str_chr(key, '.') != NULL)
+			key[size - 1] = '.';
+	}
+}
+
+/** Build the name index of a directory.
+ *
+ * @param nodep		Locked directory node.
+ *
+ * @return		EOK on success or an error code.
+ */
+static errno_t fat_directory_index_build(fat_node_t *nodep)
+{
+	char name[FAT_LFN_NAME_SIZE];
+	char key[FAT_LFN_NAME_SIZE];
+	fs_dindex_t *dindex;
+	fat_directory_t di;
+	fat_dentry_t *d;
+	errno_t rc;
+
+	rc = fs_dindex_create(&dindex);
+	if (rc != EOK)
+		return rc;
+
+	rc = fat_directory_open(nodep, &di);
+	if (rc != EOK) {
+		fs_dindex_destroy(dindex);
+		return rc;
+	}
+
+	while ((rc = fat_directory_read(&di, name, &d)) == EOK) {
+		fat_directory_index_key(name, key);
+		rc = fs_dindex_insert(dindex, key, di.pos);
+		if (rc != EOK)
+			break;
+
+		rc = fat_directory_next(&di);
+		if (rc != EOK)
+			break;
+	}
+
+	if (rc != ENOENT) {
+		(void) fat_directory_close(&di);
+		fs_dindex_destroy(dindex);
+		return rc;
+	}
+
+	rc = fat_directory_close(&di);
+	if (rc != EOK) {
+		fs_dindex_destroy(dindex);
+		return rc;
+	}
+
+	nodep->dindex = dindex;
+	return EOK;
+}
+
+/** Look up a name using the directory name index.
+ *
+ * The index is built on first use by reading the whole directory.
+ *
+ * @param nodep		Locked directory node.
+ * @param name		Name to look up.
+ * @param pos		Place to store the position of the short name entry.
+ *
+ * @return		EOK on success, ENOENT if there is no such name or
+ *			another error code if the index cannot be built.
+ */
+errno_t fat_directory_index_lookup(fat_node_t *nodep, const char *name,
+    aoff64_t *pos)
+{
+	char key[FAT_LFN_NAME_SIZE];
+	errno_t rc;
+
+	if (nodep->dindex == NULL) {
+		rc = fat_directory_index_build(nodep);
+		if (rc != EOK)
+			return (rc == ENOENT) ? EIO : rc;
+	}
+
+	fat_directory_index_key(name, key);
+	return fs_dindex_lookup(nodep->dindex, key, pos);
+}
+
+/** Add a name to the directory name index if the index exists.
+ *
+ * @param nodep		Locked directory node.
+ * @param name		Name of the new entry.
+ * @param pos		Position of the short name entry.
+ */
+void fat_directory_index_insert(fat_node_t *nodep, const char *name,
+    aoff64_t pos)
+{
+	char key[FAT_LFN_NAME_SIZE];
+
+	if (nodep->dindex == NULL)
+		return;
+
+	fat_directory_index_key(name, key);
+	if (fs_dindex_insert(nodep->dindex, key, pos) != EOK)
+		fat_directory_index_drop(nodep);
+}
+
+/** Remove a name from the directory name index if the index exists.
+ *
+ * @param nodep		Locked directory node.
+ * @param name		Name of the removed entry.
+ * @param pos		Position of the short name entry.
+ */
+void fat_directory_index_remove(fat_node_t *nodep, const char *name,
+    aoff64_t pos)
+{
+	char key[FAT_LFN_NAME_SIZE];
+
+	if (nodep->dindex == NULL)
+		return;
+
+	fat_directory_index_key(name, key);
+	if (!fs_dindex_remove(nodep->dindex, key, pos))
+		fat_directory_index_drop(nodep);
+}
+
+/** Drop the directory name index.
+ *
+ * It will be rebuilt on the next lookup.
+ *
+ * @param nodep		Directory node.
+ */
+void fat_directory_index_drop(fat_node_t *nodep)
+{
+	fs_dindex_destroy(nodep->dindex);
+	nodep->dindex = NULL;
+}
+
 /**
  * @}
  */
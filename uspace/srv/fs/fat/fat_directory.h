@@ -72,6 +72,12 @@ extern errno_t fat_directory_create_sfn(fat_directory_t *, fat_dentry_t *,
 extern errno_t fat_directory_expand(fat_directory_t *);
 extern errno_t fat_directory_vollabel_get(fat_directory_t *, char *);
 
+extern errno_t fat_directory_index_lookup(fat_node_t *, const char *,
+    aoff64_t *);
+extern void fat_directory_index_insert(fat_node_t *, const char *, aoff64_t);
+extern void fat_directory_index_remove(fat_node_t *, const char *, aoff64_t);
+extern void fat_directory_index_drop(fat_node_t *);
+
 #endif
 
 /**
@@ -46,6 +46,7 @@
 #include <byteorder.h>
 #include <align.h>
 #include <assert.h>
+#include <bitops.h>
 #include <fibril_synch.h>
 #include <mem.h>
 #include <stdlib.h>
@@ -112,6 +113,139 @@ fat_cluster_walk(fat_bs_t *bs, service_id_t service_id, fat_cluster_t firstc,
 	return EOK;
 }
 
+/** Maximum number of cached cluster runs per node. */
+#define FAT_RUNS_MAX	4096
+
+/** Drop the cached cluster runs of a node.
+ *
+ * @param nodep		FAT node.
+ */
+void fat_runs_clear(fat_node_t *nodep)
+{
+	free(nodep->runs);
+	nodep->runs = NULL;
+	nodep->runs_count = 0;
+	nodep->runs_size = 0;
+	nodep->runs_clusters = 0;
+}
+
+/** Append a cluster to the cached cluster runs of a node.
+ *
+ * @param nodep		FAT node.
+ * @param clst		Physical cluster number of the next logical cluster
+ *			of the node.
+ *
+ * @return		EOK on success, ENOMEM if the cluster could not be
+ *			added to the cache.
+ */
+static errno_t fat_runs_append(fat_node_t *nodep, fat_cluster_t clst)
+{
+	fat_run_t *run;
+
+	if (nodep->runs_count > 0) {
+		run = &nodep->runs[nodep->runs_count - 1];
+		if (run->pcl + run->count == clst) {
+			run->count++;
+			nodep->runs_clusters++;
+			return EOK;
+		}
+	}
+
+	if (nodep->runs_count == nodep->runs_size) {
+		size_t nsize = max(2 * nodep->runs_size, 4);
+		if (nsize > FAT_RUNS_MAX)
+			return ENOMEM;
+
+		run = realloc(nodep->runs, nsize * sizeof(fat_run_t));
+		if (run == NULL)
+			return ENOMEM;
+
+		nodep->runs = run;
+		nodep->runs_size = nsize;
+	}
+
+	run = &nodep->runs[nodep->runs_count++];
+	run->lcl = nodep->runs_clusters;
+	run->pcl = clst;
+	run->count = 1;
+	nodep->runs_clusters++;
+	return EOK;
+}
+
+/** Translate logical cluster number of a node to physical cluster number.
+ *
+ * The beginning of the node's cluster chain is cached as a sorted list
+ * of cluster runs, so the lookup is a binary search. The cache is extended
+ * by walking the FAT whenever a cluster beyond it is requested.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param nodep		FAT node.
+ * @param lcl		Logical cluster number within the node.
+ * @param clst		Place to store the physical cluster number.
+ *
+ * @return		EOK on success, ELIMIT if the node's cluster chain
+ *			is shorter or an error code.
+ */
+errno_t fat_node_cluster_get(fat_bs_t *bs, fat_node_t *nodep, uint32_t lcl,
+    fat_cluster_t *clst)
+{
+	service_id_t service_id = nodep->idx->service_id;
+	fat_cluster_t clst_last1 = FAT_CLST_LAST1(bs);
+	fat_cluster_t c;
+	bool caching = true;
+	uint32_t n;
+	errno_t rc;
+
+	if (lcl < nodep->runs_clusters) {
+		size_t lo = 0;
+		size_t hi = nodep->runs_count;
+
+		while (hi - lo > 1) {
+			size_t mid = (lo + hi) / 2;
+			if (nodep->runs[mid].lcl <= lcl)
+				lo = mid;
+			else
+				hi = mid;
+		}
+
+		*clst = nodep->runs[lo].pcl + (lcl - nodep->runs[lo].lcl);
+		return EOK;
+	}
+
+	/* Continue walking the chain where the cached part ends. */
+	n = nodep->runs_clusters;
+	if (n == 0) {
+		c = nodep->firstc;
+	} else {
+		fat_run_t *run = &nodep->runs[nodep->runs_count - 1];
+		rc = fat_get_cluster(bs, service_id, FAT1,
+		    run->pcl + run->count - 1, &c);
+		if (rc != EOK)
+			return rc;
+	}
+
+	while (true) {
+		if (c < FAT_CLST_FIRST || c >= clst_last1)
+			return ELIMIT;
+		assert(c != FAT_CLST_BAD(bs));
+
+		/* Once the cache is full, just walk the rest of the chain. */
+		if (caching && fat_runs_append(nodep, c) != EOK)
+			caching = false;
+
+		if (n == lcl)
+			break;
+
+		rc = fat_get_cluster(bs, service_id, FAT1, c, &c);
+		if (rc != EOK)
+			return rc;
+		n++;
+	}
+
+	*clst = c;
+	return EOK;
+}
+
 /** Read block from file located on a FAT file system.
  *
  * @param block		Pointer to a block pointer for storing result.
@@ -126,16 +260,16 @@ errno_t
 fat_block_get(block_t **block, struct fat_bs *bs, fat_node_t *nodep,
     aoff64_t bn, int flags)
 {
-	fat_cluster_t firstc = nodep->firstc;
-	fat_cluster_t currc = 0;
-	aoff64_t relbn = bn;
+	fat_cluster_t c;
 	errno_t rc;
 
 	if (!nodep->size)
 		return ELIMIT;
 
-	if (!FAT_IS_FAT32(bs) && nodep->firstc == FAT_CLST_ROOT)
-		goto fall_through;
+	if (!FAT_IS_FAT32(bs) && nodep->firstc == FAT_CLST_ROOT) {
+		return _fat_block_get(block, bs, nodep->idx->service_id,
+		    nodep->firstc, NULL, bn, flags);
+	}
 
 	if (((((nodep->size - 1) / BPS(bs)) / SPC(bs)) == bn / SPC(bs)) &&
 	    nodep->lastc_cached_valid) {
@@ -147,29 +281,12 @@ fat_block_get(block_t **block, struct fat_bs *bs, fat_node_t *nodep,
 		    CLBN2PBN(bs, nodep->lastc_cached_value, bn), flags);
 	}
 
-	if (nodep->currc_cached_valid && bn >= nodep->currc_cached_bn) {
-		/*
-		 * We can start with the cluster cached by the previous call to
-		 * fat_block_get().
-		 */
-		firstc = nodep->currc_cached_value;
-		relbn -= (nodep->currc_cached_bn / SPC(bs)) * SPC(bs);
-	}
-
-fall_through:
-	rc = _fat_block_get(block, bs, nodep->idx->service_id, firstc,
-	    &currc, relbn, flags);
+	rc = fat_node_cluster_get(bs, nodep, bn / SPC(bs), &c);
 	if (rc != EOK)
 		return rc;
 
-	/*
-	 * Update the "current" cluster cache.
-	 */
-	nodep->currc_cached_valid = true;
-	nodep->currc_cached_bn = bn;
-	nodep->currc_cached_value = currc;
-
-	return rc;
+	return block_get(block, nodep->idx->service_id, CLBN2PBN(bs, c, bn),
+	    flags);
 }
 
 /** Read block from file located on a FAT file system.
@@ -625,6 +742,258 @@ fat_set_cluster(fat_bs_t *bs, service_id_t service_id, unsigned fatno,
 	return rc;
 }
 
+/** Maximum number of levels of the free cluster map.
+ *
+ * Five levels of 64-bit words are enough for 2^30 clusters.
+ */
+#define FMAP_LEVELS_MAX	5
+
+/** Map of free clusters.
+ *
+ * Level 0 has one bit per cluster, set if the cluster is free. Each bit of
+ * a higher level tells whether the corresponding word of the level below
+ * has any bit set, so a free cluster can be found in O(log n) steps.
+ * The map is protected by fat_alloc_lock.
+ */
+typedef struct fat_free_map {
+	/** Number of levels. */
+	unsigned levels;
+	/** Bit arrays of the individual levels. */
+	uint64_t *level[FMAP_LEVELS_MAX];
+	/** Number of words of the individual levels. */
+	size_t words[FMAP_LEVELS_MAX];
+	/** Number of free clusters. */
+	uint32_t nfree;
+} fat_free_map_t;
+
+#define FMAP_NONE	((uint32_t) -1)
+
+/** Lowest set bit of a non-zero word. */
+static unsigned fmap_lsb(uint64_t w)
+{
+	return fnzb64(w & -w);
+}
+
+/** Mark cluster as free in the free cluster map. */
+static void fmap_set(fat_free_map_t *map, uint32_t clst)
+{
+	uint64_t pos = clst;
+
+	for (unsigned l = 0; l < map->levels; l++) {
+		uint64_t *w = &map->level[l][pos / 64];
+		bool was_empty = (*w == 0);
+
+		if (l == 0 && (*w & BIT_V(uint64_t, pos % 64)) == 0)
+			map->nfree++;
+
+		*w |= BIT_V(uint64_t, pos % 64);
+		if (!was_empty)
+			break;
+		pos /= 64;
+	}
+}
+
+/** Mark cluster as used in the free cluster map. */
+static void fmap_clear(fat_free_map_t *map, uint32_t clst)
+{
+	uint64_t pos = clst;
+
+	for (unsigned l = 0; l < map->levels; l++) {
+		uint64_t *w = &map->level[l][pos / 64];
+
+		if (l == 0 && (*w & BIT_V(uint64_t, pos % 64)) != 0)
+			map->nfree--;
+
+		*w &= ~BIT_V(uint64_t, pos % 64);
+		if (*w != 0)
+			break;
+		pos /= 64;
+	}
+}
+
+/** Find the first free cluster at or after @a start.
+ *
+ * @return Cluster number or FMAP_NONE if there is no such cluster.
+ */
+static uint32_t fmap_find(fat_free_map_t *map, uint32_t start)
+{
+	uint64_t pos = start;
+	unsigned l = 0;
+
+	/* Go up until a level has a set bit at or after the position. */
+	while (true) {
+		if (l == map->levels)
+			return FMAP_NONE;
+
+		size_t idx = pos / 64;
+		if (idx >= map->words[l])
+			return FMAP_NONE;
+
+		uint64_t w = map->level[l][idx] & ~BIT_RRANGE(uint64_t, pos % 64);
+		if (w != 0) {
+			pos = idx * 64 + fmap_lsb(w);
+			break;
+		}
+
+		pos = idx + 1;
+		l++;
+	}
+
+	/* Go down following the lowest set bits. */
+	while (l > 0) {
+		l--;
+		assert(map->level[l][pos] != 0);
+		pos = pos * 64 + fmap_lsb(map->level[l][pos]);
+	}
+
+	return (uint32_t) pos;
+}
+
+/** Build the map of free clusters of a file system.
+ *
+ * The first FAT is read sector by sector, which is done once at mount
+ * time so that allocations do not need to scan the FAT.
+ *
+ * @param bs		Buffer holding the boot sector of the file system.
+ * @param service_id	Service ID of the file system.
+ * @param rmap		Place to store the new map.
+ *
+ * @return		EOK on success or an error code.
+ */
+errno_t fat_free_map_create(fat_bs_t *bs, service_id_t service_id,
+    fat_free_map_t **rmap)
+{
+	fat_free_map_t *map;
+	uint32_t nclsts = CC(bs) + 2;
+	uint64_t bits = nclsts;
+	errno_t rc;
+
+	map = calloc(1, sizeof(fat_free_map_t));
+	if (map == NULL)
+		return ENOMEM;
+
+	do {
+		if (map->levels == FMAP_LEVELS_MAX) {
+			rc = ENOTSUP;
+			goto error;
+		}
+
+		map->words[map->levels] = (bits + 63) / 64;
+		map->level[map->levels] = calloc(map->words[map->levels],
+		    sizeof(uint64_t));
+		if (map->level[map->levels] == NULL) {
+			rc = ENOMEM;
+			goto error;
+		}
+
+		bits = map->words[map->levels];
+		map->levels++;
+	} while (bits > 1);
+
+	if (FAT_IS_FAT12(bs)) {
+		for (uint32_t clst = FAT_CLST_FIRST; clst < nclsts; clst++) {
+			fat_cluster_t value;
+
+			rc = fat_get_cluster(bs, service_id, FAT1, clst, &value);
+			if (rc != EOK)
+				goto error;
+			if (value == FAT_CLST_RES0)
+				fmap_set(map, clst);
+		}
+	} else {
+		size_t csize = FAT_CLST_SIZE(bs);
+		uint32_t per_sector = BPS(bs) / csize;
+		uint32_t clst = 0;
+
+		for (uint32_t sec = 0; sec < SF(bs) && clst < nclsts; sec++) {
+			block_t *b;
+
+			rc = block_get(&b, service_id, RSCNT(bs) + sec,
+			    BLOCK_FLAGS_NONE);
+			if (rc != EOK)
+				goto error;
+
+			for (uint32_t i = 0; i < per_sector && clst < nclsts;
+			    i++, clst++) {
+				fat_cluster_t value;
+
+				if (csize == FAT32_CLST_SIZE) {
+					value = uint32_t_le2host(((uint32_t *)
+					    b->data)[i]) & FAT32_MASK;
+				} else {
+					value = uint16_t_le2host(((uint16_t *)
+					    b->data)[i]);
+				}
+
+				if (clst >= FAT_CLST_FIRST &&
+				    value == FAT_CLST_RES0)
+					fmap_set(map, clst);
+			}
+
+			rc = block_put(b);
+			if (rc != EOK)
+				goto error;
+		}
+	}
+
+	*rmap = map;
+	return EOK;
+error:
+	fat_free_map_destroy(map);
+	return rc;
+}
+
+/** Destroy the map of free clusters.
+ *
+ * @param map		Map of free clusters or @c NULL.
+ */
+void fat_free_map_destroy(fat_free_map_t *map)
+{
+	if (map == NULL)
+		return;
+
+	for (unsigned l = 0; l < map->levels; l++)
+		free(map->level[l]);
+	free(map);
+}
+
+/** Get the free cluster map of a mounted file system.
+ *
+ * @return		Map of free clusters or @c NULL if not available.
+ */
+static fat_free_map_t *fat_free_map_get(service_id_t service_id)
+{
+	fat_instance_t *instance;
+	void *data;
+
+	if (fs_instance_get(service_id, &data) != EOK)
+		return NULL;
+
+	instance = (fat_instance_t *) data;
+	return instance->free_map;
+}
+
+/** Get the number of free clusters from the free cluster map.
+ *
+ * @param service_id	Service ID of the file system.
+ * @param count		Place to store the number of free clusters.
+ *
+ * @return		@c true on success, @c false if the map is not
+ *			available.
+ */
+bool fat_free_map_count(service_id_t service_id, uint64_t *count)
+{
+	fat_free_map_t *map = fat_free_map_get(service_id);
+
+	if (map == NULL)
+		return false;
+
+	fibril_mutex_lock(&fat_alloc_lock);
+	*count = map->nfree;
+	fibril_mutex_unlock(&fat_alloc_lock);
+	return true;
+}
+
 /** Replay the allocatoin of clusters in all shadow instances of FAT.
  *
  * @param bs		Buffer holding the boot sector of the file system.
@@ -675,6 +1044,7 @@ errno_t
 fat_alloc_clusters(fat_bs_t *bs, service_id_t service_id, unsigned nclsts,
     fat_cluster_t *mcl, fat_cluster_t *lcl)
 {
+	fat_free_map_t *map;
 	fat_cluster_t *lifo;    /* stack for storing free cluster numbers */
 	unsigned found = 0;     /* top of the free cluster number stack */
 	fat_cluster_t clst;
@@ -686,10 +1056,59 @@ fat_alloc_clusters(fat_bs_t *bs, service_id_t service_id, unsigned nclsts,
 	if (!lifo)
 		return ENOMEM;
 
+	fibril_mutex_lock(&fat_alloc_lock);
+
+	map = fat_free_map_get(service_id);
+	if (map != NULL) {
+		/*
+		 * Take the free clusters from the map. They are chained
+		 * in ascending order so that contiguous free space yields
+		 * a contiguous run.
+		 */
+		if (map->nfree < nclsts)
+			goto nospace;
+
+		clst = FAT_CLST_FIRST;
+		for (found = 0; found < nclsts; found++) {
+			clst = fmap_find(map, clst);
+			assert(clst != FMAP_NONE);
+			fmap_clear(map, clst);
+			lifo[nclsts - found - 1] = clst;
+		}
+
+		for (unsigned c = 0; c < nclsts; c++) {
+			rc = fat_set_cluster(bs, service_id, FAT1, lifo[c],
+			    c == 0 ? clst_last1 : lifo[c - 1]);
+			if (rc != EOK)
+				break;
+		}
+
+		if (rc == EOK) {
+			rc = fat_alloc_shadow_clusters(bs, service_id, lifo,
+			    nclsts);
+		}
+
+		if (rc == EOK) {
+			*mcl = lifo[nclsts - 1];
+			*lcl = lifo[0];
+			free(lifo);
+			fibril_mutex_unlock(&fat_alloc_lock);
+			return EOK;
+		}
+
+		/* Free the clusters again. */
+		while (found--) {
+			(void) fat_set_cluster(bs, service_id, FAT1,
+			    lifo[found], FAT_CLST_RES0);
+			fmap_set(map, lifo[found]);
+		}
+
+		goto nospace;
+	}
+
 	/*
 	 * Search FAT1 for unused clusters.
 	 */
-	fibril_mutex_lock(&fat_alloc_lock);
 	for (clst = FAT_CLST_FIRST; clst < CC(bs) + 2 && found < nclsts;
 	    clst++) {
 		rc = fat_get_cluster(bs, service_id, FAT1, clst, &value);
@@ -728,6 +1147,7 @@ fat_alloc_clusters(fat_bs_t *bs, service_id_t service_id, unsigned nclsts,
 		    FAT_CLST_RES0);
 	}
 
+nospace:
 	free(lifo);
 	fibril_mutex_unlock(&fat_alloc_lock);
 
@@ -748,6 +1168,7 @@ fat_free_clusters(fat_bs_t *bs, service_id_t service_id, fat_cluster_t firstc)
 	unsigned fatno;
 	fat_cluster_t nextc = 0;
 	fat_cluster_t clst_bad = FAT_CLST_BAD(bs);
+	fat_free_map_t *map = fat_free_map_get(service_id);
 	errno_t rc;
 
 	/* Mark all clusters in the chain as free in all copies of FAT. */
@@ -765,6 +1186,12 @@ fat_free_clusters(fat_bs_t *bs, service_id_t service_id, fat_cluster_t firstc)
 				return rc;
 		}
 
+		if (map != NULL) {
+			fibril_mutex_lock(&fat_alloc_lock);
+			fmap_set(map, firstc);
+			fibril_mutex_unlock(&fat_alloc_lock);
+		}
+
 		firstc = nextc;
 	}
 
@@ -837,8 +1264,7 @@ errno_t fat_chop_clusters(fat_bs_t *bs, fat_node_t *nodep, fat_cluster_t lcl)
 	 * Invalidate cached cluster numbers.
 	 */
 	nodep->lastc_cached_valid = false;
-	if (nodep->currc_cached_value != lcl)
-		nodep->currc_cached_valid = false;
+	fat_runs_clear(nodep);
 
 	if (lcl == FAT_CLST_RES0) {
 		/* The node will have zero size and no clusters allocated. */
@@ -35,6 +35,7 @@
 #define FAT_FAT_FAT_H_
 
 #include "../../vfs/vfs.h"
+#include <stdbool.h>
 #include <stdint.h>
 #include <block.h>
 
@@ -102,6 +103,7 @@
 struct block;
 struct fat_node;
 struct fat_bs;
+struct fat_free_map;
 
 typedef uint32_t fat_cluster_t;
 
@@ -110,6 +112,10 @@ typedef uint32_t fat_cluster_t;
 extern errno_t fat_cluster_walk(struct fat_bs *, service_id_t, fat_cluster_t,
     fat_cluster_t *, uint32_t *, uint32_t);
 
+extern errno_t fat_node_cluster_get(struct fat_bs *, struct fat_node *,
+    uint32_t, fat_cluster_t *);
+extern void fat_runs_clear(struct fat_node *);
+
 extern errno_t fat_block_get(block_t **, struct fat_bs *, struct fat_node *,
     aoff64_t, int);
 extern errno_t _fat_block_get(block_t **, struct fat_bs *, service_id_t,
@@ -119,6 +125,10 @@ extern errno_t fat_append_clusters(struct fat_bs *, struct fat_node *,
     fat_cluster_t, fat_cluster_t);
 extern errno_t fat_chop_clusters(struct fat_bs *, struct fat_node *,
     fat_cluster_t);
+extern errno_t fat_free_map_create(struct fat_bs *, service_id_t,
+    struct fat_free_map **);
+extern void fat_free_map_destroy(struct fat_free_map *);
+extern bool fat_free_map_count(service_id_t, uint64_t *);
 extern errno_t fat_alloc_clusters(struct fat_bs *, service_id_t, unsigned,
     fat_cluster_t *, fat_cluster_t *);
 extern errno_t fat_free_clusters(struct fat_bs *, service_id_t, fat_cluster_t);
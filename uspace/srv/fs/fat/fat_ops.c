@@ -109,9 +109,11 @@ static void fat_node_initialize(fat_node_t *node)
 	node->dirty = false;
 	node->lastc_cached_valid = false;
 	node->lastc_cached_value = 0;
-	node->currc_cached_valid = false;
-	node->currc_cached_bn = 0;
-	node->currc_cached_value = 0;
+	node->runs = NULL;
+	node->runs_count = 0;
+	node->runs_size = 0;
+	node->runs_clusters = 0;
+	node->dindex = NULL;
 }
 
 static errno_t fat_node_sync(fat_node_t *node)
@@ -193,6 +195,8 @@ restart:
 				return rc;
 		}
 		nodep->idx->nodep = NULL;
+		fat_runs_clear(nodep);
+		fat_directory_index_drop(nodep);
 		free(nodep->bp);
 		free(nodep);
 
@@ -231,12 +235,16 @@ static errno_t fat_node_get_new(fat_node_t **nodepp)
 				idxp_tmp->nodep = NULL;
 				fibril_mutex_unlock(&nodep->lock);
 				fibril_mutex_unlock(&idxp_tmp->lock);
+				fat_runs_clear(nodep);
+				fat_directory_index_drop(nodep);
 				free(nodep->bp);
 				free(nodep);
 				return rc;
 			}
 		}
 		idxp_tmp->nodep = NULL;
+		fat_runs_clear(nodep);
+		fat_directory_index_drop(nodep);
 		fibril_mutex_unlock(&nodep->lock);
 		fibril_mutex_unlock(&idxp_tmp->lock);
 		fn = FS_NODE(nodep);
@@ -376,12 +384,39 @@ errno_t fat_match(fs_node_t **rfn, fs_node_t *pfn, const char *component)
 	char name[FAT_LFN_NAME_SIZE];
 	fat_dentry_t *d;
 	service_id_t service_id;
+	fat_node_t *nodep;
+	fat_idx_t *idx;
+	aoff64_t pos;
 	errno_t rc;
 
 	fibril_mutex_lock(&parentp->idx->lock);
 	service_id = parentp->idx->service_id;
 	fibril_mutex_unlock(&parentp->idx->lock);
 
+	/*
+	 * Try the directory name index first so that we do not have to
+	 * decode all the long name sequences on every lookup.
+	 */
+	fibril_mutex_lock(&parentp->lock);
+	rc = fat_directory_index_lookup(parentp, component, &pos);
+	fibril_mutex_unlock(&parentp->lock);
+	if (rc == ENOENT) {
+		*rfn = NULL;
+		return EOK;
+	}
+	if (rc == EOK) {
+		idx = fat_idx_get_by_pos(service_id, parentp->firstc, pos);
+		if (!idx)
+			return ENOMEM;
+		rc = fat_node_get_core(&nodep, idx);
+		fibril_mutex_unlock(&idx->lock);
+		if (rc != EOK)
+			return rc;
+		*rfn = FS_NODE(nodep);
+		return EOK;
+	}
+
+	/* The index could not be built, scan the directory instead. */
 	fat_directory_t di;
 	rc = fat_directory_open(parentp, &di);
 	if (rc != EOK)
@@ -390,10 +425,9 @@ errno_t fat_match(fs_node_t **rfn, fs_node_t *pfn, const char *component)
 	while (fat_directory_read(&di, name, &d) == EOK) {
 		if (fat_dentry_namecmp(name, component) == 0) {
 			/* hit */
-			fat_node_t *nodep;
 			aoff64_t o = di.pos %
 			    (BPS(di.bs) / sizeof(fat_dentry_t));
-			fat_idx_t *idx = fat_idx_get_by_pos(service_id,
+			idx = fat_idx_get_by_pos(service_id,
 			    parentp->firstc, di.bnum * DPS(di.bs) + o);
 			if (!idx) {
 				/*
@@ -477,6 +511,8 @@ errno_t fat_node_put(fs_node_t *fn)
 	}
 	fibril_mutex_unlock(&nodep->lock);
 	if (destroy) {
+		fat_runs_clear(nodep);
+		fat_directory_index_drop(nodep);
 		free(nodep->bp);
 		free(nodep);
 	}
@@ -570,6 +606,8 @@ errno_t fat_destroy_node(fs_node_t *fn)
 	}
 
 	fat_idx_destroy(nodep->idx);
+	fat_runs_clear(nodep);
+	fat_directory_index_drop(nodep);
 	free(nodep->bp);
 	free(nodep);
 	return rc;
@@ -630,6 +668,10 @@ errno_t fat_link(fs_node_t *pfn, fs_node_t *cfn, const char *name)
 
 	fibril_mutex_unlock(&parentp->idx->lock);
 
+	fibril_mutex_lock(&parentp->lock);
+	fat_directory_index_insert(parentp, name, di.pos);
+	fibril_mutex_unlock(&parentp->lock);
+
 	fibril_mutex_lock(&childp->idx->lock);
 
 	if (childp->type == FAT_DIRECTORY) {
@@ -731,6 +773,8 @@ errno_t fat_unlink(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 	if (rc != EOK)
 		goto error;
 
+	fat_directory_index_remove(parentp, nm, childp->idx->pdi);
+
 	/* remove the index structure from the position hash */
 	fat_idx_hashout(childp->idx);
 	/* clear position information */
@@ -870,6 +914,9 @@ errno_t fat_free_block_count(service_id_t service_id, uint64_t *count)
 	errno_t rc;
 	uint32_t cluster_no, clusters;
 
+	if (fat_free_map_count(service_id, count))
+		return EOK;
+
 	block_count = 0;
 	bs = block_bb_get(service_id);
 	clusters = (SPC(bs)) ? TS(bs) / SPC(bs) : 0;
@@ -1025,6 +1072,8 @@ static errno_t fat_fs_open(service_id_t service_id, enum cache_mode cmode,
 
 static void fat_fs_close(service_id_t service_id, fs_node_t *rfn)
 {
+	fat_runs_clear(FAT_NODE(rfn));
+	fat_directory_index_drop(FAT_NODE(rfn));
 	free(rfn->data);
 	free(rfn);
 	(void) block_cache_fini(service_id);
@@ -1106,12 +1155,21 @@ fat_mounted(service_id_t service_id, const char *opts, fs_index_t *index,
 		return rc;
 	}
 
+	/*
+	 * Build the map of free clusters. If that fails, cluster allocation
+	 * falls back to scanning the FAT.
+	 */
+	if (fat_free_map_create(block_bb_get(service_id), service_id,
+	    &instance->free_map) != EOK)
+		instance->free_map = NULL;
+
 	fibril_mutex_lock(&ridxp->lock);
 
 	rc = fs_instance_create(service_id, instance);
 	if (rc != EOK) {
 		fibril_mutex_unlock(&ridxp->lock);
 		fat_fs_close(service_id, rfn);
+		fat_free_map_destroy(instance->free_map);
 		free(instance);
 		return rc;
 	}
@@ -1201,6 +1259,7 @@ static errno_t fat_unmounted(service_id_t service_id)
 	void *data;
 	if (fs_instance_get(service_id, &data) == EOK) {
 		fs_instance_destroy(service_id);
+		fat_free_map_destroy(((fat_instance_t *) data)->free_map);
 		free(data);
 	}
 
@@ -1317,6 +1376,94 @@ fat_read(service_id_t service_id, fs_index_t index, aoff64_t pos,
 	return rc;
 }
 
+static errno_t
+fat_readdir(service_id_t service_id, fs_index_t index, aoff64_t pos,
+    void *buf, size_t size, size_t *used, aoff64_t *npos)
+{
+	char name[FAT_LFN_NAME_SIZE];
+	fat_directory_t di;
+	fat_node_t *nodep;
+	fat_dentry_t *d;
+	fs_node_t *fn;
+	errno_t rc;
+
+	rc = fat_node_get(&fn, service_id, index);
+	if (rc != EOK)
+		return rc;
+	if (!fn)
+		return ENOENT;
+	nodep = FAT_NODE(fn);
+
+	if (nodep->type != FAT_DIRECTORY) {
+		(void) fat_node_put(fn);
+		return ENOTDIR;
+	}
+
+	*used = 0;
+	*npos = pos;
+
+	rc = fat_directory_open(nodep, &di);
+	if (rc != EOK) {
+		(void) fat_node_put(fn);
+		return rc;
+	}
+
+	rc = fat_directory_seek(&di, pos);
+	if (rc == ENOENT) {
+		/* Seeking past the last dentry means end of directory. */
+		rc = EOK;
+		goto out;
+	}
+	if (rc != EOK)
+		goto out;
+
+	while (true) {
+		rc = fat_directory_read(&di, name, &d);
+		if (rc == ENOENT) {
+			rc = EOK;
+			break;
+		}
+		if (rc != EOK)
+			break;
+
+		/*
+		 * The node index is not known without instantiating the
+		 * index structure, so leave it for the client to look up.
+		 */
+		bool packed;
+		if ((d->attr & FAT_ATTR_SUBDIR) != 0) {
+			packed = fs_dirent_pack(buf, size, used, name, 0,
+			    VFS_DIRENT_DIRECTORY, 0, 0);
+		} else {
+			packed = fs_dirent_pack(buf, size, used, name, 0,
+			    VFS_DIRENT_FILE, VFS_DIRENT_HAS_SIZE,
+			    uint32_t_le2host(d->size));
+		}
+
+		if (!packed) {
+			/* Buffer too small to hold even a single entry */
+			if (*used == 0)
+				rc = EOVERFLOW;
+			break;
+		}
+
+		*npos = di.pos + 1;
+		if (fat_directory_next(&di) != EOK)
+			break;
+	}
+
+out:
+	if (rc == EOK)
+		rc = fat_directory_close(&di);
+	else
+		(void) fat_directory_close(&di);
+	if (rc == EOK)
+		rc = fat_node_put(fn);
+	else
+		(void) fat_node_put(fn);
+	return rc;
+}
+
 static errno_t
 fat_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
     size_t *wbytes, aoff64_t *nsize)
@@ -1496,8 +1643,8 @@ fat_truncate(service_id_t service_id, fs_index_t index, aoff64_t size)
 				goto out;
 		} else {
 			fat_cluster_t lastc;
-			rc = fat_cluster_walk(bs, service_id, nodep->firstc,
-			    &lastc, NULL, (size - 1) / BPC(bs));
+			rc = fat_node_cluster_get(bs, nodep,
+			    (size - 1) / BPC(bs), &lastc);
 			if (rc != EOK)
 				goto out;
 			rc = fat_chop_clusters(bs, nodep, lastc);
@@ -1569,6 +1716,7 @@ vfs_out_ops_t fat_ops = {
 	.close = fat_close,
 	.destroy = fat_destroy,
 	.sync = fat_sync,
+	.readdir = fat_readdir,
 };
 
 /**
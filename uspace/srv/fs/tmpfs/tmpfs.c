@@ -58,6 +58,8 @@ vfs_info_t tmpfs_vfs_info = {
 	.name = NAME,
 	.concurrent_read_write = false,
 	.write_retains_size = false,
+	.cache_lookups = true,
+	.cache_pages = true,
 	.instance = 0,
 };
 
@@ -36,8 +36,12 @@
 #include <libfs.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <adt/hash_table.h>
 
+/** Size of a chunk of file data. */
+#define TMPFS_PAGE_SIZE		4096
+
 #define TMPFS_NODE(node)	((node) ? (tmpfs_node_t *)(node)->data : NULL)
 #define FS_NODE(node)		((node) ? (node)->bp : NULL)
 
@@ -52,10 +56,18 @@ struct tmpfs_node;
 
 typedef struct tmpfs_dentry {
 	link_t link;		/**< Linkage for the list of siblings. */
+	ht_link_t dh_link;	/**< Dentries hash table link. */
+	struct tmpfs_node *parent;/**< Directory containing the dentry. */
 	struct tmpfs_node *node;/**< Back pointer to TMPFS node. */
 	char *name;		/**< Name of dentry. */
 } tmpfs_dentry_t;
 
+/** Sparse file contents stored in pages indexed by a radix tree. */
+typedef struct {
+	unsigned height;	/**< Number of interior levels. */
+	void *root;		/**< Root of the tree or the only page. */
+} tmpfs_pages_t;
+
 typedef struct tmpfs_node {
 	fs_node_t *bp;		/**< Back pointer to the FS node. */
 	fs_index_t index;	/**< TMPFS node index. */
@@ -63,16 +75,27 @@ typedef struct tmpfs_node {
 	ht_link_t nh_link;		/**< Nodes hash table link. */
 	tmpfs_dentry_type_t type;
 	unsigned lnkcnt;	/**< Link count. */
-	size_t size;		/**< File size if type is TMPFS_FILE. */
-	void *data;		/**< File content's if type is TMPFS_FILE. */
+	aoff64_t size;		/**< File size if type is TMPFS_FILE. */
+	tmpfs_pages_t pages;	/**< File content's if type is TMPFS_FILE. */
 	list_t cs_list;		/**< Child's siblings list. */
 } tmpfs_node_t;
 
 extern vfs_out_ops_t tmpfs_ops;
 extern libfs_ops_t tmpfs_libfs_ops;
 
+extern const uint8_t tmpfs_zero_page[TMPFS_PAGE_SIZE];
+
 extern bool tmpfs_init(void);
 
+extern void tmpfs_pages_init(tmpfs_pages_t *);
+extern void tmpfs_pages_fini(tmpfs_pages_t *);
+extern void *tmpfs_pages_lookup(tmpfs_pages_t *, uint64_t);
+extern errno_t tmpfs_pages_get(tmpfs_pages_t *, uint64_t, void **);
+extern void tmpfs_pages_truncate(tmpfs_pages_t *, uint64_t);
+extern void tmpfs_pages_read(tmpfs_pages_t *, aoff64_t, void *, size_t);
+extern errno_t tmpfs_pages_write(tmpfs_pages_t *, aoff64_t, const void *,
+    size_t, size_t *);
+
 #endif
 
 /**
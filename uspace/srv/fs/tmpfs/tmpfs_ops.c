@@ -136,6 +136,9 @@ libfs_ops_t tmpfs_libfs_ops = {
 /** Hash table of all TMPFS nodes. */
 hash_table_t nodes;
 
+/** Hash table of all TMPFS dentries keyed by parent node and name. */
+static hash_table_t dentries;
+
 /*
  * Implementation of hash table interface for the nodes hash table.
  */
@@ -175,14 +178,13 @@ static void nodes_remove_callback(ht_link_t *item)
 		    list_first(&nodep->cs_list), tmpfs_dentry_t, link);
 
 		assert(nodep->type == TMPFS_DIRECTORY);
+		hash_table_remove_item(&dentries, &dentryp->dh_link);
 		list_remove(&dentryp->link);
+		free(dentryp->name);
 		free(dentryp);
 	}
 
-	if (nodep->data) {
-		assert(nodep->type == TMPFS_FILE);
-		free(nodep->data);
-	}
+	tmpfs_pages_fini(&nodep->pages);
 	free(nodep->bp);
 	free(nodep);
 }
@@ -196,6 +198,65 @@ const hash_table_ops_t nodes_ops = {
 	.remove_callback = nodes_remove_callback
 };
 
+/*
+ * Implementation of hash table interface for the dentries hash table.
+ */
+
+typedef struct {
+	tmpfs_node_t *parent;
+	const char *name;
+} dentry_key_t;
+
+static size_t dentries_key_hash(const void *k)
+{
+	const dentry_key_t *key = k;
+	return hash_combine((uintptr_t) key->parent, hash_string(key->name));
+}
+
+static size_t dentries_hash(const ht_link_t *item)
+{
+	tmpfs_dentry_t *dentryp = hash_table_get_inst(item, tmpfs_dentry_t,
+	    dh_link);
+	return hash_combine((uintptr_t) dentryp->parent,
+	    hash_string(dentryp->name));
+}
+
+static bool dentries_key_equal(const void *key_arg, size_t hash,
+    const ht_link_t *item)
+{
+	tmpfs_dentry_t *dentryp = hash_table_get_inst(item, tmpfs_dentry_t,
+	    dh_link);
+	const dentry_key_t *key = key_arg;
+
+	return key->parent == dentryp->parent &&
+	    str_cmp(key->name, dentryp->name) == 0;
+}
+
+/** TMPFS dentries hash table operations. */
+static const hash_table_ops_t dentries_ops = {
+	.hash = dentries_hash,
+	.key_hash = dentries_key_hash,
+	.key_equal = dentries_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+/** Find dentry by parent directory and name. */
+static tmpfs_dentry_t *tmpfs_dentry_find(tmpfs_node_t *parentp,
+    const char *name)
+{
+	dentry_key_t key = {
+		.parent = parentp,
+		.name = name
+	};
+
+	ht_link_t *lnk = hash_table_find(&dentries, &key);
+	if (lnk == NULL)
+		return NULL;
+
+	return hash_table_get_inst(lnk, tmpfs_dentry_t, dh_link);
+}
+
 static void tmpfs_node_initialize(tmpfs_node_t *nodep)
 {
 	nodep->bp = NULL;
@@ -204,13 +265,14 @@ static void tmpfs_node_initialize(tmpfs_node_t *nodep)
 	nodep->type = TMPFS_NONE;
 	nodep->lnkcnt = 0;
 	nodep->size = 0;
-	nodep->data = NULL;
+	tmpfs_pages_init(&nodep->pages);
 	list_initialize(&nodep->cs_list);
 }
 
 static void tmpfs_dentry_initialize(tmpfs_dentry_t *dentryp)
 {
 	link_initialize(&dentryp->link);
+	dentryp->parent = NULL;
 	dentryp->name = NULL;
 	dentryp->node = NULL;
 }
@@ -220,6 +282,11 @@ bool tmpfs_init(void)
 	if (!hash_table_create(&nodes, 0, 0, &nodes_ops))
 		return false;
 
+	if (!hash_table_create(&dentries, 0, 0, &dentries_ops)) {
+		hash_table_destroy(&nodes);
+		return false;
+	}
+
 	return true;
 }
 
@@ -253,13 +320,12 @@ static void tmpfs_instance_done(service_id_t service_id)
 
 errno_t tmpfs_match(fs_node_t **rfn, fs_node_t *pfn, const char *component)
 {
-	tmpfs_node_t *parentp = TMPFS_NODE(pfn);
+	tmpfs_dentry_t *dentryp;
 
-	list_foreach(parentp->cs_list, link, tmpfs_dentry_t, dentryp) {
-		if (!str_cmp(dentryp->name, component)) {
-			*rfn = FS_NODE(dentryp->node);
-			return EOK;
-		}
+	dentryp = tmpfs_dentry_find(TMPFS_NODE(pfn), component);
+	if (dentryp != NULL) {
+		*rfn = FS_NODE(dentryp->node);
+		return EOK;
 	}
 
 	*rfn = NULL;
@@ -362,10 +428,8 @@ errno_t tmpfs_link_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 	assert(parentp->type == TMPFS_DIRECTORY);
 
 	/* Check for duplicit entries. */
-	list_foreach(parentp->cs_list, link, tmpfs_dentry_t, dp) {
-		if (!str_cmp(dp->name, nm))
-			return EEXIST;
-	}
+	if (tmpfs_dentry_find(parentp, nm) != NULL)
+		return EEXIST;
 
 	/* Allocate and initialize the dentry. */
 	dentryp = malloc(sizeof(tmpfs_dentry_t));
@@ -381,9 +445,11 @@ errno_t tmpfs_link_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 		return ENOMEM;
 	}
 	str_cpy(dentryp->name, size + 1, nm);
+	dentryp->parent = parentp;
 	dentryp->node = childp;
 	childp->lnkcnt++;
 	list_append(&dentryp->link, &parentp->cs_list);
+	hash_table_insert(&dentries, &dentryp->dh_link);
 
 	return EOK;
 }
@@ -391,28 +457,25 @@ errno_t tmpfs_link_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 errno_t tmpfs_unlink_node(fs_node_t *pfn, fs_node_t *cfn, const char *nm)
 {
 	tmpfs_node_t *parentp = TMPFS_NODE(pfn);
-	tmpfs_node_t *childp = NULL;
+	tmpfs_node_t *childp;
 	tmpfs_dentry_t *dentryp;
 
 	if (!parentp)
 		return EBUSY;
 
-	list_foreach(parentp->cs_list, link, tmpfs_dentry_t, dp) {
-		if (!str_cmp(dp->name, nm)) {
-			dentryp = dp;
-			childp = dentryp->node;
-			assert(FS_NODE(childp) == cfn);
-			break;
-		}
-	}
-
-	if (!childp)
+	dentryp = tmpfs_dentry_find(parentp, nm);
+	if (dentryp == NULL)
 		return ENOENT;
 
+	childp = dentryp->node;
+	assert(FS_NODE(childp) == cfn);
+
 	if ((childp->lnkcnt == 1) && !list_empty(&childp->cs_list))
 		return ENOTEMPTY;
 
+	hash_table_remove_item(&dentries, &dentryp->dh_link);
 	list_remove(&dentryp->link);
+	free(dentryp->name);
 	free(dentryp);
 	childp->lnkcnt--;
 
@@ -491,9 +554,43 @@ static errno_t tmpfs_read(service_id_t service_id, fs_index_t index, aoff64_t po
 
 	size_t bytes;
 	if (nodep->type == TMPFS_FILE) {
-		bytes = min(nodep->size - pos, size);
-		(void) async_data_read_finalize(&call, nodep->data + pos,
-		    bytes);
+		if (pos >= nodep->size)
+			bytes = 0;
+		else
+			bytes = min(nodep->size - pos, size);
+
+		/*
+		 * The data is always copied to the client. The VFS read
+		 * protocol forwards the client's data read request here, so
+		 * there is no way to share the pages themselves, even if the
+		 * read is page aligned.
+		 */
+		size_t off = pos % TMPFS_PAGE_SIZE;
+		void *buf = NULL;
+
+		if (off + bytes > TMPFS_PAGE_SIZE) {
+			/* The read spans several pages, use a bounce buffer. */
+			buf = malloc(bytes);
+			if (buf == NULL) {
+				/* Fall back to a short read. */
+				bytes = TMPFS_PAGE_SIZE - off;
+			}
+		}
+
+		if (buf != NULL) {
+			tmpfs_pages_read(&nodep->pages, pos, buf, bytes);
+			(void) async_data_read_finalize(&call, buf, bytes);
+			free(buf);
+		} else {
+			/* Serve the data straight from the page. */
+			const uint8_t *page = tmpfs_pages_lookup(&nodep->pages,
+			    pos / TMPFS_PAGE_SIZE);
+			if (page == NULL)
+				page = tmpfs_zero_page;
+
+			(void) async_data_read_finalize(&call, page + off,
+			    bytes);
+		}
 	} else {
 		tmpfs_dentry_t *dentryp;
 		link_t *lnk;
@@ -523,6 +620,53 @@ static errno_t tmpfs_read(service_id_t service_id, fs_index_t index, aoff64_t po
 	return EOK;
 }
 
+static errno_t
+tmpfs_readdir(service_id_t service_id, fs_index_t index, aoff64_t pos,
+    void *buf, size_t size, size_t *used, aoff64_t *npos)
+{
+	/*
+	 * Lookup the respective TMPFS node.
+	 */
+	node_key_t key = {
+		.service_id = service_id,
+		.index = index
+	};
+
+	ht_link_t *hlp = hash_table_find(&nodes, &key);
+	if (!hlp)
+		return ENOENT;
+
+	tmpfs_node_t *nodep = hash_table_get_inst(hlp, tmpfs_node_t, nh_link);
+	if (nodep->type != TMPFS_DIRECTORY)
+		return ENOTDIR;
+
+	/* Locate the first entry once, then walk the list sequentially. */
+	link_t *lnk = list_nth(&nodep->cs_list, pos);
+
+	*used = 0;
+	while (lnk != NULL) {
+		tmpfs_dentry_t *dentryp = list_get_instance(lnk,
+		    tmpfs_dentry_t, link);
+		tmpfs_node_t *childp = dentryp->node;
+
+		if (!fs_dirent_pack(buf, size, used, dentryp->name,
+		    childp->index, childp->type == TMPFS_DIRECTORY ?
+		    VFS_DIRENT_DIRECTORY : VFS_DIRENT_FILE,
+		    VFS_DIRENT_HAS_SIZE, childp->size))
+			break;
+
+		pos++;
+		lnk = list_next(lnk, &nodep->cs_list);
+	}
+
+	/* Buffer too small to hold even a single entry */
+	if (lnk != NULL && *used == 0)
+		return EOVERFLOW;
+
+	*npos = pos;
+	return EOK;
+}
+
 static errno_t
 tmpfs_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
     size_t *wbytes, aoff64_t *nsize)
@@ -552,34 +696,44 @@ tmpfs_write(service_id_t service_id, fs_index_t index, aoff64_t pos,
 		return EINVAL;
 	}
 
-	/*
-	 * Check whether the file needs to grow.
-	 */
-	if (pos + size <= nodep->size) {
-		/* The file size is not changing. */
-		(void) async_data_write_finalize(&call, nodep->data + pos,
-		    size);
-		goto out;
-	}
-	size_t delta = (pos + size) - nodep->size;
-	/*
-	 * At this point, we are deliberately extremely straightforward and
-	 * simply realloc the contents of the file on every write that grows the
-	 * file. In the end, the situation might not be as bad as it may look:
-	 * our heap allocator can save us and just grow the block whenever
-	 * possible.
-	 */
-	void *newdata = realloc(nodep->data, nodep->size + delta);
-	if (!newdata) {
-		async_answer_0(&call, ENOMEM);
-		size = 0;
-		goto out;
+	size_t off = pos % TMPFS_PAGE_SIZE;
+	errno_t rc;
+
+	if (off + size <= TMPFS_PAGE_SIZE) {
+		/* Receive the data straight into the page. */
+		uint8_t *page;
+		rc = tmpfs_pages_get(&nodep->pages, pos / TMPFS_PAGE_SIZE,
+		    (void **) &page);
+		if (rc != EOK) {
+			async_answer_0(&call, rc);
+			size = 0;
+			goto out;
+		}
+
+		(void) async_data_write_finalize(&call, page + off, size);
+	} else {
+		/* The write spans several pages, use a bounce buffer. */
+		void *buf = malloc(size);
+		if (buf == NULL) {
+			async_answer_0(&call, ENOMEM);
+			size = 0;
+			goto out;
+		}
+
+		rc = async_data_write_finalize(&call, buf, size);
+		if (rc != EOK) {
+			free(buf);
+			size = 0;
+			goto out;
+		}
+
+		/* On failure keep what has been written. */
+		(void) tmpfs_pages_write(&nodep->pages, pos, buf, size, &size);
+		free(buf);
 	}
-	/* Clear any newly allocated memory in order to emulate gaps. */
-	memset(newdata + nodep->size, 0, delta);
-	nodep->size += delta;
-	nodep->data = newdata;
-	(void) async_data_write_finalize(&call, nodep->data + pos, size);
+
+	if (pos + size > nodep->size)
+		nodep->size = pos + size;
 
 out:
 	*wbytes = size;
@@ -606,20 +760,23 @@ static errno_t tmpfs_truncate(service_id_t service_id, fs_index_t index,
 	if (size == nodep->size)
 		return EOK;
 
-	if (size > SIZE_MAX)
-		return ENOMEM;
-
-	void *newdata = realloc(nodep->data, size);
-	if (!newdata && size)
-		return ENOMEM;
+	if (size < nodep->size) {
+		tmpfs_pages_truncate(&nodep->pages,
+		    (size + TMPFS_PAGE_SIZE - 1) / TMPFS_PAGE_SIZE);
 
-	if (size > nodep->size) {
-		size_t delta = size - nodep->size;
-		memset(newdata + nodep->size, 0, delta);
+		/*
+		 * Clear the tail of the last page so that the file reads
+		 * as zeros if it is extended again. Extending the file
+		 * just leaves a hole.
+		 */
+		size_t off = size % TMPFS_PAGE_SIZE;
+		uint8_t *page = tmpfs_pages_lookup(&nodep->pages,
+		    size / TMPFS_PAGE_SIZE);
+		if (off != 0 && page != NULL)
+			memset(page + off, 0, TMPFS_PAGE_SIZE - off);
 	}
 
 	nodep->size = size;
-	nodep->data = newdata;
 	return EOK;
 }
 
@@ -662,6 +819,7 @@ vfs_out_ops_t tmpfs_ops = {
 	.close = tmpfs_close,
 	.destroy = tmpfs_destroy,
 	.sync = tmpfs_sync,
+	.readdir = tmpfs_readdir,
 };
 
 /**
@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup tmpfs
+ * @{
+ */
+
+/**
+ * @file	tmpfs_pages.c
+ * @brief	Sparse page-based storage of TMPFS file contents.
+ *
+ * File contents are kept in page-sized chunks indexed by a radix tree.
+ * Pages which have never been written are not allocated and read as zeros.
+ */
+
+#include "tmpfs.h"
+#include <errno.h>
+#include <macros.h>
+#include <mem.h>
+#include <stdlib.h>
+
+#define TMPFS_RADIX_BITS	6
+#define TMPFS_RADIX_FANOUT	(1 << TMPFS_RADIX_BITS)
+#define TMPFS_RADIX_MASK	(TMPFS_RADIX_FANOUT - 1)
+
+/** Page full of zeros used to serve reads from holes. */
+const uint8_t tmpfs_zero_page[TMPFS_PAGE_SIZE];
+
+/** Determine whether a tree of given height can hold a page index. */
+static bool tmpfs_pages_fits(unsigned height, uint64_t idx)
+{
+	if (height * TMPFS_RADIX_BITS >= 64)
+		return true;
+
+	return (idx >> (height * TMPFS_RADIX_BITS)) == 0;
+}
+
+/** Number of pages covered by a subtree of given height. */
+static uint64_t tmpfs_pages_span(unsigned height)
+{
+	return (uint64_t) 1 << (height * TMPFS_RADIX_BITS);
+}
+
+/** Free a subtree including all pages in it. */
+static void tmpfs_pages_free(void *node, unsigned height)
+{
+	if (node == NULL)
+		return;
+
+	if (height > 0) {
+		void **slot = node;
+		for (unsigned i = 0; i < TMPFS_RADIX_FANOUT; i++)
+			tmpfs_pages_free(slot[i], height - 1);
+	}
+
+	free(node);
+}
+
+/** Initialize empty page tree.
+ *
+ * @param pages Page tree
+ */
+void tmpfs_pages_init(tmpfs_pages_t *pages)
+{
+	pages->height = 0;
+	pages->root = NULL;
+}
+
+/** Free all pages of a page tree.
+ *
+ * @param pages Page tree
+ */
+void tmpfs_pages_fini(tmpfs_pages_t *pages)
+{
+	tmpfs_pages_free(pages->root, pages->height);
+	tmpfs_pages_init(pages);
+}
+
+/** Find page.
+ *
+ * @param pages Page tree
+ * @param idx   Page index
+ *
+ * @return Page or @c NULL if the page lies in a hole
+ */
+void *tmpfs_pages_lookup(tmpfs_pages_t *pages, uint64_t idx)
+{
+	if (!tmpfs_pages_fits(pages->height, idx))
+		return NULL;
+
+	void *node = pages->root;
+	for (unsigned h = pages->height; h > 0 && node != NULL; h--) {
+		void **slot = node;
+		node = slot[(idx >> ((h - 1) * TMPFS_RADIX_BITS)) &
+		    TMPFS_RADIX_MASK];
+	}
+
+	return node;
+}
+
+/** Find page, allocating it if it does not exist.
+ *
+ * Newly allocated pages are zero-filled.
+ *
+ * @param pages Page tree
+ * @param idx   Page index
+ * @param rpage Place to store pointer to the page
+ *
+ * @return EOK on success or ENOMEM
+ */
+errno_t tmpfs_pages_get(tmpfs_pages_t *pages, uint64_t idx, void **rpage)
+{
+	/* Grow the tree until it can hold the index. */
+	while (!tmpfs_pages_fits(pages->height, idx)) {
+		if (pages->root != NULL) {
+			void **node = calloc(TMPFS_RADIX_FANOUT, sizeof(void *));
+			if (node == NULL)
+				return ENOMEM;
+
+			node[0] = pages->root;
+			pages->root = node;
+		}
+
+		pages->height++;
+	}
+
+	void **slotp = &pages->root;
+	for (unsigned h = pages->height; h > 0; h--) {
+		if (*slotp == NULL) {
+			*slotp = calloc(TMPFS_RADIX_FANOUT, sizeof(void *));
+			if (*slotp == NULL)
+				return ENOMEM;
+		}
+
+		void **slot = *slotp;
+		slotp = &slot[(idx >> ((h - 1) * TMPFS_RADIX_BITS)) &
+		    TMPFS_RADIX_MASK];
+	}
+
+	if (*slotp == NULL) {
+		*slotp = calloc(1, TMPFS_PAGE_SIZE);
+		if (*slotp == NULL)
+			return ENOMEM;
+	}
+
+	*rpage = *slotp;
+	return EOK;
+}
+
+/** Free pages at and above an index in a subtree.
+ *
+ * @return The subtree or @c NULL if it became empty and was freed
+ */
+static void *tmpfs_pages_trim(void *node, unsigned height, uint64_t base,
+    uint64_t npages)
+{
+	if (node == NULL)
+		return NULL;
+
+	if (base >= npages) {
+		tmpfs_pages_free(node, height);
+		return NULL;
+	}
+
+	if (height == 0)
+		return node;
+
+	void **slot = node;
+	uint64_t span = tmpfs_pages_span(height - 1);
+	bool empty = true;
+
+	for (unsigned i = 0; i < TMPFS_RADIX_FANOUT; i++) {
+		slot[i] = tmpfs_pages_trim(slot[i], height - 1,
+		    base + i * span, npages);
+		if (slot[i] != NULL)
+			empty = false;
+	}
+
+	if (empty) {
+		free(node);
+		return NULL;
+	}
+
+	return node;
+}
+
+/** Free all pages with index greater or equal to @a npages.
+ *
+ * @param pages  Page tree
+ * @param npages Number of pages to keep
+ */
+void tmpfs_pages_truncate(tmpfs_pages_t *pages, uint64_t npages)
+{
+	pages->root = tmpfs_pages_trim(pages->root, pages->height, 0, npages);
+
+	/* Shrink the tree while only the first slot of the root is used. */
+	while (pages->height > 0 && pages->root != NULL) {
+		void **slot = pages->root;
+		for (unsigned i = 1; i < TMPFS_RADIX_FANOUT; i++) {
+			if (slot[i] != NULL)
+				return;
+		}
+
+		pages->root = slot[0];
+		pages->height--;
+		free(slot);
+	}
+
+	if (pages->root == NULL)
+		pages->height = 0;
+}
+
+/** Copy data out of a page tree.
+ *
+ * Holes are read as zeros.
+ *
+ * @param pages Page tree
+ * @param pos   Starting byte position
+ * @param buf   Destination buffer
+ * @param size  Number of bytes to copy
+ */
+void tmpfs_pages_read(tmpfs_pages_t *pages, aoff64_t pos, void *buf,
+    size_t size)
+{
+	uint8_t *dp = buf;
+
+	while (size > 0) {
+		size_t off = pos % TMPFS_PAGE_SIZE;
+		size_t now = min(size, TMPFS_PAGE_SIZE - off);
+		uint8_t *page = tmpfs_pages_lookup(pages, pos / TMPFS_PAGE_SIZE);
+
+		if (page != NULL)
+			memcpy(dp, page + off, now);
+		else
+			memset(dp, 0, now);
+
+		dp += now;
+		pos += now;
+		size -= now;
+	}
+}
+
+/** Copy data into a page tree, allocating pages as needed.
+ *
+ * @param pages   Page tree
+ * @param pos     Starting byte position
+ * @param buf     Source buffer
+ * @param size    Number of bytes to copy
+ * @param written Place to store number of bytes actually copied
+ *
+ * @return EOK on success, ENOMEM if only part of the data was copied
+ */
+errno_t tmpfs_pages_write(tmpfs_pages_t *pages, aoff64_t pos, const void *buf,
+    size_t size, size_t *written)
+{
+	const uint8_t *sp = buf;
+	errno_t rc = EOK;
+
+	*written = 0;
+	while (size > 0) {
+		size_t off = pos % TMPFS_PAGE_SIZE;
+		size_t now = min(size, TMPFS_PAGE_SIZE - off);
+		uint8_t *page;
+
+		rc = tmpfs_pages_get(pages, pos / TMPFS_PAGE_SIZE,
+		    (void **) &page);
+		if (rc != EOK)
+			break;
+
+		memcpy(page + off, sp, now);
+
+		sp += now;
+		pos += now;
+		size -= now;
+		*written += now;
+	}
+
+	return rc;
+}
+
+/**
+ * @}
+ */
@@ -228,7 +228,16 @@ static errno_t ethip_send6(iplink_srv_t *srv, iplink_sdu6_t *sdu)
 	return rc;
 }
 
-errno_t ethip_received(iplink_srv_t *srv, void *data, size_t size)
+/** Process received Ethernet frame.
+ *
+ * @param srv IP link server
+ * @param data Frame data
+ * @param size Frame size
+ * @param pbuf Packet buffer holding @a data or @c NULL if none
+ * @return EOK on success or an error code
+ */
+errno_t ethip_received(iplink_srv_t *srv, void *data, size_t size,
+    pbuf_ref_t *pbuf)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_received(): srv=%p", srv);
 	ethip_nic_t *nic = (ethip_nic_t *) srv->arg;
@@ -253,21 +262,30 @@ errno_t ethip_received(iplink_srv_t *srv, void *data, size_t size)
 		sdu.data = frame.data;
 		sdu.size = frame.size;
 		log_msg(LOG_DEFAULT, LVL_DEBUG, " - call iplink_ev_recv");
-		rc = iplink_ev_recv(&nic->iplink, &sdu, ip_v4);
+		if (pbuf != NULL) {
+			sdu.pbuf = *pbuf;
+			rc = iplink_ev_recv_pbuf(&nic->iplink, &sdu, ip_v4);
+		} else {
+			rc = iplink_ev_recv(&nic->iplink, &sdu, ip_v4);
+		}
 		break;
 	case ETYPE_IPV6:
 		log_msg(LOG_DEFAULT, LVL_DEBUG, " - construct SDU IPv6");
 		sdu.data = frame.data;
 		sdu.size = frame.size;
 		log_msg(LOG_DEFAULT, LVL_DEBUG, " - call iplink_ev_recv");
-		rc = iplink_ev_recv(&nic->iplink, &sdu, ip_v6);
+		if (pbuf != NULL) {
+			sdu.pbuf = *pbuf;
+			rc = iplink_ev_recv_pbuf(&nic->iplink, &sdu, ip_v6);
+		} else {
+			rc = iplink_ev_recv(&nic->iplink, &sdu, ip_v6);
+		}
 		break;
 	default:
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "Unknown ethertype 0x%" PRIx16,
 		    frame.etype_len);
 	}
 
-	free(frame.data);
 	return rc;
 }
 
@@ -43,6 +43,7 @@
 #include <inet/eth_addr.h>
 #include <inet/iplink_srv.h>
 #include <loc.h>
+#include <pbuf.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -63,6 +64,9 @@ typedef struct ethip_nic {
 	/** MAC address */
 	eth_addr_t mac_addr;
 
+	/** Pool holding received frames (or @c NULL if frames are copied) */
+	pbuf_pool_t *pbuf_pool;
+
 	/**
 	 * List of IP addresses configured on this link
 	 * (of the type ethip_link_addr_t)
@@ -117,7 +121,7 @@ typedef struct {
 } ethip_atrans_t;
 
 extern errno_t ethip_iplink_init(ethip_nic_t *);
-extern errno_t ethip_received(iplink_srv_t *, void *, size_t);
+extern errno_t ethip_received(iplink_srv_t *, void *, size_t, pbuf_ref_t *);
 
 #endif
 
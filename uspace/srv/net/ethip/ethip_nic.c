@@ -42,6 +42,7 @@
 #include <inet/iplink_srv.h>
 #include <io/log.h>
 #include <loc.h>
+#include <macros.h>
 #include <mem.h>
 #include <nic_iface.h>
 #include <stdbool.h>
@@ -178,6 +179,14 @@ static errno_t ethip_nic_open(service_id_t sid)
 		goto error;
 	}
 
+	/* Not fatal, received frames will be copied */
+	rc = nic_pbuf_pool_import(nic->sess, &nic->pbuf_pool);
+	if (rc != EOK) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "NIC '%s' does not share "
+		    "received frames.", nic->svc_name);
+		nic->pbuf_pool = NULL;
+	}
+
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "Opened NIC '%s'", nic->svc_name);
 	list_append(&nic->link, &ethip_nic_list);
 	in_list = true;
@@ -276,7 +285,7 @@ static void ethip_nic_received(ethip_nic_t *nic, ipc_call_t *call)
 	    size);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "call ethip_received");
-	rc = ethip_received(&nic->iplink, data, size);
+	rc = ethip_received(&nic->iplink, data, size, NULL);
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "free data");
 	free(data);
 
@@ -284,6 +293,104 @@ static void ethip_nic_received(ethip_nic_t *nic, ipc_call_t *call)
 	async_answer_0(call, rc);
 }
 
+static void ethip_nic_received_pbuf(ethip_nic_t *nic, ipc_call_t *call)
+{
+	pbuf_pool_id_t pool_id = MERGE_LOUP32(ipc_get_arg1(call),
+	    ipc_get_arg2(call));
+	pbuf_ref_t pbuf;
+	size_t offs = ipc_get_arg4(call);
+	size_t size = ipc_get_arg5(call);
+	void *data;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_nic_received_pbuf() nic=%p", nic);
+
+	if (nic->pbuf_pool == NULL ||
+	    pbuf_pool_get_id(nic->pbuf_pool) != pool_id) {
+		/* Make the driver send us a copy */
+		async_answer_0(call, ENOENT);
+		return;
+	}
+
+	pbuf.pool = nic->pbuf_pool;
+	pbuf.id = ipc_get_arg3(call);
+
+	data = pbuf_get(pbuf.pool, pbuf.id, offs, size);
+	if (data == NULL) {
+		async_answer_0(call, EINVAL);
+		return;
+	}
+
+	rc = ethip_received(&nic->iplink, data, size, &pbuf);
+	if (rc == ENOENT) {
+		/* Would be mistaken for a request to copy */
+		rc = EIO;
+	}
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_nic_received_pbuf() done, rc=%s",
+	    str_error_name(rc));
+	async_answer_0(call, rc);
+}
+
+static void ethip_nic_received_pbuf_batch(ethip_nic_t *nic, ipc_call_t *call)
+{
+	pbuf_pool_id_t pool_id = MERGE_LOUP32(ipc_get_arg1(call),
+	    ipc_get_arg2(call));
+	size_t count = ipc_get_arg3(call);
+	nic_pbuf_desc_t *descs;
+	pbuf_ref_t pbuf;
+	size_t size;
+	size_t i;
+	void *data;
+	errno_t rc;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_nic_received_pbuf_batch() "
+	    "nic=%p count=%zu", nic, count);
+
+	if (count == 0 || count > NIC_RX_BATCH_MAX) {
+		async_answer_0(call, EINVAL);
+		return;
+	}
+
+	rc = async_data_write_accept((void **) &descs, false,
+	    count * sizeof(nic_pbuf_desc_t), count * sizeof(nic_pbuf_desc_t),
+	    0, &size);
+	if (rc != EOK) {
+		async_answer_0(call, rc);
+		return;
+	}
+
+	if (nic->pbuf_pool == NULL ||
+	    pbuf_pool_get_id(nic->pbuf_pool) != pool_id) {
+		/* Make the driver send us a copy */
+		free(descs);
+		async_answer_0(call, ENOENT);
+		return;
+	}
+
+	pbuf.pool = nic->pbuf_pool;
+
+	for (i = 0; i < count; i++) {
+		pbuf.id = descs[i].id;
+		data = pbuf_get(pbuf.pool, pbuf.id, descs[i].offs,
+		    descs[i].size);
+		if (data == NULL) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "Invalid frame "
+			    "descriptor, frame dropped.");
+			continue;
+		}
+
+		rc = ethip_received(&nic->iplink, data, descs[i].size, &pbuf);
+		if (rc != EOK) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_received() -> %s",
+			    str_error_name(rc));
+		}
+	}
+
+	free(descs);
+	async_answer_0(call, EOK);
+}
+
 static void ethip_nic_device_state(ethip_nic_t *nic, ipc_call_t *call)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "ethip_nic_device_state()");
@@ -315,6 +422,12 @@ static void ethip_nic_cb_conn(ipc_call_t *icall, void *arg)
 		case NIC_EV_DEVICE_STATE:
 			ethip_nic_device_state(nic, &call);
 			break;
+		case NIC_EV_RECEIVED_PBUF:
+			ethip_nic_received_pbuf(nic, &call);
+			break;
+		case NIC_EV_RECEIVED_PBUF_BATCH:
+			ethip_nic_received_pbuf_batch(nic, &call);
+			break;
 		default:
 			log_msg(LOG_DEFAULT, LVL_DEBUG, "unknown IPC method: %" PRIun, ipc_get_imethod(&call));
 			async_answer_0(&call, ENOTSUP);
@@ -48,12 +48,18 @@
 #include "inetsrv.h"
 #include "inet_link.h"
 #include "ndp.h"
+#include "ptrie.h"
+#include "rcache.h"
 
 static inet_addrobj_t *inet_addrobj_find_by_name_locked(const char *, inet_link_t *);
 
 static FIBRIL_MUTEX_INITIALIZE(addr_list_lock);
 static LIST_INITIALIZE(addr_list);
 static sysarg_t addr_id = 0;
+/** Address objects by network prefix */
+static inet_ptrie_t addr_net_trie;
+/** Address objects by host address */
+static inet_ptrie_t addr_host_trie;
 
 inet_addrobj_t *inet_addrobj_new(void)
 {
@@ -73,6 +79,19 @@ inet_addrobj_t *inet_addrobj_new(void)
 	return addr;
 }
 
+/** Get host prefix of address object.
+ *
+ * @param addr  Address object
+ * @param naddr Place to store prefix covering only the object's address
+ */
+static void inet_addrobj_host_naddr(inet_addrobj_t *addr, inet_naddr_t *naddr)
+{
+	inet_addr_t haddr;
+
+	inet_naddr_addr(&addr->naddr, &haddr);
+	inet_addr_naddr(&haddr, haddr.version == ip_v6 ? 128 : 32, naddr);
+}
+
 void inet_addrobj_delete(inet_addrobj_t *addr)
 {
 	if (addr->name != NULL)
@@ -83,6 +102,8 @@ void inet_addrobj_delete(inet_addrobj_t *addr)
 errno_t inet_addrobj_add(inet_addrobj_t *addr)
 {
 	inet_addrobj_t *aobj;
+	inet_naddr_t hnaddr;
+	errno_t rc;
 
 	fibril_mutex_lock(&addr_list_lock);
 	aobj = inet_addrobj_find_by_name_locked(addr->name, addr->ilink);
@@ -92,20 +113,44 @@ errno_t inet_addrobj_add(inet_addrobj_t *addr)
 		return EEXIST;
 	}
 
+	rc = inet_ptrie_insert(&addr_net_trie, &addr->naddr, addr);
+	if (rc == ENOMEM)
+		goto error;
+
+	inet_addrobj_host_naddr(addr, &hnaddr);
+	rc = inet_ptrie_insert(&addr_host_trie, &hnaddr, addr);
+	if (rc == ENOMEM) {
+		inet_ptrie_remove(&addr_net_trie, &addr->naddr, addr);
+		goto error;
+	}
+
 	list_append(&addr->addr_list, &addr_list);
 	fibril_mutex_unlock(&addr_list_lock);
 
+	inet_rcache_invalidate();
 	return EOK;
+error:
+	fibril_mutex_unlock(&addr_list_lock);
+	return rc;
 }
 
 void inet_addrobj_remove(inet_addrobj_t *addr)
 {
+	inet_naddr_t hnaddr;
+
 	fibril_mutex_lock(&addr_list_lock);
 	list_remove(&addr->addr_list);
+	inet_ptrie_remove(&addr_net_trie, &addr->naddr, addr);
+	inet_addrobj_host_naddr(addr, &hnaddr);
+	inet_ptrie_remove(&addr_host_trie, &hnaddr, addr);
 	fibril_mutex_unlock(&addr_list_lock);
+
+	inet_rcache_invalidate();
 }
 
 /** Find address object matching address @a addr.
+ *
+ * If several networks contain @a addr, the most specific one is returned.
  *
  * @param addr Address
  * @oaram find iaf_net to find network (using mask),
@@ -114,33 +159,29 @@ void inet_addrobj_remove(inet_addrobj_t *addr)
  */
 inet_addrobj_t *inet_addrobj_find(inet_addr_t *addr, inet_addrobj_find_t find)
 {
+	inet_addrobj_t *naddr = NULL;
+
 	fibril_mutex_lock(&addr_list_lock);
 
-	list_foreach(addr_list, addr_list, inet_addrobj_t, naddr) {
-		switch (find) {
-		case iaf_net:
-			if (inet_naddr_compare_mask(&naddr->naddr, addr)) {
-				fibril_mutex_unlock(&addr_list_lock);
-				log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_addrobj_find: found %p",
-				    naddr);
-				return naddr;
-			}
-			break;
-		case iaf_addr:
-			if (inet_naddr_compare(&naddr->naddr, addr)) {
-				fibril_mutex_unlock(&addr_list_lock);
-				log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_addrobj_find: found %p",
-				    naddr);
-				return naddr;
-			}
-			break;
-		}
+	switch (find) {
+	case iaf_net:
+		naddr = inet_ptrie_lookup(&addr_net_trie, addr);
+		break;
+	case iaf_addr:
+		naddr = inet_ptrie_lookup(&addr_host_trie, addr);
+		break;
 	}
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_addrobj_find: Not found");
 	fibril_mutex_unlock(&addr_list_lock);
 
-	return NULL;
+	if (naddr != NULL) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_addrobj_find: found %p",
+		    naddr);
+	} else {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_addrobj_find: Not found");
+	}
+
+	return naddr;
 }
 
 /** Find address object on a link, with a specific name.
@@ -374,7 +415,12 @@ static errno_t inet_addrobj_load(sif_node_t *anode)
 		return ENOMEM;
 	}
 
-	inet_addrobj_add(addr);
+	rc = inet_addrobj_add(addr);
+	if (rc != EOK) {
+		inet_addrobj_delete(addr);
+		return rc;
+	}
+
 	return EOK;
 }
 
@@ -36,6 +36,7 @@
 
 #include <byteorder.h>
 #include <errno.h>
+#include <inet/checksum.h>
 #include <io/log.h>
 #include <mem.h>
 #include <stdlib.h>
@@ -155,9 +156,10 @@ errno_t icmp_ping_send(uint16_t ident, inetping_sdu_t *sdu)
 	request->ident = host2uint16_t_be(ident);
 	request->seq_no = host2uint16_t_be(sdu->seq_no);
 
-	memcpy(rdata + sizeof(icmp_echo_t), sdu->data, sdu->size);
-
-	uint16_t checksum = inet_checksum_calc(INET_CHECKSUM_INIT, rdata, rsize);
+	uint16_t checksum = inet_checksum_calc(INET_CHECKSUM_INIT, request,
+	    sizeof(icmp_echo_t));
+	checksum = inet_checksum_copy(checksum, rdata + sizeof(icmp_echo_t),
+	    sdu->data, sdu->size);
 	request->checksum = host2uint16_t_be(checksum);
 
 	inet_dgram_t dgram;
@@ -43,6 +43,8 @@
 #include <ipc/inet.h>
 #include <ipc/services.h>
 #include <loc.h>
+#include <macros.h>
+#include <pbuf.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stddef.h>
@@ -57,6 +59,7 @@
 #include "inetcfg.h"
 #include "inetping.h"
 #include "inet_link.h"
+#include "rcache.h"
 #include "reass.h"
 #include "sroute.h"
 
@@ -85,6 +88,7 @@ static LIST_INITIALIZE(client_list);
 inet_cfg_t *cfg;
 
 static void inet_default_conn(ipc_call_t *, void *);
+static errno_t inet_recv_reassembled(inet_dgram_t *, uint8_t);
 
 static errno_t inet_init(void)
 {
@@ -94,6 +98,10 @@ static errno_t inet_init(void)
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_init()");
 
+	rc = inet_reass_init(inet_recv_reassembled);
+	if (rc != EOK)
+		return rc;
+
 	rc = inet_link_discovery_start();
 	if (rc != EOK)
 		return rc;
@@ -158,10 +166,14 @@ static errno_t inet_find_dir(inet_addr_t *src, inet_addr_t *dest, uint8_t tos,
     inet_dir_t *dir)
 {
 	inet_sroute_t *sr;
+	uint64_t rgen;
 
 	/* XXX Handle case where source address is specified */
 	(void) src;
 
+	if (inet_rcache_lookup(dest, dir, &rgen))
+		return EOK;
+
 	dir->aobj = inet_addrobj_find(dest, iaf_net);
 	if (dir->aobj != NULL) {
 		dir->ldest = *dest;
@@ -181,6 +193,7 @@ static errno_t inet_find_dir(inet_addr_t *src, inet_addr_t *dest, uint8_t tos,
 		return ENOENT;
 	}
 
+	inet_rcache_insert(dest, dir, rgen);
 	return EOK;
 }
 
@@ -384,9 +397,24 @@ static void inet_set_proto_srv(inet_client_t *client, ipc_call_t *call)
 	async_answer_0(call, EOK);
 }
 
+static void inet_pbuf_pool_share_srv(inet_client_t *client, ipc_call_t *call)
+{
+	pbuf_pool_id_t id = MERGE_LOUP32(ipc_get_arg1(call),
+	    ipc_get_arg2(call));
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_pbuf_pool_share_srv()");
+
+	/*
+	 * Only pools that we have ourselves can be passed on. The client
+	 * only receives datagrams.
+	 */
+	pbuf_pool_export(call, pbuf_pool_find(id), false);
+}
+
 static void inet_client_init(inet_client_t *client)
 {
 	client->sess = NULL;
+	client->no_pbuf = false;
 
 	fibril_mutex_lock(&client_list_lock);
 	list_append(&client->client_list, &client_list);
@@ -438,6 +466,9 @@ static void inet_default_conn(ipc_call_t *icall, void *arg)
 		case INET_SET_PROTO:
 			inet_set_proto_srv(&client, &call);
 			break;
+		case INET_PBUF_POOL_SHARE:
+			inet_pbuf_pool_share_srv(&client, &call);
+			break;
 		default:
 			async_answer_0(&call, EINVAL);
 		}
@@ -461,8 +492,71 @@ static inet_client_t *inet_client_find(uint8_t proto)
 	return NULL;
 }
 
-errno_t inet_ev_recv(inet_client_t *client, inet_dgram_t *dgram)
+/** Deliver datagram stored in a packet buffer to client.
+ *
+ * Only the reference to the packet buffer is passed, the client maps
+ * the pool on first use.
+ *
+ * @param client Client
+ * @param dgram Datagram
+ * @param pbuf Packet buffer holding @c dgram->data
+ * @return EOK on success, ENOTSUP if the client does not support packet
+ *         buffers or other error code
+ */
+static errno_t inet_ev_recv_pbuf(inet_client_t *client, inet_dgram_t *dgram,
+    pbuf_ref_t *pbuf)
 {
+	inet_ev_recv_pbuf_t params;
+	ipc_call_t answer;
+
+	params.src = dgram->src;
+	params.dest = dgram->dest;
+	params.offs = pbuf_offset(pbuf->pool, pbuf->id, dgram->data);
+	params.size = dgram->size;
+
+	async_exch_t *exch = async_exchange_begin(client->sess);
+
+	pbuf_pool_id_t pool_id = pbuf_pool_get_id(pbuf->pool);
+	aid_t req = async_send_5(exch, INET_EV_RECV_PBUF, dgram->tos,
+	    dgram->iplink, LOWER32(pool_id), UPPER32(pool_id), pbuf->id,
+	    &answer);
+
+	errno_t rc = async_data_write_start(exch, &params, sizeof(params));
+
+	async_exchange_end(exch);
+
+	if (rc != EOK) {
+		async_forget(req);
+		return rc;
+	}
+
+	errno_t retval;
+	async_wait_for(req, &retval);
+
+	return retval;
+}
+
+/** Deliver datagram to client.
+ *
+ * @param client Client
+ * @param dgram Datagram
+ * @param pbuf Packet buffer holding @c dgram->data or @c NULL if none
+ * @return EOK on success or an error code
+ */
+errno_t inet_ev_recv(inet_client_t *client, inet_dgram_t *dgram,
+    pbuf_ref_t *pbuf)
+{
+	errno_t rc;
+
+	if (pbuf != NULL && pbuf->pool != NULL && !client->no_pbuf) {
+		rc = inet_ev_recv_pbuf(client, dgram, pbuf);
+		if (rc != ENOTSUP)
+			return rc;
+
+		/* Client cannot map the pool, fall back to copying */
+		client->no_pbuf = true;
+	}
+
 	async_exch_t *exch = async_exchange_begin(client->sess);
 
 	ipc_call_t answer;
@@ -473,7 +567,7 @@ errno_t inet_ev_recv(inet_client_t *client, inet_dgram_t *dgram)
 	aid_t req = async_send_2(exch, INET_EV_RECV, dgram->tos,
 	    dgram->iplink, &answer);
 
-	errno_t rc = async_data_write_start(exch, &dgram->src, sizeof(inet_addr_t));
+	rc = async_data_write_start(exch, &dgram->src, sizeof(inet_addr_t));
 	if (rc != EOK) {
 		async_exchange_end(exch);
 		async_forget(req);
@@ -502,7 +596,8 @@ errno_t inet_ev_recv(inet_client_t *client, inet_dgram_t *dgram)
 	return retval;
 }
 
-errno_t inet_recv_dgram_local(inet_dgram_t *dgram, uint8_t proto)
+errno_t inet_recv_dgram_local(inet_dgram_t *dgram, uint8_t proto,
+    pbuf_ref_t *pbuf)
 {
 	inet_client_t *client;
 
@@ -522,7 +617,13 @@ errno_t inet_recv_dgram_local(inet_dgram_t *dgram, uint8_t proto)
 		return ENOENT;
 	}
 
-	return inet_ev_recv(client, dgram);
+	return inet_ev_recv(client, dgram, pbuf);
+}
+
+/** Deliver datagram reassembled from fragments. */
+static errno_t inet_recv_reassembled(inet_dgram_t *dgram, uint8_t proto)
+{
+	return inet_recv_dgram_local(dgram, proto, NULL);
 }
 
 errno_t inet_recv_packet(inet_packet_t *packet)
@@ -547,7 +648,8 @@ errno_t inet_recv_packet(inet_packet_t *packet)
 			dgram.data = packet->data;
 			dgram.size = packet->size;
 
-			return inet_recv_dgram_local(&dgram, packet->proto);
+			return inet_recv_dgram_local(&dgram, packet->proto,
+			    &packet->pbuf);
 		} else {
 			/* It is a fragment, queue it for reassembly */
 			inet_reass_queue_packet(packet);
@@ -43,6 +43,7 @@
 #include <inet/eth_addr.h>
 #include <inet/iplink.h>
 #include <ipc/loc.h>
+#include <pbuf.h>
 #include <sif.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -53,6 +54,8 @@
 typedef struct {
 	async_sess_t *sess;
 	uint8_t protocol;
+	/** Client does not accept packet buffer references */
+	bool no_pbuf;
 	link_t client_list;
 } inet_client_t;
 
@@ -101,6 +104,8 @@ typedef struct {
 	void *data;
 	/** Packet data size in bytes */
 	size_t size;
+	/** Packet buffer holding @c data (pool is @c NULL if none) */
+	pbuf_ref_t pbuf;
 } inet_packet_t;
 
 typedef struct {
@@ -120,6 +125,39 @@ typedef struct {
 	char *svc_name;
 } inet_link_cfg_info_t;
 
+/** Prefix trie node */
+typedef struct inet_ptrie_node {
+	/** Subtrees for the next bit being zero and one */
+	struct inet_ptrie_node *child[2];
+	/** Prefix (bits past @c plen are zero) */
+	uint8_t key[16];
+	/** Prefix length in bits */
+	uint8_t plen;
+	/** Values stored with this prefix */
+	list_t values; /* of inet_ptrie_value_t */
+} inet_ptrie_node_t;
+
+/** Value stored in prefix trie */
+typedef struct {
+	/** Link to inet_ptrie_node_t.values */
+	link_t lnode;
+	/** Value */
+	void *arg;
+} inet_ptrie_value_t;
+
+/** Prefix trie.
+ *
+ * Path-compressed binary trie mapping network prefixes to values,
+ * allowing longest prefix match lookups in time proportional to the
+ * address length. A zero-initialized trie is empty.
+ */
+typedef struct {
+	/** Root of the IPv4 trie */
+	inet_ptrie_node_t *root4;
+	/** Root of the IPv6 trie */
+	inet_ptrie_node_t *root6;
+} inet_ptrie_t;
+
 /** Address object */
 typedef struct {
 	/** Link to list of addresses */
@@ -178,11 +216,11 @@ typedef struct {
 
 extern inet_cfg_t *cfg;
 
-extern errno_t inet_ev_recv(inet_client_t *, inet_dgram_t *);
+extern errno_t inet_ev_recv(inet_client_t *, inet_dgram_t *, pbuf_ref_t *);
 extern errno_t inet_recv_packet(inet_packet_t *);
 extern errno_t inet_route_packet(inet_dgram_t *, uint8_t, uint8_t, int);
 extern errno_t inet_get_srcaddr(inet_addr_t *, uint8_t, inet_addr_t *);
-extern errno_t inet_recv_dgram_local(inet_dgram_t *, uint8_t);
+extern errno_t inet_recv_dgram_local(inet_dgram_t *, uint8_t, pbuf_ref_t *);
 
 #endif
 
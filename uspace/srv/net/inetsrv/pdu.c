@@ -39,6 +39,7 @@
 #include <byteorder.h>
 #include <errno.h>
 #include <fibril_synch.h>
+#include <inet/checksum.h>
 #include <inet/eth_addr.h>
 #include <io/log.h>
 #include <macros.h>
@@ -48,42 +49,6 @@
 #include "inet_std.h"
 #include "pdu.h"
 
-/** One's complement addition.
- *
- * Result is a + b + carry.
- */
-static uint16_t inet_ocadd16(uint16_t a, uint16_t b)
-{
-	uint32_t s;
-
-	s = (uint32_t)a + (uint32_t)b;
-	return (s & 0xffff) + (s >> 16);
-}
-
-uint16_t inet_checksum_calc(uint16_t ivalue, void *data, size_t size)
-{
-	uint16_t sum;
-	uint16_t w;
-	size_t words, i;
-	uint8_t *bdata;
-
-	sum = ~ivalue;
-	words = size / 2;
-	bdata = (uint8_t *)data;
-
-	for (i = 0; i < words; i++) {
-		w = ((uint16_t)bdata[2 * i] << 8) | bdata[2 * i + 1];
-		sum = inet_ocadd16(sum, w);
-	}
-
-	if (size % 2 != 0) {
-		w = ((uint16_t)bdata[2 * words] << 8);
-		sum = inet_ocadd16(sum, w);
-	}
-
-	return ~sum;
-}
-
 /** Encode IPv4 PDU.
  *
  * Encode internet packet into PDU (serialized form). Will encode a
@@ -301,11 +266,11 @@ errno_t inet_pdu_encode6(inet_packet_t *packet, addr128_t src, addr128_t dest,
  * @param data    Serialized IPv4 datagram
  * @param size    Length of serialized IPv4 datagram
  * @param link_id Link on which PDU was received
- * @param packet  IP datagram structure to be filled
+ * @param packet  IP datagram structure to be filled, the payload
+ *                is not copied and points into @a data
  *
  * @return EOK on success
  * @return EINVAL if the datagram is invalid or damaged
- * @return ENOMEM if not enough memory
  *
  */
 errno_t inet_pdu_decode(void *data, size_t size, service_id_t link_id,
@@ -359,15 +324,15 @@ errno_t inet_pdu_decode(void *data, size_t size, service_id_t link_id,
 	/* XXX IP options */
 	size_t data_offs = sizeof(uint32_t) *
 	    BIT_RANGE_EXTRACT(uint8_t, VI_IHL_h, VI_IHL_l, hdr->ver_ihl);
-
-	packet->size = tot_len - data_offs;
-	packet->data = calloc(packet->size, 1);
-	if (packet->data == NULL) {
-		log_msg(LOG_DEFAULT, LVL_WARN, "Out of memory.");
-		return ENOMEM;
+	if (data_offs > tot_len) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Header length = %zu > Total "
+		    "Length = %zu", data_offs, tot_len);
+		return EINVAL;
 	}
 
-	memcpy(packet->data, (uint8_t *) data + data_offs, packet->size);
+	packet->size = tot_len - data_offs;
+	packet->data = (uint8_t *) data + data_offs;
+	packet->pbuf.pool = NULL;
 	packet->link_id = link_id;
 
 	return EOK;
@@ -378,11 +343,11 @@ errno_t inet_pdu_decode(void *data, size_t size, service_id_t link_id,
  * @param data    Serialized IPv6 datagram
  * @param size    Length of serialized IPv6 datagram
  * @param link_id Link on which PDU was received
- * @param packet  IP datagram structure to be filled
+ * @param packet  IP datagram structure to be filled, the payload
+ *                is not copied and points into @a data
  *
  * @return EOK on success
  * @return EINVAL if the datagram is invalid or damaged
- * @return ENOMEM if not enough memory
  *
  */
 errno_t inet_pdu_decode6(void *data, size_t size, service_id_t link_id,
@@ -419,6 +384,12 @@ errno_t inet_pdu_decode6(void *data, size_t size, service_id_t link_id,
 
 	/* Fragment extension header */
 	if (hdr6->next == IP6_NEXT_FRAGMENT) {
+		if (payload_len < sizeof(ip6_header_fragment_t)) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "Payload too short "
+			    "for fragment header (%zu)", payload_len);
+			return EINVAL;
+		}
+
 		ip6_header_fragment_t *hdr6f = (ip6_header_fragment_t *)
 		    (hdr6 + 1);
 
@@ -455,13 +426,8 @@ errno_t inet_pdu_decode6(void *data, size_t size, service_id_t link_id,
 	packet->offs = foff * FRAG_OFFS_UNIT;
 
 	packet->size = payload_len;
-	packet->data = calloc(packet->size, 1);
-	if (packet->data == NULL) {
-		log_msg(LOG_DEFAULT, LVL_WARN, "Out of memory.");
-		return ENOMEM;
-	}
-
-	memcpy(packet->data, (uint8_t *) data + data_offs, packet->size);
+	packet->data = (uint8_t *) data + data_offs;
+	packet->pbuf.pool = NULL;
 	packet->link_id = link_id;
 	return EOK;
 }
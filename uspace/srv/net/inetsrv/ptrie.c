@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup inet
+ * @{
+ */
+/**
+ * @file
+ * @brief Prefix trie
+ *
+ * Path-compressed binary (Patricia) trie keyed by network prefixes. Each
+ * node holds a prefix and branches on the bit following it, so a lookup
+ * visits at most one node per bit of the address regardless of the number
+ * of prefixes stored. Nodes that only branch and hold no values exist
+ * only where two stored prefixes diverge.
+ */
+
+#include <adt/list.h>
+#include <errno.h>
+#include <inet/addr.h>
+#include <mem.h>
+#include <stdlib.h>
+#include "ptrie.h"
+
+/** Convert address to trie key.
+ *
+ * @param addr Address
+ * @param key  Place to store key (16 bytes)
+ * @param bits Place to store number of bits in the address
+ *
+ * @return @c true on success, @c false if @a addr is not an IPv4 or IPv6
+ *         address
+ */
+static bool inet_ptrie_key(const inet_addr_t *addr, uint8_t *key,
+    uint8_t *bits)
+{
+	memset(key, 0, 16);
+
+	switch (addr->version) {
+	case ip_v4:
+		key[0] = addr->addr >> 24;
+		key[1] = (addr->addr >> 16) & 0xff;
+		key[2] = (addr->addr >> 8) & 0xff;
+		key[3] = addr->addr & 0xff;
+		*bits = 32;
+		return true;
+	case ip_v6:
+		memcpy(key, addr->addr6, 16);
+		*bits = 128;
+		return true;
+	default:
+		return false;
+	}
+}
+
+/** Get root of the trie for an address family.
+ *
+ * @param trie Prefix trie
+ * @param bits Number of bits in the address (32 or 128)
+ * @return Pointer to the root
+ */
+static inet_ptrie_node_t **inet_ptrie_root(inet_ptrie_t *trie, uint8_t bits)
+{
+	return bits == 32 ? &trie->root4 : &trie->root6;
+}
+
+/** Get bit of a key.
+ *
+ * @param key Key
+ * @param i   Bit index (0 is the most significant bit of the first byte)
+ * @return Value of the bit
+ */
+static unsigned inet_ptrie_bit(const uint8_t *key, uint8_t i)
+{
+	return (key[i / 8] >> (7 - i % 8)) & 1;
+}
+
+/** Clear bits of a key past a prefix length.
+ *
+ * @param key  Key
+ * @param plen Prefix length
+ */
+static void inet_ptrie_mask(uint8_t *key, uint8_t plen)
+{
+	unsigned i;
+
+	if (plen % 8 != 0)
+		key[plen / 8] &= 0xff << (8 - plen % 8);
+	for (i = (plen + 7) / 8; i < 16; i++)
+		key[i] = 0;
+}
+
+/** Determine length of common prefix of two keys.
+ *
+ * @param a   First key
+ * @param b   Second key
+ * @param max Maximum number of bits to compare
+ * @return Number of leading bits that are equal, at most @a max
+ */
+static uint8_t inet_ptrie_common(const uint8_t *a, const uint8_t *b,
+    uint8_t max)
+{
+	unsigned i;
+	unsigned n;
+	uint8_t diff;
+
+	n = 0;
+	for (i = 0; n < max; i++) {
+		diff = a[i] ^ b[i];
+		if (diff != 0) {
+			while ((diff & 0x80) == 0) {
+				diff <<= 1;
+				n++;
+			}
+			break;
+		}
+
+		n += 8;
+	}
+
+	return n < max ? n : max;
+}
+
+/** Create trie node.
+ *
+ * @param key  Key (bits past @a plen must be zero)
+ * @param plen Prefix length
+ * @return New node or @c NULL if out of memory
+ */
+static inet_ptrie_node_t *inet_ptrie_node_new(const uint8_t *key,
+    uint8_t plen)
+{
+	inet_ptrie_node_t *node;
+
+	node = calloc(1, sizeof(inet_ptrie_node_t));
+	if (node == NULL)
+		return NULL;
+
+	memcpy(node->key, key, sizeof(node->key));
+	node->plen = plen;
+	list_initialize(&node->values);
+	return node;
+}
+
+/** Insert value into prefix trie.
+ *
+ * Several values can be stored with the same prefix. Lookups return
+ * the one that was inserted first.
+ *
+ * @param trie  Prefix trie
+ * @param naddr Network prefix (host bits are ignored)
+ * @param arg   Value
+ *
+ * @return EOK on success, EINVAL if @a naddr is not an IPv4 or IPv6
+ *         prefix, ENOMEM if out of memory
+ */
+errno_t inet_ptrie_insert(inet_ptrie_t *trie, inet_naddr_t *naddr, void *arg)
+{
+	inet_ptrie_node_t **pp;
+	inet_ptrie_node_t *node;
+	inet_ptrie_node_t *nnode;
+	inet_ptrie_node_t *branch;
+	inet_ptrie_value_t *value;
+	inet_addr_t addr;
+	uint8_t key[16];
+	uint8_t bits;
+	uint8_t plen;
+	uint8_t cpl;
+
+	inet_naddr_addr(naddr, &addr);
+	if (!inet_ptrie_key(&addr, key, &bits))
+		return EINVAL;
+
+	plen = naddr->prefix;
+	if (plen > bits)
+		return EINVAL;
+	inet_ptrie_mask(key, plen);
+
+	value = calloc(1, sizeof(inet_ptrie_value_t));
+	if (value == NULL)
+		return ENOMEM;
+	value->arg = arg;
+
+	pp = inet_ptrie_root(trie, bits);
+	while (true) {
+		node = *pp;
+		if (node == NULL) {
+			/* Empty subtree, add leaf */
+			nnode = inet_ptrie_node_new(key, plen);
+			if (nnode == NULL)
+				goto error;
+			list_append(&value->lnode, &nnode->values);
+			*pp = nnode;
+			return EOK;
+		}
+
+		cpl = inet_ptrie_common(node->key, key,
+		    node->plen < plen ? node->plen : plen);
+
+		if (cpl == node->plen && cpl == plen) {
+			/* Prefix already present */
+			list_append(&value->lnode, &node->values);
+			return EOK;
+		}
+
+		if (cpl == node->plen) {
+			/* Node prefix is a prefix of the new one, descend */
+			pp = &node->child[inet_ptrie_bit(key, node->plen)];
+			continue;
+		}
+
+		/* The new prefix diverges from the node's or contains it */
+		nnode = inet_ptrie_node_new(key, plen);
+		if (nnode == NULL)
+			goto error;
+		list_append(&value->lnode, &nnode->values);
+
+		if (cpl == plen) {
+			/* New prefix contains node prefix */
+			nnode->child[inet_ptrie_bit(node->key, plen)] = node;
+			*pp = nnode;
+			return EOK;
+		}
+
+		/* Branch where the prefixes diverge */
+		branch = inet_ptrie_node_new(key, cpl);
+		if (branch == NULL) {
+			free(nnode);
+			goto error;
+		}
+		inet_ptrie_mask(branch->key, cpl);
+
+		branch->child[inet_ptrie_bit(key, cpl)] = nnode;
+		branch->child[inet_ptrie_bit(node->key, cpl)] = node;
+		*pp = branch;
+		return EOK;
+	}
+
+error:
+	free(value);
+	return ENOMEM;
+}
+
+/** Remove value from subtree.
+ *
+ * Nodes that are left with no values and fewer than two children are
+ * removed from the trie.
+ *
+ * @param pp   Pointer to the root of the subtree
+ * @param key  Key
+ * @param plen Prefix length
+ * @param arg  Value
+ */
+static void inet_ptrie_remove_node(inet_ptrie_node_t **pp, const uint8_t *key,
+    uint8_t plen, void *arg)
+{
+	inet_ptrie_node_t *node = *pp;
+	inet_ptrie_node_t *child;
+
+	if (node == NULL || node->plen > plen ||
+	    inet_ptrie_common(node->key, key, node->plen) != node->plen)
+		return;
+
+	if (node->plen < plen) {
+		inet_ptrie_remove_node(&node->child[inet_ptrie_bit(key,
+		    node->plen)], key, plen, arg);
+	} else {
+		list_foreach(node->values, lnode, inet_ptrie_value_t, value) {
+			if (value->arg == arg) {
+				list_remove(&value->lnode);
+				free(value);
+				break;
+			}
+		}
+	}
+
+	if (!list_empty(&node->values) ||
+	    (node->child[0] != NULL && node->child[1] != NULL))
+		return;
+
+	/* Replace node with its only child (if any) */
+	child = node->child[0] != NULL ? node->child[0] : node->child[1];
+	*pp = child;
+	free(node);
+}
+
+/** Remove value from prefix trie.
+ *
+ * @param trie  Prefix trie
+ * @param naddr Network prefix the value was inserted with
+ * @param arg   Value
+ */
+void inet_ptrie_remove(inet_ptrie_t *trie, inet_naddr_t *naddr, void *arg)
+{
+	inet_addr_t addr;
+	uint8_t key[16];
+	uint8_t bits;
+
+	inet_naddr_addr(naddr, &addr);
+	if (!inet_ptrie_key(&addr, key, &bits) || naddr->prefix > bits)
+		return;
+
+	inet_ptrie_mask(key, naddr->prefix);
+	inet_ptrie_remove_node(inet_ptrie_root(trie, bits), key,
+	    naddr->prefix, arg);
+}
+
+/** Find value with the longest prefix matching an address.
+ *
+ * @param trie Prefix trie
+ * @param addr Address
+ * @return Value or @c NULL if no prefix matches @a addr
+ */
+void *inet_ptrie_lookup(inet_ptrie_t *trie, inet_addr_t *addr)
+{
+	inet_ptrie_node_t *node;
+	inet_ptrie_node_t *best;
+	uint8_t key[16];
+	uint8_t bits;
+
+	if (!inet_ptrie_key(addr, key, &bits))
+		return NULL;
+
+	best = NULL;
+	node = *inet_ptrie_root(trie, bits);
+	while (node != NULL &&
+	    inet_ptrie_common(node->key, key, node->plen) == node->plen) {
+		if (!list_empty(&node->values))
+			best = node;
+		if (node->plen == bits)
+			break;
+		node = node->child[inet_ptrie_bit(key, node->plen)];
+	}
+
+	if (best == NULL)
+		return NULL;
+
+	return list_get_instance(list_first(&best->values),
+	    inet_ptrie_value_t, lnode)->arg;
+}
+
+/** @}
+ */
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup inet
+ * @{
+ */
+/**
+ * @file
+ * @brief Route cache
+ *
+ * Remembers the direction (next hop) found for recently used destinations
+ * so that routing a datagram usually takes a single lookup in a small
+ * direct-mapped table. The whole cache is invalidated by bumping its
+ * generation number whenever an address object or a static route is added
+ * or removed.
+ */
+
+#include <adt/hash.h>
+#include <fibril_synch.h>
+#include <inet/addr.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "inetsrv.h"
+#include "rcache.h"
+
+/** Number of route cache entries (power of two) */
+#define INET_RCACHE_SIZE 256
+
+/** Route cache entry */
+typedef struct {
+	/** Generation in which the entry was filled in, zero if unused */
+	uint64_t gen;
+	/** Destination address */
+	inet_addr_t dest;
+	/** Direction to the destination */
+	inet_dir_t dir;
+} inet_rcache_entry_t;
+
+static FIBRIL_MUTEX_INITIALIZE(rcache_lock);
+static inet_rcache_entry_t rcache[INET_RCACHE_SIZE];
+/** Current generation of the cache */
+static uint64_t rcache_gen = 1;
+
+/** Get route cache entry for a destination.
+ *
+ * @param dest Destination address
+ * @return Entry the destination maps to
+ */
+static inet_rcache_entry_t *inet_rcache_entry(inet_addr_t *dest)
+{
+	size_t hash;
+	size_t i;
+
+	hash = dest->version;
+	switch (dest->version) {
+	case ip_v4:
+		hash = hash_combine(hash, dest->addr);
+		break;
+	case ip_v6:
+		for (i = 0; i < sizeof(addr128_t); i++)
+			hash = hash_combine(hash, dest->addr6[i]);
+		break;
+	default:
+		break;
+	}
+
+	return &rcache[hash_mix(hash) & (INET_RCACHE_SIZE - 1)];
+}
+
+/** Look up direction to a destination in the route cache.
+ *
+ * @param dest Destination address
+ * @param dir  Place to store direction
+ * @param rgen Place to store current generation, to be passed to
+ *             inet_rcache_insert() on a miss
+ *
+ * @return @c true if the direction was found in the cache
+ */
+bool inet_rcache_lookup(inet_addr_t *dest, inet_dir_t *dir, uint64_t *rgen)
+{
+	inet_rcache_entry_t *entry;
+	bool found = false;
+
+	fibril_mutex_lock(&rcache_lock);
+
+	entry = inet_rcache_entry(dest);
+	if (entry->gen == rcache_gen &&
+	    inet_addr_compare(&entry->dest, dest)) {
+		*dir = entry->dir;
+		found = true;
+	}
+
+	*rgen = rcache_gen;
+	fibril_mutex_unlock(&rcache_lock);
+	return found;
+}
+
+/** Enter direction to a destination into the route cache.
+ *
+ * The entry is only stored if the cache has not been invalidated since
+ * the generation @a gen was obtained from inet_rcache_lookup(), i.e. if
+ * @a dir is still valid.
+ *
+ * @param dest Destination address
+ * @param dir  Direction to the destination
+ * @param gen  Generation at the time @a dir was determined
+ */
+void inet_rcache_insert(inet_addr_t *dest, inet_dir_t *dir, uint64_t gen)
+{
+	inet_rcache_entry_t *entry;
+
+	fibril_mutex_lock(&rcache_lock);
+
+	if (gen == rcache_gen) {
+		entry = inet_rcache_entry(dest);
+		entry->gen = gen;
+		entry->dest = *dest;
+		entry->dir = *dir;
+	}
+
+	fibril_mutex_unlock(&rcache_lock);
+}
+
+/** Invalidate the route cache.
+ *
+ * Must be called whenever the routing configuration changes.
+ */
+void inet_rcache_invalidate(void)
+{
+	fibril_mutex_lock(&rcache_lock);
+	++rcache_gen;
+	fibril_mutex_unlock(&rcache_lock);
+}
+
+/** @}
+ */
@@ -34,51 +34,224 @@
  * @brief Datagram reassembly.
  */
 
+
+#include <adt/hash.h>
+#include <adt/hash_table.h>
+#include <adt/list.h>
 #include <errno.h>
 #include <fibril_synch.h>
 #include <io/log.h>
 #include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include "inetsrv.h"
 #include "inet_std.h"
 #include "reass.h"
 
-/** Datagram being reassembled.
+/** Time after which an incomplete datagram is discarded, in seconds */
+#define REASS_TIMEOUT 30
+
+/** Maximum memory held by datagrams being reassembled, in bytes */
+#define REASS_MEM_MAX (1024 * 1024)
+
+/** Datagram identification.
  *
- * Uniquely identified by (source address, destination address, protocol,
- * identification) per RFC 791 sec. 2.3 / Fragmentation.
+ * Uniquely identifies a datagram per RFC 791 sec. 2.3 / Fragmentation.
  */
 typedef struct {
-	link_t map_link;
-	/** List of fragments, @c reass_frag_t */
+	/** Source address */
+	inet_addr_t src;
+	/** Destination address */
+	inet_addr_t dest;
+	/** Protocol */
+	uint8_t proto;
+	/** Identifier */
+	uint32_t ident;
+} reass_key_t;
+
+/** Datagram being reassembled. */
+typedef struct {
+	/** Link to @c reass_dgram_map */
+	ht_link_t map_link;
+	/** Link to @c reass_dgram_age */
+	link_t age_link;
+	/** Datagram identification */
+	reass_key_t key;
+	/** Link the first fragment came from */
+	service_id_t link_id;
+	/** Type of service */
+	uint8_t tos;
+	/** Time when the datagram is discarded if still incomplete */
+	struct timespec expires;
+	/** List of non-overlapping fragments sorted by offset, @c reass_frag_t */
 	list_t frags;
+	/** Number of data bytes received */
+	size_t rcvd;
+	/** End of the furthest fragment received */
+	size_t maxend;
+	/** @c true if the last fragment was received */
+	bool have_last;
+	/** Datagram size (only valid if @c have_last is @c true) */
+	size_t dsize;
+	/** Memory charged to the datagram in bytes */
+	size_t mem;
 } reass_dgram_t;
 
 /** One datagram fragment */
 typedef struct {
 	link_t dgram_link;
-	inet_packet_t packet;
+	/** Offset of fragment data into datagram, in bytes */
+	size_t offs;
+	/** Fragment data size in bytes */
+	size_t size;
+	/** Fragment data */
+	void *data;
 } reass_frag_t;
 
-/** Datagram map, list of reass_dgram_t */
-static LIST_INITIALIZE(reass_dgram_map);
-/** Protects access to @c reass_dgram_map */
+/** Datagram map, hash table of reass_dgram_t */
+static hash_table_t reass_dgram_map;
+/** Datagrams in order of expiration, list of reass_dgram_t */
+static LIST_INITIALIZE(reass_dgram_age);
+/** Memory held by datagrams being reassembled in bytes */
+static size_t reass_mem;
+/** Protects access to @c reass_dgram_map and @c reass_dgram_age */
 static FIBRIL_MUTEX_INITIALIZE(reass_dgram_map_lock);
+/** Timer for discarding expired datagrams */
+static fibril_timer_t *reass_timer;
+/** Callback delivering reassembled datagrams */
+static inet_reass_deliver_t reass_deliver;
 
-static reass_dgram_t *reass_dgram_new(void);
+static reass_dgram_t *reass_dgram_new(inet_packet_t *);
 static reass_dgram_t *reass_dgram_get(inet_packet_t *);
 static errno_t reass_dgram_insert_frag(reass_dgram_t *, inet_packet_t *);
 static bool reass_dgram_complete(reass_dgram_t *);
 static void reass_dgram_remove(reass_dgram_t *);
 static errno_t reass_dgram_deliver(reass_dgram_t *);
 static void reass_dgram_destroy(reass_dgram_t *);
+static void reass_expire(const struct timespec *);
+static void reass_timer_set(void);
+static void reass_timeout(void *);
+
+static size_t reass_addr_hash(size_t hash, const inet_addr_t *addr)
+{
+	size_t i;
+
+	hash = hash_combine(hash, addr->version);
+	switch (addr->version) {
+	case ip_v4:
+		hash = hash_combine(hash, addr->addr);
+		break;
+	case ip_v6:
+		for (i = 0; i < sizeof(addr128_t); i++)
+			hash = hash_combine(hash, addr->addr6[i]);
+		break;
+	default:
+		break;
+	}
+
+	return hash;
+}
+
+static size_t reass_key_hash(const void *key)
+{
+	const reass_key_t *rkey = key;
+	size_t hash;
+
+	hash = hash_combine(rkey->proto, rkey->ident);
+	hash = reass_addr_hash(hash, &rkey->src);
+	hash = reass_addr_hash(hash, &rkey->dest);
+	return hash_mix(hash);
+}
+
+static size_t reass_dgram_hash(const ht_link_t *item)
+{
+	reass_dgram_t *rdg = hash_table_get_inst(item, reass_dgram_t,
+	    map_link);
+	return reass_key_hash(&rdg->key);
+}
+
+static bool reass_key_equal(const void *key, size_t hash,
+    const ht_link_t *item)
+{
+	const reass_key_t *rkey = key;
+	reass_dgram_t *rdg = hash_table_get_inst(item, reass_dgram_t,
+	    map_link);
+
+	return inet_addr_compare(&rdg->key.src, &rkey->src) &&
+	    inet_addr_compare(&rdg->key.dest, &rkey->dest) &&
+	    rdg->key.proto == rkey->proto &&
+	    rdg->key.ident == rkey->ident;
+}
+
+static bool reass_dgram_equal(const ht_link_t *item1, const ht_link_t *item2)
+{
+	reass_dgram_t *rdg = hash_table_get_inst(item1, reass_dgram_t,
+	    map_link);
+	return reass_key_equal(&rdg->key, 0, item2);
+}
+
+static const hash_table_ops_t reass_dgram_map_ops = {
+	.hash = reass_dgram_hash,
+	.key_hash = reass_key_hash,
+	.equal = reass_dgram_equal,
+	.key_equal = reass_key_equal,
+	.remove_callback = NULL
+};
+
+/** Initialize datagram reassembly.
+ *
+ * @param deliver	Callback delivering reassembled datagrams
+ * @return EOK on success or ENOMEM.
+ */
+errno_t inet_reass_init(inet_reass_deliver_t deliver)
+{
+	if (!hash_table_create(&reass_dgram_map, 0, 0, &reass_dgram_map_ops))
+		return ENOMEM;
+
+	reass_timer = fibril_timer_create(&reass_dgram_map_lock);
+	if (reass_timer == NULL) {
+		hash_table_destroy(&reass_dgram_map);
+		return ENOMEM;
+	}
+
+	reass_deliver = deliver;
+	return EOK;
+}
+
+/** Finalize datagram reassembly.
+ *
+ * Datagrams still being reassembled are discarded.
+ */
+void inet_reass_fini(void)
+{
+	reass_dgram_t *rdg;
+
+	fibril_mutex_lock(&reass_dgram_map_lock);
+
+	fibril_timer_clear_locked(reass_timer);
+
+	while (!list_empty(&reass_dgram_age)) {
+		rdg = list_get_instance(list_first(&reass_dgram_age),
+		    reass_dgram_t, age_link);
+		reass_dgram_remove(rdg);
+		reass_dgram_destroy(rdg);
+	}
+
+	fibril_mutex_unlock(&reass_dgram_map_lock);
+
+	fibril_timer_destroy(reass_timer);
+	hash_table_destroy(&reass_dgram_map);
+}
 
 /** Queue packet for datagram reassembly.
  *
  * @param packet	Packet
- * @return		EOK on success or ENOMEM.
+ * @return		EOK on success, ENOMEM if out of memory, ELIMIT
+ *			if the packet was dropped due to memory limit,
+ *			EINVAL if the fragment is not consistent with
+ *			the rest of the datagram.
  */
 errno_t inet_reass_queue_packet(inet_packet_t *packet)
 {
@@ -87,12 +260,17 @@ errno_t inet_reass_queue_packet(inet_packet_t *packet)
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "inet_reass_queue_packet()");
 
+	/* A fragment followed by more fragments cannot be empty */
+	if (packet->mf && packet->size == 0) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Empty fragment dropped.");
+		return EINVAL;
+	}
+
 	fibril_mutex_lock(&reass_dgram_map_lock);
 
 	/* Get existing or new datagram */
 	rdg = reass_dgram_get(packet);
 	if (rdg == NULL) {
-		/* Only happens when we are out of memory */
 		fibril_mutex_unlock(&reass_dgram_map_lock);
 		log_msg(LOG_DEFAULT, LVL_DEBUG, "Allocation failed, packet dropped.");
 		return ENOMEM;
@@ -100,73 +278,117 @@ errno_t inet_reass_queue_packet(inet_packet_t *packet)
 
 	/* Insert fragment into the datagram */
 	rc = reass_dgram_insert_frag(rdg, packet);
-	if (rc != EOK)
-		return ENOMEM;
+	if (rc == EINVAL) {
+		/* Fragments are inconsistent, drop the whole datagram */
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Bad fragment, datagram dropped.");
+		reass_dgram_remove(rdg);
+		reass_dgram_destroy(rdg);
+		fibril_mutex_unlock(&reass_dgram_map_lock);
+		return rc;
+	}
 
 	/* Check if datagram is complete */
-	if (reass_dgram_complete(rdg)) {
+	if (rc == EOK && reass_dgram_complete(rdg)) {
 		/* Remove it from the map */
 		reass_dgram_remove(rdg);
 		fibril_mutex_unlock(&reass_dgram_map_lock);
 
 		/* Deliver complete datagram */
 		rc = reass_dgram_deliver(rdg);
+
+		fibril_mutex_lock(&reass_dgram_map_lock);
 		reass_dgram_destroy(rdg);
+		fibril_mutex_unlock(&reass_dgram_map_lock);
 		return rc;
 	}
 
+	if (rc != EOK && list_empty(&rdg->frags)) {
+		/* Newly created datagram that we failed to store data for */
+		reass_dgram_remove(rdg);
+		reass_dgram_destroy(rdg);
+	}
+
 	fibril_mutex_unlock(&reass_dgram_map_lock);
-	return EOK;
+	return rc;
 }
 
 /** Get datagram reassembly structure for packet.
  *
  * @param packet	Packet
  * @return		Datagram reassembly structure matching @a packet
+ *			or @c NULL if out of memory
  */
 static reass_dgram_t *reass_dgram_get(inet_packet_t *packet)
 {
-	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
+	reass_key_t key;
+	ht_link_t *link;
 
-	list_foreach(reass_dgram_map, map_link, reass_dgram_t, rdg) {
-		link_t *f1_link = list_first(&rdg->frags);
-		assert(f1_link != NULL);
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
 
-		reass_frag_t *f1 = list_get_instance(f1_link, reass_frag_t,
-		    dgram_link);
+	key.src = packet->src;
+	key.dest = packet->dest;
+	key.proto = packet->proto;
+	key.ident = packet->ident;
 
-		if ((inet_addr_compare(&f1->packet.src, &packet->src)) &&
-		    (inet_addr_compare(&f1->packet.dest, &packet->dest)) &&
-		    (f1->packet.proto == packet->proto) &&
-		    (f1->packet.ident == packet->ident)) {
-			/* Match */
-			return rdg;
-		}
-	}
+	link = hash_table_find(&reass_dgram_map, &key);
+	if (link != NULL)
+		return hash_table_get_inst(link, reass_dgram_t, map_link);
 
 	/* No existing reassembly structure. Create a new one. */
-	return reass_dgram_new();
+	return reass_dgram_new(packet);
 }
 
 /** Create new datagram reassembly structure.
  *
- * @return New datagram reassembly structure.
+ * @param packet	First packet of the datagram
+ * @return		New datagram reassembly structure or @c NULL
+ *			if out of memory.
  */
-static reass_dgram_t *reass_dgram_new(void)
+static reass_dgram_t *reass_dgram_new(inet_packet_t *packet)
 {
 	reass_dgram_t *rdg;
 
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
+
 	rdg = calloc(1, sizeof(reass_dgram_t));
 	if (rdg == NULL)
 		return NULL;
 
-	list_append(&rdg->map_link, &reass_dgram_map);
+	rdg->key.src = packet->src;
+	rdg->key.dest = packet->dest;
+	rdg->key.proto = packet->proto;
+	rdg->key.ident = packet->ident;
+	rdg->link_id = packet->link_id;
+	rdg->tos = packet->tos;
 	list_initialize(&rdg->frags);
 
+	getuptime(&rdg->expires);
+	ts_add_diff(&rdg->expires, SEC2NSEC(REASS_TIMEOUT));
+
+	rdg->mem = sizeof(reass_dgram_t);
+	reass_mem += rdg->mem;
+
+	hash_table_insert(&reass_dgram_map, &rdg->map_link);
+	/* All datagrams have the same timeout, the list stays sorted */
+	list_append(&rdg->age_link, &reass_dgram_age);
+
+	if (list_first(&reass_dgram_age) == &rdg->age_link) {
+		fibril_timer_clear_locked(reass_timer);
+		reass_timer_set();
+	}
+
 	return rdg;
 }
 
-static reass_frag_t *reass_frag_new(void)
+/** Create new fragment.
+ *
+ * @param data		Fragment data
+ * @param offs		Offset of fragment data into datagram
+ * @param size		Fragment data size
+ * @return		New fragment or @c NULL if out of memory
+ */
+static reass_frag_t *reass_frag_new(const void *data, size_t offs,
+    size_t size)
 {
 	reass_frag_t *frag;
 
@@ -174,59 +396,149 @@ static reass_frag_t *reass_frag_new(void)
 	if (frag == NULL)
 		return NULL;
 
+	frag->data = malloc(size);
+	if (frag->data == NULL) {
+		free(frag);
+		return NULL;
+	}
+
+	memcpy(frag->data, data, size);
 	link_initialize(&frag->dgram_link);
+	frag->offs = offs;
+	frag->size = size;
 
 	return frag;
 }
 
+/** Drop oldest datagrams to make room for new data.
+ *
+ * @param keep		Datagram that must not be dropped
+ * @param size		Number of bytes needed
+ * @return		@c true if there is enough room, @c false if not
+ */
+static bool reass_make_room(reass_dgram_t *keep, size_t size)
+{
+	link_t *link;
+	reass_dgram_t *rdg;
+
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
+
+	link = list_first(&reass_dgram_age);
+	while (reass_mem + size > REASS_MEM_MAX && link != NULL) {
+		rdg = list_get_instance(link, reass_dgram_t, age_link);
+		link = list_next(link, &reass_dgram_age);
+
+		if (rdg == keep)
+			continue;
+
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Reassembly memory limit "
+		    "reached, dropping datagram.");
+		reass_dgram_remove(rdg);
+		reass_dgram_destroy(rdg);
+	}
+
+	return reass_mem + size <= REASS_MEM_MAX;
+}
+
+/** Insert fragment into datagram.
+ *
+ * Fragments are kept sorted and non-overlapping. Data already received
+ * takes precedence, only the parts of @a packet filling holes in the
+ * datagram are stored. Since fragments usually arrive in order, the
+ * insertion point is searched for from the end of the list.
+ *
+ * @param rdg		Datagram reassembly structure
+ * @param packet	Packet
+ * @return		EOK on success, ENOMEM if out of memory, ELIMIT if
+ *			memory limit was reached, EINVAL if the fragment
+ *			is not consistent with the rest of the datagram
+ */
 static errno_t reass_dgram_insert_frag(reass_dgram_t *rdg, inet_packet_t *packet)
 {
 	reass_frag_t *frag;
-	void *data_copy;
+	reass_frag_t *nf;
 	link_t *link;
+	size_t fragoff_limit;
+	size_t pos;
+	size_t end;
+	size_t hend;
 
 	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
 
-	frag = reass_frag_new();
+	end = packet->offs + packet->size;
 
-	/* Clone the packet */
+	/* Upper bound for fragment offset field */
+	fragoff_limit = 1 << (FF_FRAGOFF_h - FF_FRAGOFF_l + 1);
 
-	data_copy = malloc(packet->size);
-	if (data_copy == NULL) {
-		free(frag);
-		return ENOMEM;
+	/* Verify that total size of datagram is within reasonable bounds */
+	if (end > FRAG_OFFS_UNIT * fragoff_limit)
+		return EINVAL;
+
+	if (!packet->mf) {
+		/* Last fragment must agree on datagram size with the others */
+		if (rdg->have_last && end != rdg->dsize)
+			return EINVAL;
+		if (end < rdg->maxend)
+			return EINVAL;
+
+		rdg->have_last = true;
+		rdg->dsize = end;
+	} else if (rdg->have_last && end > rdg->dsize) {
+		return EINVAL;
 	}
 
-	memcpy(data_copy, packet->data, packet->size);
+	if (end > rdg->maxend)
+		rdg->maxend = end;
 
-	frag->packet = *packet;
-	frag->packet.data = data_copy;
+	/* Find last fragment ending at or before start of packet */
+	link = list_last(&rdg->frags);
+	while (link != NULL) {
+		nf = list_get_instance(link, reass_frag_t, dgram_link);
+		if (nf->offs + nf->size <= packet->offs)
+			break;
 
-	/*
-	 * XXX Make resource-consuming attacks harder, eliminate any duplicate
-	 * data immediately. Possibly eliminate redundant packet headers.
-	 */
+		link = list_prev(link, &rdg->frags);
+	}
 
-	/*
-	 * Insert into the list, which is sorted by offs member ascending.
-	 */
+	/* Fill holes between the following fragments */
+	link = (link != NULL) ? list_next(link, &rdg->frags) :
+	    list_first(&rdg->frags);
+	pos = packet->offs;
+	while (pos < end) {
+		nf = NULL;
+		hend = end;
+		if (link != NULL) {
+			nf = list_get_instance(link, reass_frag_t, dgram_link);
+			hend = min(hend, nf->offs);
+		}
 
-	link = list_first(&rdg->frags);
-	while (link != NULL) {
-		reass_frag_t *qf = list_get_instance(link, reass_frag_t,
-		    dgram_link);
+		if (hend > pos) {
+			if (!reass_make_room(rdg, sizeof(reass_frag_t) +
+			    hend - pos))
+				return ELIMIT;
+
+			frag = reass_frag_new(packet->data + pos - packet->offs,
+			    pos, hend - pos);
+			if (frag == NULL)
+				return ENOMEM;
 
-		if (qf->packet.offs >= packet->offs)
+			if (link != NULL)
+				list_insert_before(&frag->dgram_link, link);
+			else
+				list_append(&frag->dgram_link, &rdg->frags);
+
+			rdg->rcvd += frag->size;
+			rdg->mem += sizeof(reass_frag_t) + frag->size;
+			reass_mem += sizeof(reass_frag_t) + frag->size;
+		}
+
+		if (nf == NULL)
 			break;
 
+		pos = max(pos, nf->offs + nf->size);
 		link = list_next(link, &rdg->frags);
 	}
 
-	if (link != NULL)
-		list_insert_after(&frag->dgram_link, link);
-	else
-		list_append(&frag->dgram_link, &rdg->frags);
-
 	return EOK;
 }
 
@@ -237,42 +549,14 @@ static errno_t reass_dgram_insert_frag(reass_dgram_t *rdg, inet_packet_t *packet
  */
 static bool reass_dgram_complete(reass_dgram_t *rdg)
 {
-	reass_frag_t *frag, *prev;
-	link_t *link;
-
 	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
-	assert(!list_empty(&rdg->frags));
-
-	link = list_first(&rdg->frags);
-	assert(link != NULL);
-
-	frag = list_get_instance(link, reass_frag_t,
-	    dgram_link);
 
-	/* First fragment must be at offset zero */
-	if (frag->packet.offs != 0)
-		return false;
-
-	prev = frag;
-
-	while (true) {
-		link = list_next(link, &rdg->frags);
-		if (link == NULL)
-			break;
-
-		/* Each next fragment must follow immediately or overlap */
-		frag = list_get_instance(link, reass_frag_t, dgram_link);
-		if (frag->packet.offs > prev->packet.offs + prev->packet.size)
-			return false;
-
-		/* No more fragments - datagram is complete */
-		if (!frag->packet.mf)
-			return true;
-
-		prev = frag;
-	}
-
-	return false;
+	/*
+	 * Fragments do not overlap and do not extend past the end
+	 * of the datagram, so it is complete once we have as many bytes
+	 * as the last fragment says.
+	 */
+	return rdg->have_last && rdg->rcvd == rdg->dsize;
 }
 
 /** Remove datagram from reassembly map.
@@ -282,7 +566,8 @@ static bool reass_dgram_complete(reass_dgram_t *rdg)
 static void reass_dgram_remove(reass_dgram_t *rdg)
 {
 	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
-	list_remove(&rdg->map_link);
+	hash_table_remove_item(&reass_dgram_map, &rdg->map_link);
+	list_remove(&rdg->age_link);
 }
 
 /** Deliver complete datagram.
@@ -291,70 +576,26 @@ static void reass_dgram_remove(reass_dgram_t *rdg)
  */
 static errno_t reass_dgram_deliver(reass_dgram_t *rdg)
 {
-	size_t dgram_size;
-	size_t fragoff_limit;
 	inet_dgram_t dgram;
-	uint8_t proto;
-	reass_frag_t *frag;
 	errno_t rc;
 
-	/*
-	 * Potentially there could be something beyond the first packet
-	 * that has !MF. Make sure we ignore that.
-	 */
-	frag = NULL;
-	list_foreach(rdg->frags, dgram_link, reass_frag_t, cfrag) {
-		if (!cfrag->packet.mf) {
-			frag = cfrag;
-			break;
-		}
-	}
-
-	assert(frag != NULL);
-	assert(!frag->packet.mf);
-
-	dgram_size = frag->packet.offs + frag->packet.size;
-
-	/* Upper bound for fragment offset field */
-	fragoff_limit = 1 << (FF_FRAGOFF_h - FF_FRAGOFF_l + 1);
-
-	/* Verify that total size of datagram is within reasonable bounds */
-	if (dgram_size > FRAG_OFFS_UNIT * fragoff_limit)
-		return ELIMIT;
-
-	dgram.data = calloc(dgram_size, 1);
+	dgram.data = malloc(rdg->dsize);
 	if (dgram.data == NULL)
 		return ENOMEM;
 
 	/* XXX What if different fragments came from different link? */
-	dgram.iplink = frag->packet.link_id;
-	dgram.size = dgram_size;
-	dgram.src = frag->packet.src;
-	dgram.dest = frag->packet.dest;
-	dgram.tos = frag->packet.tos;
-	proto = frag->packet.proto;
+	dgram.iplink = rdg->link_id;
+	dgram.size = rdg->dsize;
+	dgram.src = rdg->key.src;
+	dgram.dest = rdg->key.dest;
+	dgram.tos = rdg->tos;
 
 	/* Pull together data from individual fragments */
-
-	size_t doffs = 0;
-
-	list_foreach(rdg->frags, dgram_link, reass_frag_t, cfrag) {
-		size_t cb, ce;
-
-		cb = max(doffs, cfrag->packet.offs);
-		ce = min(dgram_size, cfrag->packet.offs + cfrag->packet.size);
-
-		if (ce > cb) {
-			memcpy(dgram.data + cb,
-			    cfrag->packet.data + cb - cfrag->packet.offs,
-			    ce - cb);
-		}
-
-		if (!cfrag->packet.mf)
-			break;
+	list_foreach(rdg->frags, dgram_link, reass_frag_t, frag) {
+		memcpy(dgram.data + frag->offs, frag->data, frag->size);
 	}
 
-	rc = inet_recv_dgram_local(&dgram, proto);
+	rc = reass_deliver(&dgram, rdg->key.proto);
 	free(dgram.data);
 	return rc;
 }
@@ -365,18 +606,109 @@ static errno_t reass_dgram_deliver(reass_dgram_t *rdg)
  */
 static void reass_dgram_destroy(reass_dgram_t *rdg)
 {
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
+
 	while (!list_empty(&rdg->frags)) {
 		link_t *flink = list_first(&rdg->frags);
 		reass_frag_t *frag = list_get_instance(flink, reass_frag_t,
 		    dgram_link);
 
 		list_remove(&frag->dgram_link);
-		free(frag->packet.data);
+		free(frag->data);
 		free(frag);
 	}
 
+	reass_mem -= rdg->mem;
 	free(rdg);
 }
 
+/** Set timer to expire together with the oldest datagram.
+ *
+ * The timer must not be active.
+ */
+static void reass_timer_set(void)
+{
+	reass_dgram_t *rdg;
+	struct timespec now;
+	nsec_t delay;
+
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
+
+	if (list_empty(&reass_dgram_age))
+		return;
+
+	rdg = list_get_instance(list_first(&reass_dgram_age), reass_dgram_t,
+	    age_link);
+
+	getuptime(&now);
+	delay = ts_sub_diff(&rdg->expires, &now);
+	if (delay < 0)
+		delay = 0;
+
+	fibril_timer_set_locked(reass_timer, NSEC2USEC(delay), reass_timeout,
+	    NULL);
+}
+
+/** Discard datagrams that have not been completed in time.
+ *
+ * @param now		Current time
+ */
+static void reass_expire(const struct timespec *now)
+{
+	reass_dgram_t *rdg;
+
+	assert(fibril_mutex_is_locked(&reass_dgram_map_lock));
+
+	while (!list_empty(&reass_dgram_age)) {
+		rdg = list_get_instance(list_first(&reass_dgram_age),
+		    reass_dgram_t, age_link);
+		if (ts_gt(&rdg->expires, now))
+			break;
+
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "Reassembly timed out, "
+		    "datagram dropped.");
+		reass_dgram_remove(rdg);
+		reass_dgram_destroy(rdg);
+	}
+}
+
+/** Discard datagrams that would have timed out at the given time.
+ *
+ * This is normally done by the reassembly timer.
+ *
+ * @param now		Time
+ */
+void inet_reass_expire(const struct timespec *now)
+{
+	fibril_mutex_lock(&reass_dgram_map_lock);
+
+	reass_expire(now);
+
+	fibril_timer_clear_locked(reass_timer);
+	reass_timer_set();
+	fibril_mutex_unlock(&reass_dgram_map_lock);
+}
+
+/** Reassembly timeout handler.
+ *
+ * Discards datagrams that have not been completed in time.
+ *
+ * @param arg		Not used
+ */
+static void reass_timeout(void *arg)
+{
+	struct timespec now;
+
+	(void) arg;
+
+	fibril_mutex_lock(&reass_dgram_map_lock);
+
+	getuptime(&now);
+	reass_expire(&now);
+
+	reass_timer_set();
+	fibril_mutex_unlock(&reass_dgram_map_lock);
+}
+
 /** @}
  */
@@ -37,9 +37,16 @@
 #ifndef INET_REASS_H_
 #define INET_REASS_H_
 
+#include <time.h>
 #include "inetsrv.h"
 
+/** Callback delivering reassembled datagram to its protocol */
+typedef errno_t (*inet_reass_deliver_t)(inet_dgram_t *, uint8_t);
+
+extern errno_t inet_reass_init(inet_reass_deliver_t);
+extern void inet_reass_fini(void);
 extern errno_t inet_reass_queue_packet(inet_packet_t *);
+extern void inet_reass_expire(const struct timespec *);
 
 #endif
 
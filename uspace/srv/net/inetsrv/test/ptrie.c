@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <inet/addr.h>
+#include <pcut/pcut.h>
+#include "../ptrie.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(ptrie);
+
+/** Look up address in prefix trie given as a string */
+static void *ptrie_lookup_str(inet_ptrie_t *trie, const char *str)
+{
+	inet_addr_t addr;
+	errno_t rc;
+
+	rc = inet_addr_parse(str, &addr, NULL);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	return inet_ptrie_lookup(trie, &addr);
+}
+
+/** Insert value into prefix trie with prefix given as a string */
+static errno_t ptrie_insert_str(inet_ptrie_t *trie, const char *str, void *arg)
+{
+	inet_naddr_t naddr;
+	errno_t rc;
+
+	rc = inet_naddr_parse(str, &naddr, NULL);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	return inet_ptrie_insert(trie, &naddr, arg);
+}
+
+/** Remove value from prefix trie with prefix given as a string */
+static void ptrie_remove_str(inet_ptrie_t *trie, const char *str, void *arg)
+{
+	inet_naddr_t naddr;
+	errno_t rc;
+
+	rc = inet_naddr_parse(str, &naddr, NULL);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	inet_ptrie_remove(trie, &naddr, arg);
+}
+
+/** Empty trie matches nothing */
+PCUT_TEST(empty)
+{
+	inet_ptrie_t trie = { 0 };
+
+	PCUT_ASSERT_NULL(ptrie_lookup_str(&trie, "10.0.0.1"));
+	PCUT_ASSERT_NULL(ptrie_lookup_str(&trie, "2001:db8::1"));
+}
+
+/** Insert, look up and remove IPv4 prefix */
+PCUT_TEST(insert_lookup_remove)
+{
+	inet_ptrie_t trie = { 0 };
+	int a;
+	errno_t rc;
+
+	rc = ptrie_insert_str(&trie, "10.0.0.0/8", &a);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_EQUALS(&a, ptrie_lookup_str(&trie, "10.0.0.0"));
+	PCUT_ASSERT_EQUALS(&a, ptrie_lookup_str(&trie, "10.1.2.3"));
+	PCUT_ASSERT_EQUALS(&a, ptrie_lookup_str(&trie, "10.255.255.255"));
+	PCUT_ASSERT_NULL(ptrie_lookup_str(&trie, "11.0.0.0"));
+	PCUT_ASSERT_NULL(ptrie_lookup_str(&trie, "9.255.255.255"));
+
+	ptrie_remove_str(&trie, "10.0.0.0/8", &a);
+	PCUT_ASSERT_NULL(ptrie_lookup_str(&trie, "10.1.2.3"));
+	PCUT_ASSERT_NULL(trie.root4);
+}
+
+/** Host bits of the inserted prefix are ignored */
+PCUT_TEST(host_bits)
+{
+	inet_ptrie_t trie = { 0 };
+	int a;
+	errno_t rc;
+
+	rc = ptrie_insert_str(&trie, "192.168.1.77/24", &a);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_EQUALS(&a, ptrie_lookup_str(&trie, "192.168.1.1"));
+	PCUT_ASSERT_NULL(ptrie_lookup_str(&trie, "192.168.2.77"));
+
+	ptrie_remove_str(&trie, "192.168.1.0/24", &a);
+	PCUT_ASSERT_NULL(trie.root4);
+}
+
+/** Longest matching prefix wins among overlapping prefixes */
+PCUT_TEST(overlapping)
+{
+	inet_ptrie_t trie = { 0 };
+	int a, b, c;
+	errno_t rc;
+
+	/* Insert out of order so that branch nodes get created */
+	rc = ptrie_insert_str(&trie, "10.1.2.0/24", &c);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = ptrie_insert_str(&trie, "10.0.0.0/8", &a);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = ptrie_insert_str(&trie, "10.1.0.0/16", &b);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_EQUALS(&a, ptrie_lookup_str(&trie, "10.2.0.1"));
+	PCUT_ASSERT_EQUALS(&b, ptrie_lookup_str(&trie, "10.1.3.1"));
+	PCUT_ASSERT_EQUALS(&c, ptrie_lookup_str(&trie, "10.1.2.1"));
+	PCUT_ASSERT_NULL(ptrie_lookup_str(&trie, "11.1.2.1"));
+
+	/* Removing the middle prefix exposes the shorter one */
+	ptrie_remove_str(&trie, "10.1.0.0/16", &b);
+	PCUT_ASSERT_EQUALS(&a, ptrie_lookup_str(&trie, "10.1.3.1"));
+	PCUT_ASSERT_EQUALS(&c, ptrie_lookup_str(&trie, "10.1.2.1"));
+
+	ptrie_remove_str(&trie, "10.0.0.0/8", &a);
+	PCUT_ASSERT_NULL(ptrie_lookup_str(&trie, "10.1.3.1"));
+	PCUT_ASSERT_EQUALS(&c, ptrie_lookup_str(&trie, "10.1.2.1"));
+
+	ptrie_remove_str(&trie, "10.1.2.0/24", &c);
+	PCUT_ASSERT_NULL(trie.root4);
+}
+
+/** Sibling prefixes under a common branch */
+PCUT_TEST(siblings)
+{
+	inet_ptrie_t trie = { 0 };
+	int a, b;
+	errno_t rc;
+
+	rc = ptrie_insert_str(&trie, "172.16.0.0/16", &a);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = ptrie_insert_str(&trie, "172.17.0.0/16", &b);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_EQUALS(&a, ptrie_lookup_str(&trie, "172.16.5.5"));
+	PCUT_ASSERT_EQUALS(&b, ptrie_lookup_str(&trie, "172.17.5.5"));
+	PCUT_ASSERT_NULL(ptrie_lookup_str(&trie, "172.18.5.5"));
+
+	ptrie_remove_str(&trie, "172.16.0.0/16", &a);
+	PCUT_ASSERT_NULL(ptrie_lookup_str(&trie, "172.16.5.5"));
+	PCUT_ASSERT_EQUALS(&b, ptrie_lookup_str(&trie, "172.17.5.5"));
+
+	ptrie_remove_str(&trie, "172.17.0.0/16", &b);
+	PCUT_ASSERT_NULL(trie.root4);
+}
+
+/** Default route (/0) matches any address of the same version */
+PCUT_TEST(default_route)
+{
+	inet_ptrie_t trie = { 0 };
+	int a, b;
+	errno_t rc;
+
+	rc = ptrie_insert_str(&trie, "0.0.0.0/0", &a);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = ptrie_insert_str(&trie, "10.0.0.0/8", &b);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_EQUALS(&a, ptrie_lookup_str(&trie, "0.0.0.0"));
+	PCUT_ASSERT_EQUALS(&a, ptrie_lookup_str(&trie, "8.8.8.8"));
+	PCUT_ASSERT_EQUALS(&a, ptrie_lookup_str(&trie, "255.255.255.255"));
+	PCUT_ASSERT_EQUALS(&b, ptrie_lookup_str(&trie, "10.0.0.1"));
+	PCUT_ASSERT_NULL(ptrie_lookup_str(&trie, "2001:db8::1"));
+
+	ptrie_remove_str(&trie, "0.0.0.0/0", &a);
+	PCUT_ASSERT_NULL(ptrie_lookup_str(&trie, "8.8.8.8"));
+	PCUT_ASSERT_EQUALS(&b, ptrie_lookup_str(&trie, "10.0.0.1"));
+
+	ptrie_remove_str(&trie, "10.0.0.0/8", &b);
+	PCUT_ASSERT_NULL(trie.root4);
+}
+
+/** Host route (/32) matches only the one address */
+PCUT_TEST(host_route)
+{
+	inet_ptrie_t trie = { 0 };
+	int a, b;
+	errno_t rc;
+
+	rc = ptrie_insert_str(&trie, "10.0.0.0/8", &a);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = ptrie_insert_str(&trie, "10.0.0.1/32", &b);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_EQUALS(&b, ptrie_lookup_str(&trie, "10.0.0.1"));
+	PCUT_ASSERT_EQUALS(&a, ptrie_lookup_str(&trie, "10.0.0.0"));
+	PCUT_ASSERT_EQUALS(&a, ptrie_lookup_str(&trie, "10.0.0.2"));
+
+	ptrie_remove_str(&trie, "10.0.0.1/32", &b);
+	PCUT_ASSERT_EQUALS(&a, ptrie_lookup_str(&trie, "10.0.0.1"));
+
+	ptrie_remove_str(&trie, "10.0.0.0/8", &a);
+	PCUT_ASSERT_NULL(trie.root4);
+}
+
+/** IPv6 prefixes including /0 and /128 */
+PCUT_TEST(ipv6)
+{
+	inet_ptrie_t trie = { 0 };
+	int a, b, c;
+	errno_t rc;
+
+	rc = ptrie_insert_str(&trie, "::/0", &a);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = ptrie_insert_str(&trie, "2001:db8::/32", &b);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = ptrie_insert_str(&trie, "2001:db8::1/128", &c);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_EQUALS(&a, ptrie_lookup_str(&trie, "fe80::1"));
+	PCUT_ASSERT_EQUALS(&b, ptrie_lookup_str(&trie, "2001:db8::2"));
+	PCUT_ASSERT_EQUALS(&b, ptrie_lookup_str(&trie, "2001:db8:ffff::1"));
+	PCUT_ASSERT_EQUALS(&c, ptrie_lookup_str(&trie, "2001:db8::1"));
+	PCUT_ASSERT_NULL(ptrie_lookup_str(&trie, "10.0.0.1"));
+
+	ptrie_remove_str(&trie, "2001:db8::1/128", &c);
+	PCUT_ASSERT_EQUALS(&b, ptrie_lookup_str(&trie, "2001:db8::1"));
+
+	ptrie_remove_str(&trie, "2001:db8::/32", &b);
+	ptrie_remove_str(&trie, "::/0", &a);
+	PCUT_ASSERT_NULL(trie.root6);
+}
+
+/** Several values with the same prefix */
+PCUT_TEST(same_prefix)
+{
+	inet_ptrie_t trie = { 0 };
+	int a, b;
+	errno_t rc;
+
+	rc = ptrie_insert_str(&trie, "10.0.0.0/8", &a);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = ptrie_insert_str(&trie, "10.0.0.0/8", &b);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* The value inserted first is returned */
+	PCUT_ASSERT_EQUALS(&a, ptrie_lookup_str(&trie, "10.0.0.1"));
+
+	ptrie_remove_str(&trie, "10.0.0.0/8", &a);
+	PCUT_ASSERT_EQUALS(&b, ptrie_lookup_str(&trie, "10.0.0.1"));
+
+	ptrie_remove_str(&trie, "10.0.0.0/8", &b);
+	PCUT_ASSERT_NULL(trie.root4);
+}
+
+/** Prefix longer than the address is rejected */
+PCUT_TEST(invalid_prefix)
+{
+	inet_ptrie_t trie = { 0 };
+	inet_naddr_t naddr;
+	int a;
+	errno_t rc;
+
+	inet_naddr(&naddr, 10, 0, 0, 0, 33);
+	rc = inet_ptrie_insert(&trie, &naddr, &a);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+	PCUT_ASSERT_NULL(trie.root4);
+}
+
+PCUT_EXPORT(ptrie);
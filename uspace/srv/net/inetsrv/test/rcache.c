@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <inet/addr.h>
+#include <pcut/pcut.h>
+#include "../inetsrv.h"
+#include "../rcache.h"
+#include "../sroute.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(rcache);
+
+/** Entered direction is found until the cache is invalidated */
+PCUT_TEST(insert_lookup_invalidate)
+{
+	inet_addr_t dest;
+	inet_dir_t dir;
+	inet_dir_t cdir;
+	uint64_t gen;
+	bool found;
+
+	inet_rcache_invalidate();
+
+	inet_addr(&dest, 10, 0, 0, 1);
+	found = inet_rcache_lookup(&dest, &cdir, &gen);
+	PCUT_ASSERT_FALSE(found);
+
+	dir.dtype = dt_router;
+	dir.aobj = NULL;
+	inet_addr(&dir.ldest, 192, 168, 0, 1);
+	inet_rcache_insert(&dest, &dir, gen);
+
+	found = inet_rcache_lookup(&dest, &cdir, &gen);
+	PCUT_ASSERT_TRUE(found);
+	PCUT_ASSERT_INT_EQUALS(dt_router, cdir.dtype);
+	PCUT_ASSERT_TRUE(inet_addr_compare(&dir.ldest, &cdir.ldest));
+
+	inet_rcache_invalidate();
+
+	found = inet_rcache_lookup(&dest, &cdir, &gen);
+	PCUT_ASSERT_FALSE(found);
+}
+
+/** Different destinations are not confused */
+PCUT_TEST(other_dest)
+{
+	inet_addr_t dest;
+	inet_addr_t other;
+	inet_dir_t dir;
+	inet_dir_t cdir;
+	uint64_t gen;
+	bool found;
+
+	inet_rcache_invalidate();
+
+	inet_addr(&dest, 10, 0, 0, 1);
+	inet_addr6(&other, 0x2001, 0xdb8, 0, 0, 0, 0, 0, 1);
+
+	found = inet_rcache_lookup(&dest, &cdir, &gen);
+	PCUT_ASSERT_FALSE(found);
+
+	dir.dtype = dt_direct;
+	dir.aobj = NULL;
+	dir.ldest = dest;
+	inet_rcache_insert(&dest, &dir, gen);
+
+	found = inet_rcache_lookup(&other, &cdir, &gen);
+	PCUT_ASSERT_FALSE(found);
+	found = inet_rcache_lookup(&dest, &cdir, &gen);
+	PCUT_ASSERT_TRUE(found);
+}
+
+/** Direction determined before an invalidation is not entered */
+PCUT_TEST(stale_insert)
+{
+	inet_addr_t dest;
+	inet_dir_t dir;
+	inet_dir_t cdir;
+	uint64_t gen;
+	uint64_t ngen;
+	bool found;
+
+	inet_rcache_invalidate();
+
+	inet_addr(&dest, 10, 0, 0, 1);
+	found = inet_rcache_lookup(&dest, &cdir, &gen);
+	PCUT_ASSERT_FALSE(found);
+
+	/* Routing configuration changes while the route is being looked up */
+	inet_rcache_invalidate();
+
+	dir.dtype = dt_direct;
+	dir.aobj = NULL;
+	dir.ldest = dest;
+	inet_rcache_insert(&dest, &dir, gen);
+
+	found = inet_rcache_lookup(&dest, &cdir, &ngen);
+	PCUT_ASSERT_FALSE(found);
+}
+
+/** Adding and removing a static route invalidates the cache */
+PCUT_TEST(sroute_invalidate)
+{
+	inet_sroute_t *sroute;
+	inet_addr_t dest;
+	inet_dir_t dir;
+	inet_dir_t cdir;
+	uint64_t gen;
+	bool found;
+	errno_t rc;
+
+	inet_rcache_invalidate();
+
+	inet_addr(&dest, 10, 1, 2, 3);
+	dir.dtype = dt_direct;
+	dir.aobj = NULL;
+	dir.ldest = dest;
+
+	found = inet_rcache_lookup(&dest, &cdir, &gen);
+	PCUT_ASSERT_FALSE(found);
+	inet_rcache_insert(&dest, &dir, gen);
+
+	sroute = inet_sroute_new();
+	PCUT_ASSERT_NOT_NULL(sroute);
+	inet_naddr(&sroute->dest, 10, 0, 0, 0, 8);
+	inet_addr(&sroute->router, 192, 168, 0, 1);
+
+	rc = inet_sroute_add(sroute);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* The cached direct route may now be wrong */
+	found = inet_rcache_lookup(&dest, &cdir, &gen);
+	PCUT_ASSERT_FALSE(found);
+	PCUT_ASSERT_EQUALS(sroute, inet_sroute_find(&dest));
+
+	dir.dtype = dt_router;
+	dir.ldest = sroute->router;
+	inet_rcache_insert(&dest, &dir, gen);
+
+	found = inet_rcache_lookup(&dest, &cdir, &gen);
+	PCUT_ASSERT_TRUE(found);
+	PCUT_ASSERT_INT_EQUALS(dt_router, cdir.dtype);
+
+	inet_sroute_remove(sroute);
+
+	/* The route is gone, so must be the cached direction */
+	found = inet_rcache_lookup(&dest, &cdir, &gen);
+	PCUT_ASSERT_FALSE(found);
+	PCUT_ASSERT_NULL(inet_sroute_find(&dest));
+
+	inet_sroute_delete(sroute);
+}
+
+PCUT_EXPORT(rcache);
@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <inet/addr.h>
+#include <mem.h>
+#include <pcut/pcut.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../inetsrv.h"
+#include "../reass.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(reass);
+
+/** Size of test datagram buffer (maximum datagram size) */
+#define TEST_DGRAM_MAX 65536
+
+/** Number of delivered datagrams */
+static unsigned test_delivered;
+/** Size of last delivered datagram */
+static size_t test_dsize;
+/** Data of last delivered datagram */
+static uint8_t test_ddata[TEST_DGRAM_MAX];
+/** Data fragments are cut from */
+static uint8_t test_src[TEST_DGRAM_MAX];
+
+static errno_t test_deliver(inet_dgram_t *dgram, uint8_t proto)
+{
+	test_delivered++;
+	test_dsize = dgram->size;
+	memcpy(test_ddata, dgram->data, dgram->size);
+	return EOK;
+}
+
+/** Queue fragment of test datagram.
+ *
+ * @param ident Datagram identification
+ * @param data  Datagram data
+ * @param offs  Offset of fragment into datagram
+ * @param size  Fragment size
+ * @param mf    More fragments flag
+ * @return Return value of inet_reass_queue_packet()
+ */
+static errno_t test_queue(uint32_t ident, uint8_t *data, size_t offs,
+    size_t size, bool mf)
+{
+	inet_packet_t packet;
+
+	memset(&packet, 0, sizeof(packet));
+	inet_addr(&packet.src, 10, 0, 0, 1);
+	inet_addr(&packet.dest, 10, 0, 0, 2);
+	packet.proto = 17;
+	packet.ident = ident;
+	packet.mf = mf;
+	packet.offs = offs;
+	packet.data = data + offs;
+	packet.size = size;
+
+	return inet_reass_queue_packet(&packet);
+}
+
+PCUT_TEST_BEFORE
+{
+	errno_t rc;
+
+	for (size_t i = 0; i < TEST_DGRAM_MAX; i++)
+		test_src[i] = i % 251;
+
+	test_delivered = 0;
+	test_dsize = 0;
+
+	rc = inet_reass_init(test_deliver);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+}
+
+PCUT_TEST_AFTER
+{
+	inet_reass_fini();
+}
+
+/** Fragments arriving in reverse order are reassembled */
+PCUT_TEST(reverse_order)
+{
+	errno_t rc;
+
+	rc = test_queue(1, test_src, 16, 16, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = test_queue(1, test_src, 8, 8, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, test_delivered);
+
+	rc = test_queue(1, test_src, 0, 8, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(1, test_delivered);
+	PCUT_ASSERT_INT_EQUALS(32, test_dsize);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(test_ddata, test_src, 32));
+}
+
+/** Data received first wins in overlapping fragments */
+PCUT_TEST(overlap)
+{
+	uint8_t other[48];
+	errno_t rc;
+
+	memset(other, 0xff, sizeof(other));
+
+	rc = test_queue(2, test_src, 0, 16, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = test_queue(2, test_src, 32, 16, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Covers the hole and overlaps both neighbors */
+	rc = test_queue(2, other, 8, 32, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_INT_EQUALS(1, test_delivered);
+	PCUT_ASSERT_INT_EQUALS(48, test_dsize);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(test_ddata, test_src, 16));
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(test_ddata + 16, other + 16, 16));
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(test_ddata + 32, test_src + 32, 16));
+}
+
+/** Duplicate fragments do not count twice */
+PCUT_TEST(duplicate)
+{
+	errno_t rc;
+
+	rc = test_queue(3, test_src, 0, 16, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = test_queue(3, test_src, 0, 16, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = test_queue(3, test_src, 32, 8, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = test_queue(3, test_src, 32, 8, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* 32 bytes received, but the datagram has a hole */
+	PCUT_ASSERT_INT_EQUALS(0, test_delivered);
+
+	rc = test_queue(3, test_src, 16, 16, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(1, test_delivered);
+	PCUT_ASSERT_INT_EQUALS(40, test_dsize);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(test_ddata, test_src, 40));
+}
+
+/** Last fragments disagreeing on datagram size drop the datagram */
+PCUT_TEST(conflicting_last)
+{
+	errno_t rc;
+
+	rc = test_queue(4, test_src, 16, 16, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = test_queue(4, test_src, 16, 24, false);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+
+	/* The datagram is gone, this fragment starts a new one */
+	rc = test_queue(4, test_src, 0, 16, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, test_delivered);
+}
+
+/** Fragments past the end of the datagram drop the datagram */
+PCUT_TEST(past_last)
+{
+	errno_t rc;
+
+	rc = test_queue(5, test_src, 8, 8, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Last fragment ending before data already received */
+	rc = test_queue(5, test_src, 0, 8, false);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+
+	rc = test_queue(6, test_src, 8, 8, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* More fragments past the end given by the last one */
+	rc = test_queue(6, test_src, 16, 8, true);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+
+	PCUT_ASSERT_INT_EQUALS(0, test_delivered);
+}
+
+/** Empty fragment with more fragments following is rejected */
+PCUT_TEST(empty_mf)
+{
+	errno_t rc;
+
+	rc = test_queue(7, test_src, 8, 0, true);
+	PCUT_ASSERT_ERRNO_VAL(EINVAL, rc);
+
+	/* It did not create a datagram or mark its size */
+	rc = test_queue(7, test_src, 0, 16, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(1, test_delivered);
+	PCUT_ASSERT_INT_EQUALS(16, test_dsize);
+}
+
+/** Oldest datagrams are dropped when the memory limit is reached */
+PCUT_TEST(mem_limit)
+{
+	const size_t fsize = 60000;
+	const unsigned count = 20;
+	errno_t rc;
+
+	/* More than 1 MiB in total */
+	for (unsigned i = 0; i < count; i++) {
+		rc = test_queue(100 + i, test_src, 0, fsize, true);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	}
+
+	/* The oldest datagram has been dropped */
+	rc = test_queue(100, test_src, fsize, 8, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(0, test_delivered);
+
+	/* The newest one is still there */
+	rc = test_queue(100 + count - 1, test_src, fsize, 8, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(1, test_delivered);
+	PCUT_ASSERT_INT_EQUALS(fsize + 8, test_dsize);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(test_ddata, test_src, fsize + 8));
+}
+
+/** Incomplete datagrams are dropped after 30 seconds */
+PCUT_TEST(expire)
+{
+	struct timespec now;
+	errno_t rc;
+
+	getuptime(&now);
+
+	rc = test_queue(8, test_src, 0, 16, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	rc = test_queue(9, test_src, 0, 16, true);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Nothing expires before the timeout */
+	ts_add_diff(&now, SEC2NSEC(29));
+	inet_reass_expire(&now);
+
+	rc = test_queue(8, test_src, 16, 16, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(1, test_delivered);
+
+	/* After the timeout the datagram is gone */
+	ts_add_diff(&now, SEC2NSEC(2));
+	inet_reass_expire(&now);
+
+	rc = test_queue(9, test_src, 16, 16, false);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+	PCUT_ASSERT_INT_EQUALS(1, test_delivered);
+}
+
+PCUT_EXPORT(reass);
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup tcp
+ * @{
+ */
+
+/**
+ * @file TCP congestion control
+ *
+ * Generic part of congestion control (RFC 5681). Slow start and the
+ * reaction to loss are common, the window growth in congestion avoidance
+ * and the slow start threshold after a loss are computed by a pluggable
+ * algorithm (see tcp_cc_ops_t).
+ */
+
+#include <errno.h>
+#include <io/log.h>
+#include <macros.h>
+#include <stddef.h>
+#include <str.h>
+#include "cc.h"
+#include "tcp_type.h"
+
+/** Byte counting limit in slow start in segments (RFC 3465) */
+#define CC_ABC_L 2
+
+/** Upper limit for initial window in bytes (RFC 6928) */
+#define CC_IW_LIMIT 14600
+
+/** Maximum congestion window (largest window that can be advertised) */
+#define CC_CWND_MAX ((uint32_t) UINT16_MAX << TCP_WSCALE_MAX)
+
+/** Available congestion control algorithms */
+static tcp_cc_ops_t *tcp_cc_algs[] = {
+	&tcp_cc_newreno,
+	&tcp_cc_cubic,
+	NULL
+};
+
+/** Algorithm used for new connections */
+static tcp_cc_ops_t *tcp_cc_default = &tcp_cc_cubic;
+
+/** Find congestion control algorithm by name.
+ *
+ * @param name	Algorithm name
+ * @return	Algorithm or @c NULL if not found
+ */
+tcp_cc_ops_t *tcp_cc_find(const char *name)
+{
+	tcp_cc_ops_t **alg;
+
+	for (alg = tcp_cc_algs; *alg != NULL; alg++) {
+		if (str_cmp((*alg)->name, name) == 0)
+			return *alg;
+	}
+
+	return NULL;
+}
+
+/** Set congestion control algorithm used for new connections.
+ *
+ * @param name	Algorithm name
+ * @return	EOK on success, ENOENT if there is no such algorithm
+ */
+errno_t tcp_cc_set_default(const char *name)
+{
+	tcp_cc_ops_t *alg;
+
+	alg = tcp_cc_find(name);
+	if (alg == NULL)
+		return ENOENT;
+
+	tcp_cc_default = alg;
+	return EOK;
+}
+
+/** Initial congestion window (RFC 6928).
+ *
+ * @param conn	Connection
+ * @return	Initial window in bytes
+ */
+static uint32_t tcp_cc_iw(tcp_conn_t *conn)
+{
+	return min(10 * conn->snd_mss, max(2 * conn->snd_mss, CC_IW_LIMIT));
+}
+
+/** Initialize congestion control of a new connection.
+ *
+ * @param conn	Connection
+ */
+void tcp_cc_init(tcp_conn_t *conn)
+{
+	conn->cc = tcp_cc_default;
+	conn->cwnd = tcp_cc_iw(conn);
+	conn->ssthresh = UINT32_MAX;
+	conn->cwnd_cnt = 0;
+	conn->ca_state = tcp_ca_open;
+	conn->dupacks = 0;
+	conn->cc->init(conn);
+}
+
+/** Update initial window after maximum segment size has been negotiated.
+ *
+ * @param conn	Connection
+ */
+void tcp_cc_mss_set(tcp_conn_t *conn)
+{
+	conn->cwnd = tcp_cc_iw(conn);
+}
+
+/** Determine amount of outstanding data.
+ *
+ * @param conn	Connection
+ * @return	Flight size in bytes
+ */
+uint32_t tcp_cc_flight(tcp_conn_t *conn)
+{
+	return conn->snd_nxt - conn->snd_una;
+}
+
+/** Increase congestion window.
+ *
+ * @param conn	Connection
+ * @param inc	Increment in bytes
+ */
+void tcp_cc_cwnd_inc(tcp_conn_t *conn, uint32_t inc)
+{
+	conn->cwnd = min((uint64_t) conn->cwnd + inc, CC_CWND_MAX);
+}
+
+/** New data has been acknowledged outside of loss recovery.
+ *
+ * @param conn	Connection
+ * @param acked	Number of newly acknowledged bytes
+ */
+void tcp_cc_ack(tcp_conn_t *conn, uint32_t acked)
+{
+	if (acked == 0)
+		return;
+
+	if (conn->cwnd < conn->ssthresh) {
+		/*
+		 * Slow start with appropriate byte counting, so that
+		 * delayed ACKs do not slow down the growth.
+		 */
+		tcp_cc_cwnd_inc(conn, min(acked, CC_ABC_L * conn->snd_mss));
+		return;
+	}
+
+	conn->cc->cong_avoid(conn, acked);
+}
+
+/** Loss has been detected, compute new slow start threshold.
+ *
+ * The caller is responsible for setting the congestion window
+ * according to the kind of loss recovery.
+ *
+ * @param conn	Connection
+ */
+void tcp_cc_loss(tcp_conn_t *conn)
+{
+	conn->ssthresh = conn->cc->ssthresh(conn);
+	conn->cwnd_cnt = 0;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: %s: loss, cwnd=%" PRIu32
+	    ", ssthresh=%" PRIu32, conn->name, conn->cc->name, conn->cwnd,
+	    conn->ssthresh);
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup tcp
+ * @{
+ */
+/** @file Congestion control
+ */
+
+#ifndef CC_H
+#define CC_H
+
+#include <errno.h>
+#include <stdint.h>
+#include "tcp_type.h"
+
+extern tcp_cc_ops_t tcp_cc_newreno;
+extern tcp_cc_ops_t tcp_cc_cubic;
+
+extern tcp_cc_ops_t *tcp_cc_find(const char *);
+extern errno_t tcp_cc_set_default(const char *);
+extern void tcp_cc_init(tcp_conn_t *);
+extern void tcp_cc_mss_set(tcp_conn_t *);
+extern uint32_t tcp_cc_flight(tcp_conn_t *);
+extern void tcp_cc_cwnd_inc(tcp_conn_t *, uint32_t);
+extern void tcp_cc_ack(tcp_conn_t *, uint32_t);
+extern void tcp_cc_loss(tcp_conn_t *);
+
+#endif
+
+/** @}
+ */
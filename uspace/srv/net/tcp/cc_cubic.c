@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup tcp
+ * @{
+ */
+
+/**
+ * @file CUBIC congestion control (RFC 9438)
+ *
+ * In congestion avoidance the window follows the cubic function
+ * W(t) = C * (t - K)^3 + W_max, where t is the time since the last
+ * window reduction. The window is never grown slower than the window of
+ * a standard (Reno) TCP flow would (Reno-friendly region).
+ *
+ * All computations are carried out in integer arithmetic, the constants
+ * are scaled by 1024, time is in milliseconds and windows in segments.
+ */
+
+#include <macros.h>
+#include <mem.h>
+#include "cc.h"
+#include "conn.h"
+#include "tcp_type.h"
+
+/** Multiplicative decrease factor beta (0.7) scaled by 1024 */
+#define CUBIC_BETA 717
+/** Cubic scaling constant C (0.4) scaled by 1024 */
+#define CUBIC_C 410
+/** Reno-friendly additive increase 3 * (1 - beta) / (1 + beta) scaled by 1024 */
+#define CUBIC_ALPHA 542
+/** Limit on time distance from K to keep the cube in 64 bits (ms) */
+#define CUBIC_T_MAX (1 << 20)
+
+static void tcp_cc_cubic_init(tcp_conn_t *);
+static void tcp_cc_cubic_cong_avoid(tcp_conn_t *, uint32_t);
+static uint32_t tcp_cc_cubic_ssthresh(tcp_conn_t *);
+
+tcp_cc_ops_t tcp_cc_cubic = {
+	.name = "cubic",
+	.init = tcp_cc_cubic_init,
+	.cong_avoid = tcp_cc_cubic_cong_avoid,
+	.ssthresh = tcp_cc_cubic_ssthresh
+};
+
+/** Integer cube root.
+ *
+ * @param a	Argument
+ * @return	Largest y such that y^3 <= a
+ */
+static uint32_t tcp_cc_cubic_cbrt(uint64_t a)
+{
+	uint64_t y;
+	uint64_t b;
+	int s;
+
+	y = 0;
+	for (s = 63; s >= 0; s -= 3) {
+		y = 2 * y;
+		b = 3 * y * (y + 1) + 1;
+		if ((a >> s) >= b) {
+			a -= b << s;
+			++y;
+		}
+	}
+
+	return (uint32_t) y;
+}
+
+/** Initialize CUBIC state.
+ *
+ * @param conn	Connection
+ */
+static void tcp_cc_cubic_init(tcp_conn_t *conn)
+{
+	memset(&conn->cc_state.cubic, 0, sizeof(tcp_cubic_t));
+}
+
+/** Start a new congestion avoidance epoch.
+ *
+ * @param conn	Connection
+ * @param now	Current time (timestamp clock)
+ */
+static void tcp_cc_cubic_epoch_start(tcp_conn_t *conn, uint32_t now)
+{
+	tcp_cubic_t *cubic = &conn->cc_state.cubic;
+	uint32_t segs;
+
+	segs = conn->cwnd / conn->snd_mss;
+
+	cubic->epoch = now;
+	cubic->epoch_valid = true;
+
+	if (segs < cubic->w_max) {
+		/* K = cbrt((W_max - cwnd) / C) */
+		cubic->k = tcp_cc_cubic_cbrt((uint64_t) (cubic->w_max - segs) *
+		    1024 * 1000000000 / CUBIC_C);
+		cubic->origin = cubic->w_max;
+	} else {
+		cubic->k = 0;
+		cubic->origin = segs;
+	}
+
+	cubic->w_est = (uint64_t) conn->cwnd * 1024;
+}
+
+/** Grow congestion window in congestion avoidance.
+ *
+ * Compute the target window the cubic function reaches one round-trip
+ * time from now and grow the window so that it reaches the target
+ * in one round-trip time.
+ *
+ * @param conn	Connection
+ * @param acked	Number of newly acknowledged bytes
+ */
+static void tcp_cc_cubic_cong_avoid(tcp_conn_t *conn, uint32_t acked)
+{
+	tcp_cubic_t *cubic = &conn->cc_state.cubic;
+	uint32_t now;
+	uint32_t segs;
+	uint32_t est_segs;
+	uint32_t target;
+	uint64_t t;
+	uint64_t d;
+	uint64_t delta;
+	uint64_t cnt;
+
+	now = tcp_conn_ts_now();
+	if (!cubic->epoch_valid)
+		tcp_cc_cubic_epoch_start(conn, now);
+
+	segs = max(conn->cwnd / conn->snd_mss, 1);
+
+	/* Time since start of epoch plus one round-trip time */
+	t = (uint32_t) (now - cubic->epoch) + USEC2MSEC(conn->srtt);
+	d = t > cubic->k ? t - cubic->k : cubic->k - t;
+	d = min(d, CUBIC_T_MAX);
+
+	/* C * (t - K)^3 with t in milliseconds */
+	delta = (d * d * d / 1000) * CUBIC_C / (1024 * 1000000);
+
+	if (t >= cubic->k)
+		target = min(cubic->origin + delta, UINT32_MAX);
+	else
+		target = cubic->origin > delta ? cubic->origin - delta : 0;
+
+	/* Number of acked segments needed to grow window by one segment */
+	if (target > segs)
+		cnt = max(segs / (target - segs), 1);
+	else
+		cnt = 100 * (uint64_t) segs;
+
+	/* Reno-friendly region */
+	cubic->w_est += (uint64_t) acked * conn->snd_mss * CUBIC_ALPHA /
+	    conn->cwnd;
+	est_segs = cubic->w_est / 1024 / conn->snd_mss;
+	if (est_segs > segs)
+		cnt = min(cnt, max(segs / (est_segs - segs), 1));
+
+	conn->cwnd_cnt += acked;
+	if (conn->cwnd_cnt >= cnt * conn->snd_mss) {
+		conn->cwnd_cnt = 0;
+		tcp_cc_cwnd_inc(conn, conn->snd_mss);
+	}
+}
+
+/** Compute slow start threshold after loss.
+ *
+ * Remember window size at the time of loss. If the window did not
+ * reach the previous maximum, other flows are probably competing for
+ * bandwidth and we release some more of it (fast convergence).
+ *
+ * @param conn	Connection
+ * @return	New slow start threshold
+ */
+static uint32_t tcp_cc_cubic_ssthresh(tcp_conn_t *conn)
+{
+	tcp_cubic_t *cubic = &conn->cc_state.cubic;
+	uint32_t segs;
+
+	segs = conn->cwnd / conn->snd_mss;
+	cubic->epoch_valid = false;
+
+	if (segs < cubic->w_max)
+		cubic->w_max = segs * (1024 + CUBIC_BETA) / 2048;
+	else
+		cubic->w_max = segs;
+
+	return max((uint64_t) conn->cwnd * CUBIC_BETA / 1024,
+	    2 * conn->snd_mss);
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup tcp
+ * @{
+ */
+
+/**
+ * @file NewReno congestion control (RFC 5681, RFC 6582)
+ */
+
+#include <macros.h>
+#include "cc.h"
+#include "tcp_type.h"
+
+static void tcp_cc_newreno_init(tcp_conn_t *);
+static void tcp_cc_newreno_cong_avoid(tcp_conn_t *, uint32_t);
+static uint32_t tcp_cc_newreno_ssthresh(tcp_conn_t *);
+
+tcp_cc_ops_t tcp_cc_newreno = {
+	.name = "newreno",
+	.init = tcp_cc_newreno_init,
+	.cong_avoid = tcp_cc_newreno_cong_avoid,
+	.ssthresh = tcp_cc_newreno_ssthresh
+};
+
+/** Initialize NewReno state.
+ *
+ * @param conn	Connection
+ */
+static void tcp_cc_newreno_init(tcp_conn_t *conn)
+{
+	(void) conn;
+}
+
+/** Grow congestion window in congestion avoidance.
+ *
+ * Increase the window by one segment per window's worth of acknowledged
+ * data, i.e. approximately once per round-trip time (RFC 5681 section
+ * 3.1, byte counting per RFC 3465).
+ *
+ * @param conn	Connection
+ * @param acked	Number of newly acknowledged bytes
+ */
+static void tcp_cc_newreno_cong_avoid(tcp_conn_t *conn, uint32_t acked)
+{
+	conn->cwnd_cnt += acked;
+	if (conn->cwnd_cnt >= conn->cwnd) {
+		conn->cwnd_cnt -= conn->cwnd;
+		tcp_cc_cwnd_inc(conn, conn->snd_mss);
+	}
+}
+
+/** Compute slow start threshold after loss.
+ *
+ * @param conn	Connection
+ * @return	Half of the flight size, but at least two segments
+ */
+static uint32_t tcp_cc_newreno_ssthresh(tcp_conn_t *conn)
+{
+	return max(tcp_cc_flight(conn) / 2, 2 * conn->snd_mss);
+}
+
+/**
+ * @}
+ */
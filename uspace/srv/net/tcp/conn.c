@@ -39,22 +39,49 @@
 #include <inet/endpoint.h>
 #include <io/log.h>
 #include <macros.h>
+#include <mem.h>
 #include <nettl/amap.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <time.h>
+#include "cc.h"
 #include "conn.h"
 #include "inet.h"
 #include "iqueue.h"
+#include "ncsim.h"
 #include "pdu.h"
 #include "rqueue.h"
 #include "segment.h"
 #include "seq_no.h"
+#include "std.h"
 #include "tcp_type.h"
 #include "tqueue.h"
 #include "ucall.h"
 
-#define RCV_BUF_SIZE 4096/*2*/
-#define SND_BUF_SIZE 4096
+/** Default initial receive buffer size */
+#define RCV_BUF_INIT (64 * 1024)
+/** Default maximum receive buffer size */
+#define RCV_BUF_MAX (4 * 1024 * 1024)
+/** Default initial send buffer size */
+#define SND_BUF_INIT (64 * 1024)
+/** Default maximum send buffer size */
+#define SND_BUF_MAX (4 * 1024 * 1024)
+
+/** Receive buffer tuning interval used while RTT is not known */
+#define RCVQ_INTERVAL_DEFAULT (200 * 1000)
+/** Granularity of the timestamp clock */
+#define TS_GRANULARITY (1000)
+
+/** Initial retransmission timeout (RFC 6298) */
+#define RTO_INIT (1000 * 1000)
+/**
+ * Lower bound on retransmission timeout. RFC 6298 recommends one second,
+ * we follow the common practice of a lower bound, which speeds up
+ * recovery on low-latency paths considerably.
+ */
+#define RTO_MIN (200 * 1000)
+/** Upper bound on retransmission timeout */
+#define RTO_MAX (60 * 1000 * 1000)
 
 #define MAX_SEGMENT_LIFETIME	(15*1000*1000) //(2*60*1000*1000)
 #define TIME_WAIT_TIMEOUT	(2*MAX_SEGMENT_LIFETIME)
@@ -71,12 +98,22 @@ static FIBRIL_MUTEX_INITIALIZE(amap_lock);
 /** Internal loopback configuration */
 tcp_lb_t tcp_conn_lb = tcp_lb_none;
 
+/** Send and receive buffer configuration */
+tcp_bufcfg_t tcp_conn_bufcfg = {
+	.rcv_buf_init = RCV_BUF_INIT,
+	.rcv_buf_max = RCV_BUF_MAX,
+	.snd_buf_init = SND_BUF_INIT,
+	.snd_buf_max = SND_BUF_MAX
+};
+
 static void tcp_conn_seg_process(tcp_conn_t *, tcp_segment_t *);
 static void tcp_conn_tw_timer_set(tcp_conn_t *);
 static void tcp_conn_tw_timer_clear(tcp_conn_t *);
 static void tcp_transmit_segment(inet_ep2_t *, tcp_segment_t *);
 static void tcp_conn_trim_seg_to_wnd(tcp_conn_t *, tcp_segment_t *);
 static void tcp_reply_rst(inet_ep2_t *, tcp_segment_t *);
+static void tcp_conn_rtt_sample(tcp_conn_t *, usec_t);
+static void tcp_conn_ts_rtt_sample(tcp_conn_t *, uint32_t);
 
 static tcp_tqueue_cb_t tcp_conn_tqueue_cb = {
 	.transmit_seg = tcp_transmit_segment
@@ -132,7 +169,10 @@ tcp_conn_t *tcp_conn_new(inet_ep2_t *epp)
 
 	/* Allocate receive buffer */
 	fibril_condvar_initialize(&conn->rcv_buf_cv);
-	conn->rcv_buf_size = RCV_BUF_SIZE;
+	conn->rcv_buf_size = tcp_conn_bufcfg.rcv_buf_init;
+	conn->rcv_buf_max = max(tcp_conn_bufcfg.rcv_buf_max,
+	    conn->rcv_buf_size);
+	conn->rcv_buf_start = 0;
 	conn->rcv_buf_used = 0;
 	conn->rcv_buf_fin = false;
 
@@ -142,7 +182,10 @@ tcp_conn_t *tcp_conn_new(inet_ep2_t *epp)
 
 	/** Allocate send buffer */
 	fibril_condvar_initialize(&conn->snd_buf_cv);
-	conn->snd_buf_size = SND_BUF_SIZE;
+	conn->snd_buf_size = tcp_conn_bufcfg.snd_buf_init;
+	conn->snd_buf_max = max(tcp_conn_bufcfg.snd_buf_max,
+	    conn->snd_buf_size);
+	conn->snd_buf_start = 0;
 	conn->snd_buf_used = 0;
 	conn->snd_buf_fin = false;
 	conn->snd_buf = calloc(1, conn->snd_buf_size);
@@ -152,6 +195,25 @@ tcp_conn_t *tcp_conn_new(inet_ep2_t *epp)
 	/* Set up receive window. */
 	conn->rcv_wnd = conn->rcv_buf_size;
 
+	/*
+	 * Offer the smallest window scale that allows advertising
+	 * the maximum receive buffer size.
+	 */
+	conn->rcv_wscale_offer = 0;
+	while (conn->rcv_wscale_offer < TCP_WSCALE_MAX &&
+	    (conn->rcv_buf_max >> conn->rcv_wscale_offer) > UINT16_MAX)
+		++conn->rcv_wscale_offer;
+
+	conn->snd_mss = TCP_MSS_DEFAULT;
+	getuptime(&conn->rcvq_time);
+
+	/* Round-trip time is not known yet */
+	conn->srtt = 0;
+	conn->rttvar = 0;
+	conn->rto = RTO_INIT;
+
+	tcp_cc_init(conn);
+
 	/* Initialize incoming segment queue */
 	tcp_iqueue_init(&conn->incoming, conn);
 
@@ -511,6 +573,393 @@ bool tcp_conn_got_syn(tcp_conn_t *conn)
 	assert(false);
 }
 
+/** Write data to circular buffer.
+ *
+ * @param buf		Buffer
+ * @param bsize		Buffer size
+ * @param pos		Position where to start writing (may exceed @a bsize
+ *			by less than @a bsize)
+ * @param data		Data
+ * @param size		Number of bytes to write
+ */
+static void tcp_conn_cbuf_write(uint8_t *buf, size_t bsize, size_t pos,
+    const void *data, size_t size)
+{
+	size_t first;
+
+	if (pos >= bsize)
+		pos -= bsize;
+
+	first = min(size, bsize - pos);
+	memcpy(buf + pos, data, first);
+	memcpy(buf, (const uint8_t *) data + first, size - first);
+}
+
+/** Read data from circular buffer and remove it.
+ *
+ * @param buf		Buffer
+ * @param bsize		Buffer size
+ * @param start		Index of first used byte, will be updated
+ * @param used		Number of bytes used, will be updated
+ * @param data		Destination
+ * @param size		Number of bytes to read
+ */
+static void tcp_conn_cbuf_read(uint8_t *buf, size_t bsize, size_t *start,
+    size_t *used, void *data, size_t size)
+{
+	size_t first;
+
+	assert(size <= *used);
+
+	first = min(size, bsize - *start);
+	memcpy(data, buf + *start, first);
+	memcpy((uint8_t *) data + first, buf, size - first);
+
+	*start += size;
+	if (*start >= bsize)
+		*start -= bsize;
+	*used -= size;
+
+	/* Keep data contiguous for as long as possible */
+	if (*used == 0)
+		*start = 0;
+}
+
+/** Resize circular buffer.
+ *
+ * The data is moved to the beginning of the new buffer.
+ *
+ * @param buf		Buffer, will be updated
+ * @param bsize		Buffer size, will be updated
+ * @param start		Index of first used byte, will be updated
+ * @param used		Number of bytes used
+ * @param nsize		New size
+ * @return		EOK on success, ENOMEM if out of memory
+ */
+static errno_t tcp_conn_cbuf_resize(uint8_t **buf, size_t *bsize,
+    size_t *start, size_t used, size_t nsize)
+{
+	uint8_t *nbuf;
+	size_t nused;
+
+	assert(nsize >= used);
+
+	nbuf = malloc(nsize);
+	if (nbuf == NULL)
+		return ENOMEM;
+
+	nused = used;
+	tcp_conn_cbuf_read(*buf, *bsize, start, &nused, nbuf, used);
+
+	free(*buf);
+	*buf = nbuf;
+	*bsize = nsize;
+	*start = 0;
+	return EOK;
+}
+
+/** Append data to the send buffer.
+ *
+ * @param conn		Connection
+ * @param data		Data
+ * @param size		Number of bytes to append
+ * @return		Number of bytes actually appended (limited by free
+ *			space in the send buffer)
+ */
+size_t tcp_conn_snd_buf_put(tcp_conn_t *conn, const void *data, size_t size)
+{
+	size_t xfer_size;
+
+	assert(fibril_mutex_is_locked(&conn->lock));
+
+	xfer_size = min(size, conn->snd_buf_size - conn->snd_buf_used);
+	tcp_conn_cbuf_write(conn->snd_buf, conn->snd_buf_size,
+	    conn->snd_buf_start + conn->snd_buf_used, data, xfer_size);
+	conn->snd_buf_used += xfer_size;
+
+	return xfer_size;
+}
+
+/** Remove data from the beginning of the send buffer.
+ *
+ * @param conn		Connection
+ * @param buf		Destination buffer
+ * @param size		Number of bytes to remove (must not exceed the number
+ *			of bytes in the send buffer)
+ */
+void tcp_conn_snd_buf_get(tcp_conn_t *conn, void *buf, size_t size)
+{
+	assert(fibril_mutex_is_locked(&conn->lock));
+
+	tcp_conn_cbuf_read(conn->snd_buf, conn->snd_buf_size,
+	    &conn->snd_buf_start, &conn->snd_buf_used, buf, size);
+}
+
+/** Append received data to the receive buffer.
+ *
+ * @param conn		Connection
+ * @param data		Data
+ * @param size		Number of bytes (must fit in the receive buffer)
+ */
+static void tcp_conn_rcv_buf_put(tcp_conn_t *conn, const void *data,
+    size_t size)
+{
+	assert(size <= conn->rcv_buf_size - conn->rcv_buf_used);
+
+	tcp_conn_cbuf_write(conn->rcv_buf, conn->rcv_buf_size,
+	    conn->rcv_buf_start + conn->rcv_buf_used, data, size);
+	conn->rcv_buf_used += size;
+}
+
+/** Remove data from the beginning of the receive buffer.
+ *
+ * @param conn		Connection
+ * @param buf		Destination buffer
+ * @param size		Size of destination buffer
+ * @return		Number of bytes removed
+ */
+size_t tcp_conn_rcv_buf_get(tcp_conn_t *conn, void *buf, size_t size)
+{
+	size_t xfer_size;
+
+	assert(fibril_mutex_is_locked(&conn->lock));
+
+	xfer_size = min(size, conn->rcv_buf_used);
+	tcp_conn_cbuf_read(conn->rcv_buf, conn->rcv_buf_size,
+	    &conn->rcv_buf_start, &conn->rcv_buf_used, buf, xfer_size);
+
+	return xfer_size;
+}
+
+/** Auto-tune receive buffer size.
+ *
+ * Should be called when the user consumes data from the receive buffer.
+ * Once per round-trip time we check how much data the peer managed to
+ * send. If it filled more than half of the receive buffer, the receive
+ * window is what limits the throughput and we double the buffer (and,
+ * consequently, the window), up to the configured maximum.
+ *
+ * @param conn		Connection
+ */
+void tcp_conn_rcv_buf_tune(tcp_conn_t *conn)
+{
+	struct timespec now;
+	usec_t interval;
+	uint32_t rcvd;
+	size_t limit;
+	size_t nsize;
+	size_t osize;
+	errno_t rc;
+
+	assert(fibril_mutex_is_locked(&conn->lock));
+
+	getuptime(&now);
+	interval = conn->srtt != 0 ? conn->srtt : RCVQ_INTERVAL_DEFAULT;
+	if (NSEC2USEC(ts_sub_diff(&now, &conn->rcvq_time)) < interval)
+		return;
+
+	rcvd = conn->rcv_nxt - conn->rcvq_seq;
+	conn->rcvq_seq = conn->rcv_nxt;
+	conn->rcvq_time = now;
+
+	if (2 * (size_t) rcvd <= conn->rcv_buf_size)
+		return;
+
+	/* Without window scaling we cannot advertise a larger window */
+	limit = conn->ws_ok ? conn->rcv_buf_max : conn->rcv_buf_size;
+	nsize = min(2 * conn->rcv_buf_size, limit);
+	if (nsize <= conn->rcv_buf_size)
+		return;
+
+	osize = conn->rcv_buf_size;
+	rc = tcp_conn_cbuf_resize(&conn->rcv_buf, &conn->rcv_buf_size,
+	    &conn->rcv_buf_start, conn->rcv_buf_used, nsize);
+	if (rc != EOK)
+		return;
+
+	conn->rcv_wnd += nsize - osize;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: receive buffer grown to %zu bytes",
+	    conn->name, nsize);
+}
+
+/** Auto-tune send buffer size.
+ *
+ * Should be called when the send buffer is full. If the send buffer
+ * is smaller than the window offered by the peer, the user cannot
+ * supply data fast enough to fill the window and we double the buffer,
+ * up to the configured maximum.
+ *
+ * @param conn		Connection
+ */
+void tcp_conn_snd_buf_tune(tcp_conn_t *conn)
+{
+	size_t nsize;
+	errno_t rc;
+
+	assert(fibril_mutex_is_locked(&conn->lock));
+
+	if (conn->snd_buf_size >= conn->snd_wnd)
+		return;
+
+	nsize = min(2 * conn->snd_buf_size, conn->snd_buf_max);
+	if (nsize <= conn->snd_buf_size)
+		return;
+
+	rc = tcp_conn_cbuf_resize(&conn->snd_buf, &conn->snd_buf_size,
+	    &conn->snd_buf_start, conn->snd_buf_used, nsize);
+	if (rc != EOK)
+		return;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: send buffer grown to %zu bytes",
+	    conn->name, nsize);
+}
+
+/** Get current value of the timestamp clock.
+ *
+ * @return	Timestamp clock value in milliseconds
+ */
+uint32_t tcp_conn_ts_now(void)
+{
+	struct timespec now;
+
+	getuptime(&now);
+	return (uint32_t) (SEC2MSEC(now.tv_sec) + NSEC2MSEC(now.tv_nsec));
+}
+
+/** Process options of a received SYN segment.
+ *
+ * Negotiate maximum segment size, window scaling and timestamps
+ * (RFC 7323) and selective acknowledgements (RFC 2018). Window scaling,
+ * timestamps and SACK are only used if both sides send the respective
+ * option in their SYN.
+ *
+ * @param conn		Connection
+ * @param seg		Received SYN segment
+ */
+static void tcp_conn_syn_opts(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	if ((seg->opts & SOPT_MSS) != 0 && seg->mss != 0)
+		conn->snd_mss = seg->mss;
+	else
+		conn->snd_mss = TCP_MSS_DEFAULT;
+
+	if ((seg->opts & SOPT_WSCALE) != 0) {
+		conn->ws_ok = true;
+		conn->snd_wscale = min(seg->wscale, TCP_WSCALE_MAX);
+		conn->rcv_wscale = conn->rcv_wscale_offer;
+	} else {
+		conn->ws_ok = false;
+		conn->snd_wscale = 0;
+		conn->rcv_wscale = 0;
+	}
+
+	if ((seg->opts & SOPT_TS) != 0) {
+		conn->ts_ok = true;
+		conn->ts_recent = seg->tsval;
+	} else {
+		conn->ts_ok = false;
+	}
+
+	conn->sack_ok = (seg->opts & SOPT_SACK_PERM) != 0;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: MSS=%zu, WS=%s (snd %u, rcv %u), "
+	    "TS=%s, SACK=%s", conn->name, conn->snd_mss,
+	    conn->ws_ok ? "yes" : "no", conn->snd_wscale, conn->rcv_wscale,
+	    conn->ts_ok ? "yes" : "no", conn->sack_ok ? "yes" : "no");
+
+	/* Initial window depends on MSS */
+	tcp_cc_mss_set(conn);
+
+	/* Start receive buffer tuning measurement */
+	conn->rcvq_seq = seg->seq + 1;
+	getuptime(&conn->rcvq_time);
+}
+
+/** Process timestamp option of an incoming segment.
+ *
+ * Update TS.Recent (RFC 7323 section 4.3) and take a round-trip time
+ * sample from the echoed timestamp.
+ *
+ * @param conn		Connection
+ * @param seg		Acceptable incoming segment
+ */
+static void tcp_conn_ts_process(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	if (!conn->ts_ok || (seg->opts & SOPT_TS) == 0)
+		return;
+
+	/* SEG.TSval >= TS.Recent and SEG.SEQ <= Last.ACK.sent */
+	if ((int32_t) (seg->tsval - conn->ts_recent) >= 0 &&
+	    (int32_t) (seg->seq - conn->rcv_nxt) <= 0)
+		conn->ts_recent = seg->tsval;
+
+	/*
+	 * The echoed timestamp yields an RTT sample if the segment
+	 * acknowledges new data or carries data (the latter allows
+	 * a receive-only side to estimate RTT, too).
+	 */
+	if (seg->tsecr != 0 && (tcp_segment_text_size(seg) > 0 ||
+	    ((seg->ctrl & CTL_ACK) != 0 &&
+	    seq_no_ack_acceptable(conn, seg->ack))))
+		tcp_conn_ts_rtt_sample(conn, seg->tsecr);
+}
+
+/** Take round-trip time sample from echoed timestamp.
+ *
+ * @param conn		Connection
+ * @param tsecr		Echoed timestamp
+ */
+static void tcp_conn_ts_rtt_sample(tcp_conn_t *conn, uint32_t tsecr)
+{
+	uint32_t rtt_ms;
+
+	rtt_ms = tcp_conn_ts_now() - tsecr;
+
+	/* Discard bogus samples (echo of a timestamp from the future) */
+	if ((int32_t) rtt_ms < 0)
+		return;
+
+	tcp_conn_rtt_sample(conn, MSEC2USEC((usec_t) rtt_ms));
+}
+
+/** Update round-trip time estimate with a new sample.
+ *
+ * Compute smoothed round-trip time, its variation and the
+ * retransmission timeout according to RFC 6298.
+ *
+ * @param conn		Connection
+ * @param rtt		Round-trip time sample in microseconds
+ */
+static void tcp_conn_rtt_sample(tcp_conn_t *conn, usec_t rtt)
+{
+	usec_t diff;
+
+	rtt = max(rtt, TS_GRANULARITY);
+
+	if (conn->srtt == 0) {
+		/* First measurement */
+		conn->srtt = rtt;
+		conn->rttvar = rtt / 2;
+	} else {
+		diff = conn->srtt > rtt ? conn->srtt - rtt : rtt - conn->srtt;
+		conn->rttvar = (3 * conn->rttvar + diff) / 4;
+		conn->srtt = (7 * conn->srtt + rtt) / 8;
+	}
+
+	conn->rto = conn->srtt + max(TS_GRANULARITY, 4 * conn->rttvar);
+	conn->rto = min(max(conn->rto, RTO_MIN), RTO_MAX);
+}
+
+/** Back off retransmission timeout after the timer expired.
+ *
+ * @param conn		Connection
+ */
+void tcp_conn_rto_backoff(tcp_conn_t *conn)
+{
+	conn->rto = min(2 * conn->rto, RTO_MAX);
+}
+
 /** Segment arrived in Listen state.
  *
  * @param conn		Connection
@@ -543,6 +992,8 @@ static void tcp_conn_sa_listen(tcp_conn_t *conn, tcp_segment_t *seg)
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "rcv_nxt=%u", conn->rcv_nxt);
 
+	tcp_conn_syn_opts(conn, seg);
+
 	if (seg->len > 1)
 		log_msg(LOG_DEFAULT, LVL_WARN, "SYN combined with data, ignoring data.");
 
@@ -554,7 +1005,8 @@ static void tcp_conn_sa_listen(tcp_conn_t *conn, tcp_segment_t *seg)
 	/*
 	 * Surprisingly the spec does not deal with initial window setting.
 	 * Set SND.WND = SEG.WND and set SND.WL1 so that next segment
-	 * will always be accepted as new window setting.
+	 * will always be accepted as new window setting. The window
+	 * in a SYN segment is never scaled.
 	 */
 	conn->snd_wnd = seg->wnd;
 	conn->snd_wl1 = seg->seq;
@@ -615,7 +1067,13 @@ static void tcp_conn_sa_syn_sent(tcp_conn_t *conn, tcp_segment_t *seg)
 	conn->rcv_nxt = seg->seq + 1;
 	conn->irs = seg->seq;
 
+	tcp_conn_syn_opts(conn, seg);
+
 	if ((seg->ctrl & CTL_ACK) != 0) {
+		/* RTT sample from the echo of our SYN timestamp */
+		if (conn->ts_ok && seg->tsecr != 0)
+			tcp_conn_ts_rtt_sample(conn, seg->tsecr);
+
 		conn->snd_una = seg->ack;
 
 		/*
@@ -630,7 +1088,8 @@ static void tcp_conn_sa_syn_sent(tcp_conn_t *conn, tcp_segment_t *seg)
 	/*
 	 * Surprisingly the spec does not deal with initial window setting.
 	 * Set SND.WND = SEG.WND and set SND.WL1 so that next segment
-	 * will always be accepted as new window setting.
+	 * will always be accepted as new window setting. The window
+	 * in a SYN segment is never scaled.
 	 */
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "SND.WND := %" PRIu32 ", SND.WL1 := %" PRIu32 ", "
 	    "SND.WL2 = %" PRIu32, seg->wnd, seg->seq, seg->seq);
@@ -662,6 +1121,7 @@ static void tcp_conn_sa_syn_sent(tcp_conn_t *conn, tcp_segment_t *seg)
 static void tcp_conn_sa_queue(tcp_conn_t *conn, tcp_segment_t *seg)
 {
 	tcp_segment_t *pseg;
+	bool ooo;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_sa_seq(%p, %p)", conn, seg);
 
@@ -673,6 +1133,13 @@ static void tcp_conn_sa_queue(tcp_conn_t *conn, tcp_segment_t *seg)
 		return;
 	}
 
+	tcp_conn_ts_process(conn, seg);
+
+	/* Segment with data arriving out of order */
+	ooo = seg->len > 0 && !seq_no_segment_ready(conn, seg);
+	if (ooo)
+		conn->sack_recent = seg->seq;
+
 	/* Queue for processing */
 	tcp_iqueue_insert_seg(&conn->incoming, seg);
 
@@ -684,6 +1151,14 @@ static void tcp_conn_sa_queue(tcp_conn_t *conn, tcp_segment_t *seg)
 	 */
 	while (tcp_iqueue_get_ready_seg(&conn->incoming, &pseg) == EOK)
 		tcp_conn_seg_process(conn, pseg);
+
+	/*
+	 * Acknowledge out-of-order segment immediately so that the sender
+	 * can detect the loss (RFC 5681 section 4.2). The ACK reports
+	 * the data we hold in SACK blocks.
+	 */
+	if (ooo)
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
 }
 
 /** Process segment RST field.
@@ -802,6 +1277,24 @@ static cproc_t tcp_conn_seg_proc_ack_sr(tcp_conn_t *conn, tcp_segment_t *seg)
 	return cp_continue;
 }
 
+/** Determine if segment is a duplicate acknowledgement.
+ *
+ * A duplicate ACK (RFC 5681 section 2) acknowledges SND.UNA while
+ * data is outstanding, carries no data, SYN or FIN and does not
+ * change the window.
+ *
+ * @param conn		Connection
+ * @param seg		Segment
+ * @return		@c true if @a seg is a duplicate ACK
+ */
+static bool tcp_conn_seg_dupack(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	return seg->ack == conn->snd_una && conn->snd_nxt != conn->snd_una &&
+	    tcp_segment_text_size(seg) == 0 &&
+	    (seg->ctrl & (CTL_SYN | CTL_FIN)) == 0 &&
+	    (seg->wnd << conn->snd_wscale) == conn->snd_wnd;
+}
+
 /** Process segment ACK field in Established state.
  *
  * @param conn		Connection
@@ -811,6 +1304,11 @@ static cproc_t tcp_conn_seg_proc_ack_sr(tcp_conn_t *conn, tcp_segment_t *seg)
  */
 static cproc_t tcp_conn_seg_proc_ack_est(tcp_conn_t *conn, tcp_segment_t *seg)
 {
+	struct timespec now;
+	bool dup = false;
+	bool dupack;
+	bool sacked;
+
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_conn_seg_proc_ack_est(%p, %p)", conn, seg);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "SEG.ACK=%u, SND.UNA=%u, SND.NXT=%u",
@@ -827,15 +1325,37 @@ static cproc_t tcp_conn_seg_proc_ack_est(tcp_conn_t *conn, tcp_segment_t *seg)
 			tcp_segment_delete(seg);
 			return cp_done;
 		} else {
-			log_msg(LOG_DEFAULT, LVL_DEBUG, "Ignoring duplicate ACK.");
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "Duplicate ACK.");
+			dup = true;
 		}
 	} else {
+		/* End round-trip time measurement (Karn's algorithm) */
+		if (conn->rtt_active &&
+		    (int32_t) (seg->ack - conn->rtt_seq) >= 0) {
+			conn->rtt_active = false;
+			getuptime(&now);
+			tcp_conn_rtt_sample(conn,
+			    NSEC2USEC(ts_sub_diff(&now, &conn->rtt_time)));
+		}
+
+		conn->dupacks = 0;
+
 		/* Update SND.UNA */
 		conn->snd_una = seg->ack;
 	}
 
+	/*
+	 * Note data the peer has received out of order. An ACK reporting
+	 * new SACKed data counts as a duplicate even if it updates the
+	 * window (RFC 6675 section 2).
+	 */
+	dupack = dup && tcp_conn_seg_dupack(conn, seg);
+	sacked = tcp_tqueue_sack_received(conn, seg);
+	if (dup && sacked && seg->ack == conn->snd_una)
+		dupack = true;
+
 	if (seq_no_new_wnd_update(conn, seg)) {
-		conn->snd_wnd = seg->wnd;
+		conn->snd_wnd = seg->wnd << conn->snd_wscale;
 		conn->snd_wl1 = seg->seq;
 		conn->snd_wl2 = seg->ack;
 
@@ -845,10 +1365,13 @@ static cproc_t tcp_conn_seg_proc_ack_est(tcp_conn_t *conn, tcp_segment_t *seg)
 	}
 
 	/*
-	 * Prune acked segments from retransmission queue and
-	 * possibly transmit more data.
+	 * Prune acked segments from retransmission queue, perform
+	 * loss recovery and possibly transmit more data.
 	 */
-	tcp_tqueue_ack_received(conn);
+	if (dupack)
+		tcp_tqueue_dupack_received(conn);
+	else
+		tcp_tqueue_ack_received(conn);
 
 	return cp_continue;
 }
@@ -1013,6 +1536,52 @@ static cproc_t tcp_conn_seg_proc_urg(tcp_conn_t *conn, tcp_segment_t *seg)
 	return cp_continue;
 }
 
+/** Advance RCV.NXT over received text and acknowledge it.
+ *
+ * A segment merged from several received segments is acknowledged as
+ * if they were processed one by one with an ACK for every second one
+ * (and the last one). The sender's window then grows the same as if
+ * the segments were not merged. Segment boundaries are estimated by
+ * dividing the text evenly.
+ *
+ * @param conn		Connection
+ * @param seg		Segment
+ * @param xfer_size	Number of bytes from the start of segment text
+ *			copied to the receive buffer
+ */
+static void tcp_conn_ack_text(tcp_conn_t *conn, tcp_segment_t *seg,
+    size_t xfer_size)
+{
+	size_t text_size;
+	size_t nsegs;
+	size_t acked;
+	size_t bound;
+	size_t i;
+
+	text_size = tcp_segment_text_size(seg);
+	nsegs = max(seg->gro_segs, 1);
+	acked = 0;
+
+	for (i = 2; acked < xfer_size; i += 2) {
+		if (i < nsegs)
+			bound = min(text_size * i / nsegs, xfer_size);
+		else
+			bound = xfer_size;
+
+		if (bound <= acked)
+			continue;
+
+		/* Advance RCV.NXT */
+		conn->rcv_nxt += bound - acked;
+
+		/* Update receive window. XXX Not an efficient strategy. */
+		conn->rcv_wnd -= bound - acked;
+
+		acked = bound;
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+	}
+}
+
 /** Process segment text.
  *
  * @param conn		Connection
@@ -1060,9 +1629,7 @@ static cproc_t tcp_conn_seg_proc_text(tcp_conn_t *conn, tcp_segment_t *seg)
 	xfer_size = min(text_size, conn->rcv_buf_size - conn->rcv_buf_used);
 
 	/* Copy data to receive buffer */
-	tcp_segment_text_copy(seg, conn->rcv_buf + conn->rcv_buf_used,
-	    xfer_size);
-	conn->rcv_buf_used += xfer_size;
+	tcp_conn_rcv_buf_put(conn, seg->data, xfer_size);
 
 	/* Signal to the receive function that new data has arrived */
 	if (xfer_size > 0) {
@@ -1073,15 +1640,8 @@ static cproc_t tcp_conn_seg_proc_text(tcp_conn_t *conn, tcp_segment_t *seg)
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "Received %zu bytes of data.", xfer_size);
 
-	/* Advance RCV.NXT */
-	conn->rcv_nxt += xfer_size;
-
-	/* Update receive window. XXX Not an efficient strategy. */
-	conn->rcv_wnd -= xfer_size;
-
-	/* Send ACK */
-	if (xfer_size > 0)
-		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+	/* Advance RCV.NXT, update receive window and send ACK(s) */
+	tcp_conn_ack_text(conn, seg, xfer_size);
 
 	if (xfer_size < seg->len) {
 		/* Trim part of segment which we just received */
@@ -1409,11 +1969,16 @@ static void tcp_transmit_segment(inet_ep2_t *epp, tcp_segment_t *seg)
 
 	tcp_segment_dump(seg);
 
+	if (tcp_conn_lb == tcp_lb_ncsim) {
+		/* Loop back segment through network condition simulator */
+		dseg = tcp_segment_dup(seg);
+		if (dseg != NULL)
+			tcp_ncsim_bounce_seg(epp, dseg);
+		return;
+	}
+
 	if (tcp_conn_lb == tcp_lb_segment) {
 		/* Loop back segment */
-#if 0
-		tcp_ncsim_bounce_seg(sp, seg);
-#endif
 
 		/* Reverse the identification */
 		tcp_ep2_flipped(epp, &rident);
@@ -57,8 +57,16 @@ extern void tcp_conn_segment_arrived(tcp_conn_t *, inet_ep2_t *,
     tcp_segment_t *);
 extern void tcp_unexpected_segment(inet_ep2_t *, tcp_segment_t *);
 extern void tcp_ep2_flipped(inet_ep2_t *, inet_ep2_t *);
+extern size_t tcp_conn_snd_buf_put(tcp_conn_t *, const void *, size_t);
+extern void tcp_conn_snd_buf_get(tcp_conn_t *, void *, size_t);
+extern size_t tcp_conn_rcv_buf_get(tcp_conn_t *, void *, size_t);
+extern void tcp_conn_rcv_buf_tune(tcp_conn_t *);
+extern void tcp_conn_snd_buf_tune(tcp_conn_t *);
+extern uint32_t tcp_conn_ts_now(void);
+extern void tcp_conn_rto_backoff(tcp_conn_t *);
 
 extern tcp_lb_t tcp_conn_lb;
+extern tcp_bufcfg_t tcp_conn_bufcfg;
 
 #endif
 
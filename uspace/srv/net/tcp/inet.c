@@ -43,6 +43,7 @@
 #include <stdlib.h>
 
 #include "inet.h"
+#include "ncsim.h"
 #include "pdu.h"
 #include "rqueue.h"
 #include "std.h"
@@ -164,8 +165,11 @@ static void tcp_received_pdu(tcp_pdu_t *pdu)
 		return;
 	}
 
-	/* Insert decoded segment into rqueue */
-	tcp_rqueue_insert_seg(&rident, dseg);
+	/* Insert decoded segment into rqueue, possibly via the simulator */
+	if (tcp_ncsim_active())
+		tcp_ncsim_insert_seg(&rident, dseg);
+	else
+		tcp_rqueue_insert_seg(&rident, dseg);
 }
 
 /** Initialize TCP inet interface. */
@@ -186,6 +186,85 @@ errno_t tcp_iqueue_get_ready_seg(tcp_iqueue_t *iqueue, tcp_segment_t **seg)
 	return EOK;
 }
 
+/** Add SACK block to list of blocks to report.
+ *
+ * The block containing the most recently received segment goes first
+ * (RFC 2018 section 4), the other blocks follow in order of sequence
+ * number as long as there is room.
+ *
+ * @param blk		Block to add
+ * @param recent	Start of most recently received out-of-order segment
+ * @param blocks	Array of blocks
+ * @param cnt		Number of blocks in @a blocks, updated
+ * @param max		Size of @a blocks
+ */
+static void tcp_iqueue_sack_add(tcp_sack_block_t *blk, uint32_t recent,
+    tcp_sack_block_t *blocks, unsigned *cnt, unsigned max)
+{
+	unsigned i;
+
+	if ((int32_t) (recent - blk->start) >= 0 &&
+	    (int32_t) (recent - blk->end) < 0) {
+		/* Shift other blocks, possibly dropping the last one */
+		if (*cnt < max)
+			++*cnt;
+		for (i = *cnt - 1; i > 0; i--)
+			blocks[i] = blocks[i - 1];
+		blocks[0] = *blk;
+	} else if (*cnt < max) {
+		blocks[(*cnt)++] = *blk;
+	}
+}
+
+/** Compute SACK blocks describing out-of-order data in incoming queue.
+ *
+ * @param iqueue	Incoming queue
+ * @param recent	Start of most recently received out-of-order segment
+ * @param blocks	Array to fill in
+ * @param max		Maximum number of blocks to return
+ * @return		Number of blocks stored in @a blocks
+ */
+unsigned tcp_iqueue_sack_blocks(tcp_iqueue_t *iqueue, uint32_t recent,
+    tcp_sack_block_t *blocks, unsigned max)
+{
+	tcp_sack_block_t blk;
+	bool have_blk;
+	uint32_t start;
+	uint32_t end;
+	unsigned cnt;
+
+	cnt = 0;
+	have_blk = false;
+
+	list_foreach(iqueue->list, link, tcp_iqueue_entry_t, iqe) {
+		start = iqe->seg->seq;
+		end = iqe->seg->seq + iqe->seg->len;
+
+		/* Only data beyond RCV.NXT can be selectively acknowledged */
+		if ((int32_t) (start - iqueue->conn->rcv_nxt) <= 0)
+			continue;
+
+		if (have_blk && (int32_t) (start - blk.end) <= 0) {
+			/* Contiguous with or overlapping current block */
+			if ((int32_t) (end - blk.end) > 0)
+				blk.end = end;
+			continue;
+		}
+
+		if (have_blk)
+			tcp_iqueue_sack_add(&blk, recent, blocks, &cnt, max);
+
+		blk.start = start;
+		blk.end = end;
+		have_blk = true;
+	}
+
+	if (have_blk)
+		tcp_iqueue_sack_add(&blk, recent, blocks, &cnt, max);
+
+	return cnt;
+}
+
 /**
  * @}
  */
@@ -33,7 +33,8 @@
 /**
  * @file Network condition simulator
  *
- * Simulate network conditions for testing the reliability implementation:
+ * Simulate network conditions for testing the reliability implementation
+ * and for measuring performance over long fat networks:
  *    - variable latency
  *    - frame drop
  */
@@ -45,6 +46,7 @@
 #include <io/log.h>
 #include <stdlib.h>
 #include <fibril.h>
+#include <time.h>
 #include "conn.h"
 #include "ncsim.h"
 #include "rqueue.h"
@@ -54,108 +56,200 @@
 static list_t sim_queue;
 static fibril_mutex_t sim_queue_lock;
 static fibril_condvar_t sim_queue_cv;
+static tcp_ncsim_cfg_t sim_cfg;
+static bool sim_fibril_active;
+static bool sim_quit;
 
-/** Initialize segment receive queue. */
+/** Initialize network condition simulator. */
 void tcp_ncsim_init(void)
 {
 	list_initialize(&sim_queue);
 	fibril_mutex_initialize(&sim_queue_lock);
 	fibril_condvar_initialize(&sim_queue_cv);
+	sim_cfg.delay = 0;
+	sim_cfg.jitter = 0;
+	sim_cfg.drop_pm = 0;
+	sim_fibril_active = false;
+	sim_quit = false;
 }
 
-/** Bounce segment through simulator into receive queue.
+/** Finalize network condition simulator.
  *
- * @param epp	Endpoint pair, oriented for transmission
- * @param seg	Segment
+ * Stop the simulator fibril and discard all segments in flight.
  */
-void tcp_ncsim_bounce_seg(inet_ep2_t *epp, tcp_segment_t *seg)
+void tcp_ncsim_fini(void)
+{
+	tcp_squeue_entry_t *sqe;
+	link_t *link;
+
+	fibril_mutex_lock(&sim_queue_lock);
+	sim_quit = true;
+	fibril_condvar_broadcast(&sim_queue_cv);
+
+	while (sim_fibril_active)
+		fibril_condvar_wait(&sim_queue_cv, &sim_queue_lock);
+
+	while ((link = list_first(&sim_queue)) != NULL) {
+		sqe = list_get_instance(link, tcp_squeue_entry_t, link);
+		list_remove(link);
+		tcp_segment_delete(sqe->seg);
+		free(sqe);
+	}
+
+	fibril_mutex_unlock(&sim_queue_lock);
+}
+
+/** Set network condition simulator configuration.
+ *
+ * @param cfg	Configuration
+ */
+void tcp_ncsim_set_cfg(tcp_ncsim_cfg_t *cfg)
+{
+	fibril_mutex_lock(&sim_queue_lock);
+	sim_cfg = *cfg;
+	fibril_mutex_unlock(&sim_queue_lock);
+}
+
+/** Determine if the simulator alters segment delivery.
+ *
+ * @return @c true if segments are delayed or dropped
+ */
+bool tcp_ncsim_active(void)
+{
+	bool active;
+
+	fibril_mutex_lock(&sim_queue_lock);
+	active = sim_cfg.delay != 0 || sim_cfg.jitter != 0 ||
+	    sim_cfg.drop_pm != 0;
+	fibril_mutex_unlock(&sim_queue_lock);
+
+	return active;
+}
+
+/** Insert segment into simulator.
+ *
+ * The segment is delivered to the receive queue once its simulated
+ * delay elapses, or it is dropped.
+ *
+ * @param epp	Endpoint pair, oriented for reception
+ * @param seg	Segment (ownership transferred)
+ */
+void tcp_ncsim_insert_seg(inet_ep2_t *epp, tcp_segment_t *seg)
 {
 	tcp_squeue_entry_t *sqe;
 	tcp_squeue_entry_t *old_qe;
-	inet_ep2_t rident;
 	link_t *link;
+	usec_t delay;
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_ncsim_bounce_seg()");
-	tcp_ep2_flipped(epp, &rident);
-	tcp_rqueue_insert_seg(&rident, seg);
-	return;
+	log_msg(LOG_DEFAULT, LVL_DEBUG2, "tcp_ncsim_insert_seg()");
 
-	if (0 /* rand() % 4 == 3 */) {
+	fibril_mutex_lock(&sim_queue_lock);
+
+	if (sim_cfg.drop_pm != 0 &&
+	    (unsigned) (rand() % 1000) < sim_cfg.drop_pm) {
 		/* Drop segment */
-		log_msg(LOG_DEFAULT, LVL_ERROR, "NCSim dropping segment");
+		fibril_mutex_unlock(&sim_queue_lock);
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "NCSim dropping segment");
 		tcp_segment_delete(seg);
 		return;
 	}
 
 	sqe = calloc(1, sizeof(tcp_squeue_entry_t));
 	if (sqe == NULL) {
+		fibril_mutex_unlock(&sim_queue_lock);
 		log_msg(LOG_DEFAULT, LVL_ERROR, "Failed allocating SQE.");
+		tcp_segment_delete(seg);
 		return;
 	}
 
-	sqe->delay = rand() % (1000 * 1000);
+	delay = sim_cfg.delay;
+	if (sim_cfg.jitter != 0)
+		delay += rand() % sim_cfg.jitter;
+
+	getuptime(&sqe->due);
+	ts_add_diff(&sqe->due, USEC2NSEC(delay));
 	sqe->epp = *epp;
 	sqe->seg = seg;
 
-	fibril_mutex_lock(&sim_queue_lock);
-
-	link = list_first(&sim_queue);
-	while (link != NULL && sqe->delay > 0) {
+	/*
+	 * Keep the queue sorted by delivery time. Segments with the same
+	 * delivery time are kept in FIFO order.
+	 */
+	link = list_last(&sim_queue);
+	while (link != NULL) {
 		old_qe = list_get_instance(link, tcp_squeue_entry_t, link);
-		if (sqe->delay < old_qe->delay)
+		if (ts_gteq(&sqe->due, &old_qe->due))
 			break;
 
-		sqe->delay -= old_qe->delay;
-
-		link = link->next;
-		if (link == &sim_queue.head)
-			link = NULL;
+		link = list_prev(link, &sim_queue);
 	}
 
 	if (link != NULL)
 		list_insert_after(&sqe->link, link);
 	else
-		list_append(&sqe->link, &sim_queue);
+		list_prepend(&sqe->link, &sim_queue);
 
 	fibril_condvar_broadcast(&sim_queue_cv);
 	fibril_mutex_unlock(&sim_queue_lock);
 }
 
+/** Bounce segment through simulator into receive queue.
+ *
+ * @param epp	Endpoint pair, oriented for transmission
+ * @param seg	Segment (ownership transferred)
+ */
+void tcp_ncsim_bounce_seg(inet_ep2_t *epp, tcp_segment_t *seg)
+{
+	inet_ep2_t rident;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG2, "tcp_ncsim_bounce_seg()");
+	tcp_ep2_flipped(epp, &rident);
+	tcp_ncsim_insert_seg(&rident, seg);
+}
+
 /** Network condition simulator handler fibril. */
 static errno_t tcp_ncsim_fibril(void *arg)
 {
 	link_t *link;
 	tcp_squeue_entry_t *sqe;
-	inet_ep2_t rident;
-	errno_t rc;
+	struct timespec now;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_ncsim_fibril()");
 
-	while (true) {
-		fibril_mutex_lock(&sim_queue_lock);
+	fibril_mutex_lock(&sim_queue_lock);
 
-		while (list_empty(&sim_queue))
+	while (!sim_quit) {
+		link = list_first(&sim_queue);
+		if (link == NULL) {
 			fibril_condvar_wait(&sim_queue_cv, &sim_queue_lock);
+			continue;
+		}
 
-		do {
-			link = list_first(&sim_queue);
-			sqe = list_get_instance(link, tcp_squeue_entry_t, link);
+		sqe = list_get_instance(link, tcp_squeue_entry_t, link);
 
-			log_msg(LOG_DEFAULT, LVL_DEBUG, "NCSim - Sleep");
-			rc = fibril_condvar_wait_timeout(&sim_queue_cv,
-			    &sim_queue_lock, sqe->delay);
-		} while (rc != ETIMEOUT);
+		getuptime(&now);
+		if (!ts_gteq(&now, &sqe->due)) {
+			/* Sleep until due time or until the queue changes */
+			(void) fibril_condvar_wait_timeout(&sim_queue_cv,
+			    &sim_queue_lock,
+			    NSEC2USEC(ts_sub_diff(&sqe->due, &now)) + 1);
+			continue;
+		}
 
 		list_remove(link);
 		fibril_mutex_unlock(&sim_queue_lock);
 
-		log_msg(LOG_DEFAULT, LVL_DEBUG, "NCSim - End Sleep");
-		tcp_ep2_flipped(&sqe->epp, &rident);
-		tcp_rqueue_insert_seg(&rident, sqe->seg);
+		tcp_rqueue_insert_seg(&sqe->epp, sqe->seg);
 		free(sqe);
+
+		fibril_mutex_lock(&sim_queue_lock);
 	}
 
-	/* Not reached */
+	sim_fibril_active = false;
+	fibril_condvar_broadcast(&sim_queue_cv);
+	fibril_mutex_unlock(&sim_queue_lock);
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG2, "tcp_ncsim_fibril() exiting");
 	return 0;
 }
 
@@ -172,6 +266,8 @@ void tcp_ncsim_fibril_start(void)
 		return;
 	}
 
+	sim_quit = false;
+	sim_fibril_active = true;
 	fibril_add_ready(fid);
 }
 
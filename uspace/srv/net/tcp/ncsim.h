@@ -36,9 +36,14 @@
 #define NCSIM_H
 
 #include <inet/endpoint.h>
+#include <stdbool.h>
 #include "tcp_type.h"
 
 extern void tcp_ncsim_init(void);
+extern void tcp_ncsim_fini(void);
+extern void tcp_ncsim_set_cfg(tcp_ncsim_cfg_t *);
+extern bool tcp_ncsim_active(void);
+extern void tcp_ncsim_insert_seg(inet_ep2_t *, tcp_segment_t *);
 extern void tcp_ncsim_bounce_seg(inet_ep2_t *, tcp_segment_t *);
 extern void tcp_ncsim_fibril_start(void);
 
@@ -37,6 +37,7 @@
 #include <bitops.h>
 #include <byteorder.h>
 #include <errno.h>
+#include <inet/checksum.h>
 #include <inet/endpoint.h>
 #include <mem.h>
 #include <stdlib.h>
@@ -46,44 +47,6 @@
 #include "std.h"
 #include "tcp_type.h"
 
-#define TCP_CHECKSUM_INIT 0xffff
-
-/** One's complement addition.
- *
- * Result is a + b + carry.
- */
-static uint16_t tcp_ocadd16(uint16_t a, uint16_t b)
-{
-	uint32_t s;
-
-	s = (uint32_t)a + (uint32_t)b;
-	return (s & 0xffff) + (s >> 16);
-}
-
-static uint16_t tcp_checksum_calc(uint16_t ivalue, void *data, size_t size)
-{
-	uint16_t sum;
-	uint16_t w;
-	size_t words, i;
-	uint8_t *bdata;
-
-	sum = ~ivalue;
-	words = size / 2;
-	bdata = (uint8_t *)data;
-
-	for (i = 0; i < words; i++) {
-		w = ((uint16_t)bdata[2 * i] << 8) | bdata[2 * i + 1];
-		sum = tcp_ocadd16(sum, w);
-	}
-
-	if (size % 2 != 0) {
-		w = ((uint16_t)bdata[2 * words] << 8);
-		sum = tcp_ocadd16(sum, w);
-	}
-
-	return ~sum;
-}
-
 static void tcp_header_decode_flags(uint16_t doff_flags, tcp_control_t *rctl)
 {
 	tcp_control_t ctl;
@@ -125,7 +88,192 @@ static void tcp_header_encode_flags(tcp_control_t ctl, uint16_t doff_flags0,
 	*rdoff_flags = doff_flags;
 }
 
-static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg, tcp_header_t *hdr)
+/** Compute size of encoded segment options.
+ *
+ * @param seg	Segment
+ * @return	Size of options in bytes (multiple of four)
+ */
+static size_t tcp_opts_size(tcp_segment_t *seg)
+{
+	size_t size;
+
+	size = 0;
+	if ((seg->opts & SOPT_MSS) != 0)
+		size += OPT_MAX_SEG_SIZE_LEN;
+	if ((seg->opts & SOPT_WSCALE) != 0)
+		size += 1 + OPT_WINDOW_SCALE_LEN;
+	if ((seg->opts & SOPT_TS) != 0)
+		size += 2 + OPT_TIMESTAMP_LEN;
+	if ((seg->opts & SOPT_SACK_PERM) != 0)
+		size += 2 + OPT_SACK_PERMITTED_LEN;
+	if ((seg->opts & SOPT_SACK) != 0)
+		size += 2 + OPT_SACK_LEN + seg->sack_cnt * OPT_SACK_BLOCK_LEN;
+
+	assert(size % sizeof(uint32_t) == 0);
+	assert(size <= TCP_OPTS_MAX_SIZE);
+	return size;
+}
+
+/** Encode segment options.
+ *
+ * Options are laid out as recommended by RFC 7323 Appendix A, with
+ * NOPs padding the window scale, timestamp and SACK options to 32-bit
+ * boundaries.
+ *
+ * @param seg	Segment
+ * @param opts	Place to store encoded options (tcp_opts_size() bytes)
+ */
+static void tcp_opts_encode(tcp_segment_t *seg, uint8_t *opts)
+{
+	uint16_t mss;
+	uint32_t ts;
+	uint32_t sn;
+	unsigned i;
+
+	if ((seg->opts & SOPT_MSS) != 0) {
+		mss = host2uint16_t_be(seg->mss);
+		*opts++ = OPT_MAX_SEG_SIZE;
+		*opts++ = OPT_MAX_SEG_SIZE_LEN;
+		memcpy(opts, &mss, sizeof(uint16_t));
+		opts += sizeof(uint16_t);
+	}
+
+	if ((seg->opts & SOPT_WSCALE) != 0) {
+		*opts++ = OPT_NOP;
+		*opts++ = OPT_WINDOW_SCALE;
+		*opts++ = OPT_WINDOW_SCALE_LEN;
+		*opts++ = seg->wscale;
+	}
+
+	if ((seg->opts & SOPT_TS) != 0) {
+		*opts++ = OPT_NOP;
+		*opts++ = OPT_NOP;
+		*opts++ = OPT_TIMESTAMP;
+		*opts++ = OPT_TIMESTAMP_LEN;
+		ts = host2uint32_t_be(seg->tsval);
+		memcpy(opts, &ts, sizeof(uint32_t));
+		opts += sizeof(uint32_t);
+		ts = host2uint32_t_be(seg->tsecr);
+		memcpy(opts, &ts, sizeof(uint32_t));
+		opts += sizeof(uint32_t);
+	}
+
+	if ((seg->opts & SOPT_SACK_PERM) != 0) {
+		*opts++ = OPT_NOP;
+		*opts++ = OPT_NOP;
+		*opts++ = OPT_SACK_PERMITTED;
+		*opts++ = OPT_SACK_PERMITTED_LEN;
+	}
+
+	if ((seg->opts & SOPT_SACK) != 0) {
+		*opts++ = OPT_NOP;
+		*opts++ = OPT_NOP;
+		*opts++ = OPT_SACK;
+		*opts++ = OPT_SACK_LEN + seg->sack_cnt * OPT_SACK_BLOCK_LEN;
+		for (i = 0; i < seg->sack_cnt; i++) {
+			sn = host2uint32_t_be(seg->sack[i].start);
+			memcpy(opts, &sn, sizeof(uint32_t));
+			opts += sizeof(uint32_t);
+			sn = host2uint32_t_be(seg->sack[i].end);
+			memcpy(opts, &sn, sizeof(uint32_t));
+			opts += sizeof(uint32_t);
+		}
+	}
+}
+
+/** Decode segment options.
+ *
+ * Unknown options are skipped, malformed option lists are truncated.
+ *
+ * @param opts	Encoded options
+ * @param size	Size of encoded options in bytes
+ * @param seg	Segment to fill in
+ */
+static void tcp_opts_decode(uint8_t *opts, size_t size, tcp_segment_t *seg)
+{
+	uint8_t kind;
+	uint8_t len;
+	uint16_t mss;
+	uint32_t ts;
+	uint32_t sn;
+	unsigned i;
+
+	seg->opts = 0;
+
+	while (size > 0) {
+		kind = opts[0];
+		if (kind == OPT_END_LIST)
+			break;
+
+		if (kind == OPT_NOP) {
+			++opts;
+			--size;
+			continue;
+		}
+
+		if (size < 2)
+			break;
+
+		len = opts[1];
+		if (len < 2 || len > size)
+			break;
+
+		switch (kind) {
+		case OPT_MAX_SEG_SIZE:
+			if (len != OPT_MAX_SEG_SIZE_LEN)
+				break;
+			memcpy(&mss, opts + 2, sizeof(uint16_t));
+			seg->mss = uint16_t_be2host(mss);
+			seg->opts |= SOPT_MSS;
+			break;
+		case OPT_WINDOW_SCALE:
+			if (len != OPT_WINDOW_SCALE_LEN)
+				break;
+			seg->wscale = opts[2];
+			seg->opts |= SOPT_WSCALE;
+			break;
+		case OPT_TIMESTAMP:
+			if (len != OPT_TIMESTAMP_LEN)
+				break;
+			memcpy(&ts, opts + 2, sizeof(uint32_t));
+			seg->tsval = uint32_t_be2host(ts);
+			memcpy(&ts, opts + 6, sizeof(uint32_t));
+			seg->tsecr = uint32_t_be2host(ts);
+			seg->opts |= SOPT_TS;
+			break;
+		case OPT_SACK_PERMITTED:
+			if (len != OPT_SACK_PERMITTED_LEN)
+				break;
+			seg->opts |= SOPT_SACK_PERM;
+			break;
+		case OPT_SACK:
+			if ((len - OPT_SACK_LEN) % OPT_SACK_BLOCK_LEN != 0 ||
+			    len == OPT_SACK_LEN ||
+			    (len - OPT_SACK_LEN) / OPT_SACK_BLOCK_LEN >
+			    TCP_SACK_BLOCKS_MAX)
+				break;
+			seg->sack_cnt = (len - OPT_SACK_LEN) / OPT_SACK_BLOCK_LEN;
+			for (i = 0; i < seg->sack_cnt; i++) {
+				memcpy(&sn, opts + OPT_SACK_LEN +
+				    i * OPT_SACK_BLOCK_LEN, sizeof(uint32_t));
+				seg->sack[i].start = uint32_t_be2host(sn);
+				memcpy(&sn, opts + OPT_SACK_LEN +
+				    i * OPT_SACK_BLOCK_LEN + 4, sizeof(uint32_t));
+				seg->sack[i].end = uint32_t_be2host(sn);
+			}
+			seg->opts |= SOPT_SACK;
+			break;
+		default:
+			break;
+		}
+
+		opts += len;
+		size -= len;
+	}
+}
+
+static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg,
+    tcp_header_t *hdr, size_t hdr_size)
 {
 	uint16_t doff_flags;
 	uint16_t doff;
@@ -135,7 +283,7 @@ static void tcp_header_setup(inet_ep2_t *epp, tcp_segment_t *seg, tcp_header_t *
 	hdr->seq = host2uint32_t_be(seg->seq);
 	hdr->ack = host2uint32_t_be(seg->ack);
 
-	doff = (sizeof(tcp_header_t) / sizeof(uint32_t)) << DF_DATA_OFFSET_l;
+	doff = (hdr_size / sizeof(uint32_t)) << DF_DATA_OFFSET_l;
 	tcp_header_encode_flags(seg->ctrl, doff, &doff_flags);
 
 	hdr->doff_flags = host2uint16_t_be(doff_flags);
@@ -181,27 +329,35 @@ static ip_ver_t tcp_phdr_setup(tcp_pdu_t *pdu, tcp_phdr_t *phdr,
 	return src_ver;
 }
 
-static void tcp_header_decode(tcp_header_t *hdr, tcp_segment_t *seg)
+static void tcp_header_decode(tcp_header_t *hdr, size_t hdr_size,
+    tcp_segment_t *seg)
 {
 	tcp_header_decode_flags(uint16_t_be2host(hdr->doff_flags), &seg->ctrl);
 	seg->seq = uint32_t_be2host(hdr->seq);
 	seg->ack = uint32_t_be2host(hdr->ack);
 	seg->wnd = uint16_t_be2host(hdr->window);
 	seg->up = uint16_t_be2host(hdr->urg_ptr);
+
+	tcp_opts_decode((uint8_t *)hdr + sizeof(tcp_header_t),
+	    hdr_size - sizeof(tcp_header_t), seg);
 }
 
 static errno_t tcp_header_encode(inet_ep2_t *epp, tcp_segment_t *seg,
     void **header, size_t *size)
 {
 	tcp_header_t *hdr;
+	size_t hdr_size;
+
+	hdr_size = sizeof(tcp_header_t) + tcp_opts_size(seg);
 
-	hdr = calloc(1, sizeof(tcp_header_t));
+	hdr = calloc(1, hdr_size);
 	if (hdr == NULL)
 		return ENOMEM;
 
-	tcp_header_setup(epp, seg, hdr);
+	tcp_header_setup(epp, seg, hdr, hdr_size);
+	tcp_opts_encode(seg, (uint8_t *)hdr + sizeof(tcp_header_t));
 	*header = hdr;
-	*size = sizeof(tcp_header_t);
+	*size = hdr_size;
 
 	return EOK;
 }
@@ -260,29 +416,33 @@ void tcp_pdu_delete(tcp_pdu_t *pdu)
 	free(pdu);
 }
 
-static uint16_t tcp_pdu_checksum_calc(tcp_pdu_t *pdu)
+/** Compute checksum of TCP pseudo-header and header.
+ *
+ * @param pdu PDU
+ * @return Checksum to be used as initial value for computing
+ *         checksum of the text
+ */
+static uint16_t tcp_pdu_hdr_checksum_calc(tcp_pdu_t *pdu)
 {
 	uint16_t cs_phdr;
-	uint16_t cs_headers;
 	tcp_phdr_t phdr;
 	tcp_phdr6_t phdr6;
 
 	ip_ver_t ver = tcp_phdr_setup(pdu, &phdr, &phdr6);
 	switch (ver) {
 	case ip_v4:
-		cs_phdr = tcp_checksum_calc(TCP_CHECKSUM_INIT, (void *) &phdr,
+		cs_phdr = inet_checksum_calc(INET_CHECKSUM_INIT, &phdr,
 		    sizeof(tcp_phdr_t));
 		break;
 	case ip_v6:
-		cs_phdr = tcp_checksum_calc(TCP_CHECKSUM_INIT, (void *) &phdr6,
+		cs_phdr = inet_checksum_calc(INET_CHECKSUM_INIT, &phdr6,
 		    sizeof(tcp_phdr6_t));
 		break;
 	default:
 		assert(false);
 	}
 
-	cs_headers = tcp_checksum_calc(cs_phdr, pdu->header, pdu->header_size);
-	return tcp_checksum_calc(cs_headers, pdu->text, pdu->text_size);
+	return inet_checksum_calc(cs_phdr, pdu->header, pdu->header_size);
 }
 
 static void tcp_pdu_set_checksum(tcp_pdu_t *pdu, uint16_t checksum)
@@ -303,7 +463,8 @@ errno_t tcp_pdu_decode(tcp_pdu_t *pdu, inet_ep2_t *epp, tcp_segment_t **seg)
 	if (nseg == NULL)
 		return ENOMEM;
 
-	tcp_header_decode(pdu->header, nseg);
+	assert(pdu->header_size >= sizeof(tcp_header_t));
+	tcp_header_decode(pdu->header, pdu->header_size, nseg);
 	nseg->len += seq_no_control_len(nseg->ctrl);
 
 	hdr = (tcp_header_t *)pdu->header;
@@ -346,10 +507,11 @@ errno_t tcp_pdu_encode(inet_ep2_t *epp, tcp_segment_t *seg, tcp_pdu_t **pdu)
 	}
 
 	npdu->text_size = text_size;
-	memcpy(npdu->text, seg->data, text_size);
 
-	/* Checksum calculation */
-	checksum = tcp_pdu_checksum_calc(npdu);
+	/* Copy text while computing checksum */
+	checksum = tcp_pdu_hdr_checksum_calc(npdu);
+	checksum = inet_checksum_copy(checksum, npdu->text, seg->data,
+	    text_size);
 	tcp_pdu_set_checksum(npdu, checksum);
 
 	*pdu = npdu;
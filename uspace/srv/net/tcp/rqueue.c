@@ -41,12 +41,18 @@
 #include <stdlib.h>
 #include <fibril.h>
 #include <fibril_synch.h>
+#include <inet/addr.h>
 #include "conn.h"
 #include "rqueue.h"
 #include "segment.h"
 #include "tcp_type.h"
 #include "ucall.h"
 
+/** Maximum number of received segments merged into one */
+#define TCP_GRO_MAX_SEGS	16
+/** Maximum text size of a merged segment */
+#define TCP_GRO_MAX_SIZE	65536
+
 static prodcons_t rqueue;
 static bool fibril_active;
 static fibril_mutex_t lock;
@@ -103,6 +109,92 @@ void tcp_rqueue_insert_seg(inet_ep2_t *epp, tcp_segment_t *seg)
 	prodcons_produce(&rqueue, &rqe->link);
 }
 
+/** Determine if two endpoint pairs are the same.
+ *
+ * @param a	First endpoint pair
+ * @param b	Second endpoint pair
+ * @return	@c true if @a a and @a b are the same
+ */
+static bool tcp_rqueue_ep2_equal(inet_ep2_t *a, inet_ep2_t *b)
+{
+	return a->local_link == b->local_link &&
+	    a->local.port == b->local.port &&
+	    a->remote.port == b->remote.port &&
+	    inet_addr_compare(&a->local.addr, &b->local.addr) &&
+	    inet_addr_compare(&a->remote.addr, &b->remote.addr);
+}
+
+/** Deliver received segment.
+ *
+ * Data segments already waiting in the queue that continue the text
+ * of the segment on the same connection are merged with it and
+ * delivered as one segment. This way they are processed at once and
+ * the user is only notified once about the new data.
+ *
+ * @param rqe	Receive queue entry (freed)
+ * @return	Next queue entry that could not be merged or @c NULL
+ *		if there is none waiting
+ */
+static tcp_rqueue_entry_t *tcp_rqueue_deliver(tcp_rqueue_entry_t *rqe)
+{
+	tcp_rqueue_entry_t *ents[TCP_GRO_MAX_SEGS];
+	tcp_segment_t *segs[TCP_GRO_MAX_SEGS];
+	tcp_rqueue_entry_t *next;
+	tcp_segment_t *mseg;
+	link_t *link;
+	size_t size;
+	size_t cnt;
+	size_t i;
+
+	ents[0] = rqe;
+	segs[0] = rqe->seg;
+	cnt = 1;
+	size = tcp_segment_text_size(rqe->seg);
+	next = NULL;
+
+	while (cnt < TCP_GRO_MAX_SEGS) {
+		link = prodcons_try_consume(&rqueue);
+		if (link == NULL)
+			break;
+
+		next = list_get_instance(link, tcp_rqueue_entry_t, link);
+		if (next->seg == NULL ||
+		    !tcp_rqueue_ep2_equal(&rqe->epp, &next->epp) ||
+		    !tcp_segment_mergeable(segs[cnt - 1], next->seg) ||
+		    size + tcp_segment_text_size(next->seg) > TCP_GRO_MAX_SIZE)
+			break;
+
+		size += tcp_segment_text_size(next->seg);
+		ents[cnt] = next;
+		segs[cnt] = next->seg;
+		++cnt;
+		next = NULL;
+	}
+
+	mseg = NULL;
+	if (cnt > 1) {
+		mseg = tcp_segment_merge(segs, cnt);
+		if (mseg == NULL)
+			log_msg(LOG_DEFAULT, LVL_WARN, "Out of memory, not merging.");
+	}
+
+	if (mseg != NULL) {
+		log_msg(LOG_DEFAULT, LVL_DEBUG2, "Merged %zu segments.", cnt);
+		for (i = 0; i < cnt; i++)
+			tcp_segment_delete(segs[i]);
+
+		rqueue_cb->seg_received(&rqe->epp, mseg);
+	} else {
+		for (i = 0; i < cnt; i++)
+			rqueue_cb->seg_received(&ents[i]->epp, segs[i]);
+	}
+
+	for (i = 0; i < cnt; i++)
+		free(ents[i]);
+
+	return next;
+}
+
 /** Receive queue handler fibril. */
 static errno_t tcp_rqueue_fibril(void *arg)
 {
@@ -111,17 +203,19 @@ static errno_t tcp_rqueue_fibril(void *arg)
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "tcp_rqueue_fibril()");
 
+	rqe = NULL;
 	while (true) {
-		link = prodcons_consume(&rqueue);
-		rqe = list_get_instance(link, tcp_rqueue_entry_t, link);
+		if (rqe == NULL) {
+			link = prodcons_consume(&rqueue);
+			rqe = list_get_instance(link, tcp_rqueue_entry_t, link);
+		}
 
 		if (rqe->seg == NULL) {
 			free(rqe);
 			break;
 		}
 
-		rqueue_cb->seg_received(&rqe->epp, rqe->seg);
-		free(rqe);
+		rqe = tcp_rqueue_deliver(rqe);
 	}
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, "tcp_rqueue_fibril() exiting");
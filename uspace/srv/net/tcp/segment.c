@@ -69,11 +69,20 @@ tcp_segment_t *tcp_segment_dup(tcp_segment_t *seg)
 		return NULL;
 
 	scopy->ctrl = seg->ctrl;
+	scopy->opts = seg->opts;
 	scopy->seq = seg->seq;
 	scopy->ack = seg->ack;
 	scopy->len = seg->len;
 	scopy->wnd = seg->wnd;
 	scopy->up = seg->up;
+	scopy->mss = seg->mss;
+	scopy->wscale = seg->wscale;
+	scopy->tsval = seg->tsval;
+	scopy->tsecr = seg->tsecr;
+	scopy->sack_cnt = seg->sack_cnt;
+	memcpy(scopy->sack, seg->sack, sizeof(seg->sack));
+	scopy->gso_size = seg->gso_size;
+	scopy->gro_segs = seg->gro_segs;
 
 	tsize = tcp_segment_text_size(seg);
 	scopy->data = calloc(tsize, 1);
@@ -131,8 +140,12 @@ tcp_segment_t *tcp_segment_make_rst(tcp_segment_t *seg)
 	return rseg;
 }
 
-/** Create a control segment.
+/** Create a data segment.
  *
+ * @param ctrl	Control bits
+ * @param data	Data to copy to segment text or @c NULL to leave the text
+ *		uninitialized (for the caller to fill in)
+ * @param size	Size of segment text
  * @return	Segment
  */
 tcp_segment_t *tcp_segment_make_data(tcp_control_t ctrl, void *data,
@@ -153,7 +166,8 @@ tcp_segment_t *tcp_segment_make_data(tcp_control_t ctrl, void *data,
 		return NULL;
 	}
 
-	memcpy(seg->data, data, size);
+	if (data != NULL)
+		memcpy(seg->data, data, size);
 
 	return seg;
 }
@@ -215,6 +229,135 @@ void tcp_segment_trim(tcp_segment_t *seg, uint32_t left, uint32_t right)
 	}
 }
 
+/** Create segment from a part of segment text.
+ *
+ * Used to split a large segment into segments that fit the MSS. The new
+ * segment has the same header fields and options as @a seg. SYN is only
+ * kept in the first part and FIN only in the last part of the text.
+ *
+ * @param seg	Segment
+ * @param offs	Offset of the part into segment text
+ * @param size	Size of the part, must be non-zero
+ * @return	New segment or @c NULL if out of memory
+ */
+tcp_segment_t *tcp_segment_slice(tcp_segment_t *seg, size_t offs,
+    size_t size)
+{
+	tcp_segment_t *sseg;
+	tcp_control_t ctrl;
+	size_t tsize;
+
+	tsize = tcp_segment_text_size(seg);
+	assert(size > 0);
+	assert(offs + size <= tsize);
+
+	ctrl = seg->ctrl & ~(CTL_SYN | CTL_FIN);
+	if (offs == 0)
+		ctrl |= seg->ctrl & CTL_SYN;
+	if (offs + size == tsize)
+		ctrl |= seg->ctrl & CTL_FIN;
+
+	sseg = tcp_segment_make_data(ctrl, (uint8_t *) seg->data + offs, size);
+	if (sseg == NULL)
+		return NULL;
+
+	/* SYN takes up a sequence number before the text */
+	sseg->seq = seg->seq + offs;
+	if (offs > 0 && (seg->ctrl & CTL_SYN) != 0)
+		sseg->seq++;
+
+	sseg->opts = seg->opts;
+	sseg->ack = seg->ack;
+	sseg->wnd = seg->wnd;
+	sseg->up = seg->up;
+	sseg->mss = seg->mss;
+	sseg->wscale = seg->wscale;
+	sseg->tsval = seg->tsval;
+	sseg->tsecr = seg->tsecr;
+	sseg->sack_cnt = seg->sack_cnt;
+	memcpy(sseg->sack, seg->sack, sizeof(seg->sack));
+
+	return sseg;
+}
+
+/** Determine if a segment can be merged with the following one.
+ *
+ * Only plain in-sequence data segments with identical headers and
+ * options (apart from the sequence number) can be merged, so that
+ * processing the merged segment has the same effect as processing
+ * both of them.
+ *
+ * @param seg	Segment
+ * @param next	Segment received after @a seg
+ * @return	@c true if @a next can be appended to @a seg
+ */
+bool tcp_segment_mergeable(tcp_segment_t *seg, tcp_segment_t *next)
+{
+	if (seg->ctrl != CTL_ACK || next->ctrl != CTL_ACK)
+		return false;
+
+	if (seg->len == 0 || next->len == 0)
+		return false;
+
+	if (next->seq != seg->seq + seg->len)
+		return false;
+
+	if (next->ack != seg->ack || next->wnd != seg->wnd ||
+	    seg->up != 0 || next->up != 0)
+		return false;
+
+	/* Only timestamps can be carried by data segments we merge */
+	if (next->opts != seg->opts || (seg->opts & ~SOPT_TS) != 0)
+		return false;
+
+	if ((seg->opts & SOPT_TS) != 0 &&
+	    (next->tsval != seg->tsval || next->tsecr != seg->tsecr))
+		return false;
+
+	return true;
+}
+
+/** Merge consecutive segments into one.
+ *
+ * @param segs	Segments, each mergeable with the previous one
+ * @param cnt	Number of segments, at least one
+ * @return	New segment or @c NULL if out of memory
+ */
+tcp_segment_t *tcp_segment_merge(tcp_segment_t **segs, size_t cnt)
+{
+	tcp_segment_t *mseg;
+	uint8_t *dp;
+	size_t size;
+	size_t i;
+
+	assert(cnt > 0);
+
+	size = 0;
+	for (i = 0; i < cnt; i++)
+		size += tcp_segment_text_size(segs[i]);
+
+	mseg = tcp_segment_make_data(segs[0]->ctrl, NULL, size);
+	if (mseg == NULL)
+		return NULL;
+
+	mseg->opts = segs[0]->opts;
+	mseg->seq = segs[0]->seq;
+	mseg->ack = segs[0]->ack;
+	mseg->wnd = segs[0]->wnd;
+	mseg->tsval = segs[0]->tsval;
+	mseg->tsecr = segs[0]->tsecr;
+	mseg->gro_segs = cnt;
+
+	dp = mseg->data;
+	for (i = 0; i < cnt; i++) {
+		size = tcp_segment_text_size(segs[i]);
+		memcpy(dp, segs[i]->data, size);
+		dp += size;
+	}
+
+	return mseg;
+}
+
 /** Copy out text data from segment.
  *
  * Data is copied from the beginning of the segment text up to @a size bytes.
@@ -254,6 +397,7 @@ void tcp_segment_dump(tcp_segment_t *seg)
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, " - len = %" PRIu32, seg->len);
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, " - wnd = %" PRIu32, seg->wnd);
 	log_msg(LOG_DEFAULT, LVL_DEBUG2, " - up = %" PRIu32, seg->up);
+	log_msg(LOG_DEFAULT, LVL_DEBUG2, " - opts = %u", (unsigned)seg->opts);
 }
 
 /**
@@ -38,8 +38,11 @@
 #include <errno.h>
 #include <io/log.h>
 #include <stdio.h>
+#include <str.h>
 #include <task.h>
+#include <time.h>
 
+#include "cc.h"
 #include "conn.h"
 #include "inet.h"
 #include "ncsim.h"
@@ -54,7 +57,88 @@ static tcp_rqueue_cb_t tcp_rqueue_cb = {
 	.seg_received = tcp_as_segment_arrived
 };
 
-static errno_t tcp_init(void)
+static void usage(void)
+{
+	printf("Usage: " NAME " [-r <max-rcv-buf>] [-s <max-snd-buf>] "
+	    "[-c <cc-algorithm>] [-d <delay-ms>] [-l <loss-permille>]\n");
+	printf("  -r  Maximum receive buffer size in bytes\n");
+	printf("  -s  Maximum send buffer size in bytes\n");
+	printf("  -c  Congestion control algorithm (newreno, cubic)\n");
+	printf("  -d  Delay incoming segments (simulate network latency)\n");
+	printf("  -l  Drop incoming segments with given probability "
+	    "(in 1/1000)\n");
+}
+
+/** Parse command-line arguments.
+ *
+ * @param argc		Number of arguments
+ * @param argv		Arguments
+ * @param ncsim_cfg	Place to store network condition simulator
+ *			configuration
+ * @return		EOK on success, EINVAL if arguments are invalid
+ */
+static errno_t tcp_parse_args(int argc, char **argv,
+    tcp_ncsim_cfg_t *ncsim_cfg)
+{
+	size_t val;
+	int i;
+	errno_t rc;
+
+	ncsim_cfg->delay = 0;
+	ncsim_cfg->jitter = 0;
+	ncsim_cfg->drop_pm = 0;
+
+	i = 1;
+	while (i < argc) {
+		if (i + 1 >= argc || argv[i][0] != '-' || argv[i][1] == '\0' ||
+		    argv[i][2] != '\0')
+			return EINVAL;
+
+		if (argv[i][1] == 'c') {
+			if (tcp_cc_set_default(argv[i + 1]) != EOK)
+				return EINVAL;
+			i += 2;
+			continue;
+		}
+
+		rc = str_size_t(argv[i + 1], NULL, 10, true, &val);
+		if (rc != EOK)
+			return EINVAL;
+
+		switch (argv[i][1]) {
+		case 'r':
+			if (val == 0)
+				return EINVAL;
+			tcp_conn_bufcfg.rcv_buf_max = val;
+			if (tcp_conn_bufcfg.rcv_buf_init > val)
+				tcp_conn_bufcfg.rcv_buf_init = val;
+			break;
+		case 's':
+			if (val == 0)
+				return EINVAL;
+			tcp_conn_bufcfg.snd_buf_max = val;
+			if (tcp_conn_bufcfg.snd_buf_init > val)
+				tcp_conn_bufcfg.snd_buf_init = val;
+			break;
+		case 'd':
+			ncsim_cfg->delay = MSEC2USEC(val);
+			break;
+		case 'l':
+			if (val > 1000)
+				return EINVAL;
+			ncsim_cfg->drop_pm = val;
+			break;
+		default:
+			return EINVAL;
+		}
+
+		i += 2;
+	}
+
+	return EOK;
+}
+
+static errno_t tcp_init(tcp_ncsim_cfg_t *ncsim_cfg)
 {
 	errno_t rc;
 
@@ -71,6 +155,7 @@ static errno_t tcp_init(void)
 	tcp_rqueue_fibril_start();
 
 	tcp_ncsim_init();
+	tcp_ncsim_set_cfg(ncsim_cfg);
 	tcp_ncsim_fibril_start();
 
 	if (0)
@@ -91,17 +176,24 @@ static errno_t tcp_init(void)
 
 int main(int argc, char **argv)
 {
+	tcp_ncsim_cfg_t ncsim_cfg;
 	errno_t rc;
 
 	printf(NAME ": TCP (Transmission Control Protocol) network module\n");
 
+	rc = tcp_parse_args(argc, argv, &ncsim_cfg);
+	if (rc != EOK) {
+		usage();
+		return 1;
+	}
+
 	rc = log_init(NAME);
 	if (rc != EOK) {
 		printf(NAME ": Failed to initialize log.\n");
 		return 1;
 	}
 
-	rc = tcp_init();
+	rc = tcp_init(&ncsim_cfg);
 	if (rc != EOK)
 		return 1;
 
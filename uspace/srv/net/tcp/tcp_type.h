@@ -45,6 +45,8 @@
 #include <stdint.h>
 #include <inet/addr.h>
 #include <inet/endpoint.h>
+#include <time.h>
+#include "std.h"
 
 struct tcp_conn;
 
@@ -139,6 +141,49 @@ typedef enum {
 
 typedef struct tcp_conn tcp_conn_t;
 
+/** Loss recovery state */
+typedef enum {
+	/** No loss recovery in progress */
+	tcp_ca_open,
+	/** Fast recovery after duplicate ACKs (RFC 6582, RFC 6675) */
+	tcp_ca_recovery,
+	/** Recovery after retransmission timeout */
+	tcp_ca_loss
+} tcp_ca_state_t;
+
+/** Congestion control algorithm */
+typedef struct {
+	/** Algorithm name */
+	const char *name;
+	/** Initialize algorithm state */
+	void (*init)(tcp_conn_t *);
+	/** Grow window in congestion avoidance, @a acked bytes were acked */
+	void (*cong_avoid)(tcp_conn_t *, uint32_t acked);
+	/** Loss detected, return new slow start threshold */
+	uint32_t (*ssthresh)(tcp_conn_t *);
+} tcp_cc_ops_t;
+
+/** CUBIC congestion control state (RFC 9438) */
+typedef struct {
+	/** Window size before the last reduction in segments */
+	uint32_t w_max;
+	/** Window size the cubic function plateaus at in segments */
+	uint32_t origin;
+	/** Time to reach @c origin from start of epoch in milliseconds */
+	uint32_t k;
+	/** Start of the current epoch (timestamp clock) */
+	uint32_t epoch;
+	/** @c epoch is valid */
+	bool epoch_valid;
+	/** Estimated Reno-friendly window in 1/1024 bytes */
+	uint64_t w_est;
+} tcp_cubic_t;
+
+/** Congestion control algorithm private state */
+typedef union {
+	tcp_cubic_t cubic;
+} tcp_cc_state_t;
+
 /** Connection state change callback function */
 typedef void (*tcp_cstate_cb_t)(tcp_conn_t *, void *);
 
@@ -154,9 +199,36 @@ typedef struct {
 	tcp_cstate_t cstate;
 } tcp_conn_status_t;
 
+/** Segment options
+ *
+ * Bits indicating which options are present in a segment
+ */
+typedef enum {
+	/** Maximum segment size */
+	SOPT_MSS	= 0x1,
+	/** Window scale */
+	SOPT_WSCALE	= 0x2,
+	/** Timestamps */
+	SOPT_TS		= 0x4,
+	/** SACK permitted */
+	SOPT_SACK_PERM	= 0x8,
+	/** Selective acknowledgement */
+	SOPT_SACK	= 0x10
+} tcp_sopts_t;
+
+/** SACK block (received sequence number range) */
+typedef struct {
+	/** First sequence number in block */
+	uint32_t start;
+	/** Sequence number immediately following the block */
+	uint32_t end;
+} tcp_sack_block_t;
+
 typedef struct {
 	/** SYN, FIN */
 	tcp_control_t ctrl;
+	/** Options present in the segment */
+	tcp_sopts_t opts;
 
 	/** Segment sequence number */
 	uint32_t seq;
@@ -169,6 +241,31 @@ typedef struct {
 	/** Segment urgent pointer */
 	uint32_t up;
 
+	/** Maximum segment size option value */
+	uint16_t mss;
+	/** Window scale option value (shift count) */
+	uint8_t wscale;
+	/** Timestamp value */
+	uint32_t tsval;
+	/** Timestamp echo reply */
+	uint32_t tsecr;
+	/** Number of SACK blocks */
+	unsigned sack_cnt;
+	/** SACK blocks */
+	tcp_sack_block_t sack[TCP_SACK_BLOCKS_MAX];
+
+	/**
+	 * Maximum text size of segments this segment is split into upon
+	 * transmission, zero if it is transmitted as is
+	 */
+	size_t gso_size;
+
+	/**
+	 * Number of received segments merged into this segment, zero
+	 * if it was received as is
+	 */
+	size_t gro_segs;
+
 	/** Segment data, may be moved when trimming segment */
 	void *data;
 	/** Segment data, original pointer used to free data */
@@ -191,11 +288,22 @@ typedef struct {
 /** NCSim queue entry */
 typedef struct {
 	link_t link;
-	usec_t delay;
+	/** Time when the segment should be delivered */
+	struct timespec due;
 	inet_ep2_t epp;
 	tcp_segment_t *seg;
 } tcp_squeue_entry_t;
 
+/** Network condition simulator configuration */
+typedef struct {
+	/** Fixed delay applied to each segment */
+	usec_t delay;
+	/** Maximum random delay added on top of @c delay */
+	usec_t jitter;
+	/** Probability of dropping a segment in 1/1000 */
+	unsigned drop_pm;
+} tcp_ncsim_cfg_t;
+
 /** Incoming queue entry */
 typedef struct {
 	link_t link;
@@ -207,6 +315,10 @@ typedef struct {
 	link_t link;
 	tcp_conn_t *conn;
 	tcp_segment_t *seg;
+	/** Segment has been selectively acknowledged by the peer */
+	bool sacked;
+	/** Segment has been retransmitted during current loss recovery */
+	bool rexmit;
 } tcp_tqueue_entry_t;
 
 /** Retransmission queue callbacks */
@@ -271,10 +383,14 @@ struct tcp_conn {
 	/** Time-Wait timeout timer */
 	fibril_timer_t *tw_timer;
 
-	/** Receive buffer */
+	/** Receive buffer (circular) */
 	uint8_t *rcv_buf;
 	/** Receive buffer size */
 	size_t rcv_buf_size;
+	/** Receive buffer maximum size (when auto-tuning) */
+	size_t rcv_buf_max;
+	/** Receive buffer index of the first used byte */
+	size_t rcv_buf_start;
 	/** Receive buffer number of bytes used */
 	size_t rcv_buf_used;
 	/** Receive buffer contains FIN */
@@ -282,10 +398,14 @@ struct tcp_conn {
 	/** Receive buffer CV. Broadcast when new data is inserted */
 	fibril_condvar_t rcv_buf_cv;
 
-	/** Send buffer */
+	/** Send buffer (circular) */
 	uint8_t *snd_buf;
 	/** Send buffer size */
 	size_t snd_buf_size;
+	/** Send buffer maximum size (when auto-tuning) */
+	size_t snd_buf_max;
+	/** Send buffer index of the first used byte */
+	size_t snd_buf_start;
 	/** Send buffer number of bytes used */
 	size_t snd_buf_used;
 	/** Send buffer contains FIN */
@@ -316,6 +436,64 @@ struct tcp_conn {
 	uint32_t rcv_up;
 	/** Initial receive sequence number */
 	uint32_t irs;
+
+	/** Maximum segment size we can send */
+	size_t snd_mss;
+	/** Send window scale (shift count applied to received SEG.WND) */
+	uint8_t snd_wscale;
+	/** Receive window scale (shift count applied to sent SEG.WND) */
+	uint8_t rcv_wscale;
+	/** Window scale we offer in our SYN */
+	uint8_t rcv_wscale_offer;
+	/** Window scaling is in use */
+	bool ws_ok;
+	/** Timestamps option is in use */
+	bool ts_ok;
+	/** TS.Recent, timestamp to echo to the peer */
+	uint32_t ts_recent;
+	/** SACK option is in use */
+	bool sack_ok;
+	/** Start of the out-of-order segment received most recently */
+	uint32_t sack_recent;
+	/** Highest sequence number selectively acknowledged by the peer */
+	uint32_t sack_high;
+	/** Last window advertised to the peer (unscaled SEG.WND) */
+	uint32_t rcv_adv;
+
+	/** Smoothed round-trip time in microseconds (zero if not known yet) */
+	usec_t srtt;
+	/** Round-trip time variation in microseconds */
+	usec_t rttvar;
+	/** Retransmission timeout in microseconds */
+	usec_t rto;
+	/** A segment is being timed to measure round-trip time */
+	bool rtt_active;
+	/** Acknowledging this sequence number ends the measurement */
+	uint32_t rtt_seq;
+	/** Start time of round-trip time measurement */
+	struct timespec rtt_time;
+
+	/** Congestion control algorithm */
+	tcp_cc_ops_t *cc;
+	/** Congestion control algorithm state */
+	tcp_cc_state_t cc_state;
+	/** Congestion window in bytes */
+	uint32_t cwnd;
+	/** Slow start threshold in bytes */
+	uint32_t ssthresh;
+	/** Bytes acknowledged towards the next congestion window increase */
+	uint32_t cwnd_cnt;
+	/** Loss recovery state */
+	tcp_ca_state_t ca_state;
+	/** Number of consecutive duplicate ACKs */
+	unsigned dupacks;
+	/** SND.NXT at the start of loss recovery */
+	uint32_t recover;
+
+	/** Receive buffer auto-tuning: RCV.NXT at start of measurement */
+	uint32_t rcvq_seq;
+	/** Receive buffer auto-tuning: start time of measurement */
+	struct timespec rcvq_time;
 };
 
 /** Continuation of processing.
@@ -379,6 +557,18 @@ typedef struct tcp_client {
 	list_t clst;
 } tcp_client_t;
 
+/** Send and receive buffer configuration */
+typedef struct {
+	/** Initial receive buffer size */
+	size_t rcv_buf_init;
+	/** Maximum receive buffer size */
+	size_t rcv_buf_max;
+	/** Initial send buffer size */
+	size_t snd_buf_init;
+	/** Maximum send buffer size */
+	size_t snd_buf_max;
+} tcp_bufcfg_t;
+
 /** Internal loopback type */
 typedef enum {
 	/** No loopback */
@@ -386,7 +576,9 @@ typedef enum {
 	/** Segment loopback */
 	tcp_lb_segment,
 	/** PDU loopback */
-	tcp_lb_pdu
+	tcp_lb_pdu,
+	/** Segment loopback via network condition simulator */
+	tcp_lb_ncsim
 } tcp_lb_t;
 
 #endif
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <inet/endpoint.h>
+#include <io/log.h>
+#include <pcut/pcut.h>
+
+#include "../cc.h"
+#include "../conn.h"
+
+PCUT_INIT;
+
+PCUT_TEST_SUITE(cc);
+
+PCUT_TEST_BEFORE
+{
+	errno_t rc;
+
+	/* We will be calling functions that perform logging */
+	rc = log_init("test-tcp");
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+}
+
+/** Create connection with given congestion control algorithm */
+static tcp_conn_t *cc_test_conn(tcp_cc_ops_t *cc)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->cc = cc;
+	conn->cc->init(conn);
+	conn->snd_mss = 1000;
+	tcp_cc_mss_set(conn);
+
+	return conn;
+}
+
+/** Test looking up algorithms by name */
+PCUT_TEST(find)
+{
+	tcp_conn_t *conn;
+	errno_t rc;
+
+	PCUT_ASSERT_EQUALS(&tcp_cc_newreno, tcp_cc_find("newreno"));
+	PCUT_ASSERT_EQUALS(&tcp_cc_cubic, tcp_cc_find("cubic"));
+	PCUT_ASSERT_NULL(tcp_cc_find("foo"));
+
+	rc = tcp_cc_set_default("foo");
+	PCUT_ASSERT_ERRNO_VAL(ENOENT, rc);
+
+	rc = tcp_cc_set_default("newreno");
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	conn = cc_test_conn(&tcp_cc_newreno);
+	PCUT_ASSERT_EQUALS(&tcp_cc_newreno, conn->cc);
+	tcp_conn_delete(conn);
+
+	rc = tcp_cc_set_default("cubic");
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+}
+
+/** Test slow start */
+PCUT_TEST(slow_start)
+{
+	tcp_conn_t *conn;
+	int i;
+
+	conn = cc_test_conn(&tcp_cc_newreno);
+
+	/* Initial window is ten segments */
+	PCUT_ASSERT_INT_EQUALS(10000, conn->cwnd);
+
+	/* Window grows by the acknowledged bytes */
+	tcp_cc_ack(conn, 500);
+	PCUT_ASSERT_INT_EQUALS(10500, conn->cwnd);
+
+	/* ...but by at most two segments per ACK */
+	for (i = 0; i < 5; i++)
+		tcp_cc_ack(conn, 3000);
+	PCUT_ASSERT_INT_EQUALS(20500, conn->cwnd);
+
+	tcp_conn_delete(conn);
+}
+
+/** Test NewReno congestion avoidance */
+PCUT_TEST(newreno_cong_avoid)
+{
+	tcp_conn_t *conn;
+	int i;
+
+	conn = cc_test_conn(&tcp_cc_newreno);
+	conn->ssthresh = conn->cwnd;
+
+	/* Window grows by one segment per window's worth of data */
+	for (i = 0; i < 9; i++)
+		tcp_cc_ack(conn, 1000);
+	PCUT_ASSERT_INT_EQUALS(10000, conn->cwnd);
+
+	tcp_cc_ack(conn, 1000);
+	PCUT_ASSERT_INT_EQUALS(11000, conn->cwnd);
+
+	tcp_conn_delete(conn);
+}
+
+/** Test NewReno reaction to loss */
+PCUT_TEST(newreno_loss)
+{
+	tcp_conn_t *conn;
+
+	conn = cc_test_conn(&tcp_cc_newreno);
+
+	/* Slow start threshold is half the flight size */
+	conn->snd_una = 1;
+	conn->snd_nxt = 20001;
+	tcp_cc_loss(conn);
+	PCUT_ASSERT_INT_EQUALS(10000, conn->ssthresh);
+
+	/* But at least two segments */
+	conn->snd_nxt = 1001;
+	tcp_cc_loss(conn);
+	PCUT_ASSERT_INT_EQUALS(2000, conn->ssthresh);
+
+	tcp_conn_delete(conn);
+}
+
+/** Test CUBIC reaction to loss */
+PCUT_TEST(cubic_loss)
+{
+	tcp_conn_t *conn;
+
+	conn = cc_test_conn(&tcp_cc_cubic);
+
+	/* Window is reduced by 30 % */
+	conn->cwnd = 100000;
+	tcp_cc_loss(conn);
+	PCUT_ASSERT_INT_EQUALS(70019, conn->ssthresh);
+	PCUT_ASSERT_INT_EQUALS(100, conn->cc_state.cubic.w_max);
+
+	/* Fast convergence if maximum was not reached again */
+	conn->cwnd = 80000;
+	tcp_cc_loss(conn);
+	PCUT_ASSERT_INT_EQUALS(68, conn->cc_state.cubic.w_max);
+
+	tcp_conn_delete(conn);
+}
+
+/** Test CUBIC window growth */
+PCUT_TEST(cubic_cong_avoid)
+{
+	tcp_conn_t *conn;
+	tcp_cubic_t *cubic;
+	int i;
+
+	conn = cc_test_conn(&tcp_cc_cubic);
+	cubic = &conn->cc_state.cubic;
+	conn->srtt = 10000;
+
+	conn->cwnd = 100000;
+	tcp_cc_loss(conn);
+	conn->cwnd = conn->ssthresh;
+
+	/*
+	 * Shortly after the loss the window is below W_max, it grows
+	 * (at least as fast as Reno would), but does not reach W_max.
+	 */
+	for (i = 0; i < 1000; i++)
+		tcp_cc_ack(conn, 1000);
+
+	PCUT_ASSERT_TRUE(cubic->epoch_valid);
+	PCUT_ASSERT_TRUE(conn->cwnd > 70019);
+	PCUT_ASSERT_TRUE(conn->cwnd < 100000);
+
+	/* Long after K the window probes beyond W_max */
+	cubic->epoch -= 2 * cubic->k;
+	for (i = 0; i < 100; i++)
+		tcp_cc_ack(conn, 1000);
+
+	PCUT_ASSERT_TRUE(conn->cwnd > 100000);
+
+	tcp_conn_delete(conn);
+}
+
+PCUT_EXPORT(cc);
@@ -175,4 +175,66 @@ PCUT_TEST(two_segments)
 	tcp_conn_delete(conn);
 }
 
+/** Test computing SACK blocks from out-of-order segments */
+PCUT_TEST(sack_blocks)
+{
+	tcp_conn_t *conn;
+	tcp_iqueue_t iqueue;
+	inet_ep2_t epp;
+	tcp_segment_t *seg[4];
+	tcp_sack_block_t blocks[TCP_SACK_BLOCKS_MAX];
+	uint32_t seqs[4] = { 25, 20, 60, 40 };
+	void *data;
+	size_t dsize;
+	unsigned cnt;
+	int i;
+
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->rcv_nxt = 10;
+	conn->rcv_wnd = 100;
+
+	dsize = 5;
+	data = calloc(dsize, 1);
+	PCUT_ASSERT_NOT_NULL(data);
+
+	tcp_iqueue_init(&iqueue, conn);
+
+	cnt = tcp_iqueue_sack_blocks(&iqueue, 0, blocks, TCP_SACK_BLOCKS_MAX);
+	PCUT_ASSERT_INT_EQUALS(0, cnt);
+
+	for (i = 0; i < 4; i++) {
+		seg[i] = tcp_segment_make_data(0, data, dsize);
+		PCUT_ASSERT_NOT_NULL(seg[i]);
+		seg[i]->seq = seqs[i];
+		tcp_iqueue_insert_seg(&iqueue, seg[i]);
+	}
+
+	/* Block with most recent segment first, the rest in order */
+	cnt = tcp_iqueue_sack_blocks(&iqueue, 40, blocks, TCP_SACK_BLOCKS_MAX);
+	PCUT_ASSERT_INT_EQUALS(3, cnt);
+	PCUT_ASSERT_INT_EQUALS(40, blocks[0].start);
+	PCUT_ASSERT_INT_EQUALS(45, blocks[0].end);
+	PCUT_ASSERT_INT_EQUALS(20, blocks[1].start);
+	PCUT_ASSERT_INT_EQUALS(30, blocks[1].end);
+	PCUT_ASSERT_INT_EQUALS(60, blocks[2].start);
+	PCUT_ASSERT_INT_EQUALS(65, blocks[2].end);
+
+	/* Most recent block is reported even if there is no room */
+	cnt = tcp_iqueue_sack_blocks(&iqueue, 62, blocks, 2);
+	PCUT_ASSERT_INT_EQUALS(2, cnt);
+	PCUT_ASSERT_INT_EQUALS(60, blocks[0].start);
+	PCUT_ASSERT_INT_EQUALS(20, blocks[1].start);
+
+	for (i = 0; i < 4; i++) {
+		tcp_iqueue_remove_seg(&iqueue, seg[i]);
+		tcp_segment_delete(seg[i]);
+	}
+
+	free(data);
+	tcp_conn_delete(conn);
+}
+
 PCUT_EXPORT(iqueue);
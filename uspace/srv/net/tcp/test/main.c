@@ -36,12 +36,30 @@
 /** Verify that two segments have the same content */
 void test_seg_same(tcp_segment_t *a, tcp_segment_t *b)
 {
+	unsigned i;
+
 	PCUT_ASSERT_INT_EQUALS(a->ctrl, b->ctrl);
 	PCUT_ASSERT_INT_EQUALS(a->seq, b->seq);
 	PCUT_ASSERT_INT_EQUALS(a->ack, b->ack);
 	PCUT_ASSERT_INT_EQUALS(a->len, b->len);
 	PCUT_ASSERT_INT_EQUALS(a->wnd, b->wnd);
 	PCUT_ASSERT_INT_EQUALS(a->up, b->up);
+	PCUT_ASSERT_INT_EQUALS(a->opts, b->opts);
+	if ((a->opts & SOPT_MSS) != 0)
+		PCUT_ASSERT_INT_EQUALS(a->mss, b->mss);
+	if ((a->opts & SOPT_WSCALE) != 0)
+		PCUT_ASSERT_INT_EQUALS(a->wscale, b->wscale);
+	if ((a->opts & SOPT_TS) != 0) {
+		PCUT_ASSERT_INT_EQUALS(a->tsval, b->tsval);
+		PCUT_ASSERT_INT_EQUALS(a->tsecr, b->tsecr);
+	}
+	if ((a->opts & SOPT_SACK) != 0) {
+		PCUT_ASSERT_INT_EQUALS(a->sack_cnt, b->sack_cnt);
+		for (i = 0; i < a->sack_cnt; i++) {
+			PCUT_ASSERT_INT_EQUALS(a->sack[i].start, b->sack[i].start);
+			PCUT_ASSERT_INT_EQUALS(a->sack[i].end, b->sack[i].end);
+		}
+	}
 	PCUT_ASSERT_INT_EQUALS(tcp_segment_text_size(a),
 	    tcp_segment_text_size(b));
 	if (tcp_segment_text_size(a) != 0)
@@ -56,6 +74,7 @@ void test_seg_same(tcp_segment_t *a, tcp_segment_t *b)
 
 PCUT_INIT;
 
+PCUT_IMPORT(cc);
 PCUT_IMPORT(conn);
 PCUT_IMPORT(iqueue);
 PCUT_IMPORT(pdu);
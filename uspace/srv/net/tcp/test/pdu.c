@@ -26,6 +26,7 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <byteorder.h>
 #include <errno.h>
 #include <inet/endpoint.h>
 #include <mem.h>
@@ -35,6 +36,7 @@
 #include "main.h"
 #include "../pdu.h"
 #include "../segment.h"
+#include "../std.h"
 
 PCUT_INIT;
 
@@ -108,4 +110,152 @@ PCUT_TEST(encdec_data)
 	free(data);
 }
 
+/** Test encode/decode round trip for PDU with options */
+PCUT_TEST(encdec_opts)
+{
+	tcp_segment_t *seg, *dseg;
+	tcp_pdu_t *pdu;
+	inet_ep2_t epp, depp;
+	errno_t rc;
+
+	inet_ep2_init(&epp);
+	inet_addr(&epp.local.addr, 1, 2, 3, 4);
+	inet_addr(&epp.remote.addr, 5, 6, 7, 8);
+
+	seg = tcp_segment_make_ctrl(CTL_SYN | CTL_ACK);
+	PCUT_ASSERT_NOT_NULL(seg);
+
+	seg->seq = 20;
+	seg->ack = 19;
+	seg->wnd = 18;
+	seg->up = 17;
+	seg->opts = SOPT_MSS | SOPT_WSCALE | SOPT_TS;
+	seg->mss = 1460;
+	seg->wscale = 7;
+	seg->tsval = 0x12345678;
+	seg->tsecr = 0x9abcdef0;
+
+	rc = tcp_pdu_encode(&epp, seg, &pdu);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Header must be padded to a multiple of four bytes */
+	PCUT_ASSERT_INT_EQUALS(0, pdu->header_size % 4);
+	PCUT_ASSERT_TRUE(pdu->header_size > sizeof(tcp_header_t));
+
+	rc = tcp_pdu_decode(pdu, &depp, &dseg);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	test_seg_same(seg, dseg);
+	tcp_segment_delete(seg);
+	tcp_segment_delete(dseg);
+	tcp_pdu_delete(pdu);
+}
+
+/** Test encode/decode round trip for PDU with SACK options */
+PCUT_TEST(encdec_sack)
+{
+	tcp_segment_t *seg, *dseg;
+	tcp_pdu_t *pdu;
+	inet_ep2_t epp, depp;
+	errno_t rc;
+
+	inet_ep2_init(&epp);
+	inet_addr(&epp.local.addr, 1, 2, 3, 4);
+	inet_addr(&epp.remote.addr, 5, 6, 7, 8);
+
+	seg = tcp_segment_make_ctrl(CTL_ACK);
+	PCUT_ASSERT_NOT_NULL(seg);
+
+	seg->seq = 20;
+	seg->ack = 19;
+	seg->wnd = 18;
+	seg->opts = SOPT_TS | SOPT_SACK;
+	seg->tsval = 1;
+	seg->tsecr = 2;
+	seg->sack_cnt = 3;
+	seg->sack[0].start = 3000;
+	seg->sack[0].end = 4000;
+	seg->sack[1].start = 1000;
+	seg->sack[1].end = 2000;
+	seg->sack[2].start = 0xfffffff0;
+	seg->sack[2].end = 0x10;
+
+	rc = tcp_pdu_encode(&epp, seg, &pdu);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	/* Timestamps with three SACK blocks fill the options space */
+	PCUT_ASSERT_INT_EQUALS(sizeof(tcp_header_t) + TCP_OPTS_MAX_SIZE,
+	    pdu->header_size);
+
+	rc = tcp_pdu_decode(pdu, &depp, &dseg);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	test_seg_same(seg, dseg);
+	tcp_segment_delete(seg);
+	tcp_segment_delete(dseg);
+
+	tcp_pdu_delete(pdu);
+
+	/* SACK permitted option in SYN */
+	seg = tcp_segment_make_ctrl(CTL_SYN);
+	PCUT_ASSERT_NOT_NULL(seg);
+
+	seg->opts = SOPT_MSS | SOPT_SACK_PERM;
+	seg->mss = 1460;
+
+	rc = tcp_pdu_encode(&epp, seg, &pdu);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	rc = tcp_pdu_decode(pdu, &depp, &dseg);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	test_seg_same(seg, dseg);
+	tcp_segment_delete(seg);
+	tcp_segment_delete(dseg);
+	tcp_pdu_delete(pdu);
+}
+
+/** Test decoding PDU with unknown and malformed options */
+PCUT_TEST(decode_bad_opts)
+{
+	tcp_segment_t *dseg;
+	tcp_pdu_t *pdu;
+	inet_ep2_t depp;
+	uint8_t hdr[sizeof(tcp_header_t) + 12];
+	uint8_t text[4];
+	tcp_header_t *thdr;
+	uint8_t *opt;
+	errno_t rc;
+
+	memset(hdr, 0, sizeof(hdr));
+	memset(text, 0, sizeof(text));
+	thdr = (tcp_header_t *) hdr;
+	thdr->doff_flags = host2uint16_t_be((sizeof(hdr) / 4) <<
+	    DF_DATA_OFFSET_l);
+
+	opt = hdr + sizeof(tcp_header_t);
+	/* Unknown option (kind 99, length 3) */
+	opt[0] = 99;
+	opt[1] = 3;
+	/* Window scale option */
+	opt[3] = OPT_WINDOW_SCALE;
+	opt[4] = OPT_WINDOW_SCALE_LEN;
+	opt[5] = 3;
+	/* MSS option with length running past the end of the header */
+	opt[6] = OPT_MAX_SEG_SIZE;
+	opt[7] = 10;
+
+	pdu = tcp_pdu_create(hdr, sizeof(hdr), text, sizeof(text));
+	PCUT_ASSERT_NOT_NULL(pdu);
+
+	rc = tcp_pdu_decode(pdu, &depp, &dseg);
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	PCUT_ASSERT_INT_EQUALS(SOPT_WSCALE, dseg->opts);
+	PCUT_ASSERT_INT_EQUALS(3, dseg->wscale);
+
+	tcp_segment_delete(dseg);
+	tcp_pdu_delete(pdu);
+}
+
 PCUT_EXPORT(pdu);
@@ -126,4 +126,53 @@ PCUT_TEST(multiple_segments)
 
 }
 
+/** Test merging consecutive data segments */
+PCUT_TEST(merge_segments)
+{
+	tcp_segment_t *seg;
+	inet_ep2_t epp;
+	uint8_t data[40];
+	int i;
+
+	tcp_rqueue_init(&rcb);
+	seg_cnt = 0;
+
+	inet_ep2_init(&epp);
+
+	for (i = 0; i < 40; i++)
+		data[i] = (uint8_t) i;
+
+	/* Three consecutive data segments */
+	for (i = 0; i < 3; i++) {
+		seg = tcp_segment_make_data(CTL_ACK, data + 10 * i, 10);
+		PCUT_ASSERT_NOT_NULL(seg);
+		seg->seq = 100 + 10 * i;
+		tcp_rqueue_insert_seg(&epp, seg);
+	}
+
+	/* Data segment that does not follow */
+	seg = tcp_segment_make_data(CTL_ACK, data + 30, 10);
+	PCUT_ASSERT_NOT_NULL(seg);
+	seg->seq = 200;
+	tcp_rqueue_insert_seg(&epp, seg);
+
+	tcp_rqueue_fibril_start();
+	tcp_rqueue_fini();
+
+	PCUT_ASSERT_INT_EQUALS(2, seg_cnt);
+
+	PCUT_ASSERT_INT_EQUALS(100, recv_seg[0]->seq);
+	PCUT_ASSERT_INT_EQUALS(30, recv_seg[0]->len);
+	for (i = 0; i < 30; i++) {
+		PCUT_ASSERT_INT_EQUALS(data[i],
+		    ((uint8_t *) recv_seg[0]->data)[i]);
+	}
+
+	PCUT_ASSERT_INT_EQUALS(200, recv_seg[1]->seq);
+	PCUT_ASSERT_INT_EQUALS(10, recv_seg[1]->len);
+
+	for (i = 0; i < seg_cnt; i++)
+		tcp_segment_delete(recv_seg[i]);
+}
+
 PCUT_EXPORT(rqueue);
@@ -244,4 +244,107 @@ PCUT_TEST(data_seg_trim)
 	free(cdata);
 }
 
+/** Test splitting data segment text into parts */
+PCUT_TEST(data_seg_slice)
+{
+	tcp_segment_t *seg, *part;
+	uint8_t *data;
+	size_t i, dsize;
+
+	dsize = 15;
+	data = malloc(dsize);
+	PCUT_ASSERT_NOT_NULL(data);
+
+	for (i = 0; i < dsize; i++)
+		data[i] = (uint8_t) i;
+
+	seg = tcp_segment_make_data(CTL_SYN | CTL_FIN | CTL_ACK, data, dsize);
+	PCUT_ASSERT_NOT_NULL(seg);
+
+	seg->seq = 20;
+	seg->ack = 19;
+	seg->wnd = 18;
+
+	/* First part keeps SYN */
+	part = tcp_segment_slice(seg, 0, 10);
+	PCUT_ASSERT_NOT_NULL(part);
+	PCUT_ASSERT_INT_EQUALS(CTL_SYN | CTL_ACK, part->ctrl);
+	PCUT_ASSERT_INT_EQUALS(20, part->seq);
+	PCUT_ASSERT_INT_EQUALS(11, part->len);
+	PCUT_ASSERT_INT_EQUALS(19, part->ack);
+	PCUT_ASSERT_INT_EQUALS(18, part->wnd);
+	for (i = 0; i < 10; i++)
+		PCUT_ASSERT_INT_EQUALS(data[i], ((uint8_t *) part->data)[i]);
+	tcp_segment_delete(part);
+
+	/* Last part keeps FIN and follows the first one */
+	part = tcp_segment_slice(seg, 10, 5);
+	PCUT_ASSERT_NOT_NULL(part);
+	PCUT_ASSERT_INT_EQUALS(CTL_FIN | CTL_ACK, part->ctrl);
+	PCUT_ASSERT_INT_EQUALS(31, part->seq);
+	PCUT_ASSERT_INT_EQUALS(6, part->len);
+	for (i = 0; i < 5; i++)
+		PCUT_ASSERT_INT_EQUALS(data[10 + i], ((uint8_t *) part->data)[i]);
+	tcp_segment_delete(part);
+
+	tcp_segment_delete(seg);
+	free(data);
+}
+
+/** Test merging consecutive data segments */
+PCUT_TEST(data_seg_merge)
+{
+	tcp_segment_t *seg[3], *mseg;
+	uint8_t data[30];
+	size_t i;
+
+	for (i = 0; i < 30; i++)
+		data[i] = (uint8_t) i;
+
+	for (i = 0; i < 3; i++) {
+		seg[i] = tcp_segment_make_data(CTL_ACK, data + 10 * i, 10);
+		PCUT_ASSERT_NOT_NULL(seg[i]);
+		seg[i]->seq = 100 + 10 * i;
+		seg[i]->ack = 19;
+		seg[i]->wnd = 18;
+	}
+
+	PCUT_ASSERT_TRUE(tcp_segment_mergeable(seg[0], seg[1]));
+	PCUT_ASSERT_TRUE(tcp_segment_mergeable(seg[1], seg[2]));
+
+	/* Not in sequence */
+	PCUT_ASSERT_FALSE(tcp_segment_mergeable(seg[0], seg[2]));
+
+	/* Different window */
+	seg[2]->wnd = 17;
+	PCUT_ASSERT_FALSE(tcp_segment_mergeable(seg[1], seg[2]));
+	seg[2]->wnd = 18;
+
+	/* Different timestamps */
+	seg[1]->opts = seg[2]->opts = SOPT_TS;
+	seg[1]->tsval = 1;
+	seg[2]->tsval = 2;
+	PCUT_ASSERT_FALSE(tcp_segment_mergeable(seg[1], seg[2]));
+	seg[0]->opts = SOPT_TS;
+	seg[0]->tsval = seg[2]->tsval = 1;
+	PCUT_ASSERT_TRUE(tcp_segment_mergeable(seg[1], seg[2]));
+
+	mseg = tcp_segment_merge(seg, 3);
+	PCUT_ASSERT_NOT_NULL(mseg);
+	PCUT_ASSERT_INT_EQUALS(CTL_ACK, mseg->ctrl);
+	PCUT_ASSERT_INT_EQUALS(SOPT_TS, mseg->opts);
+	PCUT_ASSERT_INT_EQUALS(100, mseg->seq);
+	PCUT_ASSERT_INT_EQUALS(30, mseg->len);
+	PCUT_ASSERT_INT_EQUALS(19, mseg->ack);
+	PCUT_ASSERT_INT_EQUALS(18, mseg->wnd);
+	PCUT_ASSERT_INT_EQUALS(1, mseg->tsval);
+	PCUT_ASSERT_INT_EQUALS(3, mseg->gro_segs);
+	for (i = 0; i < 30; i++)
+		PCUT_ASSERT_INT_EQUALS(data[i], ((uint8_t *) mseg->data)[i]);
+
+	tcp_segment_delete(mseg);
+	for (i = 0; i < 3; i++)
+		tcp_segment_delete(seg[i]);
+}
+
 PCUT_EXPORT(segment);
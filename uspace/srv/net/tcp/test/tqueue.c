@@ -30,6 +30,7 @@
 #include <io/log.h>
 #include <pcut/pcut.h>
 
+#include "../cc.h"
 #include "../conn.h"
 #include "../segment.h"
 #include "../tqueue.h"
@@ -193,8 +194,10 @@ PCUT_TEST(new_data_small_win)
 	PCUT_ASSERT_EQUALS(15, conn->snd_nxt);
 	PCUT_ASSERT_EQUALS(25, conn->snd_buf_used);
 	PCUT_ASSERT_FALSE(conn->snd_buf_fin);
-	for (i = 0; i < 25; i++)
-		PCUT_ASSERT_INT_EQUALS(5 + i, conn->snd_buf[i]);
+	for (i = 0; i < 25; i++) {
+		PCUT_ASSERT_INT_EQUALS(5 + i,
+		    conn->snd_buf[conn->snd_buf_start + i]);
+	}
 
 	tcp_conn_delete(conn);
 	PCUT_ASSERT_EQUALS(1, seg_cnt);
@@ -203,6 +206,62 @@ PCUT_TEST(new_data_small_win)
 	tcp_segment_delete(trans_seg[0]);
 }
 
+/** Test that data is split into segments of at most MSS bytes */
+PCUT_TEST(new_data_mss)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+	int i;
+
+	/* XXX tqueue can only be created via tcp_conn_new */
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->cstate = st_established;
+	conn->snd_una = 10;
+	conn->snd_nxt = 10;
+	conn->snd_wnd = 1024;
+	conn->snd_mss = 10;
+	conn->snd_buf_used = 25;
+	conn->snd_buf_fin = true;
+	for (i = 0; i < 25; i++)
+		conn->snd_buf[i] = i;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &tqueue_test_cb;
+	seg_cnt = 0;
+
+	tcp_conn_lock(conn);
+	tcp_tqueue_new_data(conn);
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	PCUT_ASSERT_EQUALS(36, conn->snd_nxt);
+	PCUT_ASSERT_EQUALS(0, conn->snd_buf_used);
+	PCUT_ASSERT_FALSE(conn->snd_buf_fin);
+
+	tcp_conn_delete(conn);
+	PCUT_ASSERT_EQUALS(3, seg_cnt);
+
+	PCUT_ASSERT_EQUALS(CTL_ACK, trans_seg[0]->ctrl);
+	PCUT_ASSERT_EQUALS(10, trans_seg[0]->seq);
+	PCUT_ASSERT_EQUALS(10, trans_seg[0]->len);
+	PCUT_ASSERT_EQUALS(CTL_ACK, trans_seg[1]->ctrl);
+	PCUT_ASSERT_EQUALS(20, trans_seg[1]->seq);
+	PCUT_ASSERT_EQUALS(10, trans_seg[1]->len);
+	PCUT_ASSERT_EQUALS(CTL_FIN | CTL_ACK, trans_seg[2]->ctrl);
+	PCUT_ASSERT_EQUALS(30, trans_seg[2]->seq);
+	PCUT_ASSERT_EQUALS(6, trans_seg[2]->len);
+
+	for (i = 0; i < 25; i++) {
+		PCUT_ASSERT_INT_EQUALS(i,
+		    ((uint8_t *) trans_seg[i / 10]->data)[i % 10]);
+	}
+
+	for (i = 0; i < 3; i++)
+		tcp_segment_delete(trans_seg[i]);
+}
+
 /** Test flushing tqueue due to receiving an ACK */
 PCUT_TEST(ack_received)
 {
@@ -257,6 +316,311 @@ PCUT_TEST(ack_received)
 	tcp_conn_delete(conn);
 }
 
+/** Test fast retransmit and NewReno fast recovery */
+PCUT_TEST(fast_retransmit)
+{
+	tcp_conn_t *conn;
+	inet_ep2_t epp;
+	int i;
+
+	/* XXX tqueue can only be created via tcp_conn_new */
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->cstate = st_established;
+	conn->snd_una = 10;
+	conn->snd_nxt = 10;
+	conn->snd_wnd = 1024;
+	conn->snd_mss = 10;
+	conn->cc = &tcp_cc_newreno;
+	conn->cwnd = 100;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &tqueue_test_cb;
+	seg_cnt = 0;
+
+	tcp_conn_lock(conn);
+
+	/* Send five segments */
+	conn->snd_buf_used = 50;
+	conn->snd_buf_fin = false;
+	for (i = 0; i < 50; i++)
+		conn->snd_buf[i] = i;
+	tcp_tqueue_new_data(conn);
+	PCUT_ASSERT_INT_EQUALS(5, seg_cnt);
+	PCUT_ASSERT_EQUALS(60, conn->snd_nxt);
+
+	/* Two duplicate ACKs do not trigger retransmission */
+	tcp_tqueue_dupack_received(conn);
+	tcp_tqueue_dupack_received(conn);
+	PCUT_ASSERT_INT_EQUALS(5, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(tcp_ca_open, conn->ca_state);
+
+	/* Third duplicate ACK triggers fast retransmit */
+	tcp_tqueue_dupack_received(conn);
+	PCUT_ASSERT_INT_EQUALS(6, seg_cnt);
+	PCUT_ASSERT_EQUALS(10, trans_seg[5]->seq);
+	PCUT_ASSERT_INT_EQUALS(tcp_ca_recovery, conn->ca_state);
+	PCUT_ASSERT_EQUALS(60, conn->recover);
+	PCUT_ASSERT_EQUALS(25, conn->ssthresh);
+	PCUT_ASSERT_EQUALS(55, conn->cwnd);
+
+	/* Further duplicate ACKs inflate the window */
+	tcp_tqueue_dupack_received(conn);
+	PCUT_ASSERT_EQUALS(65, conn->cwnd);
+
+	/* Partial ACK retransmits the next segment */
+	conn->snd_una = 30;
+	tcp_tqueue_ack_received(conn);
+	PCUT_ASSERT_INT_EQUALS(7, seg_cnt);
+	PCUT_ASSERT_EQUALS(30, trans_seg[6]->seq);
+	PCUT_ASSERT_INT_EQUALS(tcp_ca_recovery, conn->ca_state);
+
+	/* Full ACK ends fast recovery */
+	conn->snd_una = 60;
+	tcp_tqueue_ack_received(conn);
+	PCUT_ASSERT_INT_EQUALS(tcp_ca_open, conn->ca_state);
+	PCUT_ASSERT_EQUALS(20, conn->cwnd);
+	PCUT_ASSERT_TRUE(list_empty(&conn->retransmit.list));
+
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+
+	for (i = 0; i < seg_cnt; i++)
+		tcp_segment_delete(trans_seg[i]);
+}
+
+/** Test SACK-based loss recovery */
+PCUT_TEST(sack_recovery)
+{
+	tcp_conn_t *conn;
+	tcp_segment_t *ack;
+	inet_ep2_t epp;
+	bool marked;
+	int i;
+
+	/* XXX tqueue can only be created via tcp_conn_new */
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->cstate = st_established;
+	conn->snd_una = 10;
+	conn->snd_nxt = 10;
+	conn->snd_wnd = 1024;
+	conn->snd_mss = 10;
+	conn->sack_ok = true;
+	conn->cc = &tcp_cc_newreno;
+	conn->cwnd = 100;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &tqueue_test_cb;
+	seg_cnt = 0;
+
+	tcp_conn_lock(conn);
+
+	/* Send five segments */
+	conn->snd_buf_used = 50;
+	conn->snd_buf_fin = false;
+	for (i = 0; i < 50; i++)
+		conn->snd_buf[i] = i;
+	tcp_tqueue_new_data(conn);
+	PCUT_ASSERT_INT_EQUALS(5, seg_cnt);
+
+	/* Peer received the last three segments */
+	ack = tcp_segment_make_ctrl(CTL_ACK);
+	PCUT_ASSERT_NOT_NULL(ack);
+	ack->ack = 10;
+	ack->opts = SOPT_SACK;
+	ack->sack_cnt = 1;
+	ack->sack[0].start = 30;
+	ack->sack[0].end = 60;
+
+	marked = tcp_tqueue_sack_received(conn, ack);
+	PCUT_ASSERT_TRUE(marked);
+	PCUT_ASSERT_EQUALS(60, conn->sack_high);
+
+	/* Repeated SACK does not mark anything new */
+	marked = tcp_tqueue_sack_received(conn, ack);
+	PCUT_ASSERT_FALSE(marked);
+	tcp_segment_delete(ack);
+
+	/* Both holes are retransmitted, SACKed segments are not */
+	for (i = 0; i < 3; i++)
+		tcp_tqueue_dupack_received(conn);
+	PCUT_ASSERT_INT_EQUALS(tcp_ca_recovery, conn->ca_state);
+	PCUT_ASSERT_EQUALS(25, conn->cwnd);
+	PCUT_ASSERT_INT_EQUALS(7, seg_cnt);
+	PCUT_ASSERT_EQUALS(10, trans_seg[5]->seq);
+	PCUT_ASSERT_EQUALS(20, trans_seg[6]->seq);
+
+	/* Holes are not retransmitted again */
+	tcp_tqueue_dupack_received(conn);
+	PCUT_ASSERT_INT_EQUALS(7, seg_cnt);
+
+	/* Full ACK ends fast recovery */
+	conn->snd_una = 60;
+	tcp_tqueue_ack_received(conn);
+	PCUT_ASSERT_INT_EQUALS(tcp_ca_open, conn->ca_state);
+	PCUT_ASSERT_TRUE(list_empty(&conn->retransmit.list));
+
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+
+	for (i = 0; i < seg_cnt; i++)
+		tcp_segment_delete(trans_seg[i]);
+}
+
+/** Test sending data as one large segment split upon transmission */
+PCUT_TEST(new_data_gso)
+{
+	tcp_conn_t *conn;
+	tcp_tqueue_entry_t *tqe;
+	inet_ep2_t epp;
+	int i;
+
+	/* XXX tqueue can only be created via tcp_conn_new */
+	inet_ep2_init(&epp);
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->cstate = st_established;
+	conn->snd_una = 10;
+	conn->snd_nxt = 10;
+	conn->snd_wnd = 1024;
+	conn->snd_mss = 10;
+	conn->cc = &tcp_cc_newreno;
+	conn->cwnd = 100;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &tqueue_test_cb;
+	seg_cnt = 0;
+
+	tcp_conn_lock(conn);
+
+	conn->snd_buf_used = 50;
+	conn->snd_buf_fin = false;
+	for (i = 0; i < 50; i++)
+		conn->snd_buf[i] = i;
+	tcp_tqueue_new_data(conn);
+
+	/* Five segments on the wire, but only one queued for retransmission */
+	PCUT_ASSERT_INT_EQUALS(5, seg_cnt);
+	PCUT_ASSERT_EQUALS(60, conn->snd_nxt);
+	for (i = 0; i < 5; i++) {
+		PCUT_ASSERT_INT_EQUALS(10 + 10 * i, trans_seg[i]->seq);
+		PCUT_ASSERT_INT_EQUALS(10, trans_seg[i]->len);
+	}
+
+	for (i = 0; i < 50; i++) {
+		PCUT_ASSERT_INT_EQUALS(i,
+		    ((uint8_t *) trans_seg[i / 10]->data)[i % 10]);
+	}
+
+	PCUT_ASSERT_INT_EQUALS(1, list_count(&conn->retransmit.list));
+
+	/* Acknowledged part is removed from the queued segment */
+	conn->snd_una = 30;
+	tcp_tqueue_ack_received(conn);
+	PCUT_ASSERT_INT_EQUALS(1, list_count(&conn->retransmit.list));
+	tqe = list_get_instance(list_first(&conn->retransmit.list),
+	    tcp_tqueue_entry_t, link);
+	PCUT_ASSERT_EQUALS(30, tqe->seg->seq);
+	PCUT_ASSERT_EQUALS(30, tqe->seg->len);
+
+	conn->snd_una = 60;
+	tcp_tqueue_ack_received(conn);
+	PCUT_ASSERT_TRUE(list_empty(&conn->retransmit.list));
+
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+
+	for (i = 0; i < seg_cnt; i++)
+		tcp_segment_delete(trans_seg[i]);
+}
+
+/** Test acknowledging segments merged by receive offload */
+PCUT_TEST(ack_coalesced)
+{
+	tcp_conn_t *conn;
+	tcp_segment_t *seg;
+	inet_ep2_t epp;
+	uint8_t data[800];
+	int i;
+
+	inet_ep2_init(&epp);
+	inet_addr(&epp.local.addr, 127, 0, 0, 1);
+	inet_addr(&epp.remote.addr, 127, 0, 0, 1);
+	epp.local.port = inet_port_user_lo;
+	epp.remote.port = inet_port_user_lo;
+
+	/* XXX tqueue can only be created via tcp_conn_new */
+	conn = tcp_conn_new(&epp);
+	PCUT_ASSERT_NOT_NULL(conn);
+
+	conn->cstate = st_established;
+	conn->snd_una = 10;
+	conn->snd_nxt = 10;
+	conn->rcv_nxt = 100;
+	conn->cc = &tcp_cc_newreno;
+
+	/* Redirect segment transmission */
+	conn->retransmit.cb = &tqueue_test_cb;
+	seg_cnt = 0;
+
+	for (i = 0; i < 800; i++)
+		data[i] = i;
+
+	/* Eight segments of 100 bytes merged into one */
+	seg = tcp_segment_make_data(CTL_ACK, data, 800);
+	PCUT_ASSERT_NOT_NULL(seg);
+	seg->seq = 100;
+	seg->ack = 10;
+	seg->wnd = 1024;
+	seg->gro_segs = 8;
+
+	tcp_conn_segment_arrived(conn, &epp, seg);
+
+	/* One ACK for every second segment */
+	PCUT_ASSERT_INT_EQUALS(4, seg_cnt);
+	for (i = 0; i < 4; i++) {
+		PCUT_ASSERT_INT_EQUALS(CTL_ACK, trans_seg[i]->ctrl);
+		PCUT_ASSERT_INT_EQUALS(300 + 200 * i, trans_seg[i]->ack);
+	}
+
+	PCUT_ASSERT_INT_EQUALS(900, conn->rcv_nxt);
+
+	/* Five segments of 100 bytes merged into one */
+	seg = tcp_segment_make_data(CTL_ACK, data, 500);
+	PCUT_ASSERT_NOT_NULL(seg);
+	seg->seq = 900;
+	seg->ack = 10;
+	seg->wnd = 1024;
+	seg->gro_segs = 5;
+
+	tcp_conn_segment_arrived(conn, &epp, seg);
+
+	/* The last, odd segment is acknowledged on its own */
+	PCUT_ASSERT_INT_EQUALS(7, seg_cnt);
+	PCUT_ASSERT_INT_EQUALS(1100, trans_seg[4]->ack);
+	PCUT_ASSERT_INT_EQUALS(1300, trans_seg[5]->ack);
+	PCUT_ASSERT_INT_EQUALS(1400, trans_seg[6]->ack);
+
+	PCUT_ASSERT_INT_EQUALS(1400, conn->rcv_nxt);
+
+	tcp_conn_lock(conn);
+	tcp_conn_reset(conn);
+	tcp_conn_unlock(conn);
+	tcp_conn_delete(conn);
+
+	for (i = 0; i < seg_cnt; i++)
+		tcp_segment_delete(trans_seg[i]);
+}
+
 static void tqueue_test_transmit_seg(inet_ep2_t *epp, tcp_segment_t *seg)
 {
 	trans_seg[seg_cnt++] = tcp_segment_dup(seg);
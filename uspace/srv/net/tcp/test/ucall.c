@@ -27,11 +27,18 @@
  */
 
 #include <errno.h>
+#include <fibril.h>
 #include <inet/endpoint.h>
 #include <io/log.h>
+#include <macros.h>
+#include <mem.h>
 #include <pcut/pcut.h>
+#include <stdlib.h>
+#include <time.h>
 
+#include "../cc.h"
 #include "../conn.h"
+#include "../ncsim.h"
 #include "../rqueue.h"
 #include "../ucall.h"
 
@@ -39,16 +46,40 @@ PCUT_INIT;
 
 PCUT_TEST_SUITE(ucall);
 
+enum {
+	/** Amount of data to transfer in bulk transfer test */
+	bulk_xfer_size = 1024 * 1024,
+	/** Size of user send calls in bulk transfer test */
+	bulk_xfer_chunk = 16 * 1024,
+	/** One-way delay in bulk transfer test (usec) */
+	bulk_xfer_delay = 5000,
+	/** Probability of dropping a segment in lossy transfer test (1/1000) */
+	bulk_xfer_drop_pm = 10
+};
+
+/** Sender fibril state for bulk transfer test */
+typedef struct {
+	tcp_conn_t *conn;
+	uint8_t *data;
+	size_t size;
+	tcp_error_t trc;
+	bool done;
+} test_sender_t;
+
 static void test_cstate_change(tcp_conn_t *, void *, tcp_cstate_t);
+static void test_recv_data(tcp_conn_t *, void *);
 static void test_conns_establish(tcp_conn_t **, tcp_conn_t **);
 static void test_conns_tear_down(tcp_conn_t *, tcp_conn_t *);
+static nsec_t test_bulk_xfer(tcp_conn_t *, tcp_conn_t *, uint8_t *,
+    uint8_t *);
 
 static tcp_rqueue_cb_t test_rqueue_cb = {
 	.seg_received = tcp_as_segment_arrived
 };
 
 static tcp_cb_t test_conn_cb = {
-	.cstate_change = test_cstate_change
+	.cstate_change = test_cstate_change,
+	.recv_data = test_recv_data
 };
 
 static tcp_conn_status_t cconn_status;
@@ -56,6 +87,7 @@ static tcp_conn_status_t sconn_status;
 
 static FIBRIL_MUTEX_INITIALIZE(cst_lock);
 static FIBRIL_CONDVAR_INITIALIZE(cst_cv);
+static unsigned recv_cnt;
 
 PCUT_TEST_BEFORE
 {
@@ -235,6 +267,230 @@ PCUT_TEST(conn_est_close_simult)
 	test_conns_tear_down(cconn, sconn);
 }
 
+/** Sender fibril for bulk transfer test. */
+static errno_t test_sender_fibril(void *arg)
+{
+	test_sender_t *sender = (test_sender_t *) arg;
+	size_t pos;
+	size_t chunk;
+	tcp_error_t trc;
+
+	trc = TCP_EOK;
+	pos = 0;
+	while (pos < sender->size) {
+		chunk = min(bulk_xfer_chunk, sender->size - pos);
+		trc = tcp_uc_send(sender->conn, sender->data + pos, chunk, 0);
+		if (trc != TCP_EOK)
+			break;
+		pos += chunk;
+	}
+
+	fibril_mutex_lock(&cst_lock);
+	sender->trc = trc;
+	sender->done = true;
+	fibril_mutex_unlock(&cst_lock);
+	fibril_condvar_broadcast(&cst_cv);
+
+	return 0;
+}
+
+/** Test bulk data transfer over a path with latency (similar to iperf).
+ *
+ * The segments are looped back via the network condition simulator
+ * which adds delay. For good throughput window scaling must be
+ * negotiated and the receive buffer must be grown by auto-tuning.
+ */
+PCUT_TEST(bulk_xfer_latency)
+{
+	tcp_conn_t *cconn, *sconn;
+	tcp_ncsim_cfg_t cfg;
+	uint8_t *sbuf, *rbuf;
+	nsec_t elapsed;
+	size_t i;
+
+	tcp_ncsim_init();
+	cfg.delay = bulk_xfer_delay;
+	cfg.jitter = 0;
+	cfg.drop_pm = 0;
+	tcp_ncsim_set_cfg(&cfg);
+	tcp_ncsim_fibril_start();
+
+	tcp_conn_lb = tcp_lb_ncsim;
+
+	sbuf = malloc(bulk_xfer_size);
+	PCUT_ASSERT_NOT_NULL(sbuf);
+	rbuf = malloc(bulk_xfer_size);
+	PCUT_ASSERT_NOT_NULL(rbuf);
+
+	for (i = 0; i < bulk_xfer_size; i++)
+		sbuf[i] = (uint8_t) (i % 251);
+
+	test_conns_establish(&cconn, &sconn);
+
+	/* Window scaling and timestamps should be negotiated */
+	PCUT_ASSERT_TRUE(cconn->ws_ok);
+	PCUT_ASSERT_TRUE(sconn->ws_ok);
+	PCUT_ASSERT_TRUE(cconn->ts_ok);
+	PCUT_ASSERT_TRUE(sconn->ts_ok);
+
+	elapsed = test_bulk_xfer(cconn, sconn, sbuf, rbuf);
+
+	/* Receive buffer should have been grown by auto-tuning */
+	PCUT_ASSERT_TRUE(sconn->rcv_buf_size > tcp_conn_bufcfg.rcv_buf_init);
+
+	log_msg(LOG_DEFAULT, LVL_NOTE, "bulk_xfer_latency: %zu bytes in "
+	    "%lld ms (%lld KiB/s), receive buffer %zu bytes",
+	    (size_t) bulk_xfer_size, NSEC2MSEC(elapsed),
+	    elapsed > 0 ? (long long) (SEC2NSEC(1) / 1024 *
+	    bulk_xfer_size / elapsed) : 0LL, sconn->rcv_buf_size);
+
+	test_conns_tear_down(cconn, sconn);
+	tcp_ncsim_fini();
+
+	free(sbuf);
+	free(rbuf);
+}
+
+/** Test bulk data transfer over a lossy path.
+ *
+ * The network condition simulator drops a fraction of segments, the data
+ * must be delivered intact by means of fast retransmit, SACK-based
+ * recovery and retransmission timeouts. Run with each congestion
+ * control algorithm.
+ */
+PCUT_TEST(bulk_xfer_loss)
+{
+	tcp_conn_t *cconn, *sconn;
+	tcp_ncsim_cfg_t cfg;
+	uint8_t *sbuf, *rbuf;
+	const char *algs[] = { "newreno", "cubic" };
+	nsec_t elapsed;
+	errno_t rc;
+	size_t i;
+	unsigned j;
+
+	tcp_ncsim_init();
+	cfg.delay = bulk_xfer_delay;
+	cfg.jitter = 0;
+	cfg.drop_pm = 0;
+	tcp_ncsim_set_cfg(&cfg);
+	tcp_ncsim_fibril_start();
+
+	tcp_conn_lb = tcp_lb_ncsim;
+
+	sbuf = malloc(bulk_xfer_size);
+	PCUT_ASSERT_NOT_NULL(sbuf);
+	rbuf = malloc(bulk_xfer_size);
+	PCUT_ASSERT_NOT_NULL(rbuf);
+
+	for (i = 0; i < bulk_xfer_size; i++)
+		sbuf[i] = (uint8_t) (i % 251);
+
+	for (j = 0; j < sizeof(algs) / sizeof(algs[0]); j++) {
+		rc = tcp_cc_set_default(algs[j]);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+		test_conns_establish(&cconn, &sconn);
+		PCUT_ASSERT_TRUE(cconn->sack_ok);
+		PCUT_ASSERT_TRUE(sconn->sack_ok);
+
+		/* Only drop segments once the connection is established */
+		cfg.drop_pm = bulk_xfer_drop_pm;
+		tcp_ncsim_set_cfg(&cfg);
+
+		memset(rbuf, 0, bulk_xfer_size);
+		elapsed = test_bulk_xfer(cconn, sconn, sbuf, rbuf);
+
+		cfg.drop_pm = 0;
+		tcp_ncsim_set_cfg(&cfg);
+
+		/* Loss must have been detected */
+		PCUT_ASSERT_TRUE(cconn->ssthresh != UINT32_MAX);
+
+		log_msg(LOG_DEFAULT, LVL_NOTE, "bulk_xfer_loss: %s: %zu bytes "
+		    "in %lld ms, cwnd %" PRIu32 ", ssthresh %" PRIu32 ", "
+		    "RTO %lld us", algs[j], (size_t) bulk_xfer_size,
+		    NSEC2MSEC(elapsed), cconn->cwnd, cconn->ssthresh,
+		    (long long) cconn->rto);
+
+		test_conns_tear_down(cconn, sconn);
+	}
+
+	rc = tcp_cc_set_default("cubic");
+	PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+
+	tcp_ncsim_fini();
+
+	free(sbuf);
+	free(rbuf);
+}
+
+/** Transfer data from @a cconn to @a sconn and verify it.
+ *
+ * @param cconn		Sending connection
+ * @param sconn		Receiving connection
+ * @param sbuf		Data to send (bulk_xfer_size bytes)
+ * @param rbuf		Receive buffer (bulk_xfer_size bytes)
+ * @return		Time taken to transfer the data
+ */
+static nsec_t test_bulk_xfer(tcp_conn_t *cconn, tcp_conn_t *sconn,
+    uint8_t *sbuf, uint8_t *rbuf)
+{
+	test_sender_t sender;
+	struct timespec t0, t1;
+	size_t rcvd_total;
+	size_t rcvd;
+	xflags_t xflags;
+	unsigned cnt;
+	tcp_error_t trc;
+	fid_t fid;
+
+	sender.conn = cconn;
+	sender.data = sbuf;
+	sender.size = bulk_xfer_size;
+	sender.trc = TCP_EOK;
+	sender.done = false;
+
+	getuptime(&t0);
+
+	fid = fibril_create(test_sender_fibril, &sender);
+	PCUT_ASSERT_TRUE(fid != 0);
+	fibril_add_ready(fid);
+
+	rcvd_total = 0;
+	while (rcvd_total < bulk_xfer_size) {
+		fibril_mutex_lock(&cst_lock);
+		cnt = recv_cnt;
+		fibril_mutex_unlock(&cst_lock);
+
+		trc = tcp_uc_receive(sconn, rbuf + rcvd_total,
+		    bulk_xfer_size - rcvd_total, &rcvd, &xflags);
+		if (trc == TCP_EAGAIN) {
+			/* Wait for more data */
+			fibril_mutex_lock(&cst_lock);
+			while (recv_cnt == cnt)
+				fibril_condvar_wait(&cst_cv, &cst_lock);
+			fibril_mutex_unlock(&cst_lock);
+			continue;
+		}
+
+		PCUT_ASSERT_INT_EQUALS(TCP_EOK, trc);
+		rcvd_total += rcvd;
+	}
+
+	getuptime(&t1);
+
+	fibril_mutex_lock(&cst_lock);
+	while (!sender.done)
+		fibril_condvar_wait(&cst_cv, &cst_lock);
+	fibril_mutex_unlock(&cst_lock);
+
+	PCUT_ASSERT_INT_EQUALS(TCP_EOK, sender.trc);
+	PCUT_ASSERT_INT_EQUALS(0, memcmp(sbuf, rbuf, bulk_xfer_size));
+
+	return ts_sub_diff(&t1, &t0);
+}
+
 static void test_cstate_change(tcp_conn_t *conn, void *arg,
     tcp_cstate_t old_state)
 {
@@ -246,6 +502,14 @@ static void test_cstate_change(tcp_conn_t *conn, void *arg,
 	fibril_condvar_broadcast(&cst_cv);
 }
 
+static void test_recv_data(tcp_conn_t *conn, void *arg)
+{
+	fibril_mutex_lock(&cst_lock);
+	++recv_cnt;
+	fibril_mutex_unlock(&cst_lock);
+	fibril_condvar_broadcast(&cst_cv);
+}
+
 /** Establish client-server connection */
 static void test_conns_establish(tcp_conn_t **rcconn, tcp_conn_t **rsconn)
 {
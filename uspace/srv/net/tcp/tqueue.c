@@ -42,17 +42,28 @@
 #include <macros.h>
 #include <mem.h>
 #include <stdlib.h>
+#include <time.h>
 
+#include "cc.h"
 #include "conn.h"
+#include "iqueue.h"
 #include "inet.h"
 #include "ncsim.h"
 #include "rqueue.h"
 #include "segment.h"
 #include "seq_no.h"
+#include "std.h"
 #include "tqueue.h"
 #include "tcp_type.h"
 
-#define RETRANSMIT_TIMEOUT	(2*1000*1000)
+/** Maximum segment size we advertise (Ethernet MTU minus IPv4/TCP headers) */
+#define ADVERTISED_MSS		1460
+
+/** Number of duplicate ACKs that trigger fast retransmit (RFC 5681) */
+#define DUPACK_THRESH		3
+
+/** Maximum number of MSS-sized segments sent as one large segment */
+#define TCP_GSO_MAX_SEGS	16
 
 static void retransmit_timeout_func(void *);
 static void tcp_tqueue_timer_set(tcp_conn_t *);
@@ -61,6 +72,11 @@ static void tcp_tqueue_seg(tcp_conn_t *, tcp_segment_t *);
 static void tcp_conn_transmit_segment(tcp_conn_t *, tcp_segment_t *);
 static void tcp_prepare_transmit_segment(tcp_conn_t *, tcp_segment_t *);
 static void tcp_tqueue_send_immed(tcp_conn_t *, tcp_segment_t *);
+static void tcp_tqueue_set_opts(tcp_conn_t *, tcp_segment_t *);
+static void tcp_tqueue_retransmit(tcp_conn_t *, tcp_tqueue_entry_t *);
+static void tcp_tqueue_xmit(tcp_conn_t *);
+static errno_t tcp_tqueue_split(tcp_conn_t *, tcp_tqueue_entry_t *);
+static void tcp_tqueue_split_all(tcp_conn_t *);
 
 errno_t tcp_tqueue_init(tcp_tqueue_t *tqueue, tcp_conn_t *conn,
     tcp_tqueue_cb_t *cb)
@@ -147,10 +163,22 @@ static void tcp_tqueue_seg(tcp_conn_t *conn, tcp_segment_t *seg)
 		tqe->seg = rt_seg;
 		rt_seg->seq = conn->snd_nxt;
 
+		/* Start retransmission timer unless it is already running */
+		if (list_empty(&conn->retransmit.list))
+			tcp_tqueue_timer_set(conn);
+
 		list_append(&tqe->link, &conn->retransmit.list);
 
-		/* Set retransmission timer */
-		tcp_tqueue_timer_set(conn);
+		/*
+		 * Time the segment to measure round-trip time unless
+		 * we get samples from the timestamps option.
+		 */
+		if (!conn->ts_ok && !conn->rtt_active &&
+		    tcp_segment_text_size(seg) > 0) {
+			conn->rtt_active = true;
+			conn->rtt_seq = conn->snd_nxt + seg->len;
+			getuptime(&conn->rtt_time);
+		}
 	}
 
 	tcp_prepare_transmit_segment(conn, seg);
@@ -172,94 +200,224 @@ static void tcp_prepare_transmit_segment(tcp_conn_t *conn, tcp_segment_t *seg)
 	tcp_conn_transmit_segment(conn, seg);
 }
 
+/** Determine if amount of data in the network is estimated using SACK.
+ *
+ * @param conn	Connection
+ * @return	@c true if tcp_tqueue_pipe() needs to be used
+ */
+static bool tcp_tqueue_pipe_mode(tcp_conn_t *conn)
+{
+	return conn->ca_state == tcp_ca_loss ||
+	    (conn->ca_state == tcp_ca_recovery && conn->sack_ok);
+}
+
+/** Determine if segment is deemed lost during loss recovery.
+ *
+ * After retransmission timeout all segments sent before the timeout
+ * are deemed lost. During fast recovery, segments that have not been
+ * selectively acknowledged, but some later data has, are deemed lost.
+ *
+ * @param conn	Connection
+ * @param tqe	Retransmission queue entry
+ * @return	@c true if segment is deemed lost
+ */
+static bool tcp_tqueue_seg_lost(tcp_conn_t *conn, tcp_tqueue_entry_t *tqe)
+{
+	if (tqe->sacked)
+		return false;
+
+	/* Segment sent after loss recovery started */
+	if ((int32_t) (tqe->seg->seq - conn->recover) >= 0)
+		return false;
+
+	if (conn->ca_state == tcp_ca_loss)
+		return true;
+
+	return (int32_t) (tqe->seg->seq - conn->sack_high) < 0;
+}
+
+/** Estimate amount of data in the network during loss recovery.
+ *
+ * Segments that have been selectively acknowledged or that are deemed
+ * lost (and have not been retransmitted) are not counted (pipe,
+ * RFC 6675 section 4).
+ *
+ * @param conn	Connection
+ * @return	Number of sequence numbers in the network
+ */
+static uint32_t tcp_tqueue_pipe(tcp_conn_t *conn)
+{
+	uint32_t pipe;
+
+	pipe = 0;
+	list_foreach(conn->retransmit.list, link, tcp_tqueue_entry_t, tqe) {
+		if (tqe->sacked)
+			continue;
+		if (!tqe->rexmit && tcp_tqueue_seg_lost(conn, tqe))
+			continue;
+		pipe += tqe->seg->len;
+	}
+
+	return pipe;
+}
+
 /** Transmit data from the send buffer.
+ *
+ * Send as much data as the send window and the congestion window allow,
+ * split into segments of at most one maximum segment size.
+ *
+ * Unless we are recovering from loss, data for up to TCP_GSO_MAX_SEGS
+ * segments is moved to one large segment, which is only split into
+ * MSS-sized segments right before it is handed to the network layer.
+ * This saves allocating, queueing and acknowledging each of them
+ * separately.
  *
  * @param conn	Connection
  */
 void tcp_tqueue_new_data(tcp_conn_t *conn)
 {
-	size_t avail_wnd;
+	uint32_t avail_wnd;
+	uint32_t flight;
 	size_t xfer_seqlen;
 	size_t snd_buf_seqlen;
 	size_t data_size;
+	size_t mss;
+	size_t seg_max;
 	tcp_control_t ctrl;
 	bool send_fin;
+	bool sent;
 
 	tcp_segment_t *seg;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_tqueue_new_data()", conn->name);
 
-	/* Number of free sequence numbers in send window */
-	avail_wnd = (conn->snd_una + conn->snd_wnd) - conn->snd_nxt;
-	snd_buf_seqlen = conn->snd_buf_used + (conn->snd_buf_fin ? 1 : 0);
+	/* Timestamp option takes space from each segment */
+	mss = conn->snd_mss;
+	if (conn->ts_ok && mss > 2 + OPT_TIMESTAMP_LEN)
+		mss -= 2 + OPT_TIMESTAMP_LEN;
 
-	xfer_seqlen = min(snd_buf_seqlen, avail_wnd);
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: snd_buf_seqlen = %zu, SND.WND = %" PRIu32 ", "
-	    "xfer_seqlen = %zu", conn->name, snd_buf_seqlen, conn->snd_wnd,
-	    xfer_seqlen);
+	seg_max = mss;
+	if (conn->ca_state == tcp_ca_open)
+		seg_max *= TCP_GSO_MAX_SEGS;
 
-	if (xfer_seqlen == 0)
-		return;
+	sent = false;
 
-	/* XXX Do not always send immediately */
+	if (tcp_tqueue_pipe_mode(conn))
+		flight = tcp_tqueue_pipe(conn);
+	else
+		flight = tcp_cc_flight(conn);
+
+	while (true) {
+		/* Number of free sequence numbers in send window */
+		avail_wnd = (conn->snd_una + conn->snd_wnd) - conn->snd_nxt;
+		if ((int32_t) avail_wnd < 0) {
+			/* Window has shrunk below SND.NXT */
+			avail_wnd = 0;
+		}
 
-	send_fin = conn->snd_buf_fin && xfer_seqlen == snd_buf_seqlen;
-	data_size = xfer_seqlen - (send_fin ? 1 : 0);
+		/* Limit by congestion window */
+		avail_wnd = min(avail_wnd,
+		    conn->cwnd > flight ? conn->cwnd - flight : 0);
 
-	if (send_fin) {
-		log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Sending out FIN.", conn->name);
-		/* We are sending out FIN */
-		ctrl = CTL_FIN;
-	} else {
-		ctrl = 0;
-	}
+		snd_buf_seqlen = conn->snd_buf_used + (conn->snd_buf_fin ? 1 : 0);
 
-	seg = tcp_segment_make_data(ctrl, conn->snd_buf, data_size);
-	if (seg == NULL) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failure.");
-		return;
-	}
+		xfer_seqlen = min(snd_buf_seqlen, avail_wnd);
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: snd_buf_seqlen = %zu, SND.WND = %" PRIu32 ", "
+		    "CWND = %" PRIu32 ", xfer_seqlen = %zu", conn->name,
+		    snd_buf_seqlen, conn->snd_wnd, conn->cwnd, xfer_seqlen);
 
-	/* Remove data from send buffer */
-	memmove(conn->snd_buf, conn->snd_buf + data_size,
-	    conn->snd_buf_used - data_size);
-	conn->snd_buf_used -= data_size;
+		if (xfer_seqlen == 0)
+			break;
 
-	if (send_fin)
-		conn->snd_buf_fin = false;
+		/*
+		 * Avoid sending a small segment if more data is waiting
+		 * and an ACK will open the window (RFC 1122 4.2.3.4).
+		 */
+		if (xfer_seqlen < snd_buf_seqlen && xfer_seqlen < mss &&
+		    flight > 0)
+			break;
 
-	fibril_condvar_broadcast(&conn->snd_buf_cv);
+		/* XXX Do not always send immediately */
 
-	if (send_fin)
-		tcp_conn_fin_sent(conn);
+		send_fin = conn->snd_buf_fin && xfer_seqlen == snd_buf_seqlen;
+		data_size = xfer_seqlen - (send_fin ? 1 : 0);
 
-	tcp_tqueue_seg(conn, seg);
-	tcp_segment_delete(seg);
+		if (data_size > seg_max) {
+			/* Segment is limited by MSS, FIN goes in a later one */
+			data_size = seg_max;
+			send_fin = false;
+		}
+
+		if (send_fin) {
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: Sending out FIN.", conn->name);
+			/* We are sending out FIN */
+			ctrl = CTL_FIN;
+		} else {
+			ctrl = 0;
+		}
+
+		seg = tcp_segment_make_data(ctrl, NULL, data_size);
+		if (seg == NULL) {
+			log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failure.");
+			break;
+		}
+
+		/* Move data from send buffer to segment */
+		tcp_conn_snd_buf_get(conn, seg->data, data_size);
+
+		if (data_size > mss)
+			seg->gso_size = mss;
+
+		if (send_fin)
+			conn->snd_buf_fin = false;
+
+		sent = true;
+
+		if (send_fin)
+			tcp_conn_fin_sent(conn);
+
+		flight += seg->len;
+		tcp_tqueue_seg(conn, seg);
+		tcp_segment_delete(seg);
+	}
+
+	if (sent)
+		fibril_condvar_broadcast(&conn->snd_buf_cv);
 }
 
 /** Remove ACKed segments from retransmission queue and possibly transmit
  * more data.
  *
  * This should be called when SND.UNA is updated due to incoming ACK.
+ * Newly acknowledged data grows the congestion window or advances
+ * loss recovery.
  */
 void tcp_tqueue_ack_received(tcp_conn_t *conn)
 {
 	link_t *cur, *next;
+	tcp_tqueue_entry_t *tqe;
+	uint32_t acked;
+	uint32_t trim;
+	bool removed;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_tqueue_ack_received(%p)", conn->name,
 	    conn);
 
+	acked = 0;
+	removed = false;
+
 	cur = conn->retransmit.list.head.next;
 
 	while (cur != &conn->retransmit.list.head) {
 		next = cur->next;
 
-		tcp_tqueue_entry_t *tqe = list_get_instance(cur,
-		    tcp_tqueue_entry_t, link);
+		tqe = list_get_instance(cur, tcp_tqueue_entry_t, link);
 
 		if (seq_no_segment_acked(conn, tqe->seg, conn->snd_una)) {
 			/* Remove acknowledged segment */
 			list_remove(cur);
+			acked += tcp_segment_text_size(tqe->seg);
+			removed = true;
 
 			if ((tqe->seg->ctrl & CTL_FIN) != 0) {
 				log_msg(LOG_DEFAULT, LVL_DEBUG, "Fin has been acked");
@@ -273,6 +431,15 @@ void tcp_tqueue_ack_received(tcp_conn_t *conn)
 			tcp_segment_delete(tqe->seg);
 			free(tqe);
 
+			/* Reset retransmission timer */
+			tcp_tqueue_timer_set(conn);
+		} else if (tqe->seg->gso_size != 0 &&
+		    (int32_t) (conn->snd_una - tqe->seg->seq) > 0) {
+			/* Large segment acknowledged in part, drop acked text */
+			trim = conn->snd_una - tqe->seg->seq;
+			tcp_segment_trim(tqe->seg, trim, 0);
+			acked += trim;
+
 			/* Reset retransmission timer */
 			tcp_tqueue_timer_set(conn);
 		}
@@ -284,27 +451,395 @@ void tcp_tqueue_ack_received(tcp_conn_t *conn)
 	if (list_empty(&conn->retransmit.list))
 		tcp_tqueue_timer_clear(conn);
 
-	/* Possibly transmit more data */
+	switch (conn->ca_state) {
+	case tcp_ca_open:
+		tcp_cc_ack(conn, acked);
+		break;
+	case tcp_ca_recovery:
+		if ((int32_t) (conn->snd_una - conn->recover) >= 0) {
+			/* Full acknowledgement, deflate window (RFC 6582 3.2) */
+			conn->cwnd = min(conn->ssthresh,
+			    max(tcp_cc_flight(conn), conn->snd_mss) +
+			    conn->snd_mss);
+			conn->ca_state = tcp_ca_open;
+			log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: fast recovery done, "
+			    "cwnd=%" PRIu32, conn->name, conn->cwnd);
+			break;
+		}
+
+		if (!removed)
+			break;
+
+		/*
+		 * Partial acknowledgement: the first unacknowledged segment
+		 * has most likely been lost as well.
+		 */
+		if (!conn->sack_ok && conn->cwnd > conn->snd_mss) {
+			conn->cwnd -= min(acked, conn->cwnd - conn->snd_mss);
+			if (acked >= conn->snd_mss)
+				tcp_cc_cwnd_inc(conn, conn->snd_mss);
+		}
+
+		cur = list_first(&conn->retransmit.list);
+		if (cur != NULL) {
+			tqe = list_get_instance(cur, tcp_tqueue_entry_t, link);
+			if (!tqe->sacked && !tqe->rexmit)
+				tcp_tqueue_retransmit(conn, tqe);
+		}
+		break;
+	case tcp_ca_loss:
+		if ((int32_t) (conn->snd_una - conn->recover) >= 0)
+			conn->ca_state = tcp_ca_open;
+		tcp_cc_ack(conn, acked);
+		break;
+	}
+
+	/* Possibly retransmit lost segments and transmit more data */
+	tcp_tqueue_xmit(conn);
+}
+
+/** Process duplicate acknowledgement.
+ *
+ * Enter fast retransmit and fast recovery on the third duplicate ACK
+ * (RFC 5681 section 3.2, RFC 6582). With SACK the recovery is driven
+ * by the estimate of data in the network (RFC 6675), without SACK the
+ * congestion window is inflated by each duplicate ACK.
+ *
+ * @param conn	Connection
+ */
+void tcp_tqueue_dupack_received(tcp_conn_t *conn)
+{
+	link_t *link;
+
+	++conn->dupacks;
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: duplicate ACK #%u",
+	    conn->name, conn->dupacks);
+
+	switch (conn->ca_state) {
+	case tcp_ca_open:
+		if (conn->dupacks < DUPACK_THRESH)
+			break;
+
+		link = list_first(&conn->retransmit.list);
+		if (link == NULL)
+			break;
+
+		tcp_cc_loss(conn);
+		conn->ca_state = tcp_ca_recovery;
+		conn->recover = conn->snd_nxt;
+		tcp_tqueue_split_all(conn);
+		if (conn->sack_ok)
+			conn->cwnd = conn->ssthresh;
+		else
+			conn->cwnd = conn->ssthresh + DUPACK_THRESH * conn->snd_mss;
+
+		log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: fast retransmit", conn->name);
+		tcp_tqueue_retransmit(conn,
+		    list_get_instance(link, tcp_tqueue_entry_t, link));
+		break;
+	case tcp_ca_recovery:
+		if (!conn->sack_ok)
+			tcp_cc_cwnd_inc(conn, conn->snd_mss);
+		break;
+	case tcp_ca_loss:
+		break;
+	}
+
+	tcp_tqueue_xmit(conn);
+}
+
+/** Process SACK option of an incoming acknowledgement.
+ *
+ * Mark segments covered by the SACK blocks as selectively acknowledged
+ * so that they are not retransmitted.
+ *
+ * @param conn	Connection
+ * @param seg	Incoming segment
+ * @return	@c true if any segment has been newly marked
+ */
+bool tcp_tqueue_sack_received(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	tcp_sack_block_t *blk;
+	uint32_t sstart;
+	uint32_t send;
+	unsigned i;
+	bool marked;
+
+	if (!conn->sack_ok || (seg->opts & SOPT_SACK) == 0)
+		return false;
+
+	marked = false;
+
+	if ((int32_t) (conn->sack_high - conn->snd_una) < 0)
+		conn->sack_high = conn->snd_una;
+
+	for (i = 0; i < seg->sack_cnt; i++) {
+		blk = &seg->sack[i];
+
+		/* Ignore blocks outside of SND.UNA..SND.NXT (e.g. D-SACK) */
+		if ((int32_t) (blk->start - conn->snd_una) <= 0 ||
+		    (int32_t) (blk->end - conn->snd_nxt) > 0 ||
+		    (int32_t) (blk->end - blk->start) <= 0)
+			continue;
+
+		list_foreach(conn->retransmit.list, link, tcp_tqueue_entry_t,
+		    tqe) {
+			sstart = tqe->seg->seq;
+			send = tqe->seg->seq + tqe->seg->len;
+
+			/* Large segment only covered in part, split it up */
+			if (tqe->seg->gso_size != 0 &&
+			    (int32_t) (send - blk->start) > 0 &&
+			    (int32_t) (sstart - blk->end) < 0 &&
+			    ((int32_t) (sstart - blk->start) < 0 ||
+			    (int32_t) (send - blk->end) > 0)) {
+				(void) tcp_tqueue_split(conn, tqe);
+				send = tqe->seg->seq + tqe->seg->len;
+			}
+
+			if (!tqe->sacked &&
+			    (int32_t) (sstart - blk->start) >= 0 &&
+			    (int32_t) (send - blk->end) <= 0) {
+				tqe->sacked = true;
+				marked = true;
+			}
+		}
+
+		if ((int32_t) (blk->end - conn->sack_high) > 0)
+			conn->sack_high = blk->end;
+	}
+
+	return marked;
+}
+
+/** Retransmit lost segments and transmit new data.
+ *
+ * During loss recovery retransmit segments deemed lost as long as
+ * the congestion window allows, then transmit new data.
+ *
+ * @param conn	Connection
+ */
+static void tcp_tqueue_xmit(tcp_conn_t *conn)
+{
+	uint32_t pipe;
+
+	if (tcp_tqueue_pipe_mode(conn)) {
+		pipe = tcp_tqueue_pipe(conn);
+
+		list_foreach(conn->retransmit.list, link, tcp_tqueue_entry_t,
+		    tqe) {
+			if (tqe->rexmit || !tcp_tqueue_seg_lost(conn, tqe))
+				continue;
+
+			if (pipe + tqe->seg->len > conn->cwnd)
+				break;
+
+			tcp_tqueue_retransmit(conn, tqe);
+			pipe += tqe->seg->len;
+		}
+	}
+
 	tcp_tqueue_new_data(conn);
 }
 
+/** Split large segment in retransmission queue.
+ *
+ * Replace a segment queued for retransmission, which was transmitted
+ * as several MSS-sized segments, with separate entries for each of them,
+ * so that they can be acknowledged selectively and retransmitted
+ * one by one.
+ *
+ * @param conn	Connection
+ * @param tqe	Retransmission queue entry, becomes the first part
+ * @return	EOK on success or ENOMEM
+ */
+static errno_t tcp_tqueue_split(tcp_conn_t *conn, tcp_tqueue_entry_t *tqe)
+{
+	tcp_tqueue_entry_t *ntqe;
+	tcp_tqueue_entry_t *prev;
+	tcp_segment_t *seg;
+	tcp_segment_t *pseg;
+	size_t gso_size;
+	size_t tsize;
+	size_t offs;
+
+	seg = tqe->seg;
+	gso_size = seg->gso_size;
+	if (gso_size == 0)
+		return EOK;
+
+	tsize = tcp_segment_text_size(seg);
+
+	/* Create entries for all but the first part */
+	prev = tqe;
+	for (offs = gso_size; offs < tsize; offs += gso_size) {
+		pseg = tcp_segment_slice(seg, offs, min(gso_size, tsize - offs));
+		if (pseg == NULL)
+			goto error;
+
+		ntqe = calloc(1, sizeof(tcp_tqueue_entry_t));
+		if (ntqe == NULL) {
+			tcp_segment_delete(pseg);
+			goto error;
+		}
+
+		ntqe->conn = conn;
+		ntqe->seg = pseg;
+		ntqe->sacked = tqe->sacked;
+		ntqe->rexmit = tqe->rexmit;
+		list_insert_after(&ntqe->link, &prev->link);
+		prev = ntqe;
+	}
+
+	/* First part */
+	pseg = tcp_segment_slice(seg, 0, min(gso_size, tsize));
+	if (pseg == NULL)
+		goto error;
+
+	tqe->seg = pseg;
+	tcp_segment_delete(seg);
+	return EOK;
+error:
+	log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failed.");
+
+	/* Remove the parts we have created */
+	while (prev != tqe) {
+		ntqe = prev;
+		prev = list_get_instance(ntqe->link.prev, tcp_tqueue_entry_t,
+		    link);
+		list_remove(&ntqe->link);
+		tcp_segment_delete(ntqe->seg);
+		free(ntqe);
+	}
+
+	return ENOMEM;
+}
+
+/** Split all large segments in retransmission queue.
+ *
+ * Loss recovery and SACK processing need to work with MSS-sized
+ * segments.
+ *
+ * @param conn	Connection
+ */
+static void tcp_tqueue_split_all(tcp_conn_t *conn)
+{
+	list_foreach(conn->retransmit.list, link, tcp_tqueue_entry_t, tqe) {
+		if (tcp_tqueue_split(conn, tqe) != EOK)
+			break;
+	}
+}
+
+/** Retransmit segment from retransmission queue.
+ *
+ * @param conn	Connection
+ * @param tqe	Retransmission queue entry
+ */
+static void tcp_tqueue_retransmit(tcp_conn_t *conn, tcp_tqueue_entry_t *tqe)
+{
+	tcp_segment_t *rt_seg;
+
+	rt_seg = tcp_segment_dup(tqe->seg);
+	if (rt_seg == NULL) {
+		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failed.");
+		return;
+	}
+
+	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmitting segment "
+	    "SEG.SEQ=%" PRIu32, conn->name, rt_seg->seq);
+
+	tqe->rexmit = true;
+
+	/* Karn's algorithm: do not measure RTT on retransmitted data */
+	conn->rtt_active = false;
+
+	tcp_conn_transmit_segment(conn, rt_seg);
+	tcp_segment_delete(rt_seg);
+}
+
+/** Set options of an outgoing segment.
+ *
+ * SYN segments carry MSS and, unless the peer's SYN has already arrived
+ * without them, offer window scaling, timestamps and SACK. Once
+ * negotiated, timestamps are sent in every segment. Acknowledgements
+ * without data report out-of-order data we hold in SACK blocks (these
+ * are not added to data segments so that they do not exceed the MSS).
+ *
+ * @param conn	Connection
+ * @param seg	Segment
+ */
+static void tcp_tqueue_set_opts(tcp_conn_t *conn, tcp_segment_t *seg)
+{
+	bool syn;
+	bool got_syn;
+	unsigned max_blocks;
+
+	syn = (seg->ctrl & CTL_SYN) != 0;
+	got_syn = tcp_conn_got_syn(conn);
+
+	seg->opts = 0;
+
+	if (syn) {
+		seg->opts |= SOPT_MSS;
+		seg->mss = ADVERTISED_MSS;
+
+		if (!got_syn || conn->ws_ok) {
+			seg->opts |= SOPT_WSCALE;
+			seg->wscale = conn->rcv_wscale_offer;
+		}
+
+		if (!got_syn || conn->sack_ok)
+			seg->opts |= SOPT_SACK_PERM;
+	}
+
+	if ((syn && !got_syn) || conn->ts_ok) {
+		seg->opts |= SOPT_TS;
+		seg->tsval = tcp_conn_ts_now();
+		seg->tsecr = conn->ts_recent;
+	}
+
+	if (conn->sack_ok && !syn && (seg->ctrl & CTL_ACK) != 0 &&
+	    tcp_segment_text_size(seg) == 0) {
+		/* Three blocks fit next to the timestamps option, four without */
+		max_blocks = conn->ts_ok ? TCP_SACK_BLOCKS_MAX - 1 :
+		    TCP_SACK_BLOCKS_MAX;
+		seg->sack_cnt = tcp_iqueue_sack_blocks(&conn->incoming,
+		    conn->sack_recent, seg->sack, max_blocks);
+		if (seg->sack_cnt > 0)
+			seg->opts |= SOPT_SACK;
+	}
+}
+
 static void tcp_conn_transmit_segment(tcp_conn_t *conn, tcp_segment_t *seg)
 {
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_conn_transmit_segment(%p, %p)",
 	    conn->name, conn, seg);
 
-	seg->wnd = conn->rcv_wnd;
+	if ((seg->ctrl & CTL_SYN) != 0) {
+		/* Window in SYN segments is never scaled */
+		seg->wnd = min(conn->rcv_wnd, UINT16_MAX);
+	} else {
+		seg->wnd = min(conn->rcv_wnd >> conn->rcv_wscale, UINT16_MAX);
+		conn->rcv_adv = seg->wnd;
+	}
 
 	if ((seg->ctrl & CTL_ACK) != 0)
 		seg->ack = conn->rcv_nxt;
 	else
 		seg->ack = 0;
 
+	tcp_tqueue_set_opts(conn, seg);
+
 	tcp_tqueue_send_immed(conn, seg);
 }
 
 void tcp_tqueue_send_immed(tcp_conn_t *conn, tcp_segment_t *seg)
 {
+	tcp_segment_t *pseg;
+	size_t tsize;
+	size_t offs;
+
 	log_msg(LOG_DEFAULT, LVL_DEBUG,
 	    "tcp_tqueue_send_immed(l:(%u),f:(%u), %p)",
 	    conn->ident.local.port, conn->ident.remote.port, seg);
@@ -314,14 +849,34 @@ void tcp_tqueue_send_immed(tcp_conn_t *conn, tcp_segment_t *seg)
 
 	tcp_segment_dump(seg);
 
-	conn->retransmit.cb->transmit_seg(&conn->ident, seg);
+	tsize = tcp_segment_text_size(seg);
+	if (seg->gso_size == 0 || tsize <= seg->gso_size) {
+		conn->retransmit.cb->transmit_seg(&conn->ident, seg);
+		return;
+	}
+
+	/*
+	 * Split large segment into segments of at most MSS bytes. This is
+	 * always done here, inet cannot pass the segment size down for the
+	 * NIC to segment the data.
+	 */
+	for (offs = 0; offs < tsize; offs += seg->gso_size) {
+		pseg = tcp_segment_slice(seg, offs,
+		    min(seg->gso_size, tsize - offs));
+		if (pseg == NULL) {
+			log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failed.");
+			return;
+		}
+
+		conn->retransmit.cb->transmit_seg(&conn->ident, pseg);
+		tcp_segment_delete(pseg);
+	}
 }
 
 static void retransmit_timeout_func(void *arg)
 {
 	tcp_conn_t *conn = (tcp_conn_t *) arg;
 	tcp_tqueue_entry_t *tqe;
-	tcp_segment_t *rt_seg;
 	link_t *link;
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmit_timeout_func(%p)", conn->name, conn);
@@ -345,20 +900,33 @@ static void retransmit_timeout_func(void *arg)
 
 	tqe = list_get_instance(link, tcp_tqueue_entry_t, link);
 
-	rt_seg = tcp_segment_dup(tqe->seg);
-	if (rt_seg == NULL) {
-		log_msg(LOG_DEFAULT, LVL_ERROR, "Memory allocation failed.");
-		tcp_conn_unlock(conn);
-		tcp_conn_delref(conn);
-		/* XXX Handle properly */
-		return;
+	/*
+	 * Collapse congestion window to one segment and retransmit
+	 * everything outstanding in slow start (RFC 5681 section 3.1).
+	 * Repeated timeouts do not reduce the slow start threshold again.
+	 */
+	if (conn->ca_state != tcp_ca_loss)
+		tcp_cc_loss(conn);
+	conn->cwnd = conn->snd_mss;
+	conn->ca_state = tcp_ca_loss;
+	conn->recover = conn->snd_nxt;
+	conn->dupacks = 0;
+	tcp_tqueue_split_all(conn);
+
+	/* Forget SACK information, the receiver may have discarded the data */
+	list_foreach(conn->retransmit.list, link, tcp_tqueue_entry_t, e) {
+		e->sacked = false;
+		e->rexmit = false;
 	}
+	conn->sack_high = conn->snd_una;
+
+	/* Back off the timer (RFC 6298 section 5.5) */
+	tcp_conn_rto_backoff(conn);
 
-	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: retransmitting segment", conn->name);
-	tcp_conn_transmit_segment(tqe->conn, rt_seg);
+	tcp_tqueue_retransmit(conn, tqe);
 
 	/* Reset retransmission timer */
-	fibril_timer_set_locked(conn->retransmit.timer, RETRANSMIT_TIMEOUT,
+	fibril_timer_set_locked(conn->retransmit.timer, conn->rto,
 	    retransmit_timeout_func, (void *) conn);
 
 	tcp_conn_unlock(conn);
@@ -377,7 +945,7 @@ static void tcp_tqueue_timer_set(tcp_conn_t *conn)
 	tcp_tqueue_timer_clear(conn);
 
 	tcp_conn_addref(conn);
-	fibril_timer_set_locked(conn->retransmit.timer, RETRANSMIT_TIMEOUT,
+	fibril_timer_set_locked(conn->retransmit.timer, conn->rto,
 	    retransmit_timeout_func, (void *) conn);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "### %s: tcp_tqueue_timer_set() end", conn->name);
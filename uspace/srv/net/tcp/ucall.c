@@ -147,6 +147,12 @@ tcp_error_t tcp_uc_send(tcp_conn_t *conn, void *data, size_t size,
 
 	while (size > 0) {
 		buf_free = conn->snd_buf_size - conn->snd_buf_used;
+		if (buf_free == 0) {
+			/* Grow send buffer if it cannot keep the window full */
+			tcp_conn_snd_buf_tune(conn);
+			buf_free = conn->snd_buf_size - conn->snd_buf_used;
+		}
+
 		while (buf_free == 0 && !conn->reset) {
 			log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: buf_free == 0, waiting.",
 			    conn->name);
@@ -159,12 +165,9 @@ tcp_error_t tcp_uc_send(tcp_conn_t *conn, void *data, size_t size,
 			return TCP_ERESET;
 		}
 
-		xfer_size = min(size, buf_free);
-
 		/* Copy data to buffer */
-		memcpy(conn->snd_buf + conn->snd_buf_used, data, xfer_size);
+		xfer_size = tcp_conn_snd_buf_put(conn, data, size);
 		data += xfer_size;
-		conn->snd_buf_used += xfer_size;
 		size -= xfer_size;
 
 		tcp_tqueue_new_data(conn);
@@ -215,22 +218,25 @@ tcp_error_t tcp_uc_receive(tcp_conn_t *conn, void *buf, size_t size,
 		}
 	}
 
-	/* Copy data from receive buffer to user buffer */
-	xfer_size = min(size, conn->rcv_buf_used);
-	memcpy(buf, conn->rcv_buf, xfer_size);
+	/* Move data from receive buffer to user buffer */
+	xfer_size = tcp_conn_rcv_buf_get(conn, buf, size);
 	*rcvd = xfer_size;
-
-	/* Remove data from receive buffer */
-	memmove(conn->rcv_buf, conn->rcv_buf + xfer_size, conn->rcv_buf_used -
-	    xfer_size);
-	conn->rcv_buf_used -= xfer_size;
 	conn->rcv_wnd += xfer_size;
 
+	/* Possibly grow the receive buffer and window */
+	tcp_conn_rcv_buf_tune(conn);
+
 	/* TODO */
 	*xflags = 0;
 
-	/* Send new size of receive window */
-	tcp_tqueue_ctrl_seg(conn, CTL_ACK);
+	/*
+	 * Send new size of receive window. Do not send an update if
+	 * the advertised window would not change, the peer would take
+	 * it for a duplicate ACK.
+	 */
+	if (min(conn->rcv_wnd >> conn->rcv_wscale, UINT16_MAX) !=
+	    conn->rcv_adv)
+		tcp_tqueue_ctrl_seg(conn, CTL_ACK);
 
 	log_msg(LOG_DEFAULT, LVL_DEBUG, "%s: tcp_uc_receive() - returning %zu bytes",
 	    conn->name, xfer_size);
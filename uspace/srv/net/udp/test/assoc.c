@@ -372,6 +372,60 @@ PCUT_TEST(received)
 	udp_assoc_delete(assoc);
 }
 
+/** Test allocating distinct ports to many associations and finding them */
+PCUT_TEST(add_many)
+{
+	udp_assoc_t *assoc[32];
+	bool received[32];
+	inet_ep2_t epp;
+	udp_msg_t *msg;
+	size_t i, j;
+	errno_t rc;
+
+	for (i = 0; i < 32; i++) {
+		inet_ep2_init(&epp);
+		inet_addr(&epp.remote.addr, 127, 0, 0, 1);
+		epp.remote.port = 1;
+		inet_addr(&epp.local.addr, 127, 0, 0, 1);
+
+		assoc[i] = udp_assoc_new(&epp, &test_assoc_cb,
+		    (void *) &received[i]);
+		PCUT_ASSERT_NOT_NULL(assoc[i]);
+
+		rc = udp_assoc_add(assoc[i]);
+		PCUT_ASSERT_ERRNO_VAL(EOK, rc);
+		PCUT_ASSERT_TRUE(assoc[i]->ident.local.port >= inet_port_dyn_lo);
+
+		for (j = 0; j < i; j++) {
+			PCUT_ASSERT_FALSE(assoc[i]->ident.local.port ==
+			    assoc[j]->ident.local.port);
+		}
+	}
+
+	for (i = 0; i < 32; i++) {
+		msg = udp_msg_new();
+		PCUT_ASSERT_NOT_NULL(msg);
+		msg->data_size = 1;
+		msg->data = str_dup("");
+
+		for (j = 0; j < 32; j++)
+			received[j] = false;
+
+		udp_assoc_received(&assoc[i]->ident, msg);
+
+		for (j = 0; j < 32; j++)
+			PCUT_ASSERT_INT_EQUALS(i == j, received[j]);
+
+		/* The test callback does not take ownership of the message */
+		udp_msg_delete(msg);
+	}
+
+	for (i = 0; i < 32; i++) {
+		udp_assoc_remove(assoc[i]);
+		udp_assoc_delete(assoc[i]);
+	}
+}
+
 /** Test udp_assoc_reset() */
 PCUT_TEST(reset)
 {
@@ -42,6 +42,7 @@
 #include <libarch/config.h>
 #include <ns.h>
 #include <async.h>
+#include <fibril.h>
 #include <errno.h>
 #include <str_error.h>
 #include <stdio.h>
@@ -99,6 +100,22 @@ int main(int argc, char **argv)
 		return ENOMEM;
 	}
 
+	/*
+	 * Initialize path lookup cache.
+	 */
+	if (!vfs_dcache_init()) {
+		printf("%s: Failed to initialize path lookup cache\n", NAME);
+		return ENOMEM;
+	}
+
+	/*
+	 * Initialize file page cache.
+	 */
+	if (!vfs_pcache_init()) {
+		printf("%s: Failed to initialize page cache\n", NAME);
+		return ENOMEM;
+	}
+
 	/*
 	 * Allocate and initialize the Path Lookup Buffer.
 	 */
@@ -143,6 +160,12 @@ int main(int argc, char **argv)
 		return rc;
 	}
 
+	/*
+	 * Requests touching different nodes and directories do not
+	 * serialize on each other, so let more than one thread run them.
+	 */
+	fibril_enable_multithreaded();
+
 	/*
 	 * Start accepting connections.
 	 */
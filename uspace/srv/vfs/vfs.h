@@ -123,6 +123,16 @@ typedef struct _vfs_node {
 	 */
 	fibril_rwlock_t contents_rwlock;
 
+	/**
+	 * Holding this rwlock for writing prevents others from adding or
+	 * removing entries of the directory. Holding it for reading
+	 * guarantees that the entries do not change.
+	 */
+	fibril_rwlock_t dir_rwlock;
+
+	/** Pages of the file in the page cache, protected by its mutex. */
+	list_t cpages;
+
 	struct _vfs_node *mount;
 } vfs_node_t;
 
@@ -169,7 +179,10 @@ extern fibril_mutex_t plb_mutex;/**< Mutex protecting plb and plb_entries. */
 extern uint8_t *plb;		/**< Path Lookup Buffer */
 extern list_t plb_entries;	/**< List of active PLB entries. */
 
-/** Holding this rwlock prevents changes in file system namespace. */
+/**
+ * Holding this rwlock prevents mounting and unmounting of file systems.
+ * Changes of individual directories are serialized by their dir_rwlock.
+ */
 extern fibril_rwlock_t namespace_rwlock;
 
 extern async_exch_t *vfs_exchange_grab(fs_handle_t);
@@ -180,8 +193,34 @@ extern vfs_info_t *fs_handle_to_info(fs_handle_t);
 extern errno_t vfs_get_fstypes(vfs_fstypes_t *);
 
 extern errno_t vfs_lookup_internal(vfs_node_t *, char *, int, vfs_lookup_res_t *);
+extern errno_t vfs_lookup_parent(vfs_node_t *, char *, int, vfs_node_t **,
+    char **);
 extern errno_t vfs_link_internal(vfs_node_t *, char *, vfs_triplet_t *);
 
+extern bool vfs_dcache_init(void);
+extern unsigned vfs_dcache_gen(void);
+extern bool vfs_dcache_lookup(vfs_triplet_t *, const char *, vfs_lookup_res_t *,
+    bool *);
+extern void vfs_dcache_insert(vfs_triplet_t *, const char *, vfs_lookup_res_t *,
+    unsigned);
+extern void vfs_dcache_invalidate(vfs_triplet_t *, const char *);
+extern void vfs_dcache_purge_dir(vfs_triplet_t *);
+extern void vfs_dcache_purge_fs(fs_handle_t, service_id_t);
+
+/** Page of a file kept in the page cache. */
+typedef struct vfs_cpage vfs_cpage_t;
+
+extern bool vfs_pcache_init(void);
+extern bool vfs_pcache_enabled(vfs_node_t *);
+extern errno_t vfs_pcache_get(async_exch_t *, vfs_node_t *, uint64_t,
+    vfs_cpage_t **);
+extern void vfs_pcache_put(vfs_cpage_t *);
+extern void *vfs_pcache_data(vfs_cpage_t *, size_t *);
+extern errno_t vfs_pcache_read(async_exch_t *, vfs_node_t *, aoff64_t,
+    ipc_call_t *, size_t, size_t *);
+extern void vfs_pcache_invalidate(vfs_node_t *, aoff64_t, aoff64_t);
+extern void vfs_pcache_purge(vfs_node_t *);
+
 extern bool vfs_nodes_init(void);
 extern vfs_node_t *vfs_node_get(vfs_lookup_res_t *);
 extern vfs_node_t *vfs_node_peek(vfs_lookup_res_t *result);
@@ -214,9 +253,12 @@ extern errno_t vfs_op_mtab_get(void);
 extern errno_t vfs_op_open(int fd, int flags);
 extern errno_t vfs_op_put(int fd);
 extern errno_t vfs_op_read(int fd, aoff64_t, size_t *out_bytes);
+extern errno_t vfs_op_readdir(int fd, aoff64_t, size_t *, aoff64_t *);
 extern errno_t vfs_op_rename(int basefd, char *old, char *new);
 extern errno_t vfs_op_resize(int fd, int64_t size);
 extern errno_t vfs_op_stat(int fd);
+extern errno_t vfs_op_stat_bulk(int, const char *, size_t, vfs_stat_t *,
+    errno_t *);
 extern errno_t vfs_op_statfs(int fd);
 extern errno_t vfs_op_sync(int fd);
 extern errno_t vfs_op_unlink(int parentfd, int expectfd, char *path);
@@ -0,0 +1,418 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup vfs
+ * @{
+ */
+
+/**
+ * @file	vfs_dcache.c
+ * @brief	Path lookup (directory entry) cache.
+ *
+ * The cache maps a (parent directory triplet, component name) pair to
+ * the looked up node, or remembers that the name does not exist
+ * (negative entry). Positive entries hold a reference to the VFS node,
+ * so that the node's type and size stay current while it is cached.
+ */
+
+#include "vfs.h"
+#include <adt/hash.h>
+#include <adt/hash_table.h>
+#include <adt/list.h>
+#include <fibril_synch.h>
+#include <stdlib.h>
+#include <str.h>
+
+/** Maximum number of cached entries */
+#define DCACHE_SIZE	1024
+
+/** Directory entry cache entry. */
+typedef struct {
+	/** Link in dentries hash table */
+	ht_link_t link;
+	/** Link in LRU list */
+	link_t lru_link;
+	/** Directory containing the entry */
+	vfs_triplet_t parent;
+	/** Name of the entry */
+	char *name;
+	/** Node referenced by the entry or @c NULL for negative entry */
+	vfs_node_t *node;
+} vfs_dentry_t;
+
+/** Lookup key of a directory entry. */
+typedef struct {
+	const vfs_triplet_t *parent;
+	const char *name;
+} dentry_key_t;
+
+static size_t dentries_key_hash(const void *);
+static size_t dentries_hash(const ht_link_t *);
+static bool dentries_key_equal(const void *, size_t, const ht_link_t *);
+
+static const hash_table_ops_t dentries_ops = {
+	.hash = dentries_hash,
+	.key_hash = dentries_key_hash,
+	.key_equal = dentries_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+/** Mutex protecting the cache. */
+static FIBRIL_MUTEX_INITIALIZE(dcache_mutex);
+
+/** Hash table of cached entries. */
+static hash_table_t dentries;
+
+/** Cached entries, least recently used first. */
+static LIST_INITIALIZE(dcache_lru);
+
+/** Number of cached entries. */
+static size_t dcache_count;
+
+/** Incremented with every invalidation. */
+static unsigned dcache_gen;
+
+/** Initialize the path lookup cache.
+ *
+ * @return True on success, false on failure.
+ */
+bool vfs_dcache_init(void)
+{
+	return hash_table_create(&dentries, 0, 0, &dentries_ops);
+}
+
+/** Remove entry from the cache.
+ *
+ * The entry is appended to @a dead. Its node reference must be released
+ * and the entry freed using dentry_destroy_list() after unlocking the
+ * cache, since releasing a node may require communication with the file
+ * system.
+ *
+ * @param dentry Entry to remove
+ * @param dead   List of removed entries
+ */
+static void dentry_remove(vfs_dentry_t *dentry, list_t *dead)
+{
+	hash_table_remove_item(&dentries, &dentry->link);
+	list_remove(&dentry->lru_link);
+	list_append(&dentry->lru_link, dead);
+	dcache_count--;
+}
+
+/** Destroy entries removed from the cache.
+ *
+ * @param dead List of removed entries
+ */
+static void dentry_destroy_list(list_t *dead)
+{
+	link_t *link;
+
+	while ((link = list_first(dead)) != NULL) {
+		vfs_dentry_t *dentry = list_get_instance(link, vfs_dentry_t,
+		    lru_link);
+
+		list_remove(&dentry->lru_link);
+		if (dentry->node != NULL)
+			vfs_node_put(dentry->node);
+		free(dentry->name);
+		free(dentry);
+	}
+}
+
+/** Get current cache generation.
+ *
+ * A lookup result obtained from the file system may only be inserted if
+ * the generation has not changed since before the file system was asked.
+ *
+ * @return Cache generation
+ */
+unsigned vfs_dcache_gen(void)
+{
+	fibril_mutex_lock(&dcache_mutex);
+	unsigned gen = dcache_gen;
+	fibril_mutex_unlock(&dcache_mutex);
+
+	return gen;
+}
+
+/** Look up name in the cache.
+ *
+ * @param parent Directory to look up name in
+ * @param name   Name to look up
+ * @param result Place to store lookup result of a positive entry
+ * @param found  Place to store @c false if the entry is negative
+ *
+ * @return True if the name was found in the cache.
+ */
+bool vfs_dcache_lookup(vfs_triplet_t *parent, const char *name,
+    vfs_lookup_res_t *result, bool *found)
+{
+	dentry_key_t key = {
+		.parent = parent,
+		.name = name
+	};
+
+	fibril_mutex_lock(&dcache_mutex);
+
+	ht_link_t *link = hash_table_find(&dentries, &key);
+	if (link == NULL) {
+		fibril_mutex_unlock(&dcache_mutex);
+		return false;
+	}
+
+	vfs_dentry_t *dentry = hash_table_get_inst(link, vfs_dentry_t, link);
+
+	/* Move to the end of the LRU list */
+	list_remove(&dentry->lru_link);
+	list_append(&dentry->lru_link, &dcache_lru);
+
+	if (dentry->node != NULL) {
+		vfs_node_t *node = dentry->node;
+
+		result->triplet.fs_handle = node->fs_handle;
+		result->triplet.service_id = node->service_id;
+		result->triplet.index = node->index;
+		result->type = node->type;
+		result->size = node->size;
+		*found = true;
+	} else {
+		*found = false;
+	}
+
+	fibril_mutex_unlock(&dcache_mutex);
+	return true;
+}
+
+/** Insert lookup result to the cache.
+ *
+ * @param parent Directory the name was looked up in
+ * @param name   Looked up name
+ * @param result Lookup result or @c NULL if the name does not exist
+ * @param gen    Cache generation from before the lookup was started
+ */
+void vfs_dcache_insert(vfs_triplet_t *parent, const char *name,
+    vfs_lookup_res_t *result, unsigned gen)
+{
+	vfs_dentry_t *dentry;
+	vfs_node_t *node = NULL;
+	list_t dead;
+
+	list_initialize(&dead);
+
+	dentry = calloc(1, sizeof(vfs_dentry_t));
+	if (dentry == NULL)
+		return;
+
+	dentry->name = str_dup(name);
+	if (dentry->name == NULL) {
+		free(dentry);
+		return;
+	}
+
+	if (result != NULL) {
+		node = vfs_node_get(result);
+		if (node == NULL) {
+			free(dentry->name);
+			free(dentry);
+			return;
+		}
+	}
+
+	dentry->parent = *parent;
+	dentry->node = node;
+
+	fibril_mutex_lock(&dcache_mutex);
+
+	dentry_key_t key = {
+		.parent = parent,
+		.name = name
+	};
+
+	if (gen != dcache_gen || hash_table_find(&dentries, &key) != NULL) {
+		/*
+		 * Namespace may have changed since the lookup, or another
+		 * fibril was faster.
+		 */
+		list_append(&dentry->lru_link, &dead);
+		goto out;
+	}
+
+	/* Evict least recently used entry */
+	if (dcache_count >= DCACHE_SIZE) {
+		link_t *link = list_first(&dcache_lru);
+		dentry_remove(list_get_instance(link, vfs_dentry_t, lru_link),
+		    &dead);
+	}
+
+	hash_table_insert(&dentries, &dentry->link);
+	list_append(&dentry->lru_link, &dcache_lru);
+	dcache_count++;
+
+out:
+	fibril_mutex_unlock(&dcache_mutex);
+	dentry_destroy_list(&dead);
+}
+
+/** Invalidate cached name.
+ *
+ * Must be called before the name is created, removed or relinked.
+ *
+ * @param parent Directory containing the name
+ * @param name   Name to invalidate
+ */
+void vfs_dcache_invalidate(vfs_triplet_t *parent, const char *name)
+{
+	dentry_key_t key = {
+		.parent = parent,
+		.name = name
+	};
+	list_t dead;
+
+	list_initialize(&dead);
+
+	fibril_mutex_lock(&dcache_mutex);
+
+	dcache_gen++;
+	ht_link_t *link = hash_table_find(&dentries, &key);
+	if (link != NULL) {
+		dentry_remove(hash_table_get_inst(link, vfs_dentry_t, link),
+		    &dead);
+	}
+
+	fibril_mutex_unlock(&dcache_mutex);
+	dentry_destroy_list(&dead);
+}
+
+/** Remove all cached entries matching a predicate.
+ *
+ * @param match Predicate
+ * @param arg   Argument to the predicate
+ */
+static void dcache_purge(bool (*match)(vfs_dentry_t *, void *), void *arg)
+{
+	list_t dead;
+
+	list_initialize(&dead);
+
+	fibril_mutex_lock(&dcache_mutex);
+
+	dcache_gen++;
+	list_foreach_safe(dcache_lru, cur, next) {
+		vfs_dentry_t *dentry = list_get_instance(cur, vfs_dentry_t,
+		    lru_link);
+
+		if (match(dentry, arg))
+			dentry_remove(dentry, &dead);
+	}
+
+	fibril_mutex_unlock(&dcache_mutex);
+	dentry_destroy_list(&dead);
+}
+
+static bool dentry_in_dir(vfs_dentry_t *dentry, void *arg)
+{
+	vfs_triplet_t *dir = (vfs_triplet_t *) arg;
+
+	return dentry->parent.fs_handle == dir->fs_handle &&
+	    dentry->parent.service_id == dir->service_id &&
+	    dentry->parent.index == dir->index;
+}
+
+static bool dentry_in_fs(vfs_dentry_t *dentry, void *arg)
+{
+	vfs_pair_t *fs = (vfs_pair_t *) arg;
+
+	return dentry->parent.fs_handle == fs->fs_handle &&
+	    dentry->parent.service_id == fs->service_id;
+}
+
+/** Invalidate all cached names in a directory.
+ *
+ * Used when a directory is removed, as its index may later be reused.
+ *
+ * @param dir Directory
+ */
+void vfs_dcache_purge_dir(vfs_triplet_t *dir)
+{
+	dcache_purge(dentry_in_dir, dir);
+}
+
+/** Invalidate all cached names of a file system instance.
+ *
+ * Releases the node references held by the cache, so that the file system
+ * can be unmounted.
+ *
+ * @param fs_handle  File system handle
+ * @param service_id Service ID of the file system instance
+ */
+void vfs_dcache_purge_fs(fs_handle_t fs_handle, service_id_t service_id)
+{
+	vfs_pair_t fs = {
+		.fs_handle = fs_handle,
+		.service_id = service_id
+	};
+
+	dcache_purge(dentry_in_fs, &fs);
+}
+
+static size_t dentries_key_hash(const void *key)
+{
+	const dentry_key_t *dkey = key;
+	size_t hash = hash_combine(dkey->parent->fs_handle,
+	    dkey->parent->index);
+	hash = hash_combine(hash, dkey->parent->service_id);
+	return hash_combine(hash, hash_string(dkey->name));
+}
+
+static size_t dentries_hash(const ht_link_t *item)
+{
+	vfs_dentry_t *dentry = hash_table_get_inst(item, vfs_dentry_t, link);
+	dentry_key_t key = {
+		.parent = &dentry->parent,
+		.name = dentry->name
+	};
+
+	return dentries_key_hash(&key);
+}
+
+static bool dentries_key_equal(const void *key, size_t hash,
+    const ht_link_t *item)
+{
+	const dentry_key_t *dkey = key;
+	vfs_dentry_t *dentry = hash_table_get_inst(item, vfs_dentry_t, link);
+
+	return dentry->parent.fs_handle == dkey->parent->fs_handle &&
+	    dentry->parent.service_id == dkey->parent->service_id &&
+	    dentry->parent.index == dkey->parent->index &&
+	    str_cmp(dentry->name, dkey->name) == 0;
+}
+
+/**
+ * @}
+ */
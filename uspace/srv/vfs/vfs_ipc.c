@@ -183,6 +183,18 @@ static void vfs_in_read(ipc_call_t *req)
 	async_answer_1(req, rc, bytes);
 }
 
+static void vfs_in_readdir(ipc_call_t *req)
+{
+	int fd = ipc_get_arg1(req);
+	aoff64_t pos = MERGE_LOUP32(ipc_get_arg2(req),
+	    ipc_get_arg3(req));
+
+	size_t used = 0;
+	aoff64_t npos = pos;
+	errno_t rc = vfs_op_readdir(fd, pos, &used, &npos);
+	async_answer_3(req, rc, used, LOWER32(npos), UPPER32(npos));
+}
+
 static void vfs_in_rename(ipc_call_t *req)
 {
 	/* The common base directory. */
@@ -242,6 +254,73 @@ static void vfs_in_stat(ipc_call_t *req)
 	async_answer_0(req, rc);
 }
 
+static void vfs_in_stat_bulk(ipc_call_t *req)
+{
+	int parentfd = ipc_get_arg1(req);
+	size_t count = ipc_get_arg2(req);
+	vfs_stat_t *stats = NULL;
+	errno_t *rcs = NULL;
+	char *names = NULL;
+	size_t names_size;
+	ipc_call_t call;
+	size_t size;
+
+	errno_t rc = async_data_write_accept((void **) &names, false, 1,
+	    MAX_PATH_LEN, 0, &names_size);
+	if (rc != EOK)
+		goto out;
+
+	/* Verify that the buffer holds exactly @a count names. */
+	size_t n = 0;
+	for (size_t i = 0; i < names_size; i++) {
+		if (names[i] == '\0')
+			n++;
+	}
+
+	if (count == 0 || count > VFS_STAT_BULK_MAX || n != count ||
+	    names[names_size - 1] != '\0') {
+		rc = EINVAL;
+		goto out;
+	}
+
+	stats = calloc(count, sizeof(vfs_stat_t));
+	rcs = calloc(count, sizeof(errno_t));
+	if (stats == NULL || rcs == NULL) {
+		rc = ENOMEM;
+		goto out;
+	}
+
+	rc = vfs_op_stat_bulk(parentfd, names, count, stats, rcs);
+
+out:
+	if (!async_data_read_receive(&call, &size)) {
+		async_answer_0(&call, EINVAL);
+		rc = EINVAL;
+	} else if (rc != EOK || size != count * sizeof(vfs_stat_t)) {
+		if (rc == EOK)
+			rc = EINVAL;
+		async_answer_0(&call, rc);
+	} else {
+		rc = async_data_read_finalize(&call, stats, size);
+	}
+
+	if (!async_data_read_receive(&call, &size)) {
+		async_answer_0(&call, EINVAL);
+		rc = EINVAL;
+	} else if (rc != EOK || size != count * sizeof(errno_t)) {
+		if (rc == EOK)
+			rc = EINVAL;
+		async_answer_0(&call, rc);
+	} else {
+		rc = async_data_read_finalize(&call, rcs, size);
+	}
+
+	free(names);
+	free(stats);
+	free(rcs);
+	async_answer_0(req, rc);
+}
+
 static void vfs_in_statfs(ipc_call_t *req)
 {
 	int fd = (int) ipc_get_arg1(req);
@@ -356,6 +435,9 @@ void vfs_connection(ipc_call_t *icall, void *arg)
 		case VFS_IN_READ:
 			vfs_in_read(&call);
 			break;
+		case VFS_IN_READDIR:
+			vfs_in_readdir(&call);
+			break;
 		case VFS_IN_REGISTER:
 			vfs_register(&call);
 			cont = false;
@@ -369,6 +451,9 @@ void vfs_connection(ipc_call_t *icall, void *arg)
 		case VFS_IN_STAT:
 			vfs_in_stat(&call);
 			break;
+		case VFS_IN_STAT_BULK:
+			vfs_in_stat_bulk(&call);
+			break;
 		case VFS_IN_STATFS:
 			vfs_in_statfs(&call);
 			break;
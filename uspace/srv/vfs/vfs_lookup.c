@@ -191,6 +191,9 @@ errno_t vfs_link_internal(vfs_node_t *base, char *path, vfs_triplet_t *child)
 		goto out;
 	}
 
+	/* Forget that the name did not exist */
+	vfs_dcache_invalidate(triplet, component);
+
 	async_exch_t *exch = vfs_exchange_grab(triplet->fs_handle);
 	aid_t req = async_send_3(exch, VFS_OUT_LINK, triplet->service_id,
 	    triplet->index, child->index, NULL);
@@ -237,9 +240,128 @@ static errno_t out_lookup(vfs_triplet_t *base, size_t *pfirst, size_t *plen,
 	return EOK;
 }
 
+/** Get path component.
+ *
+ * @param path      Path
+ * @param start     Index of the slash preceding the component in @a path
+ * @param len       Length of @a path
+ * @param component Buffer of NAME_MAX + 1 bytes for the component name
+ *
+ * @return Index of the end of the component in @a path. If the component
+ *         is too long, @a component is set to an empty string.
+ */
+static size_t path_component(char *path, size_t start, size_t len,
+    char *component)
+{
+	assert(path[start] == '/');
+
+	size_t end = start + 1;
+	while (end < len && path[end] != '/')
+		end++;
+
+	size_t clen = end - start - 1;
+	if (clen > NAME_MAX)
+		clen = 0;
+
+	memcpy(component, path + start + 1, clen);
+	component[clen] = '\0';
+	return end;
+}
+
+/** Look up one path component in the name cache.
+ *
+ * Names that are about to be created or removed are invalidated instead.
+ * File systems which did not opt in with cache_lookups (e.g. because they
+ * compare names case-insensitively or their names change behind the back
+ * of VFS) are never cached.
+ *
+ * @param cur       Directory to look the component up in
+ * @param component Name of the component
+ * @param lflag     Flags to be used for the component
+ * @param res       Place to store lookup result
+ * @param rc        Place to store EOK if the component was found, ENOENT
+ *                  if it does not exist or another error code
+ *
+ * @return True if the component was resolved from the cache, false if
+ *         the file system needs to be asked.
+ */
+static bool lookup_cached(vfs_triplet_t *cur, char *component, int lflag,
+    vfs_lookup_res_t *res, errno_t *rc)
+{
+	bool found;
+
+	vfs_info_t *info = fs_handle_to_info(cur->fs_handle);
+	if (info == NULL || !info->cache_lookups || component[0] == '\0')
+		return false;
+
+	if ((lflag & (L_CREATE | L_UNLINK)) != 0) {
+		/* The name is about to be created or removed */
+		vfs_dcache_invalidate(cur, component);
+		return false;
+	}
+
+	if (!vfs_dcache_lookup(cur, component, res, &found))
+		return false;
+
+	if (!found)
+		*rc = ENOENT;
+	else if ((lflag & L_FILE) && res->type == VFS_NODE_DIRECTORY)
+		*rc = EISDIR;
+	else if ((lflag & L_DIRECTORY) && res->type == VFS_NODE_FILE)
+		*rc = ENOTDIR;
+	else
+		*rc = EOK;
+
+	return true;
+}
+
+/** Cache the result of a file system lookup.
+ *
+ * The file system only returns the node it stopped in, so a positive
+ * entry can only be made if a single component was looked up. If the
+ * file system stopped early, it returned the directory in which the next
+ * component does not exist.
+ *
+ * @param cur       Directory the lookup started in
+ * @param path      Path
+ * @param start     Index in @a path where the lookup started
+ * @param stop      Index in @a path where the file system stopped
+ * @param len       Length of @a path
+ * @param lflag     Flags used for the lookup
+ * @param res       Lookup result
+ * @param gen       Cache generation from before the lookup was started
+ */
+static void lookup_cache_result(vfs_triplet_t *cur, char *path, size_t start,
+    size_t stop, size_t len, int lflag, vfs_lookup_res_t *res, unsigned gen)
+{
+	char component[NAME_MAX + 1];
+
+	vfs_info_t *info = fs_handle_to_info(cur->fs_handle);
+	if (info == NULL || !info->cache_lookups)
+		return;
+
+	if (stop < len) {
+		/* Negative entry for the component that was not found */
+		(void) path_component(path, stop, len, component);
+		if (component[0] != '\0')
+			vfs_dcache_insert(&res->triplet, component, NULL, gen);
+		return;
+	}
+
+	if (path_component(path, start, len, component) != len ||
+	    component[0] == '\0')
+		return;
+
+	if ((lflag & (L_CREATE | L_UNLINK)) == 0)
+		vfs_dcache_insert(cur, component, res, gen);
+	else if ((lflag & L_UNLINK) && res->type == VFS_NODE_DIRECTORY)
+		vfs_dcache_purge_dir(&res->triplet);
+}
+
 static errno_t _vfs_lookup_internal(vfs_node_t *base, char *path, int lflag,
     vfs_lookup_res_t *result, size_t len)
 {
+	char component[NAME_MAX + 1];
 	size_t first;
 	errno_t rc;
 
@@ -248,13 +370,11 @@ static errno_t _vfs_lookup_internal(vfs_node_t *base, char *path, int lflag,
 	if (rc != EOK)
 		return rc;
 
-	size_t next = first;
-	size_t nlen = len;
-
 	vfs_lookup_res_t res;
+	size_t cstart = 0;
 
 	/* Resolve path as long as there are mount points to cross. */
-	while (nlen > 0) {
+	while (true) {
 		while (base->mount) {
 			if (lflag & L_DISABLE_MOUNTS) {
 				rc = EXDEV;
@@ -264,31 +384,86 @@ static errno_t _vfs_lookup_internal(vfs_node_t *base, char *path, int lflag,
 			base = base->mount;
 		}
 
-		rc = out_lookup((vfs_triplet_t *) base, &next, &nlen, lflag,
-		    &res);
+		vfs_triplet_t cur = *((vfs_triplet_t *) base);
+
+		/* Resolve as many components as possible from the cache. */
+		while (len > 1 && cstart < len) {
+			size_t cend = path_component(path, cstart, len,
+			    component);
+			bool last = (cend == len);
+
+			if (!lookup_cached(&cur, component,
+			    last ? lflag : L_DIRECTORY, &res, &rc))
+				break;
+			if (rc != EOK)
+				goto out;
+
+			cstart = cend;
+			if (last)
+				break;
+
+			/* Continue in the mounted file system if any. */
+			vfs_node_t *node = vfs_node_peek(&res);
+			if (node != NULL) {
+				vfs_node_t *mp = node;
+				while (mp->mount)
+					mp = mp->mount;
+
+				if (mp != node && (lflag & L_DISABLE_MOUNTS)) {
+					vfs_node_put(node);
+					rc = EXDEV;
+					goto out;
+				}
+
+				res.triplet = *((vfs_triplet_t *) mp);
+				vfs_node_put(node);
+			}
+
+			cur = res.triplet;
+		}
+
+		if (len > 1 && cstart == len)
+			break;
+
+		/* Send the rest of the path to the file system at once. */
+		unsigned gen = vfs_dcache_gen();
+		size_t next = first + cstart;
+		size_t nlen = len - cstart;
+
+		rc = out_lookup(&cur, &next, &nlen, lflag, &res);
 		if (rc != EOK)
 			goto out;
 
+		size_t stop = len - nlen;
+
 		if (nlen > 0) {
 			base = vfs_node_peek(&res);
-			if (!base) {
-				rc = ENOENT;
-				goto out;
-			}
-			if (!base->mount) {
+			if (base != NULL && base->mount != NULL) {
 				vfs_node_put(base);
-				rc = ENOENT;
-				goto out;
-			}
-			vfs_node_put(base);
-			if (lflag & L_DISABLE_MOUNTS) {
-				rc = EXDEV;
-				goto out;
+				if (lflag & L_DISABLE_MOUNTS) {
+					rc = EXDEV;
+					goto out;
+				}
+
+				cstart = stop;
+				continue;
 			}
+
+			if (base != NULL)
+				vfs_node_put(base);
+		}
+
+		lookup_cache_result(&cur, path, cstart, stop, len, lflag, &res,
+		    gen);
+
+		if (nlen > 0) {
+			rc = ENOENT;
+			goto out;
 		}
+
+		break;
 	}
 
-	assert(nlen == 0);
 	rc = EOK;
 
 	if (result != NULL) {
@@ -321,6 +496,93 @@ out:
 	return rc;
 }
 
+/** Look up the parent directory of a canonical path.
+ *
+ * @param base    The file from which to perform the lookup.
+ * @param path    Canonical path.
+ * @param lflag   Flags to be used during lookup.
+ * @param parent  Place to store the referenced parent node.
+ *
+ * @return EOK on success or an error code from errno.h.
+ */
+static errno_t _vfs_lookup_parent(vfs_node_t *base, char *path, int lflag,
+    vfs_node_t **parent)
+{
+	char *slash = str_rchr(path, L'/');
+	vfs_lookup_res_t tres;
+	errno_t rc;
+
+	if (slash == path) {
+		vfs_node_addref(base);
+		*parent = base;
+		return EOK;
+	}
+
+	lflag &= ~(L_CREATE | L_EXCLUSIVE | L_UNLINK | L_FILE);
+	lflag |= L_DIRECTORY;
+	rc = _vfs_lookup_internal(base, path, lflag, &tres, slash - path);
+	if (rc != EOK)
+		return rc;
+
+	*parent = vfs_node_get(&tres);
+	if (*parent == NULL)
+		return ENOMEM;
+
+	return EOK;
+}
+
+/** Look up the directory containing the last component of a path.
+ *
+ * Mount points are crossed, so that the returned directory is the one
+ * that actually holds the last component. Operations which add or remove
+ * the last component should hold the directory's dir_rwlock for writing.
+ *
+ * @param base    The file from which to perform the lookup.
+ * @param path    Path to be resolved; it must be a NULL-terminated
+ *                string. It is canonified in place.
+ * @param lflag   Flags to be used during lookup.
+ * @param dir     Place to store the referenced parent directory.
+ * @param name    Place to store pointer to the last component of the
+ *                path within @a path, including the leading slash.
+ *
+ * @return EOK on success or an error code from errno.h.
+ */
+errno_t vfs_lookup_parent(vfs_node_t *base, char *path, int lflag,
+    vfs_node_t **dir, char **name)
+{
+	assert(base != NULL);
+	assert(path != NULL);
+
+	size_t len;
+	char *npath = canonify(path, &len);
+	if (!npath)
+		return EINVAL;
+	path = npath;
+
+	assert(path[0] == '/');
+
+	vfs_node_t *parent;
+	errno_t rc = _vfs_lookup_parent(base, path, lflag, &parent);
+	if (rc != EOK)
+		return rc;
+
+	while (parent->mount) {
+		if (lflag & L_DISABLE_MOUNTS) {
+			vfs_node_put(parent);
+			return EXDEV;
+		}
+
+		vfs_node_t *mp = parent->mount;
+		vfs_node_addref(mp);
+		vfs_node_put(parent);
+		parent = mp;
+	}
+
+	*dir = parent;
+	*name = str_rchr(path, L'/');
+	return EOK;
+}
+
 /** Perform a path lookup.
  *
  * @param base    The file from which to perform the lookup.
@@ -364,23 +626,11 @@ errno_t vfs_lookup_internal(vfs_node_t *base, char *path, int lflag,
 		 */
 
 		char *slash = str_rchr(path, L'/');
-		vfs_node_t *parent = base;
+		vfs_node_t *parent;
 
-		if (slash != path) {
-			int tflag = lflag;
-			vfs_lookup_res_t tres;
-
-			tflag &= ~(L_CREATE | L_EXCLUSIVE | L_UNLINK | L_FILE);
-			tflag |= L_DIRECTORY;
-			rc = _vfs_lookup_internal(base, path, tflag, &tres,
-			    slash - path);
-			if (rc != EOK)
-				return rc;
-			parent = vfs_node_get(&tres);
-			if (!parent)
-				return ENOMEM;
-		} else
-			vfs_node_addref(parent);
+		rc = _vfs_lookup_parent(base, path, lflag, &parent);
+		if (rc != EOK)
+			return rc;
 
 		rc = _vfs_lookup_internal(parent, slash, lflag, result,
 		    len - (slash - path));
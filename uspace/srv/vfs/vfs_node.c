@@ -129,6 +129,8 @@ void vfs_node_delref(vfs_node_t *node)
 		 * are no more hard links.
 		 */
 
+		vfs_pcache_purge(node);
+
 		async_exch_t *exch = vfs_exchange_grab(node->fs_handle);
 		async_msg_2(exch, VFS_OUT_DESTROY, (sysarg_t) node->service_id,
 		    (sysarg_t)node->index);
@@ -150,6 +152,7 @@ void vfs_node_forget(vfs_node_t *node)
 	fibril_mutex_lock(&nodes_mutex);
 	hash_table_remove_item(&nodes, &node->nh_link);
 	fibril_mutex_unlock(&nodes_mutex);
+	vfs_pcache_purge(node);
 	free(node);
 }
 
@@ -184,6 +187,8 @@ vfs_node_t *vfs_node_get(vfs_lookup_res_t *result)
 		node->size = result->size;
 		node->type = result->type;
 		fibril_rwlock_initialize(&node->contents_rwlock);
+		fibril_rwlock_initialize(&node->dir_rwlock);
+		list_initialize(&node->cpages);
 		hash_table_insert(&nodes, &node->nh_link);
 	} else {
 		node = hash_table_get_inst(tmp, vfs_node_t, nh_link);
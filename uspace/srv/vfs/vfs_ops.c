@@ -60,6 +60,9 @@ static errno_t vfs_truncate_internal(fs_handle_t, service_id_t, fs_index_t,
  */
 FIBRIL_RWLOCK_INITIALIZE(namespace_rwlock);
 
+/** Serializes renames. */
+static FIBRIL_MUTEX_INITIALIZE(rename_mutex);
+
 static size_t shared_path(char *a, char *b)
 {
 	size_t res = 0;
@@ -357,6 +360,21 @@ static errno_t rdwr_ipc_client(async_exch_t *exch, vfs_file_t *file, aoff64_t po
 	size_t *bytes = (size_t *) data;
 	errno_t rc;
 
+	if (read && vfs_pcache_enabled(file->node)) {
+		/* Regular file reads are served from the page cache. */
+		ipc_call_t call;
+		size_t size;
+		if (!async_data_read_receive(&call, &size)) {
+			async_answer_0(&call, EINVAL);
+			return EINVAL;
+		}
+
+		rc = vfs_pcache_read(exch, file->node, pos, &call, size,
+		    bytes);
+		ipc_set_arg1(answer, *bytes);
+		return rc;
+	}
+
 	/*
 	 * Make a VFS_READ/VFS_WRITE request at the destination FS server
 	 * and forward the IPC_M_DATA_READ/IPC_M_DATA_WRITE request to the
@@ -379,6 +397,31 @@ static errno_t rdwr_ipc_client(async_exch_t *exch, vfs_file_t *file, aoff64_t po
 	return rc;
 }
 
+/** Result of a forwarded batched directory read */
+typedef struct {
+	size_t used;
+	aoff64_t npos;
+} readdir_result_t;
+
+static errno_t rdwr_ipc_readdir(async_exch_t *exch, vfs_file_t *file,
+    aoff64_t pos, ipc_call_t *answer, bool read, void *data)
+{
+	readdir_result_t *res = (readdir_result_t *) data;
+	errno_t rc;
+
+	assert(read);
+
+	rc = async_data_read_forward_4_1(exch, VFS_OUT_READDIR,
+	    file->node->service_id, file->node->index,
+	    LOWER32(pos), UPPER32(pos), answer);
+	if (rc != EOK)
+		return rc;
+
+	res->used = ipc_get_arg1(answer);
+	res->npos = MERGE_LOUP32(ipc_get_arg2(answer), ipc_get_arg3(answer));
+	return EOK;
+}
+
 static errno_t rdwr_ipc_internal(async_exch_t *exch, vfs_file_t *file, aoff64_t pos,
     ipc_call_t *answer, bool read, void *data)
 {
@@ -448,7 +491,7 @@ static errno_t vfs_rdwr(int fd, aoff64_t pos, bool read, rdwr_ipc_cb_t ipc_cb,
 
 	if (file->node->type == VFS_NODE_DIRECTORY) {
 		/*
-		 * Make sure that no one is modifying the namespace
+		 * Make sure that no one is modifying the directory
 		 * while we are in readdir().
 		 */
 
@@ -464,7 +507,7 @@ static errno_t vfs_rdwr(int fd, aoff64_t pos, bool read, rdwr_ipc_cb_t ipc_cb,
 			return EINVAL;
 		}
 
-		fibril_rwlock_read_lock(&namespace_rwlock);
+		fibril_rwlock_read_lock(&file->node->dir_rwlock);
 	}
 
 	async_exch_t *fs_exch = vfs_exchange_grab(file->node->fs_handle);
@@ -472,6 +515,8 @@ static errno_t vfs_rdwr(int fd, aoff64_t pos, bool read, rdwr_ipc_cb_t ipc_cb,
 	if (!read && file->append)
 		pos = file->node->size;
 
+	aoff64_t old_size = file->node->size;
+
 	/*
 	 * Handle communication with the endpoint FS.
 	 */
@@ -480,8 +525,17 @@ static errno_t vfs_rdwr(int fd, aoff64_t pos, bool read, rdwr_ipc_cb_t ipc_cb,
 
 	vfs_exchange_release(fs_exch);
 
+	if (!read && rc == EOK) {
+		/*
+		 * Drop cached pages which were overwritten, including
+		 * the previous last page if the file grew.
+		 */
+		vfs_pcache_invalidate(file->node, min(pos, old_size),
+		    pos + ipc_get_arg1(&answer));
+	}
+
 	if (file->node->type == VFS_NODE_DIRECTORY)
-		fibril_rwlock_read_unlock(&namespace_rwlock);
+		fibril_rwlock_read_unlock(&file->node->dir_rwlock);
 
 	/* Unlock the VFS node. */
 	if (rlock) {
@@ -510,6 +564,78 @@ errno_t vfs_op_read(int fd, aoff64_t pos, size_t *out_bytes)
 	return vfs_rdwr(fd, pos, true, rdwr_ipc_client, out_bytes);
 }
 
+/** Read a batch of directory entries.
+ *
+ * The client's IPC_M_DATA_READ is forwarded to the file system which fills
+ * it with packed vfs_dirent_t entries.
+ *
+ * @param fd         Directory file descriptor
+ * @param pos        Position of the first entry to read
+ * @param out_used   Place to store number of bytes transferred
+ * @param out_npos   Place to store position of the next entry
+ *
+ * @return EOK on success or an error code
+ */
+errno_t vfs_op_readdir(int fd, aoff64_t pos, size_t *out_used,
+    aoff64_t *out_npos)
+{
+	readdir_result_t res;
+	vfs_file_t *file;
+	errno_t rc;
+
+	file = vfs_file_get(fd);
+	if (!file)
+		return EBADF;
+
+	if (file->node->type != VFS_NODE_DIRECTORY) {
+		vfs_file_put(file);
+		return ENOTDIR;
+	}
+
+	vfs_file_put(file);
+
+	rc = vfs_rdwr(fd, pos, true, rdwr_ipc_readdir, &res);
+	if (rc != EOK)
+		return rc;
+
+	*out_used = res.used;
+	*out_npos = res.npos;
+	return EOK;
+}
+
+/** Lock the parent directories of a rename.
+ *
+ * The directory locks are taken in the order of node addresses so that
+ * two renames between the same pair of directories cannot deadlock.
+ *
+ * @param a  First directory.
+ * @param b  Second directory, possibly the same as @a a.
+ */
+static void rename_lock_dirs(vfs_node_t *a, vfs_node_t *b)
+{
+	if ((uintptr_t) a > (uintptr_t) b) {
+		vfs_node_t *t = a;
+		a = b;
+		b = t;
+	}
+
+	fibril_rwlock_write_lock(&a->dir_rwlock);
+	if (b != a)
+		fibril_rwlock_write_lock(&b->dir_rwlock);
+}
+
+/** Unlock the parent directories of a rename.
+ *
+ * @param a  First directory.
+ * @param b  Second directory, possibly the same as @a a.
+ */
+static void rename_unlock_dirs(vfs_node_t *a, vfs_node_t *b)
+{
+	if (b != a)
+		fibril_rwlock_write_unlock(&b->dir_rwlock);
+	fibril_rwlock_write_unlock(&a->dir_rwlock);
+}
+
 errno_t vfs_op_rename(int basefd, char *old, char *new)
 {
 	vfs_file_t *base_file = vfs_file_get(basefd);
@@ -523,6 +649,10 @@ errno_t vfs_op_rename(int basefd, char *old, char *new)
 	vfs_lookup_res_t base_lr;
 	vfs_lookup_res_t old_lr;
 	vfs_lookup_res_t new_lr_orig;
+	vfs_node_t *old_dir = NULL;
+	vfs_node_t *new_dir = NULL;
+	char *old_name;
+	char *new_name;
 	bool orig_unlinked = false;
 
 	errno_t rc;
@@ -537,7 +667,14 @@ errno_t vfs_op_rename(int basefd, char *old, char *new)
 	assert(old[shared] == '/');
 	assert(new[shared] == '/');
 
-	fibril_rwlock_write_lock(&namespace_rwlock);
+	fibril_rwlock_read_lock(&namespace_rwlock);
+
+	/*
+	 * Renames are serialized among themselves so that the paths cannot
+	 * change under our hands, e.g. two concurrent renames cannot move
+	 * two directories into each other.
+	 */
+	fibril_mutex_lock(&rename_mutex);
 
 	/* Resolve the shared portion of the path first. */
 	if (shared != 0) {
@@ -545,56 +682,63 @@ errno_t vfs_op_rename(int basefd, char *old, char *new)
 		rc = vfs_lookup_internal(base, old, L_DIRECTORY, &base_lr);
 		if (rc != EOK) {
 			vfs_node_put(base);
-			fibril_rwlock_write_unlock(&namespace_rwlock);
-			return rc;
+			goto out;
 		}
 
 		vfs_node_put(base);
 		base = vfs_node_get(&base_lr);
 		if (!base) {
-			fibril_rwlock_write_unlock(&namespace_rwlock);
-			return ENOMEM;
+			rc = ENOMEM;
+			goto out;
 		}
 		old[shared] = '/';
 		old += shared;
 		new += shared;
 	}
 
-	rc = vfs_lookup_internal(base, old, L_DISABLE_MOUNTS, &old_lr);
+	rc = vfs_lookup_parent(base, old, L_DISABLE_MOUNTS, &old_dir,
+	    &old_name);
 	if (rc != EOK) {
 		vfs_node_put(base);
-		fibril_rwlock_write_unlock(&namespace_rwlock);
-		return rc;
+		goto out;
 	}
 
-	rc = vfs_lookup_internal(base, new, L_UNLINK | L_DISABLE_MOUNTS,
+	rc = vfs_lookup_parent(base, new, L_DISABLE_MOUNTS, &new_dir,
+	    &new_name);
+	vfs_node_put(base);
+	if (rc != EOK) {
+		vfs_node_put(old_dir);
+		goto out;
+	}
+
+	rename_lock_dirs(old_dir, new_dir);
+
+	rc = vfs_lookup_internal(old_dir, old_name, L_DISABLE_MOUNTS, &old_lr);
+	if (rc != EOK)
+		goto out_unlock;
+
+	rc = vfs_lookup_internal(new_dir, new_name, L_UNLINK | L_DISABLE_MOUNTS,
 	    &new_lr_orig);
 	if (rc == EOK) {
 		orig_unlinked = true;
 	} else if (rc != ENOENT) {
-		vfs_node_put(base);
-		fibril_rwlock_write_unlock(&namespace_rwlock);
-		return rc;
+		goto out_unlock;
 	}
 
-	rc = vfs_link_internal(base, new, &old_lr.triplet);
+	rc = vfs_link_internal(new_dir, new_name, &old_lr.triplet);
 	if (rc != EOK) {
-		vfs_link_internal(base, old, &old_lr.triplet);
+		vfs_link_internal(old_dir, old_name, &old_lr.triplet);
 		if (orig_unlinked)
-			vfs_link_internal(base, new, &new_lr_orig.triplet);
-		vfs_node_put(base);
-		fibril_rwlock_write_unlock(&namespace_rwlock);
-		return rc;
+			vfs_link_internal(new_dir, new_name, &new_lr_orig.triplet);
+		goto out_unlock;
 	}
 
-	rc = vfs_lookup_internal(base, old, L_UNLINK | L_DISABLE_MOUNTS,
+	rc = vfs_lookup_internal(old_dir, old_name, L_UNLINK | L_DISABLE_MOUNTS,
 	    &old_lr);
 	if (rc != EOK) {
 		if (orig_unlinked)
-			vfs_link_internal(base, new, &new_lr_orig.triplet);
-		vfs_node_put(base);
-		fibril_rwlock_write_unlock(&namespace_rwlock);
-		return rc;
+			vfs_link_internal(new_dir, new_name, &new_lr_orig.triplet);
+		goto out_unlock;
 	}
 
 	/* If the node is not held by anyone, try to destroy it. */
@@ -606,9 +750,15 @@ errno_t vfs_op_rename(int basefd, char *old, char *new)
 			vfs_node_put(node);
 	}
 
-	vfs_node_put(base);
-	fibril_rwlock_write_unlock(&namespace_rwlock);
-	return EOK;
+	rc = EOK;
+out_unlock:
+	rename_unlock_dirs(old_dir, new_dir);
+	vfs_node_put(old_dir);
+	vfs_node_put(new_dir);
+out:
+	fibril_mutex_unlock(&rename_mutex);
+	fibril_rwlock_read_unlock(&namespace_rwlock);
+	return rc;
 }
 
 errno_t vfs_op_resize(int fd, int64_t size)
@@ -626,8 +776,11 @@ errno_t vfs_op_resize(int fd, int64_t size)
 
 	errno_t rc = vfs_truncate_internal(file->node->fs_handle,
 	    file->node->service_id, file->node->index, size);
-	if (rc == EOK)
+	if (rc == EOK) {
+		vfs_pcache_invalidate(file->node,
+		    min((aoff64_t) size, file->node->size), UINT64_MAX);
 		file->node->size = size;
+	}
 
 	fibril_rwlock_write_unlock(&file->node->contents_rwlock);
 	vfs_file_put(file);
@@ -651,6 +804,157 @@ errno_t vfs_op_stat(int fd)
 	return rc;
 }
 
+/** Get information about nodes in one batch from their file system.
+ *
+ * Nodes are grouped by file system instance so that each instance only
+ * receives a single VFS_OUT_STAT_BULK request.
+ */
+static void stat_bulk_remote(vfs_triplet_t *trip, size_t count,
+    vfs_stat_t *stats, errno_t *rcs)
+{
+	fs_index_t indices[VFS_STAT_BULK_MAX];
+	size_t map[VFS_STAT_BULK_MAX];
+	vfs_stat_t gstats[VFS_STAT_BULK_MAX];
+	errno_t grcs[VFS_STAT_BULK_MAX];
+	bool pending[VFS_STAT_BULK_MAX];
+
+	assert(count <= VFS_STAT_BULK_MAX);
+
+	for (size_t i = 0; i < count; i++)
+		pending[i] = (rcs[i] == EOK);
+
+	for (size_t i = 0; i < count; i++) {
+		if (!pending[i])
+			continue;
+
+		/* Gather all pending nodes living in the same instance. */
+		size_t n = 0;
+		for (size_t j = i; j < count; j++) {
+			if (!pending[j] ||
+			    trip[j].fs_handle != trip[i].fs_handle ||
+			    trip[j].service_id != trip[i].service_id)
+				continue;
+
+			pending[j] = false;
+			indices[n] = trip[j].index;
+			map[n] = j;
+			n++;
+		}
+
+		ipc_call_t answer;
+		async_exch_t *exch = vfs_exchange_grab(trip[i].fs_handle);
+		aid_t msg = async_send_2(exch, VFS_OUT_STAT_BULK,
+		    trip[i].service_id, n, &answer);
+
+		/*
+		 * The file system expects all three transfers even if one
+		 * of them fails.
+		 */
+		errno_t rc = async_data_write_start(exch, indices,
+		    n * sizeof(fs_index_t));
+		errno_t rc2 = async_data_read_start(exch, gstats,
+		    n * sizeof(vfs_stat_t));
+		if (rc == EOK)
+			rc = rc2;
+		rc2 = async_data_read_start(exch, grcs, n * sizeof(errno_t));
+		if (rc == EOK)
+			rc = rc2;
+
+		vfs_exchange_release(exch);
+
+		async_wait_for(msg, &rc2);
+		if (rc == EOK)
+			rc = rc2;
+
+		for (size_t k = 0; k < n; k++) {
+			rcs[map[k]] = (rc == EOK) ? grcs[k] : rc;
+			if (rcs[map[k]] == EOK)
+				stats[map[k]] = gstats[k];
+		}
+	}
+}
+
+/** Get information about several nodes at paths relative to a directory.
+ *
+ * All names are resolved first, possibly from the path lookup cache, and
+ * then stat'ed with at most one request per file system instance.
+ *
+ * @param parentfd  Directory file descriptor the names are relative to
+ * @param names     Buffer with @a count NUL-terminated names
+ * @param count     Number of names, at most VFS_STAT_BULK_MAX
+ * @param stats     Array to fill with file information
+ * @param rcs       Array to fill with per-name return codes
+ *
+ * @return EOK if the request was processed (even if some names failed)
+ *         or an error code
+ */
+errno_t vfs_op_stat_bulk(int parentfd, const char *names, size_t count,
+    vfs_stat_t *stats, errno_t *rcs)
+{
+	vfs_triplet_t trip[VFS_STAT_BULK_MAX];
+	const char *name;
+
+	if (count == 0 || count > VFS_STAT_BULK_MAX)
+		return EINVAL;
+
+	vfs_file_t *parent = vfs_file_get(parentfd);
+	if (!parent)
+		return EBADF;
+
+	fibril_rwlock_read_lock(&namespace_rwlock);
+
+	/*
+	 * The names are held by the directory mounted at the parent, if any.
+	 * Prevent them from being unlinked until we stat them.
+	 */
+	vfs_node_t *dir = parent->node;
+	vfs_node_addref(dir);
+	while (dir->mount) {
+		vfs_node_t *mp = dir->mount;
+		vfs_node_addref(mp);
+		vfs_node_put(dir);
+		dir = mp;
+	}
+
+	fibril_rwlock_read_lock(&dir->dir_rwlock);
+
+	name = names;
+	for (size_t i = 0; i < count; i++) {
+		size_t nsize = str_size(name);
+
+		/* Lookup needs an absolute path relative to parent. */
+		char *path = malloc(nsize + 2);
+		if (path == NULL) {
+			rcs[i] = ENOMEM;
+			name += nsize + 1;
+			continue;
+		}
+
+		if (name[0] == '/') {
+			str_cpy(path, nsize + 2, name);
+		} else {
+			path[0] = '/';
+			str_cpy(path + 1, nsize + 1, name);
+		}
+
+		vfs_lookup_res_t lr;
+		rcs[i] = vfs_lookup_internal(dir, path, L_NONE, &lr);
+		if (rcs[i] == EOK)
+			trip[i] = lr.triplet;
+
+		free(path);
+		name += nsize + 1;
+	}
+
+	stat_bulk_remote(trip, count, stats, rcs);
+
+	fibril_rwlock_read_unlock(&dir->dir_rwlock);
+	vfs_node_put(dir);
+	fibril_rwlock_read_unlock(&namespace_rwlock);
+	vfs_file_put(parent);
+	return EOK;
+}
+
 errno_t vfs_op_statfs(int fd)
 {
 	vfs_file_t *file = vfs_file_get(fd);
@@ -708,11 +1012,13 @@ errno_t vfs_op_unlink(int parentfd, int expectfd, char *path)
 	errno_t rc = EOK;
 	vfs_file_t *parent = NULL;
 	vfs_file_t *expect = NULL;
+	vfs_node_t *dir = NULL;
+	char *name;
 
 	if (parentfd == expectfd)
 		return EINVAL;
 
-	fibril_rwlock_write_lock(&namespace_rwlock);
+	fibril_rwlock_read_lock(&namespace_rwlock);
 
 	/*
 	 * Files are retrieved in order of file descriptors, to prevent
@@ -744,9 +1050,15 @@ errno_t vfs_op_unlink(int parentfd, int expectfd, char *path)
 
 	assert(parent != NULL);
 
+	rc = vfs_lookup_parent(parent->node, path, 0, &dir, &name);
+	if (rc != EOK)
+		goto exit;
+
+	fibril_rwlock_write_lock(&dir->dir_rwlock);
+
 	if (expectfd >= 0) {
 		vfs_lookup_res_t lr;
-		rc = vfs_lookup_internal(parent->node, path, 0, &lr);
+		rc = vfs_lookup_internal(dir, name, 0, &lr);
 		if (rc != EOK)
 			goto exit;
 
@@ -762,7 +1074,7 @@ errno_t vfs_op_unlink(int parentfd, int expectfd, char *path)
 	}
 
 	vfs_lookup_res_t lr;
-	rc = vfs_lookup_internal(parent->node, path, L_UNLINK, &lr);
+	rc = vfs_lookup_internal(dir, name, L_UNLINK, &lr);
 	if (rc != EOK)
 		goto exit;
 
@@ -774,13 +1086,17 @@ errno_t vfs_op_unlink(int parentfd, int expectfd, char *path)
 		vfs_node_put(node);
 
 exit:
+	if (dir) {
+		fibril_rwlock_write_unlock(&dir->dir_rwlock);
+		vfs_node_put(dir);
+	}
 	if (path)
 		free(path);
 	if (parent)
 		vfs_file_put(parent);
 	if (expect)
 		vfs_file_put(expect);
-	fibril_rwlock_write_unlock(&namespace_rwlock);
+	fibril_rwlock_read_unlock(&namespace_rwlock);
 	return rc;
 }
 
@@ -797,6 +1113,10 @@ errno_t vfs_op_unmount(int mpfd)
 
 	fibril_rwlock_write_lock(&namespace_rwlock);
 
+	/* Release node references held by the path lookup cache. */
+	vfs_dcache_purge_fs(mp->node->mount->fs_handle,
+	    mp->node->mount->service_id);
+
 	/*
 	 * Count the total number of references for the mounted file system. We
 	 * are expecting at least one, which is held by the mount point.
@@ -879,20 +1199,45 @@ errno_t vfs_op_walk(int parentfd, int flags, char *path, int *out_fd)
 
 	fibril_rwlock_read_lock(&namespace_rwlock);
 
-	vfs_lookup_res_t lr;
-	errno_t rc = vfs_lookup_internal(parent->node, path,
-	    walk_lookup_flags(flags), &lr);
+	int lflags = walk_lookup_flags(flags);
+	vfs_node_t *dir;
+	char *name;
+	errno_t rc = vfs_lookup_parent(parent->node, path, lflags, &dir, &name);
 	if (rc != EOK) {
 		fibril_rwlock_read_unlock(&namespace_rwlock);
 		vfs_file_put(parent);
 		return rc;
 	}
 
-	vfs_node_t *node = vfs_node_get(&lr);
-	if (!node) {
+	/*
+	 * Keep the directory locked until we hold a reference to the node
+	 * so that it cannot be unlinked and destroyed in the meantime.
+	 */
+	bool create = (lflags & L_CREATE) != 0;
+	if (create)
+		fibril_rwlock_write_lock(&dir->dir_rwlock);
+	else
+		fibril_rwlock_read_lock(&dir->dir_rwlock);
+
+	vfs_lookup_res_t lr;
+	vfs_node_t *node = NULL;
+	rc = vfs_lookup_internal(dir, name, lflags, &lr);
+	if (rc == EOK) {
+		node = vfs_node_get(&lr);
+		if (!node)
+			rc = ENOMEM;
+	}
+
+	if (create)
+		fibril_rwlock_write_unlock(&dir->dir_rwlock);
+	else
+		fibril_rwlock_read_unlock(&dir->dir_rwlock);
+	vfs_node_put(dir);
+
+	if (rc != EOK) {
 		fibril_rwlock_read_unlock(&namespace_rwlock);
 		vfs_file_put(parent);
-		return ENOMEM;
+		return rc;
 	}
 
 	vfs_file_t *file;
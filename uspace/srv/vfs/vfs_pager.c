@@ -41,11 +41,14 @@
 #include <errno.h>
 #include <as.h>
 
-void vfs_page_in(ipc_call_t *req)
+/** Serve page-in request with a private copy of the page.
+ *
+ * This is the default, as a mapping that may be written to must not
+ * share frames with the page cache.
+ */
+static void vfs_page_in_private(ipc_call_t *req, aoff64_t offset,
+    size_t page_size, int fd)
 {
-	aoff64_t offset = ipc_get_arg1(req);
-	size_t page_size = ipc_get_arg2(req);
-	int fd = ipc_get_arg3(req);
 	void *page;
 	errno_t rc;
 
@@ -80,14 +83,74 @@ void vfs_page_in(ipc_call_t *req)
 	async_answer_1(req, rc, (sysarg_t) page);
 
 	/*
-	 * FIXME:
-	 * This is just for now until we implement proper page cache
-	 * management.  Not keeping the pages around in a cache results in
-	 * inherently non-coherent private mappings.
+	 * The kernel holds its own reference to the frame, so the area
+	 * can go away right after answering.
 	 */
 	as_area_destroy(page);
 }
 
+/** Serve page-in request.
+ *
+ * Pages are copied unless the mapping was created with VFS_PAGER_SHARED.
+ * Such read-only mappings (e.g. program text) are given the frame of
+ * the page cache, so that all tasks mapping the same file share the same
+ * memory.
+ *
+ * @param req Page-in request
+ */
+void vfs_page_in(ipc_call_t *req)
+{
+	aoff64_t offset = ipc_get_arg1(req) + ipc_get_arg5(req);
+	size_t page_size = ipc_get_arg2(req);
+	int fd = ipc_get_arg3(req);
+	sysarg_t flags = ipc_get_arg4(req);
+	vfs_cpage_t *cpage;
+	size_t valid;
+	errno_t rc;
+
+	if ((flags & VFS_PAGER_SHARED) == 0 || page_size != PAGE_SIZE ||
+	    offset % PAGE_SIZE != 0) {
+		vfs_page_in_private(req, offset, page_size, fd);
+		return;
+	}
+
+	vfs_file_t *file = vfs_file_get(fd);
+	if (file == NULL) {
+		async_answer_0(req, EBADF);
+		return;
+	}
+
+	if (!file->open_read || file->node->type != VFS_NODE_FILE) {
+		vfs_file_put(file);
+		async_answer_0(req, EINVAL);
+		return;
+	}
+
+	if (!vfs_pcache_enabled(file->node)) {
+		vfs_file_put(file);
+		vfs_page_in_private(req, offset, page_size, fd);
+		return;
+	}
+
+	fibril_rwlock_read_lock(&file->node->contents_rwlock);
+
+	async_exch_t *exch = vfs_exchange_grab(file->node->fs_handle);
+	rc = vfs_pcache_get(exch, file->node, offset / PAGE_SIZE, &cpage);
+	vfs_exchange_release(exch);
+
+	fibril_rwlock_read_unlock(&file->node->contents_rwlock);
+	vfs_file_put(file);
+
+	if (rc != EOK) {
+		async_answer_0(req, rc);
+		return;
+	}
+
+	/* The kernel adds its own reference to the frame. */
+	async_answer_1(req, EOK, (sysarg_t) vfs_pcache_data(cpage, &valid));
+	vfs_pcache_put(cpage);
+}
+
 /**
  * @}
  */
@@ -0,0 +1,540 @@
+/*
+ * Copyright (c) 2025 Jiri Svoboda
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/** @addtogroup vfs
+ * @{
+ */
+
+/**
+ * @file	vfs_pcache.c
+ * @brief	File page cache.
+ *
+ * The cache keeps pages of regular files keyed by the node triplet and
+ * the page index. Each page is backed by its own address space area, so
+ * that the very same frame can be handed out to the kernel when serving
+ * a page fault in a read-only mapping created with VFS_PAGER_SHARED (such
+ * as program text mapped by the ELF loader). Reads served through
+ * vfs_read() copy from the same pages.
+ *
+ * Cached pages are never modified. Writes and truncations invalidate the
+ * affected pages, clients that still have the old frame mapped keep it.
+ * Each node keeps a list of its cached pages, so that invalidation does
+ * not need to look at pages of other files.
+ *
+ * Only file systems which set cache_pages in their VFS info are cached.
+ */
+
+#include "vfs.h"
+#include <adt/hash.h>
+#include <adt/hash_table.h>
+#include <adt/list.h>
+#include <as.h>
+#include <errno.h>
+#include <fibril_synch.h>
+#include <macros.h>
+#include <mem.h>
+#include <stdlib.h>
+
+/** Maximum number of cached pages */
+#define PCACHE_SIZE	1024
+
+/** Maximum number of bytes returned by one cached read */
+#define PCACHE_READ_MAX	(64 * 1024)
+
+/** Cached page. */
+struct vfs_cpage {
+	/** Link in pages hash table */
+	ht_link_t link;
+	/** Link in LRU list */
+	link_t lru_link;
+	/** Link in the node's list of cached pages */
+	link_t node_link;
+	/** File the page belongs to */
+	vfs_triplet_t triplet;
+	/** Page index within the file */
+	uint64_t idx;
+	/** Page contents */
+	void *data;
+	/** Number of valid bytes, less than page size at end of file */
+	size_t valid;
+	/** Number of references including the one held by the cache */
+	unsigned refcnt;
+	/** Page is in the cache */
+	bool cached;
+};
+
+/** Lookup key of a cached page. */
+typedef struct {
+	const vfs_triplet_t *triplet;
+	uint64_t idx;
+} cpage_key_t;
+
+static size_t cpages_key_hash(const void *);
+static size_t cpages_hash(const ht_link_t *);
+static bool cpages_key_equal(const void *, size_t, const ht_link_t *);
+
+static const hash_table_ops_t cpages_ops = {
+	.hash = cpages_hash,
+	.key_hash = cpages_key_hash,
+	.key_equal = cpages_key_equal,
+	.equal = NULL,
+	.remove_callback = NULL
+};
+
+/** Mutex protecting the cache. */
+static FIBRIL_MUTEX_INITIALIZE(pcache_mutex);
+
+/** Hash table of cached pages. */
+static hash_table_t cpages;
+
+/** Cached pages, least recently used first. */
+static LIST_INITIALIZE(pcache_lru);
+
+/** Number of cached pages. */
+static size_t pcache_count;
+
+/** Incremented with every invalidation. */
+static unsigned pcache_gen;
+
+static size_t cpage_hash(const vfs_triplet_t *triplet, uint64_t idx)
+{
+	size_t hash = hash_combine(triplet->fs_handle, triplet->service_id);
+	hash = hash_combine(hash, triplet->index);
+	return hash_combine(hash, hash_mix64(idx));
+}
+
+static size_t cpages_key_hash(const void *k)
+{
+	const cpage_key_t *key = k;
+	return cpage_hash(key->triplet, key->idx);
+}
+
+static size_t cpages_hash(const ht_link_t *item)
+{
+	vfs_cpage_t *cpage = hash_table_get_inst(item, vfs_cpage_t, link);
+	return cpage_hash(&cpage->triplet, cpage->idx);
+}
+
+static bool cpages_key_equal(const void *k, size_t hash,
+    const ht_link_t *item)
+{
+	const cpage_key_t *key = k;
+	vfs_cpage_t *cpage = hash_table_get_inst(item, vfs_cpage_t, link);
+
+	return cpage->idx == key->idx &&
+	    cpage->triplet.fs_handle == key->triplet->fs_handle &&
+	    cpage->triplet.service_id == key->triplet->service_id &&
+	    cpage->triplet.index == key->triplet->index;
+}
+
+/** Initialize the page cache.
+ *
+ * @return True on success, false on failure.
+ */
+bool vfs_pcache_init(void)
+{
+	return hash_table_create(&cpages, 0, 0, &cpages_ops);
+}
+
+/** Free page which is no longer referenced. */
+static void cpage_destroy(vfs_cpage_t *cpage)
+{
+	as_area_destroy(cpage->data);
+	free(cpage);
+}
+
+/** Remove page from the cache and drop the cache's reference.
+ *
+ * @param cpage Page to remove
+ * @return True if the page should be destroyed by the caller.
+ */
+static bool cpage_remove(vfs_cpage_t *cpage)
+{
+	assert(cpage->cached);
+
+	hash_table_remove_item(&cpages, &cpage->link);
+	list_remove(&cpage->lru_link);
+	list_remove(&cpage->node_link);
+	cpage->cached = false;
+	pcache_count--;
+
+	return --cpage->refcnt == 0;
+}
+
+/** Make room for a new page by evicting an unused page.
+ *
+ * @return Evicted page that needs to be destroyed or @c NULL
+ */
+static vfs_cpage_t *pcache_evict(void)
+{
+	list_foreach(pcache_lru, lru_link, vfs_cpage_t, cpage) {
+		/* Skip pages that are in use. */
+		if (cpage->refcnt > 1)
+			continue;
+
+		if (cpage_remove(cpage))
+			return cpage;
+		break;
+	}
+
+	return NULL;
+}
+
+/** Read page from the file system.
+ *
+ * @param exch    Exchange with the file system
+ * @param triplet File
+ * @param idx     Page index
+ * @param data    Page buffer
+ * @param valid   Place to store number of bytes read
+ *
+ * @return EOK on success or an error code
+ */
+static errno_t pcache_fill(async_exch_t *exch, vfs_triplet_t *triplet,
+    uint64_t idx, void *data, size_t *valid)
+{
+	aoff64_t pos = idx * PAGE_SIZE;
+	size_t total = 0;
+
+	while (total < PAGE_SIZE) {
+		ipc_call_t answer;
+		aid_t msg = async_send_4(exch, VFS_OUT_READ,
+		    triplet->service_id, triplet->index,
+		    LOWER32(pos + total), UPPER32(pos + total), &answer);
+
+		errno_t rc = async_data_read_start(exch, data + total,
+		    PAGE_SIZE - total);
+		if (rc != EOK) {
+			async_forget(msg);
+			return rc;
+		}
+
+		async_wait_for(msg, &rc);
+		if (rc != EOK)
+			return rc;
+
+		size_t n = ipc_get_arg1(&answer);
+		if (n == 0)
+			break;
+
+		total += n;
+	}
+
+	*valid = total;
+	return EOK;
+}
+
+/** Check whether pages of a file may be cached.
+ *
+ * @param node File node
+ *
+ * @return True if the file system of the node opted in to page caching.
+ */
+bool vfs_pcache_enabled(vfs_node_t *node)
+{
+	vfs_info_t *info = fs_handle_to_info(node->fs_handle);
+
+	return info != NULL && info->cache_pages &&
+	    node->type == VFS_NODE_FILE;
+}
+
+/** Get page of a file.
+ *
+ * If the page is not cached, it is read from the file system. The caller
+ * must hold the node's contents lock for reading and must release the
+ * page using vfs_pcache_put().
+ *
+ * @param exch  Exchange with the file system
+ * @param node  File node
+ * @param idx   Page index
+ * @param rpage Place to store the page
+ *
+ * @return EOK on success or an error code
+ */
+errno_t vfs_pcache_get(async_exch_t *exch, vfs_node_t *node, uint64_t idx,
+    vfs_cpage_t **rpage)
+{
+	vfs_triplet_t triplet = {
+		.fs_handle = node->fs_handle,
+		.service_id = node->service_id,
+		.index = node->index
+	};
+	cpage_key_t key = {
+		.triplet = &triplet,
+		.idx = idx
+	};
+	vfs_cpage_t *cpage;
+	vfs_cpage_t *victim = NULL;
+	ht_link_t *link;
+
+	fibril_mutex_lock(&pcache_mutex);
+
+	link = hash_table_find(&cpages, &key);
+	if (link != NULL) {
+		cpage = hash_table_get_inst(link, vfs_cpage_t, link);
+		cpage->refcnt++;
+
+		/* Move to the end of the LRU list */
+		list_remove(&cpage->lru_link);
+		list_append(&cpage->lru_link, &pcache_lru);
+
+		fibril_mutex_unlock(&pcache_mutex);
+		*rpage = cpage;
+		return EOK;
+	}
+
+	unsigned gen = pcache_gen;
+	fibril_mutex_unlock(&pcache_mutex);
+
+	cpage = calloc(1, sizeof(vfs_cpage_t));
+	if (cpage == NULL)
+		return ENOMEM;
+
+	cpage->data = as_area_create(AS_AREA_ANY, PAGE_SIZE,
+	    AS_AREA_READ | AS_AREA_WRITE | AS_AREA_CACHEABLE,
+	    AS_AREA_UNPAGED);
+	if (cpage->data == AS_MAP_FAILED) {
+		free(cpage);
+		return ENOMEM;
+	}
+
+	errno_t rc = pcache_fill(exch, &triplet, idx, cpage->data,
+	    &cpage->valid);
+	if (rc != EOK) {
+		cpage_destroy(cpage);
+		return rc;
+	}
+
+	/* Clear the rest of the page past the end of file. */
+	memset(cpage->data + cpage->valid, 0, PAGE_SIZE - cpage->valid);
+
+	cpage->triplet = triplet;
+	cpage->idx = idx;
+	cpage->refcnt = 1;
+	link_initialize(&cpage->lru_link);
+	link_initialize(&cpage->node_link);
+
+	fibril_mutex_lock(&pcache_mutex);
+
+	if (gen != pcache_gen) {
+		/*
+		 * The file may have been modified while we were reading
+		 * the page. Return the page to the caller without caching it.
+		 */
+		fibril_mutex_unlock(&pcache_mutex);
+		*rpage = cpage;
+		return EOK;
+	}
+
+	link = hash_table_find(&cpages, &key);
+	if (link != NULL) {
+		/* Someone else was faster. */
+		vfs_cpage_t *other = hash_table_get_inst(link, vfs_cpage_t,
+		    link);
+		other->refcnt++;
+		fibril_mutex_unlock(&pcache_mutex);
+
+		cpage_destroy(cpage);
+		*rpage = other;
+		return EOK;
+	}
+
+	if (pcache_count >= PCACHE_SIZE)
+		victim = pcache_evict();
+
+	/* One reference for the cache and one for the caller */
+	cpage->refcnt = 2;
+	cpage->cached = true;
+	hash_table_insert(&cpages, &cpage->link);
+	list_append(&cpage->lru_link, &pcache_lru);
+	list_append(&cpage->node_link, &node->cpages);
+	pcache_count++;
+
+	fibril_mutex_unlock(&pcache_mutex);
+
+	if (victim != NULL)
+		cpage_destroy(victim);
+
+	*rpage = cpage;
+	return EOK;
+}
+
+/** Release page obtained by vfs_pcache_get().
+ *
+ * @param cpage Page
+ */
+void vfs_pcache_put(vfs_cpage_t *cpage)
+{
+	fibril_mutex_lock(&pcache_mutex);
+	bool destroy = (--cpage->refcnt == 0);
+	fibril_mutex_unlock(&pcache_mutex);
+
+	if (destroy)
+		cpage_destroy(cpage);
+}
+
+/** Get page contents.
+ *
+ * @param cpage Page
+ * @param valid Place to store the number of valid bytes
+ *
+ * @return Pointer to page contents
+ */
+void *vfs_pcache_data(vfs_cpage_t *cpage, size_t *valid)
+{
+	*valid = cpage->valid;
+	return cpage->data;
+}
+
+/** Serve a client read from the page cache.
+ *
+ * @param exch   Exchange with the file system
+ * @param node   File node
+ * @param pos    Position in the file
+ * @param call   Client's IPC_M_DATA_READ call
+ * @param size   Size requested by the client
+ * @param rbytes Place to store number of bytes read
+ *
+ * @return EOK on success or an error code
+ */
+errno_t vfs_pcache_read(async_exch_t *exch, vfs_node_t *node, aoff64_t pos,
+    ipc_call_t *call, size_t size, size_t *rbytes)
+{
+	size_t off = pos % PAGE_SIZE;
+	vfs_cpage_t *cpage;
+	errno_t rc;
+
+	size = min(size, PCACHE_READ_MAX);
+
+	rc = vfs_pcache_get(exch, node, pos / PAGE_SIZE, &cpage);
+	if (rc != EOK) {
+		async_answer_0(call, rc);
+		return rc;
+	}
+
+	if (off >= cpage->valid) {
+		/* Reading beyond end of file */
+		vfs_pcache_put(cpage);
+		*rbytes = 0;
+		return async_data_read_finalize(call, NULL, 0);
+	}
+
+	size_t bytes = min(size, cpage->valid - off);
+	uint8_t *buf = NULL;
+
+	/* The read continues to the following pages, use a bounce buffer. */
+	if (bytes < size && cpage->valid == PAGE_SIZE)
+		buf = malloc(size);
+
+	if (buf == NULL) {
+		/* Serve the data straight from the cached page. */
+		rc = async_data_read_finalize(call, cpage->data + off, bytes);
+		vfs_pcache_put(cpage);
+		*rbytes = bytes;
+		return rc;
+	}
+
+	memcpy(buf, cpage->data + off, bytes);
+	pos += bytes;
+	vfs_pcache_put(cpage);
+
+	while (bytes < size) {
+		rc = vfs_pcache_get(exch, node, pos / PAGE_SIZE, &cpage);
+		if (rc != EOK)
+			break;
+
+		size_t now = min(size - bytes, cpage->valid);
+		memcpy(buf + bytes, cpage->data, now);
+		bytes += now;
+		pos += now;
+
+		bool eof = cpage->valid < PAGE_SIZE;
+		vfs_pcache_put(cpage);
+		if (eof)
+			break;
+	}
+
+	/* Return what we have even if reading a following page failed. */
+	rc = async_data_read_finalize(call, buf, bytes);
+	free(buf);
+	*rbytes = bytes;
+	return rc;
+}
+
+/** Invalidate cached pages of a file in a byte range.
+ *
+ * @param node File node
+ * @param from Start of the range
+ * @param to   End of the range (exclusive)
+ */
+void vfs_pcache_invalidate(vfs_node_t *node, aoff64_t from, aoff64_t to)
+{
+	LIST_INITIALIZE(dead);
+
+	if (from >= to)
+		return;
+
+	uint64_t first = from / PAGE_SIZE;
+	uint64_t last = (to - 1) / PAGE_SIZE;
+
+	fibril_mutex_lock(&pcache_mutex);
+
+	pcache_gen++;
+
+	list_foreach_safe(node->cpages, cur, next) {
+		vfs_cpage_t *cpage = list_get_instance(cur, vfs_cpage_t,
+		    node_link);
+
+		if (cpage->idx < first || cpage->idx > last)
+			continue;
+
+		if (cpage_remove(cpage))
+			list_append(&cpage->lru_link, &dead);
+	}
+
+	fibril_mutex_unlock(&pcache_mutex);
+
+	link_t *link;
+	while ((link = list_first(&dead)) != NULL) {
+		list_remove(link);
+		cpage_destroy(list_get_instance(link, vfs_cpage_t, lru_link));
+	}
+}
+
+/** Remove all cached pages of a file.
+ *
+ * @param node File node
+ */
+void vfs_pcache_purge(vfs_node_t *node)
+{
+	vfs_pcache_invalidate(node, 0, UINT64_MAX);
+}
+
+/**
+ * @}
+ */